@@ -2649,6 +2649,8 @@ end
 --
 -- @param interface Table of interface functions to be used by the interpreter.
 -- @param statements AST table as returned by the parser.
+-- @param statements_private Set if the caller won't reuse the statements table, which
+--                           allows the executor to modify it rather than a copy.
 --
 -- The interface table must have the following functions:
 --
@@ -2662,8 +2664,11 @@ end
 -- Periodically called by the executor to allow processing UI events.
 -- An error() may be raised within to abort the interpreter.
 
-local function execute(interface, statements)
-	statements = util.deep_copy_table(statements)
+local function execute(interface, statements, statements_private)
+	if not statements_private
+	then
+		statements = util.deep_copy_table(statements)
+	end
 	
 	local context = {
 		interface = interface,
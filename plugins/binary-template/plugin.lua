@@ -14,9 +14,33 @@
 -- this program; if not, write to the Free Software Foundation, Inc., 51
 -- Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
-local preprocessor = require 'preprocessor';
-local parser = require 'parser';
 local executor = require 'executor';
+local templatecache = require 'templatecache';
+
+local function _template_mtime(path)
+	if not wx.wxFileExists(path)
+	then
+		return nil
+	end
+	
+	return wx.wxFileModificationTime(path):GetTicks()
+end
+
+local function _template_cache_dir()
+	local dir = wx.wxStandardPaths.Get():GetUserLocalDataDir() .. "/binary-template-cache"
+	
+	if not wx.wxDirExists(dir) and not wx.wxFileName.DirName(dir):Mkdir(493, wx.wxPATH_MKDIR_FULL)
+	then
+		print("Unable to create template cache directory " .. dir)
+		return nil
+	end
+	
+	return dir
+end
+
+-- Parsed templates are cached for the rest of the session (and on disk) so running
+-- a template again doesn't have to wait on the parser.
+local template_cache = templatecache.new(_template_mtime, _template_cache_dir())
 
 local function _find_templates(path)
 	local templates = {}
@@ -248,7 +272,8 @@ rehex.AddToToolsMenu("Execute binary template / script...", function(window)
 		local start_time = os.time()
 		
 		local ok, err = pcall(function()
-			executor.execute(interface, parser.parse_text(preprocessor.preprocess_file(template_path)))
+			local statements = template_cache:get_ast(template_path, function(s) rehex.print_info(s .. "\n") end)
+			executor.execute(interface, statements, true)
 		end)
 		
 		local end_time = os.time()
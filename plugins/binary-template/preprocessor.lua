@@ -69,12 +69,22 @@ local function _preprocess_file(filename, context)
 		include_base = "./";
 	end
 	
+	-- The modification time is taken before the file is read, so a change made while
+	-- we are reading it will still be seen as newer than what we read.
+	local mtime = nil
+	if context.mtime_func ~= nil
+	then
+		mtime = context.mtime_func(filename)
+	end
+	
 	local file, err = io.open(filename, "r")
 	if not file
 	then
 		error("Unable to open " .. filename .. ": " .. err)
 	end
 	
+	table.insert(context.files, { filename, mtime })
+	
 	local line_num = 0
 	local in_comment = false
 	local defining_macro_name = nil
@@ -293,9 +303,16 @@ local function _preprocess_file(filename, context)
 	return output;
 end
 
-M.preprocess_file = function(filename, print_func)
+-- Returns the preprocessed text, followed by an array of every file which was read
+-- (the template itself and anything it #included) so callers can tell when the
+-- output would change. Each element of the array is a { path, mtime } pair, where
+-- mtime is the value mtime_func (if given) returned just before the file was read.
+
+M.preprocess_file = function(filename, print_func, mtime_func)
 	local context = {}
 	
+	context.files = {}
+	context.mtime_func = mtime_func
 	context.if_stack = {}
 	context.no_depth = 0
 	context.macros = {}
@@ -309,7 +326,7 @@ M.preprocess_file = function(filename, print_func)
 		error("Expected '#endif' to terminate '" .. if_ctx.statement .. "' at " .. if_ctx.filename .. ":" .. if_ctx.line_num)
 	end
 	
-	return result
+	return result, context.files
 end
 
 return M;
@@ -123,6 +123,50 @@ describe("preprocessor", function()
 		assert.are.same(expect, got)
 	end)
 	
+	it("returns the list of files read", function()
+		local expect = {
+			{ "preprocessor-tests/include-test-2.bt" },
+			{ "preprocessor-tests/include-test-2a.h" },
+			{ "preprocessor-tests/include-test-2b.h" },
+		}
+		
+		local _, got = preprocessor.preprocess_file("preprocessor-tests/include-test-2.bt", error)
+		
+		assert.are.same(expect, got)
+	end)
+	
+	it("takes the modification time of each file before reading it", function()
+		local events = {}
+		
+		local real_open = io.open
+		io.open = function(path, mode)
+			table.insert(events, "open " .. path)
+			return real_open(path, mode)
+		end
+		
+		finally(function() io.open = real_open end)
+		
+		local _, got = preprocessor.preprocess_file("preprocessor-tests/include-test-2.bt", error, function(path)
+			table.insert(events, "mtime " .. path)
+			return #events
+		end)
+		
+		assert.are.same({
+			"mtime preprocessor-tests/include-test-2.bt",
+			"open preprocessor-tests/include-test-2.bt",
+			"mtime preprocessor-tests/include-test-2a.h",
+			"open preprocessor-tests/include-test-2a.h",
+			"mtime preprocessor-tests/include-test-2b.h",
+			"open preprocessor-tests/include-test-2b.h",
+		}, events)
+		
+		assert.are.same({
+			{ "preprocessor-tests/include-test-2.bt", 1 },
+			{ "preprocessor-tests/include-test-2a.h", 3 },
+			{ "preprocessor-tests/include-test-2b.h", 5 },
+		}, got)
+	end)
+	
 	it("errors on unmatched #ifdef/#ifndef/#else/#endif directives", function()
 		assert.has_error(
 			function() preprocessor.preprocess_file("preprocessor-tests/unmatched-ifdef-test.bt", error) end,
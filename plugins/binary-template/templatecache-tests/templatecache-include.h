@@ -0,0 +1,2 @@
+#warning included
+struct hdr header;
@@ -0,0 +1,413 @@
+-- Binary Template plugin for REHex
+-- Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+--
+-- This program is free software; you can redistribute it and/or modify it
+-- under the terms of the GNU General Public License version 2 as published by
+-- the Free Software Foundation.
+--
+-- This program is distributed in the hope that it will be useful, but WITHOUT
+-- ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+-- FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+-- more details.
+--
+-- You should have received a copy of the GNU General Public License along with
+-- this program; if not, write to the Free Software Foundation, Inc., 51
+-- Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+-- Cache of preprocessed and parsed templates.
+--
+-- Parsing a template (via LuLPeg) is by far the slowest part of starting one up, so
+-- we keep the resulting AST around, both in memory for the rest of the session and
+-- on disk for future ones.
+--
+-- Cached ASTs are stored serialised as a Lua table constructor. Loading one back with
+-- load() is much cheaper than running the parser and yields a private copy of the AST
+-- which the executor is free to modify without deep copying it first.
+--
+-- Each entry records the modification time and size of every file read by the
+-- preprocessor when it was generated (the template and any files it #included), the
+-- entry is only used if all of those files still have the same modification time and
+-- size. Modification times may only have a resolution of one second, so the size is
+-- there to catch a file being edited again within the same second.
+
+local preprocessor = require 'preprocessor';
+local parser = require 'parser';
+
+local M = {}
+
+-- Bump this whenever the format of the AST produced by the parser changes so that
+-- any stale on-disk caches are ignored.
+local CACHE_VERSION = 1
+
+local function _serialise_number(v)
+	if v ~= v
+	then
+		return "(0/0)"
+	elseif v == math.huge
+	then
+		return "(1/0)"
+	elseif v == -math.huge
+	then
+		return "(-1/0)"
+	end
+	
+	if math.type ~= nil and math.type(v) == "integer"
+	then
+		if math.mininteger ~= nil and v == math.mininteger
+		then
+			-- Can't be written as a literal - the negation is applied after the
+			-- (out of range) positive number is parsed.
+			return "(" .. (v + 1) .. "-1)"
+		end
+		
+		return string.format("%d", v)
+	end
+	
+	local s = string.format("%.17g", v)
+	
+	if math.type ~= nil and not s:match("[%.eEni]")
+	then
+		-- Make sure integral floats don't come back as integers.
+		s = s .. ".0"
+	end
+	
+	return s
+end
+
+local function _serialise_value(v, out, seen)
+	local t = type(v)
+	
+	if t == "table"
+	then
+		if seen[v]
+		then
+			error("Internal error: Cannot serialise recursive table")
+		end
+		
+		seen[v] = true
+		
+		table.insert(out, "{")
+		
+		for key, elem in pairs(v)
+		do
+			table.insert(out, "[")
+			_serialise_value(key, out, seen)
+			table.insert(out, "]=")
+			_serialise_value(elem, out, seen)
+			table.insert(out, ",")
+		end
+		
+		table.insert(out, "}")
+		
+		seen[v] = nil
+	elseif t == "string"
+	then
+		table.insert(out, string.format("%q", v))
+	elseif t == "number"
+	then
+		table.insert(out, _serialise_number(v))
+	elseif t == "boolean"
+	then
+		table.insert(out, tostring(v))
+	else
+		error("Internal error: Cannot serialise value of type '" .. t .. "'")
+	end
+end
+
+--- Serialise a value (usually an AST) into a Lua chunk which evaluates to a copy of it.
+--
+-- Only tables, strings, numbers and booleans are supported. Tables may be shared, but
+-- must not contain cycles.
+M.serialise = function(v)
+	local out = { "return " }
+	_serialise_value(v, out, {})
+	
+	return table.concat(out)
+end
+
+--- Load a value serialised by serialise().
+--
+-- The chunk is evaluated with an empty environment. Returns nil if the chunk can't
+-- be loaded.
+M.deserialise = function(s, chunkname)
+	local chunk = load(s, chunkname, "t", {})
+	if chunk == nil
+	then
+		return nil
+	end
+	
+	local ok, v = pcall(chunk)
+	if not ok
+	then
+		return nil
+	end
+	
+	return v
+end
+
+-- Simple string hash used for naming on-disk cache files. Doesn't need to be
+-- cryptographically strong, entries store the full template path to detect collisions.
+local function _hash_string(s)
+	local h1 = 5381
+	local h2 = 0
+	
+	for i = 1, s:len()
+	do
+		local c = s:byte(i)
+		
+		h1 = (h1 * 33 + c) % 4294967296
+		h2 = (h2 * 65599 + c) % 4294967296
+	end
+	
+	return string.format("%08x%08x", math.floor(h1), math.floor(h2))
+end
+
+-- Returns the size of a file in bytes, nil if it can't be opened.
+local function _file_size(path)
+	local file = io.open(path, "rb")
+	if not file
+	then
+		return nil
+	end
+	
+	local size = file:seek("end")
+	file:close()
+	
+	return size
+end
+
+local TemplateCache = {}
+TemplateCache.__index = TemplateCache
+
+--- Construct a new template cache.
+--
+-- @param mtime_func  Function which returns the modification time of a file, nil if it can't be determined.
+-- @param cache_dir   Directory to store cached templates in, nil to only cache in memory.
+M.new = function(mtime_func, cache_dir)
+	local self = {
+		mtime_func = mtime_func,
+		cache_dir = cache_dir,
+		
+		-- Table of template path => { deps, warnings, ast_text }
+		entries = {},
+		
+		hits = 0,
+		misses = 0,
+	}
+	
+	return setmetatable(self, TemplateCache)
+end
+
+function TemplateCache:_disk_path(template_path)
+	if self.cache_dir == nil
+	then
+		return nil
+	end
+	
+	return self.cache_dir .. "/" .. _hash_string(template_path) .. ".lua"
+end
+
+function TemplateCache:_entry_valid(entry)
+	for _, dep in ipairs(entry.deps)
+	do
+		local mtime = self.mtime_func(dep[1])
+		
+		if mtime == nil or mtime ~= dep[2]
+		then
+			return false
+		end
+		
+		local size = _file_size(dep[1])
+		
+		if size == nil or size ~= dep[3]
+		then
+			return false
+		end
+	end
+	
+	return true
+end
+
+function TemplateCache:_load_from_disk(template_path)
+	local disk_path = self:_disk_path(template_path)
+	if disk_path == nil
+	then
+		return nil
+	end
+	
+	local file = io.open(disk_path, "rb")
+	if not file
+	then
+		return nil
+	end
+	
+	local text = file:read("*a")
+	file:close()
+	
+	local entry = M.deserialise(text, "=" .. disk_path)
+	
+	if type(entry) ~= "table"
+		or entry.version ~= CACHE_VERSION
+		or entry.template ~= template_path
+		or type(entry.deps) ~= "table"
+		or type(entry.warnings) ~= "table"
+		or type(entry.ast_text) ~= "string"
+	then
+		return nil
+	end
+	
+	return entry
+end
+
+function TemplateCache:_save_to_disk(template_path, entry)
+	local disk_path = self:_disk_path(template_path)
+	if disk_path == nil
+	then
+		return
+	end
+	
+	local text = M.serialise({
+		version = CACHE_VERSION,
+		template = template_path,
+		
+		deps = entry.deps,
+		warnings = entry.warnings,
+		ast_text = entry.ast_text,
+	})
+	
+	-- Write to a temporary file and move it into place so a crash (or another
+	-- instance) never leaves a half-written cache file behind.
+	
+	local tmp_path = disk_path .. ".tmp"
+	
+	local file = io.open(tmp_path, "wb")
+	if not file
+	then
+		return
+	end
+	
+	local ok = file:write(text)
+	file:close()
+	
+	if ok
+	then
+		os.remove(disk_path)
+		os.rename(tmp_path, disk_path)
+	else
+		os.remove(tmp_path)
+	end
+end
+
+--- Get the AST of a template, preprocessing and parsing it only if necessary.
+--
+-- @param template_path  Path to the template file.
+-- @param print_func     Function to print any #warning messages.
+--
+-- Returns a freshly loaded copy of the AST, which the caller may modify.
+function TemplateCache:get_ast(template_path, print_func)
+	local entry = self.entries[template_path]
+	
+	if entry ~= nil and not self:_entry_valid(entry)
+	then
+		entry = nil
+	end
+	
+	if entry == nil
+	then
+		entry = self:_load_from_disk(template_path)
+		
+		if entry ~= nil and not self:_entry_valid(entry)
+		then
+			entry = nil
+		end
+	end
+	
+	if entry ~= nil
+	then
+		local ast = M.deserialise(entry.ast_text, "=" .. template_path)
+		
+		if ast ~= nil
+		then
+			self.hits = self.hits + 1
+			self.entries[template_path] = entry
+			
+			-- Replay any warnings so running a cached template looks the same.
+			if print_func ~= nil
+			then
+				for _, w in ipairs(entry.warnings)
+				do
+					print_func(w)
+				end
+			end
+			
+			return ast
+		end
+	end
+	
+	self.misses = self.misses + 1
+	
+	local warnings = {}
+	
+	-- The modification time and size of each file are taken just before the
+	-- preprocessor reads it, so a file being changed after we read it invalidates the
+	-- entry rather than leaving a stale one around.
+	
+	local sizes = {}
+	
+	local text, files = preprocessor.preprocess_file(template_path, function(s)
+		table.insert(warnings, s)
+		
+		if print_func ~= nil
+		then
+			print_func(s)
+		end
+	end, function(path)
+		sizes[path] = _file_size(path)
+		return self.mtime_func(path)
+	end)
+	
+	local deps = {}
+	local deps_ok = true
+	
+	for _, file in ipairs(files)
+	do
+		local size = sizes[file[1]]
+		
+		if file[2] == nil or size == nil
+		then
+			deps_ok = false
+		end
+		
+		table.insert(deps, { file[1], file[2], size })
+	end
+	
+	local ast = parser.parse_text(text)
+	
+	-- Failing to serialise or save the AST only means it won't be cached.
+	local serialised_ok, ast_text = false, nil
+	if deps_ok
+	then
+		serialised_ok, ast_text = pcall(M.serialise, ast)
+	end
+	
+	if serialised_ok
+	then
+		entry = {
+			deps = deps,
+			warnings = warnings,
+			ast_text = ast_text,
+		}
+		
+		self.entries[template_path] = entry
+		pcall(function() self:_save_to_disk(template_path, entry) end)
+	end
+	
+	return ast
+end
+
+--- Discard any cached entries held in memory.
+function TemplateCache:clear()
+	self.entries = {}
+end
+
+return M
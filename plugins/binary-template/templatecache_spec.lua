@@ -0,0 +1,218 @@
+-- Binary Template plugin for REHex
+-- Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+--
+-- This program is free software; you can redistribute it and/or modify it
+-- under the terms of the GNU General Public License version 2 as published by
+-- the Free Software Foundation.
+--
+-- This program is distributed in the hope that it will be useful, but WITHOUT
+-- ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+-- FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+-- more details.
+--
+-- You should have received a copy of the GNU General Public License along with
+-- this program; if not, write to the Free Software Foundation, Inc., 51
+-- Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+local parser = require 'parser'
+local preprocessor = require 'preprocessor'
+local templatecache = require 'templatecache'
+
+local MAIN_TEMPLATE = "templatecache-tests/main.bt"
+local INCLUDE_FILE  = "templatecache-tests/templatecache-include.h"
+
+local function fake_mtimes()
+	local mtimes = {
+		[MAIN_TEMPLATE] = 1000,
+		[INCLUDE_FILE]  = 2000,
+	}
+	
+	return mtimes, function(path) return mtimes[path] end
+end
+
+local function cleanup_cache_dir()
+	local cache = templatecache.new(function() return nil end, "templatecache-tests")
+	os.remove(cache:_disk_path(MAIN_TEMPLATE))
+	os.remove(cache:_disk_path(MAIN_TEMPLATE) .. ".tmp")
+end
+
+describe("templatecache", function()
+	after_each(cleanup_cache_dir)
+	
+	it("serialises and deserialises tables", function()
+		local v = {
+			"file.bt", 10, "variable", nil, "name", nil, true, false,
+			{ 1.5, 2.0, -3, 0x7FFFFFFF, "line 1\nline 2\r\n\0\"quoted\"" },
+			["key with spaces"] = { nested = { deeper = "yes" } },
+		}
+		
+		local got = templatecache.deserialise(templatecache.serialise(v))
+		
+		assert.are.same(v, got)
+		assert.are_not.equal(v, got)
+		
+		if math.type ~= nil
+		then
+			assert.are.equal("float",   math.type(got[9][2]))
+			assert.are.equal("integer", math.type(got[9][3]))
+		end
+	end)
+	
+	it("refuses to serialise recursive tables", function()
+		local v = {}
+		v[1] = v
+		
+		assert.has_error(function() templatecache.serialise(v) end, "Internal error: Cannot serialise recursive table")
+	end)
+	
+	it("returns the same AST as parsing the template directly", function()
+		local mtimes, mtime_func = fake_mtimes()
+		local cache = templatecache.new(mtime_func, nil)
+		
+		local expect = parser.parse_text(preprocessor.preprocess_file(MAIN_TEMPLATE, function() end))
+		
+		assert.are.same(expect, cache:get_ast(MAIN_TEMPLATE))
+		assert.are.same(expect, cache:get_ast(MAIN_TEMPLATE))
+		
+		assert.are.equal(1, cache.misses)
+		assert.are.equal(1, cache.hits)
+	end)
+	
+	it("returns a new copy of the AST each time", function()
+		local mtimes, mtime_func = fake_mtimes()
+		local cache = templatecache.new(mtime_func, nil)
+		
+		local ast1 = cache:get_ast(MAIN_TEMPLATE)
+		local ast2 = cache:get_ast(MAIN_TEMPLATE)
+		
+		assert.are_not.equal(ast1, ast2)
+		
+		ast2[1][3] = "modified"
+		assert.are.same(ast1, cache:get_ast(MAIN_TEMPLATE))
+	end)
+	
+	it("replays warnings when returning a cached AST", function()
+		local mtimes, mtime_func = fake_mtimes()
+		local cache = templatecache.new(mtime_func, nil)
+		
+		local warnings = {}
+		local print_func = function(s) table.insert(warnings, s) end
+		
+		cache:get_ast(MAIN_TEMPLATE, print_func)
+		cache:get_ast(MAIN_TEMPLATE, print_func)
+		
+		assert.are.same({
+			"#warning included at " .. INCLUDE_FILE .. ":1",
+			"#warning included at " .. INCLUDE_FILE .. ":1",
+		}, warnings)
+		
+		assert.are.equal(1, cache.hits)
+	end)
+	
+	it("reparses the template when an included file is modified", function()
+		local mtimes, mtime_func = fake_mtimes()
+		local cache = templatecache.new(mtime_func, nil)
+		
+		cache:get_ast(MAIN_TEMPLATE)
+		
+		mtimes[INCLUDE_FILE] = 2001
+		cache:get_ast(MAIN_TEMPLATE)
+		
+		assert.are.equal(2, cache.misses)
+		assert.are.equal(0, cache.hits)
+		
+		cache:get_ast(MAIN_TEMPLATE)
+		
+		assert.are.equal(2, cache.misses)
+		assert.are.equal(1, cache.hits)
+	end)
+	
+	it("reparses the template when a file changes size without changing modification time", function()
+		local path = "templatecache-tests/resized.bt"
+		
+		local write_template = function(text)
+			local file = assert(io.open(path, "wb"))
+			file:write(text)
+			file:close()
+		end
+		
+		finally(function()
+			local cache = templatecache.new(function() return nil end, "templatecache-tests")
+			os.remove(cache:_disk_path(path))
+			os.remove(path)
+		end)
+		
+		local cache = templatecache.new(function() return 1000 end, "templatecache-tests")
+		
+		write_template("int a;\n")
+		local ast1 = cache:get_ast(path)
+		
+		write_template("int a;\nint b;\n")
+		local ast2 = cache:get_ast(path)
+		
+		assert.are.same(parser.parse_text(preprocessor.preprocess_file(path, function() end)), ast2)
+		assert.are_not.same(ast1, ast2)
+		
+		assert.are.equal(2, cache.misses)
+		assert.are.equal(0, cache.hits)
+	end)
+	
+	it("doesn't cache the AST if a modification time can't be determined", function()
+		local mtimes, mtime_func = fake_mtimes()
+		local cache = templatecache.new(mtime_func, nil)
+		
+		mtimes[INCLUDE_FILE] = nil
+		
+		cache:get_ast(MAIN_TEMPLATE)
+		cache:get_ast(MAIN_TEMPLATE)
+		
+		assert.are.equal(2, cache.misses)
+		assert.are.equal(0, cache.hits)
+	end)
+	
+	it("returns the AST without caching it if it can't be serialised", function()
+		local mtimes, mtime_func = fake_mtimes()
+		local cache = templatecache.new(mtime_func, nil)
+		
+		local real_serialise = templatecache.serialise
+		templatecache.serialise = function() error("Serialisation failed") end
+		
+		finally(function() templatecache.serialise = real_serialise end)
+		
+		local expect = parser.parse_text(preprocessor.preprocess_file(MAIN_TEMPLATE, function() end))
+		
+		assert.are.same(expect, cache:get_ast(MAIN_TEMPLATE))
+		assert.are.same(expect, cache:get_ast(MAIN_TEMPLATE))
+		
+		assert.are.equal(2, cache.misses)
+		assert.are.equal(0, cache.hits)
+	end)
+	
+	it("loads cached ASTs from disk", function()
+		local mtimes, mtime_func = fake_mtimes()
+		
+		local cache1 = templatecache.new(mtime_func, "templatecache-tests")
+		local expect = cache1:get_ast(MAIN_TEMPLATE)
+		
+		local cache2 = templatecache.new(mtime_func, "templatecache-tests")
+		assert.are.same(expect, cache2:get_ast(MAIN_TEMPLATE))
+		
+		assert.are.equal(0, cache2.misses)
+		assert.are.equal(1, cache2.hits)
+	end)
+	
+	it("ignores stale cached ASTs on disk", function()
+		local mtimes, mtime_func = fake_mtimes()
+		
+		local cache1 = templatecache.new(mtime_func, "templatecache-tests")
+		cache1:get_ast(MAIN_TEMPLATE)
+		
+		mtimes[MAIN_TEMPLATE] = 1001
+		
+		local cache2 = templatecache.new(mtime_func, "templatecache-tests")
+		cache2:get_ast(MAIN_TEMPLATE)
+		
+		assert.are.equal(1, cache2.misses)
+		assert.are.equal(0, cache2.hits)
+	end)
+end)
@@ -200,9 +200,7 @@ REHex::BitEditor::BitEditor(wxWindow *parent, SharedDocumentPointer &document, D
 	
 	this->document.auto_cleanup_bind(CURSOR_UPDATE, &REHex::BitEditor::OnCursorUpdate,    this);
 	
-	this->document.auto_cleanup_bind(DATA_ERASE,     &REHex::BitEditor::OnDataModified, this);
-	this->document.auto_cleanup_bind(DATA_INSERT,    &REHex::BitEditor::OnDataModified, this);
-	this->document.auto_cleanup_bind(DATA_OVERWRITE, &REHex::BitEditor::OnDataModified, this);
+	this->document.auto_cleanup_bind(DATA_CHANGES, &REHex::BitEditor::OnDataModified, this);
 	
 	update();
 }
@@ -482,7 +480,7 @@ void REHex::BitEditor::OnCursorUpdate(CursorUpdateEvent &event)
 	event.Skip();
 }
 
-void REHex::BitEditor::OnDataModified(OffsetLengthEvent &event)
+void REHex::BitEditor::OnDataModified(DataChangesEvent &event)
 {
 	update();
 	
@@ -79,7 +79,7 @@ namespace REHex {
 			void disable_edit_controls();
 			
 			void OnCursorUpdate(CursorUpdateEvent &event);
-			void OnDataModified(OffsetLengthEvent &event);
+			void OnDataModified(DataChangesEvent &event);
 			void OnEndian(wxCommandEvent &event);
 			void OnNumBytes(wxSpinEvent &event);
 			void OnValueChange(wxCommandEvent &event);
@@ -17,6 +17,8 @@
 
 #include "platform.hpp"
 
+#include <algorithm>
+#include <assert.h>
 #include <functional>
 #include <wx/checkbox.h>
 #include <wx/choice.h>
@@ -29,6 +31,7 @@
 #include <wx/statbmp.h>
 #include <wx/stattext.h>
 
+#include "App.hpp"
 #include "BitmapTool.hpp"
 #include "NumericTextCtrl.hpp"
 #include "util.hpp"
@@ -63,6 +66,7 @@ enum {
 	ID_ZOOM_IN,
 	ID_ZOOM_OUT,
 	ID_UPDATE_TIMER,
+	ID_MIP_TIMER,
 };
 
 /* The minimum interval between updates when rendering the preview bitmap.
@@ -71,6 +75,9 @@ enum {
 */
 static const int UPDATE_TIMER_MS = 250;
 
+/* Interval between checks for downscaled images being built in the background. */
+static const int MIP_TIMER_MS = 50;
+
 BEGIN_EVENT_TABLE(REHex::BitmapTool, wxPanel)
 	EVT_CHOICE(ID_COLOUR_DEPTH,  REHex::BitmapTool::OnDepth)
 	EVT_CHOICE(ID_COLOUR_FORMAT, REHex::BitmapTool::OnFormat)
@@ -94,6 +101,7 @@ BEGIN_EVENT_TABLE(REHex::BitmapTool, wxPanel)
 	EVT_SIZE(REHex::BitmapTool::OnSize)
 	EVT_IDLE(REHex::BitmapTool::OnIdle)
 	EVT_TIMER(ID_UPDATE_TIMER, REHex::BitmapTool::OnUpdateTimer)
+	EVT_TIMER(ID_MIP_TIMER, REHex::BitmapTool::OnMipTimer)
 END_EVENT_TABLE()
 
 enum {
@@ -147,7 +155,9 @@ REHex::BitmapTool::BitmapTool(wxWindow *parent, SharedDocumentPointer &document)
 	force_bitmap_width(-1),
 	force_bitmap_height(-1),
 	bitmap_update_line(-1),
-	update_timer(this, ID_UPDATE_TIMER)
+	update_timer(this, ID_UPDATE_TIMER),
+	mip_wanted_level(0),
+	mip_timer(this, ID_MIP_TIMER)
 {
 	wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
 	
@@ -272,12 +282,18 @@ REHex::BitmapTool::BitmapTool(wxWindow *parent, SharedDocumentPointer &document)
 	SetSizerAndFit(sizer);
 	toolbar->Realize();
 	
-	this->document.auto_cleanup_bind(CURSOR_UPDATE, &REHex::BitmapTool::OnCursorUpdate,    this);
+	this->document.auto_cleanup_bind(CURSOR_UPDATE,  &REHex::BitmapTool::OnCursorUpdate, this);
+	this->document.auto_cleanup_bind(DATA_ERASE,     &REHex::BitmapTool::OnDataModified, this);
+	this->document.auto_cleanup_bind(DATA_INSERT,    &REHex::BitmapTool::OnDataModified, this);
+	this->document.auto_cleanup_bind(DATA_OVERWRITE, &REHex::BitmapTool::OnDataModified, this);
 	
 	update();
 }
 
-REHex::BitmapTool::~BitmapTool() {}
+REHex::BitmapTool::~BitmapTool()
+{
+	mip_cancel();
+}
 
 std::string REHex::BitmapTool::name() const
 {
@@ -464,15 +480,42 @@ void REHex::BitmapTool::update()
 	delete bitmap;
 	bitmap = new_bitmap;
 	
-	render_region(0, bitmap_lines_per_idle, image_offset, image_width, image_height);
+	ImageFormat format = get_image_format();
+	if(!format.same_image(mip_format))
+	{
+		/* Any downscaled copies we have are of a different image. */
+		mip_reset();
+		mip_format = format;
+	}
+	
+	mip_wanted_level = mip_level_for(image_width, image_height, bitmap_width, bitmap_height);
+	
+	auto mip_level = mip_levels.find(mip_wanted_level);
 	
-	if(bitmap_lines_per_idle < bitmap_height)
+	if(mip_wanted_level > 0 && mip_level != mip_levels.end())
 	{
-		bitmap_update_line = bitmap_lines_per_idle;
-		update_timer.Start(UPDATE_TIMER_MS, wxTIMER_ONE_SHOT);
+		render_mip(*(mip_level->second));
+		update_timer.Stop();
 	}
 	else{
-		update_timer.Stop();
+		if(mip_wanted_level > 0)
+		{
+			/* Build a downscaled copy of the image in the background and draw the
+			 * preview directly from the image data until it is ready.
+			*/
+			mip_start(mip_wanted_level);
+		}
+		
+		render_region(0, bitmap_lines_per_idle, image_offset, image_width, image_height);
+		
+		if(bitmap_lines_per_idle < bitmap_height)
+		{
+			bitmap_update_line = bitmap_lines_per_idle;
+			update_timer.Start(UPDATE_TIMER_MS, wxTIMER_ONE_SHOT);
+		}
+		else{
+			update_timer.Stop();
+		}
 	}
 	
 	bitmap_scrollwin->SetVirtualSize(s_bitmap->GetSize());
@@ -766,6 +809,317 @@ void REHex::BitmapTool::update_pixel_fmt()
 	}
 }
 
+REHex::BitmapTool::ImageFormat::ImageFormat():
+	offset(BitOffset::ZERO),
+	width(0),
+	height(0),
+	row_length(-1),
+	pixel_fmt_idx(-1),
+	colour_fmt_idx(-1),
+	pixel_fmt_div(1),
+	pixel_fmt_multi(1),
+	pixel_fmt_bits(255) {}
+
+bool REHex::BitmapTool::ImageFormat::same_image(const ImageFormat &other) const
+{
+	return offset == other.offset
+		&& width == other.width
+		&& height == other.height
+		&& row_length == other.row_length
+		&& pixel_fmt_idx == other.pixel_fmt_idx
+		&& colour_fmt_idx == other.colour_fmt_idx;
+}
+
+off_t REHex::BitmapTool::ImageFormat::line_length() const
+{
+	return row_length > 0
+		? row_length
+		: ((off_t)(width) * pixel_fmt_multi) / pixel_fmt_div;
+}
+
+REHex::BitOffset REHex::BitmapTool::ImageFormat::line_offset(int y) const
+{
+	return row_length > 0
+		? offset + BitOffset(((off_t)(y) * row_length), 0)
+		: offset + BitOffset((((off_t)(width) * y * pixel_fmt_multi) / pixel_fmt_div), 0);
+}
+
+bool REHex::BitmapTool::ImageFormat::decode_pixel(const unsigned char *line_ptr, const unsigned char *data_end, int x, int y, wxColour *colour) const
+{
+	const unsigned char *input_ptr = line_ptr;
+	int mask = pixel_fmt_bits, shift = 8 - (8 / pixel_fmt_div);
+	
+	if(pixel_fmt_div > 1)
+	{
+		/* Advance to the correct starting bit for <8bpp colour depths. */
+		
+		assert(pixel_fmt_multi == 1);
+		
+		int line_pixel_offset = row_length < 0
+			? ((width * y) % pixel_fmt_div) + x
+			: x;
+		
+		input_ptr += line_pixel_offset / pixel_fmt_div;
+		
+		int sub_byte_offset = line_pixel_offset % pixel_fmt_div;
+		for(int i = 0; i < sub_byte_offset; ++i)
+		{
+			mask >>= (8 / pixel_fmt_div);
+			shift -= 8 / pixel_fmt_div;
+			
+			assert(shift >= 0);
+			
+			assert(mask < 255);
+			assert(mask > 0);
+		}
+	}
+	else{
+		input_ptr += x * pixel_fmt_multi;
+	}
+	
+	if((input_ptr + pixel_fmt_multi) > data_end)
+	{
+		return false;
+	}
+	
+	uint32_t rgb = 0;
+	
+	for(int i = 0; i < pixel_fmt_multi; ++i)
+	{
+		assert(mask <= 255);
+		
+		rgb |= ((*input_ptr & mask) >> shift) << (8 * (pixel_fmt_multi - i - 1));
+		
+		if(pixel_fmt_div > 1)
+		{
+			mask >>= (8 / pixel_fmt_div);
+			shift -= 8 / pixel_fmt_div;
+			
+			if(shift < 0)
+			{
+				mask  = pixel_fmt_bits;
+				shift = 8 - (8 / pixel_fmt_div);
+				
+				++input_ptr;
+			}
+		}
+		else{
+			++input_ptr;
+		}
+	}
+	
+	*colour = colour_fmt_conv(rgb);
+	return true;
+}
+
+REHex::BitmapTool::MipLevel::MipLevel(int width, int height):
+	width(width),
+	height(height),
+	pixels(((size_t)(width) * (size_t)(height) * 4), 0) {}
+
+/**
+ * @brief State of a downscaled image being built on the ThreadPool.
+ *
+ * Each row of the largest (base) level is box filtered from the image data by whichever worker
+ * picks it up, then the smaller levels are each built from the one before by the worker which
+ * finishes the last row.
+*/
+struct REHex::BitmapTool::MipBuild
+{
+	Document *const document;
+	const ImageFormat format;
+	const int base_level;
+	
+	std::shared_ptr<MipLevel> base;
+	std::vector< std::shared_ptr<MipLevel> > smaller;
+	
+	std::atomic<int> next_row;
+	std::atomic<int> rows_done;
+	std::atomic<bool> complete;
+	
+	MipBuild(Document *document, const ImageFormat &format, int base_level);
+	
+	bool process();
+	void build_row(int row);
+	void build_smaller_levels();
+};
+
+REHex::BitmapTool::MipBuild::MipBuild(Document *document, const ImageFormat &format, int base_level):
+	document(document),
+	format(format),
+	base_level(base_level),
+	next_row(0),
+	rows_done(0),
+	complete(false)
+{
+	int scale = 1 << base_level;
+	base.reset(new MipLevel(((format.width + scale - 1) / scale), ((format.height + scale - 1) / scale)));
+}
+
+bool REHex::BitmapTool::MipBuild::process()
+{
+	int row = next_row.fetch_add(1);
+	if(row >= base->height)
+	{
+		return true;
+	}
+	
+	build_row(row);
+	
+	if((rows_done.fetch_add(1) + 1) == base->height)
+	{
+		build_smaller_levels();
+		complete = true;
+	}
+	
+	return false;
+}
+
+void REHex::BitmapTool::MipBuild::build_row(int row)
+{
+	int scale = 1 << base_level;
+	
+	int y_begin = row * scale;
+	int y_end = std::min((y_begin + scale), format.height);
+	
+	/* Read all the lines going into this row, plus a byte for any bits of a packed <8bpp pixel
+	 * which spill into the next line.
+	*/
+	
+	BitOffset data_begin = format.line_offset(y_begin);
+	BitOffset data_end = format.line_offset(y_end - 1) + BitOffset((format.line_length() + 1), 0);
+	
+	std::vector<unsigned char> data;
+	
+	try {
+		data = document->read_data(data_begin, (data_end - data_begin).byte());
+	}
+	catch(const std::exception &e)
+	{
+		/* Leave any unreadable pixels transparent like the ones past the end of the file. */
+		wxGetApp().printf_error("Data read error in BitmapTool: %s\n", e.what());
+	}
+	
+	const unsigned char *data_end_ptr = data.data() + data.size();
+	
+	std::vector<uint64_t> sums(((size_t)(base->width) * 4), 0);
+	std::vector<uint32_t> counts(base->width, 0);
+	
+	for(int y = y_begin; y < y_end; ++y)
+	{
+		BitOffset line_rel = format.line_offset(y) - data_begin;
+		assert(line_rel.byte_aligned());
+		
+		if((size_t)(line_rel.byte()) >= data.size())
+		{
+			/* Past the end of the file. */
+			
+			for(int x = 0; x < format.width; ++x)
+			{
+				++(counts[x >> base_level]);
+			}
+			
+			continue;
+		}
+		
+		const unsigned char *line_ptr = data.data() + line_rel.byte();
+		
+		for(int x = 0; x < format.width; ++x)
+		{
+			int level_x = x >> base_level;
+			++(counts[level_x]);
+			
+			wxColour colour;
+			if(format.decode_pixel(line_ptr, data_end_ptr, x, y, &colour))
+			{
+				unsigned int alpha = colour.Alpha();
+				
+				sums[(level_x * 4)]     += (colour.Red()   * alpha) / 255;
+				sums[(level_x * 4) + 1] += (colour.Green() * alpha) / 255;
+				sums[(level_x * 4) + 2] += (colour.Blue()  * alpha) / 255;
+				sums[(level_x * 4) + 3] += alpha;
+			}
+		}
+	}
+	
+	unsigned char *out = base->pixels.data() + ((size_t)(row) * (size_t)(base->width) * 4);
+	
+	for(int level_x = 0; level_x < base->width; ++level_x)
+	{
+		uint32_t count = counts[level_x];
+		assert(count > 0);
+		
+		for(int i = 0; i < 4; ++i)
+		{
+			out[(level_x * 4) + i] = (sums[(level_x * 4) + i] + (count / 2)) / count;
+		}
+	}
+}
+
+void REHex::BitmapTool::MipBuild::build_smaller_levels()
+{
+	const MipLevel *src = base.get();
+	
+	while(src->width > 1 || src->height > 1)
+	{
+		std::shared_ptr<MipLevel> dst(new MipLevel(((src->width + 1) / 2), ((src->height + 1) / 2)));
+		
+		for(int y = 0; y < dst->height; ++y)
+		{
+			for(int x = 0; x < dst->width; ++x)
+			{
+				unsigned int sums[4] = { 0, 0, 0, 0 };
+				unsigned int count = 0;
+				
+				for(int src_y = (y * 2); src_y < ((y * 2) + 2) && src_y < src->height; ++src_y)
+				{
+					for(int src_x = (x * 2); src_x < ((x * 2) + 2) && src_x < src->width; ++src_x)
+					{
+						const unsigned char *pixel = src->pixels.data() + (((size_t)(src_y) * (size_t)(src->width) + src_x) * 4);
+						
+						for(int i = 0; i < 4; ++i)
+						{
+							sums[i] += pixel[i];
+						}
+						
+						++count;
+					}
+				}
+				
+				unsigned char *pixel = dst->pixels.data() + (((size_t)(y) * (size_t)(dst->width) + x) * 4);
+				
+				for(int i = 0; i < 4; ++i)
+				{
+					pixel[i] = (sums[i] + (count / 2)) / count;
+				}
+			}
+		}
+		
+		smaller.push_back(dst);
+		src = dst.get();
+	}
+}
+
+REHex::BitmapTool::ImageFormat REHex::BitmapTool::get_image_format() const
+{
+	ImageFormat format;
+	
+	format.offset = image_offset;
+	format.width = image_width;
+	format.height = image_height;
+	format.row_length = row_length;
+	
+	format.pixel_fmt_idx = pixel_fmt_choice->GetCurrentSelection();
+	format.colour_fmt_idx = colour_fmt_choice->GetCurrentSelection();
+	
+	format.pixel_fmt_div = pixel_fmt_div;
+	format.pixel_fmt_multi = pixel_fmt_multi;
+	format.pixel_fmt_bits = pixel_fmt_bits;
+	format.colour_fmt_conv = colour_fmt_conv;
+	
+	return format;
+}
+
 void REHex::BitmapTool::render_region(int region_y, int region_h, BitOffset offset, int width, int height)
 {
 	int output_width = bitmap->GetWidth();
@@ -774,6 +1128,11 @@ void REHex::BitmapTool::render_region(int region_y, int region_h, BitOffset offs
 	bool flip_x = toolbar->GetToolState(ID_FLIP_X);
 	bool flip_y = toolbar->GetToolState(ID_FLIP_Y);
 	
+	ImageFormat format = get_image_format();
+	format.offset = offset;
+	format.width = width;
+	format.height = height;
+	
 	/* Read in the image data, convert the source pixel format and write it to the wxBitmap. */
 	
 	wxNativePixelData bmp_data(*bitmap);
@@ -802,13 +1161,8 @@ void REHex::BitmapTool::render_region(int region_y, int region_h, BitOffset offs
 			input_y = ((height - 1) - input_y);
 		}
 		
-		off_t line_len = row_length > 0
-			? row_length
-			: (width * pixel_fmt_multi) / pixel_fmt_div;
-		
-		BitOffset line_off = row_length > 0
-			? offset + BitOffset((input_y * line_len), 0)
-			: offset + BitOffset(((width * input_y * pixel_fmt_multi) / pixel_fmt_div), 0);
+		off_t line_len = format.line_length();
+		BitOffset line_off = format.line_offset(input_y);
 		
 		if(line_off < data_begin || (line_off + BitOffset(line_len, 0)) > data_end)
 		{
@@ -853,39 +1207,6 @@ void REHex::BitmapTool::render_region(int region_y, int region_h, BitOffset offs
 				input_x = ((width - 1) - input_x);
 			}
 			
-			const unsigned char *input_ptr = line_ptr;
-			int mask = pixel_fmt_bits, shift = 8 - (8 / pixel_fmt_div);
-			
-			if(pixel_fmt_div > 1)
-			{
-				/* Advance to the correct starting bit for <8bpp colour depths. */
-				
-				assert(pixel_fmt_multi == 1);
-				
-				bool row_packed = row_packed_cb->GetValue();
-				
-				int line_pixel_offset = row_packed
-					? ((width * input_y) % pixel_fmt_div) + input_x
-					: input_x;
-				
-				input_ptr += line_pixel_offset / pixel_fmt_div;
-				
-				int sub_byte_offset = line_pixel_offset % pixel_fmt_div;
-				for(int i = 0; i < sub_byte_offset; ++i)
-				{
-					mask >>= (8 / pixel_fmt_div);
-					shift -= 8 / pixel_fmt_div;
-					
-					assert(shift >= 0);
-					
-					assert(mask < 255);
-					assert(mask > 0);
-				}
-			}
-			else{
-				input_ptr += input_x * pixel_fmt_multi;
-			}
-			
 			/* Initialise output to chequerboard pattern. */
 			
 			bool x_even = (output_x % 20) >= 10;
@@ -897,7 +1218,9 @@ void REHex::BitmapTool::render_region(int region_y, int region_h, BitOffset offs
 			output_col_ptr.Green() = chequerboard_colour;
 			output_col_ptr.Blue()  = chequerboard_colour;
 			
-			if((input_ptr + pixel_fmt_multi) > (data.data() + data.size()))
+			wxColour colour;
+			
+			if(!format.decode_pixel(line_ptr, (data.data() + data.size()), input_x, input_y, &colour))
 			{
 				/* Ran out of image data in input file. Carry on looping to fill
 				 * the remaining bitmap with the chequerboard pattern.
@@ -906,36 +1229,6 @@ void REHex::BitmapTool::render_region(int region_y, int region_h, BitOffset offs
 				continue;
 			}
 			
-			uint32_t rgb = 0;
-			
-			for(int i = 0; i < pixel_fmt_multi; ++i)
-			{
-				assert(mask <= 255);
-				
-				assert(input_ptr >= data.data());
-				
-				rgb |= ((*input_ptr & mask) >> shift) << (8 * (pixel_fmt_multi - i - 1));
-				
-				if(pixel_fmt_div > 1)
-				{
-					mask >>= (8 / pixel_fmt_div);
-					shift -= 8 / pixel_fmt_div;
-					
-					if(shift < 0)
-					{
-						mask  = pixel_fmt_bits;
-						shift = 8 - (8 / pixel_fmt_div);
-						
-						++input_ptr;
-					}
-				}
-				else{
-					++input_ptr;
-				}
-			}
-			
-			wxColour colour = colour_fmt_conv(rgb);
-			
 			if(colour.Alpha() != wxALPHA_OPAQUE)
 			{
 				/* Blend colours with an alpha channel into the chequerboard. */
@@ -959,6 +1252,115 @@ void REHex::BitmapTool::render_region(int region_y, int region_h, BitOffset offs
 	}
 }
 
+int REHex::BitmapTool::mip_level_for(int image_width, int image_height, int output_width, int output_height)
+{
+	/* Find the smallest level which is still at least as big as the output, so each output
+	 * pixel is drawn from no more than four (filtered) pixels.
+	*/
+	
+	int level = 0;
+	
+	while(level < 30
+		&& (((image_width  - 1) >> (level + 1)) + 1) >= output_width
+		&& (((image_height - 1) >> (level + 1)) + 1) >= output_height)
+	{
+		++level;
+	}
+	
+	return level;
+}
+
+void REHex::BitmapTool::mip_start(int level)
+{
+	if(mip_build && mip_build->base_level <= level)
+	{
+		/* Already building this level (or a larger one it will be built from). */
+		return;
+	}
+	
+	mip_cancel();
+	
+	std::shared_ptr<MipBuild> build = std::make_shared<MipBuild>(document, mip_format, level);
+	
+	mip_build = build;
+	mip_task.reset(new ThreadPool::TaskHandle(wxGetApp().thread_pool->queue_task([build]() { return build->process(); }, -1)));
+	
+	mip_timer.Start(MIP_TIMER_MS, wxTIMER_CONTINUOUS);
+}
+
+void REHex::BitmapTool::mip_cancel()
+{
+	if(mip_task)
+	{
+		mip_task->finish();
+		mip_task->join();
+		mip_task.reset();
+	}
+	
+	mip_build.reset();
+	mip_timer.Stop();
+}
+
+void REHex::BitmapTool::mip_reset()
+{
+	mip_cancel();
+	mip_levels.clear();
+}
+
+void REHex::BitmapTool::render_mip(const MipLevel &level)
+{
+	int output_width = bitmap->GetWidth();
+	int output_height = bitmap->GetHeight();
+	
+	bool flip_x = toolbar->GetToolState(ID_FLIP_X);
+	bool flip_y = toolbar->GetToolState(ID_FLIP_Y);
+	
+	wxNativePixelData bmp_data(*bitmap);
+	assert(bmp_data);
+	
+	wxNativePixelData::Iterator output_ptr(bmp_data);
+	
+	for(int output_y = 0; output_y < output_height; ++output_y)
+	{
+		int level_y = ((int64_t)(output_y) * (int64_t)(level.height)) / output_height;
+		
+		if(flip_y)
+		{
+			level_y = ((level.height - 1) - level_y);
+		}
+		
+		const unsigned char *level_row = level.pixels.data() + ((size_t)(level_y) * (size_t)(level.width) * 4);
+		
+		wxNativePixelData::Iterator output_col_ptr = output_ptr;
+		
+		for(int output_x = 0; output_x < output_width; ++output_x, ++output_col_ptr)
+		{
+			int level_x = ((int64_t)(output_x) * (int64_t)(level.width)) / output_width;
+			
+			if(flip_x)
+			{
+				level_x = ((level.width - 1) - level_x);
+			}
+			
+			const unsigned char *pixel = level_row + (level_x * 4);
+			
+			/* Blend the (premultiplied) pixel into the chequerboard pattern. */
+			
+			bool x_even = (output_x % 20) >= 10;
+			bool y_even = (output_y % 20) >= 10;
+			
+			int chequerboard_colour = (x_even ^ y_even) ? 0x66 : 0x99;
+			int chequerboard_part = (chequerboard_colour * (255 - pixel[3])) / 255;
+			
+			output_col_ptr.Red()   = std::min((pixel[0] + chequerboard_part), 255);
+			output_col_ptr.Green() = std::min((pixel[1] + chequerboard_part), 255);
+			output_col_ptr.Blue()  = std::min((pixel[2] + chequerboard_part), 255);
+		}
+		
+		output_ptr.OffsetY(bmp_data, 1);
+	}
+}
+
 void REHex::BitmapTool::OnCursorUpdate(CursorUpdateEvent &event)
 {
 	if(offset_follow_cb->GetValue())
@@ -1147,6 +1549,58 @@ void REHex::BitmapTool::OnUpdateTimer(wxTimerEvent &event)
 	}
 }
 
+void REHex::BitmapTool::OnMipTimer(wxTimerEvent &event)
+{
+	if(!mip_build)
+	{
+		mip_timer.Stop();
+		return;
+	}
+	
+	if(!mip_build->complete)
+	{
+		return;
+	}
+	
+	mip_task->join();
+	mip_task.reset();
+	
+	int level = mip_build->base_level;
+	
+	mip_levels[level] = mip_build->base;
+	
+	for(auto i = mip_build->smaller.begin(); i != mip_build->smaller.end(); ++i)
+	{
+		mip_levels[++level] = *i;
+	}
+	
+	mip_build.reset();
+	mip_timer.Stop();
+	
+	auto mip_level = mip_levels.find(mip_wanted_level);
+	
+	if(mip_wanted_level > 0 && mip_level != mip_levels.end())
+	{
+		/* Replace the preview drawn directly from the image data. */
+		
+		update_timer.Stop();
+		bitmap_update_line = -1;
+		
+		render_mip(*(mip_level->second));
+		s_bitmap->Refresh();
+	}
+}
+
+void REHex::BitmapTool::OnDataModified(OffsetLengthEvent &event)
+{
+	/* Any downscaled copies of the image may be out of date now. */
+	mip_reset();
+	mip_wanted_level = 0;
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
 void REHex::BitmapTool::OnBitmapRightDown(wxMouseEvent &event)
 {
 	wxMenu menu;
@@ -1298,7 +1752,7 @@ void REHex::BitmapTool::force_bitmap_size(int width, int height)
 
 bool REHex::BitmapTool::is_processing()
 {
-	return bitmap_update_line >= 0;
+	return bitmap_update_line >= 0 || mip_build;
 }
 
 wxBitmap REHex::BitmapTool::get_bitmap()
@@ -18,6 +18,10 @@
 #ifndef REHEX_BITMAPTOOL_HPP
 #define REHEX_BITMAPTOOL_HPP
 
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
 #include <wx/checkbox.h>
 #include <wx/choice.h>
 //#include <wx/statbmp.h>
@@ -30,6 +34,7 @@
 #include "document.hpp"
 #include "NumericTextCtrl.hpp"
 #include "SharedDocumentPointer.hpp"
+#include "ThreadPool.hpp"
 #include "ToolPanel.hpp"
 
 namespace REHex {
@@ -81,6 +86,68 @@ namespace REHex {
 			wxBitmap get_bitmap();
 			
 		private:
+			/**
+			 * @brief Everything needed to find and decode the pixels of an image.
+			*/
+			struct ImageFormat
+			{
+				BitOffset offset;
+				int width, height;
+				int row_length;         /* Length of each row in bytes, -1 if rows are packed. */
+				
+				int pixel_fmt_idx;
+				int colour_fmt_idx;
+				
+				int pixel_fmt_div;      /* Number of (possibly partial) pixels per byte */
+				int pixel_fmt_multi;    /* Number of bytes to consume per pixel */
+				int pixel_fmt_bits;     /* Mask of bits to consume for first pixel in byte */
+				
+				std::function<wxColour(uint32_t)> colour_fmt_conv;
+				
+				ImageFormat();
+				
+				/**
+				 * @brief Check if two formats would decode the same image.
+				*/
+				bool same_image(const ImageFormat &other) const;
+				
+				/**
+				 * @brief Get the length of the data in each row of the image.
+				*/
+				off_t line_length() const;
+				
+				/**
+				 * @brief Get the offset of a row of the image.
+				*/
+				BitOffset line_offset(int y) const;
+				
+				/**
+				 * @brief Decode a pixel from the data of a row of the image.
+				 *
+				 * @param line_ptr  Pointer to the data at line_offset(y).
+				 * @param data_end  Pointer to the end of the loaded data.
+				 * @param x         X co-ordinate of the pixel.
+				 * @param y         Y co-ordinate of the pixel.
+				 * @param colour    Decoded colour.
+				 *
+				 * Returns false if the pixel is past the end of the loaded data.
+				*/
+				bool decode_pixel(const unsigned char *line_ptr, const unsigned char *data_end, int x, int y, wxColour *colour) const;
+			};
+			
+			/**
+			 * @brief Box filtered copy of the image at 1/(2^level) scale.
+			*/
+			struct MipLevel
+			{
+				int width, height;
+				std::vector<unsigned char> pixels;  /**< Premultiplied RGBA, alpha is zero past the end of the file. */
+				
+				MipLevel(int width, int height);
+			};
+			
+			struct MipBuild;
+			
 			SharedDocumentPointer document;
 			
 			NumericTextCtrl *offset_textctrl;
@@ -118,15 +185,36 @@ namespace REHex {
 			int bitmap_update_line;
 			wxTimer update_timer;
 			
+			/* When the image is zoomed out, downscaled copies of it are built on the
+			 * ThreadPool and kept for as long as the image format doesn't change, so
+			 * the preview can be drawn from them without aliasing or reading the whole
+			 * image again.
+			*/
+			ImageFormat mip_format;
+			std::map< int, std::shared_ptr<const MipLevel> > mip_levels;
+			
+			std::shared_ptr<MipBuild> mip_build;
+			std::unique_ptr<ThreadPool::TaskHandle> mip_task;
+			int mip_wanted_level;  /* Level needed to draw the preview, zero if not zoomed out. */
+			wxTimer mip_timer;
+			
 			void document_unbind();
 			
 			void update_colour_format_choices();
 			void update_pixel_fmt();
 			void reset_row_length_spinner();
 			
+			ImageFormat get_image_format() const;
+			
 			void update();
 			void render_region(int region_y, int region_h, BitOffset offset, int width, int height);
 			
+			static int mip_level_for(int image_width, int image_height, int output_width, int output_height);
+			void mip_start(int level);
+			void mip_cancel();
+			void mip_reset();
+			void render_mip(const MipLevel &level);
+			
 			void OnDocumentDestroy(wxWindowDestroyEvent &event);
 			void OnCursorUpdate(CursorUpdateEvent &event);
 			void OnDepth(wxCommandEvent &event);
@@ -144,6 +232,8 @@ namespace REHex {
 			void OnSize(wxSizeEvent &event);
 			void OnIdle(wxIdleEvent &event);
 			void OnUpdateTimer(wxTimerEvent &event);
+			void OnMipTimer(wxTimerEvent &event);
+			void OnDataModified(OffsetLengthEvent &event);
 			void OnBitmapRightDown(wxMouseEvent &event);
 			
 			/* Stays at the bottom because it changes the protection... */
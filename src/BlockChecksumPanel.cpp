@@ -0,0 +1,471 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <limits.h>
+#include <tuple>
+#include <wx/numformatter.h>
+#include <wx/sizer.h>
+
+#include "BlockChecksumPanel.hpp"
+#include "util.hpp"
+
+static REHex::ToolPanel *BlockChecksumPanel_factory(wxWindow *parent, REHex::SharedDocumentPointer &document, REHex::DocumentCtrl *document_ctrl)
+{
+	return new REHex::BlockChecksumPanel(parent, document, document_ctrl);
+}
+
+static REHex::ToolPanelRegistration tpr("BlockChecksumPanel", "Block checksums", REHex::ToolPanel::TPS_WIDE, &BlockChecksumPanel_factory);
+
+enum {
+	ID_RANGE_CHOICE = 1,
+	ID_ALGO_CHOICE,
+	ID_BLOCK_SIZE,
+	ID_COMPARE,
+	ID_TABLE_OFFSET,
+	ID_TABLE_STRIDE,
+	ID_TABLE_ORDER,
+	ID_HIGHLIGHT,
+};
+
+BEGIN_EVENT_TABLE(REHex::BlockChecksumPanel, wxPanel)
+	EVT_COMMAND(ID_RANGE_CHOICE, EV_SELECTION_CHANGED, REHex::BlockChecksumPanel::OnRangeChanged)
+	EVT_CHOICE(ID_ALGO_CHOICE, REHex::BlockChecksumPanel::OnSettingChanged)
+	EVT_SPINCTRL(ID_BLOCK_SIZE, REHex::BlockChecksumPanel::OnSpinChanged)
+	EVT_CHECKBOX(ID_COMPARE, REHex::BlockChecksumPanel::OnCompareToggle)
+	EVT_TEXT(ID_TABLE_OFFSET, REHex::BlockChecksumPanel::OnSettingChanged)
+	EVT_SPINCTRL(ID_TABLE_STRIDE, REHex::BlockChecksumPanel::OnSpinChanged)
+	EVT_CHOICE(ID_TABLE_ORDER, REHex::BlockChecksumPanel::OnSettingChanged)
+	EVT_BUTTON(ID_HIGHLIGHT, REHex::BlockChecksumPanel::OnHighlightMismatches)
+	EVT_TIMER(wxID_ANY, REHex::BlockChecksumPanel::OnTimerTick)
+	EVT_LIST_ITEM_ACTIVATED(wxID_ANY, REHex::BlockChecksumPanel::OnItemActivate)
+END_EVENT_TABLE()
+
+REHex::BlockChecksumPanel::BlockChecksumPanel(wxWindow *parent, SharedDocumentPointer &document, DocumentCtrl *document_ctrl):
+	ToolPanel(parent),
+	document(document),
+	document_ctrl(document_ctrl),
+	table_read_end(0),
+	timer(this, wxID_ANY)
+{
+	const int MARGIN = 4;
+	
+	range_choice = new RangeChoiceLinear(this, ID_RANGE_CHOICE, document, document_ctrl);
+	
+	algo_choice = new wxChoice(this, ID_ALGO_CHOICE);
+	
+	cs_algos = ChecksumAlgorithm::all_algos();
+	for(auto i = cs_algos.begin(); i != cs_algos.end(); ++i)
+	{
+		algo_choice->Append((*i)->label);
+	}
+	
+	block_size_ctrl = new wxSpinCtrl(this, ID_BLOCK_SIZE, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 1, INT_MAX, 512);
+	
+	wxBoxSizer *range_sizer = new wxBoxSizer(wxHORIZONTAL);
+	range_sizer->Add(new wxStaticText(this, wxID_ANY, "Range:"), 0, wxALIGN_CENTER_VERTICAL);
+	range_sizer->Add(range_choice, 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	range_sizer->Add(new wxStaticText(this, wxID_ANY, "Block size:"), 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	range_sizer->Add(block_size_ctrl, 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	range_sizer->Add(new wxStaticText(this, wxID_ANY, "Algorithm:"), 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	range_sizer->Add(algo_choice, 1, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	
+	compare_check = new wxCheckBox(this, ID_COMPARE, "Compare with table at:");
+	
+	table_offset_ctrl = new NumericTextCtrl(this, ID_TABLE_OFFSET);
+	table_offset_ctrl->ChangeValue("0");
+	
+	table_stride_ctrl = new wxSpinCtrl(this, ID_TABLE_STRIDE, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 0, INT_MAX, 0);
+	table_stride_ctrl->SetToolTip("Distance between table entries in bytes, zero if the entries are packed together");
+	
+	table_order_choice = new wxChoice(this, ID_TABLE_ORDER);
+	table_order_choice->Append("Big endian");
+	table_order_choice->Append("Little endian");
+	table_order_choice->SetSelection(0);
+	
+	wxBoxSizer *table_sizer = new wxBoxSizer(wxHORIZONTAL);
+	table_sizer->Add(compare_check, 0, wxALIGN_CENTER_VERTICAL);
+	table_sizer->Add(table_offset_ctrl, 1, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	table_sizer->Add(new wxStaticText(this, wxID_ANY, "Stride:"), 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	table_sizer->Add(table_stride_ctrl, 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	table_sizer->Add(table_order_choice, 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	
+	status_text = new wxStaticText(this, wxID_ANY, wxEmptyString);
+	
+	highlight_btn = new wxButton(this, ID_HIGHLIGHT, "Highlight mismatches");
+	highlight_btn->Disable();
+	
+	wxBoxSizer *status_sizer = new wxBoxSizer(wxHORIZONTAL);
+	status_sizer->Add(status_text, 1, wxALIGN_CENTER_VERTICAL);
+	status_sizer->Add(highlight_btn, 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	
+	list_ctrl = new BlockListCtrl(this);
+	list_ctrl->AppendColumn("Offset");
+	list_ctrl->AppendColumn("Length");
+	list_ctrl->AppendColumn("Checksum");
+	list_ctrl->AppendColumn("Expected");
+	
+	wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
+	sizer->Add(range_sizer, 0, (wxEXPAND | wxLEFT | wxRIGHT | wxTOP), MARGIN);
+	sizer->Add(table_sizer, 0, (wxEXPAND | wxLEFT | wxRIGHT | wxTOP), MARGIN);
+	sizer->Add(status_sizer, 0, (wxEXPAND | wxLEFT | wxRIGHT | wxTOP), MARGIN);
+	sizer->Add(list_ctrl, 1, (wxEXPAND | wxALL), MARGIN);
+	SetSizerAndFit(sizer);
+	
+	this->document.auto_cleanup_bind(DATA_ERASE,     &REHex::BlockChecksumPanel::OnDataErase,     this);
+	this->document.auto_cleanup_bind(DATA_INSERT,    &REHex::BlockChecksumPanel::OnDataInsert,    this);
+	this->document.auto_cleanup_bind(DATA_OVERWRITE, &REHex::BlockChecksumPanel::OnDataOverwrite, this);
+	
+	algo_choice->SetSelection(0);
+	range_choice->set_whole_file();
+	
+	table_offset_ctrl->Disable();
+	table_stride_ctrl->Disable();
+	table_order_choice->Disable();
+	
+	restart();
+}
+
+REHex::BlockChecksumPanel::~BlockChecksumPanel()
+{
+	timer.Stop();
+}
+
+std::string REHex::BlockChecksumPanel::name() const
+{
+	return "BlockChecksumPanel";
+}
+
+void REHex::BlockChecksumPanel::save_state(wxConfig *config) const
+{
+	config->Write("algorithm", wxString(cs_algos[algo_choice->GetSelection()]->name));
+	config->Write("block-size", (long)(block_size_ctrl->GetValue()));
+}
+
+void REHex::BlockChecksumPanel::load_state(wxConfig *config)
+{
+	std::string algo_name = config->Read("algorithm", "").ToStdString();
+	
+	for(size_t i = 0; i < cs_algos.size(); ++i)
+	{
+		if(cs_algos[i]->name == algo_name)
+		{
+			algo_choice->SetSelection(i);
+			break;
+		}
+	}
+	
+	block_size_ctrl->SetValue(config->Read("block-size", (long)(block_size_ctrl->GetValue())));
+	
+	restart();
+}
+
+wxSize REHex::BlockChecksumPanel::DoGetBestClientSize() const
+{
+	return wxSize(-1, 200);
+}
+
+void REHex::BlockChecksumPanel::update()
+{
+	if(!table)
+	{
+		restart();
+	}
+	else{
+		list_ctrl->Refresh();
+	}
+}
+
+void REHex::BlockChecksumPanel::restart()
+{
+	timer.Stop();
+	table.reset(NULL);
+	
+	list_ctrl->SetItemCount(0);
+	highlight_btn->Disable();
+	
+	if(!is_visible)
+	{
+		/* There is no sense in updating this if we are not visible */
+		return;
+	}
+	
+	BitOffset range_offset, range_length;
+	std::tie(range_offset, range_length) = range_choice->get_range();
+	
+	assert(range_offset.byte_aligned());
+	assert(range_length.byte_aligned());
+	
+	if(range_length <= BitOffset::ZERO)
+	{
+		status_text->SetLabel("No data selected");
+		return;
+	}
+	
+	const ChecksumAlgorithm *algorithm = cs_algos[algo_choice->GetSelection()];
+	off_t block_size = block_size_ctrl->GetValue();
+	
+	table_read_end = range_offset.byte() + range_length.byte();
+	
+	if(compare_check->GetValue())
+	{
+		off_t table_offset;
+		
+		try {
+			table_offset = table_offset_ctrl->GetValue<off_t>(0);
+		}
+		catch(const NumericTextCtrl::InputError &e)
+		{
+			status_text->SetLabel(std::string("Invalid table offset: ") + e.what());
+			return;
+		}
+		
+		off_t num_blocks = (range_length.byte() + block_size - 1) / block_size;
+		off_t table_stride = table_stride_ctrl->GetValue() > 0 ? table_stride_ctrl->GetValue() : BlockChecksumTable::checksum_size(algorithm);
+		
+		BlockChecksumTable::ReferenceTable reference(table_offset, table_stride, (table_order_choice->GetSelection() == 1));
+		table.reset(new BlockChecksumTable(document, algorithm, range_offset.byte(), range_length.byte(), block_size, &reference));
+		
+		table_read_end = std::max(table_read_end, (table_offset + (num_blocks * table_stride)));
+	}
+	else{
+		table.reset(new BlockChecksumTable(document, algorithm, range_offset.byte(), range_length.byte(), block_size));
+	}
+	
+	list_ctrl->SetItemCount(table->get_num_blocks());
+	
+	update_status();
+	
+	if(!table->is_complete())
+	{
+		timer.Start(250, wxTIMER_CONTINUOUS);
+	}
+}
+
+void REHex::BlockChecksumPanel::update_status()
+{
+	assert(table);
+	
+	wxString status;
+	
+	if(table->is_complete())
+	{
+		status = wxNumberFormatter::ToString((long)(table->get_num_blocks())) + " blocks";
+	}
+	else{
+		int percent = (int)(((double)(table->get_blocks_done()) / (double)(table->get_num_blocks())) * 100.0);
+		status = "Computing checksums (" + std::to_string(percent) + "%)...";
+	}
+	
+	if(table->has_reference())
+	{
+		status += ", " + wxNumberFormatter::ToString((long)(table->get_mismatch_count())) + " mismatched";
+	}
+	
+	status_text->SetLabel(status);
+	
+	highlight_btn->Enable(table->is_complete() && table->get_mismatch_count() > 0);
+}
+
+void REHex::BlockChecksumPanel::OnRangeChanged(wxCommandEvent &event)
+{
+	restart();
+}
+
+void REHex::BlockChecksumPanel::OnSettingChanged(wxCommandEvent &event)
+{
+	restart();
+}
+
+void REHex::BlockChecksumPanel::OnSpinChanged(wxSpinEvent &event)
+{
+	restart();
+}
+
+void REHex::BlockChecksumPanel::OnCompareToggle(wxCommandEvent &event)
+{
+	bool compare = compare_check->GetValue();
+	
+	table_offset_ctrl->Enable(compare);
+	table_stride_ctrl->Enable(compare);
+	table_order_choice->Enable(compare);
+	
+	restart();
+}
+
+void REHex::BlockChecksumPanel::OnHighlightMismatches(wxCommandEvent &event)
+{
+	if(!table || !table->is_complete())
+	{
+		return;
+	}
+	
+	const HighlightColourMap &highlight_colours = document->get_highlight_colours();
+	if(highlight_colours.empty())
+	{
+		return;
+	}
+	
+	int highlight_colour_idx = highlight_colours.begin()->first;
+	
+	std::vector<size_t> mismatches = table->get_mismatches();
+	
+	Document::AnnotationBatch batch;
+	
+	for(auto i = mismatches.begin(); i != mismatches.end(); ++i)
+	{
+		BlockChecksumTable::Block block = table->get_block(*i);
+		batch.add_highlight(BitOffset(block.offset, 0), BitOffset(block.length, 0), highlight_colour_idx);
+	}
+	
+	document->apply_annotations(batch, "highlight checksum mismatches");
+}
+
+void REHex::BlockChecksumPanel::OnTimerTick(wxTimerEvent &event)
+{
+	if(!table)
+	{
+		timer.Stop();
+		return;
+	}
+	
+	if(table->is_complete())
+	{
+		timer.Stop();
+	}
+	
+	update_status();
+	
+	/* Redraw the visible rows to pick up any checksums finished since the last tick. */
+	list_ctrl->Refresh();
+}
+
+void REHex::BlockChecksumPanel::OnItemActivate(wxListEvent &event)
+{
+	long item_idx = event.GetIndex();
+	assert(item_idx >= 0);
+	
+	if(!table || (size_t)(item_idx) >= table->get_num_blocks())
+	{
+		return;
+	}
+	
+	BlockChecksumTable::Block block = table->get_block(item_idx);
+	
+	document->set_cursor_position(BitOffset(block.offset, 0));
+	document_ctrl->set_selection_raw(BitOffset(block.offset, 0), BitOffset((block.offset + block.length - 1), 0));
+}
+
+void REHex::BlockChecksumPanel::OnDataErase(OffsetLengthEvent &event)
+{
+	/* Reset if the data was erased before the end of the data we read. */
+	if(table && event.offset < table_read_end)
+	{
+		restart();
+	}
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::BlockChecksumPanel::OnDataInsert(OffsetLengthEvent &event)
+{
+	/* Reset if the data was inserted before the end of the data we read. */
+	if(table && event.offset < table_read_end)
+	{
+		restart();
+	}
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::BlockChecksumPanel::OnDataOverwrite(OffsetLengthEvent &event)
+{
+	/* Reset if any of the overwritten bytes were within the range or reference table. */
+	if(table && event.offset < table_read_end)
+	{
+		restart();
+	}
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+REHex::BlockChecksumPanel::BlockListCtrl::BlockListCtrl(BlockChecksumPanel *parent):
+	wxListCtrl(parent, wxID_ANY, wxDefaultPosition, wxDefaultSize, (wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL))
+{
+	mismatch_attr.SetTextColour(*wxRED);
+}
+
+wxString REHex::BlockChecksumPanel::BlockListCtrl::OnGetItemText(long item, long column) const
+{
+	BlockChecksumPanel *parent = dynamic_cast<BlockChecksumPanel*>(GetParent());
+	assert(parent != NULL);
+	
+	if(!parent->table || (size_t)(item) >= parent->table->get_num_blocks())
+	{
+		/* wxWidgets has asked for an item beyond the end of the list.
+		 *
+		 * This probably means the table has been reset but SetItemCount() hasn't been
+		 * called yet.
+		*/
+		
+		return "???";
+	}
+	
+	BlockChecksumTable::Block block = parent->table->get_block(item);
+	
+	switch(column)
+	{
+		case 0:
+			/* Offset column */
+			return format_offset(block.offset, parent->document_ctrl->get_offset_display_base(), parent->document->buffer_length());
+		
+		case 1:
+			/* Length column */
+			return format_offset(block.length, parent->document_ctrl->get_offset_display_base(), parent->document->buffer_length());
+		
+		case 2:
+			/* Checksum column */
+			return block.done ? wxString(block.checksum) : wxString("...");
+		
+		case 3:
+			/* Expected column */
+			return block.expected;
+		
+		default:
+			/* Unknown column */
+			abort();
+	}
+}
+
+wxListItemAttr *REHex::BlockChecksumPanel::BlockListCtrl::OnGetItemAttr(long item) const
+{
+	BlockChecksumPanel *parent = dynamic_cast<BlockChecksumPanel*>(GetParent());
+	assert(parent != NULL);
+	
+	if(parent->table && (size_t)(item) < parent->table->get_num_blocks() && parent->table->get_block(item).mismatch)
+	{
+		return &mismatch_attr;
+	}
+	
+	return NULL;
+}
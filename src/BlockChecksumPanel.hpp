@@ -0,0 +1,123 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_BLOCKCHECKSUMPANEL_HPP
+#define REHEX_BLOCKCHECKSUMPANEL_HPP
+
+#include <memory>
+#include <vector>
+#include <wx/button.h>
+#include <wx/checkbox.h>
+#include <wx/choice.h>
+#include <wx/listctrl.h>
+#include <wx/spinctrl.h>
+#include <wx/stattext.h>
+#include <wx/timer.h>
+
+#include "BlockChecksumTable.hpp"
+#include "Checksum.hpp"
+#include "DocumentCtrl.hpp"
+#include "Events.hpp"
+#include "NumericTextCtrl.hpp"
+#include "RangeChoiceLinear.hpp"
+#include "SafeWindowPointer.hpp"
+#include "SharedDocumentPointer.hpp"
+#include "ToolPanel.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Tool panel listing the checksum of each block (sector, page, etc) in a range.
+	 *
+	 * The checksums can be compared against a table stored elsewhere in the file, with
+	 * any blocks which don't match it highlighted.
+	*/
+	class BlockChecksumPanel: public ToolPanel
+	{
+		public:
+			BlockChecksumPanel(wxWindow *parent, SharedDocumentPointer &document, DocumentCtrl *document_ctrl);
+			~BlockChecksumPanel();
+			
+			virtual std::string name() const override;
+			
+			virtual void save_state(wxConfig *config) const override;
+			virtual void load_state(wxConfig *config) override;
+			virtual void update() override;
+			
+			virtual wxSize DoGetBestClientSize() const override;
+		
+		private:
+			class BlockListCtrl: public wxListCtrl
+			{
+				public:
+					BlockListCtrl(BlockChecksumPanel *parent);
+					
+					virtual wxString OnGetItemText(long item, long column) const override;
+					virtual wxListItemAttr *OnGetItemAttr(long item) const override;
+				
+				private:
+					mutable wxListItemAttr mismatch_attr;
+			};
+			
+			SharedDocumentPointer document;
+			SafeWindowPointer<DocumentCtrl> document_ctrl;
+			
+			std::vector<const ChecksumAlgorithm*> cs_algos;
+			
+			std::unique_ptr<BlockChecksumTable> table;
+			
+			/* End of the data read by the table (range or reference table, whichever is
+			 * later), changes after this don't affect it.
+			*/
+			off_t table_read_end;
+			
+			RangeChoiceLinear *range_choice;
+			wxChoice *algo_choice;
+			wxSpinCtrl *block_size_ctrl;
+			
+			wxCheckBox *compare_check;
+			NumericTextCtrl *table_offset_ctrl;
+			wxSpinCtrl *table_stride_ctrl;
+			wxChoice *table_order_choice;
+			
+			wxStaticText *status_text;
+			wxButton *highlight_btn;
+			BlockListCtrl *list_ctrl;
+			wxTimer timer;
+			
+			void restart();
+			void update_status();
+			
+			void OnRangeChanged(wxCommandEvent &event);
+			void OnSettingChanged(wxCommandEvent &event);
+			void OnSpinChanged(wxSpinEvent &event);
+			void OnCompareToggle(wxCommandEvent &event);
+			void OnHighlightMismatches(wxCommandEvent &event);
+			void OnTimerTick(wxTimerEvent &event);
+			void OnItemActivate(wxListEvent &event);
+			
+			void OnDataErase(OffsetLengthEvent &event);
+			void OnDataInsert(OffsetLengthEvent &event);
+			void OnDataOverwrite(OffsetLengthEvent &event);
+		
+		DECLARE_EVENT_TABLE()
+		
+		friend BlockListCtrl;
+	};
+}
+
+#endif /* !REHEX_BLOCKCHECKSUMPANEL_HPP */
@@ -0,0 +1,416 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <ctype.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+
+#include "App.hpp"
+#include "BlockChecksumTable.hpp"
+
+const off_t REHex::BlockChecksumTable::DEFAULT_CHUNK_SIZE;
+
+static std::string hex_encode(const unsigned char *data, size_t length, bool reverse)
+{
+	static const char HEX_DIGITS[] = "0123456789ABCDEF";
+	
+	std::string hex;
+	hex.reserve(length * 2);
+	
+	for(size_t i = 0; i < length; ++i)
+	{
+		unsigned char byte = reverse ? data[length - i - 1] : data[i];
+		
+		hex.push_back(HEX_DIGITS[(byte >> 4) & 0xF]);
+		hex.push_back(HEX_DIGITS[byte & 0xF]);
+	}
+	
+	return hex;
+}
+
+static void hex_decode(const std::string &hex, unsigned char *data, size_t length)
+{
+	/* Digits are aligned to the end, an odd number of them leaves the top of the first
+	 * byte clear.
+	*/
+	
+	memset(data, 0, length);
+	
+	for(size_t i = 0; i < hex.size() && i < (length * 2); ++i)
+	{
+		unsigned char c = toupper((unsigned char)(hex[hex.size() - i - 1]));
+		unsigned char nibble = isdigit(c) ? (c - '0') : (c - 'A' + 10);
+		
+		data[length - (i / 2) - 1] |= (nibble & 0xF) << ((i % 2) * 4);
+	}
+}
+
+static void copy_entry(unsigned char *dst, const unsigned char *src, size_t length, bool reverse)
+{
+	if(reverse)
+	{
+		std::reverse_copy(src, (src + length), dst);
+	}
+	else{
+		memcpy(dst, src, length);
+	}
+}
+
+REHex::BlockChecksumTable::BlockChecksumTable(SharedDocumentPointer &document, const ChecksumAlgorithm *algorithm, off_t offset, off_t length, off_t block_size, const ReferenceTable *reference, off_t chunk_size):
+	document(document),
+	algorithm(algorithm),
+	offset(offset),
+	length(length),
+	block_size(block_size),
+	chunk_size(chunk_size),
+	chunk_blocks(std::max<off_t>((chunk_size / block_size), 1)),
+	compare(reference != NULL),
+	table_offset(reference != NULL ? reference->offset : 0),
+	table_stride(reference != NULL && reference->stride > 0 ? reference->stride : checksum_size(algorithm)),
+	table_little_endian(reference != NULL ? reference->little_endian : false),
+	entry_size(checksum_size(algorithm)),
+	hex_digits(checksum_hex_digits(algorithm)),
+	num_blocks((length + block_size - 1) / block_size),
+	num_chunks((num_blocks + chunk_blocks - 1) / chunk_blocks),
+	next_chunk(0),
+	chunks_done(0),
+	blocks_done(0),
+	mismatch_count(0)
+{
+	assert(algorithm != NULL);
+	assert(offset >= 0);
+	assert(length >= 0);
+	assert(block_size > 0);
+	assert(chunk_size > 0);
+	
+	/* All results are allocated up front so blocks can be looked up while the workers are
+	 * still filling them in.
+	*/
+	
+	checksums.resize(num_blocks * entry_size);
+	done.resize(num_blocks, false);
+	
+	if(compare)
+	{
+		expected.resize(num_blocks * entry_size);
+		has_expected.resize(num_blocks, false);
+		mismatched.resize(num_blocks, false);
+	}
+	
+	if(num_chunks > 0)
+	{
+		task.reset(new ThreadPool::TaskHandle(wxGetApp().thread_pool->queue_task([this]()
+		{
+			return process_next_chunk();
+		}, -1)));
+	}
+}
+
+REHex::BlockChecksumTable::~BlockChecksumTable()
+{
+	if(task)
+	{
+		task->finish();
+		task->join();
+	}
+}
+
+off_t REHex::BlockChecksumTable::checksum_size(const ChecksumAlgorithm *algorithm)
+{
+	return (checksum_hex_digits(algorithm) + 1) / 2;
+}
+
+size_t REHex::BlockChecksumTable::checksum_hex_digits(const ChecksumAlgorithm *algorithm)
+{
+	std::unique_ptr<ChecksumGenerator> generator(algorithm->factory());
+	generator->finish();
+	
+	return generator->checksum_hex().size();
+}
+
+std::string REHex::BlockChecksumTable::entry_hex(const std::vector<unsigned char> &entries, size_t block_idx) const
+{
+	std::string hex = hex_encode((entries.data() + (block_idx * entry_size)), entry_size, false);
+	
+	/* Drop the padding digit of checksums with an odd number of them. */
+	return hex.substr(hex.size() - std::min(hex.size(), hex_digits));
+}
+
+off_t REHex::BlockChecksumTable::get_offset() const
+{
+	return offset;
+}
+
+off_t REHex::BlockChecksumTable::get_length() const
+{
+	return length;
+}
+
+off_t REHex::BlockChecksumTable::get_block_size() const
+{
+	return block_size;
+}
+
+bool REHex::BlockChecksumTable::has_reference() const
+{
+	return compare;
+}
+
+size_t REHex::BlockChecksumTable::get_num_blocks() const
+{
+	return num_blocks;
+}
+
+size_t REHex::BlockChecksumTable::get_blocks_done() const
+{
+	return blocks_done;
+}
+
+size_t REHex::BlockChecksumTable::get_mismatch_count() const
+{
+	return mismatch_count;
+}
+
+bool REHex::BlockChecksumTable::is_complete() const
+{
+	return chunks_done == num_chunks;
+}
+
+void REHex::BlockChecksumTable::wait_for_completion()
+{
+	if(task)
+	{
+		task->join();
+		task.reset(NULL);
+	}
+}
+
+REHex::BlockChecksumTable::Block REHex::BlockChecksumTable::get_block(size_t block_idx) const
+{
+	assert(block_idx < num_blocks);
+	
+	Block block;
+	block.offset = offset + ((off_t)(block_idx) * block_size);
+	block.length = std::min(block_size, ((offset + length) - block.offset));
+	
+	std::lock_guard<std::mutex> rl(results_lock);
+	
+	block.done = done[block_idx];
+	
+	if(block.done)
+	{
+		block.checksum = entry_hex(checksums, block_idx);
+	}
+	
+	if(compare && has_expected[block_idx])
+	{
+		block.expected = entry_hex(expected, block_idx);
+		block.mismatch = mismatched[block_idx];
+	}
+	
+	return block;
+}
+
+std::vector<size_t> REHex::BlockChecksumTable::get_mismatches() const
+{
+	std::vector<size_t> mismatches;
+	
+	if(compare)
+	{
+		std::lock_guard<std::mutex> rl(results_lock);
+		
+		for(size_t i = 0; i < num_blocks; ++i)
+		{
+			if(mismatched[i])
+			{
+				mismatches.push_back(i);
+			}
+		}
+	}
+	
+	return mismatches;
+}
+
+bool REHex::BlockChecksumTable::process_next_chunk()
+{
+	size_t chunk_idx = next_chunk.fetch_add(1);
+	if(chunk_idx >= num_chunks)
+	{
+		return true;
+	}
+	
+	try {
+		process_chunk(chunk_idx);
+	}
+	catch(const std::exception &e)
+	{
+		/* Document has probably been truncated under us, whoever is using the table will
+		 * throw it away when they see the change.
+		*/
+		fprintf(stderr, "Exception in REHex::BlockChecksumTable::process_chunk: %s\n", e.what());
+	}
+	
+	++chunks_done;
+	
+	return false;
+}
+
+void REHex::BlockChecksumTable::process_chunk(size_t chunk_idx)
+{
+	size_t first_block = chunk_idx * chunk_blocks;
+	size_t count = std::min<size_t>(chunk_blocks, (num_blocks - first_block));
+	
+	off_t chunk_base = offset + ((off_t)(first_block) * block_size);
+	off_t chunk_end = std::min((chunk_base + ((off_t)(count) * block_size)), (offset + length));
+	
+	std::unique_ptr<ChecksumGenerator> generator(algorithm->factory());
+	
+	std::vector<unsigned char> chunk_checksums(count * entry_size);
+	size_t chunk_checksums_done = 0;
+	
+	off_t block_remain = std::min(block_size, (chunk_end - chunk_base));
+	
+	/* The chunk is read at once unless it is a single block larger than chunk_size, which
+	 * is read in pieces.
+	*/
+	
+	for(off_t pos = chunk_base; pos < chunk_end;)
+	{
+		std::vector<unsigned char> data = document->read_data(pos, std::min(chunk_size, (chunk_end - pos)));
+		if(data.empty())
+		{
+			throw std::runtime_error("Unexpected end of file");
+		}
+		
+		for(size_t i = 0; i < data.size();)
+		{
+			size_t add_len = std::min<off_t>((data.size() - i), block_remain);
+			
+			generator->add_data((data.data() + i), add_len);
+			i += add_len;
+			block_remain -= add_len;
+			
+			if(block_remain == 0)
+			{
+				generator->finish();
+				assert(chunk_checksums_done < count);
+				
+				hex_decode(generator->checksum_hex(), (chunk_checksums.data() + (chunk_checksums_done * entry_size)), entry_size);
+				++chunk_checksums_done;
+				
+				generator->reset();
+				
+				block_remain = std::min(block_size, (chunk_end - (pos + (off_t)(i))));
+			}
+		}
+		
+		pos += data.size();
+	}
+	
+	assert(chunk_checksums_done == count);
+	
+	std::vector<unsigned char> chunk_expected;
+	std::vector<bool> chunk_has_expected;
+	
+	if(compare)
+	{
+		chunk_expected.resize(count * entry_size);
+		chunk_has_expected.resize(count, false);
+		
+		read_reference(first_block, count, chunk_expected.data(), &chunk_has_expected);
+	}
+	
+	size_t chunk_mismatches = 0;
+	
+	{
+		std::lock_guard<std::mutex> rl(results_lock);
+		
+		std::copy(chunk_checksums.begin(), chunk_checksums.end(), (checksums.begin() + (first_block * entry_size)));
+		
+		for(size_t i = 0; i < count; ++i)
+		{
+			done[first_block + i] = true;
+		}
+		
+		if(compare)
+		{
+			std::copy(chunk_expected.begin(), chunk_expected.end(), (expected.begin() + (first_block * entry_size)));
+			
+			for(size_t i = 0; i < count; ++i)
+			{
+				if(chunk_has_expected[i])
+				{
+					has_expected[first_block + i] = true;
+					
+					if(memcmp((chunk_checksums.data() + (i * entry_size)), (chunk_expected.data() + (i * entry_size)), entry_size) != 0)
+					{
+						mismatched[first_block + i] = true;
+						++chunk_mismatches;
+					}
+				}
+			}
+		}
+	}
+	
+	mismatch_count += chunk_mismatches;
+	blocks_done += count;
+}
+
+void REHex::BlockChecksumTable::read_reference(size_t first_block, size_t count, unsigned char *entries, std::vector<bool> *present)
+{
+	/* Entries are stored in the same byte order as the computed checksums so they can be
+	 * compared directly.
+	*/
+	
+	off_t first_entry = table_offset + ((off_t)(first_block) * table_stride);
+	off_t span = ((off_t)(count - 1) * table_stride) + entry_size;
+	
+	if(span <= chunk_size)
+	{
+		/* Entries are close enough together to read them all at once. */
+		
+		std::vector<unsigned char> data = document->read_data(first_entry, span);
+		
+		for(size_t i = 0; i < count; ++i)
+		{
+			size_t entry_off = i * table_stride;
+			
+			if((entry_off + entry_size) <= data.size())
+			{
+				copy_entry((entries + (i * entry_size)), (data.data() + entry_off), entry_size, table_little_endian);
+				(*present)[i] = true;
+			}
+		}
+	}
+	else{
+		for(size_t i = 0; i < count; ++i)
+		{
+			std::vector<unsigned char> data = document->read_data((first_entry + ((off_t)(i) * table_stride)), entry_size);
+			
+			if(data.size() == (size_t)(entry_size))
+			{
+				copy_entry((entries + (i * entry_size)), data.data(), entry_size, table_little_endian);
+				(*present)[i] = true;
+			}
+		}
+	}
+}
@@ -0,0 +1,210 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_BLOCKCHECKSUMTABLE_HPP
+#define REHEX_BLOCKCHECKSUMTABLE_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "Checksum.hpp"
+#include "SharedDocumentPointer.hpp"
+#include "ThreadPool.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Checksums of each fixed size block in a range of a Document.
+	 *
+	 * The range is split into blocks of block_size bytes (the last one may be shorter) and
+	 * a checksum is computed for each one using the given ChecksumAlgorithm, for example a
+	 * CRC for each 512 byte sector of a disk image.
+	 *
+	 * The checksums can optionally be compared against a table of reference checksums
+	 * stored in the document, with one entry every table_stride bytes from table_offset.
+	 *
+	 * The blocks are checksummed in chunks on the ThreadPool when the table is created and
+	 * can be read back as they are finished. The table doesn't follow changes to the
+	 * document, a new one must be created if the data is modified.
+	*/
+	class BlockChecksumTable
+	{
+		public:
+			/**
+			 * @brief Default number of bytes checksummed by each worker at a time.
+			*/
+			static const off_t DEFAULT_CHUNK_SIZE = 4 * 1024 * 1024;
+			
+			/**
+			 * @brief Location and format of a table of reference checksums.
+			*/
+			struct ReferenceTable
+			{
+				off_t offset;        /**< Offset of the entry for the first block. */
+				off_t stride;        /**< Distance in bytes between entries, zero if they are packed together. */
+				bool little_endian;  /**< Entries are stored least significant byte first. */
+				
+				ReferenceTable(off_t offset, off_t stride, bool little_endian):
+					offset(offset), stride(stride), little_endian(little_endian) {}
+			};
+			
+			/**
+			 * @brief Checksum of a single block.
+			*/
+			struct Block
+			{
+				off_t offset;
+				off_t length;
+				
+				bool done;             /**< Checksum has been computed. */
+				std::string checksum;  /**< Checksum of the block (hex). */
+				std::string expected;  /**< Checksum from the reference table (hex), empty if there is no table or the entry is past the end of the file. */
+				bool mismatch;         /**< Checksum doesn't match the reference table. */
+				
+				Block(): offset(0), length(0), done(false), mismatch(false) {}
+			};
+			
+			/**
+			 * @brief Start checksumming a range of a Document.
+			 *
+			 * @param document    Document to read data from.
+			 * @param algorithm   Checksum algorithm to use.
+			 * @param offset      Offset of the first block.
+			 * @param length      Length of the range to checksum.
+			 * @param block_size  Length of each block.
+			 * @param reference   Table to compare checksums against, NULL if none.
+			 * @param chunk_size  Number of bytes checksummed by a worker at a time.
+			*/
+			BlockChecksumTable(SharedDocumentPointer &document, const ChecksumAlgorithm *algorithm, off_t offset, off_t length, off_t block_size, const ReferenceTable *reference = NULL, off_t chunk_size = DEFAULT_CHUNK_SIZE);
+			
+			~BlockChecksumTable();
+			
+			BlockChecksumTable(const BlockChecksumTable&) = delete;
+			BlockChecksumTable &operator=(const BlockChecksumTable&) = delete;
+			
+			/**
+			 * @brief Get the size in bytes of the checksums produced by an algorithm.
+			 *
+			 * This is the size of each entry in a reference table.
+			*/
+			static off_t checksum_size(const ChecksumAlgorithm *algorithm);
+			
+			off_t get_offset() const;
+			off_t get_length() const;
+			off_t get_block_size() const;
+			
+			/**
+			 * @brief Check if the table is being compared against a reference table.
+			*/
+			bool has_reference() const;
+			
+			/**
+			 * @brief Get the number of blocks in the range.
+			*/
+			size_t get_num_blocks() const;
+			
+			/**
+			 * @brief Get the number of blocks checksummed so far.
+			*/
+			size_t get_blocks_done() const;
+			
+			/**
+			 * @brief Get the number of blocks found not to match the reference table so far.
+			*/
+			size_t get_mismatch_count() const;
+			
+			/**
+			 * @brief Check if every block has been checksummed.
+			*/
+			bool is_complete() const;
+			
+			/**
+			 * @brief Wait for every block to be checksummed.
+			 *
+			 * This is mostly intended for unit tests. This should not be used from the
+			 * application UI thread.
+			*/
+			void wait_for_completion();
+			
+			/**
+			 * @brief Get the checksum of a block.
+			 *
+			 * May be called while the table is still being built, in which case blocks
+			 * which haven't been reached yet are returned with done set to false.
+			*/
+			Block get_block(size_t block_idx) const;
+			
+			/**
+			 * @brief Get the indices of the blocks which don't match the reference table.
+			 *
+			 * Only blocks which have been checksummed so far are included.
+			*/
+			std::vector<size_t> get_mismatches() const;
+		
+		private:
+			SharedDocumentPointer document;
+			const ChecksumAlgorithm *algorithm;
+			
+			const off_t offset;
+			const off_t length;
+			const off_t block_size;
+			const off_t chunk_size;
+			const off_t chunk_blocks;
+			
+			const bool compare;
+			const off_t table_offset;
+			const off_t table_stride;
+			const bool table_little_endian;
+			const off_t entry_size;
+			const size_t hex_digits;
+			
+			size_t num_blocks;
+			size_t num_chunks;
+			
+			/* Results are copied in from each worker a chunk at a time, the vectors below are
+			 * protected by results_lock. Checksums are kept as entry_size raw bytes per block
+			 * and only converted to hex when a block is looked up.
+			*/
+			mutable std::mutex results_lock;
+			std::vector<unsigned char> checksums;  /* Checksum of each block. */
+			std::vector<unsigned char> expected;   /* Reference table entry of each block, in the same byte order as checksums. */
+			std::vector<bool> done;                /* Block has been checksummed. */
+			std::vector<bool> has_expected;        /* Block has a reference table entry within the file. */
+			std::vector<bool> mismatched;
+			
+			std::atomic<size_t> next_chunk;
+			std::atomic<size_t> chunks_done;
+			std::atomic<size_t> blocks_done;
+			std::atomic<size_t> mismatch_count;
+			
+			std::unique_ptr<ThreadPool::TaskHandle> task;
+			
+			bool process_next_chunk();
+			void process_chunk(size_t chunk_idx);
+			
+			static size_t checksum_hex_digits(const ChecksumAlgorithm *algorithm);
+			std::string entry_hex(const std::vector<unsigned char> &entries, size_t block_idx) const;
+			
+			void read_reference(size_t first_block, size_t count, unsigned char *entries, std::vector<bool> *present);
+	};
+}
+
+#endif /* !REHEX_BLOCKCHECKSUMTABLE_HPP */
@@ -0,0 +1,165 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include "BlockPool.hpp"
+
+REHex::BlockPool::Stats::Stats():
+	allocated(0),
+	reused(0),
+	oversize(0),
+	returned(0),
+	discarded(0),
+	free(0) {}
+
+REHex::BlockPool::BlockPool(size_t slab_size, size_t capacity):
+	slab_size(slab_size),
+	capacity(capacity) {}
+
+std::shared_ptr<REHex::BlockPool> REHex::BlockPool::create(size_t slab_size, size_t capacity)
+{
+	return std::shared_ptr<BlockPool>(new BlockPool(slab_size, capacity));
+}
+
+REHex::BlockPool::~BlockPool()
+{
+	for(auto s = free_slabs.begin(); s != free_slabs.end(); ++s)
+	{
+		delete *s;
+	}
+}
+
+std::shared_ptr< std::vector<unsigned char> > REHex::BlockPool::get(size_t size)
+{
+	if(size > slab_size)
+	{
+		std::lock_guard<std::mutex> l(lock);
+		++(stats.oversize);
+		
+		return std::make_shared< std::vector<unsigned char> >(size);
+	}
+	
+	std::vector<unsigned char> *slab = NULL;
+	
+	{
+		std::lock_guard<std::mutex> l(lock);
+		
+		if(!free_slabs.empty())
+		{
+			slab = free_slabs.back();
+			free_slabs.pop_back();
+			
+			++(stats.reused);
+		}
+		else{
+			++(stats.allocated);
+		}
+	}
+	
+	if(slab == NULL)
+	{
+		slab = new std::vector<unsigned char>();
+		slab->reserve(slab_size);
+	}
+	
+	slab->resize(size);
+	
+	/* Slabs hold a weak reference to the pool, so any still in use when the pool is
+	 * destroyed are just freed when released.
+	*/
+	
+	std::weak_ptr<BlockPool> pool = shared_from_this();
+	
+	return std::shared_ptr< std::vector<unsigned char> >(slab, [pool](std::vector<unsigned char> *slab)
+	{
+		std::shared_ptr<BlockPool> p = pool.lock();
+		if(p)
+		{
+			p->release(slab);
+		}
+		else{
+			delete slab;
+		}
+	});
+}
+
+void REHex::BlockPool::release(std::vector<unsigned char> *slab)
+{
+	{
+		std::lock_guard<std::mutex> l(lock);
+		
+		/* Don't keep slabs which have been shrunk, or grown too far past the slab size
+		 * by inserting data into a block.
+		*/
+		
+		if(free_slabs.size() < capacity && slab->capacity() >= slab_size && slab->capacity() <= (slab_size * 2))
+		{
+			free_slabs.push_back(slab);
+			++(stats.returned);
+			
+			return;
+		}
+		
+		++(stats.discarded);
+	}
+	
+	delete slab;
+}
+
+size_t REHex::BlockPool::get_slab_size() const
+{
+	return slab_size;
+}
+
+size_t REHex::BlockPool::get_capacity() const
+{
+	std::lock_guard<std::mutex> l(lock);
+	return capacity;
+}
+
+void REHex::BlockPool::set_capacity(size_t capacity)
+{
+	std::vector< std::vector<unsigned char>* > excess;
+	
+	{
+		std::lock_guard<std::mutex> l(lock);
+		
+		this->capacity = capacity;
+		
+		while(free_slabs.size() > capacity)
+		{
+			excess.push_back(free_slabs.back());
+			free_slabs.pop_back();
+		}
+	}
+	
+	for(auto s = excess.begin(); s != excess.end(); ++s)
+	{
+		delete *s;
+	}
+}
+
+REHex::BlockPool::Stats REHex::BlockPool::get_stats() const
+{
+	std::lock_guard<std::mutex> l(lock);
+	
+	Stats s = stats;
+	s.free = free_slabs.size();
+	
+	return s;
+}
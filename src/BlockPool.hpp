@@ -0,0 +1,112 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_BLOCKPOOL_HPP
+#define REHEX_BLOCKPOOL_HPP
+
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <vector>
+
+namespace REHex
+{
+	/**
+	 * @brief Pool of recycled fixed-size buffers for holding blocks of file data.
+	 *
+	 * Buffers handed out by the pool are returned to it when the last reference to them is
+	 * released, from any thread, and handed out again by the next call to get() rather than
+	 * freeing and allocating a new one. Up to capacity unused buffers are kept.
+	 *
+	 * Each buffer has room for slab_size bytes. Requests for larger buffers are served by
+	 * a normal allocation and never pooled.
+	 *
+	 * BlockPool objects must be managed by a std::shared_ptr, see create().
+	*/
+	class BlockPool: public std::enable_shared_from_this<BlockPool>
+	{
+		public:
+			/**
+			 * @brief Counters describing how the pool has been used.
+			*/
+			struct Stats
+			{
+				size_t allocated;  /**< Number of slabs allocated by get(). */
+				size_t reused;     /**< Number of calls to get() served by a recycled slab. */
+				size_t oversize;   /**< Number of calls to get() too large for a slab. */
+				size_t returned;   /**< Number of slabs returned to the pool. */
+				size_t discarded;  /**< Number of slabs freed because the pool was full. */
+				size_t free;       /**< Number of slabs currently waiting in the pool. */
+				
+				Stats();
+			};
+			
+			/**
+			 * @brief Create a new pool.
+			 *
+			 * @param slab_size  Size of buffers in the pool, in bytes.
+			 * @param capacity   Maximum number of unused buffers to keep.
+			*/
+			static std::shared_ptr<BlockPool> create(size_t slab_size, size_t capacity);
+			
+			~BlockPool();
+			
+			/**
+			 * @brief Get a buffer from the pool.
+			 *
+			 * Returns a buffer resized to size bytes. The contents of the buffer
+			 * are undefined.
+			*/
+			std::shared_ptr< std::vector<unsigned char> > get(size_t size);
+			
+			/**
+			 * @brief Get the size of buffers in the pool.
+			*/
+			size_t get_slab_size() const;
+			
+			/**
+			 * @brief Get the maximum number of unused buffers to keep.
+			*/
+			size_t get_capacity() const;
+			
+			/**
+			 * @brief Set the maximum number of unused buffers to keep.
+			 *
+			 * Any unused buffers beyond the new capacity are freed.
+			*/
+			void set_capacity(size_t capacity);
+			
+			/**
+			 * @brief Get the usage statistics of the pool.
+			*/
+			Stats get_stats() const;
+		
+		private:
+			const size_t slab_size;
+			
+			mutable std::mutex lock;
+			size_t capacity;
+			std::vector< std::vector<unsigned char>* > free_slabs;
+			Stats stats;
+			
+			BlockPool(size_t slab_size, size_t capacity);
+			
+			void release(std::vector<unsigned char> *slab);
+	};
+}
+
+#endif /* !REHEX_BLOCKPOOL_HPP */
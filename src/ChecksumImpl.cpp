@@ -184,7 +184,7 @@ template<typename CRCType, uint16_t CRCWidth> std::string REHex::ChecksumGenerat
 	{
 		int pad_len = min_len - hex_len;
 		
-		memmove((hex + pad_len), hex, hex_len);
+		memmove((hex + pad_len), hex, (hex_len + 1));
 		memset(hex, '0', pad_len);
 	}
 	
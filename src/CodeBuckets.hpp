@@ -0,0 +1,277 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_CODEBUCKETS_HPP
+#define REHEX_CODEBUCKETS_HPP
+
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+#include "ByteRangeSet.hpp"
+#include "RangeProcessor.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Results of analysing the code in a Document in fixed size buckets.
+	 *
+	 * The document is split into buckets of bucket_size bytes which are each analysed
+	 * independently on background threads, and the result for each bucket is stored by
+	 * its base offset. This takes care of queueing work in whole buckets and working out
+	 * which buckets need analysing again when the data changes, the owner provides the
+	 * function to analyse a bucket.
+	 *
+	 * Buckets are disassembled starting RESYNC_LEAD bytes early, so that variable length
+	 * instruction sets are usually back in step with a linear disassembly by the time
+	 * the bucket is reached.
+	 *
+	 * T must be a container - buckets with an empty result aren't stored.
+	*/
+	template<typename T> class CodeBuckets
+	{
+		public:
+			/**
+			 * @brief Number of bytes before the start of a bucket to begin disassembling from.
+			*/
+			static const off_t RESYNC_LEAD = 64;
+			
+			/**
+			 * @brief Longest instruction we expect any architecture to have.
+			*/
+			static const off_t MAX_INSN_LEN = 16;
+			
+			/**
+			 * @brief Create an empty set of buckets.
+			 *
+			 * @param bucket_size     Size of each bucket, in bytes.
+			 * @param process_bucket  Function to analyse the bucket at the given offset into
+			 *                        an empty T, called from worker threads.
+			*/
+			CodeBuckets(off_t bucket_size, const std::function<void(off_t, T*)> &process_bucket);
+			
+			/**
+			 * @brief Stop the worker threads and destroy the buckets.
+			*/
+			~CodeBuckets();
+			
+			CodeBuckets(const CodeBuckets&) = delete;
+			CodeBuckets &operator=(const CodeBuckets&) = delete;
+			
+			/**
+			 * @brief Queue the buckets covering a range of the document for analysis.
+			*/
+			void queue_range(off_t offset, off_t length);
+			
+			/**
+			 * @brief Queue the buckets which may be affected by overwriting a range.
+			 *
+			 * An instruction starting a little before the range may include it, and the
+			 * bucket after may have started its lead-in within it.
+			*/
+			void queue_overwrite(off_t offset, off_t length);
+			
+			/**
+			 * @brief Discard the buckets moved by inserting or erasing data.
+			 *
+			 * Everything from offset onwards has moved. The buckets from that point are
+			 * thrown away and queued to be analysed again up to the new buffer_length,
+			 * along with any earlier buckets matching the optional stale predicate.
+			 *
+			 * The worker threads should be paused when this is called.
+			*/
+			void data_moved(off_t offset, off_t buffer_length, const std::function<bool(const T&)> &stale = nullptr);
+			
+			/**
+			 * @brief Get a counter which is incremented whenever the buckets change.
+			*/
+			unsigned int get_generation() const { return generation; }
+			
+			/**
+			 * @brief Call a function with the stored buckets.
+			 *
+			 * The function is passed a const reference to the map of buckets, which is
+			 * locked for the duration of the call.
+			*/
+			template<typename F> void with_buckets(const F &func) const
+			{
+				std::lock_guard<std::mutex> bl(buckets_lock);
+				
+				const std::map<off_t, T> &const_buckets = buckets;
+				func(const_buckets);
+			}
+			
+			/**
+			 * @brief Get the queued/processing ranges.
+			 * @see RangeProcessor::get_queue()
+			*/
+			ByteRangeSet get_queue() const { return rp->get_queue(); }
+			
+			/**
+			 * @see RangeProcessor::set_focus()
+			*/
+			void set_focus(const ByteRangeSet &focus) { rp->set_focus(focus); }
+			
+			/**
+			 * @see RangeProcessor::set_max_threads()
+			*/
+			void set_max_threads(unsigned int max_threads) { rp->set_max_threads(max_threads); }
+			
+			/**
+			 * @see RangeProcessor::pause_threads()
+			*/
+			void pause_threads() { rp->pause_threads(); }
+			
+			/**
+			 * @see RangeProcessor::resume_threads()
+			*/
+			void resume_threads() { rp->resume_threads(); }
+			
+			/**
+			 * @see RangeProcessor::wait_for_completion()
+			*/
+			void wait_for_completion() { rp->wait_for_completion(); }
+		
+		private:
+			const off_t bucket_size;
+			const std::function<void(off_t, T*)> process_bucket;
+			
+			std::map<off_t, T> buckets;
+			mutable std::mutex buckets_lock;
+			
+			std::atomic<unsigned int> generation;
+			
+			std::unique_ptr<RangeProcessor> rp;
+			
+			void process_range(off_t window_base, off_t window_size);
+	};
+}
+
+template<typename T> const off_t REHex::CodeBuckets<T>::RESYNC_LEAD;
+template<typename T> const off_t REHex::CodeBuckets<T>::MAX_INSN_LEN;
+
+template<typename T> REHex::CodeBuckets<T>::CodeBuckets(off_t bucket_size, const std::function<void(off_t, T*)> &process_bucket):
+	bucket_size(bucket_size),
+	process_bucket(process_bucket),
+	generation(0)
+{
+	rp.reset(new RangeProcessor([this](off_t window_base, off_t window_size) { process_range(window_base, window_size); }, bucket_size));
+}
+
+template<typename T> REHex::CodeBuckets<T>::~CodeBuckets()
+{
+	/* Stop the worker threads before anything they use is destroyed. */
+	rp.reset(NULL);
+}
+
+template<typename T> void REHex::CodeBuckets<T>::queue_range(off_t offset, off_t length)
+{
+	/* Work is always queued in whole buckets so the windows handed to process_range() by
+	 * the RangeProcessor line up with them.
+	*/
+	
+	if(offset < 0)
+	{
+		length += offset;
+		offset = 0;
+	}
+	
+	if(length <= 0)
+	{
+		return;
+	}
+	
+	off_t begin = offset - (offset % bucket_size);
+	off_t end = offset + length;
+	
+	if((end % bucket_size) != 0)
+	{
+		end += bucket_size - (end % bucket_size);
+	}
+	
+	rp->queue_range(begin, (end - begin));
+}
+
+template<typename T> void REHex::CodeBuckets<T>::queue_overwrite(off_t offset, off_t length)
+{
+	queue_range((offset - MAX_INSN_LEN), (length + MAX_INSN_LEN + RESYNC_LEAD));
+}
+
+template<typename T> void REHex::CodeBuckets<T>::data_moved(off_t offset, off_t buffer_length, const std::function<bool(const T&)> &stale)
+{
+	off_t first_moved_bucket = offset - (offset % bucket_size);
+	std::vector<off_t> stale_buckets;
+	
+	rp->unqueue_range(first_moved_bucket, (std::numeric_limits<off_t>::max() - first_moved_bucket));
+	
+	{
+		std::lock_guard<std::mutex> bl(buckets_lock);
+		
+		buckets.erase(buckets.lower_bound(first_moved_bucket), buckets.end());
+		
+		if(stale)
+		{
+			for(auto b = buckets.begin(); b != buckets.end(); ++b)
+			{
+				if(stale(b->second))
+				{
+					stale_buckets.push_back(b->first);
+				}
+			}
+		}
+	}
+	
+	++generation;
+	
+	for(auto b = stale_buckets.begin(); b != stale_buckets.end(); ++b)
+	{
+		queue_range(*b, bucket_size);
+	}
+	
+	queue_range(first_moved_bucket, (buffer_length - first_moved_bucket));
+}
+
+template<typename T> void REHex::CodeBuckets<T>::process_range(off_t window_base, off_t window_size)
+{
+	for(off_t bucket_base = window_base - (window_base % bucket_size); bucket_base < (window_base + window_size); bucket_base += bucket_size)
+	{
+		T result;
+		process_bucket(bucket_base, &result);
+		
+		{
+			std::lock_guard<std::mutex> bl(buckets_lock);
+			
+			if(result.empty())
+			{
+				buckets.erase(bucket_base);
+			}
+			else{
+				buckets[bucket_base] = std::move(result);
+			}
+		}
+		
+		++generation;
+	}
+}
+
+#endif /* !REHEX_CODEBUCKETS_HPP */
@@ -0,0 +1,547 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <limits>
+#include <map>
+#include <utility>
+
+#include "CodeReferenceIndex.hpp"
+#include "DisassemblyRegion.hpp"
+
+const off_t REHex::CodeReferenceIndex::BUCKET_SIZE;
+
+REHex::CodeReferenceIndex::CodeReferenceIndex(SharedDocumentPointer &document):
+	document(document)
+{
+	buckets.reset(new ReferenceBuckets(BUCKET_SIZE, [this](off_t bucket_base, std::vector<Reference> *refs)
+	{
+		process_bucket(*get_state(), bucket_base, refs);
+		
+		std::sort(refs->begin(), refs->end());
+		refs->erase(std::unique(refs->begin(), refs->end()), refs->end());
+		refs->shrink_to_fit();
+	}));
+	
+	this->document.auto_cleanup_bind(DATA_ERASE,     &REHex::CodeReferenceIndex::OnDataErase,     this);
+	this->document.auto_cleanup_bind(DATA_INSERT,    &REHex::CodeReferenceIndex::OnDataInsert,    this);
+	this->document.auto_cleanup_bind(DATA_OVERWRITE, &REHex::CodeReferenceIndex::OnDataOverwrite, this);
+	
+	this->document.auto_cleanup_bind(DATA_ERASING,        &REHex::CodeReferenceIndex::OnDataModifying,     this);
+	this->document.auto_cleanup_bind(DATA_ERASE_ABORTED,  &REHex::CodeReferenceIndex::OnDataModifyAborted, this);
+	this->document.auto_cleanup_bind(DATA_INSERTING,      &REHex::CodeReferenceIndex::OnDataModifying,     this);
+	this->document.auto_cleanup_bind(DATA_INSERT_ABORTED, &REHex::CodeReferenceIndex::OnDataModifyAborted, this);
+	
+	this->document.auto_cleanup_bind(EV_TYPES_CHANGED,    &REHex::CodeReferenceIndex::OnTypesChanged,    this);
+	this->document.auto_cleanup_bind(EV_MAPPINGS_CHANGED, &REHex::CodeReferenceIndex::OnMappingsChanged, this);
+	
+	refresh_state();
+}
+
+REHex::CodeReferenceIndex::~CodeReferenceIndex()
+{
+	/* Stop the worker threads before anything they use is destroyed. */
+	buckets.reset(NULL);
+}
+
+std::vector<REHex::CodeReferenceIndex::Reference> REHex::CodeReferenceIndex::find_references_to(off_t target) const
+{
+	std::vector<Reference> refs;
+	
+	/* Search key which sorts before any reference to target. */
+	const Reference key(std::numeric_limits<off_t>::min(), target, ReferenceType::JUMP);
+	
+	buckets->with_buckets([&](const std::map< off_t, std::vector<Reference> > &bucket_refs)
+	{
+		for(auto b = bucket_refs.begin(); b != bucket_refs.end(); ++b)
+		{
+			for(auto r = std::lower_bound(b->second.begin(), b->second.end(), key); r != b->second.end() && r->target == target; ++r)
+			{
+				refs.push_back(*r);
+			}
+		}
+	});
+	
+	/* Buckets are in source order and each bucket's references to the same target are sorted
+	 * by source, so the result is already sorted.
+	*/
+	
+	return refs;
+}
+
+size_t REHex::CodeReferenceIndex::get_num_references() const
+{
+	size_t total = 0;
+	
+	buckets->with_buckets([&](const std::map< off_t, std::vector<Reference> > &bucket_refs)
+	{
+		for(auto b = bucket_refs.begin(); b != bucket_refs.end(); ++b)
+		{
+			total += b->second.size();
+		}
+	});
+	
+	return total;
+}
+
+off_t REHex::CodeReferenceIndex::get_code_bytes() const
+{
+	std::shared_ptr<const AnalysisState> state = get_state();
+	
+	off_t total = 0;
+	for(auto s = state->segments.begin(); s != state->segments.end(); ++s)
+	{
+		total += s->length;
+	}
+	
+	return total;
+}
+
+void REHex::CodeReferenceIndex::set_focus(const ByteRangeSet &focus)
+{
+	buckets->set_focus(focus);
+}
+
+off_t REHex::CodeReferenceIndex::get_pending_bytes() const
+{
+	std::shared_ptr<const AnalysisState> state = get_state();
+	
+	ByteRangeSet code;
+	for(auto s = state->segments.begin(); s != state->segments.end(); ++s)
+	{
+		code.set_range(s->offset, s->length);
+	}
+	
+	/* The queue is rounded out to whole buckets, only count the code within it. */
+	return ByteRangeSet::intersection(code, buckets->get_queue()).total_bytes();
+}
+
+unsigned int REHex::CodeReferenceIndex::get_generation() const
+{
+	return buckets->get_generation();
+}
+
+void REHex::CodeReferenceIndex::wait_for_completion()
+{
+	buckets->wait_for_completion();
+}
+
+off_t REHex::CodeReferenceIndex::AnalysisState::addr_to_offset(const CodeSegment &segment, uint64_t addr) const
+{
+	if(addr > (uint64_t)(std::numeric_limits<off_t>::max()))
+	{
+		return -1;
+	}
+	
+	if(!segment.mapped)
+	{
+		return (off_t)(addr) < buffer_length ? (off_t)(addr) : -1;
+	}
+	
+	/* Find the last mapping which starts at or before addr. */
+	auto m = std::upper_bound(mappings.begin(), mappings.end(), (off_t)(addr),
+		[](off_t addr, const VirtMapping &mapping) { return addr < mapping.virt_offset; });
+	
+	if(m == mappings.begin())
+	{
+		return -1;
+	}
+	
+	--m;
+	
+	if((off_t)(addr) >= (m->virt_offset + m->length))
+	{
+		return -1;
+	}
+	
+	return m->real_offset + ((off_t)(addr) - m->virt_offset);
+}
+
+std::shared_ptr<const REHex::CodeReferenceIndex::AnalysisState> REHex::CodeReferenceIndex::get_state() const
+{
+	std::lock_guard<std::mutex> sl(state_lock);
+	return state;
+}
+
+void REHex::CodeReferenceIndex::refresh_state()
+{
+	std::shared_ptr<AnalysisState> new_state = std::make_shared<AnalysisState>();
+	new_state->buffer_length = document->buffer_length();
+	
+	const ByteRangeMap<off_t> &virt_to_real = document->get_virt_to_real_segs();
+	for(auto m = virt_to_real.begin(); m != virt_to_real.end(); ++m)
+	{
+		new_state->mappings.push_back(VirtMapping{ m->first.offset, m->first.length, m->second });
+	}
+	
+	const ByteRangeMap<off_t> &real_to_virt = document->get_real_to_virt_segs();
+	const BitRangeMap<Document::TypeInfo> &types = document->get_data_types();
+	
+	for(auto t = types.begin(); t != types.end(); ++t)
+	{
+		const std::string &type_name = t->second.name;
+		
+		if(type_name.compare(0, 5, "code:") != 0 || !t->first.offset.byte_aligned() || !t->first.length.byte_aligned())
+		{
+			continue;
+		}
+		
+		const CSArchitecture *arch = find_architecture(type_name.substr(5));
+		if(arch == NULL || !cs_support(arch->arch))
+		{
+			continue;
+		}
+		
+		/* Split the range wherever the virtual address mapping changes, since the
+		 * addresses used by the code depend on where it is mapped.
+		*/
+		
+		off_t offset = t->first.offset.byte();
+		off_t end = offset + t->first.length.byte();
+		
+		while(offset < end)
+		{
+			auto m = real_to_virt.get_range_in(offset, (end - offset));
+			
+			if(m == real_to_virt.end())
+			{
+				new_state->segments.emplace_back(offset, (end - offset), offset, false, arch->arch, arch->mode);
+				break;
+			}
+			
+			if(m->first.offset > offset)
+			{
+				new_state->segments.emplace_back(offset, (m->first.offset - offset), offset, false, arch->arch, arch->mode);
+				offset = m->first.offset;
+			}
+			
+			off_t seg_end = std::min(end, (m->first.offset + m->first.length));
+			off_t seg_virt = m->second + (offset - m->first.offset);
+			
+			new_state->segments.emplace_back(offset, (seg_end - offset), seg_virt, true, arch->arch, arch->mode);
+			offset = seg_end;
+		}
+	}
+	
+	std::shared_ptr<const AnalysisState> old_state;
+	
+	{
+		std::lock_guard<std::mutex> sl(state_lock);
+		
+		old_state = state;
+		state = new_state;
+	}
+	
+	/* Work out which ranges need (re)analysing. Changing the mappings may change the
+	 * target of any reference, so everything must be redone in that case.
+	*/
+	
+	ByteRangeSet changed;
+	
+	if(!old_state || old_state->mappings != new_state->mappings)
+	{
+		for(auto s = new_state->segments.begin(); s != new_state->segments.end(); ++s)
+		{
+			changed.set_range(s->offset, s->length);
+		}
+	}
+	else{
+		for(auto s = new_state->segments.begin(); s != new_state->segments.end(); ++s)
+		{
+			if(std::find(old_state->segments.begin(), old_state->segments.end(), *s) == old_state->segments.end())
+			{
+				changed.set_range(s->offset, s->length);
+			}
+		}
+	}
+	
+	if(old_state)
+	{
+		/* Any buckets covering code which has gone need clearing out. */
+		
+		for(auto s = old_state->segments.begin(); s != old_state->segments.end(); ++s)
+		{
+			if(std::find(new_state->segments.begin(), new_state->segments.end(), *s) == new_state->segments.end())
+			{
+				changed.set_range(s->offset, s->length);
+			}
+		}
+	}
+	
+	for(auto r = changed.begin(); r != changed.end(); ++r)
+	{
+		buckets->queue_range(r->offset, r->length);
+	}
+}
+
+static void collect_targets(csh disassembler, cs_arch arch, const cs_insn *insn, std::vector< std::pair<uint64_t, REHex::CodeReferenceIndex::ReferenceType> > *targets)
+{
+	typedef REHex::CodeReferenceIndex::ReferenceType ReferenceType;
+	
+	bool is_call = cs_insn_group(disassembler, insn, CS_GRP_CALL);
+	bool is_jump = cs_insn_group(disassembler, insn, CS_GRP_JUMP);
+	
+	bool is_branch = is_call || is_jump;
+	ReferenceType branch_type = is_call ? ReferenceType::CALL : ReferenceType::JUMP;
+	
+	const cs_detail *detail = insn->detail;
+	
+	switch(arch)
+	{
+		case CS_ARCH_X86:
+			for(uint8_t i = 0; i < detail->x86.op_count; ++i)
+			{
+				const cs_x86_op &op = detail->x86.operands[i];
+				
+				if(op.type == X86_OP_IMM && is_branch)
+				{
+					targets->push_back(std::make_pair((uint64_t)(op.imm), branch_type));
+				}
+				else if(op.type == X86_OP_MEM && op.mem.index == X86_REG_INVALID)
+				{
+					if(op.mem.base == X86_REG_RIP)
+					{
+						targets->push_back(std::make_pair((uint64_t)(insn->address + insn->size + op.mem.disp), ReferenceType::DATA));
+					}
+					else if(op.mem.base == X86_REG_INVALID && op.mem.segment == X86_REG_INVALID && op.mem.disp != 0)
+					{
+						targets->push_back(std::make_pair((uint64_t)(op.mem.disp), ReferenceType::DATA));
+					}
+				}
+			}
+			
+			break;
+		
+		case CS_ARCH_ARM:
+			for(uint8_t i = 0; i < detail->arm.op_count; ++i)
+			{
+				if(detail->arm.operands[i].type == ARM_OP_IMM && is_branch)
+				{
+					targets->push_back(std::make_pair((uint64_t)(uint32_t)(detail->arm.operands[i].imm), branch_type));
+				}
+			}
+			
+			break;
+		
+		case CS_ARCH_ARM64:
+		{
+			bool is_adr = insn->id == ARM64_INS_ADR || insn->id == ARM64_INS_ADRP;
+			
+			for(uint8_t i = 0; i < detail->arm64.op_count; ++i)
+			{
+				if(detail->arm64.operands[i].type == ARM64_OP_IMM && (is_branch || is_adr))
+				{
+					targets->push_back(std::make_pair((uint64_t)(detail->arm64.operands[i].imm), (is_adr ? ReferenceType::DATA : branch_type)));
+				}
+			}
+			
+			break;
+		}
+		
+		case CS_ARCH_MIPS:
+			for(uint8_t i = 0; i < detail->mips.op_count; ++i)
+			{
+				if(detail->mips.operands[i].type == MIPS_OP_IMM && is_branch)
+				{
+					targets->push_back(std::make_pair((uint64_t)(detail->mips.operands[i].imm), branch_type));
+				}
+			}
+			
+			break;
+		
+		case CS_ARCH_PPC:
+			for(uint8_t i = 0; i < detail->ppc.op_count; ++i)
+			{
+				if(detail->ppc.operands[i].type == PPC_OP_IMM && is_branch)
+				{
+					targets->push_back(std::make_pair((uint64_t)(detail->ppc.operands[i].imm), branch_type));
+				}
+			}
+			
+			break;
+		
+		case CS_ARCH_SPARC:
+			for(uint8_t i = 0; i < detail->sparc.op_count; ++i)
+			{
+				if(detail->sparc.operands[i].type == SPARC_OP_IMM && is_branch)
+				{
+					targets->push_back(std::make_pair((uint64_t)(detail->sparc.operands[i].imm), branch_type));
+				}
+			}
+			
+			break;
+		
+		default:
+			/* No operand decoding for this architecture (yet). */
+			break;
+	}
+}
+
+void REHex::CodeReferenceIndex::process_bucket(const AnalysisState &state, off_t bucket_base, std::vector<Reference> *refs)
+{
+	off_t bucket_end = bucket_base + BUCKET_SIZE;
+	
+	std::vector< std::pair<uint64_t, ReferenceType> > targets;
+	
+	for(auto s = state.segments.begin(); s != state.segments.end(); ++s)
+	{
+		off_t seg_end = s->offset + s->length;
+		
+		if(seg_end <= bucket_base || s->offset >= bucket_end)
+		{
+			continue;
+		}
+		
+		/* Instructions starting within the bucket are recorded, but we start a little
+		 * earlier and read a little further so that the instruction boundaries are right
+		 * and any instruction straddling the end of the bucket is decoded.
+		*/
+		
+		off_t decode_base = std::max(s->offset, (bucket_base - ReferenceBuckets::RESYNC_LEAD));
+		off_t decode_end = std::min(seg_end, (bucket_end + ReferenceBuckets::MAX_INSN_LEN));
+		
+		std::vector<unsigned char> data;
+		try {
+			data = document->read_data(decode_base, (decode_end - decode_base));
+		}
+		catch(const std::exception &e)
+		{
+			/* Document has probably been truncated under us, it will be requeued. */
+			continue;
+		}
+		
+		csh disassembler;
+		if(cs_open(s->arch, s->mode, &disassembler) != CS_ERR_OK)
+		{
+			continue;
+		}
+		
+		cs_option(disassembler, CS_OPT_DETAIL, CS_OPT_ON);
+		cs_option(disassembler, CS_OPT_SKIPDATA, CS_OPT_ON);
+		
+		const uint8_t *code = data.data();
+		size_t code_size = data.size();
+		uint64_t address = s->virt_offset + (decode_base - s->offset);
+		cs_insn *insn = cs_malloc(disassembler);
+		
+		/* NOTE: @code, @code_size & @address variables are all updated! */
+		while(cs_disasm_iter(disassembler, &code, &code_size, &address, insn))
+		{
+			off_t insn_offset = s->offset + (off_t)(insn->address - s->virt_offset);
+			
+			if(insn_offset >= bucket_end)
+			{
+				break;
+			}
+			
+			if(insn_offset < bucket_base || insn->detail == NULL || insn->id == 0)
+			{
+				/* Lead-in or data skipped over by Capstone. */
+				continue;
+			}
+			
+			targets.clear();
+			collect_targets(disassembler, s->arch, insn, &targets);
+			
+			for(auto t = targets.begin(); t != targets.end(); ++t)
+			{
+				off_t target_offset = state.addr_to_offset(*s, t->first);
+				if(target_offset >= 0)
+				{
+					refs->emplace_back(insn_offset, target_offset, t->second);
+				}
+			}
+		}
+		
+		cs_free(insn, 1);
+		cs_close(&disassembler);
+	}
+}
+
+void REHex::CodeReferenceIndex::OnDataModifying(OffsetLengthEvent &event)
+{
+	buckets->pause_threads();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::CodeReferenceIndex::OnDataModifyAborted(OffsetLengthEvent &event)
+{
+	buckets->resume_threads();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::CodeReferenceIndex::OnDataErase(OffsetLengthEvent &event)
+{
+	data_moved(event.offset);
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::CodeReferenceIndex::OnDataInsert(OffsetLengthEvent &event)
+{
+	data_moved(event.offset);
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::CodeReferenceIndex::data_moved(off_t offset)
+{
+	refresh_state();
+	
+	/* Any earlier buckets which reference the moved data need analysing again too. */
+	
+	buckets->data_moved(offset, document->buffer_length(), [offset](const std::vector<Reference> &refs)
+	{
+		/* References within a bucket are sorted by target. */
+		return refs.back().target >= offset;
+	});
+	
+	buckets->resume_threads();
+}
+
+void REHex::CodeReferenceIndex::OnDataOverwrite(OffsetLengthEvent &event)
+{
+	buckets->queue_overwrite(event.offset, event.length);
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::CodeReferenceIndex::OnTypesChanged(wxCommandEvent &event)
+{
+	refresh_state();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::CodeReferenceIndex::OnMappingsChanged(wxCommandEvent &event)
+{
+	refresh_state();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
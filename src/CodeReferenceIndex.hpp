@@ -0,0 +1,218 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_CODEREFERENCEINDEX_HPP
+#define REHEX_CODEREFERENCEINDEX_HPP
+
+#include <capstone/capstone.h>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <tuple>
+#include <vector>
+#include <wx/event.h>
+
+#include "ByteRangeSet.hpp"
+#include "CodeBuckets.hpp"
+#include "document.hpp"
+#include "Events.hpp"
+#include "SharedDocumentPointer.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Index of branch targets and memory references made by code in a Document.
+	 *
+	 * Any ranges of the document with a "code:<triple>" data type are disassembled on
+	 * background threads with Capstone's detail mode enabled, and every jump, call and
+	 * memory reference which can be resolved to an offset within the file is recorded.
+	 *
+	 * The index is split into fixed size buckets by the offset of the referencing
+	 * instruction, and each bucket is sorted by target offset, so finding all references
+	 * to an offset is a binary search per bucket. Changes to the data, data types or
+	 * virtual address mappings only re-analyse the affected buckets.
+	 *
+	 * Each bucket is disassembled independently, starting a little before the bucket so
+	 * that variable length instruction sets are usually back in step with a linear
+	 * disassembly by the time the bucket is reached.
+	*/
+	class CodeReferenceIndex: public wxEvtHandler
+	{
+		public:
+			enum class ReferenceType: unsigned char
+			{
+				JUMP,  /**< Branch to target. */
+				CALL,  /**< Call to target. */
+				DATA,  /**< Memory read/write or address calculation. */
+			};
+			
+			/**
+			 * @brief A reference from an instruction to an offset in the file.
+			*/
+			struct Reference
+			{
+				off_t source;  /**< File offset of the referencing instruction. */
+				off_t target;  /**< File offset being referenced. */
+				ReferenceType type;
+				
+				Reference(off_t source, off_t target, ReferenceType type):
+					source(source), target(target), type(type) {}
+				
+				bool operator<(const Reference &rhs) const
+				{
+					return std::tie(target, source) < std::tie(rhs.target, rhs.source);
+				}
+				
+				bool operator==(const Reference &rhs) const
+				{
+					return source == rhs.source && target == rhs.target && type == rhs.type;
+				}
+			};
+			
+			/**
+			 * @brief Size of each bucket in the index, in bytes of code.
+			*/
+			static const off_t BUCKET_SIZE = 256 * 1024;
+			
+			CodeReferenceIndex(SharedDocumentPointer &document);
+			virtual ~CodeReferenceIndex();
+			
+			/**
+			 * @brief Find all known references to an offset in the file.
+			 *
+			 * Returns references sorted by source offset. The result may be incomplete
+			 * if analysis is still in progress.
+			*/
+			std::vector<Reference> find_references_to(off_t target) const;
+			
+			/**
+			 * @brief Get the total number of references in the index.
+			*/
+			size_t get_num_references() const;
+			
+			/**
+			 * @brief Get the number of bytes of code in the document.
+			*/
+			off_t get_code_bytes() const;
+			
+			/**
+			 * @brief Get the number of bytes of code waiting to be analysed.
+			*/
+			off_t get_pending_bytes() const;
+			
+			/**
+			 * @brief Get a counter which is incremented whenever the index changes.
+			*/
+			unsigned int get_generation() const;
+			
+			/**
+			 * @brief Set the ranges of the file to analyse first.
+			 *
+			 * @see RangeProcessor::set_focus()
+			*/
+			void set_focus(const ByteRangeSet &focus);
+			
+			/**
+			 * @brief Wait for all queued analysis to finish.
+			 *
+			 * This is mostly intended for unit tests. This should not be used from the
+			 * application UI thread.
+			*/
+			void wait_for_completion();
+		
+		private:
+			/**
+			 * @brief A contiguous range of code with the same architecture and mapping.
+			*/
+			struct CodeSegment
+			{
+				off_t offset;       /**< File offset of segment. */
+				off_t length;       /**< Length of segment. */
+				off_t virt_offset;  /**< Address of the first instruction in the segment. */
+				bool mapped;        /**< True if virt_offset is from a virtual address mapping. */
+				
+				cs_arch arch;
+				cs_mode mode;
+				
+				CodeSegment(off_t offset, off_t length, off_t virt_offset, bool mapped, cs_arch arch, cs_mode mode):
+					offset(offset), length(length), virt_offset(virt_offset), mapped(mapped), arch(arch), mode(mode) {}
+				
+				bool operator==(const CodeSegment &rhs) const
+				{
+					return offset == rhs.offset && length == rhs.length && virt_offset == rhs.virt_offset
+						&& mapped == rhs.mapped && arch == rhs.arch && mode == rhs.mode;
+				}
+			};
+			
+			/**
+			 * @brief A virtual address mapping, sorted by virt_offset.
+			*/
+			struct VirtMapping
+			{
+				off_t virt_offset;
+				off_t length;
+				off_t real_offset;
+				
+				bool operator==(const VirtMapping &rhs) const
+				{
+					return virt_offset == rhs.virt_offset && length == rhs.length && real_offset == rhs.real_offset;
+				}
+			};
+			
+			/**
+			 * @brief Snapshot of document state needed by worker threads.
+			*/
+			struct AnalysisState
+			{
+				std::vector<CodeSegment> segments;  /**< Code segments, sorted by offset. */
+				std::vector<VirtMapping> mappings;  /**< Virtual address mappings, sorted by virt_offset. */
+				off_t buffer_length;
+				
+				/**
+				 * @brief Translate an address referenced from a segment to a file offset.
+				 * @returns File offset, negative if the address isn't within the file.
+				*/
+				off_t addr_to_offset(const CodeSegment &segment, uint64_t addr) const;
+			};
+			
+			SharedDocumentPointer document;
+			
+			std::shared_ptr<const AnalysisState> state;
+			mutable std::mutex state_lock;
+			
+			typedef CodeBuckets< std::vector<Reference> > ReferenceBuckets;
+			
+			/* References made by the instructions in each bucket, sorted by target. */
+			std::unique_ptr<ReferenceBuckets> buckets;
+			
+			std::shared_ptr<const AnalysisState> get_state() const;
+			void refresh_state();
+			
+			void process_bucket(const AnalysisState &state, off_t bucket_base, std::vector<Reference> *refs);
+			void data_moved(off_t offset);
+			
+			void OnDataModifying(OffsetLengthEvent &event);
+			void OnDataModifyAborted(OffsetLengthEvent &event);
+			void OnDataErase(OffsetLengthEvent &event);
+			void OnDataInsert(OffsetLengthEvent &event);
+			void OnDataOverwrite(OffsetLengthEvent &event);
+			void OnTypesChanged(wxCommandEvent &event);
+			void OnMappingsChanged(wxCommandEvent &event);
+	};
+}
+
+#endif /* !REHEX_CODEREFERENCEINDEX_HPP */
@@ -0,0 +1,206 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <assert.h>
+#include <wx/numformatter.h>
+#include <wx/sizer.h>
+
+#include "CodeReferencesPanel.hpp"
+#include "util.hpp"
+
+static REHex::ToolPanel *CodeReferencesPanel_factory(wxWindow *parent, REHex::SharedDocumentPointer &document, REHex::DocumentCtrl *document_ctrl)
+{
+	return new REHex::CodeReferencesPanel(parent, document, document_ctrl);
+}
+
+static REHex::ToolPanelRegistration tpr("CodeReferencesPanel", "References to here", REHex::ToolPanel::TPS_TALL, &CodeReferencesPanel_factory);
+
+BEGIN_EVENT_TABLE(REHex::CodeReferencesPanel, wxPanel)
+	EVT_TIMER(wxID_ANY, REHex::CodeReferencesPanel::OnTimerTick)
+	EVT_LIST_ITEM_ACTIVATED(wxID_ANY, REHex::CodeReferencesPanel::OnItemActivate)
+END_EVENT_TABLE()
+
+REHex::CodeReferencesPanel::CodeReferencesPanel(wxWindow *parent, SharedDocumentPointer &document, DocumentCtrl *document_ctrl):
+	ToolPanel(parent),
+	document(document),
+	document_ctrl(document_ctrl),
+	index(document),
+	timer(this, wxID_ANY),
+	shown_generation(0)
+{
+	const int MARGIN = 4;
+	
+	status_text = new wxStaticText(this, wxID_ANY, "");
+	
+	list_ctrl = new wxListCtrl(this, wxID_ANY, wxDefaultPosition, wxDefaultSize, (wxLC_REPORT | wxLC_SINGLE_SEL));
+	list_ctrl->AppendColumn("Offset");
+	list_ctrl->AppendColumn("Type");
+	
+	wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
+	sizer->Add(status_text, 0, (wxEXPAND | wxLEFT | wxRIGHT | wxTOP), MARGIN);
+	sizer->Add(list_ctrl, 1, (wxEXPAND | wxALL), MARGIN);
+	SetSizerAndFit(sizer);
+	
+	this->document.auto_cleanup_bind(CURSOR_UPDATE, &REHex::CodeReferencesPanel::OnCursorUpdate, this);
+	this->document_ctrl.auto_cleanup_bind(EV_DISP_SETTING_CHANGED, &REHex::CodeReferencesPanel::OnBaseChanged, this);
+	
+	/* The index is built in the background, poll it for changes so that the list fills in
+	 * as the analysis progresses.
+	*/
+	timer.Start(250, wxTIMER_CONTINUOUS);
+	
+	update();
+}
+
+REHex::CodeReferencesPanel::~CodeReferencesPanel()
+{
+	timer.Stop();
+}
+
+std::string REHex::CodeReferencesPanel::name() const
+{
+	return "CodeReferencesPanel";
+}
+
+void REHex::CodeReferencesPanel::save_state(wxConfig *config) const
+{
+	/* No state to save. */
+}
+
+void REHex::CodeReferencesPanel::load_state(wxConfig *config)
+{
+	/* No state to load. */
+}
+
+wxSize REHex::CodeReferencesPanel::DoGetBestClientSize() const
+{
+	return wxSize(200, -1);
+}
+
+void REHex::CodeReferencesPanel::update()
+{
+	if (!is_visible)
+	{
+		/* There is no sense in updating this if we are not visible */
+		return;
+	}
+	
+	shown_generation = index.get_generation();
+	
+	off_t cursor_pos = document->get_cursor_position().byte();
+	references = index.find_references_to(cursor_pos);
+	
+	OffsetBase offset_base = document_ctrl->get_offset_display_base();
+	off_t buffer_length = document->buffer_length();
+	
+	list_ctrl->Freeze();
+	list_ctrl->DeleteAllItems();
+	
+	for(size_t i = 0; i < references.size(); ++i)
+	{
+		const CodeReferenceIndex::Reference &ref = references[i];
+		
+		long item_idx = list_ctrl->InsertItem(i, format_offset(ref.source, offset_base, buffer_length));
+		
+		switch(ref.type)
+		{
+			case CodeReferenceIndex::ReferenceType::JUMP:
+				list_ctrl->SetItem(item_idx, 1, "Jump");
+				break;
+			
+			case CodeReferenceIndex::ReferenceType::CALL:
+				list_ctrl->SetItem(item_idx, 1, "Call");
+				break;
+			
+			case CodeReferenceIndex::ReferenceType::DATA:
+				list_ctrl->SetItem(item_idx, 1, "Data");
+				break;
+		}
+	}
+	
+	list_ctrl->Thaw();
+	
+	off_t code_bytes = index.get_code_bytes();
+	
+	wxString status;
+	
+	if(code_bytes == 0)
+	{
+		status = "No code in file. Set a machine code data type to analyse it.";
+	}
+	else{
+		status = wxNumberFormatter::ToString((long)(references.size())) + " references to "
+			+ format_offset(cursor_pos, offset_base, buffer_length);
+		
+		off_t pending_bytes = index.get_pending_bytes();
+		if(pending_bytes > 0)
+		{
+			int percent = 100 - (int)(((double)(pending_bytes) / (double)(code_bytes)) * 100.0);
+			status += "\nAnalysing code (" + std::to_string(percent) + "%)...";
+		}
+	}
+	
+	status_text->SetLabel(status);
+}
+
+void REHex::CodeReferencesPanel::OnCursorUpdate(CursorUpdateEvent &event)
+{
+	update();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::CodeReferencesPanel::OnBaseChanged(wxCommandEvent &event)
+{
+	update();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::CodeReferencesPanel::OnTimerTick(wxTimerEvent &event)
+{
+	/* Analyse the code on screen and around the cursor first, references from it are
+	 * the most likely to be looked at.
+	*/
+	
+	ByteRangeSet focus = document_ctrl->get_visible_data();
+	focus.set_range(document->get_cursor_position().byte(), 1);
+	
+	index.set_focus(focus);
+	
+	if(index.get_generation() != shown_generation)
+	{
+		update();
+	}
+}
+
+void REHex::CodeReferencesPanel::OnItemActivate(wxListEvent &event)
+{
+	long item_idx = event.GetIndex();
+	assert(item_idx >= 0);
+	
+	if((size_t)(item_idx) >= references.size())
+	{
+		return;
+	}
+	
+	document->set_cursor_position(BitOffset(references[item_idx].source, 0));
+}
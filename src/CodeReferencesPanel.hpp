@@ -0,0 +1,74 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_CODEREFERENCESPANEL_HPP
+#define REHEX_CODEREFERENCESPANEL_HPP
+
+#include <vector>
+#include <wx/listctrl.h>
+#include <wx/stattext.h>
+#include <wx/timer.h>
+
+#include "CodeReferenceIndex.hpp"
+#include "DocumentCtrl.hpp"
+#include "Events.hpp"
+#include "SafeWindowPointer.hpp"
+#include "SharedDocumentPointer.hpp"
+#include "ToolPanel.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Tool panel listing instructions which reference the cursor position.
+	*/
+	class CodeReferencesPanel: public ToolPanel
+	{
+		public:
+			CodeReferencesPanel(wxWindow *parent, SharedDocumentPointer &document, DocumentCtrl *document_ctrl);
+			~CodeReferencesPanel();
+			
+			virtual std::string name() const override;
+			
+			virtual void save_state(wxConfig *config) const override;
+			virtual void load_state(wxConfig *config) override;
+			virtual void update() override;
+			
+			virtual wxSize DoGetBestClientSize() const override;
+		
+		private:
+			SharedDocumentPointer document;
+			SafeWindowPointer<DocumentCtrl> document_ctrl;
+			
+			CodeReferenceIndex index;
+			
+			wxStaticText *status_text;
+			wxListCtrl *list_ctrl;
+			wxTimer timer;
+			
+			std::vector<CodeReferenceIndex::Reference> references;
+			unsigned int shown_generation;
+			
+			void OnCursorUpdate(CursorUpdateEvent &event);
+			void OnBaseChanged(wxCommandEvent &event);
+			void OnTimerTick(wxTimerEvent &event);
+			void OnItemActivate(wxListEvent &event);
+		
+		DECLARE_EVENT_TABLE()
+	};
+}
+
+#endif /* !REHEX_CODEREFERENCESPANEL_HPP */
@@ -24,7 +24,25 @@
 
 REHex::ConsoleBuffer::ConsoleBuffer(size_t total_text_max):
 	total_text_max(total_text_max),
-	total_text(0) {}
+	total_text(0),
+	erasable_messages(0),
+	flush_pending(false)
+{
+	QueueNode *stub = new QueueNode(false, Level::DEBUG, "");
+	
+	queue_head = stub;
+	queue_tail = stub;
+}
+
+REHex::ConsoleBuffer::~ConsoleBuffer()
+{
+	for(QueueNode *node = queue_tail; node != NULL;)
+	{
+		QueueNode *next = node->next.load();
+		delete node;
+		node = next;
+	}
+}
 
 const std::list<REHex::ConsoleBuffer::Message> &REHex::ConsoleBuffer::get_messages() const
 {
@@ -43,6 +61,36 @@ std::string REHex::ConsoleBuffer::get_messages_text() const
 		all_text += m->text;
 	}
 	
+	/* Nodes are only freed by flush() while holding lock, so we can safely walk the queued
+	 * nodes which haven't been consumed yet.
+	*/
+	
+	for(const QueueNode *node = queue_tail->next.load(std::memory_order_acquire); node != NULL; node = node->next.load(std::memory_order_acquire))
+	{
+		if(node->clear)
+		{
+			all_text.clear();
+		}
+		else{
+			all_text += node->text;
+		}
+	}
+	
+	return all_text;
+}
+
+std::string REHex::ConsoleBuffer::get_flushed_text() const
+{
+	std::lock_guard<std::mutex> l(lock);
+	
+	std::string all_text;
+	all_text.reserve(total_text);
+	
+	for(auto m = messages.begin(); m != messages.end(); ++m)
+	{
+		all_text += m->text;
+	}
+	
 	return all_text;
 }
 
@@ -54,66 +102,7 @@ void REHex::ConsoleBuffer::print(Level level, const std::string &text)
 		return;
 	}
 	
-	std::lock_guard<std::mutex> l(lock);
-	
-	if((total_text + text.length()) > total_text_max)
-	{
-		/* We don't want to erase to the middle of a line, so erase sequences of messages
-		 * up to the first one with a terminating newline until we have enough to keep the
-		 * buffer under the size limit, or there are none left.
-		*/
-		
-		auto erase_end = messages.begin();
-		size_t erase_total = 0;
-		
-		while(erase_end != messages.end() && erase_total < text.length())
-		{
-			auto line_end = erase_end;
-			size_t line_total = 0;
-			
-			while(line_end != messages.end())
-			{
-				line_total += line_end->text.length();
-				
-				if(line_end->text.back() == '\n')
-				{
-					break;
-				}
-				
-				++line_end;
-			}
-			
-			if(line_end != messages.end())
-			{
-				/* Found a message with a terminating newline, add it and any
-				 * preceeding ones to the range to be erased.
-				*/
-				erase_end = std::next(line_end);
-				erase_total += line_total;
-			}
-			else{
-				/* No more messages with terminating newlines, stop. */
-				break;
-			}
-		}
-		
-		if(erase_total > 0)
-		{
-			/* Erase the messages and raise a CONSOLE_ERASE event. */
-			
-			messages.erase(messages.begin(), erase_end);
-			total_text -= erase_total;
-			
-			ConsoleEraseEvent *event = new ConsoleEraseEvent(this, erase_total);
-			QueueEvent(event); /* Takes ownership of event. */
-		}
-	}
-	
-	messages.push_back(Message(level, text));
-	total_text += text.length();
-	
-	ConsolePrintEvent *event = new ConsolePrintEvent(this, level, text);
-	QueueEvent(event); /* Takes ownership of event. */
+	push(new QueueNode(false, level, text));
 }
 
 void REHex::ConsoleBuffer::printf(Level level, const char *fmt, ...)
@@ -142,23 +131,149 @@ void REHex::ConsoleBuffer::vprintf(Level level, const char *fmt, va_list argv)
 
 void REHex::ConsoleBuffer::clear()
 {
-	std::lock_guard<std::mutex> l(lock);
+	push(new QueueNode(true, Level::DEBUG, ""));
+}
+
+void REHex::ConsoleBuffer::push(QueueNode *node)
+{
+	QueueNode *prev = queue_head.exchange(node, std::memory_order_acq_rel);
+	prev->next.store(node, std::memory_order_release);
+	
+	/* Schedule a flush in the UI thread if one isn't already pending. Only one event is
+	 * posted for any number of messages queued before the flush runs.
+	*/
 	
-	if(total_text == 0)
+	if(!flush_pending.exchange(true))
 	{
-		/* Don't raise zero-length CONSOLE_ERASE events. */
-		return;
+		CallAfter(&REHex::ConsoleBuffer::flush);
+	}
+}
+
+void REHex::ConsoleBuffer::flush()
+{
+	std::vector< std::unique_ptr<wxEvent> > events;
+	
+	{
+		std::lock_guard<std::mutex> l(lock);
+		
+		/* Clear the flag before draining the queue, so anything pushed after we stop
+		 * draining will schedule another flush.
+		*/
+		flush_pending.store(false);
+		
+		/* Number of characters which consumers have seen and need to erase due to a
+		 * clear() call within this batch.
+		*/
+		size_t batch_start_text = total_text;
+		size_t cleared_text = 0;
+		
+		while(true)
+		{
+			QueueNode *next = queue_tail->next.load(std::memory_order_acquire);
+			if(next == NULL)
+			{
+				/* Queue is empty, or a producer hasn't finished linking its node
+				 * yet, in which case it will schedule another flush.
+				*/
+				break;
+			}
+			
+			delete queue_tail;
+			queue_tail = next;
+			
+			if(next->clear)
+			{
+				/* Any events from earlier in this batch haven't been seen by any
+				 * consumers yet, so throw them away and erase what was in the
+				 * buffer before this batch.
+				*/
+				
+				events.clear();
+				cleared_text = batch_start_text;
+				
+				messages.clear();
+				total_text = 0;
+				erasable_messages = 0;
+			}
+			else{
+				if(cleared_text > 0)
+				{
+					events.emplace_back(new ConsoleEraseEvent(this, cleared_text));
+					cleared_text = 0;
+				}
+				
+				append_message(next->level, next->text, &events);
+				
+				/* Release the text now rather than holding onto it until the node
+				 * is freed by the next flush.
+				*/
+				std::string().swap(next->text);
+			}
+		}
+		
+		if(cleared_text > 0)
+		{
+			events.emplace_back(new ConsoleEraseEvent(this, cleared_text));
+		}
 	}
 	
-	size_t old_total_text = total_text;
+	/* Dispatch events outside of the lock so handlers can read from the buffer. */
 	
-	messages.clear();
-	total_text = 0;
+	for(auto e = events.begin(); e != events.end(); ++e)
+	{
+		ProcessEvent(**e);
+	}
+}
+
+void REHex::ConsoleBuffer::append_message(Level level, const std::string &text, std::vector< std::unique_ptr<wxEvent> > *events)
+{
+	if((total_text + text.length()) > total_text_max)
+	{
+		/* We don't want to erase to the middle of a line, so erase sequences of messages
+		 * up to the first one with a terminating newline until we have enough to keep the
+		 * buffer under the size limit, or there are none left.
+		 *
+		 * Every message is erased at most once, so this is constant time per message.
+		*/
+		
+		size_t erase_total = 0;
+		
+		while(erasable_messages > 0 && erase_total < text.length())
+		{
+			bool line_end;
+			
+			do {
+				const Message &front = messages.front();
+				line_end = front.text.back() == '\n';
+				
+				erase_total += front.text.length();
+				
+				messages.pop_front();
+				--erasable_messages;
+			} while(!line_end);
+		}
+		
+		if(erase_total > 0)
+		{
+			total_text -= erase_total;
+			events->emplace_back(new ConsoleEraseEvent(this, erase_total));
+		}
+	}
+	
+	messages.push_back(Message(level, text));
+	total_text += text.length();
 	
-	ConsoleEraseEvent *event = new ConsoleEraseEvent(this, old_total_text);
-	QueueEvent(event); /* Takes ownership of event. */
+	if(text.back() == '\n')
+	{
+		erasable_messages = messages.size();
+	}
+	
+	events->emplace_back(new ConsolePrintEvent(this, level, text));
 }
 
+REHex::ConsoleBuffer::QueueNode::QueueNode(bool clear, Level level, const std::string &text):
+	next(NULL), clear(clear), level(level), text(text) {}
+
 REHex::ConsoleBuffer::Message::Message(Level level, const std::string &text):
 	level(level), text(text) {}
 
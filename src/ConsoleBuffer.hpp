@@ -18,10 +18,13 @@
 #ifndef REHEX_CONSOLEBUFFER_HPP
 #define REHEX_CONSOLEBUFFER_HPP
 
+#include <atomic>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <stdarg.h>
 #include <string>
+#include <vector>
 #include <wx/event.h>
 
 namespace REHex {
@@ -30,6 +33,11 @@ namespace REHex {
 	 *
 	 * This class is thread-safe - messages may be posted from a worker thread and received to
 	 * be displayed in the UI thread.
+	 *
+	 * Messages are pushed onto a lock-free queue by print() and clear(), so any number of
+	 * threads can write to the console without blocking each other or the UI thread. The
+	 * queue is drained in batches by flush() from the UI thread, which is scheduled when
+	 * the queue becomes non-empty and may also be called by consumers at any time.
 	*/
 	class ConsoleBuffer: public wxEvtHandler
 	{
@@ -59,10 +67,13 @@ namespace REHex {
 			 * terminating newline will be erased to keep the buffer under this size.
 			*/
 			ConsoleBuffer(size_t total_text_max = 16384 /* 16KiB */);
+			~ConsoleBuffer();
 			
 			/**
 			 * @brief Get a reference to the list of messages in the buffer.
 			 *
+			 * Does not include any messages which haven't been flushed yet.
+			 *
 			 * WARNING: Accessing the returned list is not thread-safe! Do not use it
 			 * in application code!
 			*/
@@ -70,14 +81,27 @@ namespace REHex {
 			
 			/**
 			 * @brief Get the text of all messages in the buffer.
+			 *
+			 * Includes any messages which have been queued but not yet flushed, so
+			 * the text printed by this thread is always present.
 			*/
 			std::string get_messages_text() const;
 			
+			/**
+			 * @brief Get the text of all messages which have been flushed to the buffer.
+			 *
+			 * Unlike get_messages_text(), this is consistent with the CONSOLE_PRINT and
+			 * CONSOLE_ERASE events raised so far, so it can be used to initialise a
+			 * consumer of those events.
+			*/
+			std::string get_flushed_text() const;
+			
 			/**
 			 * @brief Append a message to the buffer.
 			 *
-			 * Appends a message to the buffer, raising a CONSOLE_PRINT event to notify
-			 * any consumers.
+			 * Queues a message to be appended to the buffer. When the queue is next
+			 * flushed, the message is added to the buffer and a CONSOLE_PRINT event is
+			 * raised to notify any consumers.
 			 *
 			 * If any messages need to be erased to make room, a CONSOLE_ERASE event
 			 * will also be raised.
@@ -99,18 +123,63 @@ namespace REHex {
 			/**
 			 * @brief Clear all messages from the buffer.
 			 *
-			 * Clears all messages from the buffer, raising a CONSOLE_ERASE event if
-			 * the buffer wasn't already empty.
+			 * Queues the buffer to be cleared after any messages already queued have
+			 * been appended. When the queue is next flushed, all messages are cleared
+			 * and a CONSOLE_ERASE event is raised if the buffer wasn't already empty.
 			*/
 			void clear();
 			
+			/**
+			 * @brief Apply any queued messages to the buffer.
+			 *
+			 * Raises the CONSOLE_PRINT and CONSOLE_ERASE events for any changes to the
+			 * buffer. This must only be called from the UI thread.
+			*/
+			void flush();
+		
 		private:
+			/**
+			 * @brief A queued print() or clear() operation.
+			*/
+			struct QueueNode
+			{
+				std::atomic<QueueNode*> next;
+				
+				bool clear;
+				Level level;
+				std::string text;
+				
+				QueueNode(bool clear, Level level, const std::string &text);
+			};
+			
 			const size_t total_text_max;  /**< Buffer character limit (soft). */
 			
 			mutable std::mutex lock;
 			
 			size_t total_text;            /**< Number of characters in the buffer. */
 			std::list<Message> messages;  /**< Messages in the buffer. */
+			
+			/**
+			 * @brief Number of messages at the start of the buffer which can be erased.
+			 *
+			 * Only whole lines are erased to make room, so this counts the messages up
+			 * to and including the last one with a terminating newline.
+			*/
+			size_t erasable_messages;
+			
+			/* Intrusive multi-producer, single-consumer queue of pending operations.
+			 *
+			 * Producers append to queue_head with a single atomic exchange, flush()
+			 * consumes from queue_tail while holding lock. queue_tail always points to
+			 * a node whose operation has already been consumed (initially a stub).
+			*/
+			std::atomic<QueueNode*> queue_head;
+			QueueNode *queue_tail;
+			
+			std::atomic<bool> flush_pending;  /**< A flush() call has been scheduled. */
+			
+			void push(QueueNode *node);
+			void append_message(Level level, const std::string &text, std::vector< std::unique_ptr<wxEvent> > *events);
 	};
 	
 	/**
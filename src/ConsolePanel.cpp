@@ -18,6 +18,8 @@
 
 #include "platform.hpp"
 
+#include <algorithm>
+
 #include "App.hpp"
 #include "ConsolePanel.hpp"
 
@@ -28,8 +30,16 @@ static REHex::ToolPanel *main_console_factory(wxWindow *parent, REHex::SharedDoc
 
 static REHex::ToolPanelRegistration main_console_tpr("MainConsole", "Console", REHex::ToolPanel::TPS_WIDE, &main_console_factory);
 
+/* Interval between updates to the text control while messages are being printed. */
+static const int UPDATE_INTERVAL_MS = 100;
+
 REHex::ConsolePanel::ConsolePanel(wxWindow *parent, ConsoleBuffer *buffer, const std::string &panel_name):
-	ToolPanel(parent), buffer(buffer), panel_name(panel_name)
+	ToolPanel(parent),
+	buffer(buffer),
+	panel_name(panel_name),
+	update_timer(this, wxID_ANY),
+	output_length(0),
+	pending_erase(0)
 {
 	output_text = new wxTextCtrl(this, wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxTE_MULTILINE | wxTE_READONLY);
 	
@@ -40,6 +50,8 @@ REHex::ConsolePanel::ConsolePanel(wxWindow *parent, ConsoleBuffer *buffer, const
 	buffer->Bind(CONSOLE_PRINT, &REHex::ConsolePanel::OnConsolePrint, this);
 	buffer->Bind(CONSOLE_ERASE, &REHex::ConsolePanel::OnConsoleErase, this);
 	
+	this->Bind(wxEVT_TIMER, &REHex::ConsolePanel::OnUpdateTimer, this, update_timer.GetId());
+	
 	/* When ConsolePanel is initially constructed, the ConsoleBuffer may have events pending
 	 * for messages which are already in the buffer, if we consumed those messages from the
 	 * buffer and then carried on our merry way we would wind up showing them doubled when the
@@ -77,17 +89,53 @@ wxSize REHex::ConsolePanel::DoGetBestClientSize() const
 
 void REHex::ConsolePanel::update() {}
 
+void REHex::ConsolePanel::apply_pending()
+{
+	if(pending_erase > 0)
+	{
+		output_text->Remove(0, pending_erase);
+		output_length -= pending_erase;
+		pending_erase = 0;
+	}
+	
+	if(!pending_text.empty())
+	{
+		output_text->AppendText(pending_text);
+		output_length += pending_text.length();
+		pending_text.clear();
+	}
+	
+	output_text->SetInsertionPointEnd();
+}
+
 void REHex::ConsolePanel::OnConsolePrint(ConsolePrintEvent &event)
 {
-	output_text->AppendText(event.text);
+	pending_text += event.text;
+	
+	if(!update_timer.IsRunning())
+	{
+		update_timer.Start(UPDATE_INTERVAL_MS, wxTIMER_ONE_SHOT);
+	}
 	
 	event.Skip(); /* Continue propagation */
 }
 
 void REHex::ConsolePanel::OnConsoleErase(ConsoleEraseEvent &event)
 {
-	output_text->Remove(0, event.count);
-	output_text->SetInsertionPointEnd();
+	/* Erase from the text currently in the control first, then from any pending text
+	 * which hasn't been appended to it yet.
+	*/
+	
+	size_t erase_output = std::min(event.count, (output_length - pending_erase));
+	pending_erase += erase_output;
+	
+	size_t erase_pending = std::min((event.count - erase_output), pending_text.length());
+	pending_text.erase(0, erase_pending);
+	
+	if(!update_timer.IsRunning())
+	{
+		update_timer.Start(UPDATE_INTERVAL_MS, wxTIMER_ONE_SHOT);
+	}
 	
 	event.Skip(); /* Continue propagation */
 }
@@ -96,6 +144,23 @@ void REHex::ConsolePanel::OnFirstIdle(wxIdleEvent &event)
 {
 	this->Unbind(wxEVT_IDLE, &REHex::ConsolePanel::OnFirstIdle, this);
 	
+	std::string text = buffer->get_flushed_text();
+	
 	output_text->Clear();
-	output_text->AppendText(buffer->get_messages_text());
+	output_text->AppendText(text);
+	
+	output_length = text.length();
+	pending_erase = 0;
+	pending_text.clear();
+}
+
+void REHex::ConsolePanel::OnUpdateTimer(wxTimerEvent &event)
+{
+	/* Pick up anything still queued in the buffer so it goes out with this update. */
+	buffer->flush();
+	update_timer.Stop();
+	
+	output_text->Freeze();
+	apply_pending();
+	output_text->Thaw();
 }
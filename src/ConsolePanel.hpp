@@ -19,8 +19,10 @@
 #ifndef REHEX_CONSOLEPANEL_HPP
 #define REHEX_CONSOLEPANEL_HPP
 
+#include <string>
 #include <wx/panel.h>
 #include <wx/textctrl.h>
+#include <wx/timer.h>
 
 #include "ConsoleBuffer.hpp"
 #include "ToolPanel.hpp"
@@ -47,9 +49,22 @@ namespace REHex
 			wxTextCtrl *output_text;
 			std::string panel_name;
 			
+			/* Changes to the buffer are accumulated and applied to output_text in one
+			 * go by update_timer, rather than updating the control for every message.
+			*/
+			
+			wxTimer update_timer;
+			
+			size_t output_length;  /**< Number of buffer characters in output_text. */
+			size_t pending_erase;  /**< Characters to erase from start of output_text. */
+			std::string pending_text;  /**< Text to append to output_text. */
+			
+			void apply_pending();
+			
 			void OnConsolePrint(ConsolePrintEvent &event);
 			void OnConsoleErase(ConsoleEraseEvent &event);
 			void OnFirstIdle(wxIdleEvent &event);
+			void OnUpdateTimer(wxTimerEvent &event);
 		
 	};
 }
@@ -96,7 +96,7 @@ REHex::DiffWindow::DiffWindow(wxWindow *parent):
 	idle_ticks(0),
 	idle_secs(0),
 	idle_bytes(0),
-	odsr_calls(0),
+	slices_compared(0),
 	#endif
 	
 	invisible_owner_window(NULL)
@@ -208,7 +208,7 @@ std::list<REHex::DiffWindow::Range>::iterator REHex::DiffWindow::add_range(const
 	idle_ticks = 0;
 	idle_secs  = 0;
 	idle_bytes = 0;
-	odsr_calls = 0;
+	slices_compared = 0;
 	#endif
 	
 	if(ranges.size() == 1)
@@ -292,7 +292,7 @@ std::list<REHex::DiffWindow::Range>::iterator REHex::DiffWindow::add_range(const
 	resize_splitters();
 	
 	offsets_pending.clear_all();
-	offsets_different.clear_all();
+	differences.reset(ranges.size());
 	
 	if(ranges.size() > 1)
 	{
@@ -410,7 +410,7 @@ std::list<REHex::DiffWindow::Range>::iterator REHex::DiffWindow::remove_range(st
 	update_longest_range();
 	
 	offsets_pending.clear_all();
-	offsets_different.clear_all();
+	differences.reset(ranges.size());
 	
 	if(ranges.size() > 1)
 	{
@@ -458,7 +458,7 @@ void REHex::DiffWindow::doc_update(Range *range)
 			off_t end = range->length;
 			
 			auto pending_i   = offsets_pending.find_first_in(base, std::numeric_limits<off_t>::max());
-			auto different_i = offsets_different.find_first_in(base, std::numeric_limits<off_t>::max());
+			auto different_i = differences.get_different().find_first_in(base, std::numeric_limits<off_t>::max());
 			
 			bool is_pending = false;
 			bool is_different = false;
@@ -475,7 +475,7 @@ void REHex::DiffWindow::doc_update(Range *range)
 				}
 			}
 			
-			if(!is_pending && different_i != offsets_different.end())
+			if(!is_pending && different_i != differences.get_different().end())
 			{
 				if(different_i->offset <= (base + CONTEXT_BYTES))
 				{
@@ -615,76 +615,45 @@ void REHex::DiffWindow::set_relative_cursor_pos(off_t relative_cursor_pos)
 
 off_t REHex::DiffWindow::process_now(off_t rel_offset, off_t length)
 {
+	length = std::min(length, (longest_range - rel_offset));
+	if(length <= 0)
+	{
+		return 0;
+	}
+	
+	std::vector< std::vector<unsigned char> > range_data(ranges.size());
+	std::vector<const unsigned char*> range_data_ptrs(ranges.size(), NULL);
+	std::vector<off_t> range_available(ranges.size(), 0);
+	
+	/* If only one range has any data left from this point onwards, then everything beyond
+	 * the end of the others is different and there is no data to read or compare.
+	*/
+	
+	size_t ranges_with_data = std::count_if(ranges.begin(), ranges.end(),
+		[&](const Range &r) { return r.length > rel_offset; });
+	
 	try {
-		std::vector<unsigned char> base_data;
-		bool base_data_ready = false;
+		/* Read this slice of each range once and compare them all in a single pass. */
 		
-		for(auto r = ranges.begin(); r != ranges.end(); ++r)
+		size_t i = 0;
+		for(auto r = ranges.begin(); r != ranges.end(); ++r, ++i)
 		{
-			if(r->length <= rel_offset)
-			{
-				length = offsets_pending.begin()->length;
-				offsets_different.set_range(rel_offset, length);
-				
-				#ifdef DIFFWINDOW_PROFILING
-				++odsr_calls;
-				#endif
-				
-				break;
-			}
-			else if(r->length < (rel_offset + length))
-			{
-				length = r->length - rel_offset;
-			}
+			range_available[i] = std::max<off_t>(std::min((r->length - rel_offset), length), 0);
 			
-			if(!base_data_ready)
+			if(range_available[i] > 0 && ranges_with_data > 1)
 			{
-				base_data = r->doc->read_data(r->offset + rel_offset, length);
-				assert((off_t)(base_data.size()) >= length);
+				range_data[i] = r->doc->read_data(r->offset + rel_offset, range_available[i]);
+				assert((off_t)(range_data[i].size()) >= range_available[i]);
 				
-				base_data_ready = true;
-			}
-			else{
-				std::vector<unsigned char> r_data = r->doc->read_data(r->offset + rel_offset, length);
-				assert((off_t)(r_data.size()) >= length);
-				
-				off_t diff_base = -1;
-				off_t diff_end  = -1;
-				
-				for(off_t i = 0; i < length; ++i)
-				{
-					if(r_data[i] != base_data[i])
-					{
-						if(diff_end != i)
-						{
-							if(diff_end > diff_base)
-							{
-								offsets_different.set_range((rel_offset + diff_base), (diff_end - diff_base));
-								
-								#ifdef DIFFWINDOW_PROFILING
-								++odsr_calls;
-								#endif
-							}
-							
-							diff_base = i;
-							diff_end  = i + 1;
-						}
-						else{
-							++diff_end;
-						}
-					}
-				}
-				
-				if(diff_end > diff_base)
-				{
-					offsets_different.set_range((rel_offset + diff_base), (diff_end - diff_base));
-					
-					#ifdef DIFFWINDOW_PROFILING
-					++odsr_calls;
-					#endif
-				}
+				range_data_ptrs[i] = range_data[i].data();
 			}
 		}
+		
+		differences.process_slice(rel_offset, length, range_data_ptrs.data(), range_available.data());
+		
+		#ifdef DIFFWINDOW_PROFILING
+		++slices_compared;
+		#endif
 	}
 	catch(const std::exception &e)
 	{
@@ -711,19 +680,33 @@ void REHex::DiffWindow::update_longest_range()
 		longest_range = 0;
 		
 		offsets_pending.clear_all();
-		offsets_different.clear_all();
+		differences.clear_all();
 	}
 	else{
 		longest_range = std::max_element(ranges.begin(), ranges.end(),
 			[](const Range &lhs, const Range &rhs) { return lhs.length < rhs.length; })->length;
 		
 		offsets_pending.clear_range(longest_range, std::numeric_limits<off_t>::max());
-		offsets_different.clear_range(longest_range, std::numeric_limits<off_t>::max());
+		differences.clear_range(longest_range, std::numeric_limits<off_t>::max());
+	}
+}
+
+size_t REHex::DiffWindow::range_index(const Range *range) const
+{
+	size_t idx = 0;
+	for(auto r = ranges.begin(); r != ranges.end() && &*r != range; ++r)
+	{
+		++idx;
 	}
+	
+	assert(idx < ranges.size());
+	return idx;
 }
 
 void REHex::DiffWindow::goto_prev_difference()
 {
+	const ByteRangeSet &offsets_different = differences.get_different();
+	
 	/* Find the first difference preceeding the cursor... */
 	auto prev_diff = offsets_different.find_last_in(0, relative_cursor_pos);
 	
@@ -769,6 +752,8 @@ void REHex::DiffWindow::goto_prev_difference()
 
 void REHex::DiffWindow::goto_next_difference()
 {
+	const ByteRangeSet &offsets_different = differences.get_different();
+	
 	/* Find the first difference either encompassing or following the cursor... */
 	auto next_diff = offsets_different.find_first_in(relative_cursor_pos, std::numeric_limits<off_t>::max());
 	
@@ -873,8 +858,8 @@ void REHex::DiffWindow::OnIdle(wxIdleEvent &event)
 				break;
 			}
 			
-			auto last_diff_found = offsets_different.find_last_in(process_begin, processed);
-			if(last_diff_found != offsets_different.end())
+			auto last_diff_found = differences.get_different().find_last_in(process_begin, processed);
+			if(last_diff_found != differences.get_different().end())
 			{
 				set_relative_cursor_pos(last_diff_found->offset);
 				
@@ -941,8 +926,8 @@ void REHex::DiffWindow::OnIdle(wxIdleEvent &event)
 				break;
 			}
 			
-			auto first_diff_found = offsets_different.find_first_in(rel_offset, processed);
-			if(first_diff_found != offsets_different.end())
+			auto first_diff_found = differences.get_different().find_first_in(rel_offset, processed);
+			if(first_diff_found != differences.get_different().end())
 			{
 				set_relative_cursor_pos(first_diff_found->offset);
 				
@@ -1011,13 +996,13 @@ void REHex::DiffWindow::OnIdle(wxIdleEvent &event)
 		
 		if(offsets_pending.empty())
 		{
-			wxGetApp().printf_debug("Processed %jd bytes in %f seconds over %u idle ticks (%fus avg) (%u offsets_different insertions)\n",
-				(intmax_t)(idle_bytes), idle_secs, idle_ticks, ((idle_secs / (double)(idle_ticks)) * 1000000), odsr_calls);
+			wxGetApp().printf_debug("Processed %jd bytes in %f seconds over %u idle ticks (%fus avg) (%u slices compared)\n",
+				(intmax_t)(idle_bytes), idle_secs, idle_ticks, ((idle_secs / (double)(idle_ticks)) * 1000000), slices_compared);
 			
 			idle_ticks = 0;
 			idle_secs  = 0;
 			idle_bytes = 0;
-			odsr_calls = 0;
+			slices_compared = 0;
 		}
 	}
 	#endif
@@ -1109,7 +1094,7 @@ void REHex::DiffWindow::OnDocumentDataErase(OffsetLengthEvent &event)
 				if(shrink > 0)
 				{
 					offsets_pending.set_range(0, longest_range);
-					offsets_different.clear_all();
+					differences.clear_all();
 				}
 				
 				r->offset -= shift;
@@ -1136,7 +1121,7 @@ void REHex::DiffWindow::OnDocumentDataErase(OffsetLengthEvent &event)
 				if(shrink > 0)
 				{
 					offsets_pending.set_range(0, longest_range);
-					offsets_different.clear_all();
+					differences.clear_all();
 				}
 				
 				r->length -= shrink;
@@ -1222,7 +1207,7 @@ void REHex::DiffWindow::OnDocumentDataInsert(OffsetLengthEvent &event)
 				doc_update(&*r);
 				
 				offsets_pending.set_range(0, longest_range);
-				offsets_different.clear_all();
+				differences.clear_all();
 			}
 			
 			off_t cursor_pos = r->doc_ctrl->get_cursor_position().byte(); /* BITFIXUP */
@@ -1284,7 +1269,7 @@ void REHex::DiffWindow::OnDocumentDataOverwrite(OffsetLengthEvent &event)
 			if(overlap_end > overlap_base)
 			{
 				offsets_pending.set_range((overlap_base - r->offset), (overlap_end - overlap_base));
-				offsets_different.clear_range((overlap_base - r->offset), (overlap_end - overlap_base));
+				differences.clear_range((overlap_base - r->offset), (overlap_end - overlap_base));
 			}
 			
 			r->doc_ctrl->Refresh();
@@ -1544,12 +1529,17 @@ REHex::DocumentCtrl::DataRegion::Highlight REHex::DiffWindow::DiffDataRegion::hi
 	assert(off >= range->offset);
 	off_t relative_off = off.byte() - range->offset;
 	
-	if(diff_window->offsets_pending.isset(off.byte()))
+	if(diff_window->offsets_pending.isset(relative_off))
 	{
-		diff_window->process_now(off.byte(), 2048 /* Probably enough to process screen in one go. */);
+		diff_window->process_now(relative_off, 2048 /* Probably enough to process screen in one go. */);
 	}
 	
-	if(diff_window->offsets_different.isset(relative_off))
+	/* The first range is highlighted wherever any range differs from it, the others
+	 * only where they differ from the first.
+	*/
+	size_t range_idx = diff_window->range_index(range);
+	
+	if(diff_window->differences.get_different(range_idx).isset(relative_off))
 	{
 		return Highlight(
 			(*active_palette)[Palette::PAL_DIRTY_TEXT_FG],
@@ -33,6 +33,7 @@
 #include "document.hpp"
 #include "DocumentCtrl.hpp"
 #include "Events.hpp"
+#include "MultiDiff.hpp"
 #include "SafeWindowPointer.hpp"
 #include "SharedDocumentPointer.hpp"
 
@@ -161,8 +162,8 @@ namespace REHex {
 			
 			bool recalc_bytes_per_line_pending;
 			
-			ByteRangeSet offsets_pending;    /**< Bytes which need to be processed (relative to Range base). */
-			ByteRangeSet offsets_different;  /**< Bytes which have been processed and have differences (relative to Range base). */
+			ByteRangeSet offsets_pending;  /**< Bytes which need to be processed (relative to Range base). */
+			MultiDiff differences;         /**< Bytes which have been processed and have differences (relative to Range base). */
 			wxTimer update_regions_timer;
 			
 			off_t relative_cursor_pos;  /**< Current cursor position (relative to Range base). */
@@ -177,7 +178,7 @@ namespace REHex {
 			unsigned idle_ticks;
 			double idle_secs;
 			off_t idle_bytes;
-			unsigned odsr_calls;
+			unsigned slices_compared;
 			#endif
 			
 			SafeWindowPointer<wxTopLevelWindow> invisible_owner_window;
@@ -191,6 +192,7 @@ namespace REHex {
 			void set_relative_cursor_pos(off_t relative_cursor_pos);
 			off_t process_now(off_t rel_offset, off_t length);
 			void update_longest_range();
+			size_t range_index(const Range *range) const;
 			void goto_prev_difference();
 			void goto_next_difference();
 			
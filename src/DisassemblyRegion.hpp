@@ -34,6 +34,30 @@
 
 namespace REHex
 {
+	/**
+	 * @brief A Capstone architecture and mode which can be disassembled.
+	*/
+	struct CSArchitecture {
+		const char *triple;
+		const char *label;
+		cs_arch arch;
+		cs_mode mode;
+	};
+	
+	/**
+	 * @brief Get the list of all known architectures.
+	 *
+	 * The list may include architectures which aren't supported by the Capstone library
+	 * in use, check with cs_support() before using one.
+	*/
+	const std::vector<CSArchitecture> &get_known_architectures();
+	
+	/**
+	 * @brief Find a known architecture by its triple (e.g. "x86_64").
+	 * @returns Pointer to architecture description, NULL if not found.
+	*/
+	const CSArchitecture *find_architecture(const std::string &triple);
+	
 	class DisassemblyRegion: public DocumentCtrl::GenericDataRegion
 	{
 		public:
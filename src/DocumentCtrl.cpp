@@ -31,7 +31,7 @@
 #include <unictype.h>
 #include <unistr.h>
 #include <wx/clipbrd.h>
-#include <wx/dcbuffer.h>
+#include <wx/dcmemory.h>
 
 #include "App.hpp"
 #include "CharacterEncoder.hpp"
@@ -746,32 +746,127 @@ std::pair<REHex::BitOffset, REHex::BitOffset> REHex::DocumentCtrl::get_selection
 
 void REHex::DocumentCtrl::OnPaint(wxPaintEvent &event)
 {
-	wxBufferedPaintDC dc(this);
+	wxPaintDC paint_dc(this);
 	
-	dc.SetFont(hex_font);
+	wxSize client_size = GetClientSize();
+	if(client_size.GetWidth() <= 0 || client_size.GetHeight() <= 0)
+	{
+		return;
+	}
 	
-	dc.SetBackground(wxBrush((*active_palette)[Palette::PAL_NORMAL_TEXT_BG]));
-	dc.Clear();
+	/* The cache bitmaps are created at the window's content scale factor (like the buffer
+	 * wxBufferedPaintDC would use) so they aren't upscaled and blurred on HiDPI displays.
+	*/
+	double scale_factor = GetContentScaleFactor();
 	
-	/* Find the region containing the first visible line. */
-	auto base_region = region_by_y_offset(scroll_yoff);
-	int64_t yo_end = scroll_yoff + visible_lines + 1;
+	#if wxCHECK_VERSION(3, 1, 6)
+	wxSize cache_size = paint_cache.IsOk() ? paint_cache.GetDIPSize() : wxSize();
+	#else
+	wxSize cache_size = paint_cache.IsOk() ? paint_cache.GetScaledSize() : wxSize();
+	#endif
 	
-	/* Iterate over the visible regions and draw them. */
-	for(auto region = base_region; region != regions.end() && (*region)->y_offset < yo_end; ++region)
+	if(!paint_cache.IsOk() || cache_size != client_size || paint_cache.GetScaleFactor() != scale_factor)
+	{
+		#if wxCHECK_VERSION(3, 1, 6)
+		paint_cache.CreateWithDIPSize(client_size, scale_factor, wxBITMAP_SCREEN_DEPTH);
+		paint_cache_scratch.CreateWithDIPSize(client_size, scale_factor, wxBITMAP_SCREEN_DEPTH);
+		#else
+		paint_cache.CreateScaled(client_size.GetWidth(), client_size.GetHeight(), wxBITMAP_SCREEN_DEPTH, scale_factor);
+		paint_cache_scratch.CreateScaled(client_size.GetWidth(), client_size.GetHeight(), wxBITMAP_SCREEN_DEPTH, scale_factor);
+		#endif
+		
+		paint_cache_valid = false;
+	}
+	
+	paint_y_begin = 0;
+	paint_y_end = client_size.GetHeight();
+	
+	int64_t scroll_lines = scroll_yoff - paint_cache_yoff;
+	
+	if(paint_cache_valid && paint_cache_xoff == scroll_xoff && scroll_lines == 0)
 	{
-		int x_px = 0 - scroll_xoff;
+		/* Nothing has changed since the last paint, just copy it to the window. */
+		paint_y_end = paint_y_begin;
+	}
+	else if(paint_cache_valid && paint_cache_xoff == scroll_xoff && scroll_lines > -(int64_t)(visible_lines) && scroll_lines < (int64_t)(visible_lines))
+	{
+		/* Only the vertical scroll position has changed since the last paint, shift the
+		 * lines which are still on screen into their new position and only draw the
+		 * lines which have scrolled into view.
+		*/
+		
+		int shift_px = (int)(scroll_lines) * hf_height;
 		
-		int64_t y_px = (*region)->y_offset;
-		assert(y_px >= 0);
+		{
+			wxMemoryDC src_dc(paint_cache);
+			wxMemoryDC dst_dc(paint_cache_scratch);
+			
+			if(shift_px > 0)
+			{
+				dst_dc.Blit(0, 0, client_size.GetWidth(), (client_size.GetHeight() - shift_px), &src_dc, 0, shift_px);
+			}
+			else{
+				dst_dc.Blit(0, -shift_px, client_size.GetWidth(), (client_size.GetHeight() + shift_px), &src_dc, 0, 0);
+			}
+		}
 		
-		y_px -= scroll_yoff;
-		y_px *= hf_height;
+		std::swap(paint_cache, paint_cache_scratch);
 		
-		(*region)->draw(*this, dc, x_px, y_px);
+		if(scroll_lines > 0)
+		{
+			/* The line partially visible at the bottom of the last paint was cut off, so
+			 * it has to be drawn again along with the lines below it.
+			*/
+			paint_y_begin = (int)((int64_t)(visible_lines) - scroll_lines) * hf_height;
+		}
+		else{
+			paint_y_end = -shift_px;
+		}
 	}
 	
-	/* Iterate over the visible regions again and give them a chance to do any processing. */
+	wxMemoryDC dc(paint_cache);
+	
+	/* Find the region containing the first line being drawn. */
+	auto base_region = region_by_y_offset(scroll_yoff + (paint_y_begin / hf_height));
+	int64_t yo_end = scroll_yoff + (paint_y_end / hf_height) + 1;
+	
+	if(paint_y_begin < paint_y_end)
+	{
+		dc.SetClippingRegion(0, paint_y_begin, client_size.GetWidth(), (paint_y_end - paint_y_begin));
+		
+		dc.SetFont(hex_font);
+		
+		dc.SetPen(*wxTRANSPARENT_PEN);
+		dc.SetBrush(wxBrush((*active_palette)[Palette::PAL_NORMAL_TEXT_BG]));
+		dc.DrawRectangle(0, paint_y_begin, client_size.GetWidth(), (paint_y_end - paint_y_begin));
+		
+		/* Iterate over the regions within the area being drawn and draw them. */
+		for(auto region = base_region; region != regions.end() && (*region)->y_offset < yo_end; ++region)
+		{
+			int x_px = 0 - scroll_xoff;
+			
+			int64_t y_px = (*region)->y_offset;
+			assert(y_px >= 0);
+			
+			y_px -= scroll_yoff;
+			y_px *= hf_height;
+			
+			(*region)->draw(*this, dc, x_px, y_px);
+		}
+		
+		dc.DestroyClippingRegion();
+	}
+	
+	paint_dc.Blit(0, 0, client_size.GetWidth(), client_size.GetHeight(), &dc, 0, 0);
+	
+	paint_cache_valid = true;
+	paint_cache_yoff = scroll_yoff;
+	paint_cache_xoff = scroll_xoff;
+	
+	/* Iterate over the visible regions and give them a chance to do any processing. */
+	
+	base_region = region_by_y_offset(scroll_yoff);
+	yo_end = scroll_yoff + visible_lines + 1;
 	
 	bool width_changed = false;
 	bool height_changed = false;
@@ -808,6 +903,17 @@ void REHex::DocumentCtrl::OnPaint(wxPaintEvent &event)
 	}
 }
 
+void REHex::DocumentCtrl::Refresh(bool eraseBackground, const wxRect *rect)
+{
+	paint_cache_valid = false;
+	wxControl::Refresh(eraseBackground, rect);
+}
+
+void REHex::DocumentCtrl::refresh_scrolled()
+{
+	wxControl::Refresh();
+}
+
 void REHex::DocumentCtrl::OnErase(wxEraseEvent &event)
 {
 	// Left blank to disable erase
@@ -1121,7 +1227,7 @@ void REHex::DocumentCtrl::_update_vscroll_pos(bool update_linked_scroll_others)
 			
 			other->_update_vscroll_pos(false);
 			other->save_scroll_position();
-			other->Refresh();
+			other->refresh_scrolled();
 		});
 	}
 }
@@ -1299,7 +1405,7 @@ void REHex::DocumentCtrl::OnScroll(wxScrollWinEvent &event)
 		}
 		
 		_update_vscroll_pos();
-		Refresh();
+		refresh_scrolled();
 		
 		save_scroll_position();
 	}
@@ -1371,7 +1477,7 @@ void REHex::DocumentCtrl::OnWheel(wxMouseEvent &event)
 		}
 		
 		_update_vscroll_pos();
-		Refresh();
+		refresh_scrolled();
 		
 		save_scroll_position();
 	}
@@ -3256,7 +3362,41 @@ void REHex::DocumentCtrl::set_scroll_yoff(int64_t scroll_yoff, bool update_linke
 	
 	_update_vscroll_pos(update_linked_scroll_others);
 	save_scroll_position();
-	Refresh();
+	refresh_scrolled();
+}
+
+REHex::ByteRangeSet REHex::DocumentCtrl::get_visible_data()
+{
+	ByteRangeSet visible;
+	
+	if(regions.empty())
+	{
+		return visible;
+	}
+	
+	int64_t end_line = scroll_yoff + (int64_t)(visible_lines);
+	
+	for(auto region = region_by_y_offset(scroll_yoff); region != regions.end() && (*region)->y_offset < end_line; ++region)
+	{
+		GenericDataRegion *dr = dynamic_cast<GenericDataRegion*>(*region);
+		if(dr == NULL || dr->y_lines <= 0 || dr->d_length <= BitOffset::ZERO)
+		{
+			continue;
+		}
+		
+		int64_t first_row = std::max<int64_t>((scroll_yoff - dr->y_offset), 0);
+		int64_t last_row  = std::min<int64_t>(dr->y_lines, (end_line - dr->y_offset)) - 1;
+		
+		off_t begin = dr->nth_row_nearest_column(first_row, 0).byte();
+		off_t end   = dr->nth_row_nearest_column(last_row, std::numeric_limits<int>::max()).byte() + 1;
+		
+		if(end > begin)
+		{
+			visible.set_range(begin, (end - begin));
+		}
+	}
+	
+	return visible;
 }
 
 void REHex::DocumentCtrl::set_scroll_yoff_clamped(int64_t scroll_yoff)
@@ -3479,16 +3619,80 @@ void REHex::DocumentCtrl::DataRegion::calc_height(REHex::DocumentCtrl &doc)
 	}
 }
 
+/* Number of data offsets checked against the selection by each call of the matching task. */
+static const size_t SELECTION_MATCH_OFFSETS_PER_CHUNK = 1024;
+
+/* Minimum number of bytes which need comparing before matching is split over the ThreadPool. */
+static const size_t SELECTION_MATCH_PARALLEL_MIN = 1024 * 1024;
+
+/* Mark any copies of the selected data within the data being drawn.
+ *
+ * Comparing every offset on screen against a large selection is by far the most expensive part
+ * of laying out the lines of a DataRegion and doesn't touch any UI state, so the comparisons are
+ * done in parallel on the ThreadPool for all the lines being drawn and then the (non-overlapping)
+ * matches are picked out from the start of the data.
+*/
+static void find_selection_matches(REHex::BitRangeSet &matches, const std::vector<unsigned char> &data, REHex::BitOffset data_base, const std::vector<unsigned char> &selection_data)
+{
+	if(selection_data.empty() || selection_data.size() > data.size())
+	{
+		return;
+	}
+	
+	size_t num_offsets = (data.size() - selection_data.size()) + 1;
+	std::vector<unsigned char> match_at(num_offsets, 0);
+	
+	auto check_offsets = [&](size_t begin, size_t end)
+	{
+		for(size_t i = begin; i < end; ++i)
+		{
+			match_at[i] = memcmp((data.data() + i), selection_data.data(), selection_data.size()) == 0;
+		}
+	};
+	
+	if((num_offsets * selection_data.size()) >= SELECTION_MATCH_PARALLEL_MIN)
+	{
+		std::atomic<size_t> next_chunk_to_check(0);
+		
+		REHex::ThreadPool::TaskHandle a = wxGetApp().thread_pool->queue_task([&]()
+		{
+			size_t base = next_chunk_to_check.fetch_add(SELECTION_MATCH_OFFSETS_PER_CHUNK);
+			size_t end = std::min((base + SELECTION_MATCH_OFFSETS_PER_CHUNK), num_offsets);
+			
+			check_offsets(base, end);
+			
+			return base >= num_offsets;
+		}, -1, REHex::ThreadPool::TaskPriority::UI);
+		
+		a.join();
+	}
+	else{
+		check_offsets(0, num_offsets);
+	}
+	
+	for(size_t i = 0; i < num_offsets;)
+	{
+		if(match_at[i])
+		{
+			matches.set_range(data_base + REHex::BitOffset(i, 0), selection_data.size());
+			i += selection_data.size();
+		}
+		else{
+			++i;
+		}
+	}
+}
+
 void REHex::DocumentCtrl::DataRegion::draw(REHex::DocumentCtrl &doc, wxDC &dc, int x, int64_t y)
 {
 	PROFILE_BLOCK("REHex::DocumentCtrl::DataRegion::Draw");
 	
 	draw_container(doc, dc, x, y);
 	
-	/* If we are scrolled part-way into a data region, don't render data above the client area
-	 * as it would get expensive very quickly with large files.
+	/* If we are scrolled part-way into a data region, don't render data above the area being
+	 * drawn as it would get expensive very quickly with large files.
 	*/
-	int64_t skip_lines = (y < 0 ? (-y / doc.hf_height) : 0);
+	int64_t skip_lines = (y < doc.paint_y_begin ? ((doc.paint_y_begin - y) / doc.hf_height) : 0);
 	off_t skip_bytes  = skip_lines * bytes_per_line_actual;
 	
 	wxPen norm_fg_1px((*active_palette)[Palette::PAL_NORMAL_TEXT_FG], 1);
@@ -3509,23 +3713,23 @@ void REHex::DocumentCtrl::DataRegion::draw(REHex::DocumentCtrl &doc, wxDC &dc, i
 	
 	if(skip_lines >= (y_lines - indent_final))
 	{
-		/* All of our data is past the top of the client area, all that needed to be
+		/* All of our data is above the area being drawn, all that needed to be
 		 * rendered is the bottom of the container around it.
 		*/
 		return;
 	}
 	
 	/* Increment y up to our real drawing start point. We can now trust it to be within a
-	 * hf_height of zero, not the stratospheric integer-overflow-causing values it could
-	 * previously have on huge files.
+	 * hf_height of the client area, not the stratospheric integer-overflow-causing values it
+	 * could previously have on huge files.
 	*/
 	y += skip_lines * doc.hf_height;
 	
 	/* The maximum amount of data that can be drawn on the screen before we're past the bottom
-	 * of the client area. Drawing more than this would be pointless and very expensive in the
-	 * case of large files.
+	 * of the area being drawn. Drawing more than this would be pointless and very expensive in
+	 * the case of large files.
 	*/
-	int max_lines = ((doc.client_height - y) / doc.hf_height) + 1;
+	int max_lines = ((doc.paint_y_end - y) / doc.hf_height) + 1;
 	off_t max_bytes = (off_t)(max_lines) * (off_t)(bytes_per_line_actual);
 	
 	if((int64_t)(max_lines) > (y_lines - indent_final - skip_lines))
@@ -3590,20 +3794,7 @@ void REHex::DocumentCtrl::DataRegion::draw(REHex::DocumentCtrl &doc, wxDC &dc, i
 		data_p = data.data() + hsm_pre;
 		data_remain = std::min<size_t>((data.size() - hsm_pre), data_to_draw);
 		
-		if(!selection_data.empty())
-		{
-			for(size_t i = 0; (i + selection_data.size()) <= data.size();)
-			{
-				if(memcmp((data.data() + i), selection_data.data(), selection_data.size()) == 0)
-				{
-					ranges_matching_selection.set_range(data_base + BitOffset(i, 0), selection_data.size());
-					i += selection_data.size();
-				}
-				else{
-					++i;
-				}
-			}
-		}
+		find_selection_matches(ranges_matching_selection, data, data_base, selection_data);
 	}
 	catch(const std::exception &e)
 	{
@@ -3617,8 +3808,6 @@ void REHex::DocumentCtrl::DataRegion::draw(REHex::DocumentCtrl &doc, wxDC &dc, i
 	/* The offset of the character in the Buffer currently being drawn. */
 	BitOffset cur_off = d_offset + BitOffset::BYTES(skip_bytes);
 	
-	wxSize client_size = doc.GetClientSize();
-	
 	auto highlight_func = [&](BitOffset offset)
 	{
 		if(ranges_matching_selection.isset(offset))
@@ -3697,7 +3886,7 @@ void REHex::DocumentCtrl::DataRegion::draw(REHex::DocumentCtrl &doc, wxDC &dc, i
 	
 	bool is_last_data_region = (doc.get_data_regions().back() == this);
 	
-	while(y < client_size.GetHeight() && cur_line < (y_offset + y_lines - indent_final))
+	while(y < doc.paint_y_end && cur_line < (y_offset + y_lines - indent_final))
 	{
 		if(doc.offset_column)
 		{
@@ -599,6 +599,22 @@ namespace REHex {
 			*/
 			void set_scroll_yoff(int64_t scroll_yoff, bool update_linked_scroll_others = true);
 			
+			/**
+			 * @brief Schedule the control to be redrawn.
+			 *
+			 * Discards the cached rendering of the client area, so the next paint will
+			 * draw every visible line again.
+			*/
+			virtual void Refresh(bool eraseBackground = true, const wxRect *rect = NULL) override;
+			
+			/**
+			 * @brief Get the ranges of data which are currently on screen.
+			 *
+			 * Returns the range of each data region which falls within the visible
+			 * lines of the control, rounded out to whole lines.
+			*/
+			ByteRangeSet get_visible_data();
+			
 			void OnPaint(wxPaintEvent &event);
 			void OnErase(wxEraseEvent& event);
 			void OnSize(wxSizeEvent &event);
@@ -671,6 +687,20 @@ namespace REHex {
 			int64_t scroll_yoff_max;
 			int64_t scroll_ydiv;
 			
+			/* Rendering of the client area from the last paint. When only the vertical
+			 * scroll position has changed since, the lines which are still visible are
+			 * blitted from here and only the newly exposed lines are drawn.
+			*/
+			wxBitmap paint_cache;
+			wxBitmap paint_cache_scratch;
+			bool paint_cache_valid{false};
+			int64_t paint_cache_yoff{0};
+			int paint_cache_xoff{0};
+			
+			/* Range of client area Y co-ordinates being drawn by the current paint. */
+			int paint_y_begin{0};
+			int paint_y_end{0};
+			
 			DocumentCtrl *linked_scroll_prev;
 			DocumentCtrl *linked_scroll_next;
 			
@@ -771,6 +801,14 @@ namespace REHex {
 			
 			void linked_scroll_visit_others(const std::function<void(DocumentCtrl*)> &func);
 			
+			/**
+			 * @brief Schedule the control to be redrawn after scrolling vertically.
+			 *
+			 * Unlike Refresh(), this keeps the cached rendering of the client area so
+			 * the lines which are still visible don't need to be drawn again.
+			*/
+			void refresh_scrolled();
+			
 			static const int PRECOMP_HF_STRING_WIDTH_TO = 512;
 			unsigned int hf_string_width_precomp[PRECOMP_HF_STRING_WIDTH_TO];
 			
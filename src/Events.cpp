@@ -31,6 +31,7 @@ wxDEFINE_EVENT(REHex::DATA_INSERT_ABORTED,       REHex::OffsetLengthEvent);
 wxDEFINE_EVENT(REHex::DATA_OVERWRITING,          REHex::OffsetLengthEvent);
 wxDEFINE_EVENT(REHex::DATA_OVERWRITE,            REHex::OffsetLengthEvent);
 wxDEFINE_EVENT(REHex::DATA_OVERWRITE_ABORTED,    REHex::OffsetLengthEvent);
+wxDEFINE_EVENT(REHex::DATA_CHANGES,              REHex::DataChangesEvent);
 
 wxDEFINE_EVENT(REHex::CURSOR_UPDATE,    REHex::CursorUpdateEvent);
 
@@ -104,6 +105,18 @@ wxEvent *REHex::CursorUpdateEvent::Clone() const
 	return new CursorUpdateEvent(*this);
 }
 
+REHex::DataChangesEvent::DataChangesEvent(wxObject *source, unsigned int from_version, unsigned int to_version, const ByteRangeSet &changed, off_t moved_from):
+	wxEvent(wxID_NONE, DATA_CHANGES), from_version(from_version), to_version(to_version), changed(changed), moved_from(moved_from)
+{
+	m_propagationLevel = wxEVENT_PROPAGATE_MAX;
+	SetEventObject(source);
+}
+
+wxEvent *REHex::DataChangesEvent::Clone() const
+{
+	return new DataChangesEvent(*this);
+}
+
 REHex::DocumentTitleEvent::DocumentTitleEvent(wxWindow *source, const std::string &title):
 	wxEvent(source->GetId(), DOCUMENT_TITLE_CHANGED),
 	title(title)
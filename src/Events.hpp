@@ -78,6 +78,45 @@ namespace REHex
 	#define EVT_CURSORUPDATE(id, func) \
 		wx__DECLARE_EVT1(CURSOR_UPDATE, id, wxEVENT_HANDLER_CAST(CursorUpdateEventFunction, func))
 	
+	/**
+	 * @brief Consolidated notification of changes to the data in a Document.
+	 *
+	 * A Document raises one of these after each batch of changes to its data - when
+	 * the transaction which made them is committed (or bulk updates are thawed), or
+	 * once per pass of the event loop for changes made outside of one. Handlers which
+	 * only need to re-read or repaint data can use this instead of handling each
+	 * DATA_OVERWRITE, DATA_INSERT and DATA_ERASE event individually.
+	*/
+	class DataChangesEvent: public wxEvent
+	{
+		public:
+			const unsigned int from_version;  /**< @brief Data version before the first change in the batch. */
+			const unsigned int to_version;    /**< @brief Data version after the last change in the batch. */
+			
+			/**
+			 * @brief Ranges of data which were overwritten or inserted.
+			 *
+			 * Offsets are relative to the data at to_version.
+			*/
+			const ByteRangeSet changed;
+			
+			/**
+			 * @brief Lowest offset where data was inserted or erased, -1 if none was.
+			 *
+			 * Any data from this offset onwards may have moved.
+			*/
+			const off_t moved_from;
+			
+			DataChangesEvent(wxObject *source, unsigned int from_version, unsigned int to_version, const ByteRangeSet &changed, off_t moved_from);
+			
+			virtual wxEvent *Clone() const override;
+	};
+	
+	typedef void (wxEvtHandler::*DataChangesEventFunction)(DataChangesEvent&);
+	
+	#define EVT_DATACHANGES(id, func) \
+		wx__DECLARE_EVT1(DATA_CHANGES, id, wxEVENT_HANDLER_CAST(DataChangesEventFunction, func))
+	
 	/**
 	 * @brief Event raised by a Document when its title changes.
 	*/
@@ -128,6 +167,7 @@ namespace REHex
 	wxDECLARE_EVENT(DATA_OVERWRITING,          OffsetLengthEvent);
 	wxDECLARE_EVENT(DATA_OVERWRITE,            OffsetLengthEvent);
 	wxDECLARE_EVENT(DATA_OVERWRITE_ABORTED,    OffsetLengthEvent);
+	wxDECLARE_EVENT(DATA_CHANGES,              DataChangesEvent);
 	
 	wxDECLARE_EVENT(CURSOR_UPDATE,    CursorUpdateEvent);
 	
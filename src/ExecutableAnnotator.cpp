@@ -0,0 +1,1146 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <wx/filename.h>
+#include <wx/msgdlg.h>
+
+#include "DataType.hpp"
+#include "document.hpp"
+#include "ExecutableAnnotator.hpp"
+#include "mainwindow.hpp"
+#include "Tab.hpp"
+
+/* A region of the file read into memory in one go, with bounds-checked accessors for
+ * the fields within it. Whole headers/tables are read at once rather than going back
+ * to the Document for every field.
+*/
+class HeaderData
+{
+	public:
+		const off_t base;
+		
+		HeaderData(const REHex::Document *doc, off_t base, off_t length, bool big_endian = false);
+		
+		bool has(off_t offset, off_t length) const;
+		
+		uint8_t u8(off_t offset) const;
+		uint16_t u16(off_t offset) const;
+		uint32_t u32(off_t offset) const;
+		uint64_t u64(off_t offset) const;
+		
+		std::string str(off_t offset, size_t max_length) const;
+	
+	private:
+		std::vector<unsigned char> data;
+		bool big_endian;
+		
+		const unsigned char *field(off_t offset, off_t length) const;
+		uint64_t uint(off_t offset, int size) const;
+};
+
+HeaderData::HeaderData(const REHex::Document *doc, off_t base, off_t length, bool big_endian):
+	base(base),
+	big_endian(big_endian)
+{
+	off_t file_length = doc->buffer_length();
+	
+	if(base >= 0 && base < file_length && length > 0)
+	{
+		data = doc->read_data(base, std::min(length, (file_length - base)));
+	}
+}
+
+bool HeaderData::has(off_t offset, off_t length) const
+{
+	off_t size = data.size();
+	return offset >= 0 && length >= 0 && offset <= size && (size - offset) >= length;
+}
+
+const unsigned char *HeaderData::field(off_t offset, off_t length) const
+{
+	if(!has(offset, length))
+	{
+		throw std::runtime_error("Unexpected end of file");
+	}
+	
+	return data.data() + offset;
+}
+
+uint64_t HeaderData::uint(off_t offset, int size) const
+{
+	const unsigned char *f = field(offset, size);
+	uint64_t value = 0;
+	
+	for(int i = 0; i < size; ++i)
+	{
+		int shift = big_endian
+			? ((size - i - 1) * 8)
+			: (i * 8);
+		
+		value |= (uint64_t)(f[i]) << shift;
+	}
+	
+	return value;
+}
+
+uint8_t HeaderData::u8(off_t offset) const
+{
+	return *(field(offset, 1));
+}
+
+uint16_t HeaderData::u16(off_t offset) const
+{
+	return uint(offset, 2);
+}
+
+uint32_t HeaderData::u32(off_t offset) const
+{
+	return uint(offset, 4);
+}
+
+uint64_t HeaderData::u64(off_t offset) const
+{
+	return uint(offset, 8);
+}
+
+std::string HeaderData::str(off_t offset, size_t max_length) const
+{
+	std::string s;
+	
+	for(size_t i = 0; i < max_length && has(offset + i, 1); ++i)
+	{
+		char c = data[offset + i];
+		if(c == '\0')
+		{
+			break;
+		}
+		
+		s.push_back(c);
+	}
+	
+	return s;
+}
+
+/* A run of same-typed fields within a header. */
+struct FieldRun
+{
+	off_t offset;
+	off_t length;
+	int word_size;
+};
+
+static const char *int_type(int word_size, bool big_endian)
+{
+	switch(word_size)
+	{
+		case 1:  return "u8";
+		case 2:  return big_endian ? "u16be" : "u16le";
+		case 4:  return big_endian ? "u32be" : "u32le";
+		case 8:  return big_endian ? "u64be" : "u64le";
+		default: abort();
+	}
+}
+
+/* Adds data types for each run in a header, clipped to the given length. */
+static void add_field_types(REHex::Document::AnnotationBatch &batch, off_t base, off_t length, const FieldRun *runs, size_t n_runs, bool big_endian)
+{
+	for(size_t i = 0; i < n_runs; ++i)
+	{
+		off_t run_end = std::min((runs[i].offset + runs[i].length), length);
+		off_t run_length = run_end - runs[i].offset;
+		
+		/* Don't type partial words. */
+		run_length -= run_length % runs[i].word_size;
+		
+		if(run_length > 0)
+		{
+			batch.add_data_type((base + runs[i].offset), run_length, int_type(runs[i].word_size, big_endian));
+		}
+	}
+}
+
+/* Returns the name of the machine code data type for the given architecture, or an
+ * empty string if the disassembler doesn't support it.
+*/
+static std::string code_type(const char *triple)
+{
+	if(triple == NULL)
+	{
+		return "";
+	}
+	
+	std::string type = std::string("code:") + triple;
+	
+	return REHex::DataTypeRegistry::get_registration(type) != NULL
+		? type
+		: "";
+}
+
+static wxString hex(uint64_t value)
+{
+	return wxString::Format("0x%llx", (unsigned long long)(value));
+}
+
+/* Checks the virtual address range (base + offset, length) can be represented as an
+ * off_t, images loaded at high addresses (e.g. kernels) may go beyond it.
+*/
+static bool virt_range_valid(uint64_t base, uint64_t offset, uint64_t length)
+{
+	const uint64_t max = std::numeric_limits<off_t>::max();
+	return base <= max && offset <= (max - base) && length <= (max - base - offset);
+}
+
+/* --- PE --- */
+
+static const off_t PE_DOS_HEADER_SIZE = 64;
+static const off_t PE_COFF_HEADER_SIZE = 20;
+static const off_t PE_SECTION_HEADER_SIZE = 40;
+static const unsigned PE_MAX_DATA_DIRECTORIES = 16;
+
+static const FieldRun PE_DOS_HEADER_FIELDS[] = {
+	{ 0x00, 0x3C, 2 }, /* e_magic .. e_res2 */
+	{ 0x3C, 0x04, 4 }, /* e_lfanew */
+};
+
+static const FieldRun PE_COFF_HEADER_FIELDS[] = {
+	{  0,  4, 2 }, /* Machine, NumberOfSections */
+	{  4, 12, 4 }, /* TimeDateStamp, PointerToSymbolTable, NumberOfSymbols */
+	{ 16,  4, 2 }, /* SizeOfOptionalHeader, Characteristics */
+};
+
+static const FieldRun PE32_OPTIONAL_HEADER_FIELDS[] = {
+	{  0,  2, 2 }, /* Magic */
+	{  2,  2, 1 }, /* MajorLinkerVersion, MinorLinkerVersion */
+	{  4, 36, 4 }, /* SizeOfCode .. FileAlignment */
+	{ 40, 12, 2 }, /* MajorOperatingSystemVersion .. MinorSubsystemVersion */
+	{ 52, 16, 4 }, /* Win32VersionValue .. CheckSum */
+	{ 68,  4, 2 }, /* Subsystem, DllCharacteristics */
+	{ 72, 24, 4 }, /* SizeOfStackReserve .. NumberOfRvaAndSizes */
+};
+
+static const FieldRun PE32PLUS_OPTIONAL_HEADER_FIELDS[] = {
+	{   0,  2, 2 }, /* Magic */
+	{   2,  2, 1 }, /* MajorLinkerVersion, MinorLinkerVersion */
+	{   4, 20, 4 }, /* SizeOfCode .. BaseOfCode */
+	{  24,  8, 8 }, /* ImageBase */
+	{  32,  8, 4 }, /* SectionAlignment, FileAlignment */
+	{  40, 12, 2 }, /* MajorOperatingSystemVersion .. MinorSubsystemVersion */
+	{  52, 16, 4 }, /* Win32VersionValue .. CheckSum */
+	{  68,  4, 2 }, /* Subsystem, DllCharacteristics */
+	{  72, 32, 8 }, /* SizeOfStackReserve .. SizeOfHeapCommit */
+	{ 104,  8, 4 }, /* LoaderFlags, NumberOfRvaAndSizes */
+};
+
+static const FieldRun PE_SECTION_HEADER_FIELDS[] = {
+	{  8, 24, 4 }, /* VirtualSize .. PointerToLinenumbers */
+	{ 32,  4, 2 }, /* NumberOfRelocations, NumberOfLinenumbers */
+	{ 36,  4, 4 }, /* Characteristics */
+};
+
+static const char *PE_DATA_DIRECTORY_NAMES[PE_MAX_DATA_DIRECTORIES] = {
+	"Export",
+	"Import",
+	"Resource",
+	"Exception",
+	"Certificate",
+	"Base relocation",
+	"Debug",
+	"Architecture",
+	"Global pointer",
+	"TLS",
+	"Load config",
+	"Bound import",
+	"Import address",
+	"Delay import",
+	"CLR runtime",
+	"Reserved",
+};
+
+static const uint16_t PE_OPTIONAL_MAGIC_PE32     = 0x10B;
+static const uint16_t PE_OPTIONAL_MAGIC_PE32PLUS = 0x20B;
+
+static const uint32_t PE_SCN_CNT_CODE    = 0x00000020;
+static const uint32_t PE_SCN_MEM_EXECUTE = 0x20000000;
+static const uint32_t PE_SCN_MEM_READ    = 0x40000000;
+static const uint32_t PE_SCN_MEM_WRITE   = 0x80000000;
+
+static void pe_machine(uint16_t machine, const char **label, const char **triple)
+{
+	switch(machine)
+	{
+		case 0x014C: *label = "i386";  *triple = "i386";    break;
+		case 0x8664: *label = "amd64"; *triple = "x86_64";  break;
+		case 0x01C0: *label = "arm";   *triple = "arm";     break;
+		case 0xAA64: *label = "arm64"; *triple = "aarch64"; break;
+		case 0x0200: *label = "ia64";  *triple = NULL;      break;
+		
+		default:
+			*label = NULL;
+			*triple = NULL;
+			break;
+	}
+}
+
+struct PESection
+{
+	std::string name;
+	uint32_t virtual_size;
+	uint32_t virtual_address;
+	uint32_t raw_size;
+	uint32_t raw_offset;
+	uint32_t characteristics;
+};
+
+bool REHex::pe_probe(const Document *doc)
+{
+	try {
+		HeaderData dos(doc, 0, PE_DOS_HEADER_SIZE);
+		if(!dos.has(0, PE_DOS_HEADER_SIZE) || dos.u16(0) != 0x5A4D /* "MZ" */)
+		{
+			return false;
+		}
+		
+		HeaderData pe(doc, dos.u32(0x3C), 4);
+		return pe.has(0, 4) && pe.u32(0) == 0x00004550; /* "PE\0\0" */
+	}
+	catch(const std::runtime_error&)
+	{
+		return false;
+	}
+}
+
+REHex::Document::AnnotationBatch REHex::pe_annotate(const Document *doc)
+{
+	Document::AnnotationBatch batch;
+	
+	off_t file_length = doc->buffer_length();
+	
+	HeaderData dos(doc, 0, PE_DOS_HEADER_SIZE);
+	if(!dos.has(0, PE_DOS_HEADER_SIZE) || dos.u16(0) != 0x5A4D)
+	{
+		throw std::runtime_error("Not a PE file (no DOS header)");
+	}
+	
+	off_t pe_off = dos.u32(0x3C);
+	
+	batch.add_comment(0, PE_DOS_HEADER_SIZE, "DOS header");
+	add_field_types(batch, 0, PE_DOS_HEADER_SIZE, PE_DOS_HEADER_FIELDS, (sizeof(PE_DOS_HEADER_FIELDS) / sizeof(*PE_DOS_HEADER_FIELDS)), false);
+	
+	if(pe_off > PE_DOS_HEADER_SIZE && pe_off <= file_length)
+	{
+		batch.add_comment(PE_DOS_HEADER_SIZE, (pe_off - PE_DOS_HEADER_SIZE), "DOS stub");
+	}
+	
+	/* PE signature and COFF header. */
+	
+	HeaderData coff(doc, pe_off, (4 + PE_COFF_HEADER_SIZE));
+	if(!coff.has(0, 4 + PE_COFF_HEADER_SIZE) || coff.u32(0) != 0x00004550)
+	{
+		throw std::runtime_error("Not a PE file (no PE signature)");
+	}
+	
+	uint16_t machine          = coff.u16(4);
+	uint16_t n_sections       = coff.u16(6);
+	uint32_t timestamp        = coff.u32(8);
+	uint16_t opt_header_size  = coff.u16(20);
+	uint16_t characteristics  = coff.u16(22);
+	
+	const char *machine_label, *machine_triple;
+	pe_machine(machine, &machine_label, &machine_triple);
+	
+	std::string section_code_type = code_type(machine_triple);
+	
+	off_t opt_off = pe_off + 4 + PE_COFF_HEADER_SIZE;
+	off_t section_table_off = opt_off + opt_header_size;
+	
+	batch.add_comment(pe_off, (section_table_off - pe_off), "PE header");
+	batch.add_data_type(pe_off, 4, "u32le");
+	
+	batch.add_comment((pe_off + 4), PE_COFF_HEADER_SIZE,
+		"COFF header"
+		"\nMachine: " + (machine_label != NULL ? wxString(machine_label) : hex(machine))
+		+ "\nNumber of sections: " + wxString::Format("%u", (unsigned)(n_sections))
+		+ "\nTimestamp: " + wxString::Format("%u", (unsigned)(timestamp))
+		+ "\nCharacteristics: " + hex(characteristics));
+	
+	add_field_types(batch, (pe_off + 4), PE_COFF_HEADER_SIZE, PE_COFF_HEADER_FIELDS, (sizeof(PE_COFF_HEADER_FIELDS) / sizeof(*PE_COFF_HEADER_FIELDS)), false);
+	
+	/* Optional header. */
+	
+	uint64_t image_base = 0;
+	uint32_t entry_rva = 0;
+	uint32_t size_of_headers = 0;
+	
+	std::vector< std::pair<uint32_t, uint32_t> > data_dirs;
+	
+	if(opt_header_size > 0)
+	{
+		HeaderData opt(doc, opt_off, opt_header_size);
+		
+		uint16_t magic = opt.u16(0);
+		
+		off_t data_dirs_off;
+		
+		if(magic == PE_OPTIONAL_MAGIC_PE32)
+		{
+			entry_rva = opt.u32(16);
+			image_base = opt.u32(28);
+			size_of_headers = opt.u32(60);
+			data_dirs_off = 96;
+			
+			add_field_types(batch, opt_off, opt_header_size, PE32_OPTIONAL_HEADER_FIELDS, (sizeof(PE32_OPTIONAL_HEADER_FIELDS) / sizeof(*PE32_OPTIONAL_HEADER_FIELDS)), false);
+		}
+		else if(magic == PE_OPTIONAL_MAGIC_PE32PLUS)
+		{
+			entry_rva = opt.u32(16);
+			image_base = opt.u64(24);
+			size_of_headers = opt.u32(60);
+			data_dirs_off = 112;
+			
+			add_field_types(batch, opt_off, opt_header_size, PE32PLUS_OPTIONAL_HEADER_FIELDS, (sizeof(PE32PLUS_OPTIONAL_HEADER_FIELDS) / sizeof(*PE32PLUS_OPTIONAL_HEADER_FIELDS)), false);
+		}
+		else{
+			throw std::runtime_error("Unrecognised PE optional header magic");
+		}
+		
+		uint16_t subsystem = opt.u16(68);
+		uint32_t n_data_dirs = opt.u32(data_dirs_off - 4);
+		
+		for(uint32_t i = 0; i < n_data_dirs && i < PE_MAX_DATA_DIRECTORIES && opt.has((data_dirs_off + (i * 8)), 8); ++i)
+		{
+			data_dirs.push_back(std::make_pair(opt.u32(data_dirs_off + (i * 8)), opt.u32(data_dirs_off + (i * 8) + 4)));
+		}
+		
+		off_t data_dirs_len = std::min<off_t>((data_dirs.size() * 8), (opt_header_size - data_dirs_off));
+		if(data_dirs_len > 0)
+		{
+			batch.add_data_type((opt_off + data_dirs_off), data_dirs_len, "u32le");
+		}
+		
+		batch.add_comment(opt_off, opt_header_size,
+			wxString("Optional header (") + (magic == PE_OPTIONAL_MAGIC_PE32PLUS ? "PE32+" : "PE32") + ")"
+			+ "\nEntry point: " + hex(image_base + entry_rva)
+			+ "\nImage base: " + hex(image_base)
+			+ "\nSubsystem: " + wxString::Format("%u", (unsigned)(subsystem)));
+	}
+	
+	/* Section table. */
+	
+	HeaderData section_table(doc, section_table_off, ((off_t)(n_sections) * PE_SECTION_HEADER_SIZE));
+	std::vector<PESection> sections;
+	
+	for(unsigned i = 0; i < n_sections; ++i)
+	{
+		off_t sh_off = (off_t)(i) * PE_SECTION_HEADER_SIZE;
+		
+		PESection section;
+		section.name            = section_table.str(sh_off, 8);
+		section.virtual_size    = section_table.u32(sh_off + 8);
+		section.virtual_address = section_table.u32(sh_off + 12);
+		section.raw_size        = section_table.u32(sh_off + 16);
+		section.raw_offset      = section_table.u32(sh_off + 20);
+		section.characteristics = section_table.u32(sh_off + 36);
+		
+		sections.push_back(section);
+		
+		batch.add_comment((section_table_off + sh_off), PE_SECTION_HEADER_SIZE, "Section header " + wxString::Format("%u", i) + " (" + section.name + ")");
+		add_field_types(batch, (section_table_off + sh_off), PE_SECTION_HEADER_SIZE, PE_SECTION_HEADER_FIELDS, (sizeof(PE_SECTION_HEADER_FIELDS) / sizeof(*PE_SECTION_HEADER_FIELDS)), false);
+	}
+	
+	if(n_sections > 0)
+	{
+		batch.add_comment(section_table_off, ((off_t)(n_sections) * PE_SECTION_HEADER_SIZE), "Section table");
+	}
+	
+	/* The headers are mapped at the image base. */
+	
+	if(size_of_headers > 0 && virt_range_valid(image_base, 0, size_of_headers))
+	{
+		batch.add_virt_mapping(0, image_base, std::min<off_t>(size_of_headers, file_length));
+	}
+	
+	/* Section data. */
+	
+	for(auto s = sections.begin(); s != sections.end(); ++s)
+	{
+		if(s->raw_size == 0 || s->raw_offset == 0 || (off_t)(s->raw_offset) >= file_length)
+		{
+			continue;
+		}
+		
+		off_t section_off = s->raw_offset;
+		off_t section_len = std::min<off_t>(s->raw_size, (file_length - section_off));
+		
+		wxString comment_text = "Section " + s->name;
+		
+		if((s->characteristics & PE_SCN_CNT_CODE) != 0)
+		{
+			comment_text += "\n" + (machine_label != NULL ? wxString(machine_label) : hex(machine)) + " machine code";
+			
+			if(!section_code_type.empty())
+			{
+				/* Set a machine code data type on this section to enable inline disassembly. */
+				batch.add_data_type(section_off, section_len, section_code_type);
+			}
+		}
+		
+		comment_text += "\nVirtual address: " + hex(image_base + s->virtual_address);
+		comment_text += "\nVirtual size: " + hex(s->virtual_size);
+		
+		if((s->characteristics & (PE_SCN_MEM_EXECUTE | PE_SCN_MEM_READ | PE_SCN_MEM_WRITE)) != 0)
+		{
+			std::vector<const char*> access;
+			
+			if((s->characteristics & PE_SCN_MEM_EXECUTE) != 0) access.push_back("execute");
+			if((s->characteristics & PE_SCN_MEM_READ)    != 0) access.push_back("read");
+			if((s->characteristics & PE_SCN_MEM_WRITE)   != 0) access.push_back("write");
+			
+			comment_text += "\nMemory access: ";
+			
+			for(size_t i = 0; i < access.size(); ++i)
+			{
+				comment_text += (i > 0 ? ", " : "");
+				comment_text += access[i];
+			}
+		}
+		
+		batch.add_comment(section_off, section_len, comment_text);
+		
+		/* Any raw data beyond the virtual size is padding which isn't mapped. */
+		off_t mapped_len = s->virtual_size > 0
+			? std::min<off_t>(section_len, s->virtual_size)
+			: section_len;
+		
+		if(virt_range_valid(image_base, s->virtual_address, mapped_len))
+		{
+			batch.add_virt_mapping(section_off, (image_base + s->virtual_address), mapped_len);
+		}
+	}
+	
+	/* Converts an RVA range to a file offset, returns -1 if it isn't entirely within
+	 * the raw data of a single section.
+	*/
+	auto rva_to_offset = [&](uint32_t rva, uint32_t length) -> off_t
+	{
+		for(auto s = sections.begin(); s != sections.end(); ++s)
+		{
+			if(rva >= s->virtual_address && (uint64_t)(rva - s->virtual_address) + length <= s->raw_size && s->raw_offset != 0)
+			{
+				off_t offset = (off_t)(s->raw_offset) + (rva - s->virtual_address);
+				
+				if(offset + length <= file_length)
+				{
+					return offset;
+				}
+			}
+		}
+		
+		return -1;
+	};
+	
+	/* Data directories. */
+	
+	for(size_t i = 0; i < data_dirs.size(); ++i)
+	{
+		uint32_t dd_addr = data_dirs[i].first;
+		uint32_t dd_size = data_dirs[i].second;
+		
+		if(dd_addr == 0 || dd_size == 0)
+		{
+			continue;
+		}
+		
+		/* The certificate table is located by file offset rather than RVA. */
+		off_t dd_off = i == 4
+			? ((off_t)(dd_addr) + dd_size <= file_length ? (off_t)(dd_addr) : -1)
+			: rva_to_offset(dd_addr, dd_size);
+		
+		if(dd_off >= 0)
+		{
+			batch.add_comment(dd_off, dd_size, wxString(PE_DATA_DIRECTORY_NAMES[i]) + " directory");
+		}
+	}
+	
+	if(entry_rva != 0)
+	{
+		off_t entry_off = rva_to_offset(entry_rva, 0);
+		if(entry_off >= 0)
+		{
+			batch.add_comment(entry_off, 0, "Entry point");
+		}
+	}
+	
+	return batch;
+}
+
+/* --- ELF --- */
+
+static const uint8_t ELF_CLASS_32 = 1;
+static const uint8_t ELF_CLASS_64 = 2;
+
+static const uint8_t ELF_DATA_LSB = 1;
+static const uint8_t ELF_DATA_MSB = 2;
+
+static const off_t ELF_IDENT_SIZE = 16;
+static const off_t ELF32_HEADER_SIZE = 52;
+static const off_t ELF64_HEADER_SIZE = 64;
+static const off_t ELF32_PHDR_SIZE = 32;
+static const off_t ELF64_PHDR_SIZE = 56;
+static const off_t ELF32_SHDR_SIZE = 40;
+static const off_t ELF64_SHDR_SIZE = 64;
+
+static const FieldRun ELF32_HEADER_FIELDS[] = {
+	{  0, 16, 1 }, /* e_ident */
+	{ 16,  4, 2 }, /* e_type, e_machine */
+	{ 20, 20, 4 }, /* e_version, e_entry, e_phoff, e_shoff, e_flags */
+	{ 40, 12, 2 }, /* e_ehsize .. e_shstrndx */
+};
+
+static const FieldRun ELF64_HEADER_FIELDS[] = {
+	{  0, 16, 1 }, /* e_ident */
+	{ 16,  4, 2 }, /* e_type, e_machine */
+	{ 20,  4, 4 }, /* e_version */
+	{ 24, 24, 8 }, /* e_entry, e_phoff, e_shoff */
+	{ 48,  4, 4 }, /* e_flags */
+	{ 52, 12, 2 }, /* e_ehsize .. e_shstrndx */
+};
+
+static const FieldRun ELF32_PHDR_FIELDS[] = {
+	{ 0, 32, 4 }, /* p_type .. p_align */
+};
+
+static const FieldRun ELF64_PHDR_FIELDS[] = {
+	{ 0,  8, 4 }, /* p_type, p_flags */
+	{ 8, 48, 8 }, /* p_offset .. p_align */
+};
+
+static const FieldRun ELF32_SHDR_FIELDS[] = {
+	{ 0, 40, 4 }, /* sh_name .. sh_entsize */
+};
+
+static const FieldRun ELF64_SHDR_FIELDS[] = {
+	{  0,  8, 4 }, /* sh_name, sh_type */
+	{  8, 32, 8 }, /* sh_flags, sh_addr, sh_offset, sh_size */
+	{ 40,  8, 4 }, /* sh_link, sh_info */
+	{ 48, 16, 8 }, /* sh_addralign, sh_entsize */
+};
+
+static const uint32_t ELF_PT_LOAD = 1;
+
+static const uint32_t ELF_PF_X = 1;
+static const uint32_t ELF_PF_W = 2;
+static const uint32_t ELF_PF_R = 4;
+
+static const uint32_t ELF_SHT_NULL   = 0;
+static const uint32_t ELF_SHT_NOBITS = 8;
+
+static const uint64_t ELF_SHF_WRITE     = 1;
+static const uint64_t ELF_SHF_ALLOC     = 2;
+static const uint64_t ELF_SHF_EXECINSTR = 4;
+
+static const uint16_t ELF_SHN_UNDEF = 0;
+
+static wxString elf_type_name(uint16_t type)
+{
+	switch(type)
+	{
+		case 1:  return "REL (relocatable file)";
+		case 2:  return "EXEC (executable file)";
+		case 3:  return "DYN (shared object)";
+		case 4:  return "CORE (core file)";
+		default: return hex(type);
+	}
+}
+
+static void elf_machine(uint16_t machine, uint8_t elf_class, bool big_endian, const char **label, const char **triple)
+{
+	bool is_64 = elf_class == ELF_CLASS_64;
+	
+	switch(machine)
+	{
+		case 2:   *label = "SPARC";     *triple = "sparc";                                                break;
+		case 3:   *label = "x86";       *triple = "i386";                                                 break;
+		case 8:   *label = "MIPS";      *triple = is_64 ? (big_endian ? "mips64" : "mips64el") : (big_endian ? "mips" : "mipsel"); break;
+		case 20:  *label = "PowerPC";   *triple = "powerpc";                                              break;
+		case 21:  *label = "PowerPC64"; *triple = big_endian ? "powerpc64" : "powerpc64le";               break;
+		case 40:  *label = "ARM";       *triple = big_endian ? "armeb" : "arm";                           break;
+		case 43:  *label = "SPARC V9";  *triple = "sparcv9";                                              break;
+		case 62:  *label = "x86-64";    *triple = "x86_64";                                               break;
+		case 183: *label = "AArch64";   *triple = big_endian ? "aarch64_be" : "aarch64";                  break;
+		
+		default:
+			*label = NULL;
+			*triple = NULL;
+			break;
+	}
+}
+
+static wxString elf_segment_type_name(uint32_t type)
+{
+	switch(type)
+	{
+		case 0:          return "NULL";
+		case 1:          return "LOAD";
+		case 2:          return "DYNAMIC";
+		case 3:          return "INTERP";
+		case 4:          return "NOTE";
+		case 5:          return "SHLIB";
+		case 6:          return "PHDR";
+		case 7:          return "TLS";
+		case 0x6474E550: return "GNU_EH_FRAME";
+		case 0x6474E551: return "GNU_STACK";
+		case 0x6474E552: return "GNU_RELRO";
+		case 0x6474E553: return "GNU_PROPERTY";
+		default:         return hex(type);
+	}
+}
+
+static wxString elf_section_type_name(uint32_t type)
+{
+	switch(type)
+	{
+		case 0:          return "NULL";
+		case 1:          return "PROGBITS";
+		case 2:          return "SYMTAB";
+		case 3:          return "STRTAB";
+		case 4:          return "RELA";
+		case 5:          return "HASH";
+		case 6:          return "DYNAMIC";
+		case 7:          return "NOTE";
+		case 8:          return "NOBITS";
+		case 9:          return "REL";
+		case 10:         return "SHLIB";
+		case 11:         return "DYNSYM";
+		case 14:         return "INIT_ARRAY";
+		case 15:         return "FINI_ARRAY";
+		case 16:         return "PREINIT_ARRAY";
+		case 17:         return "GROUP";
+		case 18:         return "SYMTAB_SHNDX";
+		case 0x6FFFFFF6: return "GNU_HASH";
+		case 0x6FFFFFFD: return "VERDEF";
+		case 0x6FFFFFFE: return "VERNEED";
+		case 0x6FFFFFFF: return "VERSYM";
+		default:         return hex(type);
+	}
+}
+
+static wxString elf_access(bool read, bool write, bool execute)
+{
+	wxString s;
+	
+	if(read)    s += "read";
+	if(write)   s += wxString(s.empty() ? "" : ", ") + "write";
+	if(execute) s += wxString(s.empty() ? "" : ", ") + "execute";
+	
+	return s;
+}
+
+struct ELFSegment
+{
+	uint32_t type;
+	uint32_t flags;
+	uint64_t offset;
+	uint64_t vaddr;
+	uint64_t filesz;
+	uint64_t memsz;
+};
+
+struct ELFSection
+{
+	uint32_t name;
+	uint32_t type;
+	uint64_t flags;
+	uint64_t addr;
+	uint64_t offset;
+	uint64_t size;
+};
+
+bool REHex::elf_probe(const Document *doc)
+{
+	HeaderData ident(doc, 0, ELF_IDENT_SIZE);
+	
+	return ident.has(0, ELF_IDENT_SIZE)
+		&& ident.u8(0) == 0x7F && ident.u8(1) == 'E' && ident.u8(2) == 'L' && ident.u8(3) == 'F'
+		&& (ident.u8(4) == ELF_CLASS_32 || ident.u8(4) == ELF_CLASS_64)
+		&& (ident.u8(5) == ELF_DATA_LSB || ident.u8(5) == ELF_DATA_MSB);
+}
+
+REHex::Document::AnnotationBatch REHex::elf_annotate(const Document *doc)
+{
+	Document::AnnotationBatch batch;
+	
+	if(!elf_probe(doc))
+	{
+		throw std::runtime_error("Not an ELF file");
+	}
+	
+	off_t file_length = doc->buffer_length();
+	
+	HeaderData ident(doc, 0, ELF_IDENT_SIZE);
+	uint8_t elf_class = ident.u8(4);
+	bool big_endian = ident.u8(5) == ELF_DATA_MSB;
+	bool is_64 = elf_class == ELF_CLASS_64;
+	
+	off_t header_size = is_64 ? ELF64_HEADER_SIZE : ELF32_HEADER_SIZE;
+	
+	HeaderData eh(doc, 0, header_size, big_endian);
+	if(!eh.has(0, header_size))
+	{
+		throw std::runtime_error("Unexpected end of file");
+	}
+	
+	uint16_t e_type    = eh.u16(16);
+	uint16_t e_machine = eh.u16(18);
+	
+	uint64_t e_entry, e_phoff, e_shoff;
+	off_t sizes_off;
+	
+	if(is_64)
+	{
+		e_entry = eh.u64(24);
+		e_phoff = eh.u64(32);
+		e_shoff = eh.u64(40);
+		sizes_off = 52;
+	}
+	else{
+		e_entry = eh.u32(24);
+		e_phoff = eh.u32(28);
+		e_shoff = eh.u32(32);
+		sizes_off = 40;
+	}
+	
+	uint16_t e_ehsize    = eh.u16(sizes_off);
+	uint16_t e_phentsize = eh.u16(sizes_off + 2);
+	uint16_t e_phnum     = eh.u16(sizes_off + 4);
+	uint16_t e_shentsize = eh.u16(sizes_off + 6);
+	uint16_t e_shnum     = eh.u16(sizes_off + 8);
+	uint16_t e_shstrndx  = eh.u16(sizes_off + 10);
+	
+	const char *machine_label, *machine_triple;
+	elf_machine(e_machine, elf_class, big_endian, &machine_label, &machine_triple);
+	
+	std::string section_code_type = code_type(machine_triple);
+	
+	batch.add_comment(0, std::max<off_t>(e_ehsize, header_size),
+		wxString("ELF header")
+		+ "\nClass: " + (is_64 ? "ELF64" : "ELF32")
+		+ "\nData: " + (big_endian ? "big endian" : "little endian")
+		+ "\nType: " + elf_type_name(e_type)
+		+ "\nMachine: " + (machine_label != NULL ? wxString(machine_label) : hex(e_machine))
+		+ "\nEntry point: " + hex(e_entry));
+	
+	if(is_64)
+	{
+		add_field_types(batch, 0, header_size, ELF64_HEADER_FIELDS, (sizeof(ELF64_HEADER_FIELDS) / sizeof(*ELF64_HEADER_FIELDS)), big_endian);
+	}
+	else{
+		add_field_types(batch, 0, header_size, ELF32_HEADER_FIELDS, (sizeof(ELF32_HEADER_FIELDS) / sizeof(*ELF32_HEADER_FIELDS)), big_endian);
+	}
+	
+	/* Program header table. */
+	
+	off_t phdr_size = is_64 ? ELF64_PHDR_SIZE : ELF32_PHDR_SIZE;
+	std::vector<ELFSegment> segments;
+	
+	if(e_phoff != 0 && e_phnum > 0 && e_phentsize >= phdr_size && e_phoff < (uint64_t)(file_length))
+	{
+		HeaderData ph_table(doc, e_phoff, ((off_t)(e_phnum) * e_phentsize), big_endian);
+		
+		for(unsigned i = 0; i < e_phnum && ph_table.has(((off_t)(i) * e_phentsize), phdr_size); ++i)
+		{
+			off_t ph_off = (off_t)(i) * e_phentsize;
+			
+			ELFSegment seg;
+			
+			if(is_64)
+			{
+				seg.type   = ph_table.u32(ph_off);
+				seg.flags  = ph_table.u32(ph_off + 4);
+				seg.offset = ph_table.u64(ph_off + 8);
+				seg.vaddr  = ph_table.u64(ph_off + 16);
+				seg.filesz = ph_table.u64(ph_off + 32);
+				seg.memsz  = ph_table.u64(ph_off + 40);
+				
+				add_field_types(batch, (e_phoff + ph_off), phdr_size, ELF64_PHDR_FIELDS, (sizeof(ELF64_PHDR_FIELDS) / sizeof(*ELF64_PHDR_FIELDS)), big_endian);
+			}
+			else{
+				seg.type   = ph_table.u32(ph_off);
+				seg.offset = ph_table.u32(ph_off + 4);
+				seg.vaddr  = ph_table.u32(ph_off + 8);
+				seg.filesz = ph_table.u32(ph_off + 16);
+				seg.memsz  = ph_table.u32(ph_off + 20);
+				seg.flags  = ph_table.u32(ph_off + 24);
+				
+				add_field_types(batch, (e_phoff + ph_off), phdr_size, ELF32_PHDR_FIELDS, (sizeof(ELF32_PHDR_FIELDS) / sizeof(*ELF32_PHDR_FIELDS)), big_endian);
+			}
+			
+			segments.push_back(seg);
+			
+			batch.add_comment((e_phoff + ph_off), e_phentsize,
+				"Program header " + wxString::Format("%u", i)
+				+ "\nType: " + elf_segment_type_name(seg.type)
+				+ "\nOffset: " + hex(seg.offset)
+				+ "\nVirtual address: " + hex(seg.vaddr)
+				+ "\nFile size: " + hex(seg.filesz)
+				+ "\nMemory size: " + hex(seg.memsz)
+				+ "\nMemory access: " + elf_access(((seg.flags & ELF_PF_R) != 0), ((seg.flags & ELF_PF_W) != 0), ((seg.flags & ELF_PF_X) != 0)));
+		}
+		
+		if(!segments.empty())
+		{
+			batch.add_comment(e_phoff, ((off_t)(segments.size()) * e_phentsize), "Program header table");
+		}
+	}
+	
+	/* Section header table. */
+	
+	off_t shdr_size = is_64 ? ELF64_SHDR_SIZE : ELF32_SHDR_SIZE;
+	std::vector<ELFSection> sections;
+	
+	if(e_shoff != 0 && e_shnum > 0 && e_shentsize >= shdr_size && e_shoff < (uint64_t)(file_length))
+	{
+		HeaderData sh_table(doc, e_shoff, ((off_t)(e_shnum) * e_shentsize), big_endian);
+		
+		for(unsigned i = 0; i < e_shnum && sh_table.has(((off_t)(i) * e_shentsize), shdr_size); ++i)
+		{
+			off_t sh_off = (off_t)(i) * e_shentsize;
+			
+			ELFSection section;
+			
+			if(is_64)
+			{
+				section.name   = sh_table.u32(sh_off);
+				section.type   = sh_table.u32(sh_off + 4);
+				section.flags  = sh_table.u64(sh_off + 8);
+				section.addr   = sh_table.u64(sh_off + 16);
+				section.offset = sh_table.u64(sh_off + 24);
+				section.size   = sh_table.u64(sh_off + 32);
+			}
+			else{
+				section.name   = sh_table.u32(sh_off);
+				section.type   = sh_table.u32(sh_off + 4);
+				section.flags  = sh_table.u32(sh_off + 8);
+				section.addr   = sh_table.u32(sh_off + 12);
+				section.offset = sh_table.u32(sh_off + 16);
+				section.size   = sh_table.u32(sh_off + 20);
+			}
+			
+			sections.push_back(section);
+		}
+	}
+	
+	/* Section names, read in one go from the section name string table. */
+	
+	std::vector<std::string> section_names(sections.size());
+	
+	if(e_shstrndx != ELF_SHN_UNDEF && e_shstrndx < sections.size() && sections[e_shstrndx].type != ELF_SHT_NOBITS)
+	{
+		const ELFSection &shstrtab = sections[e_shstrndx];
+		
+		if(shstrtab.offset < (uint64_t)(file_length))
+		{
+			off_t shstrtab_len = std::min<uint64_t>(shstrtab.size, (file_length - shstrtab.offset));
+			HeaderData strtab(doc, shstrtab.offset, shstrtab_len);
+			
+			for(size_t i = 0; i < sections.size(); ++i)
+			{
+				section_names[i] = strtab.str(sections[i].name, shstrtab_len);
+			}
+		}
+	}
+	
+	for(size_t i = 0; i < sections.size(); ++i)
+	{
+		off_t sh_off = e_shoff + ((off_t)(i) * e_shentsize);
+		
+		batch.add_comment(sh_off, e_shentsize,
+			"Section header " + wxString::Format("%u", (unsigned)(i))
+			+ (section_names[i].empty() ? wxString("") : wxString(" (" + section_names[i] + ")"))
+			+ "\nType: " + elf_section_type_name(sections[i].type));
+		
+		if(is_64)
+		{
+			add_field_types(batch, sh_off, shdr_size, ELF64_SHDR_FIELDS, (sizeof(ELF64_SHDR_FIELDS) / sizeof(*ELF64_SHDR_FIELDS)), big_endian);
+		}
+		else{
+			add_field_types(batch, sh_off, shdr_size, ELF32_SHDR_FIELDS, (sizeof(ELF32_SHDR_FIELDS) / sizeof(*ELF32_SHDR_FIELDS)), big_endian);
+		}
+	}
+	
+	if(!sections.empty())
+	{
+		batch.add_comment(e_shoff, ((off_t)(sections.size()) * e_shentsize), "Section header table");
+	}
+	
+	/* Section data. */
+	
+	for(size_t i = 0; i < sections.size(); ++i)
+	{
+		const ELFSection &section = sections[i];
+		
+		if(section.type == ELF_SHT_NULL || section.type == ELF_SHT_NOBITS || section.size == 0 || section.offset >= (uint64_t)(file_length))
+		{
+			continue;
+		}
+		
+		off_t section_off = section.offset;
+		off_t section_len = std::min<uint64_t>(section.size, (file_length - section.offset));
+		
+		wxString comment_text = "Section " + section_names[i];
+		comment_text += "\nType: " + elf_section_type_name(section.type);
+		
+		if((section.flags & ELF_SHF_EXECINSTR) != 0)
+		{
+			comment_text += "\n" + (machine_label != NULL ? wxString(machine_label) : hex(e_machine)) + " machine code";
+			
+			if(!section_code_type.empty())
+			{
+				/* Set a machine code data type on this section to enable inline disassembly. */
+				batch.add_data_type(section_off, section_len, section_code_type);
+			}
+		}
+		
+		if((section.flags & ELF_SHF_ALLOC) != 0)
+		{
+			comment_text += "\nVirtual address: " + hex(section.addr);
+			comment_text += "\nMemory access: " + elf_access(true, ((section.flags & ELF_SHF_WRITE) != 0), ((section.flags & ELF_SHF_EXECINSTR) != 0));
+		}
+		
+		comment_text += "\nSize: " + hex(section.size);
+		
+		batch.add_comment(section_off, section_len, comment_text);
+	}
+	
+	/* Loadable segments. */
+	
+	off_t entry_off = -1;
+	
+	for(auto seg = segments.begin(); seg != segments.end(); ++seg)
+	{
+		if(seg->type != ELF_PT_LOAD || seg->offset >= (uint64_t)(file_length))
+		{
+			continue;
+		}
+		
+		/* Only the part of the segment present in the file (and in memory) can be mapped. */
+		off_t seg_len = std::min<uint64_t>(std::min(seg->filesz, seg->memsz), (file_length - seg->offset));
+		
+		if(seg_len > 0 && virt_range_valid(seg->vaddr, 0, seg_len))
+		{
+			batch.add_virt_mapping(seg->offset, seg->vaddr, seg_len);
+			
+			if(e_entry >= seg->vaddr && e_entry < (seg->vaddr + seg_len) && entry_off < 0)
+			{
+				entry_off = seg->offset + (e_entry - seg->vaddr);
+			}
+		}
+	}
+	
+	if(entry_off >= 0)
+	{
+		batch.add_comment(entry_off, 0, "Entry point");
+	}
+	
+	return batch;
+}
+
+bool REHex::annotate_executable(Document *doc)
+{
+	if(pe_probe(doc))
+	{
+		doc->apply_annotations(pe_annotate(doc), "analyse PE headers");
+		return true;
+	}
+	else if(elf_probe(doc))
+	{
+		doc->apply_annotations(elf_annotate(doc), "analyse ELF headers");
+		return true;
+	}
+	else{
+		return false;
+	}
+}
+
+static void annotate_document(wxWindow *parent, REHex::Document *doc)
+{
+	try {
+		if(!REHex::annotate_executable(doc))
+		{
+			wxMessageBox("The file is not a recognised executable format (PE or ELF)", "Analyse executable", (wxOK | wxICON_ERROR), parent);
+		}
+	}
+	catch(const std::exception &e)
+	{
+		wxMessageBox((std::string("Error parsing executable headers: ") + e.what()), "Analyse executable", (wxOK | wxICON_ERROR), parent);
+	}
+}
+
+static REHex::MainWindow::SetupHookRegistration tools_menu_hook(
+	REHex::MainWindow::SetupPhase::TOOLS_MENU_BOTTOM,
+	[](REHex::MainWindow *window)
+	{
+		wxMenuItem *item = window->get_tools_menu()->Append(wxID_ANY, "Analyse executable (PE/ELF)");
+		
+		window->Bind(wxEVT_MENU, [window](wxCommandEvent &event)
+		{
+			REHex::Document *doc = window->active_document();
+			if(doc != NULL)
+			{
+				annotate_document(window, doc);
+			}
+		}, item->GetId());
+	});
+
+static REHex::MainWindow::SetupHookRegistration tab_created_hook(
+	REHex::MainWindow::SetupPhase::DONE,
+	[](REHex::MainWindow *window)
+	{
+		window->Bind(REHex::TAB_CREATED, [window](REHex::TabCreatedEvent &event)
+		{
+			event.Skip(); /* Continue propagation */
+			
+			REHex::Document *doc = event.tab->doc;
+			
+			if(!doc->get_comments().empty())
+			{
+				/* Don't offer to analyse if there are any comments. */
+				return;
+			}
+			
+			wxFileName filename(doc->get_filename());
+			wxString ext = filename.GetExt().Lower();
+			
+			if((ext == "exe" || ext == "dll") && REHex::pe_probe(doc))
+			{
+				wxString message = filename.GetFullName() + " might be a PE EXE/DLL, attempt to analyse?";
+				
+				if(wxMessageBox(message, "Analyse PE file", wxYES_NO, window) == wxYES)
+				{
+					annotate_document(window, doc);
+				}
+			}
+		});
+	});
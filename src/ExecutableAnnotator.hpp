@@ -0,0 +1,66 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_EXECUTABLEANNOTATOR_HPP
+#define REHEX_EXECUTABLEANNOTATOR_HPP
+
+#include "document.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Check if a Document looks like a PE (EXE/DLL) file.
+	*/
+	bool pe_probe(const Document *doc);
+	
+	/**
+	 * @brief Parse the headers of a PE (EXE/DLL) file.
+	 *
+	 * Returns comments and data types describing the DOS, COFF and optional headers,
+	 * section table and data directories, machine code data types for executable
+	 * sections and virtual address mappings for the headers and each section.
+	 *
+	 * Throws std::runtime_error if the file isn't a valid PE file.
+	*/
+	Document::AnnotationBatch pe_annotate(const Document *doc);
+	
+	/**
+	 * @brief Check if a Document looks like an ELF file.
+	*/
+	bool elf_probe(const Document *doc);
+	
+	/**
+	 * @brief Parse the headers of an ELF file.
+	 *
+	 * Returns comments and data types describing the ELF header, program header
+	 * table and section header table, comments and machine code data types for each
+	 * section and virtual address mappings for each loadable segment.
+	 *
+	 * Throws std::runtime_error if the file isn't a valid ELF file.
+	*/
+	Document::AnnotationBatch elf_annotate(const Document *doc);
+	
+	/**
+	 * @brief Detect the format of an executable and apply annotations to it.
+	 *
+	 * Returns false if the file isn't in a recognised format. Throws
+	 * std::runtime_error if the headers can't be parsed.
+	*/
+	bool annotate_executable(Document *doc);
+}
+
+#endif /* !REHEX_EXECUTABLEANNOTATOR_HPP */
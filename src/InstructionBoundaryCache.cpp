@@ -0,0 +1,226 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <map>
+
+#include "InstructionBoundaryCache.hpp"
+
+const off_t REHex::InstructionBoundaryCache::BUCKET_SIZE;
+const off_t REHex::InstructionBoundaryCache::CHECKPOINT_INTERVAL;
+const unsigned char REHex::InstructionBoundaryCache::NO_BOUNDARY;
+
+REHex::InstructionBoundaryCache::InstructionBoundaryCache(SharedDocumentPointer &document, cs_arch arch, cs_mode mode):
+	document(document),
+	arch(arch),
+	mode(mode)
+{
+	buckets.reset(new CheckpointBuckets(BUCKET_SIZE, [this](off_t bucket_base, std::vector<unsigned char> *checkpoints) { process_bucket(bucket_base, checkpoints); }));
+	
+	/* The cache is a convenience for interactive use, so don't compete with the rest of
+	 * the application for CPU time.
+	*/
+	buckets->set_max_threads(1);
+	
+	this->document.auto_cleanup_bind(DATA_ERASE,     &REHex::InstructionBoundaryCache::OnDataErase,     this);
+	this->document.auto_cleanup_bind(DATA_INSERT,    &REHex::InstructionBoundaryCache::OnDataInsert,    this);
+	this->document.auto_cleanup_bind(DATA_OVERWRITE, &REHex::InstructionBoundaryCache::OnDataOverwrite, this);
+	
+	this->document.auto_cleanup_bind(DATA_ERASING,        &REHex::InstructionBoundaryCache::OnDataModifying,     this);
+	this->document.auto_cleanup_bind(DATA_ERASE_ABORTED,  &REHex::InstructionBoundaryCache::OnDataModifyAborted, this);
+	this->document.auto_cleanup_bind(DATA_INSERTING,      &REHex::InstructionBoundaryCache::OnDataModifying,     this);
+	this->document.auto_cleanup_bind(DATA_INSERT_ABORTED, &REHex::InstructionBoundaryCache::OnDataModifyAborted, this);
+	
+	buckets->queue_range(0, document->buffer_length());
+}
+
+REHex::InstructionBoundaryCache::~InstructionBoundaryCache()
+{
+	/* Stop the worker threads before anything they use is destroyed. */
+	buckets.reset(NULL);
+}
+
+off_t REHex::InstructionBoundaryCache::find_boundary(off_t from, off_t to) const
+{
+	if(from < 0)
+	{
+		from = 0;
+	}
+	
+	off_t result = -1;
+	
+	buckets->with_buckets([&](const std::map< off_t, std::vector<unsigned char> > &checkpoints)
+	{
+		for(off_t bucket_base = from - (from % BUCKET_SIZE); bucket_base < to; bucket_base += BUCKET_SIZE)
+		{
+			auto b = checkpoints.find(bucket_base);
+			if(b == checkpoints.end())
+			{
+				continue;
+			}
+			
+			off_t first_interval = std::max<off_t>(((from - bucket_base) / CHECKPOINT_INTERVAL), 0);
+			
+			for(size_t i = first_interval; i < b->second.size(); ++i)
+			{
+				if(b->second[i] == NO_BOUNDARY)
+				{
+					continue;
+				}
+				
+				off_t boundary = bucket_base + ((off_t)(i) * CHECKPOINT_INTERVAL) + b->second[i];
+				
+				if(boundary >= to)
+				{
+					return;
+				}
+				else if(boundary >= from)
+				{
+					result = boundary;
+					return;
+				}
+			}
+		}
+	});
+	
+	return result;
+}
+
+void REHex::InstructionBoundaryCache::set_focus(const ByteRangeSet &focus)
+{
+	buckets->set_focus(focus);
+}
+
+void REHex::InstructionBoundaryCache::wait_for_completion()
+{
+	buckets->wait_for_completion();
+}
+
+void REHex::InstructionBoundaryCache::process_bucket(off_t bucket_base, std::vector<unsigned char> *checkpoints)
+{
+	off_t bucket_end = bucket_base + BUCKET_SIZE;
+	
+	/* Instructions starting within the bucket are recorded, but we start a little earlier
+	 * so that the instruction boundaries are right by the time we reach the bucket.
+	*/
+	
+	off_t decode_base = std::max<off_t>(0, (bucket_base - CheckpointBuckets::RESYNC_LEAD));
+	
+	std::vector<unsigned char> data;
+	try {
+		data = document->read_data(decode_base, ((bucket_end + CheckpointBuckets::MAX_INSN_LEN) - decode_base));
+	}
+	catch(const std::exception &e)
+	{
+		/* Document has probably been truncated under us, it will be requeued. */
+		return;
+	}
+	
+	if((decode_base + (off_t)(data.size())) <= bucket_base)
+	{
+		/* Bucket is beyond the end of the document. */
+		return;
+	}
+	
+	csh disassembler;
+	if(cs_open(arch, mode, &disassembler) != CS_ERR_OK)
+	{
+		return;
+	}
+	
+	/* Keep going over anything which doesn't decode, like a linear sweep would. */
+	cs_option(disassembler, CS_OPT_SKIPDATA, CS_OPT_ON);
+	
+	checkpoints->assign((BUCKET_SIZE / CHECKPOINT_INTERVAL), NO_BOUNDARY);
+	
+	const uint8_t *code = data.data();
+	size_t code_size = data.size();
+	uint64_t address = decode_base;
+	cs_insn *insn = cs_malloc(disassembler);
+	
+	/* NOTE: @code, @code_size & @address variables are all updated! */
+	while(cs_disasm_iter(disassembler, &code, &code_size, &address, insn))
+	{
+		off_t insn_offset = insn->address;
+		
+		if(insn_offset >= bucket_end)
+		{
+			break;
+		}
+		
+		if(insn_offset < bucket_base || insn->id == 0)
+		{
+			/* Lead-in or data skipped over by Capstone. */
+			continue;
+		}
+		
+		off_t bucket_rel = insn_offset - bucket_base;
+		unsigned char &checkpoint = (*checkpoints)[ bucket_rel / CHECKPOINT_INTERVAL ];
+		
+		if(checkpoint == NO_BOUNDARY)
+		{
+			checkpoint = bucket_rel % CHECKPOINT_INTERVAL;
+		}
+	}
+	
+	cs_free(insn, 1);
+	cs_close(&disassembler);
+}
+
+void REHex::InstructionBoundaryCache::OnDataModifying(OffsetLengthEvent &event)
+{
+	buckets->pause_threads();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::InstructionBoundaryCache::OnDataModifyAborted(OffsetLengthEvent &event)
+{
+	buckets->resume_threads();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::InstructionBoundaryCache::OnDataErase(OffsetLengthEvent &event)
+{
+	buckets->data_moved(event.offset, document->buffer_length());
+	buckets->resume_threads();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::InstructionBoundaryCache::OnDataInsert(OffsetLengthEvent &event)
+{
+	buckets->data_moved(event.offset, document->buffer_length());
+	buckets->resume_threads();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::InstructionBoundaryCache::OnDataOverwrite(OffsetLengthEvent &event)
+{
+	buckets->queue_overwrite(event.offset, event.length);
+	
+	/* Continue propogation. */
+	event.Skip();
+}
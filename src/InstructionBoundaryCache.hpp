@@ -0,0 +1,114 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_INSTRUCTIONBOUNDARYCACHE_HPP
+#define REHEX_INSTRUCTIONBOUNDARYCACHE_HPP
+
+#include <capstone/capstone.h>
+#include <memory>
+#include <vector>
+#include <wx/event.h>
+
+#include "ByteRangeSet.hpp"
+#include "CodeBuckets.hpp"
+#include "document.hpp"
+#include "Events.hpp"
+#include "SharedDocumentPointer.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Cache of known instruction boundaries in a Document for one architecture.
+	 *
+	 * The whole document is disassembled on a background thread and the offset of the
+	 * first instruction starting in each CHECKPOINT_INTERVAL bytes is recorded, so a
+	 * disassembly of any part of the file can start from a nearby offset which is known
+	 * to be in step with a linear sweep of the code rather than having to guess.
+	 *
+	 * Only one offset per interval is kept, so the cache uses around one byte for every
+	 * CHECKPOINT_INTERVAL bytes of the document.
+	 *
+	 * The cache is split into fixed size buckets which are analysed independently, any
+	 * changes to the data cause the affected buckets to be analysed again.
+	*/
+	class InstructionBoundaryCache: public wxEvtHandler
+	{
+		public:
+			/**
+			 * @brief Size of each bucket in the cache, in bytes.
+			*/
+			static const off_t BUCKET_SIZE = 64 * 1024;
+			
+			/**
+			 * @brief Distance between checkpoints within a bucket, in bytes.
+			*/
+			static const off_t CHECKPOINT_INTERVAL = 64;
+			
+			InstructionBoundaryCache(SharedDocumentPointer &document, cs_arch arch, cs_mode mode);
+			virtual ~InstructionBoundaryCache();
+			
+			/**
+			 * @brief Find the first known instruction boundary within a range.
+			 *
+			 * Returns the offset of the first cached instruction boundary which is
+			 * at least from and less than to, or -1 if there isn't one or the range
+			 * hasn't been analysed yet.
+			*/
+			off_t find_boundary(off_t from, off_t to) const;
+			
+			/**
+			 * @brief Set the ranges of the file to analyse first.
+			 *
+			 * @see RangeProcessor::set_focus()
+			*/
+			void set_focus(const ByteRangeSet &focus);
+			
+			/**
+			 * @brief Wait for all queued analysis to finish.
+			 *
+			 * This is mostly intended for unit tests. This should not be used from the
+			 * application UI thread.
+			*/
+			void wait_for_completion();
+		
+		private:
+			/* Checkpoint value for intervals with no instruction starting in them. */
+			static const unsigned char NO_BOUNDARY = 0xFF;
+			
+			SharedDocumentPointer document;
+			
+			const cs_arch arch;
+			const cs_mode mode;
+			
+			typedef CodeBuckets< std::vector<unsigned char> > CheckpointBuckets;
+			
+			/* Offset of the first instruction in each interval of each bucket, relative
+			 * to the start of the interval.
+			*/
+			std::unique_ptr<CheckpointBuckets> buckets;
+			
+			void process_bucket(off_t bucket_base, std::vector<unsigned char> *checkpoints);
+			
+			void OnDataModifying(OffsetLengthEvent &event);
+			void OnDataModifyAborted(OffsetLengthEvent &event);
+			void OnDataErase(OffsetLengthEvent &event);
+			void OnDataInsert(OffsetLengthEvent &event);
+			void OnDataOverwrite(OffsetLengthEvent &event);
+	};
+}
+
+#endif /* !REHEX_INSTRUCTIONBOUNDARYCACHE_HPP */
@@ -0,0 +1,176 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "App.hpp"
+#include "KnownBlockScan.hpp"
+
+const off_t REHex::KnownBlockScan::DEFAULT_CHUNK_SIZE;
+
+REHex::KnownBlockScan::KnownBlockScan(SharedDocumentPointer &document, const std::shared_ptr<const KnownBlockSet> &set, off_t offset, off_t length, off_t chunk_size):
+	document(document),
+	set(set),
+	offset(offset),
+	length(length),
+	block_size(set->get_block_size()),
+	chunk_blocks(std::max<off_t>((chunk_size / set->get_block_size()), 1)),
+	num_blocks((length + block_size - 1) / block_size),
+	num_chunks((num_blocks + chunk_blocks - 1) / chunk_blocks),
+	next_chunk(0),
+	chunks_done(0),
+	blocks_done(0),
+	known_blocks(0)
+{
+	assert(offset >= 0);
+	assert(length >= 0);
+	assert(chunk_size > 0);
+	
+	if(num_chunks > 0)
+	{
+		task.reset(new ThreadPool::TaskHandle(wxGetApp().thread_pool->queue_task([this]()
+		{
+			return process_next_chunk();
+		}, -1)));
+	}
+}
+
+REHex::KnownBlockScan::~KnownBlockScan()
+{
+	if(task)
+	{
+		task->finish();
+		task->join();
+	}
+}
+
+off_t REHex::KnownBlockScan::get_offset() const
+{
+	return offset;
+}
+
+off_t REHex::KnownBlockScan::get_length() const
+{
+	return length;
+}
+
+size_t REHex::KnownBlockScan::get_num_blocks() const
+{
+	return num_blocks;
+}
+
+size_t REHex::KnownBlockScan::get_blocks_done() const
+{
+	return blocks_done;
+}
+
+size_t REHex::KnownBlockScan::get_known_blocks() const
+{
+	return known_blocks;
+}
+
+bool REHex::KnownBlockScan::is_complete() const
+{
+	return chunks_done == num_chunks;
+}
+
+void REHex::KnownBlockScan::wait_for_completion()
+{
+	if(task)
+	{
+		task->join();
+		task.reset(NULL);
+	}
+}
+
+REHex::ByteRangeSet REHex::KnownBlockScan::get_known_ranges() const
+{
+	std::lock_guard<std::mutex> kl(known_lock);
+	return known;
+}
+
+bool REHex::KnownBlockScan::process_next_chunk()
+{
+	size_t chunk_idx = next_chunk.fetch_add(1);
+	if(chunk_idx >= num_chunks)
+	{
+		return true;
+	}
+	
+	try {
+		process_chunk(chunk_idx);
+	}
+	catch(const std::exception &e)
+	{
+		/* Document has probably been truncated under us, whoever is using the scan will
+		 * throw it away when they see the change.
+		*/
+		fprintf(stderr, "Exception in REHex::KnownBlockScan::process_chunk: %s\n", e.what());
+	}
+	
+	++chunks_done;
+	
+	return false;
+}
+
+void REHex::KnownBlockScan::process_chunk(size_t chunk_idx)
+{
+	size_t first_block = chunk_idx * chunk_blocks;
+	size_t count = std::min<size_t>(chunk_blocks, (num_blocks - first_block));
+	
+	off_t chunk_base = offset + ((off_t)(first_block) * block_size);
+	off_t chunk_end = std::min((chunk_base + ((off_t)(count) * block_size)), (offset + length));
+	
+	std::vector<unsigned char> data = document->read_data(chunk_base, (chunk_end - chunk_base));
+	if(data.size() < (size_t)(chunk_end - chunk_base))
+	{
+		throw std::runtime_error("Unexpected end of file");
+	}
+	
+	/* Only the last block of the range can be short, pad it out like the builder does. */
+	data.resize(count * block_size, 0);
+	
+	ByteRangeSet chunk_known;
+	size_t chunk_known_blocks = 0;
+	
+	for(size_t i = 0; i < count; ++i)
+	{
+		if(set->contains(KnownBlockSet::hash_block((data.data() + (i * block_size)), block_size)))
+		{
+			off_t block_offset = chunk_base + ((off_t)(i) * block_size);
+			chunk_known.set_range(block_offset, std::min(block_size, (chunk_end - block_offset)));
+			
+			++chunk_known_blocks;
+		}
+	}
+	
+	if(!chunk_known.empty())
+	{
+		std::lock_guard<std::mutex> kl(known_lock);
+		known.set_ranges(chunk_known.begin(), chunk_known.end());
+	}
+	
+	known_blocks += chunk_known_blocks;
+	blocks_done += count;
+}
@@ -0,0 +1,132 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_KNOWNBLOCKSCAN_HPP
+#define REHEX_KNOWNBLOCKSCAN_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <sys/types.h>
+
+#include "ByteRangeSet.hpp"
+#include "KnownBlockSet.hpp"
+#include "SharedDocumentPointer.hpp"
+#include "ThreadPool.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Finds the blocks of a Document which are in a KnownBlockSet.
+	 *
+	 * The range is split into blocks of the set's block size, each one is hashed and
+	 * looked up in the set, and the ones which are found are collected into a set of
+	 * known ranges (adjacent blocks merged together). A short final block is padded
+	 * with zeros, the same as the last block of each file in the set.
+	 *
+	 * The blocks are processed in chunks on the ThreadPool when the scan is created and
+	 * the known ranges can be read back as they are found. The scan doesn't follow
+	 * changes to the document, a new one must be created if the data is modified.
+	*/
+	class KnownBlockScan
+	{
+		public:
+			/**
+			 * @brief Default number of bytes scanned by each worker at a time.
+			*/
+			static const off_t DEFAULT_CHUNK_SIZE = 4 * 1024 * 1024;
+			
+			/**
+			 * @brief Start scanning a range of a Document.
+			 *
+			 * @param document    Document to read data from.
+			 * @param set         Set of known block hashes.
+			 * @param offset      Offset of the first block.
+			 * @param length      Length of the range to scan.
+			 * @param chunk_size  Number of bytes scanned by a worker at a time.
+			*/
+			KnownBlockScan(SharedDocumentPointer &document, const std::shared_ptr<const KnownBlockSet> &set, off_t offset, off_t length, off_t chunk_size = DEFAULT_CHUNK_SIZE);
+			
+			~KnownBlockScan();
+			
+			KnownBlockScan(const KnownBlockScan&) = delete;
+			KnownBlockScan &operator=(const KnownBlockScan&) = delete;
+			
+			off_t get_offset() const;
+			off_t get_length() const;
+			
+			/**
+			 * @brief Get the number of blocks in the range.
+			*/
+			size_t get_num_blocks() const;
+			
+			/**
+			 * @brief Get the number of blocks scanned so far.
+			*/
+			size_t get_blocks_done() const;
+			
+			/**
+			 * @brief Get the number of blocks found in the set so far.
+			*/
+			size_t get_known_blocks() const;
+			
+			/**
+			 * @brief Check if every block has been scanned.
+			*/
+			bool is_complete() const;
+			
+			/**
+			 * @brief Wait for every block to be scanned.
+			 *
+			 * This is mostly intended for unit tests. This should not be used from the
+			 * application UI thread.
+			*/
+			void wait_for_completion();
+			
+			/**
+			 * @brief Get the ranges found in the set so far.
+			*/
+			ByteRangeSet get_known_ranges() const;
+		
+		private:
+			SharedDocumentPointer document;
+			std::shared_ptr<const KnownBlockSet> set;
+			
+			const off_t offset;
+			const off_t length;
+			const off_t block_size;
+			const off_t chunk_blocks;
+			
+			size_t num_blocks;
+			size_t num_chunks;
+			
+			mutable std::mutex known_lock;
+			ByteRangeSet known;
+			
+			std::atomic<size_t> next_chunk;
+			std::atomic<size_t> chunks_done;
+			std::atomic<size_t> blocks_done;
+			std::atomic<size_t> known_blocks;
+			
+			std::unique_ptr<ThreadPool::TaskHandle> task;
+			
+			bool process_next_chunk();
+			void process_chunk(size_t chunk_idx);
+	};
+}
+
+#endif /* !REHEX_KNOWNBLOCKSCAN_HPP */
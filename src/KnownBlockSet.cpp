@@ -0,0 +1,671 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <errno.h>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "endian_conv.hpp"
+#include "KnownBlockSet.hpp"
+#include "win32lib.hpp"
+
+const off_t REHex::KnownBlockSet::DEFAULT_BLOCK_SIZE;
+const size_t REHex::KnownBlockSet::Builder::DEFAULT_MAX_MEMORY_HASHES;
+
+static const char SET_MAGIC[8] = { 'R', 'H', 'X', 'K', 'B', 'S', 'E', 'T' };
+static const uint32_t SET_VERSION = 1;
+static const uint32_t SET_BYTE_ORDER = 0x01020304;
+
+/* Header of a set file, followed by FANOUT_ENTRIES words giving the index of the first hash
+ * with each 16-bit prefix (plus one for the end), then the Bloom filter and finally the
+ * sorted hashes. Integers are stored in native byte order, the byte_order field catches a
+ * set being moved between machines.
+*/
+struct KnownBlockSetHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	
+	uint64_t block_size;
+	uint64_t num_hashes;
+	
+	uint64_t bloom_bits;
+	uint32_t bloom_probes;
+	uint32_t reserved;
+};
+
+static const unsigned int FANOUT_BITS = 16;
+static const size_t FANOUT_ENTRIES = ((size_t)(1) << FANOUT_BITS) + 1;
+
+/* Around 10 bits and 7 probes per hash gives a false positive rate of under 1%. */
+static const uint64_t BLOOM_BITS_PER_HASH = 10;
+static const unsigned int BLOOM_PROBES = 7;
+
+static const uint64_t HASH_SEED = 0x5245484558424C4BULL;
+
+/* Number of hashes read/written at a time while merging. */
+static const size_t MERGE_BUFFER_HASHES = 64 * 1024;
+
+/* Bit positions in the Bloom filter are derived from the hash itself by double hashing. */
+static inline uint64_t bloom_step(uint64_t hash)
+{
+	return (((hash >> 29) | (hash << 35)) * 0x9E3779B97F4A7C15ULL) | 1;
+}
+
+uint64_t REHex::KnownBlockSet::hash_block(const void *data, size_t length)
+{
+	const uint64_t M = 0xC6A4A7935BD1E995ULL;
+	const int R = 47;
+	
+	const unsigned char *p = (const unsigned char*)(data);
+	const unsigned char *words_end = p + (length & ~(size_t)(7));
+	
+	uint64_t h = HASH_SEED ^ ((uint64_t)(length) * M);
+	
+	for(; p != words_end; p += 8)
+	{
+		uint64_t k = leXXXtoh_p<uint64_t>(p);
+		
+		k *= M;
+		k ^= k >> R;
+		k *= M;
+		
+		h ^= k;
+		h *= M;
+	}
+	
+	switch(length & 7)
+	{
+		case 7: h ^= (uint64_t)(p[6]) << 48; /* fall through */
+		case 6: h ^= (uint64_t)(p[5]) << 40; /* fall through */
+		case 5: h ^= (uint64_t)(p[4]) << 32; /* fall through */
+		case 4: h ^= (uint64_t)(p[3]) << 24; /* fall through */
+		case 3: h ^= (uint64_t)(p[2]) << 16; /* fall through */
+		case 2: h ^= (uint64_t)(p[1]) << 8;  /* fall through */
+		case 1: h ^= (uint64_t)(p[0]);
+			h *= M;
+	}
+	
+	h ^= h >> R;
+	h *= M;
+	h ^= h >> R;
+	
+	return h;
+}
+
+REHex::KnownBlockSet::Builder::Builder(const std::string &filename, off_t block_size, size_t max_memory_hashes):
+	filename(filename),
+	block_size(block_size),
+	max_memory_hashes(std::max<size_t>(max_memory_hashes, 1)),
+	hashes_added(0),
+	bytes_added(0)
+{
+	assert(block_size > 0);
+}
+
+REHex::KnownBlockSet::Builder::~Builder()
+{
+	remove_runs();
+}
+
+void REHex::KnownBlockSet::Builder::add_hash(uint64_t hash)
+{
+	hashes.push_back(hash);
+	++hashes_added;
+	
+	if(hashes.size() >= max_memory_hashes)
+	{
+		flush_run();
+	}
+}
+
+bool REHex::KnownBlockSet::Builder::add_file(const std::string &filename, const std::atomic<bool> *cancel)
+{
+	FILE *fh = fopen(filename.c_str(), "rb");
+	if(fh == NULL)
+	{
+		throw std::runtime_error("Unable to open " + filename + ": " + strerror(errno));
+	}
+	
+	/* Read a whole number of blocks at a time. */
+	size_t buf_blocks = std::max<size_t>(((1024 * 1024) / block_size), 1);
+	std::vector<unsigned char> buf(buf_blocks * block_size);
+	
+	bool eof = false;
+	
+	while(!eof)
+	{
+		if(cancel != NULL && *cancel)
+		{
+			fclose(fh);
+			return false;
+		}
+		
+		size_t buf_used = fread(buf.data(), 1, buf.size(), fh);
+		
+		if(buf_used < buf.size())
+		{
+			if(ferror(fh))
+			{
+				fclose(fh);
+				throw std::runtime_error("Unable to read " + filename);
+			}
+			
+			eof = true;
+		}
+		
+		for(size_t i = 0; i < buf_used; i += block_size)
+		{
+			size_t block_used = std::min<size_t>(block_size, (buf_used - i));
+			
+			if(block_used < (size_t)(block_size))
+			{
+				memset((buf.data() + i + block_used), 0, (block_size - block_used));
+			}
+			
+			add_hash(hash_block((buf.data() + i), block_size));
+		}
+		
+		bytes_added += buf_used;
+	}
+	
+	fclose(fh);
+	
+	return true;
+}
+
+uint64_t REHex::KnownBlockSet::Builder::get_hashes_added() const
+{
+	return hashes_added;
+}
+
+uint64_t REHex::KnownBlockSet::Builder::get_bytes_added() const
+{
+	return bytes_added;
+}
+
+void REHex::KnownBlockSet::Builder::flush_run()
+{
+	std::sort(hashes.begin(), hashes.end());
+	hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+	
+	std::string run_name = filename + ".run" + std::to_string(runs.size());
+	
+	FILE *out = fopen(run_name.c_str(), "wb");
+	if(out == NULL)
+	{
+		throw std::runtime_error("Unable to open " + run_name + ": " + strerror(errno));
+	}
+	
+	runs.push_back(run_name);
+	
+	bool ok = hashes.empty() || fwrite(hashes.data(), (hashes.size() * sizeof(uint64_t)), 1, out) == 1;
+	ok = (fclose(out) == 0) && ok;
+	
+	if(!ok)
+	{
+		throw std::runtime_error("Unable to write " + run_name);
+	}
+	
+	hashes.clear();
+}
+
+void REHex::KnownBlockSet::Builder::remove_runs()
+{
+	for(auto r = runs.begin(); r != runs.end(); ++r)
+	{
+		remove(r->c_str());
+	}
+	
+	runs.clear();
+}
+
+bool REHex::KnownBlockSet::Builder::finish(const std::atomic<bool> *cancel)
+{
+	/* Each source of hashes to merge yields them in ascending order. If we never ran out
+	 * of memory there is only one (the hashes vector) and no temporary files are used.
+	*/
+	
+	struct RunReader
+	{
+		FILE *fh;
+		std::vector<uint64_t> buf;
+		size_t pos;
+		
+		RunReader(): fh(NULL), pos(0) {}
+		
+		~RunReader()
+		{
+			if(fh != NULL)
+			{
+				fclose(fh);
+			}
+		}
+	};
+	
+	std::vector< std::unique_ptr<RunReader> > readers;
+	uint64_t bloom_capacity;
+	
+	if(runs.empty())
+	{
+		std::sort(hashes.begin(), hashes.end());
+		hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+		
+		readers.emplace_back(new RunReader());
+		readers[0]->buf.swap(hashes);
+		
+		bloom_capacity = readers[0]->buf.size();
+	}
+	else{
+		if(!hashes.empty())
+		{
+			flush_run();
+		}
+		
+		for(size_t i = 0; i < runs.size(); ++i)
+		{
+			readers.emplace_back(new RunReader());
+			
+			readers[i]->fh = fopen(runs[i].c_str(), "rb");
+			if(readers[i]->fh == NULL)
+			{
+				throw std::runtime_error("Unable to open " + runs[i] + ": " + strerror(errno));
+			}
+		}
+		
+		/* The number of distinct hashes isn't known until they are merged, so the
+		 * Bloom filter is sized for all of them.
+		*/
+		bloom_capacity = hashes_added;
+	}
+	
+	auto reader_next = [&](size_t reader_idx, uint64_t *hash)
+	{
+		RunReader &r = *(readers[reader_idx]);
+		
+		if(r.pos == r.buf.size() && r.fh != NULL)
+		{
+			r.buf.resize(MERGE_BUFFER_HASHES);
+			r.buf.resize(fread(r.buf.data(), sizeof(uint64_t), MERGE_BUFFER_HASHES, r.fh));
+			r.pos = 0;
+			
+			if(r.buf.empty() && ferror(r.fh))
+			{
+				throw std::runtime_error("Unable to read " + runs[reader_idx]);
+			}
+		}
+		
+		if(r.pos == r.buf.size())
+		{
+			return false;
+		}
+		
+		*hash = r.buf[r.pos++];
+		return true;
+	};
+	
+	KnownBlockSetHeader header;
+	memset(&header, 0, sizeof(header));
+	
+	memcpy(header.magic, SET_MAGIC, sizeof(header.magic));
+	header.version = SET_VERSION;
+	header.byte_order = SET_BYTE_ORDER;
+	header.block_size = block_size;
+	header.bloom_bits = std::max<uint64_t>((((bloom_capacity * BLOOM_BITS_PER_HASH) + 63) & ~(uint64_t)(63)), 64);
+	header.bloom_probes = BLOOM_PROBES;
+	
+	std::vector<uint64_t> fanout(FANOUT_ENTRIES, 0);
+	std::vector<uint64_t> bloom(header.bloom_bits / 64, 0);
+	
+	FILE *out = fopen(filename.c_str(), "wb");
+	if(out == NULL)
+	{
+		throw std::runtime_error("Unable to open " + filename + ": " + strerror(errno));
+	}
+	
+	/* The header, fanout table and Bloom filter are written out as placeholders and then
+	 * written again once all the hashes have been merged after them.
+	*/
+	
+	bool ok = fwrite(&header, sizeof(header), 1, out) == 1
+		&& fwrite(fanout.data(), (fanout.size() * sizeof(uint64_t)), 1, out) == 1
+		&& fwrite(bloom.data(), (bloom.size() * sizeof(uint64_t)), 1, out) == 1;
+	
+	std::priority_queue< std::pair<uint64_t, size_t>, std::vector< std::pair<uint64_t, size_t> >, std::greater< std::pair<uint64_t, size_t> > > heads;
+	bool cancelled = false;
+	
+	try {
+		for(size_t i = 0; i < readers.size(); ++i)
+		{
+			uint64_t hash;
+			if(reader_next(i, &hash))
+			{
+				heads.push(std::make_pair(hash, i));
+			}
+		}
+		
+		std::vector<uint64_t> out_buf;
+		out_buf.reserve(MERGE_BUFFER_HASHES);
+		
+		uint64_t num_hashes = 0;
+		uint64_t last_hash = 0;
+		
+		while(ok && !heads.empty())
+		{
+			if(cancel != NULL && *cancel)
+			{
+				cancelled = true;
+				break;
+			}
+			
+			uint64_t hash = heads.top().first;
+			size_t reader_idx = heads.top().second;
+			
+			heads.pop();
+			
+			uint64_t next_hash;
+			if(reader_next(reader_idx, &next_hash))
+			{
+				heads.push(std::make_pair(next_hash, reader_idx));
+			}
+			
+			if(num_hashes > 0 && hash == last_hash)
+			{
+				/* Already seen in another run. */
+				continue;
+			}
+			
+			last_hash = hash;
+			++num_hashes;
+			
+			++(fanout[(hash >> (64 - FANOUT_BITS)) + 1]);
+			
+			uint64_t step = bloom_step(hash);
+			for(unsigned int p = 0; p < header.bloom_probes; ++p)
+			{
+				uint64_t bit = (hash + (p * step)) % header.bloom_bits;
+				bloom[bit / 64] |= (uint64_t)(1) << (bit % 64);
+			}
+			
+			out_buf.push_back(hash);
+			
+			if(out_buf.size() == MERGE_BUFFER_HASHES)
+			{
+				ok = fwrite(out_buf.data(), (out_buf.size() * sizeof(uint64_t)), 1, out) == 1;
+				out_buf.clear();
+			}
+		}
+		
+		if(ok && !cancelled && !out_buf.empty())
+		{
+			ok = fwrite(out_buf.data(), (out_buf.size() * sizeof(uint64_t)), 1, out) == 1;
+		}
+		
+		header.num_hashes = num_hashes;
+	}
+	catch(...)
+	{
+		fclose(out);
+		remove(filename.c_str());
+		
+		throw;
+	}
+	
+	if(cancelled)
+	{
+		fclose(out);
+		remove(filename.c_str());
+		
+		readers.clear();
+		remove_runs();
+		
+		return false;
+	}
+	
+	/* Turn the count of hashes with each prefix into the index of the first one. */
+	for(size_t i = 1; i < FANOUT_ENTRIES; ++i)
+	{
+		fanout[i] += fanout[i - 1];
+	}
+	
+	ok = ok
+		&& fseek(out, 0, SEEK_SET) == 0
+		&& fwrite(&header, sizeof(header), 1, out) == 1
+		&& fwrite(fanout.data(), (fanout.size() * sizeof(uint64_t)), 1, out) == 1
+		&& fwrite(bloom.data(), (bloom.size() * sizeof(uint64_t)), 1, out) == 1;
+	
+	ok = (fclose(out) == 0) && ok;
+	
+	readers.clear();
+	remove_runs();
+	
+	if(!ok)
+	{
+		remove(filename.c_str());
+		throw std::runtime_error("Unable to write " + filename);
+	}
+	
+	return true;
+}
+
+REHex::KnownBlockSet::KnownBlockSet(const std::string &filename):
+	filename(filename),
+	map_base(NULL),
+	map_length(0)
+{
+	#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, (FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS), NULL);
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("Unable to open " + filename + ": " + GetLastError_strerror(GetLastError()));
+	}
+	
+	LARGE_INTEGER file_size;
+	if(!GetFileSizeEx(file, &file_size))
+	{
+		DWORD error = GetLastError();
+		CloseHandle(file);
+		
+		throw std::runtime_error("Unable to open " + filename + ": " + GetLastError_strerror(error));
+	}
+	
+	if((uint64_t)(file_size.QuadPart) < sizeof(KnownBlockSetHeader) || (uint64_t)(file_size.QuadPart) > (uint64_t)(SIZE_MAX))
+	{
+		CloseHandle(file);
+		throw std::runtime_error(filename + " is not a valid known block set");
+	}
+	
+	map_length = file_size.QuadPart;
+	
+	/* The view keeps the file open after the handles are closed. */
+	
+	HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(mapping == NULL)
+	{
+		DWORD error = GetLastError();
+		CloseHandle(file);
+		
+		throw std::runtime_error("Unable to map " + filename + ": " + GetLastError_strerror(error));
+	}
+	
+	map_base = (const unsigned char*)(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	DWORD error = GetLastError();
+	
+	CloseHandle(mapping);
+	CloseHandle(file);
+	
+	if(map_base == NULL)
+	{
+		throw std::runtime_error("Unable to map " + filename + ": " + GetLastError_strerror(error));
+	}
+	#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if(fd == -1)
+	{
+		throw std::runtime_error("Unable to open " + filename + ": " + strerror(errno));
+	}
+	
+	struct stat st;
+	if(fstat(fd, &st) != 0)
+	{
+		int error = errno;
+		close(fd);
+		
+		throw std::runtime_error("Unable to open " + filename + ": " + strerror(error));
+	}
+	
+	if((uint64_t)(st.st_size) < sizeof(KnownBlockSetHeader) || (uint64_t)(st.st_size) > (uint64_t)(SIZE_MAX))
+	{
+		close(fd);
+		throw std::runtime_error(filename + " is not a valid known block set");
+	}
+	
+	map_length = st.st_size;
+	
+	/* The mapping keeps the file open after the descriptor is closed. */
+	
+	void *base = mmap(NULL, map_length, PROT_READ, MAP_SHARED, fd, 0);
+	int error = errno;
+	
+	close(fd);
+	
+	if(base == MAP_FAILED)
+	{
+		throw std::runtime_error("Unable to map " + filename + ": " + strerror(error));
+	}
+	
+	/* Lookups are scattered all over the file, reading ahead wastes I/O and page cache. */
+	madvise(base, map_length, MADV_RANDOM);
+	
+	map_base = (const unsigned char*)(base);
+	#endif
+	
+	KnownBlockSetHeader header;
+	memcpy(&header, map_base, sizeof(header));
+	
+	uint64_t fixed_size = sizeof(header) + (FANOUT_ENTRIES * sizeof(uint64_t));
+	
+	bool valid = memcmp(header.magic, SET_MAGIC, sizeof(header.magic)) == 0
+		&& header.version == SET_VERSION
+		&& header.byte_order == SET_BYTE_ORDER
+		&& header.block_size > 0
+		&& header.bloom_bits > 0 && (header.bloom_bits % 64) == 0
+		&& header.bloom_probes > 0
+		&& map_length >= fixed_size
+		&& (header.bloom_bits / 8) <= (map_length - fixed_size)
+		&& header.num_hashes == ((map_length - fixed_size - (header.bloom_bits / 8)) / sizeof(uint64_t))
+		&& ((map_length - fixed_size - (header.bloom_bits / 8)) % sizeof(uint64_t)) == 0;
+	
+	if(valid)
+	{
+		fanout = (const uint64_t*)(map_base + sizeof(header));
+		bloom  = (const uint64_t*)(map_base + fixed_size);
+		hashes = (const uint64_t*)(map_base + fixed_size + (header.bloom_bits / 8));
+		
+		/* Make sure we can't search outside of the hashes. */
+		
+		valid = fanout[0] == 0 && fanout[FANOUT_ENTRIES - 1] == header.num_hashes;
+		
+		for(size_t i = 1; valid && i < FANOUT_ENTRIES; ++i)
+		{
+			valid = fanout[i] >= fanout[i - 1];
+		}
+	}
+	
+	if(!valid)
+	{
+		unmap();
+		throw std::runtime_error(filename + " is not a valid known block set");
+	}
+	
+	block_size = header.block_size;
+	num_hashes = header.num_hashes;
+	bloom_bits = header.bloom_bits;
+	bloom_probes = header.bloom_probes;
+}
+
+REHex::KnownBlockSet::~KnownBlockSet()
+{
+	unmap();
+}
+
+void REHex::KnownBlockSet::unmap()
+{
+	if(map_base != NULL)
+	{
+		#ifdef _WIN32
+		UnmapViewOfFile(map_base);
+		#else
+		munmap((void*)(map_base), map_length);
+		#endif
+		
+		map_base = NULL;
+	}
+}
+
+const std::string &REHex::KnownBlockSet::get_filename() const
+{
+	return filename;
+}
+
+off_t REHex::KnownBlockSet::get_block_size() const
+{
+	return block_size;
+}
+
+uint64_t REHex::KnownBlockSet::get_num_hashes() const
+{
+	return num_hashes;
+}
+
+bool REHex::KnownBlockSet::contains(uint64_t hash) const
+{
+	uint64_t step = bloom_step(hash);
+	
+	for(unsigned int p = 0; p < bloom_probes; ++p)
+	{
+		uint64_t bit = (hash + (p * step)) % bloom_bits;
+		
+		if((bloom[bit / 64] & ((uint64_t)(1) << (bit % 64))) == 0)
+		{
+			return false;
+		}
+	}
+	
+	size_t prefix = hash >> (64 - FANOUT_BITS);
+	
+	return std::binary_search((hashes + fanout[prefix]), (hashes + fanout[prefix + 1]), hash);
+}
@@ -0,0 +1,199 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_KNOWNBLOCKSET_HPP
+#define REHEX_KNOWNBLOCKSET_HPP
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace REHex
+{
+	/**
+	 * @brief Set of hashes of the blocks which make up a collection of known files.
+	 *
+	 * Used for triaging disk images - any block of the image whose hash is in a set built
+	 * from some reference files (e.g. a clean install of the operating system) is part of
+	 * one of those files and can be skipped over when looking for anything interesting.
+	 *
+	 * The set is stored in a file as a sorted array of 64-bit hashes, preceded by a Bloom
+	 * filter and a table of where the hashes with each 16-bit prefix begin. The file is
+	 * memory mapped rather than read in, so sets of hundreds of millions of hashes can be
+	 * opened without loading them into memory. Most blocks which aren't in the set are
+	 * rejected by the Bloom filter and the rest only need a binary search of the few
+	 * hashes sharing their prefix, so a lookup touches one or two pages of the file.
+	 *
+	 * The file is in native byte order and can't be opened on a machine with different
+	 * endianness, build another one from the same files there.
+	*/
+	class KnownBlockSet
+	{
+		public:
+			/**
+			 * @brief Default size of each block, in bytes.
+			*/
+			static const off_t DEFAULT_BLOCK_SIZE = 4096;
+			
+			/**
+			 * @brief Compute the hash of a block of data.
+			 *
+			 * This is a fast non-cryptographic hash (MurmurHash64A), which is plenty
+			 * for identifying blocks but not for proving they haven't been tampered
+			 * with. The result doesn't depend on the host byte order.
+			*/
+			static uint64_t hash_block(const void *data, size_t length);
+			
+			/**
+			 * @brief Builds a KnownBlockSet file from some reference files.
+			 *
+			 * Hashes are collected in memory until max_memory_hashes are held, then
+			 * sorted and spilled to temporary files next to the output which are merged
+			 * together by finish(), so building a set from more files than can fit in
+			 * memory only needs around 1.25 bytes per hash (for the Bloom filter).
+			*/
+			class Builder
+			{
+				public:
+					/**
+					 * @brief Default number of hashes held in memory before spilling them to disk.
+					*/
+					static const size_t DEFAULT_MAX_MEMORY_HASHES = 16 * 1024 * 1024;
+					
+					/**
+					 * @brief Start building a new set.
+					 *
+					 * @param filename           Filename to write the set to.
+					 * @param block_size         Size of each block, in bytes.
+					 * @param max_memory_hashes  Number of hashes to hold in memory before spilling to disk.
+					*/
+					Builder(const std::string &filename, off_t block_size = DEFAULT_BLOCK_SIZE, size_t max_memory_hashes = DEFAULT_MAX_MEMORY_HASHES);
+					
+					~Builder();
+					
+					Builder(const Builder&) = delete;
+					Builder &operator=(const Builder&) = delete;
+					
+					/**
+					 * @brief Add a single hash to the set.
+					*/
+					void add_hash(uint64_t hash);
+					
+					/**
+					 * @brief Add every block of a file to the set.
+					 *
+					 * The file is split into blocks from the start, a short final
+					 * block is padded with zeros to the block size like it would be
+					 * when stored in a filesystem.
+					 *
+					 * Returns false if cancel was set before the whole file was
+					 * read, in which case only some of its blocks were added.
+					 *
+					 * Throws std::runtime_error if the file can't be read.
+					*/
+					bool add_file(const std::string &filename, const std::atomic<bool> *cancel = NULL);
+					
+					/**
+					 * @brief Get the number of hashes added so far (including duplicates).
+					*/
+					uint64_t get_hashes_added() const;
+					
+					/**
+					 * @brief Get the number of bytes read by add_file() so far.
+					 *
+					 * May be called from another thread while a file is being added.
+					*/
+					uint64_t get_bytes_added() const;
+					
+					/**
+					 * @brief Write out the set.
+					 *
+					 * Returns false without leaving a set behind if cancel was set
+					 * before it was finished.
+					 *
+					 * Throws std::runtime_error on failure.
+					*/
+					bool finish(const std::atomic<bool> *cancel = NULL);
+				
+				private:
+					const std::string filename;
+					const off_t block_size;
+					const size_t max_memory_hashes;
+					
+					std::vector<uint64_t> hashes;
+					std::vector<std::string> runs;
+					uint64_t hashes_added;
+					std::atomic<uint64_t> bytes_added;
+					
+					void flush_run();
+					void remove_runs();
+			};
+			
+			/**
+			 * @brief Open a set previously written by a Builder.
+			 *
+			 * Throws std::runtime_error if the file can't be opened or isn't a valid set.
+			*/
+			KnownBlockSet(const std::string &filename);
+			
+			~KnownBlockSet();
+			
+			KnownBlockSet(const KnownBlockSet&) = delete;
+			KnownBlockSet &operator=(const KnownBlockSet&) = delete;
+			
+			const std::string &get_filename() const;
+			
+			/**
+			 * @brief Get the size of the blocks which were hashed to build the set.
+			*/
+			off_t get_block_size() const;
+			
+			/**
+			 * @brief Get the number of (distinct) hashes in the set.
+			*/
+			uint64_t get_num_hashes() const;
+			
+			/**
+			 * @brief Check if a hash is in the set.
+			*/
+			bool contains(uint64_t hash) const;
+		
+		private:
+			std::string filename;
+			
+			const unsigned char *map_base;
+			size_t map_length;
+			
+			off_t block_size;
+			uint64_t num_hashes;
+			
+			const uint64_t *fanout;
+			
+			const uint64_t *bloom;
+			uint64_t bloom_bits;
+			unsigned int bloom_probes;
+			
+			const uint64_t *hashes;
+			
+			void unmap();
+	};
+}
+
+#endif /* !REHEX_KNOWNBLOCKSET_HPP */
@@ -0,0 +1,606 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <limits.h>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <wx/dir.h>
+#include <wx/dirdlg.h>
+#include <wx/filedlg.h>
+#include <wx/filename.h>
+#include <wx/msgdlg.h>
+#include <wx/numformatter.h>
+#include <wx/progdlg.h>
+#include <wx/sizer.h>
+
+#include "App.hpp"
+#include "KnownBlocksPanel.hpp"
+#include "util.hpp"
+
+static REHex::ToolPanel *KnownBlocksPanel_factory(wxWindow *parent, REHex::SharedDocumentPointer &document, REHex::DocumentCtrl *document_ctrl)
+{
+	return new REHex::KnownBlocksPanel(parent, document, document_ctrl);
+}
+
+static REHex::ToolPanelRegistration tpr("KnownBlocksPanel", "Known blocks", REHex::ToolPanel::TPS_WIDE, &KnownBlocksPanel_factory);
+
+static const char *SET_WILDCARD = "Known block sets (*.rhkbs)|*.rhkbs|All files|*";
+
+enum {
+	ID_OPEN_SET = 1,
+	ID_BUILD_SET,
+	ID_RANGE_CHOICE,
+	ID_SKIP,
+	ID_HIGHLIGHT,
+};
+
+BEGIN_EVENT_TABLE(REHex::KnownBlocksPanel, wxPanel)
+	EVT_BUTTON(ID_OPEN_SET, REHex::KnownBlocksPanel::OnOpenSet)
+	EVT_BUTTON(ID_BUILD_SET, REHex::KnownBlocksPanel::OnBuildSet)
+	EVT_COMMAND(ID_RANGE_CHOICE, EV_SELECTION_CHANGED, REHex::KnownBlocksPanel::OnRangeChanged)
+	EVT_CHECKBOX(ID_SKIP, REHex::KnownBlocksPanel::OnSkipToggle)
+	EVT_BUTTON(ID_HIGHLIGHT, REHex::KnownBlocksPanel::OnHighlightKnown)
+	EVT_TIMER(wxID_ANY, REHex::KnownBlocksPanel::OnTimerTick)
+	EVT_LIST_ITEM_ACTIVATED(wxID_ANY, REHex::KnownBlocksPanel::OnItemActivate)
+END_EVENT_TABLE()
+
+REHex::KnownBlocksPanel::KnownBlocksPanel(wxWindow *parent, SharedDocumentPointer &document, DocumentCtrl *document_ctrl):
+	ToolPanel(parent),
+	document(document),
+	document_ctrl(document_ctrl),
+	skip_published(false),
+	timer(this, wxID_ANY)
+{
+	const int MARGIN = 4;
+	
+	set_text = new wxStaticText(this, wxID_ANY, "No known block set loaded");
+	
+	block_size_ctrl = new wxSpinCtrl(this, wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 1, INT_MAX, KnownBlockSet::DEFAULT_BLOCK_SIZE);
+	block_size_ctrl->SetToolTip("Size of the blocks hashed when building a new set");
+	
+	wxBoxSizer *set_sizer = new wxBoxSizer(wxHORIZONTAL);
+	set_sizer->Add(set_text, 1, wxALIGN_CENTER_VERTICAL);
+	set_sizer->Add(new wxButton(this, ID_OPEN_SET, "Open..."), 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	set_sizer->Add(new wxButton(this, ID_BUILD_SET, "Build from directory..."), 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	set_sizer->Add(new wxStaticText(this, wxID_ANY, "Block size:"), 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	set_sizer->Add(block_size_ctrl, 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	
+	range_choice = new RangeChoiceLinear(this, ID_RANGE_CHOICE, document, document_ctrl);
+	
+	skip_check = new wxCheckBox(this, ID_SKIP, "Skip known blocks in searches and strings");
+	
+	wxBoxSizer *range_sizer = new wxBoxSizer(wxHORIZONTAL);
+	range_sizer->Add(new wxStaticText(this, wxID_ANY, "Range:"), 0, wxALIGN_CENTER_VERTICAL);
+	range_sizer->Add(range_choice, 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	range_sizer->Add(skip_check, 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	
+	status_text = new wxStaticText(this, wxID_ANY, wxEmptyString);
+	
+	highlight_btn = new wxButton(this, ID_HIGHLIGHT, "Highlight known blocks");
+	highlight_btn->Disable();
+	
+	wxBoxSizer *status_sizer = new wxBoxSizer(wxHORIZONTAL);
+	status_sizer->Add(status_text, 1, wxALIGN_CENTER_VERTICAL);
+	status_sizer->Add(highlight_btn, 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	
+	list_ctrl = new RangeListCtrl(this);
+	list_ctrl->AppendColumn("Offset");
+	list_ctrl->AppendColumn("Length");
+	
+	wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
+	sizer->Add(set_sizer, 0, (wxEXPAND | wxLEFT | wxRIGHT | wxTOP), MARGIN);
+	sizer->Add(range_sizer, 0, (wxEXPAND | wxLEFT | wxRIGHT | wxTOP), MARGIN);
+	sizer->Add(status_sizer, 0, (wxEXPAND | wxLEFT | wxRIGHT | wxTOP), MARGIN);
+	sizer->Add(list_ctrl, 1, (wxEXPAND | wxALL), MARGIN);
+	SetSizerAndFit(sizer);
+	
+	this->document.auto_cleanup_bind(DATA_ERASE,     &REHex::KnownBlocksPanel::OnDataErase,     this);
+	this->document.auto_cleanup_bind(DATA_INSERT,    &REHex::KnownBlocksPanel::OnDataInsert,    this);
+	this->document.auto_cleanup_bind(DATA_OVERWRITE, &REHex::KnownBlocksPanel::OnDataOverwrite, this);
+	
+	range_choice->set_whole_file();
+	
+	restart();
+}
+
+REHex::KnownBlocksPanel::~KnownBlocksPanel()
+{
+	timer.Stop();
+	
+	/* Nothing will keep the skip ranges up to date once we are gone. */
+	if(skip_published)
+	{
+		document->set_skip_ranges(ByteRangeSet());
+	}
+}
+
+std::string REHex::KnownBlocksPanel::name() const
+{
+	return "KnownBlocksPanel";
+}
+
+void REHex::KnownBlocksPanel::save_state(wxConfig *config) const
+{
+	config->Write("set-filename", wxString(set ? set->get_filename() : ""));
+	config->Write("block-size", (long)(block_size_ctrl->GetValue()));
+}
+
+void REHex::KnownBlocksPanel::load_state(wxConfig *config)
+{
+	block_size_ctrl->SetValue(config->Read("block-size", (long)(block_size_ctrl->GetValue())));
+	
+	std::string set_filename = config->Read("set-filename", "").ToStdString();
+	
+	if(!set && !set_filename.empty() && wxFileExists(set_filename))
+	{
+		open_set(set_filename);
+	}
+}
+
+wxSize REHex::KnownBlocksPanel::DoGetBestClientSize() const
+{
+	return wxSize(-1, 200);
+}
+
+void REHex::KnownBlocksPanel::update()
+{
+	if(set && !scan)
+	{
+		restart();
+	}
+	else{
+		list_ctrl->Refresh();
+	}
+}
+
+void REHex::KnownBlocksPanel::open_set(const std::string &filename)
+{
+	try {
+		set.reset(new KnownBlockSet(filename));
+	}
+	catch(const std::exception &e)
+	{
+		wxMessageBox(e.what(), "Known blocks", (wxOK | wxICON_ERROR), this);
+		return;
+	}
+	
+	set_text->SetLabel(wxFileName(filename).GetFullName()
+		+ " (" + wxNumberFormatter::ToString((long)(set->get_num_hashes())) + " blocks of "
+		+ wxNumberFormatter::ToString((long)(set->get_block_size())) + " bytes)");
+	
+	block_size_ctrl->SetValue(set->get_block_size());
+	
+	restart();
+}
+
+void REHex::KnownBlocksPanel::build_set()
+{
+	wxDirDialog dir_dialog(this, "Select directory of known files", wxGetApp().get_last_directory(), (wxDD_DEFAULT_STYLE | wxDD_DIR_MUST_EXIST));
+	if(dir_dialog.ShowModal() == wxID_CANCEL)
+	{
+		return;
+	}
+	
+	wxFileDialog save_dialog(this, "Save known block set", wxGetApp().get_last_directory(), "", SET_WILDCARD, (wxFD_SAVE | wxFD_OVERWRITE_PROMPT));
+	if(save_dialog.ShowModal() == wxID_CANCEL)
+	{
+		return;
+	}
+	
+	std::string set_filename = save_dialog.GetPath().ToStdString();
+	
+	wxArrayString dir_files;
+	wxDir::GetAllFiles(dir_dialog.GetPath(), &dir_files);
+	
+	/* The set is built on a worker thread, the total size of the files is added up first
+	 * so progress can be shown in bytes.
+	*/
+	
+	std::vector<std::string> files;
+	uint64_t total_bytes = 0;
+	
+	for(size_t i = 0; i < dir_files.size(); ++i)
+	{
+		files.push_back(dir_files[i].ToStdString());
+		
+		wxULongLong file_size = wxFileName::GetSize(dir_files[i]);
+		if(file_size != wxInvalidSize)
+		{
+			total_bytes += file_size.GetValue();
+		}
+	}
+	
+	KnownBlockSet::Builder builder(set_filename, block_size_ctrl->GetValue());
+	
+	std::atomic<bool> cancel(false);
+	std::atomic<size_t> files_done(0);
+	std::atomic<bool> writing(false);
+	
+	/* Only accessed by the worker until it has been joined. */
+	std::vector<std::string> failed_files;
+	std::exception_ptr error;
+	
+	ThreadPool::TaskHandle task = wxGetApp().thread_pool->queue_task([&]()
+	{
+		try {
+			for(auto f = files.begin(); f != files.end() && !cancel; ++f)
+			{
+				try {
+					if(!builder.add_file(*f, &cancel))
+					{
+						return true;
+					}
+				}
+				catch(const std::exception&)
+				{
+					/* Unreadable files are skipped rather than failing the whole set. */
+					failed_files.push_back(*f);
+				}
+				
+				++files_done;
+			}
+			
+			if(!cancel)
+			{
+				writing = true;
+				builder.finish(&cancel);
+			}
+		}
+		catch(...)
+		{
+			error = std::current_exception();
+		}
+		
+		return true;
+	}, 1);
+	
+	{
+		wxProgressDialog progress("Building known block set", "Hashing files...", 1000, this, (wxPD_CAN_ABORT | wxPD_REMAINING_TIME | wxPD_APP_MODAL));
+		
+		while(!task.finished())
+		{
+			bool keep_going;
+			
+			if(writing)
+			{
+				keep_going = progress.Pulse("Writing " + save_dialog.GetFilename());
+			}
+			else{
+				/* Files may have grown since their sizes were read. */
+				uint64_t bytes_done = std::min(builder.get_bytes_added(), total_bytes);
+				int value = total_bytes > 0 ? (int)((bytes_done * 999) / total_bytes) : 0;
+				
+				size_t file_idx = files_done;
+				
+				keep_going = progress.Update(value, (file_idx < files.size() ? wxString(files[file_idx]) : wxString("Hashing files...")));
+			}
+			
+			if(!keep_going)
+			{
+				cancel = true;
+			}
+			
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		}
+	}
+	
+	task.join();
+	
+	if(error)
+	{
+		try {
+			std::rethrow_exception(error);
+		}
+		catch(const std::exception &e)
+		{
+			wxMessageBox((std::string("Error building known block set: ") + e.what()), "Known blocks", (wxOK | wxICON_ERROR), this);
+			return;
+		}
+	}
+	
+	if(cancel)
+	{
+		return;
+	}
+	
+	if(!failed_files.empty())
+	{
+		static const size_t MAX_LISTED_FILES = 10;
+		
+		wxString message = wxString::Format("%u of %u files could not be read and were skipped:\n",
+			(unsigned)(failed_files.size()), (unsigned)(files.size()));
+		
+		for(size_t i = 0; i < failed_files.size() && i < MAX_LISTED_FILES; ++i)
+		{
+			message += "\n" + failed_files[i];
+		}
+		
+		if(failed_files.size() > MAX_LISTED_FILES)
+		{
+			message += wxString::Format("\n(and %u more)", (unsigned)(failed_files.size() - MAX_LISTED_FILES));
+		}
+		
+		wxMessageBox(message, "Known blocks", (wxOK | wxICON_WARNING), this);
+	}
+	
+	open_set(set_filename);
+}
+
+void REHex::KnownBlocksPanel::restart()
+{
+	timer.Stop();
+	scan.reset(NULL);
+	
+	known_ranges.clear();
+	list_ctrl->SetItemCount(0);
+	highlight_btn->Disable();
+	
+	/* Any ranges we published are stale now. */
+	if(skip_published)
+	{
+		document->set_skip_ranges(ByteRangeSet());
+		skip_published = false;
+	}
+	
+	if(!set)
+	{
+		status_text->SetLabel("Open or build a known block set to scan for known blocks");
+		return;
+	}
+	
+	BitOffset range_offset, range_length;
+	std::tie(range_offset, range_length) = range_choice->get_range();
+	
+	assert(range_offset.byte_aligned());
+	assert(range_length.byte_aligned());
+	
+	if(range_length <= BitOffset::ZERO)
+	{
+		status_text->SetLabel("No data selected");
+		return;
+	}
+	
+	scan.reset(new KnownBlockScan(document, set, range_offset.byte(), range_length.byte()));
+	
+	update_status();
+	
+	if(scan->is_complete())
+	{
+		update_known_ranges();
+		publish_skip_ranges();
+	}
+	else{
+		timer.Start(250, wxTIMER_CONTINUOUS);
+	}
+}
+
+void REHex::KnownBlocksPanel::update_status()
+{
+	assert(scan);
+	
+	wxString status;
+	
+	if(scan->is_complete())
+	{
+		status = wxNumberFormatter::ToString((long)(scan->get_known_blocks())) + " of "
+			+ wxNumberFormatter::ToString((long)(scan->get_num_blocks())) + " blocks known";
+	}
+	else{
+		int percent = (int)(((double)(scan->get_blocks_done()) / (double)(scan->get_num_blocks())) * 100.0);
+		status = "Scanning (" + std::to_string(percent) + "%), "
+			+ wxNumberFormatter::ToString((long)(scan->get_known_blocks())) + " blocks known so far...";
+	}
+	
+	status_text->SetLabel(status);
+	
+	highlight_btn->Enable(scan->is_complete() && scan->get_known_blocks() > 0);
+}
+
+void REHex::KnownBlocksPanel::update_known_ranges()
+{
+	assert(scan);
+	
+	ByteRangeSet known = scan->get_known_ranges();
+	known_ranges.assign(known.begin(), known.end());
+	
+	list_ctrl->SetItemCount(known_ranges.size());
+	list_ctrl->Refresh();
+}
+
+void REHex::KnownBlocksPanel::publish_skip_ranges()
+{
+	if(skip_check->GetValue() && scan && scan->is_complete())
+	{
+		document->set_skip_ranges(scan->get_known_ranges());
+		skip_published = true;
+	}
+	else if(skip_published)
+	{
+		document->set_skip_ranges(ByteRangeSet());
+		skip_published = false;
+	}
+}
+
+void REHex::KnownBlocksPanel::OnOpenSet(wxCommandEvent &event)
+{
+	wxFileDialog open_dialog(this, "Open known block set", wxGetApp().get_last_directory(), "", SET_WILDCARD, (wxFD_OPEN | wxFD_FILE_MUST_EXIST));
+	if(open_dialog.ShowModal() == wxID_CANCEL)
+	{
+		return;
+	}
+	
+	open_set(open_dialog.GetPath().ToStdString());
+}
+
+void REHex::KnownBlocksPanel::OnBuildSet(wxCommandEvent &event)
+{
+	build_set();
+}
+
+void REHex::KnownBlocksPanel::OnRangeChanged(wxCommandEvent &event)
+{
+	restart();
+}
+
+void REHex::KnownBlocksPanel::OnSkipToggle(wxCommandEvent &event)
+{
+	publish_skip_ranges();
+}
+
+void REHex::KnownBlocksPanel::OnHighlightKnown(wxCommandEvent &event)
+{
+	if(!scan || !scan->is_complete())
+	{
+		return;
+	}
+	
+	const HighlightColourMap &highlight_colours = document->get_highlight_colours();
+	if(highlight_colours.empty())
+	{
+		return;
+	}
+	
+	int highlight_colour_idx = highlight_colours.begin()->first;
+	
+	Document::AnnotationBatch batch;
+	
+	for(auto r = known_ranges.begin(); r != known_ranges.end(); ++r)
+	{
+		batch.add_highlight(BitOffset(r->offset, 0), BitOffset(r->length, 0), highlight_colour_idx);
+	}
+	
+	document->apply_annotations(batch, "highlight known blocks");
+}
+
+void REHex::KnownBlocksPanel::OnTimerTick(wxTimerEvent &event)
+{
+	if(!scan)
+	{
+		timer.Stop();
+		return;
+	}
+	
+	if(scan->is_complete())
+	{
+		timer.Stop();
+	}
+	
+	update_status();
+	update_known_ranges();
+	
+	if(scan->is_complete())
+	{
+		publish_skip_ranges();
+	}
+}
+
+void REHex::KnownBlocksPanel::OnItemActivate(wxListEvent &event)
+{
+	long item_idx = event.GetIndex();
+	assert(item_idx >= 0);
+	
+	if((size_t)(item_idx) >= known_ranges.size())
+	{
+		return;
+	}
+	
+	const ByteRangeSet::Range &range = known_ranges[item_idx];
+	
+	document->set_cursor_position(BitOffset(range.offset, 0));
+	document_ctrl->set_selection_raw(BitOffset(range.offset, 0), BitOffset((range.offset + range.length - 1), 0));
+}
+
+void REHex::KnownBlocksPanel::OnDataErase(OffsetLengthEvent &event)
+{
+	/* Reset if the data was erased before the end of the scanned range. */
+	if(scan && event.offset < (scan->get_offset() + scan->get_length()))
+	{
+		restart();
+	}
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::KnownBlocksPanel::OnDataInsert(OffsetLengthEvent &event)
+{
+	/* Reset if the data was inserted before the end of the scanned range. */
+	if(scan && event.offset < (scan->get_offset() + scan->get_length()))
+	{
+		restart();
+	}
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::KnownBlocksPanel::OnDataOverwrite(OffsetLengthEvent &event)
+{
+	/* Reset if any of the overwritten bytes were within the scanned range. */
+	if(scan && event.offset < (scan->get_offset() + scan->get_length()))
+	{
+		restart();
+	}
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+REHex::KnownBlocksPanel::RangeListCtrl::RangeListCtrl(KnownBlocksPanel *parent):
+	wxListCtrl(parent, wxID_ANY, wxDefaultPosition, wxDefaultSize, (wxLC_REPORT | wxLC_VIRTUAL | wxLC_SINGLE_SEL)) {}
+
+wxString REHex::KnownBlocksPanel::RangeListCtrl::OnGetItemText(long item, long column) const
+{
+	KnownBlocksPanel *parent = dynamic_cast<KnownBlocksPanel*>(GetParent());
+	assert(parent != NULL);
+	
+	if((size_t)(item) >= parent->known_ranges.size())
+	{
+		/* wxWidgets has asked for an item beyond the end of the list.
+		 *
+		 * This probably means the scan has been reset but SetItemCount() hasn't been
+		 * called yet.
+		*/
+		
+		return "???";
+	}
+	
+	const ByteRangeSet::Range &range = parent->known_ranges[item];
+	
+	switch(column)
+	{
+		case 0:
+			/* Offset column */
+			return format_offset(range.offset, parent->document_ctrl->get_offset_display_base(), parent->document->buffer_length());
+		
+		case 1:
+			/* Length column */
+			return format_offset(range.length, parent->document_ctrl->get_offset_display_base(), parent->document->buffer_length());
+		
+		default:
+			/* Unknown column */
+			abort();
+	}
+}
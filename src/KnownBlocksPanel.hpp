@@ -0,0 +1,122 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_KNOWNBLOCKSPANEL_HPP
+#define REHEX_KNOWNBLOCKSPANEL_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <wx/button.h>
+#include <wx/checkbox.h>
+#include <wx/listctrl.h>
+#include <wx/spinctrl.h>
+#include <wx/stattext.h>
+#include <wx/timer.h>
+
+#include "ByteRangeSet.hpp"
+#include "DocumentCtrl.hpp"
+#include "Events.hpp"
+#include "KnownBlockScan.hpp"
+#include "KnownBlockSet.hpp"
+#include "RangeChoiceLinear.hpp"
+#include "SafeWindowPointer.hpp"
+#include "SharedDocumentPointer.hpp"
+#include "ToolPanel.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Tool panel which finds the blocks of a file belonging to known files.
+	 *
+	 * The blocks of the file (e.g. a disk image) are looked up in a KnownBlockSet built
+	 * from a directory of reference files, any which are found can be highlighted and
+	 * skipped over by the search and strings tools.
+	*/
+	class KnownBlocksPanel: public ToolPanel
+	{
+		public:
+			KnownBlocksPanel(wxWindow *parent, SharedDocumentPointer &document, DocumentCtrl *document_ctrl);
+			~KnownBlocksPanel();
+			
+			virtual std::string name() const override;
+			
+			virtual void save_state(wxConfig *config) const override;
+			virtual void load_state(wxConfig *config) override;
+			virtual void update() override;
+			
+			virtual wxSize DoGetBestClientSize() const override;
+		
+		private:
+			class RangeListCtrl: public wxListCtrl
+			{
+				public:
+					RangeListCtrl(KnownBlocksPanel *parent);
+					
+					virtual wxString OnGetItemText(long item, long column) const override;
+			};
+			
+			SharedDocumentPointer document;
+			SafeWindowPointer<DocumentCtrl> document_ctrl;
+			
+			std::shared_ptr<const KnownBlockSet> set;
+			std::unique_ptr<KnownBlockScan> scan;
+			
+			/* Known ranges from the scan, as of the last timer tick. */
+			std::vector<ByteRangeSet::Range> known_ranges;
+			
+			/* We have set the document's skip ranges. */
+			bool skip_published;
+			
+			wxStaticText *set_text;
+			wxSpinCtrl *block_size_ctrl;
+			
+			RangeChoiceLinear *range_choice;
+			wxCheckBox *skip_check;
+			
+			wxStaticText *status_text;
+			wxButton *highlight_btn;
+			RangeListCtrl *list_ctrl;
+			wxTimer timer;
+			
+			void open_set(const std::string &filename);
+			void build_set();
+			
+			void restart();
+			void update_status();
+			void update_known_ranges();
+			void publish_skip_ranges();
+			
+			void OnOpenSet(wxCommandEvent &event);
+			void OnBuildSet(wxCommandEvent &event);
+			void OnRangeChanged(wxCommandEvent &event);
+			void OnSkipToggle(wxCommandEvent &event);
+			void OnHighlightKnown(wxCommandEvent &event);
+			void OnTimerTick(wxTimerEvent &event);
+			void OnItemActivate(wxListEvent &event);
+			
+			void OnDataErase(OffsetLengthEvent &event);
+			void OnDataInsert(OffsetLengthEvent &event);
+			void OnDataOverwrite(OffsetLengthEvent &event);
+		
+		DECLARE_EVENT_TABLE()
+		
+		friend RangeListCtrl;
+	};
+}
+
+#endif /* !REHEX_KNOWNBLOCKSPANEL_HPP */
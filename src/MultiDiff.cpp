@@ -0,0 +1,207 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "MultiDiff.hpp"
+
+/* Find the first offset in [off, end) where a and b differ, returns end if none do. */
+static off_t find_mismatch(const unsigned char *a, const unsigned char *b, off_t off, off_t end)
+{
+	/* Skip over matching data a word at a time, differences are usually sparse. */
+	while((end - off) >= (off_t)(sizeof(uint64_t)))
+	{
+		uint64_t a_word, b_word;
+		memcpy(&a_word, (a + off), sizeof(a_word));
+		memcpy(&b_word, (b + off), sizeof(b_word));
+		
+		if(a_word != b_word)
+		{
+			break;
+		}
+		
+		off += sizeof(uint64_t);
+	}
+	
+	while(off < end && a[off] == b[off])
+	{
+		++off;
+	}
+	
+	return off;
+}
+
+/* Find the first offset in [off, end) where a and b match, returns end if none do. */
+static off_t find_match(const unsigned char *a, const unsigned char *b, off_t off, off_t end)
+{
+	while(off < end && a[off] != b[off])
+	{
+		++off;
+	}
+	
+	return off;
+}
+
+REHex::MultiDiff::MultiDiff():
+	different(1) {}
+
+void REHex::MultiDiff::reset(size_t num_ranges)
+{
+	different.clear();
+	different.resize(std::max<size_t>(num_ranges, 1));
+}
+
+size_t REHex::MultiDiff::get_num_ranges() const
+{
+	return different.size();
+}
+
+void REHex::MultiDiff::process_slice(off_t rel_offset, off_t length, const unsigned char *const *data, const off_t *available)
+{
+	assert(rel_offset >= 0);
+	assert(length >= 0);
+	
+	clear_range(rel_offset, length);
+	
+	size_t num_ranges = different.size();
+	
+	if(num_ranges < 2 || length == 0)
+	{
+		return;
+	}
+	
+	size_t ranges_with_data = std::count_if(available, (available + num_ranges),
+		[](off_t a) { return a > 0; });
+	
+	if(ranges_with_data <= 1)
+	{
+		/* Nothing to compare - whatever data the one range has differs from every
+		 * other range, so mark it without going through the scratch buffer.
+		*/
+		
+		off_t base_available = std::max<off_t>(std::min(available[0], length), 0);
+		off_t any_end = 0;
+		
+		for(size_t i = 1; i < num_ranges; ++i)
+		{
+			off_t i_available = std::max<off_t>(std::min(available[i], length), 0);
+			off_t present_end = std::max(base_available, i_available);
+			
+			if(present_end > 0)
+			{
+				different[i].set_range(rel_offset, present_end);
+				any_end = std::max(any_end, present_end);
+			}
+		}
+		
+		if(any_end > 0)
+		{
+			different[0].set_range(rel_offset, any_end);
+		}
+		
+		return;
+	}
+	
+	/* Flags for each offset in the slice where any range differs from the base, so the
+	 * union can be built up with one insertion per run rather than one per range.
+	*/
+	slice_any.assign(length, 0);
+	
+	auto mark_different = [&](size_t range_idx, off_t begin, off_t end)
+	{
+		different[range_idx].set_range((rel_offset + begin), (end - begin));
+		memset((slice_any.data() + begin), 1, (end - begin));
+	};
+	
+	off_t base_available = std::max<off_t>(std::min(available[0], length), 0);
+	
+	for(size_t i = 1; i < num_ranges; ++i)
+	{
+		off_t i_available = std::max<off_t>(std::min(available[i], length), 0);
+		off_t common = std::min(base_available, i_available);
+		
+		for(off_t j = find_mismatch(data[0], data[i], 0, common); j < common; j = find_mismatch(data[0], data[i], j, common))
+		{
+			off_t run_end = find_match(data[0], data[i], j, common);
+			mark_different(i, j, run_end);
+			
+			j = run_end;
+		}
+		
+		/* Past the end of either range, anything present in the other is different. */
+		
+		off_t present_end = std::max(base_available, i_available);
+		if(present_end > common)
+		{
+			mark_different(i, common, present_end);
+		}
+	}
+	
+	const unsigned char *any_base = slice_any.data();
+	const unsigned char *any_end = any_base + length;
+	
+	for(const unsigned char *p = any_base; p < any_end;)
+	{
+		const unsigned char *run_begin = (const unsigned char*)(memchr(p, 1, (any_end - p)));
+		if(run_begin == NULL)
+		{
+			break;
+		}
+		
+		const unsigned char *run_end = (const unsigned char*)(memchr(run_begin, 0, (any_end - run_begin)));
+		if(run_end == NULL)
+		{
+			run_end = any_end;
+		}
+		
+		different[0].set_range((rel_offset + (run_begin - any_base)), (run_end - run_begin));
+		
+		p = run_end;
+	}
+}
+
+void REHex::MultiDiff::clear_range(off_t offset, off_t length)
+{
+	for(auto d = different.begin(); d != different.end(); ++d)
+	{
+		d->clear_range(offset, length);
+	}
+}
+
+void REHex::MultiDiff::clear_all()
+{
+	for(auto d = different.begin(); d != different.end(); ++d)
+	{
+		d->clear_all();
+	}
+}
+
+const REHex::ByteRangeSet &REHex::MultiDiff::get_different() const
+{
+	return different[0];
+}
+
+const REHex::ByteRangeSet &REHex::MultiDiff::get_different(size_t range_idx) const
+{
+	assert(range_idx < different.size());
+	return different[range_idx];
+}
@@ -0,0 +1,106 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_MULTIDIFF_HPP
+#define REHEX_MULTIDIFF_HPP
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <vector>
+
+#include "ByteRangeSet.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Differences between any number of ranges of data.
+	 *
+	 * Each range is compared against the first (base) range. For every range other than
+	 * the base, the offsets where it differs from the base are recorded in its own set,
+	 * the set for the base range holds the offsets where any range differs.
+	 *
+	 * Offsets are relative to the start of each range. Ranges may be different lengths,
+	 * the missing bytes beyond the end of a range differ from any present bytes.
+	*/
+	class MultiDiff
+	{
+		public:
+			MultiDiff();
+			
+			/**
+			 * @brief Clear all differences and set the number of ranges.
+			*/
+			void reset(size_t num_ranges);
+			
+			/**
+			 * @brief Get the number of ranges.
+			*/
+			size_t get_num_ranges() const;
+			
+			/**
+			 * @brief Compare a slice of every range in one pass.
+			 *
+			 * @param rel_offset  Offset of the slice, relative to the start of the ranges.
+			 * @param length      Length of the slice.
+			 * @param data        Data from the slice of each range.
+			 * @param available   Number of bytes each range has within the slice.
+			 *
+			 * If a range has fewer than length bytes available, the rest of the slice
+			 * is beyond the end of that range. The data pointer for a range is only used
+			 * if it has to be compared against another range, so can be NULL if no other
+			 * range has any data at that point.
+			 *
+			 * Any differences previously recorded within the slice are replaced.
+			*/
+			void process_slice(off_t rel_offset, off_t length, const unsigned char *const *data, const off_t *available);
+			
+			/**
+			 * @brief Forget any differences within a range of offsets.
+			*/
+			void clear_range(off_t offset, off_t length);
+			
+			/**
+			 * @brief Forget all differences.
+			*/
+			void clear_all();
+			
+			/**
+			 * @brief Get the offsets where any range differs.
+			*/
+			const ByteRangeSet &get_different() const;
+			
+			/**
+			 * @brief Get the offsets where a range differs from the base range.
+			 *
+			 * Returns the same set as get_different() for the base range (index 0).
+			*/
+			const ByteRangeSet &get_different(size_t range_idx) const;
+		
+		private:
+			/**
+			 * @brief Differences for each range, the first element is the union of all.
+			*/
+			std::vector<ByteRangeSet> different;
+			
+			/**
+			 * @brief Scratch space for process_slice().
+			*/
+			std::vector<unsigned char> slice_any;
+	};
+}
+
+#endif /* !REHEX_MULTIDIFF_HPP */
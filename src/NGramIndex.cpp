@@ -0,0 +1,544 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdio.h>
+#include <string.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+
+#include "NGramIndex.hpp"
+
+const off_t REHex::NGramIndex::BLOCK_SIZE;
+const size_t REHex::NGramIndex::FILTER_BITS;
+const size_t REHex::NGramIndex::MAX_QUERY_LENGTH;
+
+static const size_t FILTER_WORDS = REHex::NGramIndex::FILTER_BITS / 64;
+
+/* Blocks with more bits than this set in their bitmap are treated as matching anything. */
+static const size_t SATURATION_BITS = (REHex::NGramIndex::FILTER_BITS * 3) / 4;
+
+static const char CACHE_MAGIC[8] = { 'R', 'H', 'X', 'N', 'G', 'R', 'A', 'M' };
+static const uint32_t CACHE_VERSION = 1;
+
+/* Header of a saved index, followed by a state byte for each block and then the bitmap
+ * of each FILTERED block in order. Integers are stored in native byte order, the
+ * byte_order field catches a cache being moved between machines.
+*/
+struct NGramCacheHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	
+	uint64_t block_size;
+	uint64_t filter_bits;
+	uint64_t max_query_length;
+	
+	uint64_t file_length;
+	int64_t file_mtime;
+	uint64_t num_blocks;
+};
+
+static const uint32_t CACHE_BYTE_ORDER = 0x01020304;
+
+static unsigned char fold_case(unsigned char c)
+{
+	return (c >= 'A' && c <= 'Z') ? (c - 'A' + 'a') : c;
+}
+
+static size_t popcount64(uint64_t v)
+{
+	size_t count = 0;
+	
+	for(; v != 0; v &= (v - 1))
+	{
+		++count;
+	}
+	
+	return count;
+}
+
+REHex::NGramIndex::NGramIndex(SharedDocumentPointer &document, bool load_cache):
+	document(document)
+{
+	rp.reset(new RangeProcessor([this](off_t window_base, off_t window_size) { process_range(window_base, window_size); }, BLOCK_SIZE));
+	
+	this->document.auto_cleanup_bind(DATA_ERASE,     &REHex::NGramIndex::OnDataErase,     this);
+	this->document.auto_cleanup_bind(DATA_INSERT,    &REHex::NGramIndex::OnDataInsert,    this);
+	this->document.auto_cleanup_bind(DATA_OVERWRITE, &REHex::NGramIndex::OnDataOverwrite, this);
+	
+	this->document.auto_cleanup_bind(DATA_ERASING,           &REHex::NGramIndex::OnDataModifying,     this);
+	this->document.auto_cleanup_bind(DATA_ERASE_ABORTED,     &REHex::NGramIndex::OnDataModifyAborted, this);
+	this->document.auto_cleanup_bind(DATA_INSERTING,         &REHex::NGramIndex::OnDataModifying,     this);
+	this->document.auto_cleanup_bind(DATA_INSERT_ABORTED,    &REHex::NGramIndex::OnDataModifyAborted, this);
+	this->document.auto_cleanup_bind(DATA_OVERWRITING,       &REHex::NGramIndex::OnDataModifying,     this);
+	this->document.auto_cleanup_bind(DATA_OVERWRITE_ABORTED, &REHex::NGramIndex::OnDataModifyAborted, this);
+	
+	off_t length = document->buffer_length();
+	blocks.resize((length + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	
+	if(load_cache)
+	{
+		this->load_cache();
+	}
+	
+	/* Queue any blocks which weren't loaded from the cache. */
+	
+	for(size_t i = 0; i < blocks.size();)
+	{
+		if(blocks[i].state != BlockState::UNINDEXED)
+		{
+			++i;
+			continue;
+		}
+		
+		size_t end = i + 1;
+		while(end < blocks.size() && blocks[end].state == BlockState::UNINDEXED)
+		{
+			++end;
+		}
+		
+		queue_blocks(i, end);
+		i = end;
+	}
+}
+
+REHex::NGramIndex::~NGramIndex()
+{
+	/* Stop the worker threads before anything they use is destroyed. */
+	rp.reset(NULL);
+}
+
+uint32_t REHex::NGramIndex::trigram_hash(unsigned char a, unsigned char b, unsigned char c)
+{
+	uint32_t trigram = ((uint32_t)(fold_case(a)) << 16) | ((uint32_t)(fold_case(b)) << 8) | (uint32_t)(fold_case(c));
+	
+	/* Fibonacci hashing - take the top bits of the product. */
+	return (trigram * UINT32_C(2654435761)) >> (32 - 15);
+}
+
+REHex::ByteRangeSet REHex::NGramIndex::find_candidates(const std::vector<unsigned char> &needle) const
+{
+	static_assert(FILTER_BITS == (1 << 15), "trigram_hash() returns 15-bit values");
+	
+	off_t length = document->buffer_length();
+	
+	ByteRangeSet candidates;
+	
+	if(needle.size() < 3)
+	{
+		candidates.set_range(0, length);
+		return candidates;
+	}
+	
+	std::vector<uint32_t> hashes;
+	
+	size_t query_length = std::min(needle.size(), MAX_QUERY_LENGTH);
+	for(size_t i = 0; (i + 3) <= query_length; ++i)
+	{
+		hashes.push_back(trigram_hash(needle[i], needle[i + 1], needle[i + 2]));
+	}
+	
+	std::sort(hashes.begin(), hashes.end());
+	hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+	
+	std::lock_guard<std::mutex> bl(blocks_lock);
+	
+	/* Adjacent candidate blocks are merged before adding them to the set. */
+	off_t run_begin = -1, run_end = -1;
+	
+	for(size_t i = 0; i < blocks.size(); ++i)
+	{
+		const Block &block = blocks[i];
+		
+		bool candidate = true;
+		
+		if(block.state == BlockState::FILTERED)
+		{
+			for(auto h = hashes.begin(); h != hashes.end() && candidate; ++h)
+			{
+				candidate = (block.filter[*h / 64] & ((uint64_t)(1) << (*h % 64))) != 0;
+			}
+		}
+		
+		if(!candidate)
+		{
+			continue;
+		}
+		
+		off_t block_begin = (off_t)(i) * BLOCK_SIZE;
+		off_t block_end   = std::min((block_begin + BLOCK_SIZE), length);
+		
+		if(block_begin == run_end)
+		{
+			run_end = block_end;
+		}
+		else{
+			if(run_begin >= 0)
+			{
+				candidates.set_range(run_begin, (run_end - run_begin));
+			}
+			
+			run_begin = block_begin;
+			run_end   = block_end;
+		}
+	}
+	
+	if(run_begin >= 0 && run_end > run_begin)
+	{
+		candidates.set_range(run_begin, (run_end - run_begin));
+	}
+	
+	return candidates;
+}
+
+size_t REHex::NGramIndex::get_indexed_blocks() const
+{
+	std::lock_guard<std::mutex> bl(blocks_lock);
+	
+	return std::count_if(blocks.begin(), blocks.end(),
+		[](const Block &block) { return block.state != BlockState::UNINDEXED; });
+}
+
+void REHex::NGramIndex::wait_for_completion()
+{
+	rp->wait_for_completion();
+}
+
+std::string REHex::NGramIndex::cache_filename(const std::string &filename)
+{
+	return filename + ".rehex-index";
+}
+
+bool REHex::NGramIndex::cache_exists(const std::string &filename)
+{
+	return !filename.empty() && wxFileExists(cache_filename(filename));
+}
+
+void REHex::NGramIndex::remove_cache(const std::string &filename)
+{
+	if(cache_exists(filename))
+	{
+		wxRemoveFile(cache_filename(filename));
+	}
+}
+
+int64_t REHex::NGramIndex::file_mtime()
+{
+	wxDateTime mtime = wxFileName(document->get_filename()).GetModificationTime();
+	return mtime.IsValid() ? (int64_t)(mtime.GetValue().GetValue()) : -1;
+}
+
+bool REHex::NGramIndex::save_cache()
+{
+	std::string filename = document->get_filename();
+	
+	/* The index describes the current data, which is only what will be in the file next
+	 * time it is opened if it hasn't been changed since the last save.
+	*/
+	if(filename.empty() || document->is_buffer_dirty() || get_indexed_blocks() == 0)
+	{
+		return false;
+	}
+	
+	NGramCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	
+	memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+	header.version = CACHE_VERSION;
+	header.byte_order = CACHE_BYTE_ORDER;
+	header.block_size = BLOCK_SIZE;
+	header.filter_bits = FILTER_BITS;
+	header.max_query_length = MAX_QUERY_LENGTH;
+	header.file_length = document->buffer_length();
+	header.file_mtime = file_mtime();
+	
+	std::string cache_name = cache_filename(filename);
+	
+	FILE *out = fopen(cache_name.c_str(), "wb");
+	if(out == NULL)
+	{
+		throw std::runtime_error("Unable to open " + cache_name);
+	}
+	
+	bool ok;
+	
+	{
+		std::lock_guard<std::mutex> bl(blocks_lock);
+		
+		header.num_blocks = blocks.size();
+		
+		std::vector<unsigned char> states;
+		states.reserve(blocks.size());
+		
+		for(auto b = blocks.begin(); b != blocks.end(); ++b)
+		{
+			states.push_back((unsigned char)(b->state));
+		}
+		
+		ok = fwrite(&header, sizeof(header), 1, out) == 1
+			&& (states.empty() || fwrite(states.data(), states.size(), 1, out) == 1);
+		
+		for(auto b = blocks.begin(); ok && b != blocks.end(); ++b)
+		{
+			if(b->state == BlockState::FILTERED)
+			{
+				ok = fwrite(b->filter.data(), (FILTER_WORDS * sizeof(uint64_t)), 1, out) == 1;
+			}
+		}
+	}
+	
+	ok = (fclose(out) == 0) && ok;
+	
+	if(!ok)
+	{
+		wxRemoveFile(cache_name);
+		throw std::runtime_error("Unable to write " + cache_name);
+	}
+	
+	return true;
+}
+
+bool REHex::NGramIndex::load_cache()
+{
+	std::string filename = document->get_filename();
+	
+	if(filename.empty() || document->is_buffer_dirty() || !cache_exists(filename))
+	{
+		return false;
+	}
+	
+	std::string cache_name = cache_filename(filename);
+	
+	FILE *in = fopen(cache_name.c_str(), "rb");
+	if(in == NULL)
+	{
+		return false;
+	}
+	
+	NGramCacheHeader header;
+	
+	bool ok = fread(&header, sizeof(header), 1, in) == 1
+		&& memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) == 0
+		&& header.version == CACHE_VERSION
+		&& header.byte_order == CACHE_BYTE_ORDER
+		&& header.block_size == (uint64_t)(BLOCK_SIZE)
+		&& header.filter_bits == FILTER_BITS
+		&& header.max_query_length == MAX_QUERY_LENGTH
+		&& header.file_length == (uint64_t)(document->buffer_length())
+		&& header.file_mtime == file_mtime()
+		&& header.num_blocks == blocks.size();
+	
+	std::vector<Block> loaded_blocks(blocks.size());
+	
+	if(ok && !loaded_blocks.empty())
+	{
+		std::vector<unsigned char> states(loaded_blocks.size());
+		ok = fread(states.data(), states.size(), 1, in) == 1;
+		
+		for(size_t i = 0; ok && i < loaded_blocks.size(); ++i)
+		{
+			switch(states[i])
+			{
+				case (unsigned char)(BlockState::UNINDEXED):
+				case (unsigned char)(BlockState::SATURATED):
+					loaded_blocks[i].state = (BlockState)(states[i]);
+					break;
+				
+				case (unsigned char)(BlockState::FILTERED):
+					loaded_blocks[i].state = BlockState::FILTERED;
+					loaded_blocks[i].filter.resize(FILTER_WORDS);
+					
+					ok = fread(loaded_blocks[i].filter.data(), (FILTER_WORDS * sizeof(uint64_t)), 1, in) == 1;
+					break;
+				
+				default:
+					ok = false;
+					break;
+			}
+		}
+	}
+	
+	fclose(in);
+	
+	if(ok)
+	{
+		std::lock_guard<std::mutex> bl(blocks_lock);
+		blocks = std::move(loaded_blocks);
+	}
+	
+	return ok;
+}
+
+void REHex::NGramIndex::queue_blocks(size_t first_block, size_t end_block)
+{
+	if(end_block > first_block)
+	{
+		rp->queue_range(((off_t)(first_block) * BLOCK_SIZE), ((off_t)(end_block - first_block) * BLOCK_SIZE));
+	}
+}
+
+void REHex::NGramIndex::process_range(off_t window_base, off_t window_size)
+{
+	for(off_t block_base = window_base - (window_base % BLOCK_SIZE); block_base < (window_base + window_size); block_base += BLOCK_SIZE)
+	{
+		process_block(block_base / BLOCK_SIZE);
+	}
+}
+
+void REHex::NGramIndex::process_block(size_t block_idx)
+{
+	off_t block_base = (off_t)(block_idx) * BLOCK_SIZE;
+	
+	/* Read enough of the next block to cover any sequence of up to MAX_QUERY_LENGTH bytes
+	 * starting in this one.
+	*/
+	
+	std::vector<unsigned char> data;
+	try {
+		data = document->read_data(block_base, (BLOCK_SIZE + MAX_QUERY_LENGTH - 1));
+	}
+	catch(const std::exception &e)
+	{
+		/* Document has probably been truncated under us, it will be requeued. */
+		return;
+	}
+	
+	Block block;
+	block.filter.resize(FILTER_WORDS, 0);
+	
+	for(size_t i = 0; (i + 3) <= data.size(); ++i)
+	{
+		uint32_t h = trigram_hash(data[i], data[i + 1], data[i + 2]);
+		block.filter[h / 64] |= (uint64_t)(1) << (h % 64);
+	}
+	
+	size_t bits_set = 0;
+	for(auto w = block.filter.begin(); w != block.filter.end(); ++w)
+	{
+		bits_set += popcount64(*w);
+	}
+	
+	if(bits_set > SATURATION_BITS)
+	{
+		block.state = BlockState::SATURATED;
+		block.filter.clear();
+		block.filter.shrink_to_fit();
+	}
+	else{
+		block.state = BlockState::FILTERED;
+	}
+	
+	std::lock_guard<std::mutex> bl(blocks_lock);
+	
+	if(block_idx < blocks.size())
+	{
+		blocks[block_idx] = std::move(block);
+	}
+}
+
+void REHex::NGramIndex::data_moved(off_t offset)
+{
+	/* Everything from the modified offset onwards has moved, along with the tail end of
+	 * the block(s) whose bitmaps overlap it. Throw those away and index them again.
+	*/
+	
+	off_t first_moved_byte = std::max<off_t>((offset - (off_t)(MAX_QUERY_LENGTH) + 1), 0);
+	size_t first_moved_block = first_moved_byte / BLOCK_SIZE;
+	
+	rp->unqueue_range(((off_t)(first_moved_block) * BLOCK_SIZE), (std::numeric_limits<off_t>::max() - ((off_t)(first_moved_block) * BLOCK_SIZE)));
+	
+	size_t num_blocks = (document->buffer_length() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	
+	{
+		std::lock_guard<std::mutex> bl(blocks_lock);
+		
+		blocks.resize(std::min(blocks.size(), first_moved_block));
+		blocks.resize(std::max(blocks.size(), num_blocks));
+	}
+	
+	queue_blocks(first_moved_block, num_blocks);
+	
+	rp->resume_threads();
+}
+
+void REHex::NGramIndex::OnDataModifying(OffsetLengthEvent &event)
+{
+	rp->pause_threads();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::NGramIndex::OnDataModifyAborted(OffsetLengthEvent &event)
+{
+	rp->resume_threads();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::NGramIndex::OnDataErase(OffsetLengthEvent &event)
+{
+	data_moved(event.offset);
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::NGramIndex::OnDataInsert(OffsetLengthEvent &event)
+{
+	data_moved(event.offset);
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::NGramIndex::OnDataOverwrite(OffsetLengthEvent &event)
+{
+	if(event.length > 0)
+	{
+		/* Any block whose bitmap covers an overwritten byte needs indexing again. */
+		
+		off_t first_byte = std::max<off_t>((event.offset - (off_t)(MAX_QUERY_LENGTH) + 1), 0);
+		
+		size_t first_block = first_byte / BLOCK_SIZE;
+		size_t end_block = ((event.offset + event.length - 1) / BLOCK_SIZE) + 1;
+		
+		{
+			std::lock_guard<std::mutex> bl(blocks_lock);
+			
+			end_block = std::min(end_block, blocks.size());
+			
+			for(size_t i = first_block; i < end_block; ++i)
+			{
+				blocks[i] = Block();
+			}
+		}
+		
+		queue_blocks(first_block, end_block);
+	}
+	
+	rp->resume_threads();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
@@ -0,0 +1,176 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_NGRAMINDEX_HPP
+#define REHEX_NGRAMINDEX_HPP
+
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <wx/event.h>
+
+#include "ByteRangeSet.hpp"
+#include "document.hpp"
+#include "Events.hpp"
+#include "RangeProcessor.hpp"
+#include "SharedDocumentPointer.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Index of the trigrams present in each block of a Document.
+	 *
+	 * The document is split into BLOCK_SIZE blocks and the (ASCII case folded) trigrams
+	 * found in each are hashed into a FILTER_BITS bitmap. Searches for a sequence of
+	 * bytes can then skip any block whose bitmap is missing one of the sequence's
+	 * trigrams, since the sequence can't possibly start there.
+	 *
+	 * Each bitmap also covers the first MAX_QUERY_LENGTH - 1 bytes of the following
+	 * block, so a sequence of up to MAX_QUERY_LENGTH bytes starting in a block is wholly
+	 * described by that block's bitmap. Only the first MAX_QUERY_LENGTH bytes of longer
+	 * sequences are used to narrow the search.
+	 *
+	 * The index is built on background threads and any blocks touched by changes to the
+	 * data are indexed again. Blocks which haven't been indexed yet are always searched.
+	 *
+	 * The bitmaps use around 1/16th of the size of the data, except for high-entropy
+	 * blocks (compressed/encrypted data, etc) which set so many bits that they wouldn't
+	 * narrow down a search, these are always searched and take no space in the index.
+	 *
+	 * The index can be saved next to the file (see save_cache()) and is loaded again by
+	 * the next NGramIndex for the same file if the file hasn't been modified since.
+	*/
+	class NGramIndex: public wxEvtHandler
+	{
+		public:
+			/**
+			 * @brief Size of each indexed block, in bytes.
+			*/
+			static const off_t BLOCK_SIZE = 64 * 1024;
+			
+			/**
+			 * @brief Size of the trigram bitmap for each block, in bits.
+			*/
+			static const size_t FILTER_BITS = 32 * 1024;
+			
+			/**
+			 * @brief Longest byte sequence used to narrow down a search.
+			*/
+			static const size_t MAX_QUERY_LENGTH = 64;
+			
+			/**
+			 * @brief Create an index of a Document.
+			 *
+			 * @param document    Document to index.
+			 * @param load_cache  Load any saved index for the file before indexing.
+			*/
+			NGramIndex(SharedDocumentPointer &document, bool load_cache = true);
+			
+			virtual ~NGramIndex();
+			
+			/**
+			 * @brief Find where a sequence of bytes may start.
+			 *
+			 * Returns the ranges of the file which a search for the given sequence
+			 * must check. Sequences shorter than a trigram can't be narrowed down, so
+			 * the whole file is returned.
+			 *
+			 * This method is thread-safe.
+			*/
+			ByteRangeSet find_candidates(const std::vector<unsigned char> &needle) const;
+			
+			/**
+			 * @brief Get the number of blocks which have been indexed.
+			*/
+			size_t get_indexed_blocks() const;
+			
+			/**
+			 * @brief Save the index for the next time the file is opened.
+			 *
+			 * The index is only saved if the document has a backing file and the
+			 * data hasn't been modified since it was last saved. Returns true if the
+			 * index was saved.
+			*/
+			bool save_cache();
+			
+			/**
+			 * @brief Wait for all queued indexing to finish.
+			 *
+			 * This is mostly intended for unit tests. This should not be used from the
+			 * application UI thread.
+			*/
+			void wait_for_completion();
+			
+			/**
+			 * @brief Get the name of the file the index of a file is saved to.
+			*/
+			static std::string cache_filename(const std::string &filename);
+			
+			/**
+			 * @brief Check if there is a saved index for a file.
+			*/
+			static bool cache_exists(const std::string &filename);
+			
+			/**
+			 * @brief Delete any saved index for a file.
+			*/
+			static void remove_cache(const std::string &filename);
+		
+		private:
+			enum class BlockState: unsigned char
+			{
+				UNINDEXED = 0,
+				SATURATED = 1,
+				FILTERED  = 2,
+			};
+			
+			struct Block
+			{
+				BlockState state;
+				std::vector<uint64_t> filter;
+				
+				Block(): state(BlockState::UNINDEXED) {}
+			};
+			
+			SharedDocumentPointer document;
+			
+			std::vector<Block> blocks;
+			mutable std::mutex blocks_lock;
+			
+			std::unique_ptr<RangeProcessor> rp;
+			
+			static uint32_t trigram_hash(unsigned char a, unsigned char b, unsigned char c);
+			
+			bool load_cache();
+			int64_t file_mtime();
+			
+			void queue_blocks(size_t first_block, size_t end_block);
+			void process_range(off_t window_base, off_t window_size);
+			void process_block(size_t block_idx);
+			void data_moved(off_t offset);
+			
+			void OnDataModifying(OffsetLengthEvent &event);
+			void OnDataModifyAborted(OffsetLengthEvent &event);
+			void OnDataErase(OffsetLengthEvent &event);
+			void OnDataInsert(OffsetLengthEvent &event);
+			void OnDataOverwrite(OffsetLengthEvent &event);
+	};
+}
+
+#endif /* !REHEX_NGRAMINDEX_HPP */
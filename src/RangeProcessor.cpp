@@ -75,6 +75,12 @@ void REHex::RangeProcessor::clear_queue()
 	queued.clear_all();
 }
 
+void REHex::RangeProcessor::set_focus(const ByteRangeSet &focus)
+{
+	std::lock_guard<std::mutex> pl(pause_lock);
+	scheduler.set_focus(focus);
+}
+
 void REHex::RangeProcessor::queue_range_locked(off_t offset, off_t length)
 {
 	ByteRangeSet to_pending;
@@ -133,8 +139,8 @@ void REHex::RangeProcessor::thread_main()
 		 * processed in this thread.
 		*/
 		
-		auto next_dirty_range = pending.begin();
-		if(next_dirty_range == pending.end())
+		ByteRangeSet::Range next_window = scheduler.next_window(pending, 0, max_window_size);
+		if(next_window.length == 0)
 		{
 			/* Nothing to do.
 			 * Wait until some work is available or we need to pause/stop the thread.
@@ -156,10 +162,8 @@ void REHex::RangeProcessor::thread_main()
 			continue;
 		}
 		
-		off_t  window_base   = next_dirty_range->offset;
-		size_t window_length = next_dirty_range->length;
-		
-		window_length = std::min<off_t>(window_length, max_window_size);
+		off_t  window_base   = next_window.offset;
+		size_t window_length = next_window.length;
 		
 		pending.clear_range(window_base, window_length);
 		working.set_range(  window_base, window_length);
@@ -27,6 +27,7 @@
 #include <thread>
 
 #include "ByteRangeSet.hpp"
+#include "RangeScheduler.hpp"
 
 namespace REHex
 {
@@ -35,6 +36,9 @@ namespace REHex
 	 *
 	 * This class breaks up one or more ranges of bytes to be processed into smaller blocks
 	 * and processes them using a callback function on worker threads.
+	 *
+	 * Blocks are processed in offset order unless a focus has been set using set_focus(),
+	 * in which case the blocks nearest the focus are processed first.
 	*/
 	class RangeProcessor
 	{
@@ -88,6 +92,17 @@ namespace REHex
 			*/
 			void clear_queue();
 			
+			/**
+			 * @brief Set the ranges to be processed first.
+			 *
+			 * Queued blocks nearest to the given ranges (e.g. the area of the file which
+			 * is on screen) will be processed before the rest of the queue. Can be
+			 * called again to update the focus as the user moves around the file.
+			 *
+			 * Blocks never cross a multiple of the window size while a focus is set.
+			*/
+			void set_focus(const ByteRangeSet &focus);
+			
 			/**
 			 * @brief Pause worker threads.
 			 *
@@ -129,6 +144,7 @@ namespace REHex
 			ByteRangeSet queued;                /**< Ranges which are queued, but already being worked. */
 			ByteRangeSet pending;               /**< Ranges waiting to be processed. */
 			ByteRangeSet working;               /**< Ranges currently being processed. */
+			RangeScheduler scheduler;           /**< Chooses which pending range to process next. */
 			
 			void queue_range_locked(off_t offset, off_t length);
 			void mark_work_done(off_t offset, off_t length);
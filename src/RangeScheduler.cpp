@@ -0,0 +1,141 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+#include "RangeScheduler.hpp"
+
+REHex::RangeScheduler::RangeScheduler() {}
+
+void REHex::RangeScheduler::set_focus(const ByteRangeSet &focus)
+{
+	this->focus = focus;
+}
+
+void REHex::RangeScheduler::clear_focus()
+{
+	focus.clear_all();
+}
+
+const REHex::ByteRangeSet &REHex::RangeScheduler::get_focus() const
+{
+	return focus;
+}
+
+/* Returns the window within range which contains point, without crossing a multiple of
+ * max_window_size.
+*/
+static REHex::ByteRangeSet::Range window_at(const REHex::ByteRangeSet::Range &range, off_t min_offset, off_t point, off_t max_window_size)
+{
+	off_t range_begin = std::max(range.offset, min_offset);
+	off_t range_end   = range.offset + range.length;
+	
+	point = std::max(point, range_begin);
+	point = std::min(point, (range_end - 1));
+	
+	off_t cell_begin = point - (point % max_window_size);
+	off_t cell_end   = cell_begin + max_window_size;
+	
+	off_t window_begin = std::max(range_begin, cell_begin);
+	off_t window_end   = std::min(range_end, cell_end);
+	
+	return REHex::ByteRangeSet::Range(window_begin, (window_end - window_begin));
+}
+
+REHex::ByteRangeSet::Range REHex::RangeScheduler::next_window(const ByteRangeSet &queue, off_t min_offset, off_t max_window_size) const
+{
+	const off_t MAX_OFFSET = std::numeric_limits<off_t>::max();
+	
+	auto first = queue.find_first_in(min_offset, (MAX_OFFSET - min_offset));
+	if(first == queue.end())
+	{
+		return ByteRangeSet::Range(0, 0);
+	}
+	
+	if(focus.empty())
+	{
+		/* No focus - process the queue in order. */
+		
+		off_t window_begin = std::max(first->offset, min_offset);
+		off_t window_end   = first->offset + first->length;
+		
+		return ByteRangeSet::Range(window_begin, std::min((window_end - window_begin), max_window_size));
+	}
+	
+	ByteRangeSet::Range best(0, 0);
+	off_t best_distance = MAX_OFFSET;
+	
+	for(auto f = focus.begin(); f != focus.end(); ++f)
+	{
+		off_t f_begin = std::max(f->offset, min_offset);
+		off_t f_end   = f->offset + f->length;
+		
+		/* The first queued range ending after the start of the focused range, this
+		 * is either within the focused range or the nearest one after it.
+		*/
+		
+		auto after = queue.find_first_in(f_begin, (MAX_OFFSET - f_begin));
+		
+		if(after != queue.end())
+		{
+			off_t point = std::max(after->offset, f_begin);
+			off_t distance = point < f_end
+				? 0
+				: (point - f_end) + 1;
+			
+			if(distance < best_distance)
+			{
+				best = window_at(*after, min_offset, point, max_window_size);
+				best_distance = distance;
+			}
+		}
+		
+		/* The nearest queued range before the start of the focused range, which we
+		 * work on backwards from the end of.
+		*/
+		
+		if(after != queue.begin())
+		{
+			auto before = std::prev(after);
+			
+			off_t before_end = before->offset + before->length;
+			
+			if(before_end > min_offset)
+			{
+				off_t point = before_end - 1;
+				off_t distance = f_begin - point;
+				
+				if(distance < best_distance)
+				{
+					best = window_at(*before, min_offset, point, max_window_size);
+					best_distance = distance;
+				}
+			}
+		}
+		
+		if(best_distance == 0)
+		{
+			break;
+		}
+	}
+	
+	return best;
+}
@@ -0,0 +1,78 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_RANGESCHEDULER_HPP
+#define REHEX_RANGESCHEDULER_HPP
+
+#include <stddef.h>
+
+#include "ByteRangeSet.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Chooses which part of a work queue to process next.
+	 *
+	 * Background workers which process ranges of a file use this to pick the next
+	 * window of work from their queue. By default the lowest offset in the queue is
+	 * processed first. When a focus has been set (usually the part of the file which is
+	 * on screen and the cursor position), the queued window nearest to any focused range
+	 * is chosen instead, so processing starts where the user is looking and spreads
+	 * outwards from there.
+	 *
+	 * When a focus is set, windows never cross a multiple of the window size, so work
+	 * queued in window-aligned blocks is still processed in the same blocks.
+	 *
+	 * This class isn't thread safe, the owner must serialise access to it.
+	*/
+	class RangeScheduler
+	{
+		public:
+			RangeScheduler();
+			
+			/**
+			 * @brief Set the ranges which should be prioritised.
+			*/
+			void set_focus(const ByteRangeSet &focus);
+			
+			/**
+			 * @brief Clear the focus, reverting to processing in offset order.
+			*/
+			void clear_focus();
+			
+			/**
+			 * @brief Get the ranges which are prioritised.
+			*/
+			const ByteRangeSet &get_focus() const;
+			
+			/**
+			 * @brief Choose the next window to be processed.
+			 *
+			 * @param queue            Ranges waiting to be processed.
+			 * @param min_offset       Ignore any queued data before this offset.
+			 * @param max_window_size  Maximum length of window to return.
+			 *
+			 * @returns The range to process next, zero length if there is nothing to do.
+			*/
+			ByteRangeSet::Range next_window(const ByteRangeSet &queue, off_t min_offset, off_t max_window_size) const;
+		
+		private:
+			ByteRangeSet focus;
+	};
+}
+
+#endif /* !REHEX_RANGESCHEDULER_HPP */
@@ -101,6 +101,24 @@ namespace REHex
 				std::shared_ptr<T> s = std::make_shared<T>(filename);
 				return SharedDocumentPointerImpl<T>(s);
 			}
+			
+			/**
+			 * @brief Construct a new Document and return a SharedDocumentPointer.
+			*/
+			static SharedDocumentPointerImpl<T> make(const std::vector<std::string> &filenames)
+			{
+				std::shared_ptr<T> s = std::make_shared<T>(filenames);
+				return SharedDocumentPointerImpl<T>(s);
+			}
+			
+			/**
+			 * @brief Construct a fork of a Document and return a SharedDocumentPointer.
+			*/
+			static SharedDocumentPointerImpl<T> make_fork(SharedDocumentPointerImpl<T> &parent)
+			{
+				std::shared_ptr<T> s = std::make_shared<T>(parent.document.get());
+				return SharedDocumentPointerImpl<T>(s);
+			}
 	};
 	
 	using SharedDocumentPointer = SharedDocumentPointerImpl<Document>;
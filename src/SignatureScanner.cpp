@@ -0,0 +1,1677 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+#include <condition_variable>
+#include <ctype.h>
+#include <exception>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include <wx/ffile.h>
+#include <wx/filedlg.h>
+#include <wx/msgdlg.h>
+#include <wx/progdlg.h>
+
+#include "App.hpp"
+#include "mainwindow.hpp"
+#include "SignatureScanner.hpp"
+#include "ThreadPool.hpp"
+
+const size_t REHex::SignatureScanner::MAX_MATCHES_PER_STRING;
+const off_t REHex::SignatureScanner::DEFAULT_WINDOW_SIZE;
+
+/* Longest run of fixed bytes used as the prefilter atom for a string. Longer atoms find
+ * fewer false candidates, but each nocase atom expands to 2^n automaton entries.
+*/
+static const size_t MAX_ATOM_LENGTH = 4;
+
+/* Largest jump allowed in a hex string. */
+static const off_t MAX_JUMP = 0x10000;
+
+static unsigned char fold_case(unsigned char c)
+{
+	return (c >= 'A' && c <= 'Z') ? (c - 'A' + 'a') : c;
+}
+
+struct SigPatternByte
+{
+	unsigned char value;
+	unsigned char mask;
+	
+	SigPatternByte(unsigned char value, unsigned char mask):
+		value(value), mask(mask) {}
+};
+
+/* A run of bytes in a string, preceeded by a jump of jump_min to jump_max bytes from the
+ * end of the previous segment (always zero for the first segment).
+*/
+struct SigSegment
+{
+	std::vector<SigPatternByte> bytes;
+	off_t jump_min;
+	off_t jump_max;
+	
+	SigSegment(off_t jump_min, off_t jump_max):
+		jump_min(jump_min), jump_max(jump_max) {}
+};
+
+struct SigString
+{
+	std::string name;
+	std::vector<SigSegment> segments;
+	bool nocase;
+	
+	/* Fixed bytes from the first segment which are fed into the automaton. */
+	std::vector<unsigned char> atom;
+	size_t atom_offset;
+	
+	off_t max_length;
+	
+	SigString(): nocase(false), atom_offset(0), max_length(0) {}
+};
+
+struct SigCondition
+{
+	enum class Type
+	{
+		TRUE_,
+		FALSE_,
+		AND,
+		OR,
+		NOT,
+		MATCHED,     /* $x */
+		MATCHED_AT,  /* $x at value */
+		MATCHED_IN,  /* $x in (value..value2) */
+		COUNT,       /* #x OP value */
+		OFFSET,      /* @x[index] OP value */
+		FILESIZE,    /* filesize OP value */
+		OF,          /* min_matched of (strings) */
+	};
+	
+	enum class Compare { EQ, NE, LT, LE, GT, GE };
+	
+	Type type;
+	Compare compare;
+	
+	size_t string;
+	std::vector<size_t> strings;
+	size_t index;
+	size_t min_matched;
+	
+	off_t value;
+	off_t value2;
+	
+	std::unique_ptr<SigCondition> lhs;
+	std::unique_ptr<SigCondition> rhs;
+	
+	SigCondition(Type type):
+		type(type), compare(Compare::EQ), string(0), index(0), min_matched(0), value(0), value2(0) {}
+	
+	bool compare_to(off_t lhs_value) const
+	{
+		switch(compare)
+		{
+			case Compare::EQ: return lhs_value == value;
+			case Compare::NE: return lhs_value != value;
+			case Compare::LT: return lhs_value <  value;
+			case Compare::LE: return lhs_value <= value;
+			case Compare::GT: return lhs_value >  value;
+			case Compare::GE: return lhs_value >= value;
+		}
+		
+		return false;
+	}
+	
+	bool evaluate(const REHex::SignatureScanner::Results &results) const
+	{
+		switch(type)
+		{
+			case Type::TRUE_:
+				return true;
+			
+			case Type::FALSE_:
+				return false;
+			
+			case Type::AND:
+				return lhs->evaluate(results) && rhs->evaluate(results);
+			
+			case Type::OR:
+				return lhs->evaluate(results) || rhs->evaluate(results);
+			
+			case Type::NOT:
+				return !(lhs->evaluate(results));
+			
+			case Type::MATCHED:
+				return results.match_counts[string] > 0;
+			
+			case Type::MATCHED_AT:
+			{
+				const std::vector<REHex::SignatureScanner::Match> &m = results.matches[string];
+				
+				auto i = std::lower_bound(m.begin(), m.end(), REHex::SignatureScanner::Match(value, 0));
+				return i != m.end() && i->offset == value;
+			}
+			
+			case Type::MATCHED_IN:
+			{
+				const std::vector<REHex::SignatureScanner::Match> &m = results.matches[string];
+				
+				auto i = std::lower_bound(m.begin(), m.end(), REHex::SignatureScanner::Match(value, 0));
+				return i != m.end() && i->offset <= value2;
+			}
+			
+			case Type::COUNT:
+				return compare_to(results.match_counts[string]);
+			
+			case Type::OFFSET:
+			{
+				/* Offsets of matches beyond the stored ones are undefined. */
+				
+				const std::vector<REHex::SignatureScanner::Match> &m = results.matches[string];
+				return index < m.size() && compare_to(m[index].offset);
+			}
+			
+			case Type::FILESIZE:
+				return compare_to(results.filesize);
+			
+			case Type::OF:
+			{
+				size_t matched = std::count_if(strings.begin(), strings.end(),
+					[&](size_t s) { return results.match_counts[s] > 0; });
+				
+				return matched >= min_matched;
+			}
+		}
+		
+		return false;
+	}
+};
+
+struct SigRule
+{
+	std::string name;
+	std::vector<size_t> strings;
+	std::unique_ptr<SigCondition> condition;
+};
+
+struct REHex::SignatureScanner::Compiled
+{
+	std::vector<SigString> strings;
+	std::vector<SigRule> rules;
+	
+	/* Longest possible match of any string. */
+	off_t max_string_length;
+	
+	/* Furthest any atom can end from the start of its string. */
+	size_t max_atom_end;
+	
+	/* Aho-Corasick automaton over the atoms of all strings, as a DFA with 256 transitions
+	 * per state. The strings whose atoms end at each state (including those reached by
+	 * following the failure links) are outputs[ output_begin[state] .. output_begin[state + 1] ).
+	*/
+	std::vector<uint32_t> transitions;
+	std::vector<uint32_t> output_begin;
+	std::vector<uint32_t> outputs;
+	
+	Compiled(): max_string_length(0), max_atom_end(0) {}
+	
+	void build_automaton();
+};
+
+void REHex::SignatureScanner::Compiled::build_automaton()
+{
+	static const uint32_t NO_STATE = std::numeric_limits<uint32_t>::max();
+	
+	/* Build a trie of the atoms. Atoms of nocase strings are inserted in every combination
+	 * of upper and lower case so the data doesn't need to be folded as it is scanned.
+	*/
+	
+	std::vector<uint32_t> trie(256, NO_STATE);
+	std::vector< std::vector<uint32_t> > state_outputs(1);
+	
+	for(size_t s = 0; s < strings.size(); ++s)
+	{
+		const SigString &string = strings[s];
+		
+		std::vector<size_t> alpha_positions;
+		if(string.nocase)
+		{
+			for(size_t i = 0; i < string.atom.size(); ++i)
+			{
+				if(string.atom[i] >= 'a' && string.atom[i] <= 'z')
+				{
+					alpha_positions.push_back(i);
+				}
+			}
+		}
+		
+		for(unsigned int variant = 0; variant < (1U << alpha_positions.size()); ++variant)
+		{
+			std::vector<unsigned char> atom = string.atom;
+			for(size_t i = 0; i < alpha_positions.size(); ++i)
+			{
+				if(variant & (1U << i))
+				{
+					atom[ alpha_positions[i] ] = toupper(atom[ alpha_positions[i] ]);
+				}
+			}
+			
+			uint32_t state = 0;
+			for(auto b = atom.begin(); b != atom.end(); ++b)
+			{
+				uint32_t &next = trie[ (state * 256) + *b ];
+				if(next == NO_STATE)
+				{
+					next = state_outputs.size();
+					
+					state_outputs.emplace_back();
+					trie.resize((trie.size() + 256), NO_STATE);
+				}
+				
+				state = trie[ (state * 256) + *b ];
+			}
+			
+			if(std::find(state_outputs[state].begin(), state_outputs[state].end(), s) == state_outputs[state].end())
+			{
+				state_outputs[state].push_back(s);
+			}
+		}
+	}
+	
+	/* Fill in the missing transitions from the failure links, breadth first so the
+	 * transitions of each state's failure state are complete before they are needed.
+	*/
+	
+	size_t num_states = state_outputs.size();
+	
+	transitions = std::move(trie);
+	std::vector<uint32_t> fail(num_states, 0);
+	std::queue<uint32_t> queue;
+	
+	for(int b = 0; b < 256; ++b)
+	{
+		uint32_t &next = transitions[b];
+		
+		if(next == NO_STATE)
+		{
+			next = 0;
+		}
+		else{
+			queue.push(next);
+		}
+	}
+	
+	while(!queue.empty())
+	{
+		uint32_t state = queue.front();
+		queue.pop();
+		
+		const std::vector<uint32_t> &fail_outputs = state_outputs[ fail[state] ];
+		state_outputs[state].insert(state_outputs[state].end(), fail_outputs.begin(), fail_outputs.end());
+		
+		for(int b = 0; b < 256; ++b)
+		{
+			uint32_t &next = transitions[ (state * 256) + b ];
+			uint32_t fail_next = transitions[ (fail[state] * 256) + b ];
+			
+			if(next == NO_STATE)
+			{
+				next = fail_next;
+			}
+			else{
+				fail[next] = fail_next;
+				queue.push(next);
+			}
+		}
+	}
+	
+	output_begin.clear();
+	outputs.clear();
+	
+	for(size_t state = 0; state < num_states; ++state)
+	{
+		output_begin.push_back(outputs.size());
+		outputs.insert(outputs.end(), state_outputs[state].begin(), state_outputs[state].end());
+	}
+	
+	output_begin.push_back(outputs.size());
+}
+
+/* Returns the end of a match of the string's segments from seg_idx onwards starting at
+ * pos, or -1 if there isn't one. Jumps are tried shortest first.
+ *
+ * Each (segment, position) found not to match is added to failed and never tried again,
+ * so a string with several variable length jumps takes at most one attempt per segment
+ * at each position rather than one per combination of jump lengths.
+*/
+static off_t match_segments(const SigString &string, size_t seg_idx, const unsigned char *data, size_t data_length, size_t pos, std::set< std::pair<size_t, size_t> > *failed)
+{
+	const SigSegment &segment = string.segments[seg_idx];
+	
+	if(segment.bytes.size() > data_length || pos > (data_length - segment.bytes.size()))
+	{
+		return -1;
+	}
+	
+	for(auto b = segment.bytes.begin(); b != segment.bytes.end(); ++b, ++pos)
+	{
+		unsigned char c = string.nocase ? fold_case(data[pos]) : data[pos];
+		
+		if((c & b->mask) != b->value)
+		{
+			return -1;
+		}
+	}
+	
+	if((seg_idx + 1) == string.segments.size())
+	{
+		return pos;
+	}
+	
+	const SigSegment &next = string.segments[seg_idx + 1];
+	
+	for(size_t jump = next.jump_min; jump <= (size_t)(next.jump_max) && (pos + jump) < data_length; ++jump)
+	{
+		std::pair<size_t, size_t> attempt((seg_idx + 1), (pos + jump));
+		
+		if(failed->find(attempt) != failed->end())
+		{
+			continue;
+		}
+		
+		off_t end = match_segments(string, (seg_idx + 1), data, data_length, (pos + jump), failed);
+		if(end >= 0)
+		{
+			return end;
+		}
+		
+		failed->insert(attempt);
+	}
+	
+	return -1;
+}
+
+/* Returns the end of a match of the string starting at pos, or -1 if there isn't one. */
+static off_t match_string(const SigString &string, const unsigned char *data, size_t data_length, size_t pos)
+{
+	std::set< std::pair<size_t, size_t> > failed;
+	return match_segments(string, 0, data, data_length, pos, &failed);
+}
+
+/* Drop all but the lowest MAX_MATCHES_PER_STRING matches. */
+static void trim_matches(std::vector<REHex::SignatureScanner::Match> *matches)
+{
+	if(matches->size() > REHex::SignatureScanner::MAX_MATCHES_PER_STRING)
+	{
+		std::nth_element(matches->begin(), (matches->begin() + REHex::SignatureScanner::MAX_MATCHES_PER_STRING), matches->end());
+		matches->erase((matches->begin() + REHex::SignatureScanner::MAX_MATCHES_PER_STRING), matches->end());
+	}
+}
+
+class SigLexer
+{
+	public:
+		enum class TokenType
+		{
+			END,
+			IDENT,
+			STRING_ID,  /* $name (or $name* as a set) */
+			COUNT_ID,   /* #name */
+			OFFSET_ID,  /* @name */
+			NUMBER,
+			TEXT,
+			PUNCT,
+		};
+		
+		struct Token
+		{
+			TokenType type;
+			std::string text;
+			off_t number;
+			int line;
+			
+			Token(): type(TokenType::END), number(0), line(0) {}
+			
+			bool is(TokenType type, const char *text) const
+			{
+				return this->type == type && this->text == text;
+			}
+		};
+		
+		SigLexer(const std::string &text):
+			text(text), pos(0), line(1), have_peeked(false) {}
+		
+		const Token &peek()
+		{
+			if(!have_peeked)
+			{
+				peeked = lex();
+				have_peeked = true;
+			}
+			
+			return peeked;
+		}
+		
+		Token next()
+		{
+			peek();
+			have_peeked = false;
+			
+			return peeked;
+		}
+		
+		/* Reads the body of a hex string up to the closing brace. Must be called just
+		 * after the opening brace has been consumed, with no token peeked.
+		*/
+		std::string hex_string_body()
+		{
+			assert(!have_peeked);
+			
+			size_t end = text.find('}', pos);
+			if(end == std::string::npos)
+			{
+				throw REHex::SignatureScanner::ParseError("Unterminated hex string", line);
+			}
+			
+			std::string body = text.substr(pos, (end - pos));
+			
+			line += std::count(body.begin(), body.end(), '\n');
+			pos = end + 1;
+			
+			return body;
+		}
+		
+		int get_line() const
+		{
+			return have_peeked ? peeked.line : line;
+		}
+	
+	private:
+		const std::string &text;
+		size_t pos;
+		int line;
+		
+		bool have_peeked;
+		Token peeked;
+		
+		void skip_space()
+		{
+			while(pos < text.length())
+			{
+				if(text[pos] == '\n')
+				{
+					++line;
+					++pos;
+				}
+				else if(isspace((unsigned char)(text[pos])))
+				{
+					++pos;
+				}
+				else if(text.compare(pos, 2, "//") == 0)
+				{
+					pos = text.find('\n', pos);
+					if(pos == std::string::npos)
+					{
+						pos = text.length();
+					}
+				}
+				else if(text.compare(pos, 2, "/*") == 0)
+				{
+					size_t end = text.find("*/", (pos + 2));
+					if(end == std::string::npos)
+					{
+						throw REHex::SignatureScanner::ParseError("Unterminated comment", line);
+					}
+					
+					line += std::count((text.begin() + pos), (text.begin() + end), '\n');
+					pos = end + 2;
+				}
+				else{
+					break;
+				}
+			}
+		}
+		
+		static bool is_ident_char(char c)
+		{
+			return isalnum((unsigned char)(c)) || c == '_';
+		}
+		
+		Token lex()
+		{
+			skip_space();
+			
+			Token token;
+			token.line = line;
+			
+			if(pos >= text.length())
+			{
+				token.type = TokenType::END;
+				return token;
+			}
+			
+			char c = text[pos];
+			
+			if(c == '$' || c == '#' || c == '@')
+			{
+				size_t end = pos + 1;
+				while(end < text.length() && is_ident_char(text[end]))
+				{
+					++end;
+				}
+				
+				if(c == '$' && end < text.length() && text[end] == '*')
+				{
+					++end;
+				}
+				
+				token.type = c == '$' ? TokenType::STRING_ID
+					: c == '#' ? TokenType::COUNT_ID
+					: TokenType::OFFSET_ID;
+				
+				token.text = text.substr((pos + 1), (end - pos - 1));
+				
+				if(token.text.empty())
+				{
+					throw REHex::SignatureScanner::ParseError("Anonymous strings are not supported", line);
+				}
+				
+				pos = end;
+			}
+			else if(isdigit((unsigned char)(c)))
+			{
+				size_t end = pos;
+				while(end < text.length() && is_ident_char(text[end]))
+				{
+					++end;
+				}
+				
+				token.type = TokenType::NUMBER;
+				token.text = text.substr(pos, (end - pos));
+				token.number = parse_number(token.text);
+				
+				pos = end;
+			}
+			else if(is_ident_char(c))
+			{
+				size_t end = pos;
+				while(end < text.length() && is_ident_char(text[end]))
+				{
+					++end;
+				}
+				
+				token.type = TokenType::IDENT;
+				token.text = text.substr(pos, (end - pos));
+				
+				pos = end;
+			}
+			else if(c == '"')
+			{
+				token.type = TokenType::TEXT;
+				token.text = parse_text();
+			}
+			else{
+				static const char *OPERATORS[] = { "..", "==", "!=", "<=", ">=" };
+				
+				token.type = TokenType::PUNCT;
+				
+				for(size_t i = 0; i < (sizeof(OPERATORS) / sizeof(*OPERATORS)); ++i)
+				{
+					if(text.compare(pos, 2, OPERATORS[i]) == 0)
+					{
+						token.text = OPERATORS[i];
+						pos += 2;
+						
+						return token;
+					}
+				}
+				
+				if(strchr("{}()[]=,:<>", c) == NULL)
+				{
+					throw REHex::SignatureScanner::ParseError((std::string("Unexpected character '") + c + "'"), line);
+				}
+				
+				token.text = std::string(1, c);
+				++pos;
+			}
+			
+			return token;
+		}
+		
+		off_t parse_number(const std::string &s)
+		{
+			off_t multiplier = 1;
+			std::string digits = s;
+			
+			if(digits.length() > 2 && (digits.compare((digits.length() - 2), 2, "KB") == 0 || digits.compare((digits.length() - 2), 2, "MB") == 0))
+			{
+				multiplier = digits[ digits.length() - 2 ] == 'K' ? 1024 : (1024 * 1024);
+				digits.erase(digits.length() - 2);
+			}
+			
+			int base = 10;
+			if(digits.length() > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X'))
+			{
+				base = 16;
+				digits.erase(0, 2);
+			}
+			
+			off_t value = 0;
+			for(auto c = digits.begin(); c != digits.end(); ++c)
+			{
+				int digit = isdigit((unsigned char)(*c)) ? (*c - '0')
+					: (base == 16 && isxdigit((unsigned char)(*c))) ? (toupper((unsigned char)(*c)) - 'A' + 10)
+					: -1;
+				
+				if(digit < 0 || value > ((std::numeric_limits<off_t>::max() - digit) / base))
+				{
+					throw REHex::SignatureScanner::ParseError(("Invalid number '" + s + "'"), line);
+				}
+				
+				value = (value * base) + digit;
+			}
+			
+			if(value > (std::numeric_limits<off_t>::max() / multiplier))
+			{
+				throw REHex::SignatureScanner::ParseError(("Invalid number '" + s + "'"), line);
+			}
+			
+			return value * multiplier;
+		}
+		
+		std::string parse_text()
+		{
+			std::string s;
+			
+			for(++pos; pos < text.length() && text[pos] != '"'; ++pos)
+			{
+				if(text[pos] == '\n')
+				{
+					break;
+				}
+				else if(text[pos] != '\\')
+				{
+					s.push_back(text[pos]);
+					continue;
+				}
+				
+				if(++pos >= text.length())
+				{
+					break;
+				}
+				
+				switch(text[pos])
+				{
+					case 'n':  s.push_back('\n'); break;
+					case 'r':  s.push_back('\r'); break;
+					case 't':  s.push_back('\t'); break;
+					case '0':  s.push_back('\0'); break;
+					case '\\': s.push_back('\\'); break;
+					case '"':  s.push_back('"');  break;
+					
+					case 'x':
+						if((pos + 2) < text.length() && isxdigit((unsigned char)(text[pos + 1])) && isxdigit((unsigned char)(text[pos + 2])))
+						{
+							s.push_back((char)(strtoul(text.substr((pos + 1), 2).c_str(), NULL, 16)));
+							pos += 2;
+							break;
+						}
+						
+						/* Fall through */
+					
+					default:
+						throw REHex::SignatureScanner::ParseError("Invalid escape sequence in string", line);
+				}
+			}
+			
+			if(pos >= text.length() || text[pos] != '"')
+			{
+				throw REHex::SignatureScanner::ParseError("Unterminated string", line);
+			}
+			
+			++pos;
+			
+			return s;
+		}
+};
+
+class SigParser
+{
+	public:
+		SigParser(const std::string &text, std::vector<SigString> *strings, std::vector<SigRule> *rules):
+			lexer(text), strings(strings), rules(rules) {}
+		
+		void parse()
+		{
+			while(lexer.peek().type != SigLexer::TokenType::END)
+			{
+				parse_rule();
+			}
+			
+			if(rules->empty())
+			{
+				throw REHex::SignatureScanner::ParseError("No rules defined", lexer.get_line());
+			}
+		}
+	
+	private:
+		typedef SigLexer::TokenType TokenType;
+		typedef SigLexer::Token Token;
+		
+		SigLexer lexer;
+		std::vector<SigString> *strings;
+		std::vector<SigRule> *rules;
+		
+		/* Strings defined in the rule being parsed, name => index in compiled->strings. */
+		std::map<std::string, size_t> rule_strings;
+		
+		[[noreturn]] void error(const std::string &message, const Token &token)
+		{
+			throw REHex::SignatureScanner::ParseError(message, token.line);
+		}
+		
+		Token expect(TokenType type, const char *text, const char *what)
+		{
+			Token token = lexer.next();
+			if(token.type != type || (text != NULL && token.text != text))
+			{
+				error((std::string("Expected ") + what), token);
+			}
+			
+			return token;
+		}
+		
+		bool accept(TokenType type, const char *text)
+		{
+			if(lexer.peek().is(type, text))
+			{
+				lexer.next();
+				return true;
+			}
+			
+			return false;
+		}
+		
+		void parse_rule()
+		{
+			expect(TokenType::IDENT, "rule", "'rule'");
+			
+			SigRule rule;
+			rule.name = expect(TokenType::IDENT, NULL, "rule name").text;
+			
+			for(auto r = rules->begin(); r != rules->end(); ++r)
+			{
+				if(r->name == rule.name)
+				{
+					throw REHex::SignatureScanner::ParseError(("Duplicate rule '" + rule.name + "'"), lexer.get_line());
+				}
+			}
+			
+			expect(TokenType::PUNCT, "{", "'{'");
+			
+			rule_strings.clear();
+			
+			if(accept(TokenType::IDENT, "meta"))
+			{
+				expect(TokenType::PUNCT, ":", "':'");
+				
+				while(lexer.peek().type == TokenType::IDENT && lexer.peek().text != "strings" && lexer.peek().text != "condition")
+				{
+					lexer.next();
+					expect(TokenType::PUNCT, "=", "'='");
+					
+					Token value = lexer.next();
+					if(value.type != TokenType::TEXT && value.type != TokenType::NUMBER && !value.is(TokenType::IDENT, "true") && !value.is(TokenType::IDENT, "false"))
+					{
+						error("Expected a metadata value", value);
+					}
+				}
+			}
+			
+			if(accept(TokenType::IDENT, "strings"))
+			{
+				expect(TokenType::PUNCT, ":", "':'");
+				
+				while(lexer.peek().type == TokenType::STRING_ID)
+				{
+					rule.strings.push_back(parse_string());
+				}
+			}
+			
+			if(rule.strings.empty())
+			{
+				throw REHex::SignatureScanner::ParseError(("Rule '" + rule.name + "' has no strings"), lexer.get_line());
+			}
+			
+			expect(TokenType::IDENT, "condition", "'condition'");
+			expect(TokenType::PUNCT, ":", "':'");
+			
+			rule.condition = parse_or();
+			
+			expect(TokenType::PUNCT, "}", "'}'");
+			
+			rules->push_back(std::move(rule));
+		}
+		
+		size_t parse_string()
+		{
+			Token id = lexer.next();
+			
+			if(id.text.back() == '*')
+			{
+				error("Expected a string name", id);
+			}
+			
+			if(rule_strings.find(id.text) != rule_strings.end())
+			{
+				error(("Duplicate string '$" + id.text + "'"), id);
+			}
+			
+			expect(TokenType::PUNCT, "=", "'='");
+			
+			SigString string;
+			string.name = id.text;
+			
+			if(lexer.peek().type == TokenType::TEXT)
+			{
+				Token text = lexer.next();
+				
+				if(text.text.empty())
+				{
+					error("Empty string", text);
+				}
+				
+				while(lexer.peek().type == TokenType::IDENT && (lexer.peek().text == "nocase" || lexer.peek().text == "ascii"))
+				{
+					if(lexer.next().text == "nocase")
+					{
+						string.nocase = true;
+					}
+				}
+				
+				if(lexer.peek().type == TokenType::IDENT && lexer.peek().text != "condition")
+				{
+					error(("Unsupported string modifier '" + lexer.peek().text + "'"), lexer.peek());
+				}
+				
+				string.segments.emplace_back(0, 0);
+				
+				for(auto c = text.text.begin(); c != text.text.end(); ++c)
+				{
+					unsigned char value = string.nocase ? fold_case(*c) : *c;
+					string.segments.back().bytes.emplace_back(value, 0xFF);
+				}
+			}
+			else{
+				Token open = expect(TokenType::PUNCT, "{", "a string");
+				parse_hex(lexer.hex_string_body(), open.line, &string);
+			}
+			
+			choose_atom(&string, id);
+			
+			string.max_length = 0;
+			for(auto s = string.segments.begin(); s != string.segments.end(); ++s)
+			{
+				string.max_length += s->jump_max + s->bytes.size();
+			}
+			
+			size_t idx = strings->size();
+			strings->push_back(string);
+			rule_strings[id.text] = idx;
+			
+			return idx;
+		}
+		
+		void parse_hex(const std::string &body, int line, SigString *string)
+		{
+			string->segments.emplace_back(0, 0);
+			
+			for(size_t i = 0; i < body.length();)
+			{
+				if(isspace((unsigned char)(body[i])))
+				{
+					++i;
+				}
+				else if(body[i] == '[')
+				{
+					size_t end = body.find(']', i);
+					if(end == std::string::npos)
+					{
+						throw REHex::SignatureScanner::ParseError("Unterminated jump in hex string", line);
+					}
+					
+					std::string range = body.substr((i + 1), (end - i - 1));
+					
+					char *endp;
+					off_t jump_min = strtoll(range.c_str(), &endp, 10);
+					off_t jump_max = jump_min;
+					
+					if(*endp == '-')
+					{
+						const char *max_s = endp + 1;
+						jump_max = strtoll(max_s, &endp, 10);
+						
+						if(endp == max_s)
+						{
+							throw REHex::SignatureScanner::ParseError("Jumps must have an upper bound", line);
+						}
+					}
+					
+					if(range.empty() || *endp != '\0' || jump_min < 0 || jump_max < jump_min || jump_max > MAX_JUMP)
+					{
+						throw REHex::SignatureScanner::ParseError(("Invalid jump [" + range + "] in hex string"), line);
+					}
+					
+					if(string->segments.back().bytes.empty())
+					{
+						throw REHex::SignatureScanner::ParseError("Hex strings can't start with a jump or contain consecutive jumps", line);
+					}
+					
+					string->segments.emplace_back(jump_min, jump_max);
+					i = end + 1;
+				}
+				else if((i + 1) < body.length())
+				{
+					unsigned char value = 0, mask = 0;
+					
+					for(int n = 0; n < 2; ++n)
+					{
+						char c = body[i + n];
+						int shift = (n == 0) ? 4 : 0;
+						
+						if(c == '?')
+						{
+							continue;
+						}
+						else if(isxdigit((unsigned char)(c)))
+						{
+							int nibble = isdigit((unsigned char)(c)) ? (c - '0') : (toupper((unsigned char)(c)) - 'A' + 10);
+							
+							value |= nibble << shift;
+							mask  |= 0xF << shift;
+						}
+						else{
+							throw REHex::SignatureScanner::ParseError("Invalid character in hex string", line);
+						}
+					}
+					
+					string->segments.back().bytes.emplace_back(value, mask);
+					i += 2;
+				}
+				else{
+					throw REHex::SignatureScanner::ParseError("Invalid character in hex string", line);
+				}
+			}
+			
+			if(string->segments.back().bytes.empty())
+			{
+				throw REHex::SignatureScanner::ParseError(string->segments.size() == 1 ? "Empty hex string" : "Hex strings can't end with a jump", line);
+			}
+		}
+		
+		/* Picks the best run of up to MAX_ATOM_LENGTH fixed bytes from the first segment
+		 * of the string to search for. Longer runs are better, and bytes which are very
+		 * common in binary files are avoided where possible.
+		*/
+		void choose_atom(SigString *string, const Token &id)
+		{
+			const std::vector<SigPatternByte> &bytes = string->segments.front().bytes;
+			
+			int best_score = -1;
+			
+			for(size_t begin = 0; begin < bytes.size(); ++begin)
+			{
+				int score = 0;
+				
+				for(size_t end = begin; end < bytes.size() && (end - begin) < MAX_ATOM_LENGTH && bytes[end].mask == 0xFF; ++end)
+				{
+					unsigned char b = bytes[end].value;
+					score += (b == 0x00 || b == 0xFF || b == 0x20 || b == 0x90 || b == 0xCC) ? 1 : 3;
+					
+					if(score > best_score)
+					{
+						best_score = score;
+						
+						string->atom_offset = begin;
+						string->atom.clear();
+						
+						for(size_t i = begin; i <= end; ++i)
+						{
+							string->atom.push_back(bytes[i].value);
+						}
+					}
+				}
+			}
+			
+			if(string->atom.empty())
+			{
+				error(("String '$" + string->name + "' must have a fixed byte before any jump"), id);
+			}
+		}
+		
+		/* Resolves a $name or $prefix* to strings in the current rule. */
+		std::vector<size_t> resolve_strings(const Token &id)
+		{
+			std::vector<size_t> strings;
+			
+			if(id.text.back() == '*')
+			{
+				std::string prefix = id.text.substr(0, (id.text.length() - 1));
+				
+				for(auto s = rule_strings.begin(); s != rule_strings.end(); ++s)
+				{
+					if(s->first.compare(0, prefix.length(), prefix) == 0)
+					{
+						strings.push_back(s->second);
+					}
+				}
+			}
+			else{
+				auto s = rule_strings.find(id.text);
+				if(s != rule_strings.end())
+				{
+					strings.push_back(s->second);
+				}
+			}
+			
+			if(strings.empty())
+			{
+				error(("Undefined string '$" + id.text + "'"), id);
+			}
+			
+			return strings;
+		}
+		
+		size_t resolve_string(const Token &id)
+		{
+			if(id.text.back() == '*')
+			{
+				error("Expected a string name", id);
+			}
+			
+			return resolve_strings(id).front();
+		}
+		
+		off_t parse_number()
+		{
+			return expect(TokenType::NUMBER, NULL, "a number").number;
+		}
+		
+		void parse_compare(SigCondition *condition)
+		{
+			Token op = lexer.next();
+			
+			if(op.is(TokenType::PUNCT, "=="))     { condition->compare = SigCondition::Compare::EQ; }
+			else if(op.is(TokenType::PUNCT, "!=")) { condition->compare = SigCondition::Compare::NE; }
+			else if(op.is(TokenType::PUNCT, "<"))  { condition->compare = SigCondition::Compare::LT; }
+			else if(op.is(TokenType::PUNCT, "<=")) { condition->compare = SigCondition::Compare::LE; }
+			else if(op.is(TokenType::PUNCT, ">"))  { condition->compare = SigCondition::Compare::GT; }
+			else if(op.is(TokenType::PUNCT, ">=")) { condition->compare = SigCondition::Compare::GE; }
+			else{
+				error("Expected a comparison operator", op);
+			}
+			
+			condition->value = parse_number();
+		}
+		
+		std::unique_ptr<SigCondition> parse_or()
+		{
+			std::unique_ptr<SigCondition> lhs = parse_and();
+			
+			while(accept(TokenType::IDENT, "or"))
+			{
+				std::unique_ptr<SigCondition> c(new SigCondition(SigCondition::Type::OR));
+				c->lhs = std::move(lhs);
+				c->rhs = parse_and();
+				
+				lhs = std::move(c);
+			}
+			
+			return lhs;
+		}
+		
+		std::unique_ptr<SigCondition> parse_and()
+		{
+			std::unique_ptr<SigCondition> lhs = parse_not();
+			
+			while(accept(TokenType::IDENT, "and"))
+			{
+				std::unique_ptr<SigCondition> c(new SigCondition(SigCondition::Type::AND));
+				c->lhs = std::move(lhs);
+				c->rhs = parse_not();
+				
+				lhs = std::move(c);
+			}
+			
+			return lhs;
+		}
+		
+		std::unique_ptr<SigCondition> parse_not()
+		{
+			if(accept(TokenType::IDENT, "not"))
+			{
+				std::unique_ptr<SigCondition> c(new SigCondition(SigCondition::Type::NOT));
+				c->lhs = parse_not();
+				
+				return c;
+			}
+			
+			return parse_primary();
+		}
+		
+		std::unique_ptr<SigCondition> parse_primary()
+		{
+			Token token = lexer.next();
+			
+			if(token.is(TokenType::PUNCT, "("))
+			{
+				std::unique_ptr<SigCondition> c = parse_or();
+				expect(TokenType::PUNCT, ")", "')'");
+				
+				return c;
+			}
+			else if(token.is(TokenType::IDENT, "true") || token.is(TokenType::IDENT, "false"))
+			{
+				return std::unique_ptr<SigCondition>(new SigCondition(token.text == "true" ? SigCondition::Type::TRUE_ : SigCondition::Type::FALSE_));
+			}
+			else if(token.is(TokenType::IDENT, "filesize"))
+			{
+				std::unique_ptr<SigCondition> c(new SigCondition(SigCondition::Type::FILESIZE));
+				parse_compare(c.get());
+				
+				return c;
+			}
+			else if(token.type == TokenType::STRING_ID)
+			{
+				std::unique_ptr<SigCondition> c(new SigCondition(SigCondition::Type::MATCHED));
+				c->string = resolve_string(token);
+				
+				if(accept(TokenType::IDENT, "at"))
+				{
+					c->type = SigCondition::Type::MATCHED_AT;
+					c->value = parse_number();
+				}
+				else if(accept(TokenType::IDENT, "in"))
+				{
+					c->type = SigCondition::Type::MATCHED_IN;
+					
+					expect(TokenType::PUNCT, "(", "'('");
+					c->value = parse_number();
+					expect(TokenType::PUNCT, "..", "'..'");
+					c->value2 = parse_number();
+					expect(TokenType::PUNCT, ")", "')'");
+				}
+				
+				return c;
+			}
+			else if(token.type == TokenType::COUNT_ID)
+			{
+				std::unique_ptr<SigCondition> c(new SigCondition(SigCondition::Type::COUNT));
+				c->string = resolve_string(token);
+				parse_compare(c.get());
+				
+				return c;
+			}
+			else if(token.type == TokenType::OFFSET_ID)
+			{
+				std::unique_ptr<SigCondition> c(new SigCondition(SigCondition::Type::OFFSET));
+				c->string = resolve_string(token);
+				
+				if(accept(TokenType::PUNCT, "["))
+				{
+					Token index = expect(TokenType::NUMBER, NULL, "a match index");
+					if(index.number < 1)
+					{
+						error("Match indices start at 1", index);
+					}
+					
+					c->index = index.number - 1;
+					
+					expect(TokenType::PUNCT, "]", "']'");
+				}
+				
+				parse_compare(c.get());
+				
+				return c;
+			}
+			else if(token.type == TokenType::NUMBER || token.is(TokenType::IDENT, "any") || token.is(TokenType::IDENT, "all"))
+			{
+				std::unique_ptr<SigCondition> c(new SigCondition(SigCondition::Type::OF));
+				
+				expect(TokenType::IDENT, "of", "'of'");
+				
+				if(accept(TokenType::IDENT, "them"))
+				{
+					for(auto s = rule_strings.begin(); s != rule_strings.end(); ++s)
+					{
+						c->strings.push_back(s->second);
+					}
+				}
+				else{
+					expect(TokenType::PUNCT, "(", "'them' or '('");
+					
+					do {
+						std::vector<size_t> strings = resolve_strings(expect(TokenType::STRING_ID, NULL, "a string name"));
+						c->strings.insert(c->strings.end(), strings.begin(), strings.end());
+					} while(accept(TokenType::PUNCT, ","));
+					
+					expect(TokenType::PUNCT, ")", "')'");
+					
+					std::sort(c->strings.begin(), c->strings.end());
+					c->strings.erase(std::unique(c->strings.begin(), c->strings.end()), c->strings.end());
+				}
+				
+				c->min_matched = token.text == "any" ? 1
+					: token.text == "all" ? c->strings.size()
+					: (size_t)(token.number);
+				
+				return c;
+			}
+			else{
+				error("Expected a condition", token);
+			}
+		}
+};
+
+REHex::SignatureScanner::ParseError::ParseError(const std::string &what, int line):
+	std::runtime_error(what), line(line) {}
+
+REHex::SignatureScanner::SignatureScanner(const std::string &rules_text):
+	compiled(new Compiled())
+{
+	SigParser parser(rules_text, &(compiled->strings), &(compiled->rules));
+	parser.parse();
+	
+	for(auto s = compiled->strings.begin(); s != compiled->strings.end(); ++s)
+	{
+		compiled->max_string_length = std::max(compiled->max_string_length, s->max_length);
+		compiled->max_atom_end = std::max(compiled->max_atom_end, (s->atom_offset + s->atom.size()));
+	}
+	
+	compiled->build_automaton();
+}
+
+REHex::SignatureScanner::~SignatureScanner() {}
+
+size_t REHex::SignatureScanner::num_rules() const
+{
+	return compiled->rules.size();
+}
+
+size_t REHex::SignatureScanner::num_strings() const
+{
+	return compiled->strings.size();
+}
+
+REHex::SignatureScanner::Results REHex::SignatureScanner::scan(const unsigned char *data, size_t length) const
+{
+	Results results;
+	results.match_counts.resize(compiled->strings.size(), 0);
+	results.matches.resize(compiled->strings.size());
+	results.filesize = length;
+	
+	scan_window(data, length, length, 0, &results);
+	
+	for(auto m = results.matches.begin(); m != results.matches.end(); ++m)
+	{
+		trim_matches(&(*m));
+		std::sort(m->begin(), m->end());
+	}
+	
+	return results;
+}
+
+bool REHex::SignatureScanner::scan(const Document *doc, Results *results, const std::function<bool(off_t done, off_t total)> &progress, off_t window_size) const
+{
+	const off_t total = doc->buffer_length();
+	
+	/* Each window is read with enough data after it to verify matches starting in its
+	 * last byte, so every match belongs to exactly one window.
+	*/
+	const off_t overlap = compiled->max_string_length - 1;
+	
+	results->match_counts.assign(compiled->strings.size(), 0);
+	results->matches.assign(compiled->strings.size(), std::vector<Match>());
+	results->filesize = total;
+	
+	std::atomic<off_t> next_window(0);
+	std::atomic<off_t> bytes_done(0);
+	std::atomic<bool> stop(false);
+	
+	std::mutex lock;
+	std::condition_variable window_done_cv;
+	std::exception_ptr error;
+	
+	/* Each call scans the next window, the ThreadPool runs as many in parallel as it has
+	 * worker threads available.
+	*/
+	ThreadPool::TaskHandle task = wxGetApp().thread_pool->queue_task([&]()
+	{
+		if(stop)
+		{
+			return true;
+		}
+		
+		off_t window_begin = next_window.fetch_add(window_size);
+		if(window_begin >= total)
+		{
+			return true;
+		}
+		
+		Results local;
+		local.match_counts.resize(compiled->strings.size(), 0);
+		local.matches.resize(compiled->strings.size());
+		
+		off_t scan_length = std::min(window_size, (total - window_begin));
+		
+		try {
+			off_t read_length = std::min((scan_length + overlap), (total - window_begin));
+			std::vector<unsigned char> data = doc->read_data(window_begin, read_length);
+			
+			scan_window(data.data(), data.size(), std::min<size_t>(scan_length, data.size()), window_begin, &local);
+		}
+		catch(...)
+		{
+			std::unique_lock<std::mutex> l(lock);
+			
+			if(!error)
+			{
+				error = std::current_exception();
+			}
+			
+			stop = true;
+			window_done_cv.notify_all();
+			
+			return true;
+		}
+		
+		std::unique_lock<std::mutex> l(lock);
+		
+		merge_results(results, local);
+		bytes_done += scan_length;
+		
+		window_done_cv.notify_all();
+		
+		return false;
+	}, -1);
+	
+	{
+		std::unique_lock<std::mutex> l(lock);
+		
+		while(!task.finished())
+		{
+			if(progress && !stop)
+			{
+				l.unlock();
+				
+				if(!progress(bytes_done, total))
+				{
+					stop = true;
+				}
+				
+				l.lock();
+			}
+			
+			window_done_cv.wait_for(l, std::chrono::milliseconds(100));
+		}
+	}
+	
+	task.join();
+	
+	if(error)
+	{
+		std::rethrow_exception(error);
+	}
+	
+	for(auto m = results->matches.begin(); m != results->matches.end(); ++m)
+	{
+		std::sort(m->begin(), m->end());
+	}
+	
+	return !stop;
+}
+
+void REHex::SignatureScanner::scan_window(const unsigned char *data, size_t data_length, size_t scan_length, off_t base, Results *results) const
+{
+	/* Atoms can't end any further into the data than this for a match starting within
+	 * the scan range.
+	*/
+	size_t feed_length = std::min(data_length, (scan_length + compiled->max_atom_end));
+	
+	const uint32_t *transitions = compiled->transitions.data();
+	const uint32_t *output_begin = compiled->output_begin.data();
+	const uint32_t *outputs = compiled->outputs.data();
+	
+	uint32_t state = 0;
+	
+	for(size_t i = 0; i < feed_length; ++i)
+	{
+		state = transitions[ (state * 256) + data[i] ];
+		
+		for(uint32_t o = output_begin[state]; o < output_begin[state + 1]; ++o)
+		{
+			const SigString &string = compiled->strings[ outputs[o] ];
+			
+			size_t atom_end = i + 1;
+			if(atom_end < (string.atom_offset + string.atom.size()))
+			{
+				continue;
+			}
+			
+			size_t start = atom_end - string.atom.size() - string.atom_offset;
+			if(start >= scan_length)
+			{
+				continue;
+			}
+			
+			off_t end = match_string(string, data, data_length, start);
+			if(end >= 0)
+			{
+				++(results->match_counts[ outputs[o] ]);
+				
+				std::vector<Match> &matches = results->matches[ outputs[o] ];
+				matches.emplace_back((base + (off_t)(start)), (end - (off_t)(start)));
+				
+				if(matches.size() >= (MAX_MATCHES_PER_STRING * 2))
+				{
+					trim_matches(&matches);
+				}
+			}
+		}
+	}
+}
+
+void REHex::SignatureScanner::merge_results(Results *dst, Results &src)
+{
+	for(size_t i = 0; i < dst->matches.size(); ++i)
+	{
+		dst->match_counts[i] += src.match_counts[i];
+		
+		dst->matches[i].insert(dst->matches[i].end(), src.matches[i].begin(), src.matches[i].end());
+		trim_matches(&(dst->matches[i]));
+	}
+}
+
+std::vector<REHex::SignatureScanner::RuleMatch> REHex::SignatureScanner::evaluate(const Results &results) const
+{
+	std::vector<RuleMatch> matched;
+	
+	for(auto r = compiled->rules.begin(); r != compiled->rules.end(); ++r)
+	{
+		if(!r->condition->evaluate(results))
+		{
+			continue;
+		}
+		
+		matched.emplace_back();
+		matched.back().rule = r->name;
+		
+		for(auto s = r->strings.begin(); s != r->strings.end(); ++s)
+		{
+			const std::vector<Match> &matches = results.matches[*s];
+			
+			for(auto m = matches.begin(); m != matches.end(); ++m)
+			{
+				matched.back().strings.push_back(std::make_pair(compiled->strings[*s].name, *m));
+			}
+		}
+	}
+	
+	return matched;
+}
+
+REHex::Document::AnnotationBatch REHex::SignatureScanner::annotate(const std::vector<RuleMatch> &matches, int highlight_colour_idx)
+{
+	/* Matches of more than one string over the same bytes share a comment. */
+	
+	std::map<std::pair<off_t, off_t>, wxString> comments;
+	
+	for(auto r = matches.begin(); r != matches.end(); ++r)
+	{
+		for(auto s = r->strings.begin(); s != r->strings.end(); ++s)
+		{
+			wxString &text = comments[ std::make_pair(s->second.offset, s->second.length) ];
+			
+			if(!text.empty())
+			{
+				text += "\n";
+			}
+			
+			text += r->rule + " ($" + s->first + ")";
+		}
+	}
+	
+	Document::AnnotationBatch batch;
+	
+	for(auto c = comments.begin(); c != comments.end(); ++c)
+	{
+		batch.add_comment(BitOffset(c->first.first, 0), BitOffset(c->first.second, 0), c->second);
+		
+		if(highlight_colour_idx >= 0)
+		{
+			batch.add_highlight(BitOffset(c->first.first, 0), BitOffset(c->first.second, 0), highlight_colour_idx);
+		}
+	}
+	
+	return batch;
+}
+
+static void scan_document(REHex::MainWindow *window, REHex::Document *doc)
+{
+	wxFileDialog open_dialog(window, "Select signature rules", wxGetApp().get_last_directory(), "", "Signature rules (*.yar, *.yara)|*.yar;*.yara|All files|*", (wxFD_OPEN | wxFD_FILE_MUST_EXIST));
+	if(open_dialog.ShowModal() == wxID_CANCEL)
+	{
+		return;
+	}
+	
+	std::string rules_text;
+	
+	{
+		wxFFile file(open_dialog.GetPath(), "rb");
+		
+		wxString content;
+		if(!file.IsOpened() || !file.ReadAll(&content, wxConvISO8859_1))
+		{
+			wxMessageBox(("Unable to read " + open_dialog.GetPath()), "Signature scan", (wxOK | wxICON_ERROR), window);
+			return;
+		}
+		
+		rules_text = content.ToStdString(wxConvISO8859_1);
+	}
+	
+	std::unique_ptr<REHex::SignatureScanner> scanner;
+	
+	try {
+		scanner.reset(new REHex::SignatureScanner(rules_text));
+	}
+	catch(const REHex::SignatureScanner::ParseError &e)
+	{
+		wxMessageBox(wxString::Format("Error on line %d of %s: %s", e.line, open_dialog.GetFilename(), e.what()), "Signature scan", (wxOK | wxICON_ERROR), window);
+		return;
+	}
+	
+	REHex::SignatureScanner::Results results;
+	
+	try {
+		wxProgressDialog progress("Scanning", "Scanning for signatures...", 1000, window, (wxPD_CAN_ABORT | wxPD_REMAINING_TIME | wxPD_APP_MODAL));
+		
+		bool finished = scanner->scan(doc, &results, [&](off_t done, off_t total)
+		{
+			return progress.Update((total > 0 ? (done * 1000) / total : 0));
+		});
+		
+		if(!finished)
+		{
+			return;
+		}
+	}
+	catch(const std::exception &e)
+	{
+		wxMessageBox((std::string("Error scanning file: ") + e.what()), "Signature scan", (wxOK | wxICON_ERROR), window);
+		return;
+	}
+	
+	std::vector<REHex::SignatureScanner::RuleMatch> matches = scanner->evaluate(results);
+	
+	if(matches.empty())
+	{
+		wxMessageBox(wxString::Format("None of the %u rules matched", (unsigned)(scanner->num_rules())), "Signature scan", (wxOK | wxICON_INFORMATION), window);
+		return;
+	}
+	
+	const REHex::HighlightColourMap &highlight_colours = doc->get_highlight_colours();
+	int highlight_colour_idx = highlight_colours.empty() ? -1 : highlight_colours.begin()->first;
+	
+	doc->apply_annotations(REHex::SignatureScanner::annotate(matches, highlight_colour_idx), "signature scan");
+	
+	wxString message = wxString::Format("%u of %u rules matched:\n", (unsigned)(matches.size()), (unsigned)(scanner->num_rules()));
+	for(auto m = matches.begin(); m != matches.end(); ++m)
+	{
+		message += "\n" + m->rule;
+	}
+	
+	wxMessageBox(message, "Signature scan", (wxOK | wxICON_INFORMATION), window);
+}
+
+static REHex::MainWindow::SetupHookRegistration tools_menu_hook(
+	REHex::MainWindow::SetupPhase::TOOLS_MENU_BOTTOM,
+	[](REHex::MainWindow *window)
+	{
+		wxMenuItem *item = window->get_tools_menu()->Append(wxID_ANY, "Scan with signature rules...");
+		
+		window->Bind(wxEVT_MENU, [window](wxCommandEvent &event)
+		{
+			REHex::Document *doc = window->active_document();
+			if(doc != NULL)
+			{
+				scan_document(window, doc);
+			}
+		}, item->GetId());
+	});
@@ -0,0 +1,203 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_SIGNATURESCANNER_HPP
+#define REHEX_SIGNATURESCANNER_HPP
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "document.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief A set of byte signature rules, compiled for scanning.
+	 *
+	 * Rules are written in a subset of the YARA rule syntax:
+	 *
+	 * @code
+	 * // Comment
+	 * rule pe_header
+	 * {
+	 *     strings:
+	 *         $mz = { 4D 5A ?? ?0 [2-8] 50 45 00 00 }
+	 *         $msg = "This program cannot be run" nocase
+	 *
+	 *     condition:
+	 *         $mz at 0 and (#msg > 0 or filesize < 0x1000)
+	 * }
+	 * @endcode
+	 *
+	 * Hex strings may contain wildcard bytes (??), wildcard nibbles (4? / ?4) and
+	 * bounded jumps ([n] / [n-m]). Text strings support C-style escapes and the
+	 * "nocase" modifier. Conditions may combine, using and/or/not:
+	 *
+	 *  - $x, $x at N, $x in (N..M)   - String matched (at/within an offset).
+	 *  - #x OP N                     - Number of matches of a string.
+	 *  - @x OP N, @x[i] OP N         - Offset of the first/ith match of a string.
+	 *  - filesize OP N
+	 *  - any/all/N of them, any/all/N of ($a, $b, ...)
+	 *  - true, false
+	 *
+	 * Each string is reduced to a short run of fixed bytes (its atom) and the atoms
+	 * of every string in the set are compiled into a single Aho-Corasick automaton,
+	 * so the data is only passed over once however many rules there are, and only
+	 * positions where an atom is found are checked against the full string.
+	*/
+	class SignatureScanner
+	{
+		public:
+			/**
+			 * @brief Exception thrown when rules can't be parsed.
+			*/
+			class ParseError: public std::runtime_error
+			{
+				public:
+					const int line;
+					
+					ParseError(const std::string &what, int line);
+			};
+			
+			/**
+			 * @brief Maximum number of match offsets stored for each string.
+			 *
+			 * Matches beyond this are still counted for the #x condition, but aren't
+			 * returned or available to @x[i].
+			*/
+			static const size_t MAX_MATCHES_PER_STRING = 10000;
+			
+			/**
+			 * @brief Default number of bytes searched by each worker at a time.
+			*/
+			static const off_t DEFAULT_WINDOW_SIZE = 4 * 1024 * 1024;
+			
+			struct Match
+			{
+				off_t offset;
+				off_t length;
+				
+				Match(off_t offset, off_t length):
+					offset(offset), length(length) {}
+				
+				bool operator<(const Match &rhs) const
+				{
+					return offset < rhs.offset || (offset == rhs.offset && length < rhs.length);
+				}
+				
+				bool operator==(const Match &rhs) const
+				{
+					return offset == rhs.offset && length == rhs.length;
+				}
+			};
+			
+			/**
+			 * @brief Matches of every string in a rule set.
+			 *
+			 * Matches of each string are sorted by offset.
+			*/
+			struct Results
+			{
+				std::vector<size_t> match_counts;
+				std::vector< std::vector<Match> > matches;
+				off_t filesize;
+				
+				Results(): filesize(0) {}
+			};
+			
+			/**
+			 * @brief A rule which matched and the matches of its strings.
+			*/
+			struct RuleMatch
+			{
+				std::string rule;
+				std::vector< std::pair<std::string, Match> > strings;
+			};
+			
+			/**
+			 * @brief Parse and compile a set of rules.
+			 *
+			 * Throws ParseError if the rules are invalid.
+			*/
+			SignatureScanner(const std::string &rules_text);
+			
+			~SignatureScanner();
+			
+			SignatureScanner(const SignatureScanner&) = delete;
+			SignatureScanner &operator=(const SignatureScanner&) = delete;
+			
+			/**
+			 * @brief Get the number of rules in the set.
+			*/
+			size_t num_rules() const;
+			
+			/**
+			 * @brief Get the number of strings in all rules in the set.
+			*/
+			size_t num_strings() const;
+			
+			/**
+			 * @brief Scan a buffer.
+			*/
+			Results scan(const unsigned char *data, size_t length) const;
+			
+			/**
+			 * @brief Scan a Document.
+			 *
+			 * @param doc          Document to scan.
+			 * @param results      Results of the scan.
+			 * @param progress     Called from the calling thread when the scan starts and periodically after with the number of bytes scanned so far, return false to abort (may be empty).
+			 * @param window_size  Number of bytes read and scanned by a worker at a time.
+			 *
+			 * The document is split into windows which are scanned in parallel on the
+			 * application's shared ThreadPool (wxGetApp().thread_pool), using as many
+			 * of its worker threads as are free. Returns false if the scan was aborted.
+			*/
+			bool scan(const Document *doc, Results *results, const std::function<bool(off_t done, off_t total)> &progress, off_t window_size = DEFAULT_WINDOW_SIZE) const;
+			
+			/**
+			 * @brief Evaluate the rule conditions against a set of results.
+			 *
+			 * Returns the rules whose conditions are met, in the order they were
+			 * defined, along with the stored matches of their strings.
+			*/
+			std::vector<RuleMatch> evaluate(const Results &results) const;
+			
+			/**
+			 * @brief Convert matched rules into comments and highlights.
+			 *
+			 * Each string match is commented with the rule and string name(s) and,
+			 * if highlight_colour_idx isn't negative, highlighted.
+			*/
+			static Document::AnnotationBatch annotate(const std::vector<RuleMatch> &matches, int highlight_colour_idx = -1);
+		
+		private:
+			struct Compiled;
+			std::unique_ptr<Compiled> compiled;
+			
+			void scan_window(const unsigned char *data, size_t data_length, size_t scan_length, off_t base, Results *results) const;
+			static void merge_results(Results *dst, Results &src);
+	};
+}
+
+#endif /* !REHEX_SIGNATURESCANNER_HPP */
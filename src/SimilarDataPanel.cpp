@@ -0,0 +1,334 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <assert.h>
+#include <tuple>
+#include <wx/numformatter.h>
+#include <wx/sizer.h>
+
+#include "App.hpp"
+#include "SimilarDataPanel.hpp"
+#include "util.hpp"
+
+/* Maximum number of similar ranges to list. */
+static const size_t MAX_MATCHES = 1000;
+
+static REHex::ToolPanel *SimilarDataPanel_factory(wxWindow *parent, REHex::SharedDocumentPointer &document, REHex::DocumentCtrl *document_ctrl)
+{
+	return new REHex::SimilarDataPanel(parent, document, document_ctrl);
+}
+
+static REHex::ToolPanelRegistration tpr("SimilarDataPanel", "Similar data", REHex::ToolPanel::TPS_WIDE, &SimilarDataPanel_factory);
+
+enum {
+	ID_FIND = 1,
+	ID_MIN_SCORE,
+};
+
+BEGIN_EVENT_TABLE(REHex::SimilarDataPanel, wxPanel)
+	EVT_BUTTON(ID_FIND, REHex::SimilarDataPanel::OnFind)
+	EVT_TIMER(wxID_ANY, REHex::SimilarDataPanel::OnTimerTick)
+	EVT_LIST_ITEM_ACTIVATED(wxID_ANY, REHex::SimilarDataPanel::OnItemActivate)
+END_EVENT_TABLE()
+
+REHex::SimilarDataPanel::SimilarDataPanel(wxWindow *parent, SharedDocumentPointer &document, DocumentCtrl *document_ctrl):
+	ToolPanel(parent),
+	document(document),
+	document_ctrl(document_ctrl),
+	query_offset(0),
+	query_length(0),
+	query_pending(false),
+	query_cancel(false),
+	query_generation(0),
+	timer(this, wxID_ANY)
+{
+	const int MARGIN = 4;
+	
+	find_btn = new wxButton(this, ID_FIND, "Find similar to selection");
+	
+	min_score_ctrl = new wxSpinCtrl(this, ID_MIN_SCORE, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 1, 100, 50);
+	min_score_ctrl->SetToolTip("Minimum similarity (%) of ranges to list");
+	
+	wxBoxSizer *find_sizer = new wxBoxSizer(wxHORIZONTAL);
+	find_sizer->Add(find_btn, 0, wxALIGN_CENTER_VERTICAL);
+	find_sizer->Add(new wxStaticText(this, wxID_ANY, "Minimum similarity:"), 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	find_sizer->Add(min_score_ctrl, 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	find_sizer->Add(new wxStaticText(this, wxID_ANY, "%"), 0, (wxALIGN_CENTER_VERTICAL | wxLEFT), MARGIN);
+	
+	status_text = new wxStaticText(this, wxID_ANY, "Select a range of data and click \"Find similar to selection\".");
+	
+	list_ctrl = new wxListCtrl(this, wxID_ANY, wxDefaultPosition, wxDefaultSize, (wxLC_REPORT | wxLC_SINGLE_SEL));
+	list_ctrl->AppendColumn("Offset");
+	list_ctrl->AppendColumn("Length");
+	list_ctrl->AppendColumn("Similarity");
+	
+	wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
+	sizer->Add(find_sizer, 0, (wxEXPAND | wxLEFT | wxRIGHT | wxTOP), MARGIN);
+	sizer->Add(status_text, 0, (wxEXPAND | wxLEFT | wxRIGHT | wxTOP), MARGIN);
+	sizer->Add(list_ctrl, 1, (wxEXPAND | wxALL), MARGIN);
+	SetSizerAndFit(sizer);
+	
+	this->document.auto_cleanup_bind(DATA_ERASE,     &REHex::SimilarDataPanel::OnDataErase,     this);
+	this->document.auto_cleanup_bind(DATA_INSERT,    &REHex::SimilarDataPanel::OnDataInsert,    this);
+	this->document.auto_cleanup_bind(DATA_OVERWRITE, &REHex::SimilarDataPanel::OnDataOverwrite, this);
+}
+
+REHex::SimilarDataPanel::~SimilarDataPanel()
+{
+	timer.Stop();
+	cancel_query();
+}
+
+std::string REHex::SimilarDataPanel::name() const
+{
+	return "SimilarDataPanel";
+}
+
+void REHex::SimilarDataPanel::save_state(wxConfig *config) const
+{
+	config->Write("min-score", (long)(min_score_ctrl->GetValue()));
+}
+
+void REHex::SimilarDataPanel::load_state(wxConfig *config)
+{
+	min_score_ctrl->SetValue(config->Read("min-score", (long)(min_score_ctrl->GetValue())));
+}
+
+wxSize REHex::SimilarDataPanel::DoGetBestClientSize() const
+{
+	return wxSize(-1, 200);
+}
+
+void REHex::SimilarDataPanel::update()
+{
+	if(!is_visible)
+	{
+		/* There is no sense in updating this if we are not visible */
+		return;
+	}
+	
+	OffsetBase offset_base = document_ctrl->get_offset_display_base();
+	off_t buffer_length = document->buffer_length();
+	
+	list_ctrl->Freeze();
+	list_ctrl->DeleteAllItems();
+	
+	for(size_t i = 0; i < matches.size(); ++i)
+	{
+		const SimilarityIndex::Match &match = matches[i];
+		
+		long item_idx = list_ctrl->InsertItem(i, format_offset(match.offset, offset_base, buffer_length));
+		list_ctrl->SetItem(item_idx, 1, format_offset(match.length, offset_base, buffer_length));
+		list_ctrl->SetItem(item_idx, 2, std::to_string(match.score) + "%");
+	}
+	
+	list_ctrl->Thaw();
+}
+
+void REHex::SimilarDataPanel::run_query()
+{
+	assert(index && index->is_complete());
+	
+	query_pending = false;
+	timer.Stop();
+	
+	cancel_query();
+	
+	status_text->SetLabel("Searching...");
+	
+	const SimilarityIndex *index = this->index.get();
+	off_t offset = query_offset;
+	off_t length = query_length;
+	int min_score = min_score_ctrl->GetValue();
+	
+	unsigned int generation = ++query_generation;
+	query_cancel = false;
+	
+	query_task.reset(new ThreadPool::TaskHandle(wxGetApp().thread_pool->queue_task([this, index, offset, length, min_score, generation]()
+	{
+		std::vector<SimilarityIndex::Match> found = index->find_similar(offset, length, min_score, MAX_MATCHES, &query_cancel);
+		
+		if(!query_cancel)
+		{
+			CallAfter([this, generation, found]()
+			{
+				if(generation == query_generation)
+				{
+					query_done(found);
+				}
+			});
+		}
+	})));
+}
+
+/* Stop any search running in the background. Must be called before the index is replaced. */
+void REHex::SimilarDataPanel::cancel_query()
+{
+	if(query_task)
+	{
+		query_cancel = true;
+		
+		query_task->finish();
+		query_task->join();
+		query_task.reset();
+	}
+	
+	/* Ignore the results of any search which finished before it was cancelled. */
+	++query_generation;
+}
+
+void REHex::SimilarDataPanel::query_done(const std::vector<SimilarityIndex::Match> &matches)
+{
+	query_task->join();
+	query_task.reset();
+	
+	this->matches = matches;
+	
+	if(matches.empty())
+	{
+		status_text->SetLabel("No similar data found.");
+	}
+	else{
+		status_text->SetLabel(wxNumberFormatter::ToString((long)(matches.size())) + " similar ranges found.");
+	}
+	
+	update();
+}
+
+void REHex::SimilarDataPanel::data_modified()
+{
+	/* The index and any matches are for the old data. */
+	
+	cancel_query();
+	
+	index.reset(NULL);
+	matches.clear();
+	
+	if(query_pending)
+	{
+		query_pending = false;
+		timer.Stop();
+	}
+	
+	status_text->SetLabel("Data modified, search again to find similar data.");
+	update();
+}
+
+void REHex::SimilarDataPanel::OnFind(wxCommandEvent &event)
+{
+	BitOffset selection_off, selection_length;
+	std::tie(selection_off, selection_length) = document_ctrl->get_selection_linear();
+	
+	if(selection_length <= BitOffset::ZERO || !selection_off.byte_aligned() || !selection_length.byte_aligned())
+	{
+		status_text->SetLabel("Select a range of data to search for.");
+		return;
+	}
+	
+	if(selection_length.byte() < SimilarityIndex::MIN_LENGTH)
+	{
+		status_text->SetLabel(wxString::Format("Select at least %d bytes to search for.", (int)(SimilarityIndex::MIN_LENGTH)));
+		return;
+	}
+	
+	query_offset = selection_off.byte();
+	query_length = selection_length.byte();
+	query_pending = true;
+	
+	cancel_query();
+	
+	matches.clear();
+	update();
+	
+	off_t block_size = SimilarityIndex::block_size_for(query_length);
+	
+	if(!index || index->get_block_size() != block_size)
+	{
+		index.reset(new SimilarityIndex(document, block_size));
+	}
+	
+	if(index->is_complete())
+	{
+		run_query();
+	}
+	else{
+		status_text->SetLabel("Indexing file...");
+		timer.Start(250, wxTIMER_CONTINUOUS);
+	}
+}
+
+void REHex::SimilarDataPanel::OnTimerTick(wxTimerEvent &event)
+{
+	if(!query_pending || !index)
+	{
+		timer.Stop();
+		return;
+	}
+	
+	if(index->is_complete())
+	{
+		run_query();
+	}
+	else{
+		off_t total = index->get_total_bytes();
+		int percent = total > 0 ? (int)(((double)(index->get_bytes_processed()) / (double)(total)) * 100.0) : 0;
+		
+		status_text->SetLabel("Indexing file (" + std::to_string(percent) + "%)...");
+	}
+}
+
+void REHex::SimilarDataPanel::OnItemActivate(wxListEvent &event)
+{
+	long item_idx = event.GetIndex();
+	assert(item_idx >= 0);
+	
+	if((size_t)(item_idx) >= matches.size())
+	{
+		return;
+	}
+	
+	const SimilarityIndex::Match &match = matches[item_idx];
+	
+	document->set_cursor_position(BitOffset(match.offset, 0));
+	document_ctrl->set_selection_raw(BitOffset(match.offset, 0), BitOffset((match.offset + match.length - 1), 0));
+}
+
+void REHex::SimilarDataPanel::OnDataErase(OffsetLengthEvent &event)
+{
+	data_modified();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::SimilarDataPanel::OnDataInsert(OffsetLengthEvent &event)
+{
+	data_modified();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::SimilarDataPanel::OnDataOverwrite(OffsetLengthEvent &event)
+{
+	data_modified();
+	
+	/* Continue propogation. */
+	event.Skip();
+}
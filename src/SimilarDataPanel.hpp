@@ -0,0 +1,102 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_SIMILARDATAPANEL_HPP
+#define REHEX_SIMILARDATAPANEL_HPP
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <wx/button.h>
+#include <wx/listctrl.h>
+#include <wx/spinctrl.h>
+#include <wx/stattext.h>
+#include <wx/timer.h>
+
+#include "DocumentCtrl.hpp"
+#include "Events.hpp"
+#include "SafeWindowPointer.hpp"
+#include "SharedDocumentPointer.hpp"
+#include "SimilarityIndex.hpp"
+#include "ThreadPool.hpp"
+#include "ToolPanel.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Tool panel listing ranges of the file which are similar to the selection.
+	*/
+	class SimilarDataPanel: public ToolPanel
+	{
+		public:
+			SimilarDataPanel(wxWindow *parent, SharedDocumentPointer &document, DocumentCtrl *document_ctrl);
+			~SimilarDataPanel();
+			
+			virtual std::string name() const override;
+			
+			virtual void save_state(wxConfig *config) const override;
+			virtual void load_state(wxConfig *config) override;
+			virtual void update() override;
+			
+			virtual wxSize DoGetBestClientSize() const override;
+		
+		private:
+			SharedDocumentPointer document;
+			SafeWindowPointer<DocumentCtrl> document_ctrl;
+			
+			/* The index is kept between searches and only rebuilt when the data is
+			 * modified or a selection needing a different block size is searched for.
+			*/
+			std::unique_ptr<SimilarityIndex> index;
+			
+			off_t query_offset;
+			off_t query_length;
+			bool query_pending;
+			
+			/* Searches are run in a worker thread, each one is given a new generation
+			 * so results from a search which has been replaced can be ignored.
+			*/
+			std::unique_ptr<ThreadPool::TaskHandle> query_task;
+			std::atomic<bool> query_cancel;
+			unsigned int query_generation;
+			
+			std::vector<SimilarityIndex::Match> matches;
+			
+			wxButton *find_btn;
+			wxSpinCtrl *min_score_ctrl;
+			wxStaticText *status_text;
+			wxListCtrl *list_ctrl;
+			wxTimer timer;
+			
+			void run_query();
+			void cancel_query();
+			void query_done(const std::vector<SimilarityIndex::Match> &matches);
+			void data_modified();
+			
+			void OnFind(wxCommandEvent &event);
+			void OnTimerTick(wxTimerEvent &event);
+			void OnItemActivate(wxListEvent &event);
+			
+			void OnDataErase(OffsetLengthEvent &event);
+			void OnDataInsert(OffsetLengthEvent &event);
+			void OnDataOverwrite(OffsetLengthEvent &event);
+		
+		DECLARE_EVENT_TABLE()
+	};
+}
+
+#endif /* !REHEX_SIMILARDATAPANEL_HPP */
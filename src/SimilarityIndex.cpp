@@ -0,0 +1,571 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <iterator>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+
+#include "App.hpp"
+#include "SimilarityIndex.hpp"
+
+const size_t REHex::SimilarityIndex::SIGNATURE_LENGTH;
+const off_t REHex::SimilarityIndex::MIN_BLOCK_SIZE;
+const off_t REHex::SimilarityIndex::MIN_LENGTH;
+const off_t REHex::SimilarityIndex::DEFAULT_CHUNK_SIZE;
+
+/* Signatures with fewer pieces than this don't say enough about the data to search for. */
+static const size_t MIN_SIGNATURE_PIECES = 4;
+
+/* Number of windows find_similar() compares between checking if it has been cancelled. */
+static const size_t FIND_CANCEL_INTERVAL = 4096;
+
+static const char PIECE_CHARS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* Pieces are hashed with a polynomial hash (rather than FNV like ssdeep) so that the hash of
+ * a piece which spans chunks can be put together from the hashes of its parts.
+*/
+static const uint32_t PIECE_HASH_MULT = 0x01000193;
+
+static uint32_t piece_hash_pow(off_t n)
+{
+	uint32_t result = 1, base = PIECE_HASH_MULT;
+	
+	for(; n > 0; n >>= 1)
+	{
+		if(n & 1)
+		{
+			result *= base;
+		}
+		
+		base *= base;
+	}
+	
+	return result;
+}
+
+/* Returns the hash of the concatenation of two sequences of bytes. */
+static uint32_t piece_hash_combine(uint32_t a_hash, uint32_t b_hash, off_t b_length)
+{
+	return (a_hash * piece_hash_pow(b_length)) + b_hash;
+}
+
+static unsigned char piece_hash_final(uint32_t hash)
+{
+	/* Low bits of the polynomial hash are weak, mix them up and take the top 6. */
+	return (hash * UINT32_C(2654435761)) >> (32 - 6);
+}
+
+/* The rolling hash used by ssdeep. Its value depends only on the last WINDOW bytes, so it
+ * can be picked up anywhere in the file by feeding it the WINDOW - 1 bytes before.
+*/
+class SimilarityRollingHash
+{
+	public:
+		static const unsigned WINDOW = 7;
+		
+		SimilarityRollingHash():
+			h1(0), h2(0), h3(0), n(0), last(-1), run(0)
+		{
+			memset(window, 0, sizeof(window));
+		}
+		
+		void update(unsigned char c)
+		{
+			h2 -= h1;
+			h2 += WINDOW * c;
+			
+			h1 += c;
+			h1 -= window[n];
+			
+			window[n] = c;
+			n = (n + 1) % WINDOW;
+			
+			h3 = (h3 << 5) ^ c;
+			
+			run = (c == last) ? (run + 1) : 1;
+			last = c;
+		}
+		
+		uint32_t sum() const
+		{
+			return h1 + h2 + h3;
+		}
+		
+		/**
+		 * @brief Returns true if the window is filled with a single repeated byte.
+		*/
+		bool uniform() const
+		{
+			return run >= WINDOW;
+		}
+	
+	private:
+		uint32_t h1, h2, h3;
+		
+		unsigned char window[WINDOW];
+		unsigned n;
+		
+		int last;
+		unsigned run;
+};
+
+REHex::SimilarityIndex::SimilarityIndex(SharedDocumentPointer &document, off_t block_size, off_t chunk_size):
+	document(document),
+	block_size(block_size),
+	chunk_size(chunk_size),
+	total_bytes(document->buffer_length()),
+	next_chunk(0),
+	chunks_done(0),
+	bytes_processed(0),
+	complete(false)
+{
+	assert(block_size >= MIN_BLOCK_SIZE);
+	assert(chunk_size > 0 && chunk_size <= (off_t)(UINT32_MAX));
+	
+	chunks.resize((total_bytes + chunk_size - 1) / chunk_size);
+	
+	if(chunks.empty())
+	{
+		stitch_chunks();
+		complete = true;
+	}
+	else{
+		task.reset(new ThreadPool::TaskHandle(wxGetApp().thread_pool->queue_task([this]()
+		{
+			return process_next_chunk();
+		}, -1)));
+	}
+}
+
+REHex::SimilarityIndex::~SimilarityIndex()
+{
+	if(task)
+	{
+		task->finish();
+		task->join();
+	}
+}
+
+off_t REHex::SimilarityIndex::block_size_for(off_t length)
+{
+	off_t block_size = MIN_BLOCK_SIZE;
+	
+	while((block_size * (off_t)(SIGNATURE_LENGTH)) < length)
+	{
+		block_size *= 2;
+	}
+	
+	return block_size;
+}
+
+off_t REHex::SimilarityIndex::get_block_size() const
+{
+	return block_size;
+}
+
+bool REHex::SimilarityIndex::is_complete() const
+{
+	return complete;
+}
+
+off_t REHex::SimilarityIndex::get_bytes_processed() const
+{
+	return bytes_processed;
+}
+
+off_t REHex::SimilarityIndex::get_total_bytes() const
+{
+	return total_bytes;
+}
+
+void REHex::SimilarityIndex::wait_for_completion()
+{
+	if(task)
+	{
+		task->join();
+		task.reset(NULL);
+	}
+}
+
+size_t REHex::SimilarityIndex::get_num_pieces() const
+{
+	assert(complete);
+	return chunk_first_piece.back();
+}
+
+bool REHex::SimilarityIndex::process_next_chunk()
+{
+	size_t chunk_idx = next_chunk.fetch_add(1);
+	if(chunk_idx >= chunks.size())
+	{
+		return true;
+	}
+	
+	try {
+		process_chunk(chunk_idx);
+	}
+	catch(const std::exception &e)
+	{
+		/* Document has probably been truncated under us, whoever is using the index will
+		 * throw it away when they see the change.
+		*/
+		fprintf(stderr, "Exception in REHex::SimilarityIndex::process_chunk: %s\n", e.what());
+	}
+	
+	if(++chunks_done == chunks.size())
+	{
+		stitch_chunks();
+		complete = true;
+	}
+	
+	return false;
+}
+
+void REHex::SimilarityIndex::process_chunk(size_t chunk_idx)
+{
+	off_t chunk_base = (off_t)(chunk_idx) * chunk_size;
+	off_t chunk_length = std::min(chunk_size, (total_bytes - chunk_base));
+	
+	/* Read the bytes before the chunk too, to get the rolling hash into the same state as
+	 * if it had been running from the start of the file.
+	*/
+	off_t prime_length = std::min<off_t>(chunk_base, (SimilarityRollingHash::WINDOW - 1));
+	
+	std::vector<unsigned char> data = document->read_data((chunk_base - prime_length), (chunk_length + prime_length));
+	
+	SimilarityRollingHash rh;
+	for(off_t i = 0; i < prime_length && (size_t)(i) < data.size(); ++i)
+	{
+		rh.update(data[i]);
+	}
+	
+	Chunk &chunk = chunks[chunk_idx];
+	uint32_t hash = 0;
+	
+	for(size_t i = prime_length; i < data.size(); ++i)
+	{
+		rh.update(data[i]);
+		hash = (hash * PIECE_HASH_MULT) + (data[i] + 1);
+		
+		if(!rh.uniform() && (off_t)(rh.sum() % block_size) == (block_size - 1))
+		{
+			uint32_t piece_end = (i - prime_length) + 1;
+			
+			if(chunk.ends.empty())
+			{
+				/* First piece started in an earlier chunk, see stitch_chunks(). */
+				chunk.head_hash = hash;
+				chunk.head_length = piece_end;
+				
+				chunk.hashes.push_back(0);
+			}
+			else{
+				chunk.hashes.push_back(piece_hash_final(hash));
+			}
+			
+			chunk.ends.push_back(piece_end);
+			hash = 0;
+		}
+	}
+	
+	if(chunk.ends.empty())
+	{
+		chunk.head_hash = hash;
+		chunk.head_length = data.size() - prime_length;
+	}
+	else{
+		chunk.tail_hash = hash;
+	}
+	
+	bytes_processed += chunk_length;
+}
+
+void REHex::SimilarityIndex::stitch_chunks()
+{
+	chunk_first_piece.clear();
+	chunk_first_piece.reserve(chunks.size() + 1);
+	
+	uint32_t carry_hash = 0;
+	size_t num_pieces = 0;
+	
+	for(auto c = chunks.begin(); c != chunks.end(); ++c)
+	{
+		chunk_first_piece.push_back(num_pieces);
+		
+		if(c->ends.empty())
+		{
+			/* No pieces ended in this chunk, the whole thing is part of a later one. */
+			carry_hash = piece_hash_combine(carry_hash, c->head_hash, c->head_length);
+		}
+		else{
+			c->hashes[0] = piece_hash_final(piece_hash_combine(carry_hash, c->head_hash, c->head_length));
+			carry_hash = c->tail_hash;
+		}
+		
+		num_pieces += c->ends.size();
+	}
+	
+	chunk_first_piece.push_back(num_pieces);
+}
+
+off_t REHex::SimilarityIndex::piece_end(size_t piece_idx) const
+{
+	size_t chunk_idx = (std::upper_bound(chunk_first_piece.begin(), chunk_first_piece.end(), piece_idx) - chunk_first_piece.begin()) - 1;
+	assert(chunk_idx < chunks.size());
+	
+	return ((off_t)(chunk_idx) * chunk_size) + chunks[chunk_idx].ends[piece_idx - chunk_first_piece[chunk_idx]];
+}
+
+unsigned char REHex::SimilarityIndex::piece_hash(size_t piece_idx) const
+{
+	size_t chunk_idx = (std::upper_bound(chunk_first_piece.begin(), chunk_first_piece.end(), piece_idx) - chunk_first_piece.begin()) - 1;
+	assert(chunk_idx < chunks.size());
+	
+	return chunks[chunk_idx].hashes[piece_idx - chunk_first_piece[chunk_idx]];
+}
+
+size_t REHex::SimilarityIndex::first_piece_from(off_t offset) const
+{
+	/* Piece N starts where piece N - 1 ends, so the first piece starting at or after the
+	 * offset is the one after the first piece ending at or after it.
+	*/
+	
+	if(offset <= 0)
+	{
+		return 0;
+	}
+	
+	size_t lo = 0, hi = get_num_pieces();
+	while(lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		
+		if(piece_end(mid) < offset)
+		{
+			lo = mid + 1;
+		}
+		else{
+			hi = mid;
+		}
+	}
+	
+	return std::min((lo + 1), get_num_pieces());
+}
+
+size_t REHex::SimilarityIndex::end_piece_before(off_t offset) const
+{
+	size_t lo = 0, hi = get_num_pieces();
+	while(lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		
+		if(piece_end(mid) <= offset)
+		{
+			lo = mid + 1;
+		}
+		else{
+			hi = mid;
+		}
+	}
+	
+	return lo;
+}
+
+std::string REHex::SimilarityIndex::signature(off_t offset, off_t length) const
+{
+	size_t begin = first_piece_from(offset);
+	size_t end = end_piece_before(offset + length);
+	
+	std::string sig;
+	
+	for(size_t i = begin; i < end; ++i)
+	{
+		sig.push_back(PIECE_CHARS[piece_hash(i)]);
+	}
+	
+	return sig;
+}
+
+int REHex::SimilarityIndex::compare(const std::string &a, const std::string &b)
+{
+	if(a.empty() || b.empty())
+	{
+		return 0;
+	}
+	
+	/* Levenshtein distance, keeping one row of the matrix. */
+	
+	std::vector<size_t> row(b.size() + 1);
+	for(size_t j = 0; j <= b.size(); ++j)
+	{
+		row[j] = j;
+	}
+	
+	for(size_t i = 1; i <= a.size(); ++i)
+	{
+		size_t diag = row[0];
+		row[0] = i;
+		
+		for(size_t j = 1; j <= b.size(); ++j)
+		{
+			size_t above = row[j];
+			
+			row[j] = std::min({
+				(above + 1),
+				(row[j - 1] + 1),
+				(diag + (a[i - 1] == b[j - 1] ? 0 : 1)) });
+			
+			diag = above;
+		}
+	}
+	
+	size_t distance = row[b.size()];
+	size_t max_length = std::max(a.size(), b.size());
+	
+	return (100 * (max_length - distance)) / max_length;
+}
+
+std::vector<REHex::SimilarityIndex::Match> REHex::SimilarityIndex::find_similar(off_t offset, off_t length, int min_score, size_t max_results, const std::atomic<bool> *cancel) const
+{
+	std::string needle = signature(offset, length);
+	if(needle.size() < MIN_SIGNATURE_PIECES)
+	{
+		return std::vector<Match>();
+	}
+	
+	/* The edit distance between two signatures is at least the length of the longer one,
+	 * less the number of pieces they have in common, so the number of pieces in common is
+	 * tracked as a window is slid over the pieces in the file and the (comparitively slow)
+	 * edit distance is only calculated where the score might reach min_score.
+	*/
+	
+	size_t needle_counts[64] = {};
+	for(auto c = needle.begin(); c != needle.end(); ++c)
+	{
+		++needle_counts[strchr(PIECE_CHARS, *c) - PIECE_CHARS];
+	}
+	
+	size_t window_counts[64] = {};
+	size_t common = 0;
+	
+	std::vector<Match> candidates;
+	
+	size_t num_pieces = get_num_pieces();
+	size_t window_end = 0;
+	
+	for(size_t window_begin = 0; window_begin < num_pieces; ++window_begin)
+	{
+		if((window_begin % FIND_CANCEL_INTERVAL) == 0 && cancel != NULL && *cancel)
+		{
+			return std::vector<Match>();
+		}
+		
+		off_t range_begin = window_begin == 0 ? 0 : piece_end(window_begin - 1);
+		off_t range_end = range_begin + length;
+		
+		if(range_end > total_bytes)
+		{
+			break;
+		}
+		
+		for(; window_end < num_pieces && piece_end(window_end) <= range_end; ++window_end)
+		{
+			unsigned char h = piece_hash(window_end);
+			
+			if(window_counts[h] < needle_counts[h])
+			{
+				++common;
+			}
+			
+			++window_counts[h];
+		}
+		
+		bool overlaps_needle = range_begin < (offset + length) && range_end > offset;
+		
+		if(window_end > window_begin && !overlaps_needle)
+		{
+			size_t max_length = std::max(needle.size(), (window_end - window_begin));
+			
+			if((int)((100 * common) / max_length) >= min_score)
+			{
+				std::string window;
+				for(size_t i = window_begin; i < window_end; ++i)
+				{
+					window.push_back(PIECE_CHARS[piece_hash(i)]);
+				}
+				
+				int score = compare(needle, window);
+				if(score >= min_score)
+				{
+					candidates.push_back(Match(range_begin, length, score));
+				}
+			}
+		}
+		
+		/* Slide the first piece out of the window. */
+		
+		if(window_end > window_begin)
+		{
+			unsigned char h = piece_hash(window_begin);
+			
+			--window_counts[h];
+			
+			if(window_counts[h] < needle_counts[h])
+			{
+				--common;
+			}
+		}
+		else{
+			/* Piece is longer than the range, the window is empty. */
+			window_end = window_begin + 1;
+		}
+	}
+	
+	/* Pick the best matches, skipping any which overlap a better (or earlier) one. */
+	
+	std::sort(candidates.begin(), candidates.end(), [](const Match &a, const Match &b)
+	{
+		return a.score != b.score ? a.score > b.score : a.offset < b.offset;
+	});
+	
+	std::vector<Match> results;
+	std::map<off_t, off_t> taken;
+	
+	for(auto c = candidates.begin(); c != candidates.end() && results.size() < max_results; ++c)
+	{
+		auto next = taken.lower_bound(c->offset);
+		if(next != taken.end() && next->first < (c->offset + c->length))
+		{
+			continue;
+		}
+		
+		if(next != taken.begin() && std::prev(next)->second > c->offset)
+		{
+			continue;
+		}
+		
+		taken.insert(std::make_pair(c->offset, (c->offset + c->length)));
+		results.push_back(*c);
+	}
+	
+	return results;
+}
@@ -0,0 +1,228 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_SIMILARITYINDEX_HPP
+#define REHEX_SIMILARITYINDEX_HPP
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "SharedDocumentPointer.hpp"
+#include "ThreadPool.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Context triggered piecewise hash index of a Document.
+	 *
+	 * A rolling hash of the last 7 bytes is run over the whole document and wherever it
+	 * hits a trigger value (one in every block_size bytes on average) the data since the
+	 * previous trigger is ended as a "piece". Each piece is hashed down to one of 64
+	 * values, in the style of ssdeep.
+	 *
+	 * Since the trigger points only depend on the data around them, the pieces of a
+	 * block of data are the same wherever it is in the file and a few changed bytes
+	 * only change the pieces they fall in. The signature of any range of the file is the
+	 * string of pieces which fall entirely within it, and two ranges can be compared by
+	 * the edit distance between their signatures.
+	 *
+	 * The document is hashed in chunks on the ThreadPool when the index is created. The
+	 * index takes around 5 bytes per piece and doesn't follow changes to the document,
+	 * a new index must be created if the data is modified.
+	*/
+	class SimilarityIndex
+	{
+		public:
+			/**
+			 * @brief Target number of pieces in the signature of a range.
+			*/
+			static const size_t SIGNATURE_LENGTH = 64;
+			
+			/**
+			 * @brief Smallest block size (average piece length).
+			*/
+			static const off_t MIN_BLOCK_SIZE = 3;
+			
+			/**
+			 * @brief Smallest range which can be searched for.
+			*/
+			static const off_t MIN_LENGTH = 1024;
+			
+			/**
+			 * @brief Default size of the chunks hashed by each worker at a time.
+			*/
+			static const off_t DEFAULT_CHUNK_SIZE = 4 * 1024 * 1024;
+			
+			/**
+			 * @brief A range of the document similar to the one being searched for.
+			*/
+			struct Match
+			{
+				off_t offset;
+				off_t length;
+				int score;     /**< Similarity from 0 (nothing in common) to 100 (identical signatures). */
+				
+				Match(off_t offset, off_t length, int score):
+					offset(offset), length(length), score(score) {}
+				
+				bool operator==(const Match &rhs) const
+				{
+					return offset == rhs.offset && length == rhs.length && score == rhs.score;
+				}
+			};
+			
+			/**
+			 * @brief Start indexing a Document.
+			 *
+			 * @param document    Document to index.
+			 * @param block_size  Average length of each piece (see block_size_for()).
+			 * @param chunk_size  Number of bytes hashed by a worker at a time.
+			*/
+			SimilarityIndex(SharedDocumentPointer &document, off_t block_size, off_t chunk_size = DEFAULT_CHUNK_SIZE);
+			
+			~SimilarityIndex();
+			
+			SimilarityIndex(const SimilarityIndex&) = delete;
+			SimilarityIndex &operator=(const SimilarityIndex&) = delete;
+			
+			/**
+			 * @brief Get the block size giving around SIGNATURE_LENGTH pieces for a range.
+			*/
+			static off_t block_size_for(off_t length);
+			
+			/**
+			 * @brief Get the block size of the index.
+			*/
+			off_t get_block_size() const;
+			
+			/**
+			 * @brief Check if the whole document has been indexed.
+			*/
+			bool is_complete() const;
+			
+			/**
+			 * @brief Get the number of bytes hashed so far.
+			*/
+			off_t get_bytes_processed() const;
+			
+			/**
+			 * @brief Get the length of the document being indexed.
+			*/
+			off_t get_total_bytes() const;
+			
+			/**
+			 * @brief Wait for indexing to finish.
+			 *
+			 * This is mostly intended for unit tests. This should not be used from the
+			 * application UI thread.
+			*/
+			void wait_for_completion();
+			
+			/**
+			 * @brief Get the number of pieces in the document.
+			 *
+			 * Only valid once is_complete() returns true.
+			*/
+			size_t get_num_pieces() const;
+			
+			/**
+			 * @brief Get the signature of a range of the document.
+			 *
+			 * Returns one (base64) character for each piece wholly within the range.
+			 * Only valid once is_complete() returns true.
+			*/
+			std::string signature(off_t offset, off_t length) const;
+			
+			/**
+			 * @brief Compare two signatures.
+			 *
+			 * Returns a score from 0 (nothing in common) to 100 (identical).
+			*/
+			static int compare(const std::string &a, const std::string &b);
+			
+			/**
+			 * @brief Find ranges of the document similar to another range.
+			 *
+			 * @param offset       Offset of the range to search for.
+			 * @param length       Length of the range to search for.
+			 * @param min_score    Minimum similarity score of matches.
+			 * @param max_results  Maximum number of matches to return.
+			 * @param cancel       Checked periodically, no matches are returned once set (may be NULL).
+			 *
+			 * Ranges of the same length starting at each piece boundary in the document
+			 * are compared against the range being searched for. The best scoring ranges
+			 * which don't overlap each other (or the range being searched for) are
+			 * returned, ordered by score and then offset.
+			 *
+			 * Only valid once is_complete() returns true. Safe to call from any thread.
+			*/
+			std::vector<Match> find_similar(off_t offset, off_t length, int min_score, size_t max_results, const std::atomic<bool> *cancel = NULL) const;
+		
+		private:
+			/**
+			 * @brief Pieces ending within a chunk of the document.
+			*/
+			struct Chunk
+			{
+				std::vector<uint32_t> ends;         /**< End of each piece, relative to the chunk. */
+				std::vector<unsigned char> hashes;  /**< Hash of each piece (0-63). */
+				
+				/* The first piece in a chunk starts in an earlier chunk, so it can't be
+				 * hashed until all earlier chunks are done. The hashes of the data
+				 * before the first trigger (head) and after the last (tail) are kept so
+				 * the first pieces can be hashed when the chunks are stitched together.
+				*/
+				
+				uint32_t head_hash;
+				off_t head_length;
+				
+				uint32_t tail_hash;
+				
+				Chunk(): head_hash(0), head_length(0), tail_hash(0) {}
+			};
+			
+			SharedDocumentPointer document;
+			const off_t block_size;
+			const off_t chunk_size;
+			const off_t total_bytes;
+			
+			std::vector<Chunk> chunks;
+			std::vector<size_t> chunk_first_piece;  /**< Index of the first piece in each chunk (and total at end). */
+			
+			std::atomic<size_t> next_chunk;
+			std::atomic<size_t> chunks_done;
+			std::atomic<off_t> bytes_processed;
+			std::atomic<bool> complete;
+			
+			std::unique_ptr<ThreadPool::TaskHandle> task;
+			
+			bool process_next_chunk();
+			void process_chunk(size_t chunk_idx);
+			void stitch_chunks();
+			
+			off_t piece_end(size_t piece_idx) const;
+			unsigned char piece_hash(size_t piece_idx) const;
+			size_t first_piece_from(off_t offset) const;
+			size_t end_piece_before(off_t offset) const;
+	};
+}
+
+#endif /* !REHEX_SIMILARITYINDEX_HPP */
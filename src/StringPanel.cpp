@@ -17,6 +17,7 @@
 
 #include "platform.hpp"
 
+#include <algorithm>
 #include <assert.h>
 #include <ctype.h>
 #include <iterator>
@@ -43,6 +44,9 @@ static const size_t UI_THREAD_THRESH = 256 * 1024; /* 256KiB */
 
 static const size_t MAX_STRINGS_BATCH = 64;
 
+/* Encodings which can be searched for alongside the one selected in the encoding choice. */
+static const char *EXTRA_ENCODINGS[] = { "UTF-8", "UTF-16LE", "UTF-16BE" };
+
 static REHex::ToolPanel *StringPanel_factory(wxWindow *parent, REHex::SharedDocumentPointer &document, REHex::DocumentCtrl *document_ctrl)
 {
 	return new REHex::StringPanel(parent, document, document_ctrl);
@@ -56,6 +60,8 @@ enum {
 	ID_CONTINUE_BUTTON,
 	ID_MIN_STRING_LENGTH,
 	ID_CJK_TOGGLE,
+	ID_EXTRA_ENCODING,
+	ID_FILTER_CHOICE,
 };
 
 BEGIN_EVENT_TABLE(REHex::StringPanel, wxPanel)
@@ -63,6 +69,8 @@ BEGIN_EVENT_TABLE(REHex::StringPanel, wxPanel)
 	EVT_LIST_ITEM_ACTIVATED(wxID_ANY, REHex::StringPanel::OnItemActivate)
 	EVT_LIST_ITEM_RIGHT_CLICK(wxID_ANY, REHex::StringPanel::OnItemRightClick)
 	EVT_CHOICE(ID_ENCODING_CHOICE, REHex::StringPanel::OnEncodingChanged)
+	EVT_CHECKBOX(ID_EXTRA_ENCODING, REHex::StringPanel::OnExtraEncodingToggle)
+	EVT_CHOICE(ID_FILTER_CHOICE, REHex::StringPanel::OnFilterChanged)
 	
 	EVT_BUTTON(ID_RESET_BUTTON,     REHex::StringPanel::OnReset)
 	EVT_BUTTON(ID_CONTINUE_BUTTON,  REHex::StringPanel::OnContinue)
@@ -75,6 +83,7 @@ REHex::StringPanel::StringPanel(wxWindow *parent, SharedDocumentPointer &documen
 	ToolPanel(parent),
 	document(document),
 	document_ctrl(document_ctrl),
+	filter_encoding_idx(-1),
 	min_string_length(8),
 	ignore_cjk(false),
 	update_needed(false),
@@ -83,7 +92,9 @@ REHex::StringPanel::StringPanel(wxWindow *parent, SharedDocumentPointer &documen
 	threads_pause(false),
 	spawned_threads(0),
 	running_threads(0),
-	search_base(0)
+	search_base(0),
+	snapshot_version(document->get_data_version()),
+	snapshot_length(document->buffer_length())
 {
 	const int MARGIN = 4;
 	
@@ -91,6 +102,7 @@ REHex::StringPanel::StringPanel(wxWindow *parent, SharedDocumentPointer &documen
 	
 	list_ctrl->AppendColumn("Offset");
 	list_ctrl->AppendColumn("Text");
+	list_ctrl->AppendColumn("Encoding");
 	
 	status_text = new wxStaticText(this, wxID_ANY, "");
 	
@@ -104,7 +116,30 @@ REHex::StringPanel::StringPanel(wxWindow *parent, SharedDocumentPointer &documen
 	}
 	
 	encoding_choice->SetSelection(0);
-	selected_encoding = all_encodings.front();
+	
+	wxBoxSizer *extra_encodings_sizer = new wxBoxSizer(wxHORIZONTAL);
+	extra_encodings_sizer->Add(new wxStaticText(this, wxID_ANY, "Also search: "), 0, wxALIGN_CENTER_VERTICAL);
+	
+	for(size_t i = 0; i < (sizeof(EXTRA_ENCODINGS) / sizeof(*EXTRA_ENCODINGS)); ++i)
+	{
+		const CharacterEncoding *ce = CharacterEncoding::encoding_by_key(EXTRA_ENCODINGS[i]);
+		if(ce == NULL)
+		{
+			/* Encoding isn't available on this system. */
+			continue;
+		}
+		
+		wxCheckBox *check = new wxCheckBox(this, ID_EXTRA_ENCODING, ce->key);
+		extra_encodings_sizer->Add(check, 0, (wxRIGHT | wxALIGN_CENTER_VERTICAL), MARGIN);
+		
+		extra_encoding_checks.push_back(std::make_pair(ce, check));
+	}
+	
+	filter_choice = new wxChoice(this, ID_FILTER_CHOICE);
+	
+	wxBoxSizer *filter_sizer = new wxBoxSizer(wxHORIZONTAL);
+	filter_sizer->Add(new wxStaticText(this, wxID_ANY, "Show: "), 0, wxALIGN_CENTER_VERTICAL);
+	filter_sizer->Add(filter_choice, 0, wxALIGN_CENTER_VERTICAL);
 	
 	min_string_length_ctrl = new wxSpinCtrl(
 		this, ID_MIN_STRING_LENGTH, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS,
@@ -144,8 +179,10 @@ REHex::StringPanel::StringPanel(wxWindow *parent, SharedDocumentPointer &documen
 	
 	wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
 	sizer->Add(encoding_choice, 0, (wxLEFT | wxRIGHT | wxTOP), MARGIN);
+	sizer->Add(extra_encodings_sizer, 0, (wxLEFT | wxRIGHT | wxTOP), MARGIN);
 	sizer->Add(min_string_length_sizer, 0, (wxLEFT | wxRIGHT | wxTOP), MARGIN);
 	sizer->Add(ignore_cjk_check, 0, (wxLEFT | wxRIGHT | wxTOP), MARGIN);
+	sizer->Add(filter_sizer, 0, (wxLEFT | wxRIGHT | wxTOP), MARGIN);
 	sizer->Add(status_sizer, 0, (wxEXPAND | wxLEFT | wxRIGHT | wxTOP), MARGIN);
 	sizer->Add(list_ctrl, 1, (wxEXPAND | wxALL), MARGIN);
 	SetSizerAndFit(sizer);
@@ -153,13 +190,11 @@ REHex::StringPanel::StringPanel(wxWindow *parent, SharedDocumentPointer &documen
 	this->document.auto_cleanup_bind(DATA_ERASE,     &REHex::StringPanel::OnDataErase,     this);
 	this->document.auto_cleanup_bind(DATA_INSERT,    &REHex::StringPanel::OnDataInsert,    this);
 	this->document.auto_cleanup_bind(DATA_OVERWRITE, &REHex::StringPanel::OnDataOverwrite, this);
+	this->document.auto_cleanup_bind(EV_SKIP_RANGES_CHANGED, &REHex::StringPanel::OnSkipRangesChanged, this);
 	
-	this->document.auto_cleanup_bind(DATA_ERASING,              &REHex::StringPanel::OnDataModifying,        this);
-	this->document.auto_cleanup_bind(DATA_ERASE_ABORTED,        &REHex::StringPanel::OnDataModifyAborted,    this);
-	this->document.auto_cleanup_bind(DATA_INSERTING,            &REHex::StringPanel::OnDataModifying,        this);
-	this->document.auto_cleanup_bind(DATA_INSERT_ABORTED,       &REHex::StringPanel::OnDataModifyAborted,    this);
+	skip_ranges = this->document->get_skip_ranges();
 	
-	mark_dirty(0, document->buffer_length());
+	reset_encodings();
 	
 	start_threads();
 }
@@ -200,16 +235,18 @@ void REHex::StringPanel::update()
 	
 	if(update_needed && document_ctrl)
 	{
-		size_t strings_count;
+		size_t strings_count, list_count;
 		
 		{
 			std::lock_guard<std::mutex> sl(strings_lock);
 			
-			strings_count = strings.size();
+			strings_count = count_strings();
+			list_count = count_list_items();
+			
 			update_needed = false;
 		}
 		
-		list_ctrl->SetItemCount(strings_count);
+		list_ctrl->SetItemCount(list_count);
 		
 		bool searching = spawned_threads > 0;
 		std::string status_text = "";
@@ -233,6 +270,11 @@ void REHex::StringPanel::update()
 			status_text += "Found "
 				+ wxNumberFormatter::ToString((long)(strings_count))
 				+ " strings";
+			
+			if(list_count != strings_count)
+			{
+				status_text += ", showing " + wxNumberFormatter::ToString((long)(list_count));
+			}
 		}
 		else if(!searching)
 		{
@@ -243,6 +285,194 @@ void REHex::StringPanel::update()
 	}
 }
 
+void REHex::StringPanel::reset_encodings()
+{
+	/* Must only be called while the worker threads are paused. */
+	
+	std::vector<const CharacterEncoding*> new_encodings;
+	new_encodings.push_back((const CharacterEncoding*)(encoding_choice->GetClientData(encoding_choice->GetSelection())));
+	
+	for(auto i = extra_encoding_checks.begin(); i != extra_encoding_checks.end(); ++i)
+	{
+		if(i->second->GetValue() && std::find(new_encodings.begin(), new_encodings.end(), i->first) == new_encodings.end())
+		{
+			new_encodings.push_back(i->first);
+		}
+	}
+	
+	{
+		std::lock_guard<std::mutex> pl(pause_lock);
+		std::lock_guard<std::mutex> sl(strings_lock);
+		
+		encodings = new_encodings;
+		
+		strings.clear();
+		strings.resize(encodings.size());
+		
+		mark_dirty(0, document->buffer_length());
+	}
+	
+	filter_choice->Clear();
+	filter_choice->Append("All encodings");
+	
+	for(auto e = encodings.begin(); e != encodings.end(); ++e)
+	{
+		filter_choice->Append((*e)->label);
+	}
+	
+	filter_choice->SetSelection(0);
+	filter_choice->Enable(encodings.size() > 1);
+	filter_encoding_idx = -1;
+	
+	list_ctrl->SetItemCount(0);
+	
+	update_needed = true;
+}
+
+size_t REHex::StringPanel::count_strings() const
+{
+	size_t count = 0;
+	
+	for(auto s = strings.begin(); s != strings.end(); ++s)
+	{
+		count += s->size();
+	}
+	
+	return count;
+}
+
+void REHex::StringPanel::clear_strings()
+{
+	for(auto s = strings.begin(); s != strings.end(); ++s)
+	{
+		s->clear_all();
+	}
+}
+
+/* Count the strings starting before offset in all encodings. */
+static size_t count_strings_before(const std::vector<REHex::ByteRangeSet> &strings, off_t offset)
+{
+	size_t count = 0;
+	
+	for(auto s = strings.begin(); s != strings.end(); ++s)
+	{
+		auto next = std::lower_bound(s->begin(), s->end(), offset,
+			[](const REHex::ByteRangeSet::Range &range, off_t offset) { return range.offset < offset; });
+		
+		count += std::distance(s->begin(), next);
+	}
+	
+	return count;
+}
+
+/* The list is never built up in memory - items are looked up from strings as the list control
+ * asks for them, so only the visible ones are ever looked at. The following methods must be
+ * called with strings_lock held.
+*/
+
+size_t REHex::StringPanel::count_list_items() const
+{
+	return filter_encoding_idx >= 0
+		? strings[filter_encoding_idx].size()
+		: count_strings();
+}
+
+bool REHex::StringPanel::get_list_item(size_t idx, ListItem *item) const
+{
+	if(filter_encoding_idx >= 0 || strings.size() == 1)
+	{
+		size_t encoding_idx = filter_encoding_idx >= 0 ? filter_encoding_idx : 0;
+		const ByteRangeSet &encoding_strings = strings[encoding_idx];
+		
+		if(idx >= encoding_strings.size())
+		{
+			return false;
+		}
+		
+		*item = ListItem(encoding_strings[idx].offset, encoding_strings[idx].length, encoding_idx);
+		return true;
+	}
+	
+	if(idx >= count_strings())
+	{
+		return false;
+	}
+	
+	/* The strings from all encodings are listed in offset order, with strings at the same
+	 * offset in the order of the encodings. Find the lowest offset with more than idx
+	 * strings at or before it, which is the offset of the item we want.
+	*/
+	
+	off_t lo = 0, hi = 0;
+	
+	for(auto s = strings.begin(); s != strings.end(); ++s)
+	{
+		if(!s->empty())
+		{
+			hi = std::max(hi, (*s)[s->size() - 1].offset);
+		}
+	}
+	
+	while(lo < hi)
+	{
+		off_t mid = lo + ((hi - lo) / 2);
+		
+		if(count_strings_before(strings, (mid + 1)) > idx)
+		{
+			hi = mid;
+		}
+		else{
+			lo = mid + 1;
+		}
+	}
+	
+	size_t same_offset_idx = idx - count_strings_before(strings, lo);
+	
+	for(size_t e = 0; e < strings.size(); ++e)
+	{
+		auto r = strings[e].find_first_in(lo, 1);
+		
+		if(r != strings[e].end() && r->offset == lo)
+		{
+			if(same_offset_idx == 0)
+			{
+				*item = ListItem(r->offset, r->length, e);
+				return true;
+			}
+			
+			--same_offset_idx;
+		}
+	}
+	
+	/* Unreachable. */
+	assert(false);
+	return false;
+}
+
+bool REHex::StringPanel::find_list_item(off_t offset, size_t *idx) const
+{
+	for(size_t e = 0; e < strings.size(); ++e)
+	{
+		if(filter_encoding_idx >= 0 && (int)(e) != filter_encoding_idx)
+		{
+			continue;
+		}
+		
+		auto r = strings[e].find_first_in(offset, 1);
+		
+		if(r != strings[e].end() && r->offset == offset)
+		{
+			*idx = filter_encoding_idx >= 0
+				? std::distance(strings[e].begin(), r)
+				: count_strings_before(strings, offset);
+			
+			return true;
+		}
+	}
+	
+	return false;
+}
+
 void REHex::StringPanel::mark_dirty(off_t offset, off_t length)
 {
 	ByteRangeSet to_pending;
@@ -317,10 +547,50 @@ off_t REHex::StringPanel::sum_clean_bytes()
 	return document->buffer_length() - sum_dirty_bytes();
 }
 
+void REHex::StringPanel::update_focus()
+{
+	/* Prioritise searching the data which is on screen and around the cursor. */
+	
+	ByteRangeSet focus;
+	
+	if(document_ctrl != NULL)
+	{
+		focus = document_ctrl->get_visible_data();
+	}
+	
+	focus.set_range(document->get_cursor_position().byte(), 1);
+	
+	std::lock_guard<std::mutex> pl(pause_lock);
+	scheduler.set_focus(focus);
+}
+
 REHex::ByteRangeSet REHex::StringPanel::get_strings()
 {
 	std::lock_guard<std::mutex> sl(strings_lock);
-	return strings;
+	
+	ByteRangeSet all_strings;
+	
+	for(auto s = strings.begin(); s != strings.end(); ++s)
+	{
+		all_strings.set_ranges(s->begin(), s->end());
+	}
+	
+	return all_strings;
+}
+
+REHex::ByteRangeSet REHex::StringPanel::get_strings(const std::string &encoding_key)
+{
+	std::lock_guard<std::mutex> sl(strings_lock);
+	
+	for(size_t i = 0; i < encodings.size(); ++i)
+	{
+		if(encodings[i]->key == encoding_key)
+		{
+			return strings[i];
+		}
+	}
+	
+	return ByteRangeSet();
 }
 
 off_t REHex::StringPanel::get_clean_bytes()
@@ -341,7 +611,6 @@ void REHex::StringPanel::set_encoding(const std::string &encoding_key)
 	int num_encodings = encoding_choice->GetCount();
 	
 	int encoding_idx = -1;
-	const CharacterEncoding *encoding = NULL;
 	
 	for(int i = 0; i < num_encodings; ++i)
 	{
@@ -350,8 +619,6 @@ void REHex::StringPanel::set_encoding(const std::string &encoding_key)
 		if(ce->key == encoding_key)
 		{
 			encoding_idx = i;
-			encoding = ce;
-			
 			break;
 		}
 	}
@@ -362,21 +629,47 @@ void REHex::StringPanel::set_encoding(const std::string &encoding_key)
 	}
 	
 	encoding_choice->SetSelection(encoding_idx);
-	this->selected_encoding = encoding;
+	reset_encodings();
 	
+	start_threads();
+}
+
+void REHex::StringPanel::set_extra_encoding(const std::string &encoding_key, bool enable)
+{
+	for(auto i = extra_encoding_checks.begin(); i != extra_encoding_checks.end(); ++i)
 	{
-		std::lock_guard<std::mutex> pl(pause_lock);
-		mark_dirty(0, document->buffer_length());
+		if(i->first->key == encoding_key)
+		{
+			pause_threads();
+			
+			i->second->SetValue(enable);
+			reset_encodings();
+			
+			start_threads();
+			
+			break;
+		}
 	}
+}
+
+void REHex::StringPanel::set_encoding_filter(const std::string &encoding_key)
+{
+	int idx = -1;
 	
+	for(size_t i = 0; i < encodings.size(); ++i)
 	{
-		std::lock_guard<std::mutex> sl(strings_lock);
-		strings.clear_all();
+		if(encodings[i]->key == encoding_key)
+		{
+			idx = i;
+			break;
+		}
 	}
 	
-	start_threads();
+	filter_choice->SetSelection(idx + 1);
+	filter_encoding_idx = idx;
 	
 	update_needed = true;
+	update();
 }
 
 void REHex::StringPanel::set_min_string_length(int min_string_length)
@@ -393,7 +686,7 @@ void REHex::StringPanel::set_min_string_length(int min_string_length)
 	
 	{
 		std::lock_guard<std::mutex> sl(strings_lock);
-		strings.clear_all();
+		clear_strings();
 	}
 	
 	start_threads();
@@ -413,18 +706,19 @@ void REHex::StringPanel::select_all()
 
 void REHex::StringPanel::select_by_file_offset(off_t offset)
 {
-	int idx;
+	size_t idx;
 	
 	{
 		std::lock_guard<std::mutex> sl(strings_lock);
 		
-		auto it = strings.find_first_in(offset, 1);
-		assert(it != strings.end() && it->offset == offset);
-		
-		idx = std::distance(strings.begin(), it);
-		assert(idx < list_ctrl->GetItemCount());
+		if(!find_list_item(offset, &idx))
+		{
+			return;
+		}
 	}
 	
+	assert(idx < (size_t)(list_ctrl->GetItemCount()));
+	
 	list_ctrl->SetItemState(idx, wxLIST_STATE_SELECTED, wxLIST_STATE_SELECTED);
 }
 
@@ -459,9 +753,6 @@ void REHex::StringPanel::thread_main()
 {
 	std::unique_lock<std::mutex> pl(pause_lock);
 	
-	ByteRangeSet set_ranges;
-	ByteRangeSet clear_ranges;
-	
 	auto get_dirty_range = [&]()
 	{
 		return pending.find_first_in(search_base, std::numeric_limits<off_t>::max());
@@ -469,19 +760,18 @@ void REHex::StringPanel::thread_main()
 	
 	while(!threads_exit)
 	{
-		/* Take up to WINDOW_SIZE bytes from the next range in the dirty pool to be
-		 * processed in this thread.
+		/* Take up to WINDOW_SIZE bytes from the pending pool to be processed in this
+		 * thread, starting with whatever is nearest to the part of the file the user
+		 * is looking at.
 		*/
 		
-		auto next_dirty_range = get_dirty_range();
-		if(next_dirty_range == pending.end())
+		ByteRangeSet::Range next_window = scheduler.next_window(pending, search_base, WINDOW_SIZE);
+		if(next_window.length == 0)
 		{
 			/* Nothing to do.
 			 * Wait until some work is available or we need to pause/stop the thread.
 			*/
 			
-			thread_flush(&set_ranges, &clear_ranges, true);
-			
 			resume_cv.wait(pl, [&]() { return get_dirty_range() != pending.end() || threads_pause || threads_exit; });
 			
 			if(threads_pause)
@@ -497,24 +787,64 @@ void REHex::StringPanel::thread_main()
 			continue;
 		}
 		
-		off_t  window_base   = next_dirty_range->offset;
-		size_t window_length = next_dirty_range->length;
-		
-		if(window_base < search_base)
+		if(!snapshot)
 		{
-			off_t adj = search_base - window_base;
-			assert(adj < next_dirty_range->length);
-			
-			window_base += adj;
-			window_length -= adj;
+			snapshot = document->get_read_snapshot();
 			
+			if(snapshot->get_version() != snapshot_version)
+			{
+				/* The document has been changed since we last processed a change
+				 * event, our ranges won't match the new data until we have.
+				*/
+				
+				snapshot.reset();
+				
+				unsigned int stale_version = snapshot_version;
+				resume_cv.wait(pl, [&]() { return snapshot_version != stale_version || threads_pause || threads_exit; });
+				
+				if(threads_pause)
+				{
+					--running_threads;
+					
+					paused_cv.notify_all();
+					resume_cv.wait(pl, [this]() { return !threads_pause; });
+					
+					++running_threads;
+				}
+				
+				continue;
+			}
 		}
 		
-		window_length = std::min<off_t>(window_length, WINDOW_SIZE);
+		off_t  window_base   = next_window.offset;
+		size_t window_length = next_window.length;
 		
 		pending.clear_range(window_base, window_length);
 		working.set_range(  window_base, window_length);
 		
+		/* The window offsets are relative to the current snapshot. We read the data from
+		 * that snapshot so the document can continue being modified while we work, then
+		 * any results are adjusted for changes made since when they are merged.
+		*/
+		
+		std::shared_ptr<const Document::ReadSnapshot> window_snapshot = snapshot;
+		unsigned int window_version = window_snapshot->get_version();
+		
+		/* The encodings can only change while we are paused, so this copy is good until
+		 * the window is finished or we are paused.
+		*/
+		std::vector<const CharacterEncoding*> window_encodings = encodings;
+		
+		/* Likewise for skip_ranges, but that may be large so it is read in place. Windows
+		 * which are entirely within it don't need to be read at all.
+		*/
+		
+		if(skip_ranges.isset(window_base, window_length))
+		{
+			window_done(window_base, window_length, window_version, false);
+			continue;
+		}
+		
 		pl.unlock();
 		
 		/* Grow both ends of our window by MIN_STRING_LENGTH bytes to ensure we can match
@@ -531,7 +861,7 @@ void REHex::StringPanel::thread_main()
 		
 		std::vector<unsigned char> data;
 		try {
-			data = document->read_data(window_base_adj, window_length_adj);
+			data = window_snapshot->read_data(window_base_adj, window_length_adj);
 		}
 		catch(const std::exception&)
 		{
@@ -545,146 +875,229 @@ void REHex::StringPanel::thread_main()
 			
 			pl.lock();
 			
-			working.clear_range(window_base, window_length);
-			mark_dirty(window_base, window_length);
+			window_done(window_base, window_length, window_version, true);
 			
 			continue;
 		}
 		
-		for(size_t i = 0; i < data.size();)
+		window_snapshot.reset();
+		
+		/* The window is read once and then searched for strings in each encoding in turn
+		 * while it is still in memory, rather than going around the whole file again for
+		 * each encoding.
+		*/
+		
+		std::vector<ByteRangeSet> set_ranges(window_encodings.size());
+		std::vector<ByteRangeSet> clear_ranges(window_encodings.size());
+		
+		for(size_t encoding_idx = 0; encoding_idx < window_encodings.size() && window_length > 0; ++encoding_idx)
 		{
-			off_t string_base = window_base_adj + i;
-			off_t string_end  = string_base;
-			
-			/* TODO: Align with encoding word size. */
-			
-			bool is_really_string;
-			size_t num_codepoints = 1;
+			const CharacterEncoding *encoding = window_encodings[encoding_idx];
 			
-			auto is_i_string = [&](bool force_advance)
+			for(size_t i = 0; i < data.size();)
 			{
-				EncodedCharacter ec = selected_encoding->encoder->decode(data.data() + i, data.size() - i);
+				off_t string_base = window_base_adj + i;
+				off_t string_end  = string_base;
 				
-				if(ec.valid)
+				/* TODO: Align with encoding word size. */
+				
+				bool is_really_string;
+				size_t num_codepoints = 1;
+				
+				auto is_i_string = [&](bool force_advance)
 				{
-					ucs4_t c;
-					u8_mbtouc_unsafe(&c, (const uint8_t*)(ec.utf8_char().data()), ec.utf8_char().size());
+					EncodedCharacter ec = encoding->encoder->decode(data.data() + i, data.size() - i);
 					
-					bool is_valid = c >= 0x20
-						&& c != 0x7F
-						&& c != 0xFFFD
-						&& !uc_is_property_unassigned_code_value(c)
-						&& !uc_is_property_not_a_character(c)
-						&& (!ignore_cjk || !(uc_is_property_ideographic(c) || uc_is_property_unified_ideograph(c) || uc_is_property_radical(c)));
-					
-					if(force_advance || is_valid == is_really_string)
+					if(ec.valid)
 					{
-						string_end += ec.encoded_char().size();
-						i          += ec.encoded_char().size();
+						ucs4_t c;
+						u8_mbtouc_unsafe(&c, (const uint8_t*)(ec.utf8_char().data()), ec.utf8_char().size());
+						
+						bool is_valid = c >= 0x20
+							&& c != 0x7F
+							&& c != 0xFFFD
+							&& !uc_is_property_unassigned_code_value(c)
+							&& !uc_is_property_not_a_character(c)
+							&& (!ignore_cjk || !(uc_is_property_ideographic(c) || uc_is_property_unified_ideograph(c) || uc_is_property_radical(c)));
+						
+						if(force_advance || is_valid == is_really_string)
+						{
+							string_end += ec.encoded_char().size();
+							i          += ec.encoded_char().size();
+						}
+						
+						return is_valid;
 					}
-					
-					return is_valid;
-				}
-				else{
-					if(force_advance || !is_really_string)
-					{
-						++string_end;
-						++i;
+					else{
+						if(force_advance || !is_really_string)
+						{
+							++string_end;
+							++i;
+						}
+						
+						return false;
 					}
-					
-					return false;
-				}
-			};
-			
-			is_really_string = is_i_string(true);
-			
-			while(!threads_pause && !threads_exit && i < data.size() && is_i_string(false) == is_really_string)
-			{
-				++num_codepoints;
-			}
-			
-			if(threads_pause || threads_exit)
-			{
-				/* We are being paused to allow for data being inserted or erased.
-				 * This may invalidate the base and/or length of our window, so we
-				 * mark the window as dirty again from the last point we started
-				 * processing so that it can be adjusted correctly and then resumed
-				 * when processing continues.
-				*/
+				};
 				
-				off_t  new_dirty_base   = std::max(window_base, string_base);
-				size_t new_dirty_length = window_length - (new_dirty_base - window_base);
+				is_really_string = is_i_string(true);
 				
-				/* vvvvvvvv */
-				pl.lock();
-				
-				if(string_base > window_base)
+				while(!threads_pause && !threads_exit && i < data.size() && is_i_string(false) == is_really_string)
 				{
-					mark_work_done(window_base, (string_base - window_base));
+					++num_codepoints;
 				}
 				
-				working.clear_range(new_dirty_base, new_dirty_length);
-				mark_dirty(new_dirty_base, new_dirty_length);
-				
-				thread_flush(&set_ranges, &clear_ranges, true);
-				
-				--running_threads;
-				
-				if(threads_exit)
+				if(threads_pause || threads_exit)
 				{
-					--spawned_threads;
-					return;
+					/* We are being paused to allow the search settings to be changed. We
+					 * mark the window as dirty again from the last point we started
+					 * processing so that it can be resumed when processing continues.
+					 *
+					 * When searching for more than one encoding the others haven't got
+					 * that far, so the whole window is marked dirty again.
+					*/
+					
+					off_t  new_dirty_base   = window_encodings.size() == 1 ? std::max(window_base, string_base) : window_base;
+					size_t new_dirty_length = window_length - (new_dirty_base - window_base);
+					
+					/* vvvvvvvv */
+					pl.lock();
+					
+					for(size_t e = 0; e < window_encodings.size(); ++e)
+					{
+						thread_flush(e, &(set_ranges[e]), &(clear_ranges[e]), window_version, true);
+					}
+					
+					if(new_dirty_base > window_base)
+					{
+						window_done(window_base, (new_dirty_base - window_base), window_version, false);
+					}
+					
+					window_done(new_dirty_base, new_dirty_length, window_version, true);
+					
+					--running_threads;
+					
+					if(threads_exit)
+					{
+						--spawned_threads;
+						return;
+					}
+					
+					paused_cv.notify_all();
+					resume_cv.wait(pl, [this]() { return !threads_pause; });
+					
+					++running_threads;
+					
+					pl.unlock();
+					/* ^^^^^^^^ */
+					
+					/* Window is no longer valid, get a new one. */
+					window_length = 0;
+					break;
 				}
 				
-				paused_cv.notify_all();
-				resume_cv.wait(pl, [this]() { return !threads_pause; });
+				off_t clamped_string_base = std::max(string_base, window_base);
+				off_t clamped_string_end  = std::min(string_end,  (off_t)(window_base + window_length));
 				
-				++running_threads;
-				
-				pl.unlock();
-				/* ^^^^^^^^ */
-				
-				/* Window is no longer valid, get a new one. */
-				window_length = 0;
-				break;
-			}
-			
-			off_t clamped_string_base = std::max(string_base, window_base);
-			off_t clamped_string_end  = std::min(string_end,  (off_t)(window_base + window_length));
-			
-			if(clamped_string_base < clamped_string_end)
-			{
-				if(is_really_string && num_codepoints >= (size_t)(min_string_length))
-				{
-					set_ranges.set_range(clamped_string_base, (clamped_string_end - clamped_string_base));
-				}
-				else if(clamped_string_base <= clamped_string_end)
+				if(clamped_string_base < clamped_string_end)
 				{
-					clear_ranges.set_range(clamped_string_base, (clamped_string_end - clamped_string_base));
+					if(is_really_string && num_codepoints >= (size_t)(min_string_length)
+						&& !skip_ranges.isset(clamped_string_base, (clamped_string_end - clamped_string_base)))
+					{
+						set_ranges[encoding_idx].set_range(clamped_string_base, (clamped_string_end - clamped_string_base));
+					}
+					else if(clamped_string_base <= clamped_string_end)
+					{
+						clear_ranges[encoding_idx].set_range(clamped_string_base, (clamped_string_end - clamped_string_base));
+					}
 				}
+				
+				thread_flush(encoding_idx, &(set_ranges[encoding_idx]), &(clear_ranges[encoding_idx]), window_version, false);
 			}
-			
-			thread_flush(&set_ranges, &clear_ranges, false);
 		}
 		
 		pl.lock();
 		
-		mark_work_done(window_base, window_length);
+		if(window_length > 0)
+		{
+			/* Results must be merged before the next window, which may be relative to
+			 * a newer snapshot.
+			*/
+			for(size_t e = 0; e < window_encodings.size(); ++e)
+			{
+				thread_flush(e, &(set_ranges[e]), &(clear_ranges[e]), window_version, true);
+			}
+			
+			window_done(window_base, window_length, window_version, false);
+		}
 	}
 	
-	thread_flush(&set_ranges, &clear_ranges, true);
-	
 	--running_threads;
 	--spawned_threads;
 }
 
-void REHex::StringPanel::thread_flush(ByteRangeSet *set_ranges, ByteRangeSet *clear_ranges, bool force)
+bool REHex::StringPanel::adjust_to_current(ByteRangeSet *ranges, unsigned int from_version, bool clear_changed)
+{
+	unsigned int current_version = snapshot_version;
+	if(from_version == current_version)
+	{
+		return true;
+	}
+	
+	std::vector<Document::DataChange> changes;
+	if(!document->get_data_changes(from_version, current_version, &changes))
+	{
+		return false;
+	}
+	
+	Document::apply_data_changes(ranges, changes, clear_changed);
+	
+	return true;
+}
+
+void REHex::StringPanel::window_done(off_t offset, off_t length, unsigned int version, bool requeue)
+{
+	ByteRangeSet window;
+	window.set_range(offset, length);
+	
+	/* The window in working has been moved along with any insertions/erasures since the
+	 * window was taken, so we don't clear any overwritten ranges from it here.
+	*/
+	
+	if(adjust_to_current(&window, version, false))
+	{
+		for(auto r = window.begin(); r != window.end(); ++r)
+		{
+			if(requeue)
+			{
+				working.clear_range(r->offset, r->length);
+				mark_dirty(r->offset, r->length);
+			}
+			else{
+				mark_work_done(r->offset, r->length);
+			}
+		}
+	}
+	else{
+		/* Too many changes have been made since we took the window to work out where
+		 * it is now. Start again from scratch.
+		*/
+		
+		working.clear_all();
+		mark_dirty(0, snapshot_length);
+	}
+}
+
+void REHex::StringPanel::thread_flush(size_t encoding_idx, ByteRangeSet *set_ranges, ByteRangeSet *clear_ranges, unsigned int version, bool force)
 {
 	if(force || clear_ranges->size() >= MAX_STRINGS_BATCH)
 	{
 		std::lock_guard<std::mutex> sl(strings_lock);
 		
-		strings.clear_ranges(clear_ranges->begin(), clear_ranges->end());
+		if(adjust_to_current(clear_ranges, version, true))
+		{
+			strings[encoding_idx].clear_ranges(clear_ranges->begin(), clear_ranges->end());
+		}
+		
 		clear_ranges->clear_all();
 		
 		update_needed = true;
@@ -694,23 +1107,24 @@ void REHex::StringPanel::thread_flush(ByteRangeSet *set_ranges, ByteRangeSet *cl
 	{
 		std::lock_guard<std::mutex> sl(strings_lock);
 		
-		if(!set_ranges->empty())
+		if(!set_ranges->empty() && adjust_to_current(set_ranges, version, true))
 		{
 			off_t processed_total = sum_clean_bytes();
-			size_t size_hint = (double)(strings.size()) * ((double)(document->buffer_length()) / (double)(processed_total));
+			size_t size_hint = (double)(strings[encoding_idx].size()) * ((double)(snapshot_length) / (double)(processed_total));
 			
 			if(size_hint > MAX_STRINGS)
 			{
 				size_hint = MAX_STRINGS;
 			}
 			
-			strings.set_ranges(set_ranges->begin(), set_ranges->end(), size_hint);
-			set_ranges->clear_all();
+			strings[encoding_idx].set_ranges(set_ranges->begin(), set_ranges->end(), size_hint);
 			
 			update_needed = true;
 		}
 		
-		if(strings.size() >= MAX_STRINGS)
+		set_ranges->clear_all();
+		
+		if(count_strings() >= MAX_STRINGS)
 		{
 			/* Reached the string limit, start spinning down. */
 			threads_exit = true;
@@ -723,13 +1137,14 @@ void REHex::StringPanel::start_threads()
 	{
 		std::lock_guard<std::mutex> sl(strings_lock);
 		
-		if(strings.size() >= MAX_STRINGS)
+		if(count_strings() >= MAX_STRINGS)
 		{
 			/* Already at the strings limit, don't restart threads. */
 			return;
 		}
 	}
 	
+	update_focus();
 	resume_threads();
 	
 	std::lock_guard<std::mutex> pl(pause_lock);
@@ -897,35 +1312,39 @@ wxString REHex::StringPanel::get_item_offset_and_string(StringPanelListCtrl *lis
 	return list_ctrl->OnGetItemText(item_idx, 0) + "\t" + list_ctrl->OnGetItemText(item_idx, 1);
 }
 
-void REHex::StringPanel::OnDataModifying(OffsetLengthEvent &event)
+void REHex::StringPanel::data_changed()
 {
-	pause_threads();
+	/* Called with both pause_lock and strings_lock held. */
 	
-	/* Continue propogation. */
-	event.Skip();
-}
-
-void REHex::StringPanel::OnDataModifyAborted(OffsetLengthEvent &event)
-{
-	start_threads();
+	snapshot_version = document->get_data_version();
+	snapshot_length = document->buffer_length();
 	
-	/* Continue propogation. */
-	event.Skip();
+	snapshot.reset();
+	
+	/* Wake any threads waiting for us to catch up with the change. */
+	resume_cv.notify_all();
 }
 
 void REHex::StringPanel::OnDataErase(OffsetLengthEvent &event)
 {
-	{
-		std::lock_guard<std::mutex> sl(strings_lock);
-		strings.data_erased(event.offset, event.length);
-	}
-	
 	{
 		std::lock_guard<std::mutex> pl(pause_lock);
+		std::lock_guard<std::mutex> sl(strings_lock);
+		
+		for(auto s = strings.begin(); s != strings.end(); ++s)
+		{
+			s->data_erased(event.offset, event.length);
+		}
+		
+		/* Any windows being processed are moved along with the data. The worker
+		 * threads adjust their results to match when they are done.
+		*/
 		
 		dirty.data_erased(event.offset, event.length);
 		pending.data_erased(event.offset, event.length);
-		assert(working.empty());
+		working.data_erased(event.offset, event.length);
+		
+		data_changed();
 		
 		mark_dirty_pad(event.offset, 0);
 	}
@@ -941,17 +1360,20 @@ void REHex::StringPanel::OnDataErase(OffsetLengthEvent &event)
 
 void REHex::StringPanel::OnDataInsert(OffsetLengthEvent &event)
 {
-	{
-		std::lock_guard<std::mutex> sl(strings_lock);
-		strings.data_inserted(event.offset, event.length);
-	}
-	
 	{
 		std::lock_guard<std::mutex> pl(pause_lock);
+		std::lock_guard<std::mutex> sl(strings_lock);
+		
+		for(auto s = strings.begin(); s != strings.end(); ++s)
+		{
+			s->data_inserted(event.offset, event.length);
+		}
 		
 		dirty.data_inserted(event.offset, event.length);
 		pending.data_inserted(event.offset, event.length);
-		assert(working.empty());
+		working.data_inserted(event.offset, event.length);
+		
+		data_changed();
 		
 		mark_dirty_pad(event.offset, event.length);
 	}
@@ -964,13 +1386,17 @@ void REHex::StringPanel::OnDataInsert(OffsetLengthEvent &event)
 
 void REHex::StringPanel::OnDataOverwrite(OffsetLengthEvent &event)
 {
-	{
-		std::lock_guard<std::mutex> sl(strings_lock);
-		strings.clear_range(event.offset, event.length);
-	}
-	
 	{
 		std::lock_guard<std::mutex> pl(pause_lock);
+		std::lock_guard<std::mutex> sl(strings_lock);
+		
+		for(auto s = strings.begin(); s != strings.end(); ++s)
+		{
+			s->clear_range(event.offset, event.length);
+		}
+		
+		data_changed();
+		
 		mark_dirty_pad(event.offset, event.length);
 	}
 	
@@ -983,6 +1409,33 @@ void REHex::StringPanel::OnDataOverwrite(OffsetLengthEvent &event)
 	event.Skip();
 }
 
+void REHex::StringPanel::OnSkipRangesChanged(wxCommandEvent &event)
+{
+	if(!(document->get_skip_ranges() == skip_ranges))
+	{
+		pause_threads();
+		
+		{
+			std::lock_guard<std::mutex> pl(pause_lock);
+			
+			skip_ranges = document->get_skip_ranges();
+			mark_dirty(0, document->buffer_length());
+		}
+		
+		{
+			std::lock_guard<std::mutex> sl(strings_lock);
+			clear_strings();
+		}
+		
+		start_threads();
+		
+		update_needed = true;
+	}
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
 void REHex::StringPanel::OnItemActivate(wxListEvent &event)
 {
 	int num_selected = list_ctrl->GetSelectedItemCount();
@@ -995,16 +1448,17 @@ void REHex::StringPanel::OnItemActivate(wxListEvent &event)
 	long item_idx = event.GetIndex();
 	assert(item_idx >= 0);
 	
-	std::lock_guard<std::mutex> sl(strings_lock);
+	ListItem string_range(0, 0, 0);
 	
-	if((size_t)(item_idx) >= strings.size())
 	{
-		/* UI thread probably hasn't caught up to worker threads yet. */
-		return;
+		std::lock_guard<std::mutex> sl(strings_lock);
+		
+		if(!get_list_item(item_idx, &string_range))
+		{
+			return;
+		}
 	}
 	
-	const ByteRangeSet::Range &string_range = strings[item_idx];
-	
 	document->set_cursor_position(string_range.offset);
 	document_ctrl->set_selection_raw(string_range.offset, (string_range.offset + string_range.length - 1));
 }
@@ -1069,6 +1523,10 @@ void REHex::StringPanel::OnTimerTick(wxTimerEvent &event)
 		/* Processing is finished. Shut down threads. */
 		stop_threads();
 	}
+	else{
+		/* Follow the user as they scroll around the file. */
+		update_focus();
+	}
 	
 	update();
 }
@@ -1077,22 +1535,26 @@ void REHex::StringPanel::OnEncodingChanged(wxCommandEvent &event)
 {
 	pause_threads();
 	
-	int encoding_idx = event.GetSelection();
-	selected_encoding = (const CharacterEncoding*)(encoding_choice->GetClientData(encoding_idx));
+	reset_encodings();
 	
-	{
-		std::lock_guard<std::mutex> pl(pause_lock);
-		mark_dirty(0, document->buffer_length());
-	}
+	start_threads();
+}
+
+void REHex::StringPanel::OnExtraEncodingToggle(wxCommandEvent &event)
+{
+	pause_threads();
 	
-	{
-		std::lock_guard<std::mutex> sl(strings_lock);
-		strings.clear_all();
-	}
+	reset_encodings();
 	
 	start_threads();
+}
+
+void REHex::StringPanel::OnFilterChanged(wxCommandEvent &event)
+{
+	filter_encoding_idx = event.GetSelection() - 1;
 	
 	update_needed = true;
+	update();
 }
 
 void REHex::StringPanel::OnMinStringLength(wxSpinEvent &event)
@@ -1108,7 +1570,7 @@ void REHex::StringPanel::OnMinStringLength(wxSpinEvent &event)
 	
 	{
 		std::lock_guard<std::mutex> sl(strings_lock);
-		strings.clear_all();
+		clear_strings();
 	}
 	
 	start_threads();
@@ -1129,7 +1591,7 @@ void REHex::StringPanel::OnCJKToggle(wxCommandEvent &event)
 	
 	{
 		std::lock_guard<std::mutex> sl(strings_lock);
-		strings.clear_all();
+		clear_strings();
 	}
 	
 	start_threads();
@@ -1141,16 +1603,25 @@ void REHex::StringPanel::OnReset(wxCommandEvent &event)
 {
 	pause_threads();
 	
-	if(!strings.empty())
+	off_t strings_begin = std::numeric_limits<off_t>::max();
+	off_t strings_end = 0;
+	
+	for(auto s = strings.begin(); s != strings.end(); ++s)
+	{
+		if(!s->empty())
+		{
+			strings_begin = std::min(strings_begin, s->first().offset);
+			strings_end = std::max(strings_end, (s->last().offset + s->last().length));
+		}
+	}
+	
+	if(strings_begin < strings_end)
 	{
-		off_t strings_begin = strings.first().offset;
-		off_t strings_end = strings.last().offset + strings.last().length;
-		
 		pending.set_range(strings_begin, (strings_end - strings_begin));
 	}
 	
 	search_base = 0;
-	strings.clear_all();
+	clear_strings();
 	
 	start_threads();
 	
@@ -1168,16 +1639,25 @@ void REHex::StringPanel::OnContinue(wxCommandEvent &event)
 	
 	search_base = next_pending->offset;
 	
-	if(!strings.empty())
+	off_t strings_begin = std::numeric_limits<off_t>::max();
+	off_t strings_end = 0;
+	
+	for(auto s = strings.begin(); s != strings.end(); ++s)
+	{
+		if(!s->empty())
+		{
+			strings_begin = std::min(strings_begin, s->first().offset);
+			strings_end = std::max(strings_end, (s->last().offset + s->last().length));
+		}
+	}
+	
+	if(strings_begin < strings_end)
 	{
-		off_t strings_begin = strings.first().offset;
-		off_t strings_end = strings.last().offset + strings.last().length;
-		
 		pending.set_range(strings_begin, (strings_end - strings_begin));
-		
-		strings.clear_all();
 	}
 	
+	clear_strings();
+	
 	start_threads();
 	
 	reset_button->Enable();
@@ -1193,20 +1673,24 @@ wxString REHex::StringPanel::StringPanelListCtrl::OnGetItemText(long item, long
 	StringPanel *parent = dynamic_cast<StringPanel*>(GetParent());
 	assert(parent != NULL);
 	
-	std::lock_guard<std::mutex> sl(parent->strings_lock);
+	ListItem si(0, 0, 0);
 	
-	if((size_t)(item) >= parent->strings.size())
 	{
-		/* wxWidgets has asked for an item beyond the end of the set.
-		 *
-		 * This probably means an element has been removed by a worker thread but the UI
-		 * thread hasn't caught up and called SetItemCount() yet.
-		*/
+		std::lock_guard<std::mutex> sl(parent->strings_lock);
 		
-		return "???";
+		if(!parent->get_list_item(item, &si))
+		{
+			/* wxWidgets has asked for an item beyond the end of the list.
+			 *
+			 * This probably means an element has been removed by a worker thread but
+			 * the UI thread hasn't caught up and called SetItemCount() yet.
+			*/
+			
+			return "???";
+		}
 	}
 	
-	const ByteRangeSet::Range &si = parent->strings.get_ranges()[item];
+	const CharacterEncoding *encoding = parent->encodings[si.encoding_idx];
 	
 	switch(column)
 	{
@@ -1226,7 +1710,7 @@ wxString REHex::StringPanel::StringPanelListCtrl::OnGetItemText(long item, long
 				
 				for(size_t i = 0; i < string_data.size();)
 				{
-					EncodedCharacter ec = parent->selected_encoding->encoder->decode(string_data.data() + i, string_data.size() - i);
+					EncodedCharacter ec = encoding->encoder->decode(string_data.data() + i, string_data.size() - i);
 					
 					string += ec.utf8_char();
 					i += ec.encoded_char().size();
@@ -1241,6 +1725,12 @@ wxString REHex::StringPanel::StringPanelListCtrl::OnGetItemText(long item, long
 			}
 		}
 		
+		case 2:
+		{
+			/* Encoding column */
+			return encoding->key;
+		}
+		
 		default:
 			/* Unknown column */
 			abort();
@@ -21,9 +21,11 @@
 #include <atomic>
 #include <condition_variable>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <stddef.h>
 #include <thread>
+#include <vector>
 #include <wx/animate.h>
 #include <wx/bmpbuttn.h>
 #include <wx/checkbox.h>
@@ -39,6 +41,7 @@
 #include "CharacterEncoder.hpp"
 #include "document.hpp"
 #include "Events.hpp"
+#include "RangeScheduler.hpp"
 #include "SafeWindowPointer.hpp"
 #include "SharedDocumentPointer.hpp"
 #include "ToolPanel.hpp"
@@ -70,10 +73,33 @@ namespace REHex {
 			
 			virtual wxSize DoGetBestClientSize() const override;
 			
+			/**
+			 * @brief Get the strings found in any of the encodings being searched for.
+			*/
 			ByteRangeSet get_strings();
+			
+			/**
+			 * @brief Get the strings found in one of the encodings being searched for.
+			*/
+			ByteRangeSet get_strings(const std::string &encoding_key);
+			
 			off_t get_clean_bytes();
 			size_t get_num_threads();
 			void set_encoding(const std::string &encoding_key);
+			
+			/**
+			 * @brief Enable or disable searching for one of the "Also search" encodings.
+			 *
+			 * Strings in the extra encodings are found in the same pass over the file as
+			 * the ones in the main encoding and listed alongside them.
+			*/
+			void set_extra_encoding(const std::string &encoding_key, bool enable);
+			
+			/**
+			 * @brief Only list strings in the given encoding (empty string lists all).
+			*/
+			void set_encoding_filter(const std::string &encoding_key);
+			
 			void set_min_string_length(int min_string_length);
 			
 			void select_all();
@@ -86,6 +112,19 @@ namespace REHex {
 			static wxString get_item_offset_and_string(StringPanelListCtrl *list_ctrl, int item_idx);
 			
 		private:
+			/**
+			 * @brief A string shown in the list.
+			*/
+			struct ListItem
+			{
+				off_t offset;
+				off_t length;
+				size_t encoding_idx;  /**< Index into encodings. */
+				
+				ListItem(off_t offset, off_t length, size_t encoding_idx):
+					offset(offset), length(length), encoding_idx(encoding_idx) {}
+			};
+			
 			SharedDocumentPointer document;
 			SafeWindowPointer<DocumentCtrl> document_ctrl;
 			
@@ -93,7 +132,15 @@ namespace REHex {
 			wxStaticText *status_text;
 			
 			wxChoice *encoding_choice;
-			const CharacterEncoding *selected_encoding;
+			std::vector< std::pair<const CharacterEncoding*, wxCheckBox*> > extra_encoding_checks;
+			
+			wxChoice *filter_choice;
+			int filter_encoding_idx;  /* Index into encodings to list, -1 for all. */
+			
+			/* Encodings being searched for, the one selected in encoding_choice first.
+			 * Only changed while the worker threads are paused.
+			*/
+			std::vector<const CharacterEncoding*> encodings;
 			
 			wxSpinCtrl *min_string_length_ctrl;
 			int min_string_length;
@@ -101,12 +148,17 @@ namespace REHex {
 			wxCheckBox *ignore_cjk_check;
 			bool ignore_cjk;
 			
+			/* Copy of the document's skip ranges, strings entirely within these aren't
+			 * listed. Only changed while the worker threads are paused.
+			*/
+			ByteRangeSet skip_ranges;
+			
 			wxBitmapButton *reset_button;
 			wxBitmapButton *continue_button;
 			wxAnimationCtrl *spinner;
 			
 			std::mutex strings_lock;
-			ByteRangeSet strings;
+			std::vector<ByteRangeSet> strings;  /* Strings found in each of encodings. */
 			bool update_needed;
 			
 			std::list<std::thread> threads;  /* List of threads created and not yet reaped. */
@@ -122,16 +174,47 @@ namespace REHex {
 			ByteRangeSet dirty;                 /* Ranges which are dirty, but not yet ready to be processed. */
 			ByteRangeSet pending;               /* Ranges waiting to be processed. */
 			ByteRangeSet working;               /* Ranges currently being processed. */
+			RangeScheduler scheduler;           /* Chooses which pending range to process next. */
 			off_t search_base;
 			
+			/* Version and length of the document as of the last data change event we
+			 * have processed. The ranges in strings, dirty, pending and working are all
+			 * relative to this version of the data.
+			 *
+			 * Protected by both strings_lock and pause_lock - both must be held to
+			 * change them and either must be held to access them.
+			*/
+			unsigned int snapshot_version;
+			off_t snapshot_length;
+			
+			/* Snapshot of the document at snapshot_version, taken by the first worker
+			 * thread to need one after each change rather than on every change.
+			 *
+			 * Protected by pause_lock.
+			*/
+			std::shared_ptr<const Document::ReadSnapshot> snapshot;
+			
+			void data_changed();
+			
+			void reset_encodings();
+			size_t count_strings() const;
+			void clear_strings();
+			size_t count_list_items() const;
+			bool get_list_item(size_t idx, ListItem *item) const;
+			bool find_list_item(off_t offset, size_t *idx) const;
+			
 			void mark_dirty(off_t offset, off_t length);
 			void mark_dirty_pad(off_t offset, off_t length);
 			void mark_work_done(off_t offset, off_t length);
 			off_t sum_dirty_bytes();
 			off_t sum_clean_bytes();
 			
+			void update_focus();
+			
 			void thread_main();
-			void thread_flush(ByteRangeSet *set_ranges, ByteRangeSet *clear_ranges, bool force);
+			void thread_flush(size_t encoding_idx, ByteRangeSet *set_ranges, ByteRangeSet *clear_ranges, unsigned int version, bool force);
+			bool adjust_to_current(ByteRangeSet *ranges, unsigned int from_version, bool clear_changed);
+			void window_done(off_t offset, off_t length, unsigned int version, bool requeue);
 			void start_threads();
 			void stop_threads();
 			void pause_threads();
@@ -139,15 +222,16 @@ namespace REHex {
 			
 			void do_export(wxString (*get_item_func)(StringPanelListCtrl*, int));
 			
-			void OnDataModifying(OffsetLengthEvent &event);
-			void OnDataModifyAborted(OffsetLengthEvent &event);
 			void OnDataErase(OffsetLengthEvent &event);
 			void OnDataInsert(OffsetLengthEvent &event);
 			void OnDataOverwrite(OffsetLengthEvent &event);
+			void OnSkipRangesChanged(wxCommandEvent &event);
 			void OnItemActivate(wxListEvent &event);
 			void OnItemRightClick(wxListEvent &event);
 			void OnTimerTick(wxTimerEvent &event);
 			void OnEncodingChanged(wxCommandEvent &event);
+			void OnExtraEncodingToggle(wxCommandEvent &event);
+			void OnFilterChanged(wxCommandEvent &event);
 			void OnReset(wxCommandEvent &event);
 			void OnContinue(wxCommandEvent &event);
 			void OnMinStringLength(wxSpinEvent &event);
@@ -20,6 +20,7 @@
 #include <exception>
 #include <inttypes.h>
 #include <stack>
+#include <stdio.h>
 #include <tuple>
 #include <vector>
 #include <wx/artprov.h>
@@ -230,6 +231,12 @@ REHex::Tab::Tab(wxWindow *parent, SharedDocumentPointer &document):
 	wxGetApp().Bind(BULK_UPDATES_FROZEN, &REHex::Tab::OnBulkUpdatesFrozen, this);
 	wxGetApp().Bind(BULK_UPDATES_THAWED, &REHex::Tab::OnBulkUpdatesThawed, this);
 	
+	/* Keep indexing any file which was indexed when it was last open. */
+	if(NGramIndex::cache_exists(doc->get_filename()))
+	{
+		set_search_index_enabled(true);
+	}
+	
 	CallAfter([&]()
 	{
 		doc_ctrl->set_scroll_yoff(0);
@@ -245,6 +252,17 @@ REHex::Tab::~Tab()
 	{
 		(*sdi)->Unbind(wxEVT_DESTROY, &REHex::Tab::OnSearchDialogDestroy, this);
 	}
+	
+	if(search_index)
+	{
+		try {
+			search_index->save_cache();
+		}
+		catch(const std::exception &e)
+		{
+			fprintf(stderr, "Unable to save search index: %s\n", e.what());
+		}
+	}
 }
 
 bool REHex::Tab::tool_active(const std::string &name)
@@ -676,6 +694,29 @@ void REHex::Tab::set_auto_reload(bool auto_reload)
 	this->auto_reload = auto_reload;
 }
 
+bool REHex::Tab::get_search_index_enabled() const
+{
+	return (bool)(search_index);
+}
+
+void REHex::Tab::set_search_index_enabled(bool enabled)
+{
+	if(enabled && !search_index)
+	{
+		search_index.reset(new NGramIndex(doc));
+	}
+	else if(!enabled && search_index)
+	{
+		search_index.reset();
+		NGramIndex::remove_cache(doc->get_filename());
+	}
+}
+
+std::shared_ptr<REHex::NGramIndex> REHex::Tab::get_search_index() const
+{
+	return search_index;
+}
+
 void REHex::Tab::OnSize(wxSizeEvent &event)
 {
 	if(h_splitter->IsSplit())
@@ -813,6 +854,8 @@ void REHex::Tab::OnDocumentCtrlChar(wxKeyEvent &event)
 	{
 		unsigned char nibble = REHex::parse_ascii_nibble(key);
 		
+		ScopedKeystroke keystroke(doc);
+		
 		if(insert_mode && (cursor_pos_within_region % BitOffset(1,0) != BitOffset(0, 4)))
 		{
 			if(!cursor_pos.byte_aligned())
@@ -848,6 +891,8 @@ void REHex::Tab::OnDocumentCtrlChar(wxKeyEvent &event)
 		wxCharBuffer utf8_buf = wxString(wxUniChar(ukey)).utf8_str();
 		std::string utf8_key(utf8_buf.data(), utf8_buf.length());
 		
+		ScopedKeystroke keystroke(doc);
+		
 		if(insert_mode)
 		{
 			if(cursor_pos.byte_aligned())
@@ -1474,6 +1519,14 @@ void REHex::Tab::file_deleted_dialog()
 	
 	file_deleted_dialog_pending = false;
 	
+	if(doc->get_filename().empty())
+	{
+		/* The document is a fork of another one. It still has its own handle to the
+		 * deleted file to read from and has no filename to save or reload from.
+		*/
+		return;
+	}
+	
 	wxMessageDialog confirm(
 		this,
 		(wxString("The file ") + doc->get_filename() + " has been deleted from disk."),
@@ -1546,6 +1599,20 @@ void REHex::Tab::file_modified_dialog()
 	
 	file_modified_dialog_pending = false;
 	
+	if(doc->get_filename().empty())
+	{
+		/* The document is a fork of another one. It can't be reloaded, and any data it
+		 * hasn't modified is still read from the file the parent was opened from.
+		*/
+		
+		wxMessageBox(
+			(wxString("The file which '") + doc->get_title() + "' was forked from has been modified externally.\n"
+				+ "Any data which hasn't been changed in the fork may now be incorrect."),
+			"File modified", (wxOK | wxICON_EXCLAMATION), this);
+		
+		return;
+	}
+	
 	if(doc->is_dirty())
 	{
 		wxMessageDialog confirm(
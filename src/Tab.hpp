@@ -19,6 +19,7 @@
 #define REHEX_TAB_HPP
 
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -33,6 +34,7 @@
 #include "document.hpp"
 #include "DocumentCtrl.hpp"
 #include "Events.hpp"
+#include "NGramIndex.hpp"
 #include "SafeWindowPointer.hpp"
 #include "SettingsDialog.hpp"
 #include "SharedDocumentPointer.hpp"
@@ -95,6 +97,23 @@ namespace REHex
 			bool get_auto_reload() const;
 			void set_auto_reload(bool auto_reload);
 			
+			/**
+			 * @brief Check if the document is being indexed to speed up searches.
+			*/
+			bool get_search_index_enabled() const;
+			
+			/**
+			 * @brief Enable or disable indexing the document for searches.
+			 *
+			 * Disabling indexing also deletes any index saved for the file.
+			*/
+			void set_search_index_enabled(bool enabled);
+			
+			/**
+			 * @brief Get the search index of the document (NULL if not enabled).
+			*/
+			std::shared_ptr<NGramIndex> get_search_index() const;
+			
 			/* Public for use by unit tests. */
 			static std::vector<DocumentCtrl::Region*> compute_regions(SharedDocumentPointer doc, BitOffset real_offset_base, BitOffset virt_offset_base, BitOffset length, InlineCommentMode inline_comment_mode);
 			
@@ -193,6 +212,8 @@ namespace REHex
 			
 			bool auto_reload;
 			
+			std::shared_ptr<NGramIndex> search_index;
+		
 		DECLARE_EVENT_TABLE()
 	};
 }
@@ -0,0 +1,576 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <tuple>
+#include <wx/dcbuffer.h>
+#include <wx/numformatter.h>
+#include <wx/settings.h>
+#include <wx/sizer.h>
+
+#include "App.hpp"
+#include "util.hpp"
+#include "ValuePlotPanel.hpp"
+
+/* Furthest zoom in, in samples per pixel column. */
+static const double MIN_SAMPLES_PER_COLUMN = 1.0 / 32.0;
+
+static REHex::ToolPanel *ValuePlotPanel_factory(wxWindow *parent, REHex::SharedDocumentPointer &document, REHex::DocumentCtrl *document_ctrl)
+{
+	return new REHex::ValuePlotPanel(parent, document, document_ctrl);
+}
+
+static REHex::ToolPanelRegistration tpr("ValuePlotPanel", "Value plot", REHex::ToolPanel::TPS_WIDE, &ValuePlotPanel_factory);
+
+enum {
+	ID_RANGE_CHOICE = 1,
+	ID_TYPE_CHOICE,
+	ID_STRIDE,
+	ID_REFRESH_TIMER,
+};
+
+BEGIN_EVENT_TABLE(REHex::ValuePlotPanel, wxPanel)
+	EVT_COMMAND(ID_RANGE_CHOICE, EV_SELECTION_CHANGED, REHex::ValuePlotPanel::OnRangeChanged)
+	EVT_CHOICE(ID_TYPE_CHOICE, REHex::ValuePlotPanel::OnTypeChanged)
+	EVT_SPINCTRL(ID_STRIDE, REHex::ValuePlotPanel::OnStrideChanged)
+	
+	EVT_TIMER(ID_REFRESH_TIMER, REHex::ValuePlotPanel::OnRefreshTimer)
+END_EVENT_TABLE()
+
+REHex::ValuePlotPanel::ValuePlotPanel(wxWindow *parent, SharedDocumentPointer &document, DocumentCtrl *document_ctrl):
+	ToolPanel(parent),
+	document(document),
+	document_ctrl(document_ctrl),
+	refresh_timer(this, ID_REFRESH_TIMER),
+	view_first(0.0),
+	view_spc(1.0),
+	wheel_accumulator(0),
+	panning(false),
+	pan_last_x(0)
+{
+	const int MARGIN = 4;
+	
+	range_choice = new RangeChoiceLinear(this, ID_RANGE_CHOICE, document, document_ctrl);
+	
+	type_choice = new wxChoice(this, ID_TYPE_CHOICE);
+	
+	for(int i = 0; i < ValuePlotPyramid::VT_COUNT; ++i)
+	{
+		type_choice->Append(ValuePlotPyramid::type_name((ValuePlotPyramid::ValueType)(i)));
+	}
+	
+	type_choice->SetSelection(ValuePlotPyramid::VT_S16LE);
+	
+	stride_ctrl = new wxSpinCtrl(this, ID_STRIDE, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 1, 65536, 2);
+	stride_ctrl->SetToolTip("Distance in bytes from the start of one value to the next");
+	
+	wxBoxSizer *controls_sizer = new wxBoxSizer(wxHORIZONTAL);
+	controls_sizer->Add(new wxStaticText(this, wxID_ANY, "Range:"), 0, wxALIGN_CENTER_VERTICAL);
+	controls_sizer->Add(range_choice, 0, (wxLEFT | wxALIGN_CENTER_VERTICAL), MARGIN);
+	controls_sizer->Add(new wxStaticText(this, wxID_ANY, "Type:"), 0, (wxLEFT | wxALIGN_CENTER_VERTICAL), MARGIN);
+	controls_sizer->Add(type_choice, 0, (wxLEFT | wxALIGN_CENTER_VERTICAL), MARGIN);
+	controls_sizer->Add(new wxStaticText(this, wxID_ANY, "Stride:"), 0, (wxLEFT | wxALIGN_CENTER_VERTICAL), MARGIN);
+	controls_sizer->Add(stride_ctrl, 0, (wxLEFT | wxALIGN_CENTER_VERTICAL), MARGIN);
+	
+	status_text = new wxStaticText(this, wxID_ANY, "");
+	
+	plot = new wxPanel(this, wxID_ANY, wxDefaultPosition, wxSize(-1, 100), wxFULL_REPAINT_ON_RESIZE);
+	plot->SetBackgroundStyle(wxBG_STYLE_PAINT);
+	
+	plot->Bind(wxEVT_PAINT, &REHex::ValuePlotPanel::OnPlotPaint, this);
+	plot->Bind(wxEVT_SIZE, &REHex::ValuePlotPanel::OnPlotSize, this);
+	plot->Bind(wxEVT_MOUSEWHEEL, &REHex::ValuePlotPanel::OnPlotWheel, this);
+	plot->Bind(wxEVT_LEFT_DOWN, &REHex::ValuePlotPanel::OnPlotLeftDown, this);
+	plot->Bind(wxEVT_LEFT_UP, &REHex::ValuePlotPanel::OnPlotLeftUp, this);
+	plot->Bind(wxEVT_LEFT_DCLICK, &REHex::ValuePlotPanel::OnPlotLeftDClick, this);
+	plot->Bind(wxEVT_MOTION, &REHex::ValuePlotPanel::OnPlotMotion, this);
+	plot->Bind(wxEVT_MOUSE_CAPTURE_LOST, &REHex::ValuePlotPanel::OnPlotCaptureLost, this);
+	
+	wxBoxSizer *sizer = new wxBoxSizer(wxVERTICAL);
+	sizer->Add(controls_sizer, 0, (wxLEFT | wxRIGHT | wxTOP), MARGIN);
+	sizer->Add(status_text, 0, (wxEXPAND | wxLEFT | wxRIGHT | wxTOP), MARGIN);
+	sizer->Add(plot, 1, (wxEXPAND | wxALL), MARGIN);
+	SetSizerAndFit(sizer);
+	
+	this->document.auto_cleanup_bind(DATA_ERASE,     &REHex::ValuePlotPanel::OnDataErase,     this);
+	this->document.auto_cleanup_bind(DATA_INSERT,    &REHex::ValuePlotPanel::OnDataInsert,    this);
+	this->document.auto_cleanup_bind(DATA_OVERWRITE, &REHex::ValuePlotPanel::OnDataOverwrite, this);
+	
+	reset_pyramid();
+}
+
+REHex::ValuePlotPanel::~ValuePlotPanel()
+{
+	refresh_timer.Stop();
+}
+
+std::string REHex::ValuePlotPanel::name() const
+{
+	return "ValuePlotPanel";
+}
+
+void REHex::ValuePlotPanel::save_state(wxConfig *config) const
+{
+	config->Write("type", wxString(ValuePlotPyramid::type_name((ValuePlotPyramid::ValueType)(type_choice->GetSelection()))));
+	config->Write("stride", (long)(stride_ctrl->GetValue()));
+}
+
+void REHex::ValuePlotPanel::load_state(wxConfig *config)
+{
+	wxString type = config->Read("type", "");
+	
+	for(int i = 0; i < ValuePlotPyramid::VT_COUNT; ++i)
+	{
+		if(type == ValuePlotPyramid::type_name((ValuePlotPyramid::ValueType)(i)))
+		{
+			type_choice->SetSelection(i);
+		}
+	}
+	
+	stride_ctrl->SetValue(config->Read("stride", (long)(stride_ctrl->GetValue())));
+	
+	reset_pyramid();
+}
+
+wxSize REHex::ValuePlotPanel::DoGetBestClientSize() const
+{
+	return wxSize(-1, 200);
+}
+
+void REHex::ValuePlotPanel::update()
+{
+	if(!is_visible)
+	{
+		/* There is no sense in updating this if we are not visible */
+		return;
+	}
+	
+	plot->Refresh();
+}
+
+void REHex::ValuePlotPanel::reset_pyramid()
+{
+	BitOffset range_offset, range_length;
+	std::tie(range_offset, range_length) = range_choice->get_range();
+	
+	assert(range_offset.byte_aligned());
+	assert(range_length.byte_aligned());
+	
+	ValuePlotPyramid::ValueType type = (ValuePlotPyramid::ValueType)(type_choice->GetSelection());
+	off_t type_size = ValuePlotPyramid::type_size(type);
+	off_t stride = stride_ctrl->GetValue();
+	
+	off_t num_samples = range_length.byte() >= type_size
+		? (((range_length.byte() - type_size) / stride) + 1)
+		: 0;
+	
+	pyramid.reset(new ValuePlotPyramid(document, range_offset.byte(), stride, num_samples, type));
+	columns.clear();
+	
+	reset_view();
+	
+	status_text->SetLabel("Building plot...");
+	refresh_timer.Start(250, wxTIMER_CONTINUOUS);
+	
+	update();
+}
+
+void REHex::ValuePlotPanel::reset_view()
+{
+	int width = std::max(plot->GetClientSize().GetWidth(), 1);
+	
+	view_first = 0.0;
+	view_spc = (double)(pyramid->get_num_samples()) / (double)(width);
+	
+	clamp_view();
+}
+
+void REHex::ValuePlotPanel::clamp_view()
+{
+	int width = std::max(plot->GetClientSize().GetWidth(), 1);
+	double num_samples = pyramid->get_num_samples();
+	
+	double max_spc = std::max((num_samples / (double)(width)), MIN_SAMPLES_PER_COLUMN);
+	view_spc = std::max(view_spc, MIN_SAMPLES_PER_COLUMN);
+	view_spc = std::min(view_spc, max_spc);
+	
+	view_first = std::min(view_first, (num_samples - ((double)(width) * view_spc)));
+	view_first = std::max(view_first, 0.0);
+}
+
+void REHex::ValuePlotPanel::zoom_adj(int steps, int about_x)
+{
+	/* Keep the sample under about_x in the same place. */
+	double about_sample = view_first + ((double)(about_x) * view_spc);
+	
+	view_spc /= pow(2.0, steps);
+	clamp_view();
+	
+	view_first = about_sample - ((double)(about_x) * view_spc);
+	clamp_view();
+	
+	plot->Refresh();
+}
+
+void REHex::ValuePlotPanel::update_columns(int width)
+{
+	columns.clear();
+	
+	if(!pyramid->is_complete() || width <= 0)
+	{
+		return;
+	}
+	
+	columns.resize(width);
+	
+	if(view_spc >= (double)(ValuePlotPyramid::BASE_BLOCK * 2))
+	{
+		/* Every column is summarised from the same level of the pyramid, so they are
+		 * rounded to the same block boundaries and don't overlap.
+		*/
+		size_t level = pyramid->level_for((off_t)(view_spc));
+		
+		for(int x = 0; x < width; ++x)
+		{
+			off_t begin = (off_t)(view_first + ((double)(x) * view_spc));
+			off_t end = (off_t)(view_first + ((double)(x + 1) * view_spc));
+			
+			columns[x] = pyramid->summarise(begin, (end - begin), level);
+		}
+	}
+	else{
+		/* Zoomed in past the bottom of the pyramid, there are few enough samples on
+		 * screen to read them directly.
+		*/
+		
+		off_t first = (off_t)(view_first);
+		off_t last = (off_t)(view_first + ((double)(width) * view_spc));
+		
+		std::vector<double> samples;
+		
+		try {
+			samples = pyramid->read_samples(first, ((last - first) + 1));
+		}
+		catch(const std::exception &e)
+		{
+			wxGetApp().printf_error("Data read error in REHex::ValuePlotPanel::update_columns: %s\n", e.what());
+		}
+		
+		for(int x = 0; x < width; ++x)
+		{
+			off_t begin = (off_t)(view_first + ((double)(x) * view_spc));
+			off_t end = std::max((off_t)(view_first + ((double)(x + 1) * view_spc)), (begin + 1));
+			
+			for(off_t i = begin; i < end && (size_t)(i - first) < samples.size(); ++i)
+			{
+				columns[x].add(samples[i - first]);
+			}
+		}
+	}
+}
+
+off_t REHex::ValuePlotPanel::sample_at(int x) const
+{
+	return (off_t)(view_first + ((double)(x) * view_spc));
+}
+
+void REHex::ValuePlotPanel::OnRangeChanged(wxCommandEvent &event)
+{
+	reset_pyramid();
+}
+
+void REHex::ValuePlotPanel::OnTypeChanged(wxCommandEvent &event)
+{
+	ValuePlotPyramid::ValueType type = (ValuePlotPyramid::ValueType)(type_choice->GetSelection());
+	off_t type_size = ValuePlotPyramid::type_size(type);
+	
+	if(stride_ctrl->GetValue() < type_size)
+	{
+		stride_ctrl->SetValue(type_size);
+	}
+	
+	reset_pyramid();
+}
+
+void REHex::ValuePlotPanel::OnStrideChanged(wxSpinEvent &event)
+{
+	reset_pyramid();
+}
+
+void REHex::ValuePlotPanel::OnRefreshTimer(wxTimerEvent &event)
+{
+	if(pyramid->is_complete())
+	{
+		refresh_timer.Stop();
+		
+		status_text->SetLabel(wxNumberFormatter::ToString((long)(pyramid->get_num_samples())) + " values");
+		update();
+	}
+	else{
+		int percent = (int)(pyramid->get_progress() * 100.0);
+		status_text->SetLabel("Building plot (" + std::to_string(percent) + "%)...");
+	}
+}
+
+void REHex::ValuePlotPanel::OnPlotPaint(wxPaintEvent &event)
+{
+	wxAutoBufferedPaintDC dc(plot);
+	
+	wxSize size = plot->GetClientSize();
+	
+	dc.SetBackground(wxBrush(wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOW)));
+	dc.Clear();
+	
+	dc.SetFont(GetFont());
+	dc.SetTextForeground(wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOWTEXT));
+	
+	update_columns(size.GetWidth());
+	
+	double y_min = INFINITY, y_max = -INFINITY;
+	
+	for(auto c = columns.begin(); c != columns.end(); ++c)
+	{
+		if(c->count > 0)
+		{
+			y_min = std::min(y_min, c->min);
+			y_max = std::max(y_max, c->max);
+		}
+	}
+	
+	if(y_min > y_max)
+	{
+		/* Still building, or no values in the range. */
+		return;
+	}
+	
+	if(y_min == y_max)
+	{
+		y_min -= 1.0;
+		y_max += 1.0;
+	}
+	
+	int text_height = dc.GetCharHeight();
+	
+	int top = text_height / 2;
+	int bottom = size.GetHeight() - (text_height / 2) - 1;
+	
+	auto value_y = [&](double value)
+	{
+		return bottom - (int)(((value - y_min) / (y_max - y_min)) * (double)(bottom - top));
+	};
+	
+	/* Range of the samples under each column... */
+	
+	dc.SetPen(wxPen(wxSystemSettings::GetColour(wxSYS_COLOUR_HIGHLIGHT)));
+	
+	for(int x = 0; x < (int)(columns.size()); ++x)
+	{
+		if(columns[x].count > 0)
+		{
+			dc.DrawLine(x, value_y(columns[x].max), x, (value_y(columns[x].min) + 1));
+		}
+	}
+	
+	/* ...and the mean, as a line broken wherever there are no samples. */
+	
+	dc.SetPen(wxPen(wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOWTEXT)));
+	
+	std::vector<wxPoint> points;
+	
+	auto draw_points = [&]()
+	{
+		if(points.size() == 1)
+		{
+			dc.DrawPoint(points[0]);
+		}
+		else if(points.size() > 1)
+		{
+			dc.DrawLines((int)(points.size()), points.data());
+		}
+		
+		points.clear();
+	};
+	
+	for(int x = 0; x < (int)(columns.size()); ++x)
+	{
+		if(columns[x].count > 0)
+		{
+			points.push_back(wxPoint(x, value_y(columns[x].mean())));
+		}
+		else{
+			draw_points();
+		}
+	}
+	
+	draw_points();
+	
+	dc.DrawText(wxString::Format("%g", y_max), 2, 0);
+	dc.DrawText(wxString::Format("%g", y_min), 2, (size.GetHeight() - text_height));
+}
+
+void REHex::ValuePlotPanel::OnPlotSize(wxSizeEvent &event)
+{
+	clamp_view();
+	plot->Refresh();
+	
+	event.Skip();
+}
+
+void REHex::ValuePlotPanel::OnPlotWheel(wxMouseEvent &event)
+{
+	if(event.GetWheelAxis() != wxMOUSE_WHEEL_VERTICAL)
+	{
+		return;
+	}
+	
+	int delta = event.GetWheelDelta();
+	
+	wheel_accumulator += event.GetWheelRotation();
+	
+	if(wheel_accumulator >= delta || wheel_accumulator <= -delta)
+	{
+		zoom_adj((wheel_accumulator / delta), event.GetX());
+		wheel_accumulator %= delta;
+	}
+}
+
+void REHex::ValuePlotPanel::OnPlotLeftDown(wxMouseEvent &event)
+{
+	panning = true;
+	pan_last_x = event.GetX();
+	
+	plot->CaptureMouse();
+	
+	event.Skip();
+}
+
+void REHex::ValuePlotPanel::OnPlotLeftUp(wxMouseEvent &event)
+{
+	if(panning)
+	{
+		panning = false;
+		
+		if(plot->HasCapture())
+		{
+			plot->ReleaseMouse();
+		}
+	}
+	
+	event.Skip();
+}
+
+void REHex::ValuePlotPanel::OnPlotLeftDClick(wxMouseEvent &event)
+{
+	off_t sample = sample_at(event.GetX());
+	
+	if(sample >= 0 && sample < pyramid->get_num_samples())
+	{
+		off_t offset = pyramid->get_offset() + (sample * pyramid->get_stride());
+		document->set_cursor_position(BitOffset(offset, 0));
+	}
+}
+
+void REHex::ValuePlotPanel::OnPlotMotion(wxMouseEvent &event)
+{
+	int x = event.GetX();
+	
+	if(panning && event.Dragging())
+	{
+		view_first += (double)(pan_last_x - x) * view_spc;
+		clamp_view();
+		
+		pan_last_x = x;
+		plot->Refresh();
+		
+		return;
+	}
+	
+	if(x >= 0 && x < (int)(columns.size()) && columns[x].count > 0)
+	{
+		off_t sample = sample_at(x);
+		off_t offset = pyramid->get_offset() + (sample * pyramid->get_stride());
+		
+		const ValuePlotPyramid::Summary &column = columns[x];
+		
+		std::string offset_s = format_offset(offset, document_ctrl->get_offset_display_base(), document->buffer_length());
+		
+		if(column.count == 1)
+		{
+			status_text->SetLabel(wxString::Format("Value %s at offset %s: %g",
+				wxNumberFormatter::ToString((long)(sample)), wxString(offset_s), column.min));
+		}
+		else{
+			status_text->SetLabel(wxString::Format("Values from %s at offset %s: min %g, max %g, mean %g",
+				wxNumberFormatter::ToString((long)(sample)), wxString(offset_s), column.min, column.max, column.mean()));
+		}
+	}
+	
+	event.Skip();
+}
+
+void REHex::ValuePlotPanel::OnPlotCaptureLost(wxMouseCaptureLostEvent &event)
+{
+	panning = false;
+}
+
+void REHex::ValuePlotPanel::OnDataErase(OffsetLengthEvent &event)
+{
+	BitOffset range_offset, range_length;
+	std::tie(range_offset, range_length) = range_choice->get_range();
+	
+	if(range_length.byte() > 0 && event.offset < (range_offset.byte() + range_length.byte()))
+	{
+		reset_pyramid();
+	}
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::ValuePlotPanel::OnDataInsert(OffsetLengthEvent &event)
+{
+	BitOffset range_offset, range_length;
+	std::tie(range_offset, range_length) = range_choice->get_range();
+	
+	if(range_length.byte() > 0 && event.offset < (range_offset.byte() + range_length.byte()))
+	{
+		reset_pyramid();
+	}
+	
+	/* Continue propogation. */
+	event.Skip();
+}
+
+void REHex::ValuePlotPanel::OnDataOverwrite(OffsetLengthEvent &event)
+{
+	BitOffset range_offset, range_length;
+	std::tie(range_offset, range_length) = range_choice->get_range();
+	
+	if(range_length.byte() > 0
+		&& event.offset < (range_offset.byte() + range_length.byte())
+		&& (event.offset + event.length) > range_offset.byte())
+	{
+		reset_pyramid();
+	}
+	
+	/* Continue propogation. */
+	event.Skip();
+}
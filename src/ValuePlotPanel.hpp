@@ -0,0 +1,116 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_VALUEPLOTPANEL_HPP
+#define REHEX_VALUEPLOTPANEL_HPP
+
+#include <memory>
+#include <vector>
+#include <wx/choice.h>
+#include <wx/panel.h>
+#include <wx/spinctrl.h>
+#include <wx/stattext.h>
+#include <wx/timer.h>
+
+#include "DocumentCtrl.hpp"
+#include "Events.hpp"
+#include "RangeChoiceLinear.hpp"
+#include "SafeWindowPointer.hpp"
+#include "SharedDocumentPointer.hpp"
+#include "ToolPanel.hpp"
+#include "ValuePlotPyramid.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Tool panel which plots a range of the file as a series of typed values.
+	 *
+	 * Each pixel column of the plot shows the range (min to max) and mean of the samples
+	 * under it, looked up from a ValuePlotPyramid so zooming and panning cost the same
+	 * however many samples are in the series.
+	*/
+	class ValuePlotPanel: public ToolPanel
+	{
+		public:
+			ValuePlotPanel(wxWindow *parent, SharedDocumentPointer &document, DocumentCtrl *document_ctrl);
+			~ValuePlotPanel();
+			
+			virtual std::string name() const override;
+			
+			virtual void save_state(wxConfig *config) const override;
+			virtual void load_state(wxConfig *config) override;
+			virtual void update() override;
+			
+			virtual wxSize DoGetBestClientSize() const override;
+		
+		private:
+			SharedDocumentPointer document;
+			SafeWindowPointer<DocumentCtrl> document_ctrl;
+			
+			RangeChoiceLinear *range_choice;
+			wxChoice *type_choice;
+			wxSpinCtrl *stride_ctrl;
+			wxStaticText *status_text;
+			wxPanel *plot;
+			wxTimer refresh_timer;
+			
+			std::unique_ptr<ValuePlotPyramid> pyramid;
+			
+			/* Summary of the samples under each pixel column, from the last redraw. */
+			std::vector<ValuePlotPyramid::Summary> columns;
+			
+			/* Sample at the left edge of the plot and number of samples per pixel column,
+			 * which is less than one when zoomed in far enough to see each sample.
+			*/
+			double view_first;
+			double view_spc;
+			
+			int wheel_accumulator;
+			bool panning;
+			int pan_last_x;
+			
+			void reset_pyramid();
+			void reset_view();
+			void clamp_view();
+			void zoom_adj(int steps, int about_x);
+			
+			void update_columns(int width);
+			off_t sample_at(int x) const;
+			
+			void OnRangeChanged(wxCommandEvent &event);
+			void OnTypeChanged(wxCommandEvent &event);
+			void OnStrideChanged(wxSpinEvent &event);
+			void OnRefreshTimer(wxTimerEvent &event);
+			
+			void OnPlotPaint(wxPaintEvent &event);
+			void OnPlotSize(wxSizeEvent &event);
+			void OnPlotWheel(wxMouseEvent &event);
+			void OnPlotLeftDown(wxMouseEvent &event);
+			void OnPlotLeftUp(wxMouseEvent &event);
+			void OnPlotLeftDClick(wxMouseEvent &event);
+			void OnPlotMotion(wxMouseEvent &event);
+			void OnPlotCaptureLost(wxMouseCaptureLostEvent &event);
+			
+			void OnDataErase(OffsetLengthEvent &event);
+			void OnDataInsert(OffsetLengthEvent &event);
+			void OnDataOverwrite(OffsetLengthEvent &event);
+		
+		DECLARE_EVENT_TABLE()
+	};
+}
+
+#endif /* !REHEX_VALUEPLOTPANEL_HPP */
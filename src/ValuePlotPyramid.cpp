@@ -0,0 +1,458 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <limits>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "App.hpp"
+#include "endian_conv.hpp"
+#include "ValuePlotPyramid.hpp"
+
+const off_t REHex::ValuePlotPyramid::BASE_BLOCK;
+const size_t REHex::ValuePlotPyramid::CHUNK_BLOCKS;
+
+/* Maximum number of bytes to read from the document at once. */
+static const off_t READ_WINDOW_SIZE = 4 * 1024 * 1024;
+
+REHex::ValuePlotPyramid::Summary::Summary():
+	min(std::numeric_limits<double>::infinity()),
+	max(-std::numeric_limits<double>::infinity()),
+	sum(0.0),
+	count(0) {}
+
+void REHex::ValuePlotPyramid::Summary::add(double value)
+{
+	if(isnan(value))
+	{
+		return;
+	}
+	
+	min = std::min(min, value);
+	max = std::max(max, value);
+	sum += value;
+	++count;
+}
+
+void REHex::ValuePlotPyramid::Summary::add(const Summary &other)
+{
+	min = std::min(min, other.min);
+	max = std::max(max, other.max);
+	sum += other.sum;
+	count += other.count;
+}
+
+double REHex::ValuePlotPyramid::Summary::mean() const
+{
+	return count > 0 ? (sum / (double)(count)) : std::numeric_limits<double>::quiet_NaN();
+}
+
+REHex::ValuePlotPyramid::ValuePlotPyramid(SharedDocumentPointer &document, off_t offset, off_t stride, off_t num_samples, ValueType type):
+	document(document),
+	offset(offset),
+	stride(stride),
+	num_samples(num_samples),
+	type(type),
+	num_chunks(0),
+	next_chunk(0),
+	chunks_done(0),
+	complete(false)
+{
+	assert(stride > 0);
+	assert(num_samples >= 0);
+	assert(type >= 0 && type < VT_COUNT);
+	
+	/* All levels are allocated up front so the workers can fill in their blocks without
+	 * any locking.
+	*/
+	
+	size_t level_size = (num_samples + BASE_BLOCK - 1) / BASE_BLOCK;
+	
+	while(level_size > 0)
+	{
+		levels.emplace_back(level_size);
+		
+		if(level_size == 1)
+		{
+			break;
+		}
+		
+		level_size = (level_size + 1) / 2;
+	}
+	
+	if(levels.empty())
+	{
+		complete = true;
+		return;
+	}
+	
+	num_chunks = (levels[0].size() + CHUNK_BLOCKS - 1) / CHUNK_BLOCKS;
+	
+	task.reset(new ThreadPool::TaskHandle(wxGetApp().thread_pool->queue_task([this]()
+	{
+		return process_next_chunk();
+	}, -1)));
+}
+
+REHex::ValuePlotPyramid::~ValuePlotPyramid()
+{
+	if(task)
+	{
+		task->finish();
+		task->join();
+	}
+}
+
+off_t REHex::ValuePlotPyramid::type_size(ValueType type)
+{
+	switch(type)
+	{
+		case VT_U8:
+		case VT_S8:
+			return 1;
+		
+		case VT_U16LE:
+		case VT_U16BE:
+		case VT_S16LE:
+		case VT_S16BE:
+			return 2;
+		
+		case VT_U32LE:
+		case VT_U32BE:
+		case VT_S32LE:
+		case VT_S32BE:
+		case VT_F32LE:
+		case VT_F32BE:
+			return 4;
+		
+		case VT_U64LE:
+		case VT_U64BE:
+		case VT_S64LE:
+		case VT_S64BE:
+		case VT_F64LE:
+		case VT_F64BE:
+			return 8;
+		
+		default:
+			abort();
+	}
+}
+
+const char *REHex::ValuePlotPyramid::type_name(ValueType type)
+{
+	switch(type)
+	{
+		case VT_U8:    return "u8";
+		case VT_S8:    return "s8";
+		case VT_U16LE: return "le u16";
+		case VT_U16BE: return "be u16";
+		case VT_S16LE: return "le s16";
+		case VT_S16BE: return "be s16";
+		case VT_U32LE: return "le u32";
+		case VT_U32BE: return "be u32";
+		case VT_S32LE: return "le s32";
+		case VT_S32BE: return "be s32";
+		case VT_U64LE: return "le u64";
+		case VT_U64BE: return "be u64";
+		case VT_S64LE: return "le s64";
+		case VT_S64BE: return "be s64";
+		case VT_F32LE: return "le f32";
+		case VT_F32BE: return "be f32";
+		case VT_F64LE: return "le f64";
+		case VT_F64BE: return "be f64";
+		
+		default:
+			abort();
+	}
+}
+
+double REHex::ValuePlotPyramid::decode(ValueType type, const unsigned char *data)
+{
+	switch(type)
+	{
+		case VT_U8:    return *data;
+		case VT_S8:    return (int8_t)(*data);
+		case VT_U16LE: return leXXXtoh_p<uint16_t>(data);
+		case VT_U16BE: return beXXXtoh_p<uint16_t>(data);
+		case VT_S16LE: return leXXXtoh_p<int16_t>(data);
+		case VT_S16BE: return beXXXtoh_p<int16_t>(data);
+		case VT_U32LE: return leXXXtoh_p<uint32_t>(data);
+		case VT_U32BE: return beXXXtoh_p<uint32_t>(data);
+		case VT_S32LE: return leXXXtoh_p<int32_t>(data);
+		case VT_S32BE: return beXXXtoh_p<int32_t>(data);
+		case VT_U64LE: return leXXXtoh_p<uint64_t>(data);
+		case VT_U64BE: return beXXXtoh_p<uint64_t>(data);
+		case VT_S64LE: return leXXXtoh_p<int64_t>(data);
+		case VT_S64BE: return beXXXtoh_p<int64_t>(data);
+		case VT_F32LE: return leXXXtoh_p<float>(data);
+		case VT_F32BE: return beXXXtoh_p<float>(data);
+		case VT_F64LE: return leXXXtoh_p<double>(data);
+		case VT_F64BE: return beXXXtoh_p<double>(data);
+		
+		default:
+			abort();
+	}
+}
+
+off_t REHex::ValuePlotPyramid::get_offset() const
+{
+	return offset;
+}
+
+off_t REHex::ValuePlotPyramid::get_stride() const
+{
+	return stride;
+}
+
+off_t REHex::ValuePlotPyramid::get_num_samples() const
+{
+	return num_samples;
+}
+
+REHex::ValuePlotPyramid::ValueType REHex::ValuePlotPyramid::get_type() const
+{
+	return type;
+}
+
+bool REHex::ValuePlotPyramid::is_complete() const
+{
+	return complete;
+}
+
+double REHex::ValuePlotPyramid::get_progress() const
+{
+	if(complete)
+	{
+		return 1.0;
+	}
+	
+	return (double)(chunks_done) / (double)(num_chunks);
+}
+
+void REHex::ValuePlotPyramid::wait_for_completion()
+{
+	if(task)
+	{
+		task->join();
+		task.reset(NULL);
+	}
+}
+
+std::vector<double> REHex::ValuePlotPyramid::read_samples(off_t first, off_t count)
+{
+	first = std::max<off_t>(first, 0);
+	count = std::min(count, (num_samples - first));
+	
+	std::vector<double> samples;
+	if(count <= 0)
+	{
+		return samples;
+	}
+	
+	samples.reserve(count);
+	
+	off_t value_size = type_size(type);
+	off_t window_samples = std::max<off_t>((READ_WINDOW_SIZE / stride), 1);
+	
+	while(count > 0)
+	{
+		off_t n = std::min(count, window_samples);
+		std::vector<unsigned char> data = document->read_data((offset + (first * stride)), (((n - 1) * stride) + value_size));
+		
+		for(off_t i = 0; i < n; ++i)
+		{
+			if((off_t)(data.size()) < ((i * stride) + value_size))
+			{
+				/* Document has been truncated. */
+				return samples;
+			}
+			
+			samples.push_back(decode(type, (data.data() + (i * stride))));
+		}
+		
+		first += n;
+		count -= n;
+	}
+	
+	return samples;
+}
+
+size_t REHex::ValuePlotPyramid::level_for(off_t count) const
+{
+	size_t level = 0;
+	
+	while((level + 1) < levels.size() && ((BASE_BLOCK << (level + 1)) * 2) <= count)
+	{
+		++level;
+	}
+	
+	return level;
+}
+
+REHex::ValuePlotPyramid::Summary REHex::ValuePlotPyramid::summarise(off_t first, off_t count, size_t level) const
+{
+	assert(complete);
+	
+	if(first < 0)
+	{
+		count += first;
+		first = 0;
+	}
+	
+	count = std::min(count, (num_samples - first));
+	
+	Summary summary;
+	if(count <= 0)
+	{
+		return summary;
+	}
+	
+	level = std::min(level, (levels.size() - 1));
+	
+	const std::vector<Summary> &blocks = levels[level];
+	off_t block_size = BASE_BLOCK << level;
+	
+	size_t begin = (first + (block_size / 2)) / block_size;
+	size_t end = (first + count) >= num_samples
+		? blocks.size()
+		: (((first + count) + (block_size / 2)) / block_size);
+	
+	for(size_t i = begin; i < end; ++i)
+	{
+		summary.add(blocks[i]);
+	}
+	
+	return summary;
+}
+
+REHex::ValuePlotPyramid::Summary REHex::ValuePlotPyramid::summarise(off_t first, off_t count) const
+{
+	off_t end = std::min((first + count), num_samples);
+	first = std::max<off_t>(first, 0);
+	
+	return summarise(first, (end - first), level_for(end - first));
+}
+
+REHex::ValuePlotPyramid::Summary REHex::ValuePlotPyramid::summarise_all() const
+{
+	assert(complete);
+	
+	if(levels.empty())
+	{
+		return Summary();
+	}
+	
+	return levels.back()[0];
+}
+
+bool REHex::ValuePlotPyramid::process_next_chunk()
+{
+	size_t chunk_idx = next_chunk.fetch_add(1);
+	if(chunk_idx >= num_chunks)
+	{
+		return true;
+	}
+	
+	try {
+		process_chunk(chunk_idx);
+	}
+	catch(const std::exception &e)
+	{
+		/* Document has probably been truncated under us, whoever is using the pyramid
+		 * will throw it away when they see the change.
+		*/
+		fprintf(stderr, "Exception in REHex::ValuePlotPyramid::process_chunk: %s\n", e.what());
+	}
+	
+	if(++chunks_done == num_chunks)
+	{
+		build_upper_levels();
+		complete = true;
+	}
+	
+	return false;
+}
+
+void REHex::ValuePlotPyramid::process_chunk(size_t chunk_idx)
+{
+	size_t block_begin = chunk_idx * CHUNK_BLOCKS;
+	size_t block_end = std::min((block_begin + CHUNK_BLOCKS), levels[0].size());
+	
+	off_t sample_begin = (off_t)(block_begin) * BASE_BLOCK;
+	off_t sample_end = std::min(((off_t)(block_end) * BASE_BLOCK), num_samples);
+	
+	std::vector<double> samples = read_samples(sample_begin, (sample_end - sample_begin));
+	
+	for(size_t i = 0; i < samples.size(); ++i)
+	{
+		levels[0][block_begin + (i / BASE_BLOCK)].add(samples[i]);
+	}
+	
+	/* CHUNK_BLOCKS is a power of two, so every block on the levels up to CHUNK_BLOCKS
+	 * times larger than the bottom is made up only of blocks from one chunk and can be
+	 * built here. The rest are built by build_upper_levels() once all chunks are done.
+	*/
+	
+	for(size_t level = 1; level < levels.size() && ((size_t)(1) << level) <= CHUNK_BLOCKS; ++level)
+	{
+		std::vector<Summary> &lower = levels[level - 1];
+		std::vector<Summary> &upper = levels[level];
+		
+		size_t begin = block_begin >> level;
+		size_t end = (block_end + ((size_t)(1) << level) - 1) >> level;
+		
+		for(size_t i = begin; i < end; ++i)
+		{
+			upper[i] = lower[i * 2];
+			
+			if(((i * 2) + 1) < lower.size())
+			{
+				upper[i].add(lower[(i * 2) + 1]);
+			}
+		}
+	}
+}
+
+void REHex::ValuePlotPyramid::build_upper_levels()
+{
+	for(size_t level = 1; level < levels.size(); ++level)
+	{
+		if(((size_t)(1) << level) <= CHUNK_BLOCKS)
+		{
+			continue;
+		}
+		
+		std::vector<Summary> &lower = levels[level - 1];
+		std::vector<Summary> &upper = levels[level];
+		
+		for(size_t i = 0; i < upper.size(); ++i)
+		{
+			upper[i] = lower[i * 2];
+			
+			if(((i * 2) + 1) < lower.size())
+			{
+				upper[i].add(lower[(i * 2) + 1]);
+			}
+		}
+	}
+}
@@ -0,0 +1,226 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef REHEX_VALUEPLOTPYRAMID_HPP
+#define REHEX_VALUEPLOTPYRAMID_HPP
+
+#include <atomic>
+#include <memory>
+#include <sys/types.h>
+#include <vector>
+
+#include "SharedDocumentPointer.hpp"
+#include "ThreadPool.hpp"
+
+namespace REHex
+{
+	/**
+	 * @brief Min/max/mean level of detail pyramid over a series of values in a Document.
+	 *
+	 * The series is read from num_samples values of the given type, each stride bytes
+	 * after the last. The bottom level of the pyramid summarises each BASE_BLOCK samples
+	 * and each level above summarises pairs of blocks from the one below, so a range of
+	 * any length can be summarised from a handful of blocks on the level whose block
+	 * size is nearest to it.
+	 *
+	 * The pyramid is built in chunks on the ThreadPool when it is created. It doesn't
+	 * follow changes to the document, a new pyramid must be created if the data is
+	 * modified.
+	*/
+	class ValuePlotPyramid
+	{
+		public:
+			enum ValueType
+			{
+				VT_U8 = 0,
+				VT_S8,
+				VT_U16LE,
+				VT_U16BE,
+				VT_S16LE,
+				VT_S16BE,
+				VT_U32LE,
+				VT_U32BE,
+				VT_S32LE,
+				VT_S32BE,
+				VT_U64LE,
+				VT_U64BE,
+				VT_S64LE,
+				VT_S64BE,
+				VT_F32LE,
+				VT_F32BE,
+				VT_F64LE,
+				VT_F64BE,
+				
+				VT_COUNT,
+			};
+			
+			/**
+			 * @brief Number of samples summarised by each block on the bottom level.
+			*/
+			static const off_t BASE_BLOCK = 128;
+			
+			/**
+			 * @brief Number of bottom level blocks built by each worker at a time.
+			 *
+			 * Must be a power of two.
+			*/
+			static const size_t CHUNK_BLOCKS = 2048;
+			
+			/**
+			 * @brief Summary of a range of samples.
+			 *
+			 * NaN values (from floating point types) are ignored, so count may be
+			 * less than the number of samples in the range.
+			*/
+			struct Summary
+			{
+				double min;
+				double max;
+				double sum;
+				off_t count;
+				
+				Summary();
+				
+				void add(double value);
+				void add(const Summary &other);
+				
+				double mean() const;
+			};
+			
+			/**
+			 * @brief Start building a pyramid over a range of a Document.
+			 *
+			 * @param document     Document to read samples from.
+			 * @param offset       Offset of the first sample.
+			 * @param stride       Distance in bytes from the start of one sample to the next.
+			 * @param num_samples  Number of samples in the series.
+			 * @param type         Type of the samples.
+			*/
+			ValuePlotPyramid(SharedDocumentPointer &document, off_t offset, off_t stride, off_t num_samples, ValueType type);
+			
+			~ValuePlotPyramid();
+			
+			ValuePlotPyramid(const ValuePlotPyramid&) = delete;
+			ValuePlotPyramid &operator=(const ValuePlotPyramid&) = delete;
+			
+			/**
+			 * @brief Get the size of a value of the given type in bytes.
+			*/
+			static off_t type_size(ValueType type);
+			
+			/**
+			 * @brief Get the display name of a type (e.g. "le u16").
+			*/
+			static const char *type_name(ValueType type);
+			
+			/**
+			 * @brief Decode a single value of the given type.
+			*/
+			static double decode(ValueType type, const unsigned char *data);
+			
+			off_t get_offset() const;
+			off_t get_stride() const;
+			off_t get_num_samples() const;
+			ValueType get_type() const;
+			
+			/**
+			 * @brief Check if the whole pyramid has been built.
+			*/
+			bool is_complete() const;
+			
+			/**
+			 * @brief Get the fraction of the pyramid built so far (0.0 - 1.0).
+			*/
+			double get_progress() const;
+			
+			/**
+			 * @brief Wait for the pyramid to be built.
+			 *
+			 * This is mostly intended for unit tests. This should not be used from the
+			 * application UI thread.
+			*/
+			void wait_for_completion();
+			
+			/**
+			 * @brief Read samples directly from the document.
+			 *
+			 * Returns the decoded values of up to count samples starting from sample
+			 * first, fewer if the document has been truncated. Intended for drawing
+			 * ranges too small to be worth looking up in the pyramid.
+			*/
+			std::vector<double> read_samples(off_t first, off_t count);
+			
+			/**
+			 * @brief Get the level to summarise ranges of the given length from.
+			 *
+			 * Returns the level whose block size is nearest to half of count, so any
+			 * range of that length is covered by between two and four of its blocks.
+			*/
+			size_t level_for(off_t count) const;
+			
+			/**
+			 * @brief Summarise a range of samples from the pyramid.
+			 *
+			 * The range is summarised from the blocks on the given level, with its ends
+			 * rounded to the nearest block boundary. Consecutive ranges summarised from
+			 * the same level (like the columns of a plot) are therefore rounded to the
+			 * same boundaries and neither overlap nor leave gaps. The cost depends only
+			 * on the number of blocks used, not on the length of the range.
+			 *
+			 * Only valid once is_complete() returns true.
+			*/
+			Summary summarise(off_t first, off_t count, size_t level) const;
+			
+			/**
+			 * @brief Summarise a range of samples from the level given by level_for().
+			*/
+			Summary summarise(off_t first, off_t count) const;
+			
+			/**
+			 * @brief Get the summary of the whole series.
+			 *
+			 * Only valid once is_complete() returns true.
+			*/
+			Summary summarise_all() const;
+		
+		private:
+			SharedDocumentPointer document;
+			const off_t offset;
+			const off_t stride;
+			const off_t num_samples;
+			const ValueType type;
+			
+			/* levels[0] has one Summary per BASE_BLOCK samples, levels[n] has one per
+			 * (BASE_BLOCK << n) samples. The last block on each level may be partial.
+			*/
+			std::vector< std::vector<Summary> > levels;
+			
+			size_t num_chunks;
+			
+			std::atomic<size_t> next_chunk;
+			std::atomic<size_t> chunks_done;
+			std::atomic<bool> complete;
+			
+			std::unique_ptr<ThreadPool::TaskHandle> task;
+			
+			bool process_next_chunk();
+			void process_chunk(size_t chunk_idx);
+			void build_upper_levels();
+	};
+}
+
+#endif /* !REHEX_VALUEPLOTPYRAMID_HPP */
@@ -47,6 +47,15 @@
 wxDEFINE_EVENT(REHex::BACKING_FILE_DELETED, wxCommandEvent);
 wxDEFINE_EVENT(REHex::BACKING_FILE_MODIFIED, wxCommandEvent);
 
+const size_t REHex::Buffer::DEFAULT_DIRTY_MEMORY_BUDGET;
+
+std::atomic<size_t> REHex::Buffer::dirty_memory_budget(DEFAULT_DIRTY_MEMORY_BUDGET);
+std::atomic<size_t> REHex::Buffer::dirty_memory_used(0);
+std::atomic<bool> REHex::Buffer::swap_failed(false);
+
+/* Size of the chunks swapped out data is copied in when writing out the file. */
+static const off_t SWAP_COPY_CHUNK = 1048576; /* 1MiB */
+
 REHex::Buffer::Block *REHex::Buffer::_block_by_virt_offset(off_t virt_offset)
 {
 	if(virt_offset >= _length())
@@ -88,28 +97,32 @@ void REHex::Buffer::_load_block(Block *block)
 	{
 		if(block->virt_length > 0)
 		{
-			if(fseeko(fh, block->real_offset, SEEK_SET) != 0)
-			{
-				throw std::runtime_error(std::string("fseeko: ") + strerror(errno));
-			}
-			
-			block->grow(block->virt_length);
-			
-			if(fread(block->data.data(), block->virt_length, 1, fh) == 0)
-			{
-				if(feof(fh))
-				{
-					clearerr(fh);
-					throw std::runtime_error("Read error: unexpected end of file");
-				}
-				else{
-					throw std::runtime_error(std::string("Read error: ") + strerror(errno));
-				}
-			}
+			block->data.reset(block_pool->get(block->virt_length));
+			_read_file(block->real_offset, block->data.data(), block->virt_length);
 		}
 		
 		block->state = Block::CLEAN;
 	}
+	else if(block->state == Block::SWAPPED)
+	{
+		/* Page the modified data back in from the swap file. */
+		
+		block->data.reset(block_pool->get(block->virt_length));
+		block->swap_data->read(0, block->data.data(), block->virt_length);
+		
+		/* The space in the swap file can be reused unless a snapshot or fork has it. */
+		block->swap_data.reset();
+		
+		block->state = Block::DIRTY;
+		_dirty_bump(block);
+		
+		/* Make room for it by swapping out something else if necessary. */
+		_enforce_memory_budget(block);
+	}
+	else if(block->state == Block::DIRTY)
+	{
+		_dirty_bump(block);
+	}
 	
 	if(block->state == Block::CLEAN && block->virt_length > 0)
 	{
@@ -135,6 +148,122 @@ void REHex::Buffer::_load_block(Block *block)
 	}
 }
 
+static void read_fh(FILE *fh, off_t offset, unsigned char *dst, off_t length)
+{
+	if(fseeko(fh, offset, SEEK_SET) != 0)
+	{
+		throw std::runtime_error(std::string("fseeko: ") + strerror(errno));
+	}
+	
+	if(fread(dst, length, 1, fh) == 0)
+	{
+		if(feof(fh))
+		{
+			clearerr(fh);
+			throw std::runtime_error("Read error: unexpected end of file");
+		}
+		else{
+			throw std::runtime_error(std::string("Read error: ") + strerror(errno));
+		}
+	}
+}
+
+void REHex::Buffer::_read_file(off_t real_offset, unsigned char *dst, off_t length)
+{
+	if(extents.empty())
+	{
+		read_fh(fh, real_offset, dst, length);
+		return;
+	}
+	
+	/* Find the file containing real_offset and read from it and any subsequent files
+	 * until we have as much as was asked for.
+	*/
+	
+	auto extent = std::upper_bound(extents.begin(), extents.end(), real_offset,
+		[](off_t offset, const Extent &extent) { return offset < extent.offset; });
+	
+	assert(extent != extents.begin());
+	--extent;
+	
+	while(length > 0)
+	{
+		if(extent == extents.end())
+		{
+			throw std::runtime_error("Read error: unexpected end of file");
+		}
+		
+		off_t extent_rel_off = real_offset - extent->offset;
+		off_t to_read = std::min(length, (extent->length - extent_rel_off));
+		
+		read_fh(extent->fh, extent_rel_off, dst, to_read);
+		
+		real_offset += to_read;
+		dst         += to_read;
+		length      -= to_read;
+		
+		++extent;
+	}
+}
+
+/* Open each of the given files and add them to the extents list. */
+void REHex::Buffer::_open_extents(const std::vector<std::string> &filenames)
+{
+	off_t offset = 0;
+	
+	for(auto f = filenames.begin(); f != filenames.end(); ++f)
+	{
+		Extent extent;
+		extent.filename = *f;
+		
+		extent.fh = fopen(f->c_str(), "rb");
+		if(extent.fh == NULL)
+		{
+			int err = errno;
+			_close_extents();
+			throw std::runtime_error(std::string("Could not open file ") + *f + ": " + strerror(err));
+		}
+		
+		struct stat st;
+		if(fstat(fileno(extent.fh), &st) == 0 && !S_ISREG(st.st_mode) && !S_ISBLK(st.st_mode))
+		{
+			fclose(extent.fh);
+			_close_extents();
+			throw std::runtime_error(std::string("Could not open file ") + *f + ": Not a regular file");
+		}
+		
+		if(fseeko(extent.fh, 0, SEEK_END) != 0 || (extent.length = ftello(extent.fh)) == -1)
+		{
+			int err = errno;
+			fclose(extent.fh);
+			_close_extents();
+			throw std::runtime_error(std::string("Could not open file ") + *f + ": " + strerror(err));
+		}
+		
+		if(extent.length == 0)
+		{
+			/* Empty files don't contribute anything. */
+			fclose(extent.fh);
+			continue;
+		}
+		
+		extent.offset = offset;
+		offset += extent.length;
+		
+		extents.push_back(extent);
+	}
+}
+
+void REHex::Buffer::_close_extents()
+{
+	for(auto e = extents.begin(); e != extents.end(); ++e)
+	{
+		fclose(e->fh);
+	}
+	
+	extents.clear();
+}
+
 /* Ensure the given Block is at the head of last_accessed_blocks, removing it if it was already
  * inserted at a later point.
 */
@@ -175,6 +304,185 @@ void REHex::Buffer::_last_access_remove(Block *block)
 	}
 }
 
+/* Mark the given block as modified. */
+void REHex::Buffer::_mark_dirty(Block *block)
+{
+	block->state = Block::DIRTY;
+	block->swap_data.reset();
+	
+	_last_access_remove(block);
+	_dirty_bump(block);
+}
+
+/* Ensure the given DIRTY block is at the head of dirty_blocks and update the amount of memory
+ * it counts towards dirty_memory_used.
+ *
+ * Data shared with DIRTY blocks in other Buffers (i.e. forks) is only counted once.
+*/
+void REHex::Buffer::_dirty_bump(Block *block)
+{
+	assert(block->state == Block::DIRTY);
+	
+	auto map_it = dirty_blocks_map.find(block);
+	if(map_it != dirty_blocks_map.end())
+	{
+		if(map_it->second != dirty_blocks.begin())
+		{
+			dirty_blocks.splice(dirty_blocks.begin(), dirty_blocks, map_it->second);
+		}
+	}
+	else{
+		dirty_blocks.push_front(block);
+		dirty_blocks_map[block] = dirty_blocks.begin();
+	}
+	
+	const std::shared_ptr<DirtyRefs> &refs = block->data.get_dirty_refs();
+	
+	if(block->dirty_refs != refs)
+	{
+		_dirty_release(block);
+		
+		if(refs && refs->blocks++ == 0)
+		{
+			refs->size = block->data.size();
+			dirty_memory_used += refs->size;
+		}
+		
+		block->dirty_refs = refs;
+	}
+	else if(refs && refs->size != block->data.size())
+	{
+		/* Data has been resized in place, so nobody else is sharing it. */
+		
+		size_t size = block->data.size();
+		
+		if(size > refs->size)
+		{
+			dirty_memory_used += size - refs->size;
+		}
+		else{
+			dirty_memory_used -= refs->size - size;
+		}
+		
+		refs->size = size;
+	}
+}
+
+/* Stop the given block counting its data towards dirty_memory_used. */
+void REHex::Buffer::_dirty_release(Block *block)
+{
+	if(block->dirty_refs)
+	{
+		if(--(block->dirty_refs->blocks) == 0)
+		{
+			dirty_memory_used -= block->dirty_refs->size;
+		}
+		
+		block->dirty_refs.reset();
+	}
+}
+
+/* Remove the given block from dirty_blocks and stop counting it towards dirty_memory_used. */
+void REHex::Buffer::_dirty_remove(Block *block)
+{
+	auto map_it = dirty_blocks_map.find(block);
+	if(map_it != dirty_blocks_map.end())
+	{
+		dirty_blocks.erase(map_it->second);
+		dirty_blocks_map.erase(map_it);
+	}
+	
+	_dirty_release(block);
+}
+
+/* Write the data of a DIRTY block out to the swap file and unload it.
+ * Returns false if the swap file couldn't be written to, leaving the block in memory.
+*/
+bool REHex::Buffer::_swap_out(Block *block)
+{
+	assert(block->state == Block::DIRTY);
+	
+	if(block->virt_length > 0)
+	{
+		if(swap_failed)
+		{
+			return false;
+		}
+		
+		try {
+			if(!swap_file)
+			{
+				swap_file = std::make_shared<SwapFile>();
+			}
+			
+			const Block *cblock = block;
+			block->swap_data = swap_file->write(cblock->data.data(), block->virt_length);
+		}
+		catch(const std::exception &e)
+		{
+			/* Only report the first failure, rather than every time the budget is
+			 * exceeded from now on.
+			*/
+			if(!swap_failed.exchange(true))
+			{
+				wxGetApp().printf_error("Could not write to swap file, modified data will be kept in memory: %s\n", e.what());
+			}
+			
+			return false;
+		}
+		
+		block->state = Block::SWAPPED;
+	}
+	
+	_dirty_remove(block);
+	
+	block->data.clear();
+	
+	return true;
+}
+
+/* Swap out the least recently accessed DIRTY blocks, other than keep, until the total amount of
+ * dirty data in memory is within dirty_memory_budget.
+*/
+void REHex::Buffer::_enforce_memory_budget(const Block *keep)
+{
+	auto next = dirty_blocks.end();
+	
+	while(dirty_memory_used > dirty_memory_budget && next != dirty_blocks.begin())
+	{
+		auto victim = std::prev(next);
+		
+		/* Data still shared with a fork is counted by it too, so swapping it out
+		 * wouldn't free anything.
+		*/
+		if(*victim == keep || ((*victim)->dirty_refs && (*victim)->dirty_refs->blocks > 1))
+		{
+			next = victim;
+			continue;
+		}
+		
+		if(!_swap_out(*victim))
+		{
+			break;
+		}
+	}
+}
+
+void REHex::Buffer::set_dirty_memory_budget(size_t budget)
+{
+	dirty_memory_budget = budget;
+}
+
+size_t REHex::Buffer::get_dirty_memory_budget()
+{
+	return dirty_memory_budget;
+}
+
+size_t REHex::Buffer::get_dirty_memory_used()
+{
+	return dirty_memory_used;
+}
+
 /* Returns true if the given FILE handles refer to the same underlying file.
  * Falls back to comparing the filenames if we cannot identify the actual files.
 */
@@ -226,6 +534,10 @@ bool REHex::Buffer::_same_file(FILE *file1, const std::string &name1, FILE *file
 
 REHex::Buffer::Buffer():
 	fh(nullptr),
+	snapshot_source(std::make_shared<SnapshotSource>(this)),
+	fork_group(std::make_shared<ForkGroup>()),
+	block_pool(BlockPool::create(DEFAULT_BLOCK_SIZE, (MAX_CLEAN_BLOCKS + 1))),
+	file_generation(0),
 	_file_deleted(false),
 	_file_modified(false),
 	block_size(DEFAULT_BLOCK_SIZE)
@@ -233,15 +545,23 @@ REHex::Buffer::Buffer():
 	blocks.push_back(Block(0,0));
 	blocks.back().state = Block::CLEAN;
 	
+	fork_group->buffers.insert(this);
+	
 	timer.Bind(wxEVT_TIMER, &REHex::Buffer::OnTimerTick, this);
 }
 
 REHex::Buffer::Buffer(const std::string &filename, off_t block_size):
 	filename(filename),
+	snapshot_source(std::make_shared<SnapshotSource>(this)),
+	fork_group(std::make_shared<ForkGroup>()),
+	block_pool(BlockPool::create(block_size, (MAX_CLEAN_BLOCKS + 1))),
+	file_generation(0),
 	_file_deleted(false),
 	_file_modified(false),
 	block_size(block_size)
 {
+	fork_group->buffers.insert(this);
+	
 	timer.Bind(wxEVT_TIMER, &REHex::Buffer::OnTimerTick, this);
 	
 	fh = fopen(filename.c_str(), "rb");
@@ -260,13 +580,155 @@ REHex::Buffer::Buffer(const std::string &filename, off_t block_size):
 	reload();
 }
 
+REHex::Buffer::Buffer(const std::vector<std::string> &filenames, off_t block_size):
+	fh(NULL),
+	snapshot_source(std::make_shared<SnapshotSource>(this)),
+	fork_group(std::make_shared<ForkGroup>()),
+	block_pool(BlockPool::create(block_size, (MAX_CLEAN_BLOCKS + 1))),
+	file_generation(0),
+	_file_deleted(false),
+	_file_modified(false),
+	block_size(block_size)
+{
+	fork_group->buffers.insert(this);
+	
+	_open_extents(filenames);
+	
+	off_t total_length = extents.empty()
+		? 0
+		: extents.back().offset + extents.back().length;
+	
+	++file_generation;
+	
+	for(off_t offset = 0; offset < total_length; offset += block_size)
+	{
+		blocks.push_back(Block(offset, std::min((total_length - offset), (off_t)(block_size))));
+	}
+	
+	if(total_length == 0)
+	{
+		blocks.push_back(Block(0,0));
+	}
+	
+	/* The files are treated as read only and aren't monitored for changes, the timer is
+	 * only started once the Buffer has been written out to a new file.
+	*/
+	timer.Bind(wxEVT_TIMER, &REHex::Buffer::OnTimerTick, this);
+}
+
+REHex::Buffer::Buffer(Buffer *parent):
+	fh(NULL),
+	filename(parent->filename),
+	snapshot_source(std::make_shared<SnapshotSource>(this)),
+	fork_group(parent->fork_group),
+	block_pool(parent->block_pool),
+	file_generation(0),
+	block_size(parent->block_size)
+{
+	timer.Bind(wxEVT_TIMER, &REHex::Buffer::OnTimerTick, this);
+	
+	std::unique_lock<std::mutex> gl(fork_group->lock);
+	std::unique_lock<std::mutex> pl(parent->lock);
+	
+	if(parent->fh != NULL)
+	{
+		/* Open our own handle to the backing file so reads don't interfere with the
+		 * parent, making sure it is still the same file the parent has open.
+		*/
+		
+		fh = fopen(filename.c_str(), "rb");
+		if(fh == NULL)
+		{
+			throw std::runtime_error(std::string("Could not open file: ") + strerror(errno));
+		}
+		
+		if(!_same_file(parent->fh, filename, fh, filename))
+		{
+			fclose(fh);
+			throw std::runtime_error("Could not open file: File has been replaced on disk");
+		}
+	}
+	
+	if(!parent->extents.empty())
+	{
+		std::vector<std::string> filenames;
+		for(auto e = parent->extents.begin(); e != parent->extents.end(); ++e)
+		{
+			filenames.push_back(e->filename);
+		}
+		
+		_open_extents(filenames);
+		
+		for(size_t i = 0; i < extents.size(); ++i)
+		{
+			if(i >= parent->extents.size() || !_same_file(parent->extents[i].fh, parent->extents[i].filename, extents[i].fh, extents[i].filename) || extents[i].length != parent->extents[i].length)
+			{
+				_close_extents();
+				throw std::runtime_error("Could not open file: File has been replaced on disk");
+			}
+		}
+	}
+	
+	/* Copying the blocks only copies references to any loaded data, which is copied by
+	 * whichever Buffer modifies it first.
+	*/
+	
+	blocks = parent->blocks;
+	swap_file = parent->swap_file;
+	
+	/* The parent is already counting any dirty data we share with it. */
+	for(auto b = blocks.begin(); b != blocks.end(); ++b)
+	{
+		b->dirty_refs.reset();
+	}
+	
+	for(auto b = parent->last_accessed_blocks.rbegin(); b != parent->last_accessed_blocks.rend(); ++b)
+	{
+		_last_access_bump(&(blocks[ *b - parent->blocks.data() ]));
+	}
+	
+	for(auto b = parent->dirty_blocks.rbegin(); b != parent->dirty_blocks.rend(); ++b)
+	{
+		_dirty_bump(&(blocks[ *b - parent->blocks.data() ]));
+	}
+	
+	_file_deleted  = parent->_file_deleted;
+	_file_modified = parent->_file_modified;
+	last_mtime     = parent->last_mtime;
+	
+	fork_group->buffers.insert(this);
+	
+	if(fh != NULL)
+	{
+		timer.Start(FILE_CHECK_INTERVAL_MS, wxTIMER_ONE_SHOT);
+	}
+}
+
 REHex::Buffer::~Buffer()
 {
+	{
+		std::lock_guard<std::mutex> gl(fork_group->lock);
+		fork_group->buffers.erase(this);
+	}
+	
+	{
+		/* Stop any outstanding snapshots from trying to read through us. */
+		std::lock_guard<std::mutex> sl(snapshot_source->lock);
+		snapshot_source->buffer = NULL;
+	}
+	
+	while(!dirty_blocks.empty())
+	{
+		_dirty_remove(dirty_blocks.front());
+	}
+	
 	if(fh != NULL)
 	{
 		fclose(fh);
 		fh = NULL;
 	}
+	
+	_close_extents();
 }
 
 void REHex::Buffer::reload()
@@ -315,16 +777,26 @@ void REHex::Buffer::reload()
 
 void REHex::Buffer::_reinit_blocks(off_t file_length)
 {
+	++file_generation;
+	
 	_file_deleted  = false;
 	_file_modified = false;
 	last_mtime    = _get_file_mtime(fh, filename);
 	
 	/* Clear any existing blocks and references. */
 	
+	while(!dirty_blocks.empty())
+	{
+		_dirty_remove(dirty_blocks.front());
+	}
+	
 	last_accessed_blocks.clear();
 	last_accessed_blocks_map.clear();
 	blocks.clear();
 	
+	/* Nothing refers to the swap file any more. */
+	swap_file.reset();
+	
 	/* Populate the blocks list with appropriate offsets and sizes. */
 	
 	for(off_t offset = 0; offset < file_length; offset += block_size)
@@ -338,6 +810,34 @@ void REHex::Buffer::_reinit_blocks(off_t file_length)
 	}
 }
 
+/* Read all data which is still only in the backing file into memory, ready for the file to be
+ * overwritten by another Buffer. The blocks are marked as dirty so they can be swapped out.
+*/
+void REHex::Buffer::_copy_file_blocks()
+{
+	/* Any snapshots can no longer read unloaded blocks from the file. */
+	++file_generation;
+	
+	for(auto b = blocks.begin(); b != blocks.end(); ++b)
+	{
+		if(b->state == Block::CLEAN)
+		{
+			_mark_dirty(&(*b));
+		}
+	}
+	
+	for(auto b = blocks.begin(); b != blocks.end(); ++b)
+	{
+		if(b->state == Block::UNLOADED)
+		{
+			_load_block(&(*b));
+			_mark_dirty(&(*b));
+			
+			_enforce_memory_budget(&(*b));
+		}
+	}
+}
+
 void REHex::Buffer::write_inplace()
 {
 	write_inplace(filename);
@@ -345,6 +845,7 @@ void REHex::Buffer::write_inplace()
 
 void REHex::Buffer::write_inplace(const std::string &filename)
 {
+	std::unique_lock<std::mutex> gl(fork_group->lock);
 	std::unique_lock<std::mutex> l(lock);
 	
 	/* Need to open the file with open() since fopen() can't be told to open
@@ -378,6 +879,15 @@ void REHex::Buffer::write_inplace(const std::string &filename)
 	/* Disable write buffering */
 	setbuf(wfh, NULL);
 	
+	for(auto e = extents.begin(); e != extents.end(); ++e)
+	{
+		if(_same_file(e->fh, e->filename, wfh, filename))
+		{
+			fclose(wfh);
+			throw std::runtime_error("Cannot overwrite a file which is part of the document");
+		}
+	}
+	
 	off_t out_length = _length();
 	
 	/* Reserve space in the output file if it isn't already at least as large
@@ -422,6 +932,42 @@ void REHex::Buffer::write_inplace(const std::string &filename)
 	/* Are we updating the file we originally read data in from? */
 	bool updating_file = (fh != NULL && _same_file(fh, this->filename, wfh, filename));
 	
+	/* Any forks still reading from the file need their own copy of its data before we
+	 * overwrite it.
+	*/
+	
+	std::vector<Buffer*> forks_reading_file;
+	
+	for(auto f = fork_group->buffers.begin(); f != fork_group->buffers.end(); ++f)
+	{
+		if(*f == this)
+		{
+			continue;
+		}
+		
+		std::unique_lock<std::mutex> fl((*f)->lock);
+		
+		if((*f)->fh != NULL && _same_file((*f)->fh, (*f)->filename, wfh, filename))
+		{
+			try {
+				(*f)->_copy_file_blocks();
+			}
+			catch(...)
+			{
+				fclose(wfh);
+				throw;
+			}
+			
+			forks_reading_file.push_back(*f);
+		}
+	}
+	
+	if(updating_file)
+	{
+		/* Any snapshots can no longer read unloaded blocks from the file. */
+		++file_generation;
+	}
+	
 	std::list<Block*> pending;
 	for(auto b = blocks.begin(); b != blocks.end(); ++b)
 	{
@@ -430,7 +976,7 @@ void REHex::Buffer::write_inplace(const std::string &filename)
 	
 	for(auto b = pending.begin(); b != pending.end();)
 	{
-		if(updating_file && ((*b)->virt_offset == (*b)->real_offset && (*b)->state != Block::DIRTY))
+		if(updating_file && ((*b)->virt_offset == (*b)->real_offset && ((*b)->state == Block::UNLOADED || (*b)->state == Block::CLEAN)))
 		{
 			/* We're updating the file we originally read data in from and this block
 			 * hasn't changed (in contents or offset), don't need to do anything.
@@ -458,7 +1004,10 @@ void REHex::Buffer::write_inplace(const std::string &filename)
 		
 		if((*b)->virt_length > 0)
 		{
-			_load_block(*b);
+			if((*b)->state != Block::SWAPPED)
+			{
+				_load_block(*b);
+			}
 			
 			if(fseeko(wfh, (*b)->virt_offset, SEEK_SET) != 0)
 			{
@@ -467,19 +1016,28 @@ void REHex::Buffer::write_inplace(const std::string &filename)
 				throw std::runtime_error(std::string("fseeko: ") + strerror(err));
 			}
 			
-			if(fwrite((*b)->data.data(), (*b)->virt_length, 1, wfh) == 0)
+			const Block *cblock = *b;
+			
+			/* Swapped out blocks are copied straight from the swap file rather than
+			 * being paged back in.
+			*/
+			bool written = cblock->state == Block::SWAPPED
+				? cblock->swap_data->copy_to(wfh)
+				: fwrite(cblock->data.data(), cblock->virt_length, 1, wfh) != 0;
+			
+			if(!written)
 			{
-				if(updating_file)
+				int err = errno;
+				
+				if(updating_file && (*b)->state != Block::SWAPPED)
 				{
 					/* Ensure the block is marked as dirty, since we may have
 					 * partially rewritten it in the underlying file and no
 					 * longer be able to correctly reload it.
 					*/
-					(*b)->state = Block::DIRTY;
-					_last_access_remove(*b);
+					_mark_dirty(*b);
 				}
 				
-				int err = errno;
 				fclose(wfh);
 				throw std::runtime_error(std::string("Write error: ") + strerror(err));
 			}
@@ -491,7 +1049,16 @@ void REHex::Buffer::write_inplace(const std::string &filename)
 				*/
 				
 				(*b)->real_offset = (*b)->virt_offset;
-				(*b)->state       = Block::CLEAN;
+				
+				if((*b)->state == Block::SWAPPED)
+				{
+					(*b)->swap_data.reset();
+					(*b)->state = Block::UNLOADED;
+				}
+				else{
+					_dirty_remove(*b);
+					(*b)->state = Block::CLEAN;
+				}
 			}
 		}
 		
@@ -527,11 +1094,16 @@ void REHex::Buffer::write_inplace(const std::string &filename)
 	fh = wfh;
 	this->filename = filename;
 	
+	_close_extents();
+	
 	if(updating_file)
 	{
 		_file_deleted  = false;
 		_file_modified = false;
 		last_mtime     = _get_file_mtime(fh, filename);
+		
+		/* Every block has been written out, so nothing refers to the swap file. */
+		swap_file.reset();
 	}
 	else{
 		/* We've written out a complete new file, and it is now the backing store for this
@@ -541,6 +1113,18 @@ void REHex::Buffer::write_inplace(const std::string &filename)
 		_reinit_blocks(out_length);
 	}
 	
+	for(auto f = forks_reading_file.begin(); f != forks_reading_file.end(); ++f)
+	{
+		/* The forks don't depend on the file any more, don't tell them it changed. */
+		
+		std::unique_lock<std::mutex> fl((*f)->lock);
+		
+		if(!(*f)->_file_deleted && !(*f)->_file_modified)
+		{
+			(*f)->last_mtime = _get_file_mtime((*f)->fh, (*f)->filename);
+		}
+	}
+	
 	timer.Start(FILE_CHECK_INTERVAL_MS, wxTIMER_ONE_SHOT);
 }
 
@@ -568,9 +1152,18 @@ void REHex::Buffer::write_copy(const std::string &filename)
 	{
 		if(b->virt_length > 0)
 		{
-			_load_block(&(*b));
+			if(b->state != Block::SWAPPED)
+			{
+				_load_block(&(*b));
+			}
+			
+			const Block *cblock = &(*b);
 			
-			if(fwrite(b->data.data(), b->virt_length, 1, out) == 0)
+			bool written = cblock->state == Block::SWAPPED
+				? cblock->swap_data->copy_to(out)
+				: fwrite(cblock->data.data(), cblock->virt_length, 1, out) != 0;
+			
+			if(!written)
 			{
 				fclose(out);
 				throw std::runtime_error(std::string("Write error: ") + strerror(errno));
@@ -618,12 +1211,141 @@ REHex::Buffer::FileTime REHex::Buffer::_get_file_mtime(FILE *fh, const std::stri
 		wxGetApp().printf_error("Could not fstat() open file \"%s\": %s\n",
 			filename.c_str(), strerror(errno));
 	}
-	#endif
+	#endif
+	
+	return FileTime();
+}
+
+/* Append data from a block to the output of a read_data() call, shifting it left by the bit offset
+ * of the read and merging the carried bits into the end of the previous block's data.
+*/
+static void read_data_append(std::vector<unsigned char> *data, const unsigned char *base, off_t length, int shift)
+{
+	size_t dst_off = data->size();
+	data->resize(data->size() + length);
+	
+	REHex::CarryBits carry = REHex::memcpy_left(data->data() + dst_off, base, length, shift);
+	if(dst_off > 0)
+	{
+		assert(((*data)[dst_off - 1] & carry.mask) == 0);
+		(*data)[dst_off - 1] |= carry.value;
+	}
+}
+
+/* Trim any extra partial byte from the end of a bit-aligned read_data() call. */
+static void read_data_finish(std::vector<unsigned char> *data, const REHex::BitOffset &offset, off_t max_length, off_t end_offset, off_t buffer_length)
+{
+	if(offset.bit() > 0)
+	{
+		if(data->size() == (size_t)(max_length))
+		{
+			/* Pop off the extra partial byte we read to fill in the previous byte. */
+			data->pop_back();
+		}
+		else if(end_offset == buffer_length)
+		{
+			/* Pop off partial byte at the end of the file. */
+			data->pop_back();
+		}
+	}
+}
+
+std::vector<unsigned char> REHex::Buffer::read_data(const BitOffset &offset, off_t max_length)
+{
+	assert(offset.byte() >= 0);
+	assert(max_length >= 0);
+	
+	if(offset.bit() > 0)
+	{
+		++max_length;
+	}
+	
+	std::unique_lock<std::mutex> l(lock);
+	
+	Block *block = _block_by_virt_offset(offset.byte());
+	if(block == nullptr)
+	{
+		return std::vector<unsigned char>();
+	}
+	
+	std::vector<unsigned char> data;
+	data.reserve(max_length);
+	
+	off_t byte_offset = offset.byte();
+	
+	while(block < blocks.data() + blocks.size() && (size_t)(max_length) > data.size())
+	{
+		_load_block(block);
+		
+		off_t block_rel_off = byte_offset - block->virt_offset;
+		off_t block_rel_len = block->virt_length - block_rel_off;
+		off_t to_copy = std::min(block_rel_len, (max_length - (off_t)(data.size())));
+		
+		const Block *cblock = block;
+		const unsigned char *base = cblock->data.data() + block_rel_off;
+		
+		read_data_append(&data, base, to_copy, offset.bit());
+		
+		++block;
+		
+		byte_offset += to_copy;
+	}
+	
+	read_data_finish(&data, offset, max_length, byte_offset, _length());
+	
+	return data;
+}
+
+REHex::BlockPool::Stats REHex::Buffer::get_block_pool_stats() const
+{
+	return block_pool->get_stats();
+}
+
+std::shared_ptr<const REHex::Buffer::Snapshot> REHex::Buffer::snapshot()
+{
+	std::unique_lock<std::mutex> l(lock);
+	
+	std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>();
+	
+	snapshot->source = snapshot_source;
+	snapshot->file_generation = file_generation;
+	
+	snapshot->blocks.reserve(blocks.size());
+	
+	for(auto b = blocks.begin(); b != blocks.end(); ++b)
+	{
+		Snapshot::SnapshotBlock sb;
+		
+		sb.real_offset = b->real_offset;
+		sb.virt_offset = b->virt_offset;
+		sb.virt_length = b->virt_length;
+		
+		if(b->state == Block::SWAPPED)
+		{
+			sb.swap_data = b->swap_data;
+		}
+		else if(b->state != Block::UNLOADED)
+		{
+			sb.data = b->data.share();
+		}
+		
+		snapshot->blocks.push_back(sb);
+	}
+	
+	return snapshot;
+}
+
+off_t REHex::Buffer::Snapshot::length() const
+{
+	if(blocks.empty())
+	{
+		return 0;
+	}
 	
-	return FileTime();
+	return blocks.back().virt_offset + blocks.back().virt_length;
 }
 
-std::vector<unsigned char> REHex::Buffer::read_data(const BitOffset &offset, off_t max_length)
+std::vector<unsigned char> REHex::Buffer::Snapshot::read_data(const BitOffset &offset, off_t max_length) const
 {
 	assert(offset.byte() >= 0);
 	assert(max_length >= 0);
@@ -633,58 +1355,86 @@ std::vector<unsigned char> REHex::Buffer::read_data(const BitOffset &offset, off
 		++max_length;
 	}
 	
-	std::unique_lock<std::mutex> l(lock);
+	off_t byte_offset = offset.byte();
 	
-	Block *block = _block_by_virt_offset(offset.byte());
-	if(block == nullptr)
+	if(byte_offset >= length())
 	{
 		return std::vector<unsigned char>();
 	}
 	
+	auto block = std::upper_bound(blocks.begin(), blocks.end(), byte_offset,
+		[](off_t offset, const SnapshotBlock &block) { return offset < block.virt_offset; });
+	
+	assert(block != blocks.begin());
+	--block;
+	
 	std::vector<unsigned char> data;
 	data.reserve(max_length);
 	
-	off_t byte_offset = offset.byte();
+	std::vector<unsigned char> file_data;
 	
-	while(block < blocks.data() + blocks.size() && (size_t)(max_length) > data.size())
+	for(; block != blocks.end() && (size_t)(max_length) > data.size(); ++block)
 	{
-		_load_block(block);
-		
 		off_t block_rel_off = byte_offset - block->virt_offset;
 		off_t block_rel_len = block->virt_length - block_rel_off;
 		off_t to_copy = std::min(block_rel_len, (max_length - (off_t)(data.size())));
 		
-		const unsigned char *base = block->data.data() + block_rel_off;
-		
-		size_t dst_off = data.size();
-		data.resize(data.size() + to_copy);
-		
-		CarryBits carry = memcpy_left(data.data() + dst_off, base, to_copy, offset.bit());
-		if(dst_off > 0)
+		if(to_copy <= 0)
 		{
-			assert((data[dst_off - 1] & carry.mask) == 0);
-			data[dst_off - 1] |= carry.value;
+			/* Skip over any empty blocks. */
+			continue;
 		}
 		
-		++block;
+		const unsigned char *base;
 		
-		byte_offset += to_copy;
-	}
-	
-	if(offset.bit() > 0)
-	{
-		if(data.size() == max_length)
+		if(block->data)
 		{
-			/* Pop off the extra partial byte we read to fill in the previous byte. */
-			data.pop_back();
+			base = block->data->data() + block_rel_off;
 		}
-		else if(byte_offset == _length())
+		else if(block->swap_data)
 		{
-			/* Pop off partial byte at the end of the file. */
-			data.pop_back();
+			/* Block was swapped out when the snapshot was taken, the space in the
+			 * swap file isn't reused while we still refer to it.
+			*/
+			
+			file_data.resize(to_copy);
+			block->swap_data->read(block_rel_off, file_data.data(), to_copy);
+			
+			base = file_data.data();
+		}
+		else{
+			/* Block wasn't loaded when the snapshot was taken, read the part we need
+			 * directly from the file, as long as it hasn't been rewritten since.
+			*/
+			
+			std::lock_guard<std::mutex> sl(source->lock);
+			
+			if(source->buffer == NULL)
+			{
+				throw std::runtime_error("Buffer has been closed");
+			}
+			
+			Buffer *buffer = source->buffer;
+			std::lock_guard<std::mutex> bl(buffer->lock);
+			
+			if(buffer->file_generation != file_generation)
+			{
+				throw std::runtime_error("File has been rewritten since snapshot was taken");
+			}
+			
+			file_data.resize(to_copy);
+			buffer->_read_file((block->real_offset + block_rel_off), file_data.data(), to_copy);
+			
+			base = file_data.data();
 		}
+		
+		read_data_append(&data, base, to_copy, offset.bit());
+		
+		byte_offset += to_copy;
 	}
 	
+	read_data_finish(&data, offset, max_length, byte_offset, length());
+	
 	return data;
 }
 
@@ -740,8 +1490,7 @@ bool REHex::Buffer::overwrite_data(BitOffset offset, unsigned const char *data,
 		
 		carry = memcpy_right((block->data.data() + block_rel_off), data, to_copy, offset.bit());
 		
-		block->state = Block::DIRTY;
-		_last_access_remove(block);
+		_mark_dirty(block);
 		
 		if(length == 0)
 		{
@@ -764,6 +1513,8 @@ bool REHex::Buffer::overwrite_data(BitOffset offset, unsigned const char *data,
 		++block;
 	}
 	
+	_enforce_memory_budget(NULL);
+	
 	return true;
 }
 
@@ -811,14 +1562,15 @@ bool REHex::Buffer::overwrite_bits(BitOffset offset, const std::vector<bool> &da
 		
 		if(touched_block)
 		{
-			block->state = Block::DIRTY;
-			_last_access_remove(block);
+			_mark_dirty(block);
 		}
 		
 		++block;
 		block_offset = BitOffset::ZERO;
 	}
 	
+	_enforce_memory_budget(NULL);
+	
 	return true;
 }
 
@@ -842,21 +1594,34 @@ bool REHex::Buffer::insert_data(off_t offset, unsigned const char *data, off_t l
 	
 	_load_block(block);
 	
+	off_t block_rel_off = offset - block->virt_offset;
+	
+	if((block->virt_length + length) > (block_size * 2))
+	{
+		/* Don't let the block grow without limit, otherwise inserting a large amount
+		 * of data (or typing into the same block for a long time) would leave a block
+		 * too big to be swapped out in one piece.
+		*/
+		
+		_insert_split(block, block_rel_off, data, length);
+		
+		_enforce_memory_budget(NULL);
+		return true;
+	}
+	
 	/* Ensure the block's data buffer is large enough */
 	
 	block->grow(block->virt_length + length);
 	
 	/* Insert the new data, shifting the rest of the buffer along if necessary */
 	
-	off_t block_rel_off = offset - block->virt_offset;
 	unsigned char *dst = block->data.data() + block_rel_off;
 	
 	memmove(dst + length, dst, block->virt_length - block_rel_off);
 	memcpy(dst, data, length);
 	
 	block->virt_length += length;
-	block->state = Block::DIRTY;
-	_last_access_remove(block);
+	_mark_dirty(block);
 	
 	/* Shift the virtual offset of any subsequent blocks along. */
 	
@@ -865,9 +1630,153 @@ bool REHex::Buffer::insert_data(off_t offset, unsigned const char *data, off_t l
 		block->virt_offset += length;
 	}
 	
+	_enforce_memory_budget(NULL);
+	
 	return true;
 }
 
+/* Insert data into a loaded block, splitting the result into as many block_size blocks as
+ * necessary.
+*/
+void REHex::Buffer::_insert_split(Block *block, off_t block_rel_off, const unsigned char *data, off_t length)
+{
+	size_t block_idx = block - blocks.data();
+	const Block *cblock = block;
+	
+	/* The new contents of the block are made up of the data before the insert point, the
+	 * inserted data and whatever followed the insert point.
+	*/
+	
+	std::vector<unsigned char> tail(cblock->data.data() + block_rel_off, cblock->data.data() + cblock->virt_length);
+	
+	struct { const unsigned char *data; off_t length; } pieces[] = {
+		{ cblock->data.data(), block_rel_off },
+		{ data,                length },
+		{ tail.data(),         (off_t)(tail.size()) },
+	};
+	
+	auto copy_range = [&](unsigned char *dst, off_t begin, off_t end)
+	{
+		off_t piece_base = 0;
+		
+		for(size_t i = 0; i < (sizeof(pieces) / sizeof(*pieces)) && begin < end; ++i)
+		{
+			off_t piece_end = piece_base + pieces[i].length;
+			
+			if(begin < piece_end)
+			{
+				off_t to_copy = std::min(end, piece_end) - begin;
+				memcpy(dst, pieces[i].data + (begin - piece_base), to_copy);
+				
+				dst   += to_copy;
+				begin += to_copy;
+			}
+			
+			piece_base = piece_end;
+		}
+	};
+	
+	off_t total_length = cblock->virt_length + length;
+	
+	/* The new blocks don't have any data in the file, they get the real offset of the
+	 * following block so write_inplace() orders them the same way it would've if they
+	 * were still part of this one.
+	*/
+	
+	off_t split_real_offset = (block_idx + 1) < blocks.size()
+		? blocks[block_idx + 1].real_offset
+		: block->real_offset;
+	
+	std::vector<Block> new_blocks;
+	
+	for(off_t split_off = block_size; split_off < total_length; split_off += block_size)
+	{
+		off_t split_length = std::min((off_t)(block_size), (total_length - split_off));
+		
+		new_blocks.push_back(Block(split_real_offset, split_length));
+		
+		Block &nb = new_blocks.back();
+		nb.virt_offset = block->virt_offset + split_off;
+		nb.state = Block::DIRTY;
+		
+		nb.data.reset(block_pool->get(split_length));
+		copy_range(nb.data.data(), split_off, (split_off + split_length));
+	}
+	
+	/* The existing block keeps the first block_size bytes. Anything before the insert
+	 * point is already there.
+	*/
+	
+	if(block_rel_off < block_size)
+	{
+		block->data.resize(block_size);
+		copy_range((block->data.data() + block_rel_off), block_rel_off, block_size);
+	}
+	
+	block->virt_length = block_size;
+	block->trim();
+	
+	_mark_dirty(block);
+	
+	_insert_blocks((block_idx + 1), new_blocks);
+	
+	for(size_t i = block_idx + 1; i <= (block_idx + new_blocks.size()); ++i)
+	{
+		_mark_dirty(&(blocks[i]));
+	}
+	
+	/* Shift the virtual offset of any subsequent blocks along. */
+	
+	for(size_t i = block_idx + new_blocks.size() + 1; i < blocks.size(); ++i)
+	{
+		blocks[i].virt_offset += length;
+	}
+}
+
+/* Insert new blocks into the block list before the given index. Any pointers to blocks in the
+ * last accessed and dirty lists are updated to account for the blocks moving.
+*/
+void REHex::Buffer::_insert_blocks(size_t index, std::vector<Block> &new_blocks)
+{
+	auto block_to_new_idx = [&](Block *block)
+	{
+		size_t idx = block - blocks.data();
+		return idx >= index ? (idx + new_blocks.size()) : idx;
+	};
+	
+	std::vector<size_t> last_accessed_idx, dirty_idx;
+	
+	for(auto b = last_accessed_blocks.begin(); b != last_accessed_blocks.end(); ++b)
+	{
+		last_accessed_idx.push_back(block_to_new_idx(*b));
+	}
+	
+	for(auto b = dirty_blocks.begin(); b != dirty_blocks.end(); ++b)
+	{
+		dirty_idx.push_back(block_to_new_idx(*b));
+	}
+	
+	blocks.insert((blocks.begin() + index), new_blocks.begin(), new_blocks.end());
+	
+	last_accessed_blocks.clear();
+	last_accessed_blocks_map.clear();
+	
+	for(auto i = last_accessed_idx.begin(); i != last_accessed_idx.end(); ++i)
+	{
+		last_accessed_blocks.push_back(&(blocks[*i]));
+		last_accessed_blocks_map[ &(blocks[*i]) ] = std::prev(last_accessed_blocks.end());
+	}
+	
+	dirty_blocks.clear();
+	dirty_blocks_map.clear();
+	
+	for(auto i = dirty_idx.begin(); i != dirty_idx.end(); ++i)
+	{
+		dirty_blocks.push_back(&(blocks[*i]));
+		dirty_blocks_map[ &(blocks[*i]) ] = std::prev(dirty_blocks.end());
+	}
+}
+
 bool REHex::Buffer::erase_data(off_t offset, off_t length)
 {
 	std::unique_lock<std::mutex> l(lock);
@@ -901,8 +1810,7 @@ bool REHex::Buffer::erase_data(off_t offset, off_t length)
 		
 		block->trim();
 		
-		block->state = Block::DIRTY;
-		_last_access_remove(block);
+		_mark_dirty(block);
 		
 		/* Shift the offset back by however many bytes we've already
 		 * erased from previous blocks.
@@ -925,6 +1833,8 @@ bool REHex::Buffer::erase_data(off_t offset, off_t length)
 		block->virt_offset -= length;
 	}
 	
+	_enforce_memory_budget(NULL);
+	
 	return true;
 }
 
@@ -1022,6 +1932,228 @@ void REHex::Buffer::Block::trim()
 	}
 }
 
+void REHex::Buffer::BlockData::resize(size_t size)
+{
+	if(!vec)
+	{
+		vec = std::make_shared< std::vector<unsigned char> >(size);
+		dirty_refs = std::make_shared<DirtyRefs>();
+	}
+	else{
+		detach();
+		vec->resize(size);
+	}
+}
+
+void REHex::Buffer::BlockData::clear()
+{
+	vec.reset();
+	dirty_refs.reset();
+}
+
+void REHex::Buffer::BlockData::reset(const std::shared_ptr< std::vector<unsigned char> > &vec)
+{
+	this->vec = vec;
+	dirty_refs = vec ? std::make_shared<DirtyRefs>() : NULL;
+}
+
+void REHex::Buffer::BlockData::shrink_to_fit()
+{
+	if(vec && vec.use_count() == 1)
+	{
+		vec->shrink_to_fit();
+	}
+}
+
+std::shared_ptr< const std::vector<unsigned char> > REHex::Buffer::BlockData::share() const
+{
+	return vec;
+}
+
+void REHex::Buffer::BlockData::detach()
+{
+	/* New references to the data can only be created via the Buffer while its lock is held,
+	 * so if we are the only owner nobody else can start sharing it while we modify it.
+	*/
+	
+	if(vec && vec.use_count() > 1)
+	{
+		vec = std::make_shared< std::vector<unsigned char> >(*vec);
+		dirty_refs = std::make_shared<DirtyRefs>();
+	}
+}
+
+REHex::Buffer::SwapFile::SwapFile():
+	length(0)
+{
+	fh = tmpfile();
+	if(fh == NULL)
+	{
+		throw std::runtime_error(std::string("Could not create swap file: ") + strerror(errno));
+	}
+}
+
+REHex::Buffer::SwapFile::~SwapFile()
+{
+	fclose(fh);
+}
+
+std::shared_ptr<const REHex::Buffer::SwapFile::Extent> REHex::Buffer::SwapFile::write(const unsigned char *data, off_t length)
+{
+	std::lock_guard<std::mutex> l(lock);
+	
+	/* Use the first gap left by a released extent which is big enough, else append. */
+	
+	off_t offset = this->length;
+	
+	for(auto f = free_space.begin(); f != free_space.end(); ++f)
+	{
+		if(f->second >= length)
+		{
+			offset = f->first;
+			break;
+		}
+	}
+	
+	if(fseeko(fh, offset, SEEK_SET) != 0)
+	{
+		throw std::runtime_error(std::string("fseeko: ") + strerror(errno));
+	}
+	
+	if(fwrite(data, length, 1, fh) == 0)
+	{
+		throw std::runtime_error(std::string("Write error: ") + strerror(errno));
+	}
+	
+	if(offset == this->length)
+	{
+		this->length += length;
+	}
+	else{
+		auto f = free_space.find(offset);
+		assert(f != free_space.end());
+		
+		if(f->second > length)
+		{
+			free_space[offset + length] = f->second - length;
+		}
+		
+		free_space.erase(f);
+	}
+	
+	return std::shared_ptr<const Extent>(new Extent(shared_from_this(), offset, length));
+}
+
+off_t REHex::Buffer::SwapFile::get_length()
+{
+	std::lock_guard<std::mutex> l(lock);
+	return length;
+}
+
+void REHex::Buffer::SwapFile::release(off_t offset, off_t length)
+{
+	std::lock_guard<std::mutex> l(lock);
+	
+	/* Merge with any free space either side. */
+	
+	auto next = free_space.lower_bound(offset);
+	
+	if(next != free_space.end() && next->first == (offset + length))
+	{
+		length += next->second;
+		next = free_space.erase(next);
+	}
+	
+	if(next != free_space.begin())
+	{
+		auto prev = std::prev(next);
+		
+		if((prev->first + prev->second) == offset)
+		{
+			offset = prev->first;
+			length += prev->second;
+			
+			free_space.erase(prev);
+		}
+	}
+	
+	if((offset + length) == this->length)
+	{
+		/* Free space at the end of the file is reused by appending. */
+		this->length = offset;
+	}
+	else{
+		free_space[offset] = length;
+	}
+}
+
+REHex::Buffer::SwapFile::Extent::Extent(const std::shared_ptr<SwapFile> &file, off_t offset, off_t length):
+	file(file),
+	offset(offset),
+	length(length) {}
+
+REHex::Buffer::SwapFile::Extent::~Extent()
+{
+	file->release(offset, length);
+}
+
+void REHex::Buffer::SwapFile::Extent::read(off_t offset, unsigned char *dst, off_t length) const
+{
+	assert(offset >= 0);
+	assert((offset + length) <= this->length);
+	
+	std::lock_guard<std::mutex> l(file->lock);
+	
+	if(fseeko(file->fh, (this->offset + offset), SEEK_SET) != 0)
+	{
+		throw std::runtime_error(std::string("fseeko: ") + strerror(errno));
+	}
+	
+	if(fread(dst, length, 1, file->fh) == 0)
+	{
+		clearerr(file->fh);
+		throw std::runtime_error(std::string("Read error: ") + strerror(errno));
+	}
+}
+
+bool REHex::Buffer::SwapFile::Extent::copy_to(FILE *out) const
+{
+	std::lock_guard<std::mutex> l(file->lock);
+	
+	if(fseeko(file->fh, offset, SEEK_SET) != 0)
+	{
+		return false;
+	}
+	
+	off_t remain = length;
+	std::vector<unsigned char> chunk(std::min(remain, SWAP_COPY_CHUNK));
+	
+	while(remain > 0)
+	{
+		off_t chunk_length = std::min(remain, SWAP_COPY_CHUNK);
+		
+		if(fread(chunk.data(), chunk_length, 1, file->fh) == 0)
+		{
+			if(feof(file->fh))
+			{
+				clearerr(file->fh);
+				errno = EIO;
+			}
+			
+			return false;
+		}
+		
+		if(fwrite(chunk.data(), chunk_length, 1, out) == 0)
+		{
+			return false;
+		}
+		
+		remain -= chunk_length;
+	}
+	
+	return true;
+}
+
 REHex::Buffer::FileTime::FileTime()
 {
 	tv_sec = 0;
@@ -18,9 +18,12 @@
 #ifndef REHEX_BUFFER_HPP
 #define REHEX_BUFFER_HPP
 
+#include <atomic>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 #include <time.h>
 #include <vector>
@@ -32,6 +35,7 @@
 #endif
 
 #include "BitOffset.hpp"
+#include "BlockPool.hpp"
 
 namespace REHex {
 	wxDECLARE_EVENT(BACKING_FILE_DELETED, wxCommandEvent);
@@ -43,8 +47,10 @@ namespace REHex {
 	 * This class provides scalable read/write access to a file on disk - paging sections in
 	 * and out as necessary to fulfil read requests without keeping the whole file in memory.
 	 *
-	 * Blocks which have been modified are not paged out and will remain resident until the
-	 * file is written out.
+	 * Blocks which have been modified can't be paged back in from the file, so they remain
+	 * resident until the file is written out, unless the total size of modified data in all
+	 * Buffers exceeds the dirty memory budget, in which case the least recently used ones
+	 * are paged out to a temporary swap file instead.
 	*/
 	class Buffer: public wxEvtHandler
 	{
@@ -53,6 +59,23 @@ namespace REHex {
 			std::string filename;
 			std::mutex lock;
 			
+			/**
+			 * @brief One of the files making up a Buffer backed by multiple files.
+			*/
+			struct Extent
+			{
+				off_t offset;  /**< Offset of the file within the Buffer. */
+				off_t length;  /**< Length of the file. */
+				
+				std::string filename;
+				FILE *fh;
+			};
+			
+			/* Files backing the Buffer, in order, when it was created from multiple
+			 * files. Empty when the Buffer is backed by a single file (fh).
+			*/
+			std::vector<Extent> extents;
+			
 			struct FileTime: public timespec
 			{
 				public:
@@ -67,6 +90,194 @@ namespace REHex {
 					bool operator!=(const FileTime &rhs) const;
 			};
 			
+			/**
+			 * @brief Number of DIRTY Blocks referencing some BlockData storage.
+			 *
+			 * A forked Buffer starts out sharing its dirty blocks' data with the Buffer
+			 * it was forked from. The memory is only counted towards dirty_memory_used
+			 * while at least one DIRTY Block references it, however many do.
+			*/
+			struct DirtyRefs
+			{
+				std::atomic<size_t> blocks;
+				size_t size;  /**< Bytes counted towards dirty_memory_used. */
+				
+				DirtyRefs(): blocks(0), size(0) {}
+			};
+			
+			/**
+			 * @brief Copy-on-write storage for the data of a Block.
+			 *
+			 * The data is shared with any Snapshot taken while the block was loaded, and
+			 * copied the first time the block is modified afterwards, so snapshots never
+			 * see later changes and taking one never copies any data.
+			*/
+			class BlockData
+			{
+				public:
+					bool empty() const { return !vec || vec->empty(); }
+					size_t size() const { return vec ? vec->size() : 0; }
+					
+					const unsigned char *data() const { return vec ? vec->data() : NULL; }
+					unsigned char *data() { detach(); return vec ? vec->data() : NULL; }
+					
+					const unsigned char &operator[](size_t i) const { return (*vec)[i]; }
+					unsigned char &operator[](size_t i) { detach(); return (*vec)[i]; }
+					
+					void resize(size_t size);
+					void clear();
+					
+					/**
+					 * @brief Replace the data with a new buffer.
+					*/
+					void reset(const std::shared_ptr< std::vector<unsigned char> > &vec);
+					void shrink_to_fit();
+					
+					/**
+					 * @brief Get a shared reference to the current data.
+					*/
+					std::shared_ptr< const std::vector<unsigned char> > share() const;
+					
+					/**
+					 * @brief Get the DirtyRefs of the current data.
+					 *
+					 * Every copy of the BlockData sharing the same data returns
+					 * the same DirtyRefs. NULL if there is no data.
+					*/
+					const std::shared_ptr<DirtyRefs> &get_dirty_refs() const { return dirty_refs; }
+				
+				private:
+					std::shared_ptr< std::vector<unsigned char> > vec;
+					std::shared_ptr<DirtyRefs> dirty_refs;
+					
+					void detach();
+			};
+			
+			/**
+			 * @brief Link from Snapshot objects back to the Buffer they were taken from.
+			 *
+			 * Used for reading any data which wasn't loaded when the snapshot was taken,
+			 * the buffer pointer is cleared when the Buffer is destroyed.
+			*/
+			struct SnapshotSource
+			{
+				std::mutex lock;
+				Buffer *buffer;
+				
+				SnapshotSource(Buffer *buffer): buffer(buffer) {}
+			};
+			
+			std::shared_ptr<SnapshotSource> snapshot_source;
+			
+			/**
+			 * @brief Set of Buffers forked from the same original Buffer.
+			 *
+			 * Forks read unmodified data from the same backing file, so any Buffer in
+			 * the set writing to the file must first give the others their own copy
+			 * of that data. The lock is always taken before the lock of any Buffer.
+			*/
+			struct ForkGroup
+			{
+				std::mutex lock;
+				std::set<Buffer*> buffers;
+			};
+			
+			std::shared_ptr<ForkGroup> fork_group;
+			
+			/**
+			 * @brief Temporary file holding modified blocks which have been swapped out.
+			 *
+			 * Each block written to the swap file is referenced by an Extent, which is
+			 * shared by any Snapshot or forked Buffer with the same block swapped out.
+			 * The space is only reused once the last reference to the Extent goes away.
+			 *
+			 * SwapFile objects must be managed by a std::shared_ptr.
+			*/
+			class SwapFile: public std::enable_shared_from_this<SwapFile>
+			{
+				public:
+					/**
+					 * @brief Data written to the swap file.
+					*/
+					class Extent
+					{
+						public:
+							~Extent();
+							
+							Extent(const Extent&) = delete;
+							Extent &operator=(const Extent&) = delete;
+							
+							/**
+							 * @brief Read data from the extent.
+							 *
+							 * Throws on I/O error.
+							*/
+							void read(off_t offset, unsigned char *dst, off_t length) const;
+							
+							/**
+							 * @brief Copy the extent to the current position in another file.
+							 *
+							 * Returns false with errno set on I/O error.
+							*/
+							bool copy_to(FILE *out) const;
+						
+						private:
+							Extent(const std::shared_ptr<SwapFile> &file, off_t offset, off_t length);
+							
+							std::shared_ptr<SwapFile> file;
+							off_t offset;
+							off_t length;
+						
+						friend SwapFile;
+					};
+					
+					/**
+					 * @brief Create a new, empty, swap file.
+					 *
+					 * Throws on I/O error.
+					*/
+					SwapFile();
+					~SwapFile();
+					
+					/**
+					 * @brief Write data to free space in the swap file.
+					 *
+					 * Throws on I/O error.
+					*/
+					std::shared_ptr<const Extent> write(const unsigned char *data, off_t length);
+					
+					/**
+					 * @brief Get the length of the swap file.
+					*/
+					off_t get_length();
+				
+				private:
+					std::mutex lock;
+					FILE *fh;
+					off_t length;
+					
+					/* Space freed by destroyed extents, by offset. Adjacent ranges are
+					 * merged, and any at the end of the file are removed by reducing
+					 * length instead.
+					*/
+					std::map<off_t, off_t> free_space;
+					
+					void release(off_t offset, off_t length);
+			};
+			
+			/**
+			 * @brief Pool of buffers for loading blocks into.
+			 *
+			 * Shared with any forks of this Buffer. Buffers released by Snapshots and
+			 * forks are returned to it too.
+			*/
+			std::shared_ptr<BlockPool> block_pool;
+			
+			/**
+			 * @brief Incremented whenever the contents of the backing file may change.
+			*/
+			unsigned int file_generation;
+		
 		#ifdef UNIT_TEST
 		/* Make the block list public when unit testing so we can examine the
 		 * contents directly rather than trying to cover all possible iterations
@@ -86,11 +297,20 @@ namespace REHex {
 						UNLOADED,
 						CLEAN,
 						DIRTY,
+						SWAPPED,
 					};
 					
 					State state;
 					
-					std::vector<unsigned char> data;
+					BlockData data;
+					
+					/* Data within the SwapFile when SWAPPED. */
+					std::shared_ptr<const SwapFile::Extent> swap_data;
+					
+					/* DirtyRefs of the data this block counts towards the dirty memory
+					 * budget, NULL if it isn't counting any.
+					*/
+					std::shared_ptr<DirtyRefs> dirty_refs;
 					
 					Block(off_t offset, off_t length);
 					
@@ -100,6 +320,8 @@ namespace REHex {
 			
 			std::vector<Block> blocks;
 			
+			std::shared_ptr<SwapFile> swap_file;
+			
 			bool _file_deleted, _file_modified;
 			FileTime last_mtime;
 			wxTimer timer;
@@ -120,16 +342,48 @@ namespace REHex {
 			std::list<Block*> last_accessed_blocks;
 			std::map< Block*, std::list<Block*>::iterator > last_accessed_blocks_map;
 			
+			/* dirty_blocks is a list of the DIRTY blocks which are resident in memory,
+			 * most recently accessed first. When the total size of dirty data in all
+			 * Buffers exceeds the dirty memory budget, the least recently accessed
+			 * blocks are written out to the swap file and unloaded until it doesn't.
+			*/
+			
+			std::list<Block*> dirty_blocks;
+			std::map< Block*, std::list<Block*>::iterator > dirty_blocks_map;
+			
+			static std::atomic<size_t> dirty_memory_budget;
+			static std::atomic<size_t> dirty_memory_used;
+			
+			/* Set after the first failure to write to a swap file, after which modified
+			 * blocks are kept in memory regardless of the budget.
+			*/
+			static std::atomic<bool> swap_failed;
+		
 		private:
 			Block *_block_by_virt_offset(off_t virt_offset);
 			void _load_block(Block *block);
+			void _read_file(off_t real_offset, unsigned char *dst, off_t length);
+			
+			void _open_extents(const std::vector<std::string> &filenames);
+			void _close_extents();
 			
 			off_t _length();
 			
 			void _last_access_bump(Block *block);
 			void _last_access_remove(Block *block);
 			
+			void _mark_dirty(Block *block);
+			void _dirty_bump(Block *block);
+			void _dirty_release(Block *block);
+			void _dirty_remove(Block *block);
+			bool _swap_out(Block *block);
+			void _enforce_memory_budget(const Block *keep);
+			
+			void _insert_split(Block *block, off_t block_rel_off, const unsigned char *data, off_t length);
+			void _insert_blocks(size_t index, std::vector<Block> &new_blocks);
+			
 			void _reinit_blocks(off_t file_length);
+			void _copy_file_blocks();
 			
 			void OnTimerTick(wxTimerEvent &timer);
 			
@@ -137,10 +391,66 @@ namespace REHex {
 			static FileTime _get_file_mtime(FILE *fh, const std::string &filename);
 			
 		public:
+			/**
+			 * @brief Immutable view of the data in a Buffer at a point in time.
+			 *
+			 * A Snapshot shares the data of any blocks which were loaded when it was
+			 * taken, so it is cheap to take and remains consistent while the Buffer
+			 * continues to be modified. Any data which wasn't loaded is read from the
+			 * backing file on demand.
+			 *
+			 * Snapshot objects are safe to read from any thread.
+			*/
+			class Snapshot
+			{
+				public:
+					/**
+					 * @brief Get the length of the data in the snapshot.
+					*/
+					off_t length() const;
+					
+					/**
+					 * @brief Read data from the snapshot.
+					 *
+					 * @param offset      Offset to read from.
+					 * @param max_length  Maximum number of bytes to read.
+					 *
+					 * Behaves the same as Buffer::read_data() on the Buffer at the
+					 * time the snapshot was taken.
+					 *
+					 * Throws on I/O error, or if data which wasn't loaded when the
+					 * snapshot was taken can no longer be read because the Buffer
+					 * has been destroyed or the backing file has been rewritten.
+					*/
+					std::vector<unsigned char> read_data(const BitOffset &offset, off_t max_length) const;
+				
+				private:
+					struct SnapshotBlock
+					{
+						off_t real_offset;
+						off_t virt_offset;
+						off_t virt_length;
+						
+						/* NULL if the block wasn't loaded. */
+						std::shared_ptr< const std::vector<unsigned char> > data;
+						
+						/* NULL if the block wasn't swapped out. */
+						std::shared_ptr<const SwapFile::Extent> swap_data;
+					};
+					
+					std::vector<SnapshotBlock> blocks;
+					
+					std::shared_ptr<SnapshotSource> source;
+					unsigned int file_generation;
+				
+				friend Buffer;
+			};
+			
 			static const unsigned int DEFAULT_BLOCK_SIZE = 4194304; /* 4MiB */
 			static const unsigned int MAX_CLEAN_BLOCKS   = 4;
 			static const unsigned int BLOCK_TRIM_THRESH  = 262144; /* 256KiB */
 			static const unsigned int FILE_CHECK_INTERVAL_MS = 1000;
+			static const size_t DEFAULT_DIRTY_MEMORY_BUDGET = 1073741824; /* 1GiB */
 			
 			const off_t block_size;
 			
@@ -154,6 +464,33 @@ namespace REHex {
 			*/
 			Buffer(const std::string &filename, off_t block_size = DEFAULT_BLOCK_SIZE);
 			
+			/**
+			 * @brief Create a Buffer backed by multiple files on disk.
+			 *
+			 * The files are presented as one contiguous Buffer in the order given,
+			 * like a split disk image. The files are never written to, the Buffer
+			 * can be modified but must be written out using write_inplace() with
+			 * the name of a new file, which then becomes the only backing file.
+			*/
+			Buffer(const std::vector<std::string> &filenames, off_t block_size = DEFAULT_BLOCK_SIZE);
+			
+			/**
+			 * @brief Create a copy-on-write fork of another Buffer.
+			 *
+			 * The new Buffer has the same contents and backing file as the parent
+			 * and shares any loaded blocks with it, so forking is cheap regardless
+			 * of the size of the file. Blocks are only copied when they are first
+			 * modified by either Buffer, after which the two are independent.
+			 *
+			 * Unmodified data continues to be read from the backing file until
+			 * either Buffer writes to it with write_inplace(), at which point the
+			 * other Buffers read all of their remaining data into memory (or the
+			 * swap file) first.
+			 *
+			 * Throws if the backing file can't be opened again.
+			*/
+			Buffer(Buffer *parent);
+			
 			~Buffer();
 			
 			/**
@@ -214,6 +551,37 @@ namespace REHex {
 			*/
 			std::vector<unsigned char> read_data(const BitOffset &offset, off_t max_length);
 			
+			/**
+			 * @brief Set the maximum amount of modified data to keep in memory.
+			 *
+			 * The budget is shared by all Buffer objects. Once the modified data held
+			 * in memory exceeds it, the least recently used modified blocks are moved
+			 * out to a temporary swap file and read back in when next accessed.
+			*/
+			static void set_dirty_memory_budget(size_t budget);
+			
+			/**
+			 * @brief Get the maximum amount of modified data to keep in memory.
+			*/
+			static size_t get_dirty_memory_budget();
+			
+			/**
+			 * @brief Get the amount of modified data currently held in memory by all Buffers.
+			*/
+			static size_t get_dirty_memory_used();
+			
+			/**
+			 * @brief Get the usage statistics of the pool blocks are loaded into.
+			*/
+			BlockPool::Stats get_block_pool_stats() const;
+			
+			/**
+			 * @brief Take a read-only snapshot of the current Buffer contents.
+			 *
+			 * The returned snapshot isn't affected by any later changes to the Buffer.
+			*/
+			std::shared_ptr<const Snapshot> snapshot();
+			
 			/**
 			 * @brief Read data from the Buffer.
 			 *
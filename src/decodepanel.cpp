@@ -130,9 +130,7 @@ REHex::DecodePanel::DecodePanel(wxWindow *parent, SharedDocumentPointer &documen
 	
 	this->document.auto_cleanup_bind(CURSOR_UPDATE, &REHex::DecodePanel::OnCursorUpdate,    this);
 	
-	this->document.auto_cleanup_bind(DATA_ERASE,     &REHex::DecodePanel::OnDataModified, this);
-	this->document.auto_cleanup_bind(DATA_INSERT,    &REHex::DecodePanel::OnDataModified, this);
-	this->document.auto_cleanup_bind(DATA_OVERWRITE, &REHex::DecodePanel::OnDataModified, this);
+	this->document.auto_cleanup_bind(DATA_CHANGES, &REHex::DecodePanel::OnDataModified, this);
 	
 	update();
 }
@@ -304,7 +302,7 @@ void REHex::DecodePanel::OnCursorUpdate(CursorUpdateEvent &event)
 	event.Skip();
 }
 
-void REHex::DecodePanel::OnDataModified(OffsetLengthEvent &event)
+void REHex::DecodePanel::OnDataModified(DataChangesEvent &event)
 {
 	update();
 	
@@ -79,7 +79,7 @@ namespace REHex {
 			void set_pgrid_colours();
 			
 			void OnCursorUpdate(CursorUpdateEvent &event);
-			void OnDataModified(OffsetLengthEvent &event);
+			void OnDataModified(DataChangesEvent &event);
 			void OnPropertyGridChanged(wxPropertyGridEvent& event);
 			void OnPropertyGridSelected(wxPropertyGridEvent &event);
 			void OnEndian(wxCommandEvent &event);
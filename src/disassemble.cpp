@@ -43,79 +43,14 @@ BEGIN_EVENT_TABLE(REHex::Disassemble, wxPanel)
 	EVT_CHOICE(wxID_ANY, REHex::Disassemble::OnArch)
 END_EVENT_TABLE()
 
-struct CSArchitecture {
-	const char *triple;
-	const char *label;
-	cs_arch arch;
-	cs_mode mode;
-};
-
-cs_mode operator|(const cs_mode& lhs, const cs_mode& rhs)
-{
-	return static_cast<cs_mode>(static_cast<int>(lhs) | static_cast<int>(rhs));
-}
-
-/* List of all known architectures */
-static const CSArchitecture known_arch_list[] = {
-	{ "arm",   "ARM",               CS_ARCH_ARM, CS_MODE_ARM | CS_MODE_LITTLE_ENDIAN },
-	{ "armeb", "ARM (big endian)",  CS_ARCH_ARM, CS_MODE_ARM | CS_MODE_BIG_ENDIAN },
-	/* Add THUMB? */
-	
-	{ "aarch64",    "AArch64 (ARM64)",              CS_ARCH_ARM64, CS_MODE_ARM | CS_MODE_LITTLE_ENDIAN },
-	{ "aarch64_be", "AArch64 (ARM64, big endian)",  CS_ARCH_ARM64, CS_MODE_ARM | CS_MODE_BIG_ENDIAN },
-	
-	#if CS_MAKE_VERSION(CS_API_MAJOR, CS_API_MINOR) >= CS_MAKE_VERSION(4, 0)
-	{ "m680x-6301",  "Hitachi 6301/6303",  CS_ARCH_M680X,  CS_MODE_M680X_6301 },
-	{ "m680x-6309",  "Hitachi 6309",       CS_ARCH_M680X,  CS_MODE_M680X_6309 },
-	#endif
-	
-	{ "mips",     "MIPS",                           CS_ARCH_MIPS, CS_MODE_MIPS32 | CS_MODE_BIG_ENDIAN },
-	{ "mipsel",   "MIPS (little endian)",           CS_ARCH_MIPS, CS_MODE_MIPS32 | CS_MODE_LITTLE_ENDIAN },
-	{ "mips64",   "MIPS (64-bit)",                  CS_ARCH_MIPS, CS_MODE_MIPS64 | CS_MODE_BIG_ENDIAN },
-	{ "mips64el", "MIPS (64-bit, little endian)",   CS_ARCH_MIPS, CS_MODE_MIPS64 | CS_MODE_LITTLE_ENDIAN },
-	
-	#if CS_MAKE_VERSION(CS_API_MAJOR, CS_API_MINOR) >= CS_MAKE_VERSION(4, 0)
-	{ "m680x-6800",   "Motorola 6800/6802",             CS_ARCH_M680X,  CS_MODE_M680X_6800  },
-	{ "m680x-6801",   "Motorola 6801/6803",             CS_ARCH_M680X,  CS_MODE_M680X_6801  },
-	{ "m680x-6805",   "Motorola/Freescale 6805",        CS_ARCH_M680X,  CS_MODE_M680X_6805  },
-	{ "m680x-6808",   "Motorola/Freescale/NXP 68HC08",  CS_ARCH_M680X,  CS_MODE_M680X_6808  },
-	{ "m680x-6809",   "Motorola 6809",                  CS_ARCH_M680X,  CS_MODE_M680X_6809  },
-	{ "m680x-6811",   "Motorola/Freescale/NXP 68HC11",  CS_ARCH_M680X,  CS_MODE_M680X_6811  },
-	{ "m680x-cpu12",  "Motorola/Freescale/NXP 68HC12",  CS_ARCH_M680X,  CS_MODE_M680X_CPU12 },
-	
-	{ "m68k-68000", "Motorola 68000", CS_ARCH_M68K, CS_MODE_M68K_000 },
-	{ "m68k-68000", "Motorola 68010", CS_ARCH_M68K, CS_MODE_M68K_010 },
-	{ "m68k-68000", "Motorola 68020", CS_ARCH_M68K, CS_MODE_M68K_020 },
-	{ "m68k-68000", "Motorola 68030", CS_ARCH_M68K, CS_MODE_M68K_030 },
-	{ "m68k-68000", "Motorola 68040", CS_ARCH_M68K, CS_MODE_M68K_040 },
-	{ "m68k-68000", "Motorola 68060", CS_ARCH_M68K, CS_MODE_M68K_060 },
-	#endif
-	
-	#if CS_MAKE_VERSION(CS_API_MAJOR, CS_API_MINOR) >= CS_MAKE_VERSION(5, 0)
-	{ "mos65xx", "MOS 65XX (including 6502)", CS_ARCH_MOS65XX, CS_MODE_LITTLE_ENDIAN },
-	#endif
-	
-	{ "powerpc",     "PowerPC",                     CS_ARCH_PPC, CS_MODE_32 | CS_MODE_BIG_ENDIAN },
-	{ "powerpc64",   "PowerPC (64-bit)",            CS_ARCH_PPC, CS_MODE_64 | CS_MODE_BIG_ENDIAN },
-	{ "powerpc64le", "PowerPC (64-bit) (little endian)",CS_ARCH_PPC, CS_MODE_64 | CS_MODE_LITTLE_ENDIAN },
-	
-	{ "sparc",   "SPARC",                   CS_ARCH_SPARC, CS_MODE_BIG_ENDIAN },
-	{ "sparcel", "SPARC (little endian)",   CS_ARCH_SPARC, CS_MODE_LITTLE_ENDIAN },
-	{ "sparcv9", "SPARC V9 (SPARC64)",      CS_ARCH_SPARC, CS_MODE_BIG_ENDIAN | CS_MODE_V9 },
-	
-	{ "x86_16", "X86-16",           CS_ARCH_X86, CS_MODE_16 },
-	{ "i386",   "X86",              CS_ARCH_X86, CS_MODE_32 },
-	{ "x86_64", "X86-64 (AMD64)",   CS_ARCH_X86, CS_MODE_64 },
-};
-
 /* List of all supported architectures */
-static std::vector<CSArchitecture> arch_list;
+static std::vector<REHex::CSArchitecture> arch_list;
 static std::list<REHex::StaticDataTypeRegistration> disasm_dtrs;
 static const char *DEFAULT_ARCH = "x86_64";
 
 static void Initialize_disassembler()
 {
-	for(const auto& desc : known_arch_list)
+	for(const auto& desc : REHex::get_known_architectures())
 	{
 		/* Check if this architecture is supported by the currently used capstone */
 		if(cs_support(desc.arch))
@@ -146,7 +81,7 @@ static REHex::App::SetupHookRegistration Initialize_disassembler_hook(
 	&Initialize_disassembler);
 
 REHex::Disassemble::Disassemble(wxWindow *parent, SharedDocumentPointer &document, DocumentCtrl *document_ctrl):
-	ToolPanel(parent), document(document), document_ctrl(document_ctrl), disassembler(0)
+	ToolPanel(parent), document(document), document_ctrl(document_ctrl), disassembler(0), boundaries_arch(-1)
 {
 	arch = new wxChoice(this, wxID_ANY);
 	
@@ -171,9 +106,7 @@ REHex::Disassemble::Disassemble(wxWindow *parent, SharedDocumentPointer &documen
 	
 	this->document.auto_cleanup_bind(CURSOR_UPDATE, &REHex::Disassemble::OnCursorUpdate,    this);
 	
-	this->document.auto_cleanup_bind(DATA_ERASE,     &REHex::Disassemble::OnDataModified, this);
-	this->document.auto_cleanup_bind(DATA_INSERT,    &REHex::Disassemble::OnDataModified, this);
-	this->document.auto_cleanup_bind(DATA_OVERWRITE, &REHex::Disassemble::OnDataModified, this);
+	this->document.auto_cleanup_bind(DATA_CHANGES, &REHex::Disassemble::OnDataModified, this);
 	
 	this->document_ctrl.auto_cleanup_bind(EV_DISP_SETTING_CHANGED, &REHex::Disassemble::OnBaseChanged, this);
 	
@@ -261,6 +194,32 @@ void REHex::Disassemble::update()
 	
 	std::map<BitOffset, Instruction> instructions;
 	
+	/* Step 0: If the background sweep has found where an instruction starts within the
+	 * window before the current position, disassemble forward from there once.
+	*/
+	
+	if(boundaries && position.byte_aligned())
+	{
+		ByteRangeSet focus;
+		focus.set_range(window_base.byte(), WINDOW_SIZE);
+		
+		boundaries->set_focus(focus);
+		
+		off_t sync_off = boundaries->find_boundary(window_base.byte(), (position.byte() + 1));
+		if(sync_off >= 0 && (size_t)(sync_off - window_base.byte()) < data.size())
+		{
+			size_t sync_data_off = sync_off - window_base.byte();
+			std::map<BitOffset, Instruction> i_instructions = disassemble(BitOffset(sync_off, 0), data.data() + sync_data_off, data.size() - sync_data_off);
+			
+			auto ii = i_instructions.upper_bound(position);
+			if(ii != i_instructions.begin()
+				&& (--ii, ((ii->first + ii->second.length) > position)))
+			{
+				instructions = i_instructions;
+			}
+		}
+	}
+	
 	/* Step 1: We try disassembling each offset from the start of the window up to the current
 	 * position, the first one that disassembles to a contiguous series of instructions where
 	 * one starts at position is where we display disassembly from.
@@ -269,7 +228,7 @@ void REHex::Disassemble::update()
 	BitOffset doc_off;
 	size_t data_off;
 	
-	for(doc_off = window_base, data_off = 0; doc_off <= position && data_off < data.size(); doc_off += BitOffset(1, 0), ++data_off)
+	for(doc_off = window_base, data_off = 0; instructions.empty() && doc_off <= position && data_off < data.size(); doc_off += BitOffset(1, 0), ++data_off)
 	{
 		std::map<BitOffset, Instruction> i_instructions = disassemble(doc_off, data.data() + data_off, data.size() - data_off);
 		
@@ -333,6 +292,12 @@ void REHex::Disassemble::reinit_disassembler()
 {
 	const CSArchitecture& desc = arch_list[ arch->GetSelection() ];
 	
+	if(boundaries_arch != arch->GetSelection())
+	{
+		boundaries.reset(new InstructionBoundaryCache(document, desc.arch, desc.mode));
+		boundaries_arch = arch->GetSelection();
+	}
+	
 	if(disassembler != 0)
 	{
 		cs_close(&disassembler);
@@ -402,7 +367,7 @@ void REHex::Disassemble::OnArch(wxCommandEvent &event)
 	update();
 }
 
-void REHex::Disassemble::OnDataModified(OffsetLengthEvent &event)
+void REHex::Disassemble::OnDataModified(DataChangesEvent &event)
 {
 	update();
 	
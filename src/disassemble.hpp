@@ -20,6 +20,7 @@
 
 #include <capstone/capstone.h>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <wx/choice.h>
@@ -29,6 +30,7 @@
 #include "CodeCtrl.hpp"
 #include "document.hpp"
 #include "Events.hpp"
+#include "InstructionBoundaryCache.hpp"
 #include "SafeWindowPointer.hpp"
 #include "SharedDocumentPointer.hpp"
 #include "ToolPanel.hpp"
@@ -61,6 +63,9 @@ namespace REHex {
 			
 			size_t disassembler;
 			
+			std::unique_ptr<InstructionBoundaryCache> boundaries;
+			int boundaries_arch;  /**< Index into arch_list which boundaries was created for. */
+			
 			wxChoice *arch;
 			CodeCtrl *assembly;
 			
@@ -69,7 +74,7 @@ namespace REHex {
 			
 			void OnCursorUpdate(CursorUpdateEvent &event);
 			void OnArch(wxCommandEvent &event);
-			void OnDataModified(OffsetLengthEvent &event);
+			void OnDataModified(DataChangesEvent &event);
 			void OnBaseChanged(wxCommandEvent &event);
 			void OnAsmSyntaxChanged(wxCommandEvent &event);
 			
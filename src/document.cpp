@@ -53,9 +53,11 @@ wxDEFINE_EVENT(REHex::EV_DISP_SETTING_CHANGED,wxCommandEvent);
 wxDEFINE_EVENT(REHex::EV_HIGHLIGHTS_CHANGED,  wxCommandEvent);
 wxDEFINE_EVENT(REHex::EV_TYPES_CHANGED,       wxCommandEvent);
 wxDEFINE_EVENT(REHex::EV_MAPPINGS_CHANGED,    wxCommandEvent);
+wxDEFINE_EVENT(REHex::EV_SKIP_RANGES_CHANGED, wxCommandEvent);
 
 REHex::Document::Document():
 	write_protect(false),
+	data_version(0),
 	current_seq(0),
 	buffer_seq(0),
 	saved_seq(0),
@@ -64,7 +66,8 @@ REHex::Document::Document():
 	comment_modified_buffer(this, EV_COMMENT_MODIFIED),
 	highlights_changed_buffer(this, EV_HIGHLIGHTS_CHANGED),
 	types_changed_buffer(this, EV_TYPES_CHANGED),
-	mappings_changed_buffer(this, EV_MAPPINGS_CHANGED)
+	mappings_changed_buffer(this, EV_MAPPINGS_CHANGED),
+	data_change_buffer(this)
 {
 	buffer = new Buffer();
 	title  = "Untitled";
@@ -77,6 +80,7 @@ REHex::Document::Document():
 REHex::Document::Document(const std::string &filename):
 	filename(filename),
 	write_protect(false),
+	data_version(0),
 	current_seq(0),
 	buffer_seq(0),
 	saved_seq(0),
@@ -85,7 +89,8 @@ REHex::Document::Document(const std::string &filename):
 	comment_modified_buffer(this, EV_COMMENT_MODIFIED),
 	highlights_changed_buffer(this, EV_HIGHLIGHTS_CHANGED),
 	types_changed_buffer(this, EV_TYPES_CHANGED),
-	mappings_changed_buffer(this, EV_MAPPINGS_CHANGED)
+	mappings_changed_buffer(this, EV_MAPPINGS_CHANGED),
+	data_change_buffer(this)
 {
 	buffer = new Buffer(filename);
 	
@@ -106,6 +111,81 @@ REHex::Document::Document(const std::string &filename):
 	wxGetApp().Bind(PALETTE_CHANGED, &REHex::Document::OnColourPaletteChanged, this);
 }
 
+REHex::Document::Document(const std::vector<std::string> &filenames):
+	write_protect(true),
+	data_version(0),
+	current_seq(0),
+	buffer_seq(0),
+	saved_seq(0),
+	highlight_colour_map(HighlightColourMap::defaults()),
+	cursor_state(CSTATE_HEX),
+	comment_modified_buffer(this, EV_COMMENT_MODIFIED),
+	highlights_changed_buffer(this, EV_HIGHLIGHTS_CHANGED),
+	types_changed_buffer(this, EV_TYPES_CHANGED),
+	mappings_changed_buffer(this, EV_MAPPINGS_CHANGED),
+	data_change_buffer(this)
+{
+	/* The files are opened read only and there is no single filename to save to, so the
+	 * document is write protected and can only be saved to a new file.
+	*/
+	
+	buffer = new Buffer(filenames);
+	
+	data_seq.set_range   (0, buffer->length(), 0);
+	types.set_range      (0, buffer->length(), TypeInfo(""));
+	
+	if(filenames.empty())
+	{
+		title = "Untitled";
+	}
+	else{
+		size_t last_slash = filenames.front().find_last_of("/\\");
+		title = (last_slash != std::string::npos ? filenames.front().substr(last_slash + 1) : filenames.front());
+		
+		if(filenames.size() > 1)
+		{
+			title += " (+" + std::to_string(filenames.size() - 1) + " more)";
+		}
+	}
+	
+	_forward_buffer_events();
+	
+	wxGetApp().Bind(PALETTE_CHANGED, &REHex::Document::OnColourPaletteChanged, this);
+}
+
+REHex::Document::Document(Document *parent):
+	write_protect(false),
+	data_version(0),
+	current_seq(parent->current_seq),
+	buffer_seq(parent->buffer_seq),
+	data_seq(parent->data_seq),
+	saved_seq(parent->saved_seq),
+	comments(parent->comments),
+	highlight_colour_map(parent->highlight_colour_map),
+	highlights(parent->highlights),
+	types(parent->types),
+	real_to_virt_segs(parent->real_to_virt_segs),
+	virt_to_real_segs(parent->virt_to_real_segs),
+	cpos_off(parent->cpos_off),
+	cursor_state(parent->cursor_state),
+	comment_modified_buffer(this, EV_COMMENT_MODIFIED),
+	highlights_changed_buffer(this, EV_HIGHLIGHTS_CHANGED),
+	types_changed_buffer(this, EV_TYPES_CHANGED),
+	mappings_changed_buffer(this, EV_MAPPINGS_CHANGED),
+	data_change_buffer(this)
+{
+	/* The fork has no filename of its own, so it can only be saved to a new file and won't
+	 * ever overwrite the file of the parent. The undo history isn't carried over.
+	*/
+	
+	buffer = new Buffer(parent->buffer);
+	title  = parent->title + " (fork)";
+	
+	_forward_buffer_events();
+	
+	wxGetApp().Bind(PALETTE_CHANGED, &REHex::Document::OnColourPaletteChanged, this);
+}
+
 void REHex::Document::_forward_buffer_events()
 {
 	buffer->Bind(BACKING_FILE_DELETED, [&](wxCommandEvent &event)
@@ -180,8 +260,14 @@ void REHex::Document::reload()
 	OffsetLengthEvent data_overwriting_event(this, DATA_OVERWRITING, 0, overlap_size);
 	ProcessEvent(data_overwriting_event);
 	
-	delete buffer;
-	buffer = new_buffer;
+	{
+		std::lock_guard<std::mutex> dl(data_version_lock);
+		
+		delete buffer;
+		buffer = new_buffer;
+		
+		_log_data_change(DataChange::OVERWRITE, 0, overlap_size);
+	}
 	
 	_forward_buffer_events();
 	
@@ -196,6 +282,16 @@ void REHex::Document::reload()
 		OffsetLengthEvent data_inserting_event(this, DATA_INSERTING, old_size, new_size - old_size);
 		ProcessEvent(data_inserting_event);
 		
+		{
+			/* The data is already in the new buffer, but any snapshots taken since the
+			 * buffer was swapped were given the previous version, so this is still the
+			 * right point to log the insertion.
+			*/
+			
+			std::lock_guard<std::mutex> dl(data_version_lock);
+			_log_data_change(DataChange::INSERT, old_size, new_size - old_size);
+		}
+		
 		OffsetLengthEvent data_insert_event(this, DATA_INSERT, old_size, new_size - old_size);
 		ProcessEvent(data_insert_event);
 	}
@@ -210,6 +306,7 @@ void REHex::Document::reload()
 	
 	undo_stack.clear();
 	redo_stack.clear();
+	end_typing_session();
 	
 	comments.clear();
 	highlights.clear();
@@ -243,6 +340,11 @@ void REHex::Document::reload()
 
 void REHex::Document::save()
 {
+	if(filename.empty())
+	{
+		throw std::logic_error("Attempt to save document with no backing file");
+	}
+	
 	bool externally_changed = file_deleted() || file_modified();
 	
 	if(is_buffer_dirty() || externally_changed)
@@ -252,6 +354,9 @@ void REHex::Document::save()
 	
 	_save_metadata(filename + ".rehex-meta");
 	
+	/* Changes made after saving can't be merged into an undo step from before. */
+	end_typing_session();
+	
 	if(current_seq != saved_seq || externally_changed)
 	{
 		saved_seq = current_seq;
@@ -274,6 +379,9 @@ void REHex::Document::save(const std::string &filename)
 	
 	_save_metadata(filename + ".rehex-meta");
 	
+	/* Changes made after saving can't be merged into an undo step from before. */
+	end_typing_session();
+	
 	if(current_seq != saved_seq || externally_changed)
 	{
 		saved_seq = current_seq;
@@ -351,6 +459,11 @@ REHex::Document::CursorState REHex::Document::get_cursor_state() const
 
 void REHex::Document::set_cursor_position(BitOffset off, CursorState cursor_state)
 {
+	if(off != cpos_off)
+	{
+		end_typing_session();
+	}
+	
 	_set_cursor_position(off, cursor_state);
 }
 
@@ -947,6 +1060,111 @@ off_t REHex::Document::buffer_length() const
 	return buffer->length();
 }
 
+std::shared_ptr<const REHex::Document::ReadSnapshot> REHex::Document::get_read_snapshot() const
+{
+	std::lock_guard<std::mutex> dl(data_version_lock);
+	return std::make_shared<ReadSnapshot>(buffer->snapshot(), data_version);
+}
+
+unsigned int REHex::Document::get_data_version() const
+{
+	std::lock_guard<std::mutex> dl(data_version_lock);
+	return data_version;
+}
+
+bool REHex::Document::get_data_changes(unsigned int from_version, unsigned int to_version, std::vector<DataChange> *changes) const
+{
+	assert(from_version <= to_version);
+	
+	std::lock_guard<std::mutex> dl(data_version_lock);
+	
+	assert(to_version <= data_version);
+	
+	if(from_version == to_version)
+	{
+		return true;
+	}
+	
+	if(data_changes.empty() || data_changes.front().version > (from_version + 1))
+	{
+		/* Changes have been dropped from the log. */
+		return false;
+	}
+	
+	/* Versions are sequential, so we can index straight into the log. */
+	auto begin = data_changes.begin() + (from_version + 1 - data_changes.front().version);
+	auto end   = data_changes.begin() + (to_version + 1 - data_changes.front().version);
+	
+	changes->insert(changes->end(), begin, end);
+	
+	return true;
+}
+
+void REHex::Document::apply_data_changes(ByteRangeSet *ranges, const std::vector<DataChange> &changes, bool clear_changed)
+{
+	for(auto c = changes.begin(); c != changes.end(); ++c)
+	{
+		switch(c->type)
+		{
+			case DataChange::OVERWRITE:
+				if(clear_changed)
+				{
+					ranges->clear_range(c->offset, c->length);
+				}
+				
+				break;
+			
+			case DataChange::INSERT:
+				ranges->data_inserted(c->offset, c->length);
+				
+				if(clear_changed)
+				{
+					ranges->clear_range(c->offset, c->length);
+				}
+				
+				break;
+			
+			case DataChange::ERASE:
+				ranges->data_erased(c->offset, c->length);
+				
+				break;
+		}
+	}
+}
+
+void REHex::Document::_log_data_change(DataChange::Type type, off_t offset, off_t length)
+{
+	/* Caller must hold data_version_lock. */
+	
+	++data_version;
+	data_changes.push_back(DataChange(data_version, type, offset, length));
+	
+	data_change_buffer.add(data_changes.back());
+	
+	if(data_changes.size() > MAX_DATA_CHANGES)
+	{
+		data_changes.pop_front();
+	}
+}
+
+REHex::Document::ReadSnapshot::ReadSnapshot(const std::shared_ptr<const Buffer::Snapshot> &buffer_snapshot, unsigned int version):
+	buffer_snapshot(buffer_snapshot), version(version) {}
+
+unsigned int REHex::Document::ReadSnapshot::get_version() const
+{
+	return version;
+}
+
+off_t REHex::Document::ReadSnapshot::buffer_length() const
+{
+	return buffer_snapshot->length();
+}
+
+std::vector<unsigned char> REHex::Document::ReadSnapshot::read_data(BitOffset offset, off_t max_length) const
+{
+	return buffer_snapshot->read_data(offset, max_length);
+}
+
 bool REHex::Document::file_deleted() const
 {
 	return buffer->file_deleted();
@@ -1373,6 +1591,142 @@ off_t REHex::Document::virt_to_real_offset(off_t virt_offset) const
 	}
 }
 
+size_t REHex::Document::apply_annotations(const AnnotationBatch &batch, const char *change_desc)
+{
+	if(batch.empty())
+	{
+		return 0;
+	}
+	
+	/* The batch is shared by the undo history rather than copied into each closure, and
+	 * the applied count is written by the first (and any redo) run of the change.
+	*/
+	
+	std::shared_ptr<const AnnotationBatch> shared_batch(new AnnotationBatch(batch));
+	std::shared_ptr<size_t> applied(new size_t(0));
+	
+	_tracked_change(change_desc,
+		[this, shared_batch, applied]()
+		{
+			BitOffset length = BitOffset(buffer_length(), 0);
+			size_t n_comments = 0, n_highlights = 0, n_types = 0, n_mappings = 0;
+			
+			for(auto c = shared_batch->comments.begin(); c != shared_batch->comments.end(); ++c)
+			{
+				if(c->offset < BitOffset::ZERO || c->length < BitOffset::ZERO || (c->offset + c->length) > length)
+				{
+					continue;
+				}
+				
+				if(comments.set(c->offset, c->length, c->comment))
+				{
+					++n_comments;
+				}
+			}
+			
+			for(auto h = shared_batch->highlights.begin(); h != shared_batch->highlights.end(); ++h)
+			{
+				if(h->offset < BitOffset::ZERO || h->length < BitOffset(0, 1) || (h->offset + h->length) > length
+					|| highlight_colour_map.find(h->colour_idx) == highlight_colour_map.end())
+				{
+					continue;
+				}
+				
+				highlights.set_range(h->offset, h->length, h->colour_idx);
+				++n_highlights;
+			}
+			
+			for(auto t = shared_batch->data_types.begin(); t != shared_batch->data_types.end(); ++t)
+			{
+				if(t->offset < BitOffset::ZERO || t->length <= BitOffset::ZERO || (t->offset + t->length).byte() > buffer_length())
+				{
+					continue;
+				}
+				
+				types.set_range(t->offset, t->length, t->type);
+				++n_types;
+			}
+			
+			for(auto m = shared_batch->virt_mappings.begin(); m != shared_batch->virt_mappings.end(); ++m)
+			{
+				if(m->real_offset < 0 || m->length <= 0 || (m->real_offset + m->length) > buffer_length()
+					|| real_to_virt_segs.get_range_in(m->real_offset, m->length) != real_to_virt_segs.end()
+					|| virt_to_real_segs.get_range_in(m->virt_offset, m->length) != virt_to_real_segs.end())
+				{
+					continue;
+				}
+				
+				real_to_virt_segs.set_range(m->real_offset, m->length, m->virt_offset);
+				virt_to_real_segs.set_range(m->virt_offset, m->length, m->real_offset);
+				++n_mappings;
+			}
+			
+			if(n_comments > 0)
+			{
+				_raise_comment_modified();
+			}
+			
+			if(n_highlights > 0)
+			{
+				_raise_highlights_changed();
+			}
+			
+			if(n_types > 0)
+			{
+				_raise_types_changed();
+			}
+			
+			if(n_mappings > 0)
+			{
+				_raise_mappings_changed();
+			}
+			
+			*applied = n_comments + n_highlights + n_types + n_mappings;
+		},
+		
+		[this, shared_batch]()
+		{
+			/* Comments, highlights, types and mappings are restored implicitly. */
+			
+			if(!shared_batch->comments.empty())
+			{
+				_raise_comment_modified();
+			}
+			
+			if(!shared_batch->highlights.empty())
+			{
+				_raise_highlights_changed();
+			}
+			
+			if(!shared_batch->data_types.empty())
+			{
+				_raise_types_changed();
+			}
+			
+			if(!shared_batch->virt_mappings.empty())
+			{
+				_raise_mappings_changed();
+			}
+		});
+	
+	return *applied;
+}
+
+const REHex::ByteRangeSet &REHex::Document::get_skip_ranges() const
+{
+	return skip_ranges;
+}
+
+void REHex::Document::set_skip_ranges(const ByteRangeSet &skip_ranges)
+{
+	this->skip_ranges = skip_ranges;
+	
+	wxCommandEvent event(REHex::EV_SKIP_RANGES_CHANGED);
+	event.SetEventObject(this);
+	
+	ProcessEvent(event);
+}
+
 void REHex::Document::handle_paste(wxWindow *modal_dialog_parent, const BitRangeTree<Document::Comment> &clipboard_comments)
 {
 	BitOffset cursor_pos = get_cursor_position();
@@ -1413,6 +1767,8 @@ void REHex::Document::handle_paste(wxWindow *modal_dialog_parent, const BitRange
 
 void REHex::Document::undo()
 {
+	end_typing_session();
+	
 	if(!undo_stack.empty())
 	{
 		wxGetApp().bulk_updates_freeze();
@@ -1435,22 +1791,8 @@ void REHex::Document::undo()
 		
 		cpos_off     = trans.old_cpos_off;
 		cursor_state = trans.old_cursor_state;
-		comments     = trans.old_comments;
-		highlight_colour_map = trans.old_highlight_colours;
-		highlights   = trans.old_highlights;
 		
-		if(types != trans.old_types)
-		{
-			types = trans.old_types;
-			_raise_types_changed();
-		}
-		
-		if(real_to_virt_segs != trans.old_real_to_virt_segs || virt_to_real_segs != trans.old_virt_to_real_segs)
-		{
-			real_to_virt_segs = trans.old_real_to_virt_segs;
-			virt_to_real_segs = trans.old_virt_to_real_segs;
-			_raise_mappings_changed();
-		}
+		_restore_transaction_metadata(trans);
 		
 		if(current_seq == saved_seq)
 		{
@@ -1487,8 +1829,30 @@ const char *REHex::Document::undo_desc()
 	}
 }
 
+void REHex::Document::_restore_transaction_metadata(const Transaction &trans)
+{
+	comments     = trans.old_comments;
+	highlight_colour_map = trans.old_highlight_colours;
+	highlights   = trans.old_highlights;
+	
+	if(types != trans.old_types)
+	{
+		types = trans.old_types;
+		_raise_types_changed();
+	}
+	
+	if(real_to_virt_segs != trans.old_real_to_virt_segs || virt_to_real_segs != trans.old_virt_to_real_segs)
+	{
+		real_to_virt_segs = trans.old_real_to_virt_segs;
+		virt_to_real_segs = trans.old_virt_to_real_segs;
+		_raise_mappings_changed();
+	}
+}
+
 void REHex::Document::redo()
 {
+	end_typing_session();
+	
 	if(!redo_stack.empty())
 	{
 		wxGetApp().bulk_updates_freeze();
@@ -1545,6 +1909,7 @@ void REHex::Document::reset_to_clean()
 	
 	undo_stack.clear();
 	redo_stack.clear();
+	end_typing_session();
 	_raise_undo_update();
 }
 
@@ -1554,6 +1919,21 @@ void REHex::Document::transact_begin(const std::string &desc)
 	{
 		wxGetApp().bulk_updates_freeze();
 		
+		if(typing_session.keystroke && _typing_session_continues(desc))
+		{
+			/* Another keystroke following on from the last one - add its changes to
+			 * the typing session's transaction rather than starting a new one, which
+			 * would take a copy of all the document metadata.
+			*/
+			
+			undo_stack.back().complete = false;
+			
+			typing_session.reopened = true;
+			typing_session.reopened_ops = undo_stack.back().ops.size();
+			
+			return;
+		}
+		
 		++current_seq;
 		
 		if(current_seq == saved_seq)
@@ -1573,6 +1953,10 @@ void REHex::Document::transact_begin(const std::string &desc)
 		undo_stack.emplace_back(desc, this);
 		redo_stack.clear();
 		
+		typing_session.open = typing_session.keystroke;
+		typing_session.reopened = false;
+		typing_session.seq = current_seq;
+		
 		_raise_undo_update();
 	}
 	else{
@@ -1608,11 +1992,19 @@ void REHex::Document::transact_commit()
 	
 	undo_stack.back().complete = true;
 	
-	if(current_seq == saved_seq + 1)
+	if(current_seq == saved_seq + 1 && !typing_session.reopened)
 	{
 		_raise_dirty();
 	}
 	
+	if(typing_session.open)
+	{
+		typing_session.reopened = false;
+		typing_session.end_cpos_off = cpos_off;
+		typing_session.end_cursor_state = cursor_state;
+		typing_session.end_time = wxGetUTCTimeMillis();
+	}
+	
 	while(undo_stack.size() > UNDO_MAX)
 	{
 		undo_stack.pop_front();
@@ -1628,6 +2020,50 @@ void REHex::Document::transact_rollback()
 		throw std::runtime_error("Attempted to rollback without an open transaction");
 	}
 	
+	if(typing_session.reopened)
+	{
+		/* Only back out the changes made by this keystroke, the earlier ones in the
+		 * typing session stay in its transaction.
+		 *
+		 * The metadata was only saved when the typing session began, so the whole
+		 * transaction is unwound to get back to it and then the earlier keystrokes are
+		 * replayed on top.
+		*/
+		
+		Transaction &trans = undo_stack.back();
+		
+		std::list<TransOpFunc> redo_funcs;
+		
+		for(auto undo_func = trans.ops.begin(); undo_func != trans.ops.end(); ++undo_func)
+		{
+			TransOpFunc redo_func = (*undo_func)();
+			redo_funcs.push_front(redo_func);
+		}
+		
+		_restore_transaction_metadata(trans);
+		
+		std::list<TransOpFunc> undo_funcs;
+		
+		auto redo_func = redo_funcs.begin();
+		for(size_t i = 0; i < typing_session.reopened_ops; ++i, ++redo_func)
+		{
+			TransOpFunc undo_func = (*redo_func)();
+			undo_funcs.push_front(undo_func);
+		}
+		
+		trans.ops.swap(undo_funcs);
+		trans.complete = true;
+		
+		_set_cursor_position(typing_session.end_cpos_off, typing_session.end_cursor_state);
+		
+		typing_session.reopened = false;
+		end_typing_session();
+		
+		wxGetApp().bulk_updates_thaw();
+		
+		return;
+	}
+	
 	undo();
 	
 	redo_stack.clear();
@@ -1636,6 +2072,29 @@ void REHex::Document::transact_rollback()
 	wxGetApp().bulk_updates_thaw();
 }
 
+void REHex::Document::end_typing_session()
+{
+	typing_session.open = false;
+}
+
+bool REHex::Document::_typing_session_continues(const std::string &desc) const
+{
+	if(!typing_session.open || undo_stack.empty() || !redo_stack.empty())
+	{
+		return false;
+	}
+	
+	/* The keystroke must carry on from where the last one left the cursor, and the last
+	 * keystroke's transaction must still be the most recent change.
+	*/
+	
+	return undo_stack.back().desc == desc
+		&& current_seq == typing_session.seq
+		&& cpos_off == typing_session.end_cpos_off
+		&& cursor_state == typing_session.end_cursor_state
+		&& (wxGetUTCTimeMillis() - typing_session.end_time) <= TYPING_SESSION_TIMEOUT;
+}
+
 void REHex::Document::_UNTRACKED_overwrite_data(BitOffset offset, const unsigned char *data, off_t length, const ByteRangeMap<unsigned int> &data_seq_slice)
 {
 	/* The overwrite events use byte offsets and lengths, there isn't really much reason to
@@ -1651,7 +2110,18 @@ void REHex::Document::_UNTRACKED_overwrite_data(BitOffset offset, const unsigned
 	OffsetLengthEvent data_overwriting_event(this, DATA_OVERWRITING, byte_offset, byte_length);
 	ProcessEvent(data_overwriting_event);
 	
-	bool ok = buffer->overwrite_data(offset, data, length);
+	bool ok;
+	
+	{
+		std::lock_guard<std::mutex> dl(data_version_lock);
+		
+		ok = buffer->overwrite_data(offset, data, length);
+		if(ok)
+		{
+			_log_data_change(DataChange::OVERWRITE, byte_offset, byte_length);
+		}
+	}
+	
 	assert(ok);
 	
 	if(ok)
@@ -1682,7 +2152,18 @@ void REHex::Document::_UNTRACKED_overwrite_bits(BitOffset offset, const std::vec
 	OffsetLengthEvent data_overwriting_event(this, DATA_OVERWRITING, byte_offset, byte_length);
 	ProcessEvent(data_overwriting_event);
 	
-	bool ok = buffer->overwrite_bits(offset, data);
+	bool ok;
+	
+	{
+		std::lock_guard<std::mutex> dl(data_version_lock);
+		
+		ok = buffer->overwrite_bits(offset, data);
+		if(ok)
+		{
+			_log_data_change(DataChange::OVERWRITE, byte_offset, byte_length);
+		}
+	}
+	
 	assert(ok);
 	
 	if(ok)
@@ -1707,7 +2188,18 @@ void REHex::Document::_UNTRACKED_insert_data(off_t offset, const unsigned char *
 	OffsetLengthEvent data_inserting_event(this, DATA_INSERTING, offset, length);
 	ProcessEvent(data_inserting_event);
 	
-	bool ok = buffer->insert_data(offset, data, length);
+	bool ok;
+	
+	{
+		std::lock_guard<std::mutex> dl(data_version_lock);
+		
+		ok = buffer->insert_data(offset, data, length);
+		if(ok)
+		{
+			_log_data_change(DataChange::INSERT, offset, length);
+		}
+	}
+	
 	assert(ok);
 	
 	if(ok)
@@ -1816,7 +2308,18 @@ void REHex::Document::_UNTRACKED_erase_data(off_t offset, off_t length)
 	OffsetLengthEvent data_erasing_event(this, DATA_ERASING, offset, length);
 	ProcessEvent(data_erasing_event);
 	
-	bool ok = buffer->erase_data(offset, length);
+	bool ok;
+	
+	{
+		std::lock_guard<std::mutex> dl(data_version_lock);
+		
+		ok = buffer->erase_data(offset, length);
+		if(ok)
+		{
+			_log_data_change(DataChange::ERASE, offset, length);
+		}
+	}
+	
 	assert(ok);
 	
 	if(ok)
@@ -2409,6 +2912,31 @@ bool REHex::Document::TypeInfo::operator<(const TypeInfo &rhs) const
 	}
 }
 
+void REHex::Document::AnnotationBatch::add_comment(BitOffset offset, BitOffset length, const wxString &text)
+{
+	comments.emplace_back(offset, length, Comment(text));
+}
+
+void REHex::Document::AnnotationBatch::add_highlight(BitOffset offset, BitOffset length, int colour_idx)
+{
+	highlights.emplace_back(offset, length, colour_idx);
+}
+
+void REHex::Document::AnnotationBatch::add_data_type(BitOffset offset, BitOffset length, const std::string &type, const json_t *options)
+{
+	data_types.emplace_back(offset, length, TypeInfo(type, options));
+}
+
+void REHex::Document::AnnotationBatch::add_virt_mapping(off_t real_offset, off_t virt_offset, off_t length)
+{
+	virt_mappings.emplace_back(real_offset, virt_offset, length);
+}
+
+bool REHex::Document::AnnotationBatch::empty() const
+{
+	return comments.empty() && highlights.empty() && data_types.empty() && virt_mappings.empty();
+}
+
 REHex::Document::TransOpFunc::TransOpFunc(const std::function<TransOpFunc()> &func):
 	func(func) {}
 
@@ -2536,3 +3064,100 @@ void REHex::Document::CommandEventBuffer::OnBulkUpdatesThawed(wxCommandEvent &ev
 	
 	event.Skip();
 }
+
+REHex::Document::DataChangeBuffer::DataChangeBuffer(wxEvtHandler *handler):
+	handler(handler),
+	frozen(false),
+	pending(false),
+	flush_queued(false),
+	from_version(0),
+	to_version(0),
+	moved_from(-1)
+{
+	wxGetApp().Bind(BULK_UPDATES_FROZEN, &REHex::Document::DataChangeBuffer::OnBulkUpdatesFrozen, this);
+	wxGetApp().Bind(BULK_UPDATES_THAWED, &REHex::Document::DataChangeBuffer::OnBulkUpdatesThawed, this);
+}
+
+REHex::Document::DataChangeBuffer::~DataChangeBuffer()
+{
+	wxGetApp().Unbind(BULK_UPDATES_THAWED, &REHex::Document::DataChangeBuffer::OnBulkUpdatesThawed, this);
+	wxGetApp().Unbind(BULK_UPDATES_FROZEN, &REHex::Document::DataChangeBuffer::OnBulkUpdatesFrozen, this);
+}
+
+void REHex::Document::DataChangeBuffer::add(const DataChange &change)
+{
+	if(!pending)
+	{
+		from_version = change.version - 1;
+		pending = true;
+	}
+	
+	to_version = change.version;
+	
+	/* Keep the accumulated ranges relative to the latest version of the data. */
+	
+	switch(change.type)
+	{
+		case DataChange::OVERWRITE:
+			changed.set_range(change.offset, change.length);
+			break;
+		
+		case DataChange::INSERT:
+			changed.data_inserted(change.offset, change.length);
+			changed.set_range(change.offset, change.length);
+			break;
+		
+		case DataChange::ERASE:
+			changed.data_erased(change.offset, change.length);
+			break;
+	}
+	
+	if(change.type != DataChange::OVERWRITE && (moved_from < 0 || change.offset < moved_from))
+	{
+		moved_from = change.offset;
+	}
+	
+	if(!frozen && !flush_queued)
+	{
+		/* Changes made outside of a transaction are raised together at the end of
+		 * the current event loop iteration.
+		*/
+		
+		flush_queued = true;
+		handler->CallAfter([this]()
+		{
+			flush_queued = false;
+			flush();
+		});
+	}
+}
+
+void REHex::Document::DataChangeBuffer::flush()
+{
+	if(!pending || frozen)
+	{
+		return;
+	}
+	
+	DataChangesEvent event(handler, from_version, to_version, changed, moved_from);
+	
+	pending = false;
+	changed.clear_all();
+	moved_from = -1;
+	
+	handler->ProcessEvent(event);
+}
+
+void REHex::Document::DataChangeBuffer::OnBulkUpdatesFrozen(wxCommandEvent &event)
+{
+	frozen = true;
+	event.Skip();
+}
+
+void REHex::Document::DataChangeBuffer::OnBulkUpdatesThawed(wxCommandEvent &event)
+{
+	frozen = false;
+	flush();
+	
+	event.Skip();
+}
@@ -18,12 +18,15 @@
 #ifndef REHEX_DOCUMENT_HPP
 #define REHEX_DOCUMENT_HPP
 
+#include <deque>
 #include <functional>
 #include <jansson.h>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <stdint.h>
 #include <utility>
+#include <vector>
 #include <wx/dataobj.h>
 #include <wx/wx.h>
 
@@ -47,6 +50,7 @@ namespace REHex {
 	wxDECLARE_EVENT(EV_HIGHLIGHTS_CHANGED,  wxCommandEvent);
 	wxDECLARE_EVENT(EV_TYPES_CHANGED,       wxCommandEvent);
 	wxDECLARE_EVENT(EV_MAPPINGS_CHANGED,    wxCommandEvent);
+	wxDECLARE_EVENT(EV_SKIP_RANGES_CHANGED, wxCommandEvent);
 	
 	/**
 	 * @brief Data and metadata of an open file.
@@ -121,6 +125,133 @@ namespace REHex {
 				bool operator<(const TypeInfo &rhs) const;
 			};
 			
+			/**
+			 * @brief A set of comments, highlights, data types and virtual address mappings.
+			 *
+			 * Used for applying a large number of annotations (e.g. from parsing the
+			 * headers of a file) in one step. See apply_annotations().
+			*/
+			struct AnnotationBatch
+			{
+				struct CommentAnnotation
+				{
+					BitOffset offset;
+					BitOffset length;
+					Comment comment;
+					
+					CommentAnnotation(BitOffset offset, BitOffset length, const Comment &comment):
+						offset(offset), length(length), comment(comment) {}
+				};
+				
+				struct HighlightAnnotation
+				{
+					BitOffset offset;
+					BitOffset length;
+					int colour_idx;
+					
+					HighlightAnnotation(BitOffset offset, BitOffset length, int colour_idx):
+						offset(offset), length(length), colour_idx(colour_idx) {}
+				};
+				
+				struct DataTypeAnnotation
+				{
+					BitOffset offset;
+					BitOffset length;
+					TypeInfo type;
+					
+					DataTypeAnnotation(BitOffset offset, BitOffset length, const TypeInfo &type):
+						offset(offset), length(length), type(type) {}
+				};
+				
+				struct VirtMappingAnnotation
+				{
+					off_t real_offset;
+					off_t virt_offset;
+					off_t length;
+					
+					VirtMappingAnnotation(off_t real_offset, off_t virt_offset, off_t length):
+						real_offset(real_offset), virt_offset(virt_offset), length(length) {}
+				};
+				
+				std::vector<CommentAnnotation> comments;
+				std::vector<HighlightAnnotation> highlights;
+				std::vector<DataTypeAnnotation> data_types;
+				std::vector<VirtMappingAnnotation> virt_mappings;
+				
+				void add_comment(BitOffset offset, BitOffset length, const wxString &text);
+				void add_highlight(BitOffset offset, BitOffset length, int colour_idx);
+				void add_data_type(BitOffset offset, BitOffset length, const std::string &type, const json_t *options = NULL);
+				void add_virt_mapping(off_t real_offset, off_t virt_offset, off_t length);
+				
+				bool empty() const;
+			};
+			
+			/**
+			 * @brief A change to the data in a Document.
+			 *
+			 * Every change to the data is assigned a new data version number. Each
+			 * change corresponds to one DATA_OVERWRITE, DATA_INSERT or DATA_ERASE
+			 * event, raised in the same order as the changes are made.
+			*/
+			struct DataChange
+			{
+				enum Type
+				{
+					OVERWRITE,
+					INSERT,
+					ERASE,
+				};
+				
+				unsigned int version;  /**< Data version after this change. */
+				Type type;
+				off_t offset;
+				off_t length;
+				
+				DataChange(unsigned int version, Type type, off_t offset, off_t length):
+					version(version), type(type), offset(offset), length(length) {}
+			};
+			
+			/**
+			 * @brief Immutable view of the data in a Document at a point in time.
+			 *
+			 * Background workers can read from a ReadSnapshot without being affected
+			 * by (or having to pause for) changes made to the Document afterwards, and
+			 * then use the change log (see get_data_changes()) to map any results from
+			 * the snapshot's version to the current one.
+			 *
+			 * ReadSnapshot objects are safe to read from any thread.
+			*/
+			class ReadSnapshot
+			{
+				public:
+					ReadSnapshot(const std::shared_ptr<const Buffer::Snapshot> &buffer_snapshot, unsigned int version);
+					
+					/**
+					 * @brief Get the data version this snapshot was taken at.
+					*/
+					unsigned int get_version() const;
+					
+					/**
+					 * @brief Get the length of the data in the snapshot.
+					*/
+					off_t buffer_length() const;
+					
+					/**
+					 * @brief Read some data from the snapshot.
+					 * @see Buffer::Snapshot::read_data()
+					*/
+					std::vector<unsigned char> read_data(BitOffset offset, off_t max_length) const;
+				
+				private:
+					std::shared_ptr<const Buffer::Snapshot> buffer_snapshot;
+					unsigned int version;
+			};
+			
+			/**
+			 * @brief Maximum number of changes kept in the data change log.
+			*/
+			static const size_t MAX_DATA_CHANGES = 4096;
+			
 			/**
 			 * @brief Create a Document for a new file.
 			*/
@@ -131,6 +262,24 @@ namespace REHex {
 			*/
 			Document(const std::string &filename);
 			
+			/**
+			 * @brief Create a Document from several files on disk joined end to end.
+			 *
+			 * Used for opening split images. The files are only read from, so the
+			 * document starts write protected and has no filename.
+			*/
+			Document(const std::vector<std::string> &filenames);
+			
+			/**
+			 * @brief Create a copy-on-write fork of another Document.
+			 *
+			 * The new Document starts with the same data, metadata and cursor
+			 * position as the parent, sharing the parent's Buffer data until it is
+			 * modified by either Document. The fork has no filename, so it must be
+			 * saved to a new file.
+			*/
+			Document(Document *parent);
+			
 			~Document();
 			
 			/**
@@ -300,6 +449,42 @@ namespace REHex {
 			off_t real_to_virt_offset(off_t real_offset) const;
 			off_t virt_to_real_offset(off_t virt_offset) const;
 			
+			/**
+			 * @brief Apply a batch of annotations to the file.
+			 *
+			 * @param batch        Comments, highlights, data types and mappings to apply.
+			 * @param change_desc  Description of change for undo history.
+			 *
+			 * All annotations in the batch are applied as a single undoable change
+			 * and each kind of metadata only raises its change event once, rather
+			 * than once per annotation as when calling set_comment(), etc.
+			 *
+			 * Any annotation which the equivalent set_XXX() method would reject (out
+			 * of range, straddling an existing comment, overlapping an existing
+			 * mapping) is skipped.
+			 *
+			 * Returns the number of annotations which were applied.
+			*/
+			size_t apply_annotations(const AnnotationBatch &batch, const char *change_desc = "apply annotations");
+			
+			/**
+			 * @brief Get the ranges of the file which searches should skip over.
+			*/
+			const ByteRangeSet &get_skip_ranges() const;
+			
+			/**
+			 * @brief Set the ranges of the file which searches should skip over.
+			 *
+			 * Tools which identify uninteresting data (e.g. blocks belonging to known
+			 * files in a disk image) can publish it here so the search and strings
+			 * tools ignore it. The ranges aren't saved or tracked in the undo history
+			 * and aren't adjusted when data is inserted or erased, whoever set them
+			 * is responsible for replacing them when the data changes.
+			 *
+			 * Raises EV_SKIP_RANGES_CHANGED.
+			*/
+			void set_skip_ranges(const ByteRangeSet &skip_ranges);
+			
 			void handle_paste(wxWindow *modal_dialog_parent, const BitRangeTree<Document::Comment> &clipboard_comments);
 			
 			/**
@@ -327,6 +512,21 @@ namespace REHex {
 			*/
 			void reset_to_clean();
 			
+			/**
+			 * @brief Maximum time between keystrokes in one typing session, in milliseconds.
+			*/
+			static const int TYPING_SESSION_TIMEOUT = 2000;
+			
+			/**
+			 * @brief Close the current typing session.
+			 *
+			 * The next keystroke will start a new undo step even if it follows on
+			 * from the last one.
+			 *
+			 * @see ScopedKeystroke
+			*/
+			void end_typing_session();
+			
 			json_t *serialise_metadata() const;
 			void load_metadata(const json_t *metadata);
 			
@@ -378,10 +578,49 @@ namespace REHex {
 			
 			void transact_step(const TransOpFunc &op, const std::string &desc);
 			
+			struct TypingSession
+			{
+				bool keystroke;        /* A ScopedKeystroke is active. */
+				bool open;             /* Transaction at the top of undo_stack may be extended. */
+				bool reopened;         /* Transaction at the top of undo_stack was re-opened by a keystroke. */
+				size_t reopened_ops;   /* Number of ops in the transaction before it was re-opened. */
+				
+				unsigned int seq;
+				BitOffset end_cpos_off;
+				CursorState end_cursor_state;
+				wxLongLong end_time;
+				
+				TypingSession():
+					keystroke(false),
+					open(false),
+					reopened(false),
+					reopened_ops(0),
+					seq(0),
+					end_cursor_state(CSTATE_HEX),
+					end_time(0) {}
+			};
+			
+			TypingSession typing_session;
+			
+			bool _typing_session_continues(const std::string &desc) const;
+			
+			/* Restore the comments, highlights, types and mappings saved when a
+			 * Transaction was started.
+			*/
+			void _restore_transaction_metadata(const Transaction &trans);
+			
+			friend class ScopedKeystroke;
+			
 			Buffer *buffer;
 			std::string filename;
 			bool write_protect;
 			
+			mutable std::mutex data_version_lock;  /* Protects buffer pointer, data_version and data_changes. */
+			unsigned int data_version;
+			std::deque<DataChange> data_changes;
+			
+			void _log_data_change(DataChange::Type type, off_t offset, off_t length);
+			
 			void _forward_buffer_events();
 			
 			unsigned int current_seq;
@@ -397,6 +636,8 @@ namespace REHex {
 			ByteRangeMap<off_t> real_to_virt_segs;
 			ByteRangeMap<off_t> virt_to_real_segs;
 			
+			ByteRangeSet skip_ranges;
+			
 			std::string title;
 			
 			BitOffset cpos_off;
@@ -478,6 +719,34 @@ namespace REHex {
 			CommandEventBuffer mappings_changed_buffer;
 			void _raise_mappings_changed();
 			
+			/* Accumulates changes to the data so a single DATA_CHANGES event can be
+			 * raised for them once bulk updates are thawed or on the next pass of the
+			 * event loop, whichever comes first.
+			*/
+			class DataChangeBuffer
+			{
+				public:
+					DataChangeBuffer(wxEvtHandler *handler);
+					~DataChangeBuffer();
+					
+					void add(const DataChange &change);
+					void flush();
+				
+				private:
+					wxEvtHandler *handler;
+					
+					bool frozen, pending, flush_queued;
+					
+					unsigned int from_version, to_version;
+					ByteRangeSet changed;
+					off_t moved_from;
+					
+					void OnBulkUpdatesFrozen(wxCommandEvent &event);
+					void OnBulkUpdatesThawed(wxCommandEvent &event);
+			};
+			
+			DataChangeBuffer data_change_buffer;
+			
 			void OnColourPaletteChanged(wxCommandEvent &event);
 			
 		public:
@@ -498,6 +767,44 @@ namespace REHex {
 			*/
 			off_t buffer_length() const;
 			
+			/**
+			 * @brief Take a read-only snapshot of the current data.
+			 *
+			 * This method is thread-safe.
+			*/
+			std::shared_ptr<const ReadSnapshot> get_read_snapshot() const;
+			
+			/**
+			 * @brief Get the current data version.
+			 *
+			 * This method is thread-safe.
+			*/
+			unsigned int get_data_version() const;
+			
+			/**
+			 * @brief Get the changes made to the data between two versions.
+			 *
+			 * @param from_version  Version to get changes since.
+			 * @param to_version    Version to get changes up to (inclusive).
+			 * @param changes       Vector to append the changes to, oldest first.
+			 *
+			 * Returns false if the log doesn't go back far enough to cover all the
+			 * changes since from_version. This method is thread-safe.
+			*/
+			bool get_data_changes(unsigned int from_version, unsigned int to_version, std::vector<DataChange> *changes) const;
+			
+			/**
+			 * @brief Adjust a set of ranges for a series of changes to the data.
+			 *
+			 * @param ranges         Set of ranges to adjust.
+			 * @param changes        Changes to apply, oldest first.
+			 * @param clear_changed  Remove any ranges which were overwritten or inserted.
+			 *
+			 * Ranges are moved and split by insertions and erasures in the same way as
+			 * ByteRangeSet::data_inserted() and ByteRangeSet::data_erased().
+			*/
+			static void apply_data_changes(ByteRangeSet *ranges, const std::vector<DataChange> &changes, bool clear_changed);
+			
 			/**
 			 * @brief Returns true if the backing file has been deleted.
 			*/
@@ -687,6 +994,33 @@ namespace REHex {
 				committed = true;
 			}
 	};
+	
+	/**
+	 * @brief RAII-style marker for Document changes made by typing.
+	 *
+	 * Transactions started while a ScopedKeystroke exists belong to a typing session. If
+	 * the last transaction was also made by a keystroke with the same description, the
+	 * cursor hasn't moved since and it was less than TYPING_SESSION_TIMEOUT ms ago, that
+	 * transaction is re-opened and extended rather than a new one being created, so a run
+	 * of typing is a single step in the undo history.
+	*/
+	class ScopedKeystroke
+	{
+		private:
+			Document *doc;
+		
+		public:
+			ScopedKeystroke(Document *doc):
+				doc(doc)
+			{
+				doc->typing_session.keystroke = true;
+			}
+			
+			~ScopedKeystroke()
+			{
+				doc->typing_session.keystroke = false;
+			}
+	};
 }
 
 #endif /* !REHEX_DOCUMENT_HPP */
@@ -16,6 +16,7 @@
 */
 
 #include "platform.hpp"
+#include <algorithm>
 #include <exception>
 #include <limits>
 #include <memory>
@@ -73,7 +74,9 @@ enum {
 	ID_SHOW_ASCII,
 	ID_SEARCH_TEXT,
 	ID_SEARCH_BSEQ,
+	ID_SEARCH_APPROX_BSEQ,
 	ID_SEARCH_VALUE,
+	ID_SEARCH_INDEX,
 	ID_COMPARE_FILE,
 	ID_COMPARE_SELECTION,
 	ID_GOTO_OFFSET,
@@ -106,6 +109,8 @@ enum {
 	ID_IMPORT_HEX,
 	ID_EXPORT_HEX,
 	ID_AUTO_RELOAD,
+	ID_FORK_DOCUMENT,
+	ID_OPEN_SPLIT,
 	
 	ID_SET_COMMENT_CURSOR,
 	ID_SET_COMMENT_SELECTION,
@@ -129,10 +134,12 @@ BEGIN_EVENT_TABLE(REHex::MainWindow, wxFrame)
 	
 	EVT_MENU(wxID_NEW,        REHex::MainWindow::OnNew)
 	EVT_MENU(wxID_OPEN,       REHex::MainWindow::OnOpen)
+	EVT_MENU(ID_OPEN_SPLIT,   REHex::MainWindow::OnOpenSplit)
 	EVT_MENU(wxID_SAVE,       REHex::MainWindow::OnSave)
 	EVT_MENU(wxID_SAVEAS,     REHex::MainWindow::OnSaveAs)
 	EVT_MENU(wxID_REFRESH,    REHex::MainWindow::OnReload)
 	EVT_MENU(ID_AUTO_RELOAD,  REHex::MainWindow::OnAutoReload)
+	EVT_MENU(ID_FORK_DOCUMENT, REHex::MainWindow::OnForkDocument)
 	EVT_MENU(ID_IMPORT_HEX,   REHex::MainWindow::OnImportHex)
 	EVT_MENU(ID_EXPORT_HEX,   REHex::MainWindow::OnExportHex)
 	EVT_MENU(wxID_CLOSE,      REHex::MainWindow::OnClose)
@@ -165,7 +172,9 @@ BEGIN_EVENT_TABLE(REHex::MainWindow, wxFrame)
 	
 	EVT_MENU(ID_SEARCH_TEXT, REHex::MainWindow::OnSearchText)
 	EVT_MENU(ID_SEARCH_BSEQ,  REHex::MainWindow::OnSearchBSeq)
+	EVT_MENU(ID_SEARCH_APPROX_BSEQ, REHex::MainWindow::OnSearchApproxBSeq)
 	EVT_MENU(ID_SEARCH_VALUE,  REHex::MainWindow::OnSearchValue)
+	EVT_MENU(ID_SEARCH_INDEX,  REHex::MainWindow::OnSearchIndex)
 	
 	EVT_MENU(ID_COMPARE_FILE,       REHex::MainWindow::OnCompareFile)
 	EVT_MENU(ID_COMPARE_SELECTION,  REHex::MainWindow::OnCompareSelection)
@@ -274,6 +283,8 @@ REHex::MainWindow::MainWindow(const wxSize& size):
 		recent_files_menu = new wxMenu;
 		file_menu->AppendSubMenu(recent_files_menu, "Open &Recent");
 		
+		file_menu->Append(ID_OPEN_SPLIT, "Open S&plit Image...", "Open several files joined together as one document");
+		
 		file_menu->Append(wxID_SAVE,   "&Save");
 		file_menu->Append(wxID_SAVEAS, "&Save As");
 		
@@ -284,6 +295,10 @@ REHex::MainWindow::MainWindow(const wxSize& size):
 		
 		file_menu->AppendSeparator(); /* ---- */
 		
+		file_menu->Append(ID_FORK_DOCUMENT, "&Fork Document", "Open a copy of the document in a new tab to make changes to without affecting the original");
+		
+		file_menu->AppendSeparator(); /* ---- */
+		
 		file_menu->Append(ID_IMPORT_HEX, "&Import Intel Hex File");
 		file_menu->Append(ID_EXPORT_HEX, "E&xport Intel Hex File");
 		
@@ -335,7 +350,9 @@ REHex::MainWindow::MainWindow(const wxSize& size):
 		
 		edit_menu->Append(ID_SEARCH_TEXT,  "Search for text...");
 		edit_menu->Append(ID_SEARCH_BSEQ,  "Search for byte sequence...");
+		edit_menu->Append(ID_SEARCH_APPROX_BSEQ, "Search for approximate byte sequence...");
 		edit_menu->Append(ID_SEARCH_VALUE, "Search for value...");
+		edit_menu->AppendCheckItem(ID_SEARCH_INDEX, "Index file for faster searching", "Index the file in the background to speed up text and byte sequence searches");
 		
 		edit_menu->AppendSeparator(); /* ---- */
 		
@@ -688,6 +705,54 @@ REHex::Tab *REHex::MainWindow::open_file(const std::string &filename)
 	return tab;
 }
 
+REHex::Tab *REHex::MainWindow::open_split_image(const std::vector<std::string> &filenames)
+{
+	Tab *tab;
+	try {
+		SharedDocumentPointer doc(SharedDocumentPointer::make(filenames));
+		tab = new Tab(notebook, doc);
+	}
+	catch(const std::exception &e)
+	{
+		wxMessageBox(
+			std::string("Error opening split image:\n") + e.what(),
+			"Error", wxICON_ERROR, this);
+		return NULL;
+	}
+	
+	notebook->AddPage(tab, tab->doc->get_title(), true);
+	tab->doc_ctrl->SetFocus();
+	
+	TabCreatedEvent event(this, tab);
+	wxPostEvent(this, event);
+	
+	return tab;
+}
+
+REHex::Tab *REHex::MainWindow::fork_document(Tab *parent)
+{
+	Tab *tab;
+	try {
+		SharedDocumentPointer doc(SharedDocumentPointer::make_fork(parent->doc));
+		tab = new Tab(notebook, doc);
+	}
+	catch(const std::exception &e)
+	{
+		wxMessageBox(
+			std::string("Error forking ") + parent->doc->get_title() + ":\n" + e.what(),
+			"Error", wxICON_ERROR, this);
+		return NULL;
+	}
+	
+	notebook->AddPage(tab, tab->doc->get_title(), true);
+	tab->doc_ctrl->SetFocus();
+	
+	TabCreatedEvent event(this, tab);
+	wxPostEvent(this, event);
+	
+	return tab;
+}
+
 REHex::Tab *REHex::MainWindow::import_hex_file(const std::string &filename)
 {
 	Tab *tab;
@@ -837,6 +902,38 @@ void REHex::MainWindow::OnOpen(wxCommandEvent &event)
 	open_file(filename);
 }
 
+void REHex::MainWindow::OnOpenSplit(wxCommandEvent &event)
+{
+	wxFileDialog openFileDialog(this, "Open Split Image", wxGetApp().get_last_directory(), "", "", wxFD_OPEN | wxFD_FILE_MUST_EXIST | wxFD_MULTIPLE);
+	if(openFileDialog.ShowModal() == wxID_CANCEL)
+		return;
+	
+	wxArrayString paths;
+	openFileDialog.GetPaths(paths);
+	
+	/* The order of the selected files isn't defined, the parts of split images are
+	 * normally numbered, so join them in order of their names.
+	*/
+	
+	std::vector<std::string> filenames;
+	for(auto p = paths.begin(); p != paths.end(); ++p)
+	{
+		filenames.push_back(p->ToStdString());
+	}
+	
+	std::sort(filenames.begin(), filenames.end());
+	
+	if(!filenames.empty())
+	{
+		wxFileName wxfn(filenames.front());
+		wxString dirname = wxfn.GetPath();
+		
+		wxGetApp().set_last_directory(dirname.ToStdString());
+	}
+	
+	open_split_image(filenames);
+}
+
 void REHex::MainWindow::OnRecentOpen(wxCommandEvent &event)
 {
 	wxFileHistory *recent_files = wxGetApp().recent_files;
@@ -930,6 +1027,11 @@ void REHex::MainWindow::OnAutoReload(wxCommandEvent &event)
 	tab->set_auto_reload(event.IsChecked());
 }
 
+void REHex::MainWindow::OnForkDocument(wxCommandEvent &event)
+{
+	fork_document(active_tab());
+}
+
 void REHex::MainWindow::OnImportHex(wxCommandEvent &event)
 {
 	std::string dir;
@@ -1245,6 +1347,7 @@ void REHex::MainWindow::OnSearchText(wxCommandEvent &event)
 	assert(tab != NULL);
 	
 	REHex::Search::Text *sd = new REHex::Search::Text(tab, tab->doc);
+	sd->set_index(tab->get_search_index());
 	sd->Show(true);
 	
 	tab->search_dialog_register(sd);
@@ -1259,6 +1362,21 @@ void REHex::MainWindow::OnSearchBSeq(wxCommandEvent &event)
 	assert(tab != NULL);
 	
 	REHex::Search::ByteSequence *sd = new REHex::Search::ByteSequence(tab, tab->doc);
+	sd->set_index(tab->get_search_index());
+	sd->Show(true);
+	
+	tab->search_dialog_register(sd);
+}
+
+void REHex::MainWindow::OnSearchApproxBSeq(wxCommandEvent &event)
+{
+	wxWindow *cpage = notebook->GetCurrentPage();
+	assert(cpage != NULL);
+	
+	auto tab = dynamic_cast<Tab*>(cpage);
+	assert(tab != NULL);
+	
+	REHex::Search::ApproxByteSequence *sd = new REHex::Search::ApproxByteSequence(tab, tab->doc);
 	sd->Show(true);
 	
 	tab->search_dialog_register(sd);
@@ -1278,6 +1396,12 @@ void REHex::MainWindow::OnSearchValue(wxCommandEvent &event)
 	tab->search_dialog_register(sd);
 }
 
+void REHex::MainWindow::OnSearchIndex(wxCommandEvent &event)
+{
+	Tab *tab = active_tab();
+	tab->set_search_index_enabled(event.IsChecked());
+}
+
 void REHex::MainWindow::OnCompareFile(wxCommandEvent &event)
 {
 	Tab *tab = active_tab();
@@ -1865,6 +1989,7 @@ void REHex::MainWindow::OnDocumentChange(wxAuiNotebookEvent& event)
 	
 	edit_menu->Check(ID_OVERWRITE_MODE, !tab->doc_ctrl->get_insert_mode());
 	edit_menu->Check(ID_WRITE_PROTECT, tab->doc->get_write_protect());
+	edit_menu->Check(ID_SEARCH_INDEX, tab->get_search_index_enabled());
 	view_menu->Check(ID_SHOW_OFFSETS, tab->doc_ctrl->get_show_offsets());
 	view_menu->Check(ID_SHOW_ASCII,   tab->doc_ctrl->get_show_ascii());
 	
@@ -2798,9 +2923,11 @@ std::vector<REHex::WindowCommand> REHex::MainWindow::get_template_commands()
 	return std::vector<WindowCommand>({
 		WindowCommand( "file_new",           "New",           wxID_NEW,         wxACCEL_CTRL, 'N' ),
 		WindowCommand( "file_open",          "Open",          wxID_OPEN,        wxACCEL_CTRL, 'O' ),
+		WindowCommand( "file_open_split",    "Open split image", ID_OPEN_SPLIT                    ),
 		WindowCommand( "file_save",          "Save",          wxID_SAVE,        wxACCEL_CTRL, 'S' ),
 		WindowCommand( "file_save_as",       "Save as",       wxID_SAVEAS                         ),
 		WindowCommand( "file_reload",        "Reload",        wxID_REFRESH                        ),
+		WindowCommand( "file_fork",          "Fork document", ID_FORK_DOCUMENT                    ),
 		WindowCommand( "file_close",         "Close",         wxID_CLOSE,       wxACCEL_CTRL, 'W' ),
 		WindowCommand( "file_close_all",     "Close all",     ID_CLOSE_ALL                        ),
 		WindowCommand( "file_close_others",  "Close others",  ID_CLOSE_OTHERS                     ),
@@ -2816,7 +2943,9 @@ std::vector<REHex::WindowCommand> REHex::MainWindow::get_template_commands()
 		WindowCommand( "write_protect",      "Write protect",             ID_WRITE_PROTECT),
 		WindowCommand( "search_text",        "Search for text",           ID_SEARCH_TEXT),
 		WindowCommand( "search_bseq",        "Search for byte sequence",  ID_SEARCH_BSEQ),
+		WindowCommand( "search_approx_bseq", "Search for approximate byte sequence", ID_SEARCH_APPROX_BSEQ),
 		WindowCommand( "search_value",       "Search for value",          ID_SEARCH_VALUE),
+		WindowCommand( "search_index",       "Index file for faster searching", ID_SEARCH_INDEX),
 		WindowCommand( "compare_file",       "Compare whole file",        ID_COMPARE_FILE,       wxACCEL_CTRL,                 'K'),
 		WindowCommand( "compare_selection",  "Compare selection",         ID_COMPARE_SELECTION,  wxACCEL_CTRL | wxACCEL_SHIFT, 'K'),
 		WindowCommand( "goto_offset",        "Jump to offset",            ID_GOTO_OFFSET,        wxACCEL_CTRL,                 'G'),
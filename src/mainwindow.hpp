@@ -51,6 +51,19 @@ namespace REHex {
 			*/
 			Tab *open_file(const std::string &filename);
 			
+			/**
+			 * @brief Create a new tab with several files joined together as one document.
+			*/
+			Tab *open_split_image(const std::vector<std::string> &filenames);
+			
+			/**
+			 * @brief Create a new tab with a copy-on-write fork of an open document.
+			 *
+			 * The original document can be compared against the fork using the
+			 * DiffWindow like any other open document.
+			*/
+			Tab *fork_document(Tab *parent);
+			
 			Tab *import_hex_file(const std::string &filename);
 			
 			wxMenuBar *get_menu_bar() const;
@@ -84,11 +97,13 @@ namespace REHex {
 			
 			void OnNew(wxCommandEvent &event);
 			void OnOpen(wxCommandEvent &event);
+			void OnOpenSplit(wxCommandEvent &event);
 			void OnRecentOpen(wxCommandEvent &event);
 			void OnSave(wxCommandEvent &event);
 			void OnSaveAs(wxCommandEvent &event);
 			void OnReload(wxCommandEvent &event);
 			void OnAutoReload(wxCommandEvent &event);
+			void OnForkDocument(wxCommandEvent &event);
 			void OnImportHex(wxCommandEvent &event);
 			void OnExportHex(wxCommandEvent &event);
 			void OnClose(wxCommandEvent &event);
@@ -101,7 +116,9 @@ namespace REHex {
 			
 			void OnSearchText(wxCommandEvent &event);
 			void OnSearchBSeq(wxCommandEvent &event);
+			void OnSearchApproxBSeq(wxCommandEvent &event);
 			void OnSearchValue(wxCommandEvent &event);
+			void OnSearchIndex(wxCommandEvent &event);
 			void OnCompareFile(wxCommandEvent &event);
 			void OnCompareSelection(wxCommandEvent &event);
 			void OnGotoOffset(wxCommandEvent &event);
@@ -16,9 +16,11 @@
 */
 
 #include "platform.hpp"
+#include <algorithm>
 #include <assert.h>
 #include <cmath>
 #include <functional>
+#include <stdexcept>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
@@ -78,6 +80,7 @@ END_EVENT_TABLE()
 REHex::Search::Search(wxWindow *parent, SharedDocumentPointer &doc, const char *title):
 	wxDialog(parent, wxID_ANY, title),
 	doc(doc), range_begin(0), range_end(-1), align_to(1), align_from(0), match_found_at(-1), running(false),
+	use_candidates(false),
 	search_end_focus(NULL),
 	timer(this, ID_TIMER),
 	auto_close(false),
@@ -164,6 +167,13 @@ void REHex::Search::not_found_notification()
 	wxMessageBox("Not found", wxMessageBoxCaptionStr, (wxOK | wxICON_INFORMATION | wxCENTRE), this);
 }
 
+void REHex::Search::found_notification(off_t offset) {}
+
+std::vector<unsigned char> REHex::Search::index_query()
+{
+	return std::vector<unsigned char>();
+}
+
 void REHex::Search::limit_range(off_t range_begin, off_t range_end)
 {
 	assert(range_begin >= 0);
@@ -196,6 +206,11 @@ void REHex::Search::set_modal_parent(wxWindow *modal_parent)
 	this->modal_parent = modal_parent;
 }
 
+void REHex::Search::set_index(const std::shared_ptr<NGramIndex> &index)
+{
+	this->index = index;
+}
+
 /* This method is only used by the unit tests. */
 off_t REHex::Search::find_next(off_t from_offset, size_t window_size)
 {
@@ -245,6 +260,36 @@ void REHex::Search::begin_search(off_t sub_range_begin, off_t sub_range_end, Sea
 	
 	search_direction = direction;
 	
+	use_candidates = false;
+	
+	if(index)
+	{
+		std::vector<unsigned char> query = index_query();
+		if(!query.empty())
+		{
+			search_candidates = index->find_candidates(query);
+			use_candidates = true;
+		}
+	}
+	
+	/* Matches starting in any ranges the document says to skip (e.g. blocks belonging to
+	 * known files) aren't searched for.
+	*/
+	
+	const ByteRangeSet &skip_ranges = doc->get_skip_ranges();
+	if(!skip_ranges.empty())
+	{
+		if(!use_candidates)
+		{
+			search_candidates.clear_all();
+			search_candidates.set_range(sub_range_begin, (sub_range_end - sub_range_begin));
+			
+			use_candidates = true;
+		}
+		
+		search_candidates.clear_ranges(skip_ranges.begin(), skip_ranges.end());
+	}
+	
 	/* Number of threads to spawn */
 	unsigned int thread_count = std::thread::hardware_concurrency();
 	
@@ -349,6 +394,7 @@ void REHex::Search::OnTimer(wxTimerEvent &event)
 		if(match_found_at >= 0)
 		{
 			doc->set_cursor_position(BitOffset(match_found_at));
+			found_notification(match_found_at);
 		}
 		else{
 			size_t compare_size = test_max_window();
@@ -506,34 +552,16 @@ void REHex::Search::thread_main(size_t window_size, size_t compare_size)
 	while(running && match_found_at < 0)
 	{
 		off_t window_begin, window_end;
-		off_t at, step;
 		
 		if(search_direction == SearchDirection::FORWARDS)
 		{
 			window_begin = next_window_start.fetch_add(window_size);
 			window_end = std::min((off_t)(window_begin + window_size), search_end);
-			
-			at = window_begin;
-			if(((at - align_from) % align_to) != 0)
-			{
-				at += (align_to - ((at - align_from) % align_to));
-			}
-			
-			step = align_to;
 		}
 		else /* if(direction == SearchDirection::BACKWARDS) */
 		{
 			window_begin = next_window_start.fetch_sub(window_size);
 			window_end = std::min((off_t)(window_begin + window_size), search_end);
-			
-			at = window_end - 1;
-			if(((at - align_from) % align_to) != 0)
-			{
-				at += (align_to - ((at - align_from) % align_to));
-				at -= align_to;
-			}
-			
-			step = -align_to;
 		}
 		
 		if(window_end <= search_base || window_begin > search_end)
@@ -546,36 +574,104 @@ void REHex::Search::thread_main(size_t window_size, size_t compare_size)
 			window_begin = search_base;
 		}
 		
-		try {
-			off_t read_size = std::min(((window_end - window_begin) + (off_t)(compare_size)), (search_end - window_begin));
-			std::vector<unsigned char> window = doc->read_data(window_begin, read_size);
+		if(!use_candidates)
+		{
+			if(search_window(window_begin, window_end, compare_size))
+			{
+				return;
+			}
 			
-			size_t window_off = at - window_begin;
+			continue;
+		}
+		
+		/* Only search the parts of the window where the index says a match may start. */
+		
+		std::vector<ByteRangeSet::Range> parts;
+		
+		for(auto c = search_candidates.find_first_in(window_begin, (window_end - window_begin));
+			c != search_candidates.end() && c->offset < window_end; ++c)
+		{
+			off_t part_begin = std::max(c->offset, window_begin);
+			off_t part_end   = std::min((c->offset + c->length), window_end);
 			
-			for(; at >= window_begin && at < window_end && window_off < window.size(); at += step, window_off += step)
+			parts.push_back(ByteRangeSet::Range(part_begin, (part_end - part_begin)));
+		}
+		
+		if(search_direction == SearchDirection::BACKWARDS)
+		{
+			std::reverse(parts.begin(), parts.end());
+		}
+		
+		for(auto p = parts.begin(); p != parts.end(); ++p)
+		{
+			if(search_window(p->offset, (p->offset + p->length), compare_size))
 			{
-				size_t window_avail = window.size() - window_off;
-				assert(window_avail > 0);
+				return;
+			}
+		}
+	}
+}
+
+/* Tests each (aligned) offset from window_begin up to window_end in the search direction.
+ * Returns true if a match was found and recorded.
+*/
+bool REHex::Search::search_window(off_t window_begin, off_t window_end, size_t compare_size)
+{
+	off_t at, step;
+	
+	if(search_direction == SearchDirection::FORWARDS)
+	{
+		at = window_begin;
+		if(((at - align_from) % align_to) != 0)
+		{
+			at += (align_to - ((at - align_from) % align_to));
+		}
+		
+		step = align_to;
+	}
+	else /* if(direction == SearchDirection::BACKWARDS) */
+	{
+		at = window_end - 1;
+		if(((at - align_from) % align_to) != 0)
+		{
+			at += (align_to - ((at - align_from) % align_to));
+			at -= align_to;
+		}
+		
+		step = -align_to;
+	}
+	
+	try {
+		off_t read_size = std::min(((window_end - window_begin) + (off_t)(compare_size)), (search_end - window_begin));
+		std::vector<unsigned char> window = doc->read_data(window_begin, read_size);
+		
+		size_t window_off = at - window_begin;
+		
+		for(; at >= window_begin && at < window_end && window_off < window.size(); at += step, window_off += step)
+		{
+			size_t window_avail = window.size() - window_off;
+			assert(window_avail > 0);
+			
+			if(test((window.data() + window_off), window_avail))
+			{
+				std::unique_lock<std::mutex> l(lock);
 				
-				if(test((window.data() + window_off), window_avail))
+				if(match_found_at < 0
+					|| (search_direction == SearchDirection::FORWARDS && match_found_at > at)
+					|| (search_direction == SearchDirection::BACKWARDS && match_found_at < at))
 				{
-					std::unique_lock<std::mutex> l(lock);
-					
-					if(match_found_at < 0
-						|| (search_direction == SearchDirection::FORWARDS && match_found_at > at)
-						|| (search_direction == SearchDirection::BACKWARDS && match_found_at < at))
-					{
-						match_found_at = at;
-						return;
-					}
+					match_found_at = at;
+					return true;
 				}
 			}
 		}
-		catch(const std::exception &e)
-		{
-			fprintf(stderr, "Exception in REHex::Search::thread_main: %s\n", e.what());
-		}
 	}
+	catch(const std::exception &e)
+	{
+		fprintf(stderr, "Exception in REHex::Search::thread_main: %s\n", e.what());
+	}
+	
+	return false;
 }
 
 REHex::Search::Text::Text(wxWindow *parent, SharedDocumentPointer &doc, const wxString &search_for, bool case_sensitive, const std::string &encoding):
@@ -688,6 +784,21 @@ bool REHex::Search::Text::test(const void *data, size_t data_size)
 	return remain_cmp == 0;
 }
 
+std::vector<unsigned char> REHex::Search::Text::index_query()
+{
+	/* The index only knows about raw bytes (with ASCII case folded), so it can only be
+	 * used for the fast path where the data is compared directly.
+	*/
+	
+	if(cmp_fast_path)
+	{
+		return std::vector<unsigned char>(search_for.begin(), search_for.end());
+	}
+	else{
+		return std::vector<unsigned char>();
+	}
+}
+
 size_t REHex::Search::Text::test_max_window()
 {
 	return search_for.size();
@@ -815,6 +926,11 @@ bool REHex::Search::ByteSequence::test(const void *data, size_t data_size)
 		&& memcmp(data, search_for.data(), search_for.size()) == 0);
 }
 
+std::vector<unsigned char> REHex::Search::ByteSequence::index_query()
+{
+	return search_for;
+}
+
 size_t REHex::Search::ByteSequence::test_max_window()
 {
 	return search_for.size();
@@ -855,6 +971,265 @@ bool REHex::Search::ByteSequence::read_window_controls()
 	return true;
 }
 
+const size_t REHex::Search::ApproxByteSequence::MAX_LEVENSHTEIN_LENGTH;
+
+REHex::Search::ApproxByteSequence::ApproxByteSequence(wxWindow *parent, SharedDocumentPointer &doc, const std::vector<unsigned char> &search_for, unsigned int max_distance, Metric metric):
+	Search(parent, doc, "Search for approximate byte sequence")
+{
+	setup_window();
+	
+	set_search_for(search_for, max_distance, metric);
+}
+
+/* NOTE: end_search() is called from subclass destructor rather than base to ensure search is
+ * stopped before the subclass becomes invalid, else there is a race where the base class will try
+ * calling the subclass's test() method and trigger undefined behaviour.
+*/
+REHex::Search::ApproxByteSequence::~ApproxByteSequence()
+{
+	if(running)
+	{
+		end_search();
+	}
+}
+
+void REHex::Search::ApproxByteSequence::set_search_for(const std::vector<unsigned char> &search_for, unsigned int max_distance, Metric metric)
+{
+	if(metric == Metric::LEVENSHTEIN && search_for.size() > MAX_LEVENSHTEIN_LENGTH)
+	{
+		throw std::invalid_argument("Byte sequence is too long for edit distance search");
+	}
+	
+	this->search_for = search_for;
+	this->max_distance = max_distance;
+	this->metric = metric;
+	
+	memset(peq, 0, sizeof(peq));
+	
+	for(size_t i = 0; i < search_for.size() && i < MAX_LEVENSHTEIN_LENGTH; ++i)
+	{
+		peq[ search_for[i] ] |= ((uint64_t)(1) << i);
+	}
+}
+
+int REHex::Search::ApproxByteSequence::hamming_distance(const unsigned char *data, size_t data_size) const
+{
+	size_t length = search_for.size();
+	
+	if(data_size < length)
+	{
+		return -1;
+	}
+	
+	unsigned int mismatches = 0;
+	size_t i = 0;
+	
+	/* Compare eight bytes at a time. Each differing byte is folded down into its lowest
+	 * bit and then the bits are summed into the top byte by the multiplication.
+	*/
+	
+	for(; (i + 8) <= length; i += 8)
+	{
+		uint64_t a, b;
+		memcpy(&a, (data + i), 8);
+		memcpy(&b, (search_for.data() + i), 8);
+		
+		uint64_t x = a ^ b;
+		x |= (x >> 4);
+		x |= (x >> 2);
+		x |= (x >> 1);
+		x &= 0x0101010101010101ULL;
+		
+		mismatches += (x * 0x0101010101010101ULL) >> 56;
+		
+		if(mismatches > max_distance)
+		{
+			return -1;
+		}
+	}
+	
+	for(; i < length; ++i)
+	{
+		if(data[i] != search_for[i] && ++mismatches > max_distance)
+		{
+			return -1;
+		}
+	}
+	
+	return mismatches;
+}
+
+int REHex::Search::ApproxByteSequence::levenshtein_distance(const unsigned char *data, size_t data_size) const
+{
+	/* Myers' bit-vector algorithm, as formulated by Hyyrö, computing the edit distance
+	 * between the whole search sequence and each prefix of the data. The distance between
+	 * the sequence and the first j bytes of the data is tracked in score, the bit vectors
+	 * hold the vertical deltas of the rest of the column.
+	 *
+	 * Shifting a one into the horizontal positive delta each step anchors the match to the
+	 * start of the data, rather than allowing it to begin anywhere.
+	*/
+	
+	size_t length = search_for.size();
+	size_t max_j = std::min(data_size, (length + max_distance));
+	
+	uint64_t pv = ~(uint64_t)(0);
+	uint64_t mv = 0;
+	uint64_t high_bit = (uint64_t)(1) << (length - 1);
+	
+	unsigned int score = length;
+	int best = -1;
+	
+	for(size_t j = 0; j < max_j; ++j)
+	{
+		uint64_t eq = peq[ data[j] ];
+		
+		uint64_t xv = eq | mv;
+		uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+		
+		uint64_t ph = mv | ~(xh | pv);
+		uint64_t mh = pv & xh;
+		
+		if(ph & high_bit)
+		{
+			++score;
+		}
+		else if(mh & high_bit)
+		{
+			--score;
+		}
+		
+		ph = (ph << 1) | 1;
+		mh = (mh << 1);
+		
+		pv = mh | ~(xv | ph);
+		mv = ph & xv;
+		
+		if((j + 1 + max_distance) >= length && score <= max_distance && (best < 0 || (int)(score) < best))
+		{
+			best = score;
+		}
+	}
+	
+	return best;
+}
+
+int REHex::Search::ApproxByteSequence::distance(const void *data, size_t data_size) const
+{
+	if(search_for.empty())
+	{
+		return -1;
+	}
+	
+	if(metric == Metric::LEVENSHTEIN)
+	{
+		return levenshtein_distance((const unsigned char*)(data), data_size);
+	}
+	else{
+		return hamming_distance((const unsigned char*)(data), data_size);
+	}
+}
+
+bool REHex::Search::ApproxByteSequence::test(const void *data, size_t data_size)
+{
+	return distance(data, data_size) >= 0;
+}
+
+size_t REHex::Search::ApproxByteSequence::test_max_window()
+{
+	return metric == Metric::LEVENSHTEIN
+		? search_for.size() + max_distance
+		: search_for.size();
+}
+
+void REHex::Search::ApproxByteSequence::setup_window_controls(wxWindow *parent, wxSizer *sizer)
+{
+	{
+		wxBoxSizer *text_sizer = new wxBoxSizer(wxHORIZONTAL);
+		
+		text_sizer->Add(new wxStaticText(parent, wxID_ANY, "Data: "), 0, wxALIGN_CENTER_VERTICAL);
+		
+		search_for_tc = new wxTextCtrl(parent, wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxTE_PROCESS_ENTER);
+		text_sizer->Add(search_for_tc, 1);
+		
+		sizer->Add(text_sizer, 0, wxTOP | wxLEFT | wxRIGHT | wxEXPAND, 10);
+	}
+	
+	{
+		wxStaticBoxSizer *sz = new wxStaticBoxSizer(wxVERTICAL, parent, "Differences");
+		
+		wxBoxSizer *distance_sizer = new wxBoxSizer(wxHORIZONTAL);
+		sz->Add(distance_sizer, 0, wxTOP | wxLEFT | wxRIGHT, 5);
+		
+		distance_sizer->Add(new wxStaticText(sz->GetStaticBox(), wxID_ANY, "Allow up to "), 0, wxALIGN_CENTER_VERTICAL);
+		
+		max_distance_sc = new wxSpinCtrl(sz->GetStaticBox(), wxID_ANY, "1", wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS, 0, 63, 1);
+		distance_sizer->Add(max_distance_sc, 0, wxALIGN_CENTER_VERTICAL);
+		
+		distance_sizer->Add(new wxStaticText(sz->GetStaticBox(), wxID_ANY, " differences"), 0, wxALIGN_CENTER_VERTICAL);
+		
+		hamming_rb = new wxRadioButton(sz->GetStaticBox(), wxID_ANY, "Changed bytes only", wxDefaultPosition, wxDefaultSize, wxRB_GROUP);
+		hamming_rb->SetValue(true);
+		sz->Add(hamming_rb, 0, wxTOP | wxLEFT | wxRIGHT, 5);
+		
+		levenshtein_rb = new wxRadioButton(sz->GetStaticBox(), wxID_ANY, "Changed, inserted or deleted bytes");
+		sz->Add(levenshtein_rb, 0, wxTOP | wxLEFT | wxRIGHT, 5);
+		
+		last_match_st = new wxStaticText(sz->GetStaticBox(), wxID_ANY, "");
+		sz->Add(last_match_st, 0, wxALL | wxEXPAND, 5);
+		
+		sizer->Add(sz, 0, wxTOP | wxLEFT | wxRIGHT | wxEXPAND, 10);
+	}
+}
+
+bool REHex::Search::ApproxByteSequence::read_window_controls()
+{
+	std::string search_for_text = search_for_tc->GetValue().ToStdString();
+	
+	if(search_for_text.empty())
+	{
+		wxMessageBox("Please enter a hex string to search for", "Error", (wxOK | wxICON_EXCLAMATION | wxCENTRE), this);
+		return false;
+	}
+	
+	std::vector<unsigned char> search_for;
+	
+	try {
+		search_for = REHex::parse_hex_string(search_for_text);
+	}
+	catch(const REHex::ParseError &e) {
+		wxMessageBox(e.what(), "Error", (wxOK | wxICON_EXCLAMATION | wxCENTRE), this);
+		return false;
+	}
+	
+	unsigned int max_distance = max_distance_sc->GetValue();
+	Metric metric = levenshtein_rb->GetValue() ? Metric::LEVENSHTEIN : Metric::HAMMING;
+	
+	if(max_distance >= search_for.size())
+	{
+		wxMessageBox("The number of differences must be less than the length of the byte sequence", "Error", (wxOK | wxICON_EXCLAMATION | wxCENTRE), this);
+		return false;
+	}
+	
+	if(metric == Metric::LEVENSHTEIN && search_for.size() > MAX_LEVENSHTEIN_LENGTH)
+	{
+		wxMessageBox(("Byte sequences longer than " + std::to_string(MAX_LEVENSHTEIN_LENGTH) + " bytes can only be searched for with changed bytes"), "Error", (wxOK | wxICON_EXCLAMATION | wxCENTRE), this);
+		return false;
+	}
+	
+	set_search_for(search_for, max_distance, metric);
+	
+	return true;
+}
+
+void REHex::Search::ApproxByteSequence::found_notification(off_t offset)
+{
+	std::vector<unsigned char> data = doc->read_data(offset, test_max_window());
+	int match_distance = distance(data.data(), data.size());
+	
+	last_match_st->SetLabel(wxString::Format("Last match has %d difference(s)", match_distance));
+}
+
 REHex::Search::Value::Value(wxWindow *parent, SharedDocumentPointer &doc):
 	Search(parent, doc, "Search for value")
 {
@@ -19,7 +19,9 @@
 #define REHEX_SEARCH_HPP
 
 #include <atomic>
+#include <memory>
 #include <mutex>
+#include <stdint.h>
 #include <string>
 #include <sys/types.h>
 #include <thread>
@@ -27,11 +29,15 @@
 #include <wx/choice.h>
 #include <wx/progdlg.h>
 #include <wx/radiobut.h>
+#include <wx/spinctrl.h>
+#include <wx/stattext.h>
 #include <wx/textctrl.h>
 #include <wx/timer.h>
 
+#include "ByteRangeSet.hpp"
 #include "CharacterEncoder.hpp"
 #include "document.hpp"
+#include "NGramIndex.hpp"
 #include "NumericTextCtrl.hpp"
 #include "SharedDocumentPointer.hpp"
 
@@ -42,6 +48,7 @@ namespace REHex {
 			
 			class Text;
 			class ByteSequence;
+			class ApproxByteSequence;
 			class Value;
 			
 			static const size_t DEFAULT_WINDOW_SIZE = 2134016; /* 2MiB */
@@ -71,6 +78,14 @@ namespace REHex {
 			off_t search_base;
 			off_t search_end;
 			
+			std::shared_ptr<NGramIndex> index;
+			
+			/* Ranges which may contain a match, from the index and/or the document's
+			 * skip ranges (if use_candidates).
+			*/
+			ByteRangeSet search_candidates;
+			bool use_candidates;
+			
 			SearchDirection search_direction;
 			
 			wxTextCtrl *search_end_focus;
@@ -92,7 +107,17 @@ namespace REHex {
 			
 			virtual bool wrap_query(const char *message);
 			virtual void not_found_notification();
-			
+			virtual void found_notification(off_t offset);
+			
+			/**
+			 * @brief Get the bytes which any match must start with.
+			 *
+			 * If an index has been set, it is used to skip over any parts of the
+			 * file which can't contain these bytes. The default implementation
+			 * returns an empty vector, which searches the whole range.
+			*/
+			virtual std::vector<unsigned char> index_query();
+		
 		public:
 			void limit_range(off_t range_begin, off_t range_end);
 			void require_alignment(off_t alignment, off_t relative_to_offset = 0);
@@ -101,6 +126,11 @@ namespace REHex {
 			void set_auto_wrap(bool auto_wrap);
 			void set_modal_parent(wxWindow *modal_parent);
 			
+			/**
+			 * @brief Set an index of the document to narrow down searches with.
+			*/
+			void set_index(const std::shared_ptr<NGramIndex> &index);
+			
 			off_t find_next(off_t from_offset, size_t window_size = DEFAULT_WINDOW_SIZE);
 			void begin_search(off_t range_begin, off_t range_end, SearchDirection direction, size_t window_size = DEFAULT_WINDOW_SIZE);
 			void end_search();
@@ -120,6 +150,7 @@ namespace REHex {
 			void enable_controls();
 			bool read_base_window_controls();
 			void thread_main(size_t window_size, size_t compare_size);
+			bool search_window(off_t window_begin, off_t window_end, size_t compare_size);
 			
 		/* Stays at the bottom because it changes the protection... */
 		DECLARE_EVENT_TABLE()
@@ -151,6 +182,7 @@ namespace REHex {
 		protected:
 			virtual void setup_window_controls(wxWindow *parent, wxSizer *sizer);
 			virtual bool read_window_controls();
+			virtual std::vector<unsigned char> index_query();
 	};
 	
 	class Search::ByteSequence: public Search
@@ -170,6 +202,64 @@ namespace REHex {
 		protected:
 			virtual void setup_window_controls(wxWindow *parent, wxSizer *sizer);
 			virtual bool read_window_controls();
+			virtual std::vector<unsigned char> index_query();
+	};
+	
+	/**
+	 * @brief Search for a byte sequence with up to a given number of differences.
+	 *
+	 * Matches may have up to max_distance bytes which differ from the sequence being
+	 * searched for (Hamming distance) or, using the LEVENSHTEIN metric, up to max_distance
+	 * bytes changed, inserted or deleted (edit distance).
+	 *
+	 * Each offset is compared using bit-parallel algorithms - eight bytes at a time when
+	 * counting mismatches and Myers' bit-vector algorithm for edit distance - so a search
+	 * takes roughly as long as an exact one. Edit distance searches are limited to
+	 * sequences of MAX_LEVENSHTEIN_LENGTH bytes.
+	*/
+	class Search::ApproxByteSequence: public Search
+	{
+		public:
+			enum class Metric { HAMMING, LEVENSHTEIN };
+			
+			static const size_t MAX_LEVENSHTEIN_LENGTH = 64;
+		
+		private:
+			std::vector<unsigned char> search_for;
+			unsigned int max_distance;
+			Metric metric;
+			
+			/* Bit i of the entry for each byte value is set if search_for[i] has that value. */
+			uint64_t peq[256];
+			
+			wxTextCtrl *search_for_tc;
+			wxSpinCtrl *max_distance_sc;
+			wxRadioButton *hamming_rb, *levenshtein_rb;
+			wxStaticText *last_match_st;
+			
+			void set_search_for(const std::vector<unsigned char> &search_for, unsigned int max_distance, Metric metric);
+			
+			int hamming_distance(const unsigned char *data, size_t data_size) const;
+			int levenshtein_distance(const unsigned char *data, size_t data_size) const;
+		
+		public:
+			ApproxByteSequence(wxWindow *parent, SharedDocumentPointer &doc, const std::vector<unsigned char> &search_for = std::vector<unsigned char>(), unsigned int max_distance = 1, Metric metric = Metric::HAMMING);
+			virtual ~ApproxByteSequence();
+			
+			/**
+			 * @brief Get the distance of the closest match starting at the given data.
+			 *
+			 * Returns -1 if there is no match within max_distance.
+			*/
+			int distance(const void *data, size_t data_size) const;
+			
+			virtual bool test(const void *data, size_t data_size);
+			virtual size_t test_max_window();
+		
+		protected:
+			virtual void setup_window_controls(wxWindow *parent, wxSizer *sizer);
+			virtual bool read_window_controls();
+			virtual void found_notification(off_t offset);
 	};
 	
 	class Search::Value: public Search
@@ -177,6 +177,94 @@ TEST_F(BitmapToolTest, Format1BPPGreyscalePackedHalfScale)
 	EXPECT_EQ(bitmap_pixels, EXPECT_PIXELS);
 }
 
+TEST_F(BitmapToolTest, Format1BPPGreyscalePackedHalfScaleFiltered)
+{
+	static const unsigned char PIXEL_DATA[] = {
+		0xAA, 0xAA,
+		0x55, 0x55,
+		0xAA, 0xAA,
+		0x55, 0x55,
+		0xAA, 0xAA,
+		0x55, 0x55,
+		0xAA, 0xAA,
+		0x55, 0x55,
+		0xAA, 0xAA,
+		0x55, 0x55,
+		0xAA, 0xAA,
+		0x55, 0x55,
+		0xFF, 0xFF,
+		0xFF, 0xFF,
+		0x00, 0x00,
+		0x00, 0x00,
+	};
+	
+	/* Each pixel in the output should be the average of the 2x2 input pixels it covers rather
+	 * than just picking one of them.
+	*/
+	static const char *EXPECT_PIXELS =
+		"#808080 #808080 #808080 #808080 #808080 #808080 #808080 #808080\n"
+		"#808080 #808080 #808080 #808080 #808080 #808080 #808080 #808080\n"
+		"#808080 #808080 #808080 #808080 #808080 #808080 #808080 #808080\n"
+		"#808080 #808080 #808080 #808080 #808080 #808080 #808080 #808080\n"
+		"#808080 #808080 #808080 #808080 #808080 #808080 #808080 #808080\n"
+		"#808080 #808080 #808080 #808080 #808080 #808080 #808080 #808080\n"
+		"#FFFFFF #FFFFFF #FFFFFF #FFFFFF #FFFFFF #FFFFFF #FFFFFF #FFFFFF\n"
+		"#000000 #000000 #000000 #000000 #000000 #000000 #000000 #000000\n";
+	
+	doc->insert_data(0, PIXEL_DATA, sizeof(PIXEL_DATA));
+	
+	bmtool->set_image_offset(0);
+	bmtool->set_image_size(16, 16);
+	bmtool->set_pixel_format(BitmapTool::PIXEL_FMT_1BPP);
+	bmtool->force_bitmap_size(8, 8);
+	
+	run_wx_until([&]() { return !bmtool->is_processing(); });
+	
+	std::string bitmap_pixels = bitmap_to_string(bmtool->get_bitmap());
+	EXPECT_EQ(bitmap_pixels, EXPECT_PIXELS);
+}
+
+TEST_F(BitmapToolTest, Format1BPPGreyscalePackedQuarterScaleFlipY)
+{
+	static const unsigned char PIXEL_DATA[] = {
+		0xFF, 0xFF,
+		0xFF, 0xFF,
+		0xFF, 0xFF,
+		0xFF, 0xFF,
+		0xFF, 0xFF,
+		0xFF, 0xFF,
+		0xFF, 0xFF,
+		0xFF, 0xFF,
+		0xF0, 0xF0,
+		0xF0, 0xF0,
+		0xF0, 0xF0,
+		0xF0, 0xF0,
+		0x00, 0x00,
+		0x00, 0x00,
+		0x00, 0x00,
+		0x00, 0x00,
+	};
+	
+	static const char *EXPECT_PIXELS =
+		"#000000 #000000 #000000 #000000\n"
+		"#FFFFFF #000000 #FFFFFF #000000\n"
+		"#FFFFFF #FFFFFF #FFFFFF #FFFFFF\n"
+		"#FFFFFF #FFFFFF #FFFFFF #FFFFFF\n";
+	
+	doc->insert_data(0, PIXEL_DATA, sizeof(PIXEL_DATA));
+	
+	bmtool->set_image_offset(0);
+	bmtool->set_image_size(16, 16);
+	bmtool->set_pixel_format(BitmapTool::PIXEL_FMT_1BPP);
+	bmtool->set_flip_y(true);
+	bmtool->force_bitmap_size(4, 4);
+	
+	run_wx_until([&]() { return !bmtool->is_processing(); });
+	
+	std::string bitmap_pixels = bitmap_to_string(bmtool->get_bitmap());
+	EXPECT_EQ(bitmap_pixels, EXPECT_PIXELS);
+}
+
 TEST_F(BitmapToolTest, Format1BPPGreyscalePackedDoubleScale)
 {
 	static const unsigned char PIXEL_DATA[] = {
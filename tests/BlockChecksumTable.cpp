@@ -0,0 +1,254 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "../src/BlockChecksumTable.hpp"
+#include "../src/Checksum.hpp"
+#include "../src/document.hpp"
+#include "../src/SharedDocumentPointer.hpp"
+#include "testutil.hpp"
+
+using namespace REHex;
+
+typedef BlockChecksumTable::Block Block;
+typedef BlockChecksumTable::ReferenceTable ReferenceTable;
+
+static std::string checksum(const ChecksumAlgorithm *algo, const unsigned char *data, size_t length)
+{
+	std::unique_ptr<ChecksumGenerator> generator(algo->factory());
+	generator->add_data(data, length);
+	generator->finish();
+	
+	return generator->checksum_hex();
+}
+
+static uint32_t crc32(const unsigned char *data, size_t length)
+{
+	return strtoul(checksum(ChecksumAlgorithm::by_name("CRC-32"), data, length).c_str(), NULL, 16);
+}
+
+TEST(BlockChecksumTable, ChecksumSize)
+{
+	EXPECT_EQ(BlockChecksumTable::checksum_size(ChecksumAlgorithm::by_name("CRC-8")), 1);
+	EXPECT_EQ(BlockChecksumTable::checksum_size(ChecksumAlgorithm::by_name("CRC-16-ARC")), 2);
+	EXPECT_EQ(BlockChecksumTable::checksum_size(ChecksumAlgorithm::by_name("CRC-32")), 4);
+	EXPECT_EQ(BlockChecksumTable::checksum_size(ChecksumAlgorithm::by_name("ADLER-32")), 4);
+}
+
+TEST(BlockChecksumTable, KnownValues)
+{
+	const ChecksumAlgorithm *crc32_algo = ChecksumAlgorithm::by_name("CRC-32");
+	ASSERT_NE(crc32_algo, nullptr) << "CRC-32 algorithm is registered";
+	
+	const char *DATA = "XX123456789123456789X";
+	SharedDocumentPointer doc = make_doc(std::vector<unsigned char>(DATA, DATA + strlen(DATA)));
+	
+	BlockChecksumTable table(doc, crc32_algo, 2, 18, 9);
+	table.wait_for_completion();
+	
+	ASSERT_TRUE(table.is_complete());
+	ASSERT_EQ(table.get_num_blocks(), 2U);
+	EXPECT_EQ(table.get_blocks_done(), 2U);
+	EXPECT_FALSE(table.has_reference());
+	
+	Block b0 = table.get_block(0);
+	EXPECT_EQ(b0.offset, 2);
+	EXPECT_EQ(b0.length, 9);
+	EXPECT_TRUE(b0.done);
+	EXPECT_STRCASEEQ(b0.checksum.c_str(), "CBF43926");
+	EXPECT_EQ(b0.expected, "");
+	EXPECT_FALSE(b0.mismatch);
+	
+	Block b1 = table.get_block(1);
+	EXPECT_EQ(b1.offset, 11);
+	EXPECT_EQ(b1.length, 9);
+	EXPECT_STRCASEEQ(b1.checksum.c_str(), "CBF43926");
+}
+
+TEST(BlockChecksumTable, ChunkSize)
+{
+	/* Blocks must be checksummed the same however the range is split between workers,
+	 * including when blocks are larger than a chunk and must be read in pieces.
+	*/
+	
+	const ChecksumAlgorithm *crc32_algo = ChecksumAlgorithm::by_name("CRC-32");
+	ASSERT_NE(crc32_algo, nullptr) << "CRC-32 algorithm is registered";
+	
+	std::vector<unsigned char> data = random_data(100000, 1);
+	SharedDocumentPointer doc = make_doc(data);
+	
+	const off_t OFFSET = 100;
+	const off_t LENGTH = 90000;
+	
+	for(off_t block_size : { 512, 4096, 30000 })
+	{
+		for(off_t chunk_size : { (off_t)(1000), (off_t)(8192), BlockChecksumTable::DEFAULT_CHUNK_SIZE })
+		{
+			BlockChecksumTable table(doc, crc32_algo, OFFSET, LENGTH, block_size, NULL, chunk_size);
+			table.wait_for_completion();
+			
+			ASSERT_TRUE(table.is_complete());
+			ASSERT_EQ(table.get_num_blocks(), (size_t)((LENGTH + block_size - 1) / block_size));
+			EXPECT_EQ(table.get_blocks_done(), table.get_num_blocks());
+			
+			for(size_t i = 0; i < table.get_num_blocks(); ++i)
+			{
+				Block block = table.get_block(i);
+				
+				off_t expect_offset = OFFSET + ((off_t)(i) * block_size);
+				off_t expect_length = std::min(block_size, ((OFFSET + LENGTH) - expect_offset));
+				
+				EXPECT_EQ(block.offset, expect_offset);
+				EXPECT_EQ(block.length, expect_length);
+				EXPECT_TRUE(block.done);
+				EXPECT_EQ(block.checksum, checksum(crc32_algo, (data.data() + expect_offset), expect_length))
+					<< "Block " << i << " with block_size = " << block_size << ", chunk_size = " << chunk_size;
+			}
+		}
+	}
+}
+
+TEST(BlockChecksumTable, EmptyRange)
+{
+	SharedDocumentPointer doc = make_doc(random_data(1024, 2));
+	
+	BlockChecksumTable table(doc, ChecksumAlgorithm::by_name("CRC-32"), 0, 0, 512);
+	table.wait_for_completion();
+	
+	EXPECT_TRUE(table.is_complete());
+	EXPECT_EQ(table.get_num_blocks(), 0U);
+	EXPECT_TRUE(table.get_mismatches().empty());
+}
+
+TEST(BlockChecksumTable, ReferenceTable)
+{
+	/* Eight 512 byte sectors followed by a table of their CRCs, stored little endian in
+	 * the first four bytes of each eight byte entry.
+	*/
+	
+	const off_t SECTOR_SIZE = 512;
+	const off_t NUM_SECTORS = 8;
+	const off_t TABLE_OFFSET = SECTOR_SIZE * NUM_SECTORS;
+	const off_t TABLE_STRIDE = 8;
+	
+	std::vector<unsigned char> data = random_data((TABLE_OFFSET + (NUM_SECTORS * TABLE_STRIDE)), 3);
+	
+	for(off_t i = 0; i < NUM_SECTORS; ++i)
+	{
+		uint32_t crc = crc32((data.data() + (i * SECTOR_SIZE)), SECTOR_SIZE);
+		
+		for(int j = 0; j < 4; ++j)
+		{
+			data[TABLE_OFFSET + (i * TABLE_STRIDE) + j] = (crc >> (j * 8)) & 0xFF;
+		}
+	}
+	
+	/* Corrupt sectors 2 and 5. */
+	data[(2 * SECTOR_SIZE) + 100] ^= 0x01;
+	data[(5 * SECTOR_SIZE)] ^= 0x80;
+	
+	SharedDocumentPointer doc = make_doc(data);
+	
+	ReferenceTable reference(TABLE_OFFSET, TABLE_STRIDE, true);
+	
+	BlockChecksumTable table(doc, ChecksumAlgorithm::by_name("CRC-32"), 0, TABLE_OFFSET, SECTOR_SIZE, &reference, 1024);
+	table.wait_for_completion();
+	
+	ASSERT_TRUE(table.is_complete());
+	EXPECT_TRUE(table.has_reference());
+	
+	EXPECT_EQ(table.get_mismatch_count(), 2U);
+	EXPECT_EQ(table.get_mismatches(), std::vector<size_t>({ 2, 5 }));
+	
+	for(off_t i = 0; i < NUM_SECTORS; ++i)
+	{
+		Block block = table.get_block(i);
+		
+		char expect_hex[16];
+		snprintf(expect_hex, sizeof(expect_hex), "%02X%02X%02X%02X",
+			data[TABLE_OFFSET + (i * TABLE_STRIDE) + 3],
+			data[TABLE_OFFSET + (i * TABLE_STRIDE) + 2],
+			data[TABLE_OFFSET + (i * TABLE_STRIDE) + 1],
+			data[TABLE_OFFSET + (i * TABLE_STRIDE) + 0]);
+		
+		EXPECT_EQ(block.expected, expect_hex) << "Sector " << i;
+		EXPECT_EQ(block.mismatch, (i == 2 || i == 5)) << "Sector " << i;
+	}
+	
+	/* The same table read big endian doesn't match anything. */
+	
+	ReferenceTable reference_be(TABLE_OFFSET, TABLE_STRIDE, false);
+	
+	BlockChecksumTable table_be(doc, ChecksumAlgorithm::by_name("CRC-32"), 0, TABLE_OFFSET, SECTOR_SIZE, &reference_be);
+	table_be.wait_for_completion();
+	
+	EXPECT_EQ(table_be.get_mismatch_count(), (size_t)(NUM_SECTORS));
+}
+
+TEST(BlockChecksumTable, ReferenceTablePacked)
+{
+	/* Table of big endian CRCs packed together before the blocks they cover, the last
+	 * entry is cut off by the end of the file.
+	*/
+	
+	const off_t BLOCK_SIZE = 100;
+	const off_t NUM_BLOCKS = 10;
+	
+	std::vector<unsigned char> data = random_data((NUM_BLOCKS * BLOCK_SIZE), 4);
+	
+	for(off_t i = 0; i < NUM_BLOCKS; ++i)
+	{
+		uint32_t crc = crc32((data.data() + (i * BLOCK_SIZE)), BLOCK_SIZE);
+		unsigned char entry[] = { (unsigned char)(crc >> 24), (unsigned char)(crc >> 16), (unsigned char)(crc >> 8), (unsigned char)(crc) };
+		
+		data.insert(data.end(), entry, entry + sizeof(entry));
+	}
+	
+	data.resize(data.size() - 2);
+	
+	SharedDocumentPointer doc = make_doc(data);
+	
+	ReferenceTable reference((NUM_BLOCKS * BLOCK_SIZE), 0, false);
+	
+	BlockChecksumTable table(doc, ChecksumAlgorithm::by_name("CRC-32"), 0, (NUM_BLOCKS * BLOCK_SIZE), BLOCK_SIZE, &reference);
+	table.wait_for_completion();
+	
+	EXPECT_EQ(table.get_mismatch_count(), 0U);
+	
+	for(off_t i = 0; i < (NUM_BLOCKS - 1); ++i)
+	{
+		Block block = table.get_block(i);
+		
+		EXPECT_EQ(block.expected, block.checksum) << "Block " << i;
+		EXPECT_FALSE(block.mismatch) << "Block " << i;
+	}
+	
+	Block last = table.get_block(NUM_BLOCKS - 1);
+	EXPECT_EQ(last.expected, "") << "Entries past the end of the file are ignored";
+	EXPECT_FALSE(last.mismatch) << "Entries past the end of the file are ignored";
+}
@@ -0,0 +1,121 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+#include "../src/BlockPool.hpp"
+
+using namespace REHex;
+
+TEST(BlockPool, ReuseReleasedSlab)
+{
+	std::shared_ptr<BlockPool> pool = BlockPool::create(1024, 2);
+	
+	std::shared_ptr< std::vector<unsigned char> > a = pool->get(1000);
+	EXPECT_EQ(a->size(), 1000U);
+	EXPECT_GE(a->capacity(), 1024U);
+	
+	const std::vector<unsigned char> *a_ptr = a.get();
+	a.reset();
+	
+	BlockPool::Stats stats = pool->get_stats();
+	EXPECT_EQ(stats.allocated, 1U);
+	EXPECT_EQ(stats.returned, 1U);
+	EXPECT_EQ(stats.free, 1U);
+	
+	std::shared_ptr< std::vector<unsigned char> > b = pool->get(10);
+	EXPECT_EQ(b.get(), a_ptr) << "BlockPool::get() reuses released slab";
+	EXPECT_EQ(b->size(), 10U);
+	
+	stats = pool->get_stats();
+	EXPECT_EQ(stats.allocated, 1U);
+	EXPECT_EQ(stats.reused, 1U);
+	EXPECT_EQ(stats.free, 0U);
+}
+
+TEST(BlockPool, Capacity)
+{
+	std::shared_ptr<BlockPool> pool = BlockPool::create(1024, 2);
+	
+	std::vector< std::shared_ptr< std::vector<unsigned char> > > slabs;
+	for(int i = 0; i < 4; ++i)
+	{
+		slabs.push_back(pool->get(1024));
+	}
+	
+	slabs.clear();
+	
+	BlockPool::Stats stats = pool->get_stats();
+	EXPECT_EQ(stats.allocated, 4U);
+	EXPECT_EQ(stats.returned, 2U);
+	EXPECT_EQ(stats.discarded, 2U) << "BlockPool doesn't keep more than capacity slabs";
+	EXPECT_EQ(stats.free, 2U);
+	
+	pool->set_capacity(1);
+	
+	EXPECT_EQ(pool->get_capacity(), 1U);
+	EXPECT_EQ(pool->get_stats().free, 1U) << "BlockPool::set_capacity() frees excess slabs";
+}
+
+TEST(BlockPool, Oversize)
+{
+	std::shared_ptr<BlockPool> pool = BlockPool::create(1024, 2);
+	
+	std::shared_ptr< std::vector<unsigned char> > a = pool->get(4096);
+	EXPECT_EQ(a->size(), 4096U);
+	
+	a.reset();
+	
+	BlockPool::Stats stats = pool->get_stats();
+	EXPECT_EQ(stats.oversize, 1U);
+	EXPECT_EQ(stats.allocated, 0U);
+	EXPECT_EQ(stats.free, 0U) << "BlockPool doesn't keep oversize buffers";
+}
+
+TEST(BlockPool, DiscardResizedSlab)
+{
+	std::shared_ptr<BlockPool> pool = BlockPool::create(1024, 2);
+	
+	std::shared_ptr< std::vector<unsigned char> > a = pool->get(1024);
+	a->resize(4096);
+	a.reset();
+	
+	std::shared_ptr< std::vector<unsigned char> > b = pool->get(1024);
+	b->shrink_to_fit();
+	b->resize(10);
+	b->shrink_to_fit();
+	b.reset();
+	
+	BlockPool::Stats stats = pool->get_stats();
+	EXPECT_EQ(stats.discarded, 2U) << "BlockPool doesn't keep slabs which have been grown or shrunk";
+	EXPECT_EQ(stats.free, 0U);
+}
+
+TEST(BlockPool, OutliveSlabs)
+{
+	std::shared_ptr<BlockPool> pool = BlockPool::create(1024, 2);
+	
+	std::shared_ptr< std::vector<unsigned char> > a = pool->get(1024);
+	pool.reset();
+	
+	/* Releasing a slab after the pool has been destroyed frees it. */
+	a.reset();
+}
@@ -262,6 +262,15 @@ TEST(Checksum, CRC8)
 		
 		EXPECT_STRCASEEQ(crc_gen->checksum_hex().c_str(), "F4");
 	}
+	
+	{
+		/* CRC of nothing is zero, which must still be padded to the full width. */
+		
+		ChecksumGenerator *crc_gen = crc_algo->factory();
+		crc_gen->finish();
+		
+		EXPECT_STRCASEEQ(crc_gen->checksum_hex().c_str(), "00");
+	}
 }
 
 TEST(Checksum, CRC32)
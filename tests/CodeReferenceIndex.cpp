@@ -0,0 +1,227 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/CodeReferenceIndex.hpp"
+#include "../src/document.hpp"
+#include "../src/SharedDocumentPointer.hpp"
+
+using namespace REHex;
+
+typedef CodeReferenceIndex::Reference Reference;
+typedef CodeReferenceIndex::ReferenceType ReferenceType;
+
+/* Offset and length of the .text section in tests/ls.x86_64 */
+static const off_t TEXT_OFFSET = 0x46F0;
+static const off_t TEXT_LENGTH = 0x125BE;
+
+/* Offset of setlocale() in the PLT. */
+static const off_t SETLOCALE_PLT = 0x4530;
+
+TEST(CodeReferenceIndex, NoCode)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make("tests/ls.x86_64"));
+	
+	CodeReferenceIndex index(doc);
+	index.wait_for_completion();
+	
+	EXPECT_EQ(index.get_code_bytes(), 0);
+	EXPECT_EQ(index.get_pending_bytes(), 0);
+	EXPECT_EQ(index.get_num_references(), 0U);
+	
+	EXPECT_EQ(index.find_references_to(SETLOCALE_PLT), std::vector<Reference>());
+}
+
+TEST(CodeReferenceIndex, FindReferences)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make("tests/ls.x86_64"));
+	doc->set_data_type(TEXT_OFFSET, TEXT_LENGTH, "code:x86_64");
+	
+	CodeReferenceIndex index(doc);
+	index.wait_for_completion();
+	
+	EXPECT_EQ(index.get_code_bytes(), TEXT_LENGTH);
+	EXPECT_EQ(index.get_pending_bytes(), 0);
+	
+	std::vector<Reference> expect_calls = {
+		Reference(0x4767, SETLOCALE_PLT, ReferenceType::CALL),
+		Reference(0xCA1C, SETLOCALE_PLT, ReferenceType::CALL),
+		Reference(0xCAD9, SETLOCALE_PLT, ReferenceType::CALL),
+		Reference(0xE336, SETLOCALE_PLT, ReferenceType::CALL),
+	};
+	
+	EXPECT_EQ(index.find_references_to(SETLOCALE_PLT), expect_calls);
+	
+	/* RIP-relative lea instructions referencing a string in .rodata */
+	
+	std::vector<Reference> string_refs = index.find_references_to(0x188C1);
+	ASSERT_EQ(string_refs.size(), 24U);
+	
+	EXPECT_EQ(string_refs.front(), Reference(0x475B, 0x188C1, ReferenceType::DATA));
+	EXPECT_EQ(string_refs.back(), Reference(0x16650, 0x188C1, ReferenceType::DATA));
+	
+	/* Conditional jump. */
+	
+	std::vector<Reference> expect_jumps = {
+		Reference(0x8C39, 0x8E10, ReferenceType::JUMP),
+	};
+	
+	EXPECT_EQ(index.find_references_to(0x8E10), expect_jumps);
+}
+
+TEST(CodeReferenceIndex, DataOverwritten)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make("tests/ls.x86_64"));
+	doc->set_data_type(TEXT_OFFSET, TEXT_LENGTH, "code:x86_64");
+	
+	CodeReferenceIndex index(doc);
+	index.wait_for_completion();
+	
+	/* Replace the first call to setlocale() with NOPs. */
+	
+	const unsigned char NOPS[] = { 0x90, 0x90, 0x90, 0x90, 0x90 };
+	doc->overwrite_data(0x4767, NOPS, sizeof(NOPS));
+	
+	index.wait_for_completion();
+	
+	std::vector<Reference> expect_calls = {
+		Reference(0xCA1C, SETLOCALE_PLT, ReferenceType::CALL),
+		Reference(0xCAD9, SETLOCALE_PLT, ReferenceType::CALL),
+		Reference(0xE336, SETLOCALE_PLT, ReferenceType::CALL),
+	};
+	
+	EXPECT_EQ(index.find_references_to(SETLOCALE_PLT), expect_calls);
+	
+	/* And undo it. */
+	
+	doc->undo();
+	index.wait_for_completion();
+	
+	EXPECT_EQ(index.find_references_to(SETLOCALE_PLT).size(), 4U);
+}
+
+TEST(CodeReferenceIndex, DataErased)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make("tests/ls.x86_64"));
+	doc->set_data_type(TEXT_OFFSET, TEXT_LENGTH, "code:x86_64");
+	
+	CodeReferenceIndex index(doc);
+	index.wait_for_completion();
+	
+	/* Erase a byte before the code, moving everything down by one. */
+	
+	doc->erase_data(0x100, 1);
+	index.wait_for_completion();
+	
+	EXPECT_EQ(index.get_code_bytes(), TEXT_LENGTH);
+	
+	std::vector<Reference> expect_calls = {
+		Reference(0x4766, (SETLOCALE_PLT - 1), ReferenceType::CALL),
+		Reference(0xCA1B, (SETLOCALE_PLT - 1), ReferenceType::CALL),
+		Reference(0xCAD8, (SETLOCALE_PLT - 1), ReferenceType::CALL),
+		Reference(0xE335, (SETLOCALE_PLT - 1), ReferenceType::CALL),
+	};
+	
+	EXPECT_EQ(index.find_references_to(SETLOCALE_PLT - 1), expect_calls);
+	EXPECT_EQ(index.find_references_to(SETLOCALE_PLT), std::vector<Reference>());
+}
+
+TEST(CodeReferenceIndex, DataInserted)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make("tests/ls.x86_64"));
+	doc->set_data_type(TEXT_OFFSET, TEXT_LENGTH, "code:x86_64");
+	
+	CodeReferenceIndex index(doc);
+	index.wait_for_completion();
+	
+	/* Insert some bytes between the first call to setlocale() and the rest. */
+	
+	const unsigned char ZEROS[16] = { 0 };
+	doc->insert_data(0x8000, ZEROS, sizeof(ZEROS));
+	
+	index.wait_for_completion();
+	
+	std::vector<Reference> expect_calls = {
+		Reference(0x4767, SETLOCALE_PLT, ReferenceType::CALL),
+	};
+	
+	EXPECT_EQ(index.find_references_to(SETLOCALE_PLT), expect_calls);
+	
+	/* The later calls are relative, so their targets have moved along with them. */
+	
+	EXPECT_EQ(index.find_references_to(SETLOCALE_PLT + 16).size(), 3U);
+}
+
+TEST(CodeReferenceIndex, TypesChanged)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make("tests/ls.x86_64"));
+	
+	CodeReferenceIndex index(doc);
+	index.wait_for_completion();
+	
+	EXPECT_EQ(index.find_references_to(SETLOCALE_PLT).size(), 0U);
+	
+	/* Mark only the start of .text as code. */
+	
+	doc->set_data_type(TEXT_OFFSET, (0x5000 - TEXT_OFFSET), "code:x86_64");
+	index.wait_for_completion();
+	
+	std::vector<Reference> expect_calls = {
+		Reference(0x4767, SETLOCALE_PLT, ReferenceType::CALL),
+	};
+	
+	EXPECT_EQ(index.find_references_to(SETLOCALE_PLT), expect_calls);
+	
+	/* Mark it as data again. */
+	
+	doc->set_data_type(TEXT_OFFSET, (0x5000 - TEXT_OFFSET), "");
+	index.wait_for_completion();
+	
+	EXPECT_EQ(index.get_code_bytes(), 0);
+	EXPECT_EQ(index.get_num_references(), 0U);
+}
+
+TEST(CodeReferenceIndex, VirtualMappings)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make("tests/ls.x86_64"));
+	doc->set_data_type(TEXT_OFFSET, TEXT_LENGTH, "code:x86_64");
+	
+	CodeReferenceIndex index(doc);
+	index.wait_for_completion();
+	
+	/* Map only .text at a different address - the PLT isn't mapped anywhere, so the calls
+	 * into it can't be resolved to an offset in the file.
+	*/
+	
+	doc->set_virt_mapping(TEXT_OFFSET, (0x400000 + TEXT_OFFSET), TEXT_LENGTH);
+	index.wait_for_completion();
+	
+	EXPECT_EQ(index.find_references_to(SETLOCALE_PLT), std::vector<Reference>());
+	
+	/* Map the rest of the file in too. */
+	
+	doc->set_virt_mapping(0, 0x400000, TEXT_OFFSET);
+	doc->set_virt_mapping((TEXT_OFFSET + TEXT_LENGTH), (0x400000 + TEXT_OFFSET + TEXT_LENGTH), (doc->buffer_length() - (TEXT_OFFSET + TEXT_LENGTH)));
+	index.wait_for_completion();
+	
+	EXPECT_EQ(index.find_references_to(SETLOCALE_PLT).size(), 4U);
+	EXPECT_EQ(index.find_references_to(0x188C1).size(), 24U);
+}
@@ -19,7 +19,9 @@
 
 #include <gtest/gtest.h>
 #include <list>
+#include <stdio.h>
 #include <string>
+#include <thread>
 #include <vector>
 #include <wx/app.h>
 #include <wx/frame.h>
@@ -250,3 +252,126 @@ TEST_F(ConsoleBufferTest, SizeLimit)
 		"PRINT(INFO, 'flagrant\n')",
 	);
 }
+
+TEST_F(ConsoleBufferTest, ClearQueued)
+{
+	cbuffer.print(ConsoleBuffer::Level::INFO, "lying alive\n");
+	pump_events();
+	
+	events.clear();
+	
+	/* Messages queued before a clear() should be discarded without being printed, and
+	 * messages queued after it should be printed after the erase.
+	*/
+	
+	cbuffer.print(ConsoleBuffer::Level::INFO, "road pencil\n");
+	cbuffer.clear();
+	cbuffer.print(ConsoleBuffer::Level::ERROR, "overjoyed\n");
+	pump_events();
+	
+	EXPECT_MESSAGES(
+		ConsoleBuffer::Message(ConsoleBuffer::Level::ERROR, "overjoyed\n"),
+	);
+	
+	EXPECT_EVENTS(
+		"ERASE(12)",
+		"PRINT(ERROR, 'overjoyed\n')",
+	);
+	
+	cbuffer.print(ConsoleBuffer::Level::INFO, "small bat\n");
+	cbuffer.clear();
+	cbuffer.clear();
+	pump_events();
+	
+	EXPECT_MESSAGES();
+	
+	EXPECT_EVENTS(
+		"ERASE(10)",
+	);
+	
+	cbuffer.clear();
+	pump_events();
+	
+	EXPECT_EVENTS();
+}
+
+TEST_F(ConsoleBufferTest, ExplicitFlush)
+{
+	cbuffer.print(ConsoleBuffer::Level::INFO, "receptive\n");
+	cbuffer.print(ConsoleBuffer::Level::INFO, "spiffy\n");
+	
+	EXPECT_MESSAGES();
+	EXPECT_EVENTS();
+	
+	EXPECT_EQ(cbuffer.get_messages_text(), "receptive\nspiffy\n");
+	EXPECT_EQ(cbuffer.get_flushed_text(), "");
+	
+	cbuffer.flush();
+	
+	EXPECT_MESSAGES(
+		ConsoleBuffer::Message(ConsoleBuffer::Level::INFO, "receptive\n"),
+		ConsoleBuffer::Message(ConsoleBuffer::Level::INFO, "spiffy\n"),
+	);
+	
+	EXPECT_EVENTS(
+		"PRINT(INFO, 'receptive\n')",
+		"PRINT(INFO, 'spiffy\n')",
+	);
+	
+	EXPECT_EQ(cbuffer.get_flushed_text(), "receptive\nspiffy\n");
+	
+	/* Flush scheduled by print() should find nothing left to do. */
+	pump_events();
+	
+	EXPECT_EVENTS();
+}
+
+TEST(ConsoleBuffer, ConcurrentPrint)
+{
+	const int N_THREADS = 4;
+	const int N_MESSAGES = 10000;
+	
+	ConsoleBuffer cbuffer(16 * 1024 * 1024);
+	
+	std::vector<std::thread> threads;
+	
+	for(int i = 0; i < N_THREADS; ++i)
+	{
+		threads.emplace_back([&cbuffer, i]()
+		{
+			for(int j = 0; j < N_MESSAGES; ++j)
+			{
+				cbuffer.printf(ConsoleBuffer::Level::INFO, "%d %d\n", i, j);
+			}
+		});
+	}
+	
+	for(auto t = threads.begin(); t != threads.end(); ++t)
+	{
+		t->join();
+	}
+	
+	cbuffer.flush();
+	
+	/* Every message should be present and in order for each thread. */
+	
+	std::vector<int> next_message(N_THREADS, 0);
+	
+	for(auto m = cbuffer.get_messages().begin(); m != cbuffer.get_messages().end(); ++m)
+	{
+		int i, j;
+		ASSERT_EQ(sscanf(m->text.c_str(), "%d %d\n", &i, &j), 2);
+		
+		ASSERT_TRUE(i >= 0 && i < N_THREADS);
+		EXPECT_EQ(j, next_message[i]);
+		
+		next_message[i] = j + 1;
+	}
+	
+	EXPECT_EQ(cbuffer.get_messages().size(), (size_t)(N_THREADS * N_MESSAGES));
+	
+	for(int i = 0; i < N_THREADS; ++i)
+	{
+		EXPECT_EQ(next_message[i], N_MESSAGES) << "All messages from thread " << i << " received";
+	}
+}
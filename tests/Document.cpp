@@ -18,6 +18,7 @@
 #include "../src/platform.hpp"
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <stdint.h>
 #include <string>
 #include <string.h>
@@ -4365,6 +4366,420 @@ TEST_F(DocumentTest, LoadMetadataDataHighlightsCustomColours)
 	}
 }
 
+TEST_F(DocumentTest, ApplyAnnotations)
+{
+	std::vector<unsigned char> zero_1k(1024, 0);
+	doc->insert_data(0, zero_1k.data(), zero_1k.size());
+	
+	Document::AnnotationBatch batch;
+	batch.add_comment( 0, 10, "cold");
+	batch.add_comment(20, 10, "strong");
+	batch.add_comment(25, 10, "straddling");   /* Straddles end of "strong" */
+	batch.add_comment(1000, 100, "too long");  /* Beyond end of file */
+	batch.add_highlight(40, 8, 0);
+	batch.add_highlight(60, 8, 99);            /* No such colour */
+	batch.add_data_type(0, 4, "u32le");
+	batch.add_data_type(1020, 8, "u64le");     /* Beyond end of file */
+	batch.add_virt_mapping(0, 1000, 100);
+	batch.add_virt_mapping(200, 1050, 100);    /* Overlaps previous mapping */
+	
+	events.clear();
+	
+	EXPECT_EQ(doc->apply_annotations(batch), 5U);
+	
+	EXPECT_EQ(std::count(events.begin(), events.end(), "EV_COMMENT_MODIFIED"), 1) << "Document::apply_annotations() raises EV_COMMENT_MODIFIED once";
+	EXPECT_EQ(std::count(events.begin(), events.end(), "EV_HIGHLIGHTS_CHANGED"), 1) << "Document::apply_annotations() raises EV_HIGHLIGHTS_CHANGED once";
+	EXPECT_EQ(std::count(events.begin(), events.end(), "EV_MAPPINGS_CHANGED"), 1) << "Document::apply_annotations() raises EV_MAPPINGS_CHANGED once";
+	
+	{
+		BitRangeTree<Document::Comment> expect;
+		expect.set( 0, 10, REHex::Document::Comment("cold"));
+		expect.set(20, 10, REHex::Document::Comment("strong"));
+		
+		EXPECT_EQ(doc->get_comments(), expect);
+	}
+	
+	{
+		BitRangeMap<int> expect;
+		expect.set_range(BitOffset(40, 0), BitOffset(8, 0), 0);
+		
+		EXPECT_EQ(doc->get_highlights(), expect);
+	}
+	
+	EXPECT_DATA_TYPES(
+		DATA_TYPE(0,    4, "u32le"),
+		DATA_TYPE(4, 1020, ""),
+	);
+	
+	{
+		const std::vector< std::pair<ByteRangeMap<off_t>::Range, off_t> > EXPECT_R2V = {
+			std::make_pair(ByteRangeMap<off_t>::Range(0, 100), 1000),
+		};
+		
+		EXPECT_EQ(doc->get_real_to_virt_segs().get_ranges(), EXPECT_R2V);
+	}
+	
+	EXPECT_STREQ(doc->undo_desc(), "apply annotations") << "Document::apply_annotations() creates a single undo step";
+	
+	doc->undo();
+	
+	EXPECT_TRUE(doc->get_comments().empty());
+	EXPECT_TRUE(doc->get_highlights().empty());
+	EXPECT_DATA_TYPES(
+		DATA_TYPE(0, 1024, ""),
+	);
+	EXPECT_TRUE(doc->get_real_to_virt_segs().empty());
+	
+	doc->redo();
+	
+	{
+		BitRangeTree<Document::Comment> expect;
+		expect.set( 0, 10, REHex::Document::Comment("cold"));
+		expect.set(20, 10, REHex::Document::Comment("strong"));
+		
+		EXPECT_EQ(doc->get_comments(), expect);
+	}
+	
+	EXPECT_DATA_TYPES(
+		DATA_TYPE(0,    4, "u32le"),
+		DATA_TYPE(4, 1020, ""),
+	);
+	
+	EXPECT_EQ(doc->get_real_to_virt_segs().size(), 1U);
+}
+
+TEST_F(DocumentTest, ReadSnapshot)
+{
+	const unsigned char DATA[] = { 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H' };
+	doc->insert_data(0, DATA, sizeof(DATA));
+	
+	std::shared_ptr<const Document::ReadSnapshot> snapshot = doc->get_read_snapshot();
+	unsigned int version = snapshot->get_version();
+	
+	EXPECT_EQ(version, doc->get_data_version());
+	
+	const unsigned char X[] = { 'X', 'X' };
+	doc->overwrite_data(2, X, sizeof(X));
+	doc->insert_data(0, X, sizeof(X));
+	doc->erase_data(8, 2);
+	
+	EXPECT_EQ(doc->read_data(0, 100), std::vector<unsigned char>({ 'X', 'X', 'A', 'B', 'X', 'X', 'E', 'F' }));
+	
+	EXPECT_EQ(snapshot->buffer_length(), 8);
+	EXPECT_EQ(snapshot->read_data(0, 100), std::vector<unsigned char>(DATA, DATA + sizeof(DATA))) << "Document::ReadSnapshot isn't affected by later changes";
+	
+	std::vector<Document::DataChange> changes;
+	ASSERT_TRUE(doc->get_data_changes(version, doc->get_data_version(), &changes));
+	ASSERT_EQ(changes.size(), 3U);
+	
+	EXPECT_EQ(changes[0].type, Document::DataChange::OVERWRITE);
+	EXPECT_EQ(changes[1].type, Document::DataChange::INSERT);
+	EXPECT_EQ(changes[2].type, Document::DataChange::ERASE);
+	
+	/* Translate ranges from the snapshot to the current document. */
+	
+	ByteRangeSet ranges;
+	ranges.set_range(0, 8);
+	
+	Document::apply_data_changes(&ranges, changes, true);
+	
+	const std::vector<ByteRangeSet::Range> EXPECT_RANGES = {
+		ByteRangeSet::Range(2, 2),
+		ByteRangeSet::Range(6, 2),
+	};
+	
+	EXPECT_EQ(ranges.get_ranges(), EXPECT_RANGES);
+}
+
+TEST_F(DocumentTest, Fork)
+{
+	doc->insert_data(0, (const unsigned char*)("ABCDEFGH"), 8);
+	doc->set_comment(0, 4, REHex::Document::Comment("head"));
+	doc->set_highlight(4, 2, 0);
+	
+	Document fork(doc);
+	
+	EXPECT_EQ(fork.read_data(0, 100), doc->read_data(0, 100)) << "Forked Document has data of parent";
+	EXPECT_EQ(fork.get_comments(), doc->get_comments()) << "Forked Document has comments of parent";
+	EXPECT_EQ(fork.get_highlights(), doc->get_highlights()) << "Forked Document has highlights of parent";
+	
+	EXPECT_EQ(fork.get_filename(), "") << "Forked Document has no filename";
+	EXPECT_EQ(fork.get_title(), "Untitled (fork)");
+	EXPECT_EQ(fork.undo_desc(), (const char*)(NULL)) << "Forked Document has no undo history";
+	
+	fork.overwrite_data(0, (const unsigned char*)("XX"), 2);
+	fork.set_comment(0, 4, REHex::Document::Comment("fork"));
+	
+	doc->erase_data(6, 2);
+	doc->set_highlight(0, 2, 1);
+	
+	EXPECT_EQ(fork.read_data(0, 100), std::vector<unsigned char>({ 'X', 'X', 'C', 'D', 'E', 'F', 'G', 'H' })) << "Changes to forked Document don't affect parent";
+	EXPECT_DATA("ABCDEF");
+	
+	BitRangeTree<Document::Comment> expect_doc_comments;
+	expect_doc_comments.set(0, 4, REHex::Document::Comment("head"));
+	
+	EXPECT_EQ(doc->get_comments(), expect_doc_comments) << "Changes to forked Document don't affect parent";
+	
+	BitRangeMap<int> expect_fork_highlights;
+	expect_fork_highlights.set_range(4, 2, 0);
+	
+	EXPECT_EQ(fork.get_highlights(), expect_fork_highlights) << "Changes to parent Document don't affect fork";
+}
+
+TEST_F(DocumentTest, DataChangesEventTransaction)
+{
+	doc->insert_data(0, (const unsigned char*)("ABCDEFGHIJKLMNOP"), 16);
+	run_wx_for(100);
+	
+	std::vector<std::string> changes_events;
+	ByteRangeSet changed;
+	
+	doc->Bind(DATA_CHANGES, [&](DataChangesEvent &event)
+	{
+		char event_s[64];
+		snprintf(event_s, sizeof(event_s), "DATA_CHANGES(%u, %u, %d)", event.from_version, event.to_version, (int)(event.moved_from));
+		changes_events.push_back(event_s);
+		
+		changed = event.changed;
+	});
+	
+	unsigned int base_version = doc->get_data_version();
+	
+	{
+		ScopedTransaction t(doc, "patch");
+		
+		doc->overwrite_data(2, (const unsigned char*)("xx"), 2);
+		doc->overwrite_data(3, (const unsigned char*)("yy"), 2);
+		doc->insert_data(8, (const unsigned char*)("zz"), 2);
+		doc->erase_data(0, 1);
+		
+		EXPECT_TRUE(changes_events.empty()) << "DATA_CHANGES isn't raised before transaction is committed";
+		
+		t.commit();
+	}
+	
+	char expect_event[64];
+	snprintf(expect_event, sizeof(expect_event), "DATA_CHANGES(%u, %u, 0)", base_version, (base_version + 4));
+	
+	EXPECT_EQ(changes_events, std::vector<std::string>({ expect_event })) << "One DATA_CHANGES event is raised when transaction is committed";
+	
+	ByteRangeSet expect_changed;
+	expect_changed.set_range(1, 3);
+	expect_changed.set_range(7, 2);
+	
+	EXPECT_EQ(changed.get_ranges(), expect_changed.get_ranges()) << "DATA_CHANGES event has changed ranges relative to final data";
+	
+	run_wx_for(100);
+	
+	EXPECT_EQ(changes_events.size(), 1U) << "No further DATA_CHANGES events are raised";
+}
+
+TEST_F(DocumentTest, DataChangesEventEventLoop)
+{
+	doc->insert_data(0, (const unsigned char*)("ABCDEFGHIJKLMNOP"), 16);
+	run_wx_for(100);
+	
+	std::vector<std::string> changes_events;
+	ByteRangeSet changed;
+	
+	doc->Bind(DATA_CHANGES, [&](DataChangesEvent &event)
+	{
+		char event_s[64];
+		snprintf(event_s, sizeof(event_s), "DATA_CHANGES(%u, %u, %d)", event.from_version, event.to_version, (int)(event.moved_from));
+		changes_events.push_back(event_s);
+		
+		changed = event.changed;
+	});
+	
+	unsigned int base_version = doc->get_data_version();
+	
+	doc->overwrite_data(4, (const unsigned char*)("xx"), 2);
+	doc->overwrite_data(12, (const unsigned char*)("yy"), 2);
+	
+	EXPECT_TRUE(changes_events.empty()) << "DATA_CHANGES isn't raised until the event loop runs";
+	
+	run_wx_for(100);
+	
+	char expect_event[64];
+	snprintf(expect_event, sizeof(expect_event), "DATA_CHANGES(%u, %u, -1)", base_version, (base_version + 2));
+	
+	EXPECT_EQ(changes_events, std::vector<std::string>({ expect_event })) << "Changes made in one pass of the event loop raise one DATA_CHANGES event";
+	
+	ByteRangeSet expect_changed;
+	expect_changed.set_range(4, 2);
+	expect_changed.set_range(12, 2);
+	
+	EXPECT_EQ(changed.get_ranges(), expect_changed.get_ranges());
+}
+
+/* Types a byte in hex insert mode the way Tab does - inserting the high nibble and then
+ * overwriting the low nibble, with each nibble being a separate keystroke.
+*/
+static void type_hex_byte(Document *doc, unsigned char byte)
+{
+	BitOffset cursor_pos = doc->get_cursor_position();
+	
+	{
+		ScopedKeystroke keystroke(doc);
+		
+		unsigned char high = (byte & 0xF0);
+		doc->insert_data(cursor_pos.byte(), &high, 1, (cursor_pos + BitOffset(0, 4)), Document::CSTATE_GOTO, "change data");
+	}
+	
+	{
+		ScopedKeystroke keystroke(doc);
+		
+		std::vector<bool> low_bits = { ((byte & 8) != 0), ((byte & 4) != 0), ((byte & 2) != 0), ((byte & 1) != 0) };
+		doc->overwrite_bits((cursor_pos + BitOffset(0, 4)), low_bits, (cursor_pos + BitOffset(1, 0)), Document::CSTATE_GOTO, "change data");
+	}
+}
+
+TEST_F(DocumentTest, TypingSessionIsOneUndoStep)
+{
+	doc->insert_data(0, (const unsigned char*)("ABCD"), 4, -1, Document::CSTATE_CURRENT, "initialise");
+	doc->set_cursor_position(2);
+	
+	type_hex_byte(doc, 'x');
+	type_hex_byte(doc, 'y');
+	type_hex_byte(doc, 'z');
+	
+	ASSERT_DATA("ABxyzCD");
+	EXPECT_EQ(doc->get_cursor_position(), BitOffset(5, 0));
+	
+	/* Undo should revert every keystroke in the session. */
+	
+	doc->undo();
+	
+	EXPECT_DATA("ABCD");
+	EXPECT_EQ(doc->get_cursor_position(), BitOffset(2, 0)) << "Undo restores cursor from before typing session";
+	
+	{
+		const char *undo_desc = doc->undo_desc();
+		EXPECT_EQ(std::string(undo_desc ? undo_desc : "(null)"), "initialise");
+	}
+	
+	doc->redo();
+	
+	EXPECT_DATA("ABxyzCD");
+	
+	doc->undo();
+	doc->undo();
+	
+	EXPECT_DATA("");
+}
+
+TEST_F(DocumentTest, TypingSessionCursorJump)
+{
+	doc->insert_data(0, (const unsigned char*)("ABCD"), 4, -1, Document::CSTATE_CURRENT, "initialise");
+	doc->set_cursor_position(1);
+	
+	type_hex_byte(doc, 'x');
+	type_hex_byte(doc, 'y');
+	
+	doc->set_cursor_position(0);
+	
+	type_hex_byte(doc, 'z');
+	
+	ASSERT_DATA("zAxyBCD");
+	
+	/* Moving the cursor ends the typing session. */
+	
+	doc->undo();
+	EXPECT_DATA("AxyBCD");
+	
+	doc->undo();
+	EXPECT_DATA("ABCD");
+}
+
+TEST_F(DocumentTest, TypingSessionOtherCommand)
+{
+	doc->insert_data(0, (const unsigned char*)("ABCD"), 4, -1, Document::CSTATE_CURRENT, "initialise");
+	doc->set_cursor_position(4);
+	
+	type_hex_byte(doc, 'x');
+	
+	doc->set_comment(0, 1, REHex::Document::Comment("comment"));
+	
+	type_hex_byte(doc, 'y');
+	
+	ASSERT_DATA("ABCDxy");
+	
+	/* Other changes end the typing session. */
+	
+	doc->undo();
+	EXPECT_DATA("ABCDx");
+	
+	doc->undo();
+	EXPECT_DATA("ABCDx");
+	EXPECT_TRUE(doc->get_comments().empty());
+	
+	doc->undo();
+	EXPECT_DATA("ABCD");
+	
+	/* Changes made without a ScopedKeystroke are never merged. */
+	
+	doc->overwrite_data(0, (const unsigned char*)("a"), 1, 1, Document::CSTATE_GOTO, "change data");
+	doc->overwrite_data(1, (const unsigned char*)("b"), 1, 2, Document::CSTATE_GOTO, "change data");
+	
+	doc->undo();
+	EXPECT_DATA("aBCD");
+}
+
+TEST_F(DocumentTest, TypingSessionRollback)
+{
+	doc->insert_data(0, (const unsigned char*)("ABCD"), 4, -1, Document::CSTATE_CURRENT, "initialise");
+	doc->set_comment(3, 1, REHex::Document::Comment("comment"));
+	doc->set_cursor_position(2);
+	
+	type_hex_byte(doc, 'x');
+	
+	ASSERT_DATA("ABxCD");
+	
+	/* Roll back a keystroke which reopened the typing session's transaction after it
+	 * erased the commented byte.
+	*/
+	
+	{
+		ScopedKeystroke keystroke(doc);
+		
+		doc->transact_begin("change data");
+		doc->erase_data(3, 2, 3, Document::CSTATE_GOTO, "change data");
+		
+		ASSERT_DATA("ABx");
+		ASSERT_TRUE(doc->get_comments().empty());
+		
+		doc->transact_rollback();
+	}
+	
+	EXPECT_DATA("ABxCD");
+	EXPECT_EQ(doc->get_cursor_position(), BitOffset(3, 0));
+	
+	{
+		BitRangeTree<Document::Comment> expect;
+		expect.set(4, 1, REHex::Document::Comment("comment"));
+		
+		EXPECT_EQ(doc->get_comments(), expect) << "Rollback restores metadata changed by the keystroke";
+	}
+	
+	/* The earlier keystrokes are still one undo step. */
+	
+	doc->undo();
+	
+	EXPECT_DATA("ABCD");
+	
+	{
+		BitRangeTree<Document::Comment> expect;
+		expect.set(3, 1, REHex::Document::Comment("comment"));
+		
+		EXPECT_EQ(doc->get_comments(), expect);
+	}
+	
+	doc->redo();
+	
+	EXPECT_DATA("ABxCD");
+}
+
 TEST(Document, TypeInfoComparison)
 {
 	/* Check name comparison. */
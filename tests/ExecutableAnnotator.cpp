@@ -0,0 +1,339 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <string.h>
+#include <vector>
+
+#include "../src/DataType.hpp"
+#include "../src/document.hpp"
+#include "../src/ExecutableAnnotator.hpp"
+#include "../src/SharedDocumentPointer.hpp"
+
+using namespace REHex;
+
+/* The machine code types are normally registered by the disassembler during app startup,
+ * which doesn't happen in the tests, so we register a stand-in when necessary.
+*/
+class CodeTypeRegistration
+{
+	public:
+		std::unique_ptr<StaticDataTypeRegistration> reg;
+		
+		CodeTypeRegistration(const char *name)
+		{
+			if(DataTypeRegistry::get_registration(name) == NULL)
+			{
+				reg.reset(new StaticDataTypeRegistration(name, name, {}, DataType()));
+			}
+		}
+};
+
+static std::string comment_at(Document *doc, off_t offset, off_t length)
+{
+	auto c = doc->get_comments().find(BitRangeTreeKey(offset, length));
+	if(c == doc->get_comments().end())
+	{
+		return "<no comment>";
+	}
+	
+	return c->value.text->ToStdString();
+}
+
+static std::string type_at(Document *doc, off_t offset)
+{
+	auto t = doc->get_data_types().get_range(offset);
+	if(t == doc->get_data_types().end())
+	{
+		return "<no type>";
+	}
+	
+	return t->second.name;
+}
+
+static void put_u16(std::vector<unsigned char> &data, size_t offset, uint16_t value)
+{
+	data[offset]     = value & 0xFF;
+	data[offset + 1] = (value >> 8) & 0xFF;
+}
+
+static void put_u32(std::vector<unsigned char> &data, size_t offset, uint32_t value)
+{
+	put_u16(data, offset,     value & 0xFFFF);
+	put_u16(data, offset + 2, (value >> 16) & 0xFFFF);
+}
+
+static void put_u64(std::vector<unsigned char> &data, size_t offset, uint64_t value)
+{
+	put_u32(data, offset,     value & 0xFFFFFFFF);
+	put_u32(data, offset + 4, (value >> 32) & 0xFFFFFFFF);
+}
+
+/* Builds a minimal PE32+ (x86-64) image with a .text and a .rdata section. */
+static std::vector<unsigned char> make_pe()
+{
+	std::vector<unsigned char> data(0x600, 0);
+	
+	/* DOS header */
+	data[0] = 'M';
+	data[1] = 'Z';
+	put_u32(data, 0x3C, 0x80); /* e_lfanew */
+	
+	/* PE signature */
+	data[0x80] = 'P';
+	data[0x81] = 'E';
+	
+	/* COFF header */
+	put_u16(data, 0x84, 0x8664); /* Machine */
+	put_u16(data, 0x86, 2);      /* NumberOfSections */
+	put_u16(data, 0x94, 240);    /* SizeOfOptionalHeader */
+	put_u16(data, 0x96, 0x0022); /* Characteristics */
+	
+	/* Optional header */
+	put_u16(data, 0x98,       0x20B);        /* Magic */
+	put_u32(data, 0x98 + 16,  0x1010);       /* AddressOfEntryPoint */
+	put_u64(data, 0x98 + 24,  0x140000000);  /* ImageBase */
+	put_u32(data, 0x98 + 60,  0x200);        /* SizeOfHeaders */
+	put_u16(data, 0x98 + 68,  3);            /* Subsystem */
+	put_u32(data, 0x98 + 108, 16);           /* NumberOfRvaAndSizes */
+	put_u32(data, 0x98 + 120, 0x2000);       /* Import directory RVA */
+	put_u32(data, 0x98 + 124, 0x28);         /* Import directory size */
+	
+	/* Section table (0x188) */
+	memcpy(&(data[0x188]), ".text", 5);
+	put_u32(data, 0x188 + 8,  0x100);        /* VirtualSize */
+	put_u32(data, 0x188 + 12, 0x1000);       /* VirtualAddress */
+	put_u32(data, 0x188 + 16, 0x200);        /* SizeOfRawData */
+	put_u32(data, 0x188 + 20, 0x200);        /* PointerToRawData */
+	put_u32(data, 0x188 + 36, 0x60000020);   /* Characteristics */
+	
+	memcpy(&(data[0x1B0]), ".rdata", 6);
+	put_u32(data, 0x1B0 + 8,  0x80);         /* VirtualSize */
+	put_u32(data, 0x1B0 + 12, 0x2000);       /* VirtualAddress */
+	put_u32(data, 0x1B0 + 16, 0x200);        /* SizeOfRawData */
+	put_u32(data, 0x1B0 + 20, 0x400);        /* PointerToRawData */
+	put_u32(data, 0x1B0 + 36, 0x40000040);   /* Characteristics */
+	
+	return data;
+}
+
+TEST(ExecutableAnnotator, ProbeELF)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make("tests/ls.x86_64"));
+	
+	EXPECT_TRUE(elf_probe(doc));
+	EXPECT_FALSE(pe_probe(doc));
+}
+
+TEST(ExecutableAnnotator, AnnotateELF)
+{
+	CodeTypeRegistration code_reg("code:x86_64");
+	
+	SharedDocumentPointer doc(SharedDocumentPointer::make("tests/ls.x86_64"));
+	
+	ASSERT_TRUE(annotate_executable(doc));
+	
+	EXPECT_EQ(comment_at(doc, 0, 64),
+		"ELF header\n"
+		"Class: ELF64\n"
+		"Data: little endian\n"
+		"Type: DYN (shared object)\n"
+		"Machine: x86-64\n"
+		"Entry point: 0x6130");
+	
+	EXPECT_EQ(type_at(doc, 0),  "u8");
+	EXPECT_EQ(type_at(doc, 16), "u16le");
+	EXPECT_EQ(type_at(doc, 24), "u64le");
+	EXPECT_EQ(type_at(doc, 52), "u16le");
+	
+	EXPECT_EQ(comment_at(doc, 64, (11 * 56)), "Program header table");
+	
+	EXPECT_EQ(comment_at(doc, (64 + (3 * 56)), 56),
+		"Program header 3\n"
+		"Type: LOAD\n"
+		"Offset: 0x4000\n"
+		"Virtual address: 0x4000\n"
+		"File size: 0x12cb9\n"
+		"Memory size: 0x12cb9\n"
+		"Memory access: read, execute");
+	
+	EXPECT_EQ(comment_at(doc, 137000, (29 * 64)), "Section header table");
+	EXPECT_EQ(comment_at(doc, (137000 + (14 * 64)), 64), "Section header 14 (.text)\nType: PROGBITS");
+	
+	EXPECT_EQ(comment_at(doc, 0x46F0, 0x125BE),
+		"Section .text\n"
+		"Type: PROGBITS\n"
+		"x86-64 machine code\n"
+		"Virtual address: 0x46f0\n"
+		"Memory access: read, execute\n"
+		"Size: 0x125be");
+	
+	EXPECT_EQ(type_at(doc, 0x46F0), "code:x86_64");
+	EXPECT_EQ(type_at(doc, 0x17000), "") << "Non-executable sections aren't typed as code";
+	
+	EXPECT_EQ(comment_at(doc, 0x215E8, 0x34),
+		"Section .gnu_debuglink\n"
+		"Type: PROGBITS\n"
+		"Size: 0x34");
+	
+	EXPECT_EQ(comment_at(doc, 0x6130, 0), "Entry point");
+	
+	const std::vector< std::pair<ByteRangeMap<off_t>::Range, off_t> > EXPECT_R2V = {
+		std::make_pair(ByteRangeMap<off_t>::Range(0x00000, 0x034A8), 0x00000),
+		std::make_pair(ByteRangeMap<off_t>::Range(0x04000, 0x12CB9), 0x04000),
+		std::make_pair(ByteRangeMap<off_t>::Range(0x17000, 0x08910), 0x17000),
+		std::make_pair(ByteRangeMap<off_t>::Range(0x20390, 0x01258), 0x21390),
+	};
+	
+	EXPECT_EQ(doc->get_real_to_virt_segs().get_ranges(), EXPECT_R2V);
+	
+	EXPECT_STREQ(doc->undo_desc(), "analyse ELF headers");
+}
+
+TEST(ExecutableAnnotator, ProbePE)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make());
+	
+	std::vector<unsigned char> pe = make_pe();
+	doc->insert_data(0, pe.data(), pe.size());
+	
+	EXPECT_TRUE(pe_probe(doc));
+	EXPECT_FALSE(elf_probe(doc));
+	
+	/* Break the PE signature. */
+	unsigned char x = 'X';
+	doc->overwrite_data(0x81, &x, 1);
+	
+	EXPECT_FALSE(pe_probe(doc));
+	EXPECT_THROW(pe_annotate(doc), std::runtime_error);
+}
+
+TEST(ExecutableAnnotator, AnnotatePE)
+{
+	CodeTypeRegistration code_reg("code:x86_64");
+	
+	SharedDocumentPointer doc(SharedDocumentPointer::make());
+	
+	std::vector<unsigned char> pe = make_pe();
+	doc->insert_data(0, pe.data(), pe.size());
+	
+	ASSERT_TRUE(annotate_executable(doc));
+	
+	EXPECT_EQ(comment_at(doc, 0x00, 0x40), "DOS header");
+	EXPECT_EQ(comment_at(doc, 0x40, 0x40), "DOS stub");
+	EXPECT_EQ(comment_at(doc, 0x80, 0x108), "PE header");
+	
+	EXPECT_EQ(comment_at(doc, 0x84, 20),
+		"COFF header\n"
+		"Machine: amd64\n"
+		"Number of sections: 2\n"
+		"Timestamp: 0\n"
+		"Characteristics: 0x22");
+	
+	EXPECT_EQ(comment_at(doc, 0x98, 240),
+		"Optional header (PE32+)\n"
+		"Entry point: 0x140001010\n"
+		"Image base: 0x140000000\n"
+		"Subsystem: 3");
+	
+	EXPECT_EQ(type_at(doc, 0x98),      "u16le");
+	EXPECT_EQ(type_at(doc, 0x98 + 24), "u64le");
+	EXPECT_EQ(type_at(doc, 0x98 + 72), "u64le");
+	EXPECT_EQ(type_at(doc, 0x98 + 112), "u32le");
+	
+	EXPECT_EQ(comment_at(doc, 0x188, 80), "Section table");
+	EXPECT_EQ(comment_at(doc, 0x188, 40), "Section header 0 (.text)");
+	EXPECT_EQ(comment_at(doc, 0x1B0, 40), "Section header 1 (.rdata)");
+	
+	EXPECT_EQ(comment_at(doc, 0x200, 0x200),
+		"Section .text\n"
+		"amd64 machine code\n"
+		"Virtual address: 0x140001000\n"
+		"Virtual size: 0x100\n"
+		"Memory access: execute, read");
+	
+	EXPECT_EQ(comment_at(doc, 0x400, 0x200),
+		"Section .rdata\n"
+		"Virtual address: 0x140002000\n"
+		"Virtual size: 0x80\n"
+		"Memory access: read");
+	
+	EXPECT_EQ(type_at(doc, 0x200), "code:x86_64");
+	EXPECT_EQ(type_at(doc, 0x400), "");
+	
+	EXPECT_EQ(comment_at(doc, 0x400, 0x28), "Import directory");
+	EXPECT_EQ(comment_at(doc, 0x210, 0), "Entry point");
+	
+	const std::vector< std::pair<ByteRangeMap<off_t>::Range, off_t> > EXPECT_R2V = {
+		std::make_pair(ByteRangeMap<off_t>::Range(0x000, 0x200), 0x140000000),
+		std::make_pair(ByteRangeMap<off_t>::Range(0x200, 0x100), 0x140001000),
+		std::make_pair(ByteRangeMap<off_t>::Range(0x400, 0x080), 0x140002000),
+	};
+	
+	EXPECT_EQ(doc->get_real_to_virt_segs().get_ranges(), EXPECT_R2V);
+	
+	EXPECT_STREQ(doc->undo_desc(), "analyse PE headers");
+}
+
+TEST(ExecutableAnnotator, AnnotatePEHighImageBase)
+{
+	/* Virtual addresses which don't fit in an off_t aren't mapped, but the rest of the
+	 * headers are still annotated.
+	*/
+	
+	SharedDocumentPointer doc(SharedDocumentPointer::make());
+	
+	std::vector<unsigned char> pe = make_pe();
+	put_u64(pe, 0x98 + 24, 0xFFFFFFFFFFFF0000ULL);  /* ImageBase */
+	doc->insert_data(0, pe.data(), pe.size());
+	
+	ASSERT_TRUE(annotate_executable(doc));
+	
+	EXPECT_EQ(comment_at(doc, 0x400, 0x200),
+		"Section .rdata\n"
+		"Virtual address: 0xffffffffffff2000\n"
+		"Virtual size: 0x80\n"
+		"Memory access: read");
+	
+	EXPECT_TRUE(doc->get_real_to_virt_segs().empty());
+}
+
+TEST(ExecutableAnnotator, AnnotateUnknown)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make());
+	
+	const char *DATA = "Not an executable";
+	doc->insert_data(0, (const unsigned char*)(DATA), strlen(DATA));
+	
+	EXPECT_FALSE(annotate_executable(doc));
+	EXPECT_TRUE(doc->get_comments().empty());
+}
+
+TEST(ExecutableAnnotator, AnnotateTruncatedELF)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make("tests/ls.x86_64"));
+	doc->erase_data(32, (doc->buffer_length() - 32));
+	
+	EXPECT_TRUE(elf_probe(doc));
+	EXPECT_THROW(elf_annotate(doc), std::runtime_error);
+}
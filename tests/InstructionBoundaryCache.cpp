@@ -0,0 +1,131 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+
+#include <capstone/capstone.h>
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/document.hpp"
+#include "../src/InstructionBoundaryCache.hpp"
+#include "../src/SharedDocumentPointer.hpp"
+
+using namespace REHex;
+
+/* Offset of a call to setlocale() in the .text section of tests/ls.x86_64 */
+static const off_t SETLOCALE_CALL = 0xCA1C;
+
+/* Check if disassembling forwards from from reaches an instruction starting at target. */
+static bool disassembly_reaches(Document *doc, off_t from, off_t target)
+{
+	std::vector<unsigned char> data = doc->read_data(from, ((target - from) + 16));
+	
+	csh disassembler;
+	if(cs_open(CS_ARCH_X86, CS_MODE_64, &disassembler) != CS_ERR_OK)
+	{
+		return false;
+	}
+	
+	bool reached = false;
+	
+	const uint8_t *code = data.data();
+	size_t code_size = data.size();
+	uint64_t address = from;
+	cs_insn *insn = cs_malloc(disassembler);
+	
+	while(cs_disasm_iter(disassembler, &code, &code_size, &address, insn) && (off_t)(insn->address) <= target)
+	{
+		if((off_t)(insn->address) == target)
+		{
+			reached = true;
+		}
+	}
+	
+	cs_free(insn, 1);
+	cs_close(&disassembler);
+	
+	return reached;
+}
+
+TEST(InstructionBoundaryCache, EmptyDocument)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make());
+	
+	InstructionBoundaryCache cache(doc, CS_ARCH_X86, CS_MODE_64);
+	cache.wait_for_completion();
+	
+	EXPECT_EQ(cache.find_boundary(0, 1024), -1);
+}
+
+TEST(InstructionBoundaryCache, FindBoundary)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make("tests/ls.x86_64"));
+	
+	InstructionBoundaryCache cache(doc, CS_ARCH_X86, CS_MODE_64);
+	cache.wait_for_completion();
+	
+	off_t boundary = cache.find_boundary((SETLOCALE_CALL - 64), (SETLOCALE_CALL + 1));
+	
+	ASSERT_GE(boundary, (SETLOCALE_CALL - 64));
+	ASSERT_LE(boundary, SETLOCALE_CALL);
+	
+	EXPECT_TRUE(disassembly_reaches(doc, boundary, SETLOCALE_CALL));
+	
+	EXPECT_EQ(cache.find_boundary(doc->buffer_length(), doc->buffer_length() + 1024), -1);
+}
+
+TEST(InstructionBoundaryCache, DataInserted)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make("tests/ls.x86_64"));
+	
+	InstructionBoundaryCache cache(doc, CS_ARCH_X86, CS_MODE_64);
+	cache.wait_for_completion();
+	
+	const unsigned char NOP[] = { 0x90 };
+	doc->insert_data(0, NOP, sizeof(NOP));
+	
+	cache.wait_for_completion();
+	
+	off_t boundary = cache.find_boundary((SETLOCALE_CALL + 1 - 64), (SETLOCALE_CALL + 2));
+	
+	ASSERT_GE(boundary, (SETLOCALE_CALL + 1 - 64));
+	ASSERT_LE(boundary, (SETLOCALE_CALL + 1));
+	
+	EXPECT_TRUE(disassembly_reaches(doc, boundary, (SETLOCALE_CALL + 1)));
+}
+
+TEST(InstructionBoundaryCache, DataErased)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make("tests/ls.x86_64"));
+	
+	InstructionBoundaryCache cache(doc, CS_ARCH_X86, CS_MODE_64);
+	cache.wait_for_completion();
+	
+	doc->erase_data(0, 16);
+	
+	cache.wait_for_completion();
+	
+	off_t boundary = cache.find_boundary((SETLOCALE_CALL - 16 - 64), (SETLOCALE_CALL - 16 + 1));
+	
+	ASSERT_GE(boundary, (SETLOCALE_CALL - 16 - 64));
+	ASSERT_LE(boundary, (SETLOCALE_CALL - 16));
+	
+	EXPECT_TRUE(disassembly_reaches(doc, boundary, (SETLOCALE_CALL - 16)));
+	
+	EXPECT_EQ(cache.find_boundary(doc->buffer_length(), doc->buffer_length() + 1024), -1);
+}
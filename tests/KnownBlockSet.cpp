@@ -0,0 +1,382 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "../src/ByteRangeSet.hpp"
+#include "../src/document.hpp"
+#include "../src/KnownBlockScan.hpp"
+#include "../src/KnownBlockSet.hpp"
+#include "../src/SharedDocumentPointer.hpp"
+#include "testutil.hpp"
+
+using namespace REHex;
+
+static std::vector<uint64_t> random_hashes(size_t count, uint64_t seed)
+{
+	std::vector<uint64_t> hashes(count);
+	
+	for(size_t i = 0; i < count; ++i)
+	{
+		/* splitmix64 */
+		seed += 0x9E3779B97F4A7C15ULL;
+		
+		uint64_t z = seed;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		hashes[i] = z ^ (z >> 31);
+	}
+	
+	return hashes;
+}
+
+static bool file_exists(const std::string &filename)
+{
+	FILE *fh = fopen(filename.c_str(), "rb");
+	if(fh != NULL)
+	{
+		fclose(fh);
+	}
+	
+	return fh != NULL;
+}
+
+TEST(KnownBlockSet, HashBlock)
+{
+	/* The hash of a block must never change, or any sets built before the change would no
+	 * longer match anything.
+	*/
+	
+	EXPECT_EQ(KnownBlockSet::hash_block("", 0), 0x4DFC92E0E55ABAACULL);
+	EXPECT_EQ(KnownBlockSet::hash_block("a", 1), 0x41DB2F766ADF7FACULL);
+	EXPECT_EQ(KnownBlockSet::hash_block("Hello, world!", 13), 0x97CA3E423A0960E1ULL);
+	
+	std::vector<unsigned char> block = random_data(4096, 1);
+	EXPECT_EQ(KnownBlockSet::hash_block(block.data(), block.size()), KnownBlockSet::hash_block(block.data(), block.size()));
+	
+	std::vector<unsigned char> block2 = block;
+	block2[4000] ^= 0x01;
+	EXPECT_NE(KnownBlockSet::hash_block(block.data(), block.size()), KnownBlockSet::hash_block(block2.data(), block2.size()));
+}
+
+TEST(KnownBlockSet, BuildAndLookup)
+{
+	TempFilename setfile;
+	
+	std::vector<uint64_t> hashes = random_hashes(100000, 1);
+	
+	{
+		KnownBlockSet::Builder builder(setfile.tmpfile, 512);
+		
+		for(auto h = hashes.begin(); h != hashes.end(); ++h)
+		{
+			builder.add_hash(*h);
+		}
+		
+		/* Duplicates are only stored once. */
+		builder.add_hash(hashes[0]);
+		builder.add_hash(hashes[500]);
+		
+		EXPECT_EQ(builder.get_hashes_added(), 100002U);
+		
+		builder.finish();
+	}
+	
+	{
+		KnownBlockSet set(setfile.tmpfile);
+		
+		EXPECT_EQ(set.get_block_size(), 512);
+		EXPECT_EQ(set.get_num_hashes(), 100000U);
+		
+		for(auto h = hashes.begin(); h != hashes.end(); ++h)
+		{
+			ASSERT_TRUE(set.contains(*h)) << "Hash " << *h << " is in set";
+		}
+		
+		/* Nothing which wasn't added is found - the Bloom filter passes around 1% of
+		 * these, which the binary search must then reject.
+		*/
+		
+		std::vector<uint64_t> others = random_hashes(100000, 2);
+		
+		for(auto h = others.begin(); h != others.end(); ++h)
+		{
+			ASSERT_FALSE(set.contains(*h)) << "Hash " << *h << " is not in set";
+		}
+	}
+}
+
+TEST(KnownBlockSet, BuildEmpty)
+{
+	TempFilename setfile;
+	
+	{
+		KnownBlockSet::Builder builder(setfile.tmpfile);
+		builder.finish();
+	}
+	
+	{
+		KnownBlockSet set(setfile.tmpfile);
+		
+		EXPECT_EQ(set.get_block_size(), KnownBlockSet::DEFAULT_BLOCK_SIZE);
+		EXPECT_EQ(set.get_num_hashes(), 0U);
+		EXPECT_FALSE(set.contains(0));
+		EXPECT_FALSE(set.contains(12345));
+	}
+}
+
+TEST(KnownBlockSet, BuildSpilledRuns)
+{
+	TempFilename setfile;
+	
+	/* Hashes spill to disk every 1000, with duplicates both within and across runs. */
+	
+	std::vector<uint64_t> hashes = random_hashes(10000, 3);
+	
+	{
+		KnownBlockSet::Builder builder(setfile.tmpfile, 4096, 1000);
+		
+		for(int pass = 0; pass < 2; ++pass)
+		{
+			for(size_t i = 0; i < hashes.size(); ++i)
+			{
+				builder.add_hash(hashes[i]);
+				
+				if((i % 7) == 0)
+				{
+					builder.add_hash(hashes[i]);
+				}
+			}
+		}
+		
+		EXPECT_TRUE(file_exists(std::string(setfile.tmpfile) + ".run0")) << "Builder spills hashes to disk";
+		
+		builder.finish();
+		
+		EXPECT_FALSE(file_exists(std::string(setfile.tmpfile) + ".run0")) << "Builder removes temporary files";
+	}
+	
+	{
+		KnownBlockSet set(setfile.tmpfile);
+		
+		EXPECT_EQ(set.get_num_hashes(), 10000U);
+		
+		for(auto h = hashes.begin(); h != hashes.end(); ++h)
+		{
+			ASSERT_TRUE(set.contains(*h)) << "Hash " << *h << " is in set";
+		}
+		
+		std::vector<uint64_t> others = random_hashes(10000, 4);
+		
+		for(auto h = others.begin(); h != others.end(); ++h)
+		{
+			ASSERT_FALSE(set.contains(*h)) << "Hash " << *h << " is not in set";
+		}
+	}
+}
+
+TEST(KnownBlockSet, AddFile)
+{
+	TempFilename tmpfile, setfile;
+	
+	/* Two whole blocks followed by a partial one, which is hashed padded with zeros. */
+	
+	std::vector<unsigned char> data = random_data(((2 * 1024) + 100), 5);
+	write_file(tmpfile.tmpfile, data);
+	
+	{
+		KnownBlockSet::Builder builder(setfile.tmpfile, 1024);
+		builder.add_file(tmpfile.tmpfile);
+		
+		EXPECT_EQ(builder.get_hashes_added(), 3U);
+		EXPECT_EQ(builder.get_bytes_added(), data.size());
+		
+		EXPECT_THROW(builder.add_file("tests/.nonexistent-file"), std::runtime_error);
+		
+		builder.finish();
+	}
+	
+	KnownBlockSet set(setfile.tmpfile);
+	
+	std::vector<unsigned char> last_block(data.begin() + 2048, data.end());
+	last_block.resize(1024, 0);
+	
+	EXPECT_TRUE(set.contains(KnownBlockSet::hash_block(data.data(), 1024)));
+	EXPECT_TRUE(set.contains(KnownBlockSet::hash_block((data.data() + 1024), 1024)));
+	EXPECT_TRUE(set.contains(KnownBlockSet::hash_block(last_block.data(), 1024)));
+	
+	EXPECT_FALSE(set.contains(KnownBlockSet::hash_block((data.data() + 1), 1024)));
+	EXPECT_FALSE(set.contains(KnownBlockSet::hash_block((data.data() + 2048), 100)));
+}
+
+TEST(KnownBlockSet, BuildCancelled)
+{
+	TempFilename tmpfile, setfile;
+	
+	write_file(tmpfile.tmpfile, random_data(4096, 6));
+	
+	std::vector<uint64_t> hashes = random_hashes(10000, 7);
+	std::atomic<bool> cancel(false);
+	
+	{
+		KnownBlockSet::Builder builder(setfile.tmpfile, 1024, 1000);
+		
+		for(auto h = hashes.begin(); h != hashes.end(); ++h)
+		{
+			builder.add_hash(*h);
+		}
+		
+		cancel = true;
+		
+		EXPECT_FALSE(builder.add_file(tmpfile.tmpfile, &cancel));
+		EXPECT_EQ(builder.get_hashes_added(), hashes.size()) << "Cancelled add_file() doesn't add any blocks";
+		
+		EXPECT_FALSE(builder.finish(&cancel));
+		
+		EXPECT_FALSE(file_exists(setfile.tmpfile)) << "Cancelled finish() doesn't leave a set behind";
+		EXPECT_FALSE(file_exists(std::string(setfile.tmpfile) + ".run0")) << "Cancelled finish() removes temporary files";
+	}
+}
+
+TEST(KnownBlockSet, OpenInvalid)
+{
+	TempFilename setfile;
+	
+	EXPECT_THROW(KnownBlockSet("tests/.nonexistent-file"), std::runtime_error);
+	
+	write_file(setfile.tmpfile, random_data(4096, 6));
+	EXPECT_THROW(KnownBlockSet(setfile.tmpfile), std::runtime_error) << "Opening a file which isn't a set fails";
+	
+	{
+		KnownBlockSet::Builder builder(setfile.tmpfile);
+		builder.add_hash(1);
+		builder.add_hash(2);
+		builder.finish();
+	}
+	
+	/* Chop the last hash off. */
+	
+	std::vector<unsigned char> set_data = read_file(setfile.tmpfile);
+	set_data.resize(set_data.size() - 8);
+	write_file(setfile.tmpfile, set_data);
+	
+	EXPECT_THROW(KnownBlockSet(setfile.tmpfile), std::runtime_error) << "Opening a truncated set fails";
+}
+
+TEST(KnownBlockScan, FindKnownBlocks)
+{
+	TempFilename tmpfile, setfile;
+	
+	const off_t BS = 512;
+	
+	/* Reference file of four blocks. */
+	
+	std::vector<unsigned char> ref = random_data((4 * BS), 7);
+	write_file(tmpfile.tmpfile, ref);
+	
+	{
+		KnownBlockSet::Builder builder(setfile.tmpfile, BS);
+		builder.add_file(tmpfile.tmpfile);
+		builder.finish();
+	}
+	
+	std::shared_ptr<const KnownBlockSet> set(new KnownBlockSet(setfile.tmpfile));
+	
+	/* Image with blocks 1 and 2 of the reference file at blocks 3-4, block 0 at block 7
+	 * and block 3 unaligned at byte 9 * BS + 1.
+	*/
+	
+	std::vector<unsigned char> image = random_data((12 * BS), 8);
+	
+	memcpy((image.data() + (3 * BS)), (ref.data() + BS), (2 * BS));
+	memcpy((image.data() + (7 * BS)), ref.data(), BS);
+	memcpy((image.data() + (9 * BS) + 1), (ref.data() + (3 * BS)), BS);
+	
+	SharedDocumentPointer doc = make_doc(image);
+	
+	for(off_t chunk_size : { BS, (4 * BS), KnownBlockScan::DEFAULT_CHUNK_SIZE })
+	{
+		KnownBlockScan scan(doc, set, 0, image.size(), chunk_size);
+		scan.wait_for_completion();
+		
+		ASSERT_TRUE(scan.is_complete());
+		EXPECT_EQ(scan.get_num_blocks(), 12U);
+		EXPECT_EQ(scan.get_blocks_done(), 12U);
+		EXPECT_EQ(scan.get_known_blocks(), 3U);
+		
+		ByteRangeSet known = scan.get_known_ranges();
+		std::vector<ByteRangeSet::Range> got_ranges(known.begin(), known.end());
+		
+		const std::vector<ByteRangeSet::Range> EXPECT_RANGES = {
+			ByteRangeSet::Range((3 * BS), (2 * BS)),
+			ByteRangeSet::Range((7 * BS), BS),
+		};
+		
+		EXPECT_EQ(got_ranges, EXPECT_RANGES) << "chunk_size = " << chunk_size;
+	}
+	
+	/* Scanning from the unaligned block finds it. */
+	
+	{
+		KnownBlockScan scan(doc, set, ((9 * BS) + 1), BS);
+		scan.wait_for_completion();
+		
+		EXPECT_EQ(scan.get_known_blocks(), 1U);
+		EXPECT_TRUE(scan.get_known_ranges().isset(((9 * BS) + 1), BS));
+	}
+}
+
+TEST(KnownBlockScan, PaddedTail)
+{
+	TempFilename tmpfile, setfile;
+	
+	/* A reference file which ends part way through a block matches the end of an image
+	 * which ends at the same point.
+	*/
+	
+	const off_t BS = 4096;
+	
+	std::vector<unsigned char> ref = random_data((BS + 1000), 9);
+	write_file(tmpfile.tmpfile, ref);
+	
+	{
+		KnownBlockSet::Builder builder(setfile.tmpfile, BS);
+		builder.add_file(tmpfile.tmpfile);
+		builder.finish();
+	}
+	
+	std::shared_ptr<const KnownBlockSet> set(new KnownBlockSet(setfile.tmpfile));
+	
+	SharedDocumentPointer doc = make_doc(ref);
+	
+	KnownBlockScan scan(doc, set, 0, ref.size());
+	scan.wait_for_completion();
+	
+	EXPECT_EQ(scan.get_num_blocks(), 2U);
+	EXPECT_EQ(scan.get_known_blocks(), 2U);
+	EXPECT_TRUE(scan.get_known_ranges().isset(0, ref.size()));
+}
@@ -0,0 +1,212 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include <vector>
+
+#include "../src/MultiDiff.hpp"
+#include "testutil.hpp"
+
+using namespace REHex;
+
+#define EXPECT_RANGES(actual, ...) \
+{ \
+	const std::vector<ByteRangeSet::Range> expect_ranges = { __VA_ARGS__ }; \
+	const ByteRangeSet &actual_ranges = actual; \
+	EXPECT_EQ(std::vector<ByteRangeSet::Range>(actual_ranges.begin(), actual_ranges.end()), expect_ranges); \
+}
+
+TEST(MultiDiff, TwoRangesSame)
+{
+	std::vector<unsigned char> a(1000, 0xAA);
+	std::vector<unsigned char> b(1000, 0xAA);
+	
+	const unsigned char *data[] = { a.data(), b.data() };
+	const off_t available[] = { 1000, 1000 };
+	
+	MultiDiff diff;
+	diff.reset(2);
+	diff.process_slice(0, 1000, data, available);
+	
+	EXPECT_RANGES(diff.get_different());
+	EXPECT_RANGES(diff.get_different(0));
+	EXPECT_RANGES(diff.get_different(1));
+}
+
+TEST(MultiDiff, TwoRangesDifferent)
+{
+	std::vector<unsigned char> a(1000, 0xAA);
+	std::vector<unsigned char> b(1000, 0xAA);
+	
+	b[0] = 0x00;
+	memset((b.data() + 100), 0x00, 20);
+	b[127] = 0x00;
+	b[999] = 0x00;
+	
+	const unsigned char *data[] = { a.data(), b.data() };
+	const off_t available[] = { 1000, 1000 };
+	
+	MultiDiff diff;
+	diff.reset(2);
+	diff.process_slice(2000, 1000, data, available);
+	
+	EXPECT_RANGES(diff.get_different(),
+		ByteRangeSet::Range(2000, 1),
+		ByteRangeSet::Range(2100, 20),
+		ByteRangeSet::Range(2127, 1),
+		ByteRangeSet::Range(2999, 1));
+	
+	EXPECT_RANGES(diff.get_different(1),
+		ByteRangeSet::Range(2000, 1),
+		ByteRangeSet::Range(2100, 20),
+		ByteRangeSet::Range(2127, 1),
+		ByteRangeSet::Range(2999, 1));
+}
+
+TEST(MultiDiff, ManyRanges)
+{
+	std::vector<unsigned char> a(256, 0x00);
+	std::vector<unsigned char> b(256, 0x00);
+	std::vector<unsigned char> c(256, 0x00);
+	std::vector<unsigned char> d(256, 0x00);
+	
+	b[10] = 0x01;
+	c[10] = 0x01;
+	c[20] = 0x02;
+	d[30] = 0x03;
+	d[31] = 0x03;
+	
+	const unsigned char *data[] = { a.data(), b.data(), c.data(), d.data() };
+	const off_t available[] = { 256, 256, 256, 256 };
+	
+	MultiDiff diff;
+	diff.reset(4);
+	diff.process_slice(0, 256, data, available);
+	
+	EXPECT_RANGES(diff.get_different(),
+		ByteRangeSet::Range(10, 1),
+		ByteRangeSet::Range(20, 1),
+		ByteRangeSet::Range(30, 2));
+	
+	EXPECT_RANGES(diff.get_different(1),
+		ByteRangeSet::Range(10, 1));
+	
+	EXPECT_RANGES(diff.get_different(2),
+		ByteRangeSet::Range(10, 1),
+		ByteRangeSet::Range(20, 1));
+	
+	EXPECT_RANGES(diff.get_different(3),
+		ByteRangeSet::Range(30, 2));
+}
+
+TEST(MultiDiff, RangesEnd)
+{
+	std::vector<unsigned char> a(100, 0x00);
+	std::vector<unsigned char> b(60, 0x00);
+	std::vector<unsigned char> c(80, 0x00);
+	
+	const unsigned char *data[] = { a.data(), b.data(), c.data() };
+	const off_t available[] = { 100, 60, 80 };
+	
+	MultiDiff diff;
+	diff.reset(3);
+	diff.process_slice(0, 100, data, available);
+	
+	EXPECT_RANGES(diff.get_different(),
+		ByteRangeSet::Range(60, 40));
+	
+	EXPECT_RANGES(diff.get_different(1),
+		ByteRangeSet::Range(60, 40));
+	
+	EXPECT_RANGES(diff.get_different(2),
+		ByteRangeSet::Range(80, 20));
+}
+
+TEST(MultiDiff, BaseRangeEnds)
+{
+	std::vector<unsigned char> b(100, 0x00);
+	
+	const unsigned char *data[] = { NULL, b.data(), NULL };
+	const off_t available[] = { 0, 100, 0 };
+	
+	MultiDiff diff;
+	diff.reset(3);
+	diff.process_slice(500, 100, data, available);
+	
+	EXPECT_RANGES(diff.get_different(),
+		ByteRangeSet::Range(500, 100));
+	
+	EXPECT_RANGES(diff.get_different(1),
+		ByteRangeSet::Range(500, 100));
+	
+	/* Both the base and third ranges have ended, so they don't differ. */
+	EXPECT_RANGES(diff.get_different(2));
+}
+
+TEST(MultiDiff, OnlyBaseRangeHasData)
+{
+	std::vector<unsigned char> a(100, 0x00);
+	
+	const unsigned char *data[] = { a.data(), NULL, NULL };
+	const off_t available[] = { 100, 0, 0 };
+	
+	MultiDiff diff;
+	diff.reset(3);
+	diff.process_slice(200, 100, data, available);
+	
+	EXPECT_RANGES(diff.get_different(),
+		ByteRangeSet::Range(200, 100));
+	
+	EXPECT_RANGES(diff.get_different(1),
+		ByteRangeSet::Range(200, 100));
+	
+	EXPECT_RANGES(diff.get_different(2),
+		ByteRangeSet::Range(200, 100));
+}
+
+TEST(MultiDiff, ReprocessSlice)
+{
+	std::vector<unsigned char> a(100, 0x00);
+	std::vector<unsigned char> b(100, 0x00);
+	
+	b[50] = 0x01;
+	
+	const unsigned char *data[] = { a.data(), b.data() };
+	const off_t available[] = { 100, 100 };
+	
+	MultiDiff diff;
+	diff.reset(2);
+	diff.process_slice(0, 100, data, available);
+	
+	EXPECT_RANGES(diff.get_different(), ByteRangeSet::Range(50, 1));
+	
+	b[50] = 0x00;
+	b[60] = 0x01;
+	
+	diff.process_slice(0, 100, data, available);
+	
+	EXPECT_RANGES(diff.get_different(), ByteRangeSet::Range(60, 1));
+	EXPECT_RANGES(diff.get_different(1), ByteRangeSet::Range(60, 1));
+	
+	diff.clear_range(0, 100);
+	
+	EXPECT_RANGES(diff.get_different());
+	EXPECT_RANGES(diff.get_different(1));
+}
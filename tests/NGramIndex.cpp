@@ -0,0 +1,229 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <wx/frame.h>
+
+#include "../src/ByteRangeSet.hpp"
+#include "../src/document.hpp"
+#include "../src/NGramIndex.hpp"
+#include "../src/search.hpp"
+#include "../src/SharedDocumentPointer.hpp"
+
+using namespace REHex;
+
+#define TMPFILE  "tests/.tmpfile"
+
+static const off_t BS = NGramIndex::BLOCK_SIZE;
+
+static std::vector<unsigned char> S(const char *s)
+{
+	return std::vector<unsigned char>(s, s + strlen(s));
+}
+
+/* 16 blocks of zeros with a few strings dotted around. */
+static std::vector<unsigned char> make_data()
+{
+	std::vector<unsigned char> data(16 * BS, 0);
+	
+	memcpy(data.data() + (5 * BS) + 100, "Hello, world", 12);
+	memcpy(data.data() + (7 * BS) - 3,   "Hello, world", 12);  /* Spans blocks 6 and 7 */
+	memcpy(data.data() + (12 * BS),      "abcdefgh",     8);
+	
+	return data;
+}
+
+static ByteRangeSet ranges(const std::vector< std::pair<off_t, off_t> > &r)
+{
+	ByteRangeSet set;
+	for(auto i = r.begin(); i != r.end(); ++i)
+	{
+		set.set_range(i->first, i->second);
+	}
+	
+	return set;
+}
+
+TEST(NGramIndex, FindCandidates)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make());
+	
+	std::vector<unsigned char> data = make_data();
+	doc->insert_data(0, data.data(), data.size());
+	
+	NGramIndex index(doc);
+	index.wait_for_completion();
+	
+	EXPECT_EQ(index.get_indexed_blocks(), 16U);
+	
+	EXPECT_EQ(index.find_candidates(S("hello")), ranges({ { 5 * BS, 2 * BS } })) << "NGramIndex::find_candidates() finds blocks where sequence starts (ignoring case)";
+	EXPECT_EQ(index.find_candidates(S("WORLD")), ranges({ { 5 * BS, 3 * BS } })) << "NGramIndex::find_candidates() finds blocks where sequence starts (ignoring case)";
+	
+	/* Block 11 covers the start of block 12 too. */
+	EXPECT_EQ(index.find_candidates(S("abcdefgh")), ranges({ { 11 * BS, 2 * BS } })) << "NGramIndex::find_candidates() finds blocks overlapping the start of the sequence";
+	
+	EXPECT_EQ(index.find_candidates(S("goodbye")), ranges({})) << "NGramIndex::find_candidates() returns no candidates for sequences not in file";
+	
+	EXPECT_EQ(index.find_candidates(S("he")), ranges({ { 0, 16 * BS } })) << "NGramIndex::find_candidates() returns whole file for sequences shorter than a trigram";
+}
+
+TEST(NGramIndex, SaturatedBlocks)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make());
+	
+	std::vector<unsigned char> data = make_data();
+	
+	/* Fill block 2 with noise which will set most of the bits in its bitmap. */
+	uint32_t seed = 1;
+	for(off_t i = 2 * BS; i < (3 * BS); ++i)
+	{
+		seed = (seed * 1103515245) + 12345;
+		data[i] = (seed >> 16) & 0xFF;
+	}
+	
+	doc->insert_data(0, data.data(), data.size());
+	
+	NGramIndex index(doc);
+	index.wait_for_completion();
+	
+	EXPECT_EQ(index.find_candidates(S("hello")), ranges({ { 2 * BS, BS }, { 5 * BS, 2 * BS } })) << "NGramIndex::find_candidates() always returns saturated blocks";
+}
+
+TEST(NGramIndex, DataModified)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make());
+	
+	std::vector<unsigned char> data = make_data();
+	doc->insert_data(0, data.data(), data.size());
+	
+	NGramIndex index(doc);
+	index.wait_for_completion();
+	
+	doc->overwrite_data((9 * BS) + 1000, "hello", 5);
+	index.wait_for_completion();
+	
+	EXPECT_EQ(index.find_candidates(S("hello")), ranges({ { 5 * BS, 2 * BS }, { 9 * BS, BS } })) << "NGramIndex indexes overwritten blocks again";
+	
+	doc->overwrite_data((5 * BS) + 100, "HELP!", 5);
+	index.wait_for_completion();
+	
+	EXPECT_EQ(index.find_candidates(S("hello")), ranges({ { 6 * BS, BS }, { 9 * BS, BS } })) << "NGramIndex indexes overwritten blocks again";
+	
+	std::vector<unsigned char> zeros(BS, 0);
+	doc->insert_data(0, zeros.data(), zeros.size());
+	index.wait_for_completion();
+	
+	EXPECT_EQ(index.get_indexed_blocks(), 17U);
+	EXPECT_EQ(index.find_candidates(S("hello")), ranges({ { 7 * BS, BS }, { 10 * BS, BS } })) << "NGramIndex indexes blocks moved by an insert again";
+	
+	doc->erase_data(0, (2 * BS));
+	index.wait_for_completion();
+	
+	EXPECT_EQ(index.get_indexed_blocks(), 15U);
+	EXPECT_EQ(index.find_candidates(S("hello")), ranges({ { 5 * BS, BS }, { 8 * BS, BS } })) << "NGramIndex indexes blocks moved by an erase again";
+}
+
+TEST(NGramIndex, Cache)
+{
+	{
+		std::vector<unsigned char> data = make_data();
+		
+		FILE *tmp = fopen(TMPFILE, "wb");
+		ASSERT_NE(tmp, (FILE*)(NULL));
+		fwrite(data.data(), data.size(), 1, tmp);
+		fclose(tmp);
+	}
+	
+	NGramIndex::remove_cache(TMPFILE);
+	
+	SharedDocumentPointer doc(SharedDocumentPointer::make(TMPFILE));
+	
+	ByteRangeSet hello_candidates;
+	
+	{
+		NGramIndex index(doc);
+		index.wait_for_completion();
+		
+		hello_candidates = index.find_candidates(S("hello"));
+		
+		EXPECT_TRUE(index.save_cache());
+		EXPECT_TRUE(NGramIndex::cache_exists(TMPFILE));
+	}
+	
+	{
+		/* The whole index is loaded from the cache, so is available straight away. */
+		NGramIndex index(doc);
+		
+		EXPECT_EQ(index.get_indexed_blocks(), 16U);
+		EXPECT_EQ(index.find_candidates(S("hello")), hello_candidates);
+	}
+	
+	{
+		NGramIndex index(doc, false);
+		index.wait_for_completion();
+		
+		EXPECT_EQ(index.find_candidates(S("hello")), hello_candidates);
+		
+		doc->overwrite_data(0, "hello", 5);
+		EXPECT_FALSE(index.save_cache()) << "NGramIndex::save_cache() doesn't save index of modified data";
+	}
+	
+	NGramIndex::remove_cache(TMPFILE);
+	EXPECT_FALSE(NGramIndex::cache_exists(TMPFILE));
+}
+
+TEST(NGramIndex, Search)
+{
+	wxFrame frame(NULL, wxID_ANY, wxT("Unit tests"));
+	
+	SharedDocumentPointer doc(SharedDocumentPointer::make());
+	
+	std::vector<unsigned char> data = make_data();
+	doc->insert_data(0, data.data(), data.size());
+	
+	std::shared_ptr<NGramIndex> index(new NGramIndex(doc));
+	index->wait_for_completion();
+	
+	{
+		Search::ByteSequence s(&frame, doc, S("Hello, world"));
+		s.set_index(index);
+		
+		EXPECT_EQ(s.find_next(0, 4096), (5 * BS) + 100);
+		EXPECT_EQ(s.find_next((5 * BS) + 101, 4096), (7 * BS) - 3) << "Search using NGramIndex finds sequences spanning blocks";
+		EXPECT_EQ(s.find_next((7 * BS) - 2, 4096), -1);
+	}
+	
+	{
+		Search::Text s(&frame, doc, "HELLO", false);
+		s.set_index(index);
+		
+		EXPECT_EQ(s.find_next(0, 4096), (5 * BS) + 100) << "Search using NGramIndex finds case-insensitive text";
+	}
+	
+	{
+		Search::ByteSequence s(&frame, doc, S("abcdefgh"));
+		s.set_index(index);
+		
+		EXPECT_EQ(s.find_next(0, 4096), (12 * BS));
+	}
+}
@@ -444,3 +444,39 @@ TEST(RangeProcessorTest, GetQueue)
 		EXPECT_EQ(got_queue, EXPECT_QUEUE);
 	}
 }
+
+TEST(RangeProcessorTest, ProcessFocusFirst)
+{
+	std::mutex lock;
+	std::vector< std::pair<off_t, off_t> > got_calls;
+	
+	auto func = [&](off_t window_base, off_t window_size)
+	{
+		lock.lock();
+		got_calls.push_back( std::make_pair(window_base, window_size) );
+		lock.unlock();
+	};
+	
+	RangeProcessor rp(func, 1024 /* 1KiB window */);
+	rp.set_max_threads(1);
+	
+	ByteRangeSet focus;
+	focus.set_range((1024 * 6) + 100, 1024);
+	rp.set_focus(focus);
+	
+	rp.queue_range(0, 1024 * 8);
+	rp.wait_for_completion();
+	
+	const std::vector< std::pair<off_t, off_t> > EXPECT_CALLS = {
+		std::make_pair(1024 * 6, 1024),
+		std::make_pair(1024 * 7, 1024),
+		std::make_pair(1024 * 5, 1024),
+		std::make_pair(1024 * 4, 1024),
+		std::make_pair(1024 * 3, 1024),
+		std::make_pair(1024 * 2, 1024),
+		std::make_pair(1024 * 1, 1024),
+		std::make_pair(1024 * 0, 1024),
+	};
+	
+	EXPECT_EQ(got_calls, EXPECT_CALLS);
+}
@@ -0,0 +1,120 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/RangeScheduler.hpp"
+
+using namespace REHex;
+
+TEST(RangeScheduler, EmptyQueue)
+{
+	RangeScheduler rs;
+	ByteRangeSet queue;
+	
+	EXPECT_EQ(rs.next_window(queue, 0, 1024), ByteRangeSet::Range(0, 0));
+	
+	ByteRangeSet focus;
+	focus.set_range(4096, 1024);
+	rs.set_focus(focus);
+	
+	EXPECT_EQ(rs.next_window(queue, 0, 1024), ByteRangeSet::Range(0, 0));
+}
+
+TEST(RangeScheduler, NoFocus)
+{
+	RangeScheduler rs;
+	
+	ByteRangeSet queue;
+	queue.set_range(100, 5000);
+	queue.set_range(10000, 100);
+	
+	EXPECT_EQ(rs.next_window(queue, 0, 1024), ByteRangeSet::Range(100, 1024)) << "RangeScheduler::next_window() returns the lowest window when no focus is set";
+	EXPECT_EQ(rs.next_window(queue, 5000, 1024), ByteRangeSet::Range(5000, 100)) << "RangeScheduler::next_window() clamps window to min_offset";
+	EXPECT_EQ(rs.next_window(queue, 6000, 1024), ByteRangeSet::Range(10000, 100));
+	EXPECT_EQ(rs.next_window(queue, 20000, 1024), ByteRangeSet::Range(0, 0));
+}
+
+TEST(RangeScheduler, FocusInsideQueue)
+{
+	RangeScheduler rs;
+	
+	ByteRangeSet queue;
+	queue.set_range(0, 100000);
+	
+	ByteRangeSet focus;
+	focus.set_range(50000, 2000);
+	rs.set_focus(focus);
+	
+	EXPECT_EQ(rs.next_window(queue, 0, 1024), ByteRangeSet::Range(49152, 1024)) << "RangeScheduler::next_window() returns aligned window containing start of focus";
+	
+	queue.clear_range(49152, 1024);
+	EXPECT_EQ(rs.next_window(queue, 0, 1024), ByteRangeSet::Range(50176, 1024)) << "RangeScheduler::next_window() returns next window within focus";
+	
+	queue.clear_range(50176, 1024);
+	queue.clear_range(51200, 1024);
+	EXPECT_EQ(rs.next_window(queue, 0, 1024), ByteRangeSet::Range(52224, 1024)) << "RangeScheduler::next_window() returns nearest window once focus is done";
+}
+
+TEST(RangeScheduler, FocusBetweenRanges)
+{
+	RangeScheduler rs;
+	
+	ByteRangeSet queue;
+	queue.set_range(0, 1000);
+	queue.set_range(9000, 1000);
+	
+	ByteRangeSet focus;
+	focus.set_range(3000, 100);
+	rs.set_focus(focus);
+	
+	EXPECT_EQ(rs.next_window(queue, 0, 1024), ByteRangeSet::Range(0, 1000)) << "RangeScheduler::next_window() returns nearest range before focus";
+	
+	focus.clear_all();
+	focus.set_range(8000, 100);
+	rs.set_focus(focus);
+	
+	EXPECT_EQ(rs.next_window(queue, 0, 1024), ByteRangeSet::Range(9000, 216)) << "RangeScheduler::next_window() returns nearest range after focus";
+	EXPECT_EQ(rs.next_window(queue, 9500, 1024), ByteRangeSet::Range(9500, 500)) << "RangeScheduler::next_window() clamps window to min_offset";
+	
+	rs.clear_focus();
+	
+	EXPECT_EQ(rs.next_window(queue, 0, 1024), ByteRangeSet::Range(0, 1000));
+}
+
+TEST(RangeScheduler, MultipleFocusRanges)
+{
+	RangeScheduler rs;
+	
+	ByteRangeSet queue;
+	queue.set_range(10000, 100);
+	queue.set_range(20000, 100);
+	
+	ByteRangeSet focus;
+	focus.set_range(0, 100);
+	focus.set_range(19000, 10);
+	rs.set_focus(focus);
+	
+	EXPECT_EQ(rs.next_window(queue, 0, 1024), ByteRangeSet::Range(20000, 100)) << "RangeScheduler::next_window() returns range nearest to any focus";
+	
+	queue.set_range(500, 100);
+	
+	EXPECT_EQ(rs.next_window(queue, 0, 1024), ByteRangeSet::Range(500, 100)) << "RangeScheduler::next_window() returns range nearest to any focus";
+}
@@ -0,0 +1,239 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string>
+#include <string.h>
+#include <vector>
+
+#include "../src/document.hpp"
+#include "../src/SharedDocumentPointer.hpp"
+#include "../src/SignatureScanner.hpp"
+
+using namespace REHex;
+
+typedef SignatureScanner::Match Match;
+
+static std::vector<Match> scan_string(const SignatureScanner &scanner, const std::string &data, size_t string_idx)
+{
+	SignatureScanner::Results results = scanner.scan((const unsigned char*)(data.data()), data.size());
+	return results.matches[string_idx];
+}
+
+static std::vector<std::string> matched_rules(const SignatureScanner &scanner, const std::string &data)
+{
+	std::vector<SignatureScanner::RuleMatch> matches = scanner.evaluate(scanner.scan((const unsigned char*)(data.data()), data.size()));
+	
+	std::vector<std::string> names;
+	for(auto m = matches.begin(); m != matches.end(); ++m)
+	{
+		names.push_back(m->rule);
+	}
+	
+	return names;
+}
+
+static int parse_error_line(const std::string &rules)
+{
+	try {
+		SignatureScanner scanner(rules);
+	}
+	catch(const SignatureScanner::ParseError &e)
+	{
+		return e.line;
+	}
+	
+	return -1;
+}
+
+TEST(SignatureScanner, TextString)
+{
+	SignatureScanner scanner(
+		"rule text { strings: $a = \"abc\" condition: $a }\n"
+		"rule text_nocase { strings: $a = \"HeLLo\\x21\" nocase condition: $a }\n");
+	
+	EXPECT_EQ(scanner.num_rules(), 2U);
+	EXPECT_EQ(scanner.num_strings(), 2U);
+	
+	std::string data = "xxabcxxabxabcabc hello! HELLO! hello?";
+	
+	EXPECT_EQ(scan_string(scanner, data, 0), std::vector<Match>({ Match(2, 3), Match(10, 3), Match(13, 3) }));
+	EXPECT_EQ(scan_string(scanner, data, 1), std::vector<Match>({ Match(17, 6), Match(24, 6) }));
+}
+
+TEST(SignatureScanner, HexString)
+{
+	SignatureScanner scanner(
+		"rule wildcards { strings: $a = { 4D 5A ?? ?0 [2-3] 50 45 } condition: $a }\n"
+		"rule leading_wildcard { strings: $b = { ?? ?? 01 02 } condition: $b }\n");
+	
+	const unsigned char DATA[] = {
+		0x4D, 0x5A, 0x99, 0x10, 0xAA, 0xBB, 0x50, 0x45,        /* Match at 0, jump of 2 */
+		0x4D, 0x5A, 0x99, 0x11, 0xAA, 0xBB, 0x50, 0x45,        /* Low nibble doesn't match */
+		0x4D, 0x5A, 0x00, 0xF0, 0xAA, 0xBB, 0xCC, 0x50, 0x45,  /* Match at 16, jump of 3 */
+		0x4D, 0x5A, 0x00, 0xF0, 0xAA, 0xBB, 0xCC, 0xDD, 0x50,  /* Jump too long */
+		0x01, 0x02,                                            /* Match at 32 */
+	};
+	
+	SignatureScanner::Results results = scanner.scan(DATA, sizeof(DATA));
+	
+	EXPECT_EQ(results.matches[0], std::vector<Match>({ Match(0, 8), Match(16, 9) }));
+	EXPECT_EQ(results.matches[1], std::vector<Match>({ Match(32, 4) }));
+	
+	EXPECT_EQ(results.match_counts, std::vector<size_t>({ 2U, 1U }));
+}
+
+TEST(SignatureScanner, ManyVariableJumps)
+{
+	/* Without remembering which positions have already failed, this would try every
+	 * combination of jump lengths (about 100^6) at the start of the data.
+	*/
+	SignatureScanner scanner(
+		"rule jumps { strings: $a = { 4D 5A [0-100] ?? [0-100] ?? [0-100] ?? [0-100] ?? [0-100] ?? [0-100] FF } condition: $a }\n");
+	
+	std::vector<unsigned char> data(1024, 0x00);
+	data[0] = 0x4D;
+	data[1] = 0x5A;
+	
+	SignatureScanner::Results results = scanner.scan(data.data(), data.size());
+	EXPECT_EQ(results.match_counts, std::vector<size_t>({ 0U }));
+	
+	data[600] = 0xFF;
+	
+	results = scanner.scan(data.data(), data.size());
+	EXPECT_EQ(results.matches[0], std::vector<Match>({ Match(0, 601) }));
+}
+
+TEST(SignatureScanner, Conditions)
+{
+	SignatureScanner scanner(
+		"rule at_0        { strings: $a = \"AB\" condition: $a at 0 }\n"
+		"rule at_1        { strings: $a = \"AB\" condition: $a at 1 }\n"
+		"rule in_range    { strings: $a = \"AB\" condition: $a in (3..10) }\n"
+		"rule count       { strings: $a = \"AB\" condition: #a == 3 }\n"
+		"rule offset      { strings: $a = \"AB\" condition: @a[2] == 0x4 and @a < 1 }\n"
+		"rule filesize    { strings: $a = \"AB\" condition: filesize > 1KB }\n"
+		"rule any_of      { strings: $a = \"AB\" $b = \"ZZ\" condition: any of them }\n"
+		"rule all_of      { strings: $a = \"AB\" $b = \"ZZ\" condition: all of them }\n"
+		"rule n_of_list   { strings: $x1 = \"AB\" $x2 = \"CD\" $y = \"ZZ\" condition: 2 of ($x*) and not $y }\n"
+		"rule precedence  { strings: $a = \"AB\" condition: false and false or $a }\n"
+		"rule parentheses { strings: $a = \"AB\" condition: false and (false or $a) }\n");
+	
+	EXPECT_EQ(matched_rules(scanner, "AB__AB_AB_CD"), std::vector<std::string>({
+		"at_0",
+		"in_range",
+		"count",
+		"offset",
+		"any_of",
+		"n_of_list",
+		"precedence",
+	}));
+}
+
+TEST(SignatureScanner, ManyRules)
+{
+	/* Lots of rules with overlapping atoms, only some of which match. */
+	
+	std::string rules;
+	for(int i = 0; i < 500; ++i)
+	{
+		char rule[128];
+		snprintf(rule, sizeof(rule), "rule r%d { strings: $a = { %02X %02X ?? %02X } condition: $a }\n", i, (i % 7), (i / 7) % 256, (i % 13));
+		
+		rules += rule;
+	}
+	
+	SignatureScanner scanner(rules);
+	
+	std::string data(4096, '\xFF');
+	
+	/* Matches r100 ({ 02 0E ?? 09 }) and r101 ({ 03 0E ?? 0A }) */
+	memcpy(&(data[1000]), "\x02\x0E\x00\x09", 4);
+	memcpy(&(data[2000]), "\x03\x0E\x00\x0A", 4);
+	
+	EXPECT_EQ(matched_rules(scanner, data), std::vector<std::string>({ "r100", "r101" }));
+}
+
+TEST(SignatureScanner, ParseErrors)
+{
+	EXPECT_EQ(parse_error_line(""), 1) << "No rules";
+	EXPECT_EQ(parse_error_line("rule a {\n condition: true\n}"), 2) << "Rule without strings";
+	EXPECT_EQ(parse_error_line("rule a {\n strings: $a = \"x\"\n condition: $b\n}"), 3) << "Undefined string";
+	EXPECT_EQ(parse_error_line("rule a {\n strings:\n $a = { 01 [1-] 02 }\n condition: $a\n}"), 3) << "Unbounded jump";
+	EXPECT_EQ(parse_error_line("rule a {\n strings:\n $a = { ?? [1] 02 }\n condition: $a\n}"), 3) << "No fixed byte before jump";
+	EXPECT_EQ(parse_error_line("rule a {\n strings:\n $a = \"x\" wide\n condition: $a\n}"), 3) << "Unsupported modifier";
+	EXPECT_EQ(parse_error_line("/* a\n comment */ rule a {\n strings:\n $a = \"x\"\n condition: $a or\n}"), 6) << "Incomplete condition";
+	EXPECT_EQ(parse_error_line("rule a { strings: $a = \"x\" condition: $a }\nrule a { strings: $a = \"x\" condition: $a }"), 2) << "Duplicate rule";
+}
+
+TEST(SignatureScanner, ScanDocument)
+{
+	SignatureScanner scanner(
+		"rule header { strings: $a = { DE AD [0-4] BE EF } condition: $a at 0 }\n"
+		"rule marker { strings: $a = \"MARK\" condition: #a == 4 }\n");
+	
+	/* The document is scanned in small windows so matches straddle window boundaries. */
+	
+	std::vector<unsigned char> data(100000, 0);
+	memcpy(data.data(), "\xDE\xAD\x00\x00\xBE\xEF", 6);
+	memcpy(data.data() + 1022, "MARK", 4);
+	memcpy(data.data() + 2048, "MARK", 4);
+	memcpy(data.data() + 50001, "MARK", 4);
+	memcpy(data.data() + 99996, "MARK", 4);
+	
+	SharedDocumentPointer doc(SharedDocumentPointer::make());
+	doc->insert_data(0, data.data(), data.size());
+	
+	SignatureScanner::Results results;
+	EXPECT_TRUE(scanner.scan(doc, &results, NULL, 1024));
+	
+	EXPECT_EQ(results.matches[1], std::vector<Match>({ Match(1022, 4), Match(2048, 4), Match(50001, 4), Match(99996, 4) }));
+	
+	std::vector<SignatureScanner::RuleMatch> matches = scanner.evaluate(results);
+	ASSERT_EQ(matches.size(), 2U);
+	
+	EXPECT_EQ(matches[0].rule, "header");
+	EXPECT_EQ(matches[0].strings, (std::vector< std::pair<std::string, Match> >({ std::make_pair("a", Match(0, 6)) })));
+	
+	EXPECT_EQ(matches[1].rule, "marker");
+	EXPECT_EQ(matches[1].strings.size(), 4U);
+	
+	size_t applied = doc->apply_annotations(SignatureScanner::annotate(matches, 0), "signature scan");
+	EXPECT_EQ(applied, 10U) << "SignatureScanner::annotate() returns a comment and highlight for each match";
+	
+	auto c = doc->get_comments().find(BitRangeTreeKey(1022, 4));
+	ASSERT_NE(c, doc->get_comments().end());
+	EXPECT_EQ(c->value.text->ToStdString(), "marker ($a)");
+	
+	EXPECT_NE(doc->get_highlights().get_range(BitOffset(50001, 0)), doc->get_highlights().end());
+}
+
+TEST(SignatureScanner, ScanDocumentAbort)
+{
+	SignatureScanner scanner("rule a { strings: $a = \"x\" condition: $a }");
+	
+	std::vector<unsigned char> data(1024 * 1024, 'x');
+	
+	SharedDocumentPointer doc(SharedDocumentPointer::make());
+	doc->insert_data(0, data.data(), data.size());
+	
+	SignatureScanner::Results results;
+	EXPECT_FALSE(scanner.scan(doc, &results, [](off_t done, off_t total) { return false; }, 1024)) << "SignatureScanner::scan() returns false when aborted";
+}
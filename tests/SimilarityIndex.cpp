@@ -0,0 +1,187 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "../src/document.hpp"
+#include "../src/SharedDocumentPointer.hpp"
+#include "../src/SimilarityIndex.hpp"
+#include "testutil.hpp"
+
+using namespace REHex;
+
+typedef SimilarityIndex::Match Match;
+
+TEST(SimilarityIndex, BlockSizeFor)
+{
+	EXPECT_EQ(SimilarityIndex::block_size_for(0), 3);
+	EXPECT_EQ(SimilarityIndex::block_size_for(192), 3);
+	EXPECT_EQ(SimilarityIndex::block_size_for(193), 6);
+	EXPECT_EQ(SimilarityIndex::block_size_for(4096), 96);
+}
+
+TEST(SimilarityIndex, Compare)
+{
+	EXPECT_EQ(SimilarityIndex::compare("ABCD", "ABCD"), 100);
+	EXPECT_EQ(SimilarityIndex::compare("ABCD", "ABXD"), 75);
+	EXPECT_EQ(SimilarityIndex::compare("ABCD", "ABD"), 75);
+	EXPECT_EQ(SimilarityIndex::compare("ABCD", "WXYZ"), 0);
+	EXPECT_EQ(SimilarityIndex::compare("", "ABCD"), 0);
+	EXPECT_EQ(SimilarityIndex::compare("", ""), 0);
+}
+
+TEST(SimilarityIndex, ChunkSize)
+{
+	/* Pieces spanning chunks must be hashed the same as if the file was hashed in one go. */
+	
+	SharedDocumentPointer doc = make_doc(random_data(300000, 1));
+	
+	SimilarityIndex one_chunk(doc, 24, 1024 * 1024);
+	SimilarityIndex small_chunks(doc, 24, 1000);
+	SimilarityIndex tiny_chunks(doc, 24, 7);
+	
+	one_chunk.wait_for_completion();
+	small_chunks.wait_for_completion();
+	tiny_chunks.wait_for_completion();
+	
+	ASSERT_TRUE(one_chunk.is_complete());
+	ASSERT_TRUE(small_chunks.is_complete());
+	ASSERT_TRUE(tiny_chunks.is_complete());
+	
+	EXPECT_EQ(one_chunk.get_bytes_processed(), 300000);
+	
+	/* Around one piece every block_size bytes. */
+	EXPECT_GT(one_chunk.get_num_pieces(), (300000U / 24U) / 2U);
+	EXPECT_LT(one_chunk.get_num_pieces(), (300000U / 24U) * 2U);
+	
+	EXPECT_EQ(small_chunks.get_num_pieces(), one_chunk.get_num_pieces());
+	EXPECT_EQ(tiny_chunks.get_num_pieces(), one_chunk.get_num_pieces());
+	
+	EXPECT_EQ(small_chunks.signature(0, 300000), one_chunk.signature(0, 300000));
+	EXPECT_EQ(tiny_chunks.signature(0, 300000), one_chunk.signature(0, 300000));
+	
+	EXPECT_EQ(small_chunks.signature(12345, 2000), one_chunk.signature(12345, 2000));
+}
+
+TEST(SimilarityIndex, Signature)
+{
+	std::vector<unsigned char> data = random_data(100000, 2);
+	
+	/* Same block of data at two places in the file. */
+	std::vector<unsigned char> block = random_data(4096, 3);
+	std::copy(block.begin(), block.end(), data.begin() + 10000);
+	std::copy(block.begin(), block.end(), data.begin() + 70001);
+	
+	SharedDocumentPointer doc = make_doc(data);
+	
+	SimilarityIndex index(doc, SimilarityIndex::block_size_for(4096));
+	index.wait_for_completion();
+	
+	std::string sig = index.signature(10000, 4096);
+	
+	EXPECT_GE(sig.size(), 16U);
+	EXPECT_LE(sig.size(), 128U);
+	
+	EXPECT_EQ(index.signature(70001, 4096), sig) << "Signature doesn't depend on position in file";
+	
+	EXPECT_EQ(index.signature(10000, 0), "");
+	EXPECT_EQ(index.signature(200000, 4096), "");
+}
+
+TEST(SimilarityIndex, FindSimilar)
+{
+	std::vector<unsigned char> data = random_data(1024 * 1024, 4);
+	
+	std::vector<unsigned char> block(data.begin() + 20000, data.begin() + 28192);
+	
+	/* Exact copy. */
+	std::copy(block.begin(), block.end(), data.begin() + 100000);
+	
+	/* Copy with a few bytes changed. */
+	std::copy(block.begin(), block.end(), data.begin() + 500000);
+	data[500000 + 1000] ^= 0xFF;
+	data[500000 + 5000] ^= 0xFF;
+	
+	/* Copy with the second half moved along by 200 bytes. */
+	std::copy(block.begin(), block.begin() + 4096, data.begin() + 800000);
+	std::copy(block.begin() + 4096, block.end(), data.begin() + 800000 + 4096 + 200);
+	
+	SharedDocumentPointer doc = make_doc(data);
+	
+	SimilarityIndex index(doc, SimilarityIndex::block_size_for(block.size()));
+	index.wait_for_completion();
+	
+	std::vector<Match> matches = index.find_similar(20000, block.size(), 50, 10);
+	ASSERT_EQ(matches.size(), 3U);
+	
+	/* Matches start at a piece boundary near the copy, which may be a little before or
+	 * after it.
+	*/
+	
+	const off_t SLACK = SimilarityIndex::block_size_for(block.size()) * 8;
+	
+	auto match_near = [&](off_t offset)
+	{
+		for(auto m = matches.begin(); m != matches.end(); ++m)
+		{
+			if(m->offset > (offset - SLACK) && m->offset < (offset + SLACK))
+			{
+				return *m;
+			}
+		}
+		
+		return Match(-1, 0, 0);
+	};
+	
+	EXPECT_EQ(matches[0], match_near(100000)) << "SimilarityIndex::find_similar() ranks exact copy first";
+	EXPECT_EQ(matches[0].score, 100);
+	EXPECT_EQ(matches[0].length, (off_t)(block.size()));
+	
+	EXPECT_GE(match_near(500000).score, 50) << "SimilarityIndex::find_similar() finds copy with changed bytes";
+	EXPECT_GE(match_near(800000).score, 50) << "SimilarityIndex::find_similar() finds copy with inserted bytes";
+	
+	EXPECT_EQ(index.find_similar(20000, block.size(), 50, 1), std::vector<Match>({ matches[0] })) << "SimilarityIndex::find_similar() returns at most max_results matches";
+}
+
+TEST(SimilarityIndex, UniformData)
+{
+	/* Runs of a single byte never end a piece, so there is nothing to search for. */
+	
+	std::vector<unsigned char> data(256 * 1024, 0xFF);
+	SharedDocumentPointer doc = make_doc(data);
+	
+	SimilarityIndex index(doc, 24);
+	index.wait_for_completion();
+	
+	EXPECT_EQ(index.get_num_pieces(), 0U);
+	EXPECT_EQ(index.find_similar(0, 4096, 1, 10), std::vector<Match>());
+}
+
+TEST(SimilarityIndex, EmptyDocument)
+{
+	SharedDocumentPointer doc(SharedDocumentPointer::make());
+	
+	SimilarityIndex index(doc, 24);
+	
+	EXPECT_TRUE(index.is_complete());
+	EXPECT_EQ(index.get_num_pieces(), 0U);
+}
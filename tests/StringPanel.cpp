@@ -187,6 +187,64 @@ TEST_F(StringPanelTest, MixedFile)
 	EXPECT_EQ(got_strings, EXPECT_STRINGS) << "StringPanel finds strings in mixed file";
 }
 
+TEST_F(StringPanelTest, SkipRanges)
+{
+	std::vector<unsigned char> data;
+	
+	for(off_t i = 0; i < 1024; ++i)
+	{
+		data.push_back(i % 256);
+	}
+	
+	doc->insert_data(0, data.data(), data.size());
+	
+	ByteRangeSet skip_ranges;
+	skip_ranges.set_range(256, 256);
+	skip_ranges.set_range(600, 100);
+	doc->set_skip_ranges(skip_ranges);
+	
+	string_panel = new StringPanel(&frame, doc, main_doc_ctrl);
+	string_panel->set_min_string_length(4);
+	string_panel->set_visible(true);
+	
+	wait_for_idle(10000);
+	
+	EXPECT_EQ(string_panel->get_clean_bytes(), 1024U) << "StringPanel processed all data in file";
+	
+	{
+		ByteRangeSet strings = string_panel->get_strings();
+		std::vector<ByteRangeSet::Range> got_strings(strings.begin(), strings.end());
+		
+		const std::vector<ByteRangeSet::Range> EXPECT_STRINGS = {
+			ByteRangeSet::Range( 32, 95),
+			ByteRangeSet::Range(544, 95),
+			ByteRangeSet::Range(800, 95),
+		};
+		
+		EXPECT_EQ(got_strings, EXPECT_STRINGS) << "StringPanel ignores strings entirely within skip ranges";
+	}
+	
+	doc->set_skip_ranges(ByteRangeSet());
+	
+	wait_for_idle(10000);
+	
+	EXPECT_EQ(string_panel->get_clean_bytes(), 1024U) << "StringPanel processed all data in file";
+	
+	{
+		ByteRangeSet strings = string_panel->get_strings();
+		std::vector<ByteRangeSet::Range> got_strings(strings.begin(), strings.end());
+		
+		const std::vector<ByteRangeSet::Range> EXPECT_STRINGS = {
+			ByteRangeSet::Range( 32, 95),
+			ByteRangeSet::Range(288, 95),
+			ByteRangeSet::Range(544, 95),
+			ByteRangeSet::Range(800, 95),
+		};
+		
+		EXPECT_EQ(got_strings, EXPECT_STRINGS) << "StringPanel finds strings again when skip ranges are cleared";
+	}
+}
+
 TEST_F(StringPanelTest, OverwriteDataTruncatesString)
 {
 	const std::vector<unsigned char> BIN_DATA(1024, 0x1B);
@@ -878,6 +936,86 @@ TEST_F(StringPanelTest, UTF16)
 	}
 }
 
+TEST_F(StringPanelTest, MultipleEncodings)
+{
+	const unsigned char DATA[] = {
+		/* Padding */
+		/* 0x00 */ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		
+		/* Short ASCII-only string */
+		/* 0x08 */ 'A', 'B', 'C', 0x00, 0x00, 0x00, 0x00, 0x00,
+		
+		/* ASCII-only string */
+		/* 0x10 */ 'A', 'B', 'C', 'D', 'E', 'F', 0x00, 0x00,
+		
+		/* Padding */
+		/* 0x18 */ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		
+		/* Mixed ASCII/UTF-8 string */
+		/* 0x20 */ 'A', 'B', 0xC3, 0xB4, 0xC3, 0xBC, 0x00, 0x00,
+		
+		/* "Hello" in UTF-16LE */
+		/* 0x28 */ 'H', 0x00,  'e', 0x00,  'l', 0x00,  'l', 0x00,
+		/* 0x30 */ 'o', 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	
+	};
+	
+	doc->insert_data(0, DATA, sizeof(DATA));
+	
+	string_panel = new StringPanel(&frame, doc, main_doc_ctrl);
+	string_panel->set_encoding("ASCII");
+	string_panel->set_extra_encoding("UTF-16LE", true);
+	string_panel->set_min_string_length(4);
+	string_panel->set_visible(true);
+	
+	wait_for_idle(10000);
+	
+	ASSERT_EQ(string_panel->get_clean_bytes(), 0x38);
+	ASSERT_EQ(string_panel->get_num_threads(), 0U);
+	
+	{
+		ByteRangeSet strings = string_panel->get_strings("ASCII");
+		std::vector<ByteRangeSet::Range> got_strings(strings.begin(), strings.end());
+		
+		const std::vector<ByteRangeSet::Range> EXPECT_STRINGS = {
+			ByteRangeSet::Range(0x10, 6),
+		};
+		
+		EXPECT_EQ(got_strings, EXPECT_STRINGS) << "StringPanel finds strings in main encoding";
+	}
+	
+	{
+		ByteRangeSet strings = string_panel->get_strings("UTF-16LE");
+		std::vector<ByteRangeSet::Range> got_strings(strings.begin(), strings.end());
+		
+		const std::vector<ByteRangeSet::Range> EXPECT_STRINGS = {
+			ByteRangeSet::Range(0x28, 10),
+		};
+		
+		EXPECT_EQ(got_strings, EXPECT_STRINGS) << "StringPanel finds strings in extra encoding";
+	}
+	
+	{
+		ByteRangeSet strings = string_panel->get_strings();
+		std::vector<ByteRangeSet::Range> got_strings(strings.begin(), strings.end());
+		
+		const std::vector<ByteRangeSet::Range> EXPECT_STRINGS = {
+			ByteRangeSet::Range(0x10, 6),
+			ByteRangeSet::Range(0x28, 10),
+		};
+		
+		EXPECT_EQ(got_strings, EXPECT_STRINGS) << "StringPanel finds strings in all encodings";
+	}
+	
+	string_panel->select_all();
+	EXPECT_EQ(string_panel->copy_get_string(&StringPanel::get_item_string), "ABCDEF\nHello") << "Strings in all encodings are listed";
+	
+	string_panel->set_encoding_filter("UTF-16LE");
+	
+	string_panel->select_all();
+	EXPECT_EQ(string_panel->copy_get_string(&StringPanel::get_item_string), "Hello") << "Strings can be filtered by encoding";
+}
+
 TEST_F(StringPanelTest, SelectAllCopyText)
 {
 	std::vector<unsigned char> data(1024, 0);
@@ -0,0 +1,215 @@
+/* Reverse Engineer's Hex Editor
+ * Copyright (C) 2024 Daniel Collins <solemnwarning@solemnwarning.net>
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "../src/platform.hpp"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <math.h>
+#include <portable_endian.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "../src/document.hpp"
+#include "../src/SharedDocumentPointer.hpp"
+#include "../src/ValuePlotPyramid.hpp"
+#include "testutil.hpp"
+
+using namespace REHex;
+
+typedef ValuePlotPyramid::Summary Summary;
+
+static Summary brute_summarise(const std::vector<unsigned char> &data, off_t offset, off_t stride, off_t first, off_t count, ValuePlotPyramid::ValueType type)
+{
+	Summary summary;
+	
+	for(off_t i = first; i < (first + count); ++i)
+	{
+		summary.add(ValuePlotPyramid::decode(type, (data.data() + offset + (i * stride))));
+	}
+	
+	return summary;
+}
+
+#define EXPECT_SUMMARY_EQ(actual, expected) \
+{ \
+	Summary a = (actual); \
+	Summary e = (expected); \
+	EXPECT_EQ(a.count, e.count); \
+	EXPECT_EQ(a.min, e.min); \
+	EXPECT_EQ(a.max, e.max); \
+	EXPECT_DOUBLE_EQ(a.sum, e.sum); \
+}
+
+TEST(ValuePlotPyramid, Decode)
+{
+	const unsigned char DATA[] = { 0xFE, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xF0, 0x3F };
+	
+	EXPECT_EQ(ValuePlotPyramid::decode(ValuePlotPyramid::VT_U8, DATA), 254.0);
+	EXPECT_EQ(ValuePlotPyramid::decode(ValuePlotPyramid::VT_S8, DATA), -2.0);
+	EXPECT_EQ(ValuePlotPyramid::decode(ValuePlotPyramid::VT_U16LE, DATA), 65534.0);
+	EXPECT_EQ(ValuePlotPyramid::decode(ValuePlotPyramid::VT_U16BE, DATA), 65279.0);
+	EXPECT_EQ(ValuePlotPyramid::decode(ValuePlotPyramid::VT_S16LE, DATA), -2.0);
+	EXPECT_EQ(ValuePlotPyramid::decode(ValuePlotPyramid::VT_S32LE, DATA), 65534.0);
+	EXPECT_EQ(ValuePlotPyramid::decode(ValuePlotPyramid::VT_S32BE, DATA), -16842752.0);
+	EXPECT_EQ(ValuePlotPyramid::decode(ValuePlotPyramid::VT_F64LE, DATA), 1.0 + (65534.0 / 4503599627370496.0));
+	EXPECT_EQ(ValuePlotPyramid::decode(ValuePlotPyramid::VT_F32LE, (DATA + 4)), 1.875);
+}
+
+TEST(ValuePlotPyramid, EmptySeries)
+{
+	SharedDocumentPointer doc = make_doc(random_data(1024, 1));
+	
+	ValuePlotPyramid pyramid(doc, 0, 1, 0, ValuePlotPyramid::VT_U8);
+	pyramid.wait_for_completion();
+	
+	ASSERT_TRUE(pyramid.is_complete());
+	EXPECT_EQ(pyramid.get_progress(), 1.0);
+	
+	EXPECT_EQ(pyramid.summarise_all().count, 0);
+	EXPECT_EQ(pyramid.summarise(0, 100).count, 0);
+	EXPECT_TRUE(pyramid.read_samples(0, 100).empty());
+}
+
+TEST(ValuePlotPyramid, ReadSamples)
+{
+	std::vector<unsigned char> data = random_data(1024, 2);
+	SharedDocumentPointer doc = make_doc(data);
+	
+	ValuePlotPyramid pyramid(doc, 3, 5, 100, ValuePlotPyramid::VT_U16BE);
+	pyramid.wait_for_completion();
+	
+	std::vector<double> samples = pyramid.read_samples(10, 20);
+	ASSERT_EQ(samples.size(), 20U);
+	
+	for(size_t i = 0; i < samples.size(); ++i)
+	{
+		EXPECT_EQ(samples[i], (double)((data[3 + ((10 + i) * 5)] << 8) | data[3 + ((10 + i) * 5) + 1])) << "Sample " << (10 + i);
+	}
+	
+	EXPECT_EQ(pyramid.read_samples(90, 20).size(), 10U) << "Reads are clamped to the end of the series";
+}
+
+TEST(ValuePlotPyramid, SummariseAll)
+{
+	/* Enough samples for several chunks and levels built by build_upper_levels(). */
+	const off_t NUM_SAMPLES = (ValuePlotPyramid::BASE_BLOCK * ValuePlotPyramid::CHUNK_BLOCKS * 5) + 1234;
+	
+	std::vector<unsigned char> data = random_data(((NUM_SAMPLES * 3) + 16), 3);
+	SharedDocumentPointer doc = make_doc(data);
+	
+	ValuePlotPyramid pyramid(doc, 7, 3, NUM_SAMPLES, ValuePlotPyramid::VT_S16LE);
+	pyramid.wait_for_completion();
+	
+	ASSERT_TRUE(pyramid.is_complete());
+	
+	EXPECT_SUMMARY_EQ(pyramid.summarise_all(), brute_summarise(data, 7, 3, 0, NUM_SAMPLES, ValuePlotPyramid::VT_S16LE));
+	EXPECT_SUMMARY_EQ(pyramid.summarise(0, NUM_SAMPLES), brute_summarise(data, 7, 3, 0, NUM_SAMPLES, ValuePlotPyramid::VT_S16LE));
+}
+
+TEST(ValuePlotPyramid, SummariseAlignedRanges)
+{
+	const off_t NUM_SAMPLES = (ValuePlotPyramid::BASE_BLOCK * ValuePlotPyramid::CHUNK_BLOCKS * 3) + 99;
+	const off_t B = ValuePlotPyramid::BASE_BLOCK;
+	
+	std::vector<unsigned char> data = random_data(NUM_SAMPLES, 4);
+	SharedDocumentPointer doc = make_doc(data);
+	
+	ValuePlotPyramid pyramid(doc, 0, 1, NUM_SAMPLES, ValuePlotPyramid::VT_U8);
+	pyramid.wait_for_completion();
+	
+	/* Ranges on block boundaries of the level used are summarised exactly. */
+	
+	EXPECT_SUMMARY_EQ(pyramid.summarise(0, B), brute_summarise(data, 0, 1, 0, B, ValuePlotPyramid::VT_U8));
+	EXPECT_SUMMARY_EQ(pyramid.summarise((B * 5), (B * 2)), brute_summarise(data, 0, 1, (B * 5), (B * 2), ValuePlotPyramid::VT_U8));
+	EXPECT_SUMMARY_EQ(pyramid.summarise((B * 64), (B * 96)), brute_summarise(data, 0, 1, (B * 64), (B * 96), ValuePlotPyramid::VT_U8));
+	EXPECT_SUMMARY_EQ(pyramid.summarise((B * 2048), (B * 2048)), brute_summarise(data, 0, 1, (B * 2048), (B * 2048), ValuePlotPyramid::VT_U8));
+	
+	/* The partial block at the end of the series is included when a range reaches it. */
+	EXPECT_SUMMARY_EQ(pyramid.summarise((NUM_SAMPLES - 99), 99), brute_summarise(data, 0, 1, (NUM_SAMPLES - 99), 99, ValuePlotPyramid::VT_U8));
+	EXPECT_SUMMARY_EQ(pyramid.summarise((NUM_SAMPLES - 99 - (B * 2)), 1000000), brute_summarise(data, 0, 1, (NUM_SAMPLES - 99 - (B * 2)), (99 + (B * 2)), ValuePlotPyramid::VT_U8));
+}
+
+TEST(ValuePlotPyramid, SummariseColumns)
+{
+	const off_t NUM_SAMPLES = 1000003;
+	
+	std::vector<unsigned char> data = random_data((NUM_SAMPLES * 2), 5);
+	SharedDocumentPointer doc = make_doc(data);
+	
+	ValuePlotPyramid pyramid(doc, 0, 2, NUM_SAMPLES, ValuePlotPyramid::VT_U16LE);
+	pyramid.wait_for_completion();
+	
+	Summary all = pyramid.summarise_all();
+	
+	/* Unaligned ranges are rounded to block boundaries, but consecutive ranges (like the
+	 * columns of a plot) summarised from the same level still cover every sample exactly
+	 * once.
+	*/
+	
+	for(int columns = 1; columns <= 1000; columns *= 7)
+	{
+		double samples_per_column = (double)(NUM_SAMPLES) / (double)(columns);
+		size_t level = pyramid.level_for((off_t)(samples_per_column));
+		
+		Summary total;
+		
+		for(int c = 0; c < columns; ++c)
+		{
+			off_t begin = (off_t)(c * samples_per_column);
+			off_t end = (c + 1) == columns ? NUM_SAMPLES : (off_t)((c + 1) * samples_per_column);
+			
+			Summary column = pyramid.summarise(begin, (end - begin), level);
+			EXPECT_GT(column.count, 0) << "Column " << c << " of " << columns;
+			
+			total.add(column);
+		}
+		
+		EXPECT_SUMMARY_EQ(total, all);
+	}
+}
+
+TEST(ValuePlotPyramid, NaNIgnored)
+{
+	std::vector<unsigned char> data;
+	
+	for(int i = 0; i < 1000; ++i)
+	{
+		float f = (i % 3) == 0 ? NAN : (float)(i);
+		
+		uint32_t u;
+		memcpy(&u, &f, sizeof(f));
+		u = htole32(u);
+		
+		unsigned char buf[sizeof(u)];
+		memcpy(buf, &u, sizeof(u));
+		
+		data.insert(data.end(), buf, buf + sizeof(buf));
+	}
+	
+	SharedDocumentPointer doc = make_doc(data);
+	
+	ValuePlotPyramid pyramid(doc, 0, 4, 1000, ValuePlotPyramid::VT_F32LE);
+	pyramid.wait_for_completion();
+	
+	Summary all = pyramid.summarise_all();
+	
+	EXPECT_EQ(all.count, 666);
+	EXPECT_EQ(all.min, 1.0);
+	EXPECT_EQ(all.max, 998.0);
+}
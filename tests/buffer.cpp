@@ -2931,3 +2931,538 @@ TEST(Buffer, ReadBitsAtEOF)
 	
 	EXPECT_EQ(bits, EXPECT);
 }
+
+TEST(Buffer, SnapshotUnaffectedByChanges)
+{
+	TempFilename f1;
+	
+	std::vector<unsigned char> file_data;
+	for(int i = 0; i < 64; ++i) { file_data.push_back(i); }
+	
+	write_file(f1.tmpfile, file_data);
+	
+	REHex::Buffer b(f1.tmpfile, 8);
+	
+	/* Load some of the blocks, leave the rest unloaded. */
+	b.read_data(0, 20);
+	
+	std::shared_ptr<const REHex::Buffer::Snapshot> s1 = b.snapshot();
+	
+	const unsigned char OVERWRITE[] = { 0xAA, 0xBB };
+	const unsigned char INSERT[] = { 0xCC, 0xDD, 0xEE };
+	
+	b.overwrite_data(4, OVERWRITE, 2);
+	b.insert_data(40, INSERT, 3);
+	b.erase_data(10, 20);
+	
+	std::shared_ptr<const REHex::Buffer::Snapshot> s2 = b.snapshot();
+	
+	EXPECT_EQ(s1->length(), 64);
+	EXPECT_EQ(s1->read_data(0, 1024), file_data) << "Snapshot isn't affected by later changes";
+	
+	std::vector<unsigned char> s1_middle(file_data.begin() + 3, file_data.begin() + 43);
+	EXPECT_EQ(s1->read_data(3, 40), s1_middle) << "Snapshot can read ranges spanning blocks";
+	
+	std::vector<unsigned char> expect_s2 = b.read_data(0, 1024);
+	
+	EXPECT_EQ(s2->length(), 47);
+	EXPECT_EQ(s2->read_data(0, 1024), expect_s2) << "Snapshot has contents of Buffer when taken";
+	
+	b.overwrite_data(0, OVERWRITE, 2);
+	
+	EXPECT_EQ(s2->read_data(0, 1024), expect_s2) << "Snapshot isn't affected by later changes";
+	
+	EXPECT_EQ(s1->read_data(64, 10), std::vector<unsigned char>()) << "Reading past end of snapshot returns no data";
+}
+
+TEST(Buffer, SnapshotReadBitAligned)
+{
+	TempFilename f1;
+	write_file(f1.tmpfile, std::vector<unsigned char>({ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09 }));
+	
+	REHex::Buffer b(f1.tmpfile, 4);
+	
+	std::shared_ptr<const REHex::Buffer::Snapshot> s = b.snapshot();
+	
+	EXPECT_EQ(s->read_data(REHex::BitOffset(1, 4), 5), b.read_data(REHex::BitOffset(1, 4), 5));
+	EXPECT_EQ(s->read_data(REHex::BitOffset(6, 1), 10), b.read_data(REHex::BitOffset(6, 1), 10));
+}
+
+TEST(Buffer, SnapshotExpiresOnWriteInplace)
+{
+	TempFilename f1;
+	write_file(f1.tmpfile, std::vector<unsigned char>({ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 }));
+	
+	REHex::Buffer b(f1.tmpfile, 4);
+	
+	b.read_data(0, 4);
+	
+	std::shared_ptr<const REHex::Buffer::Snapshot> s = b.snapshot();
+	
+	const unsigned char INSERT[] = { 0xAA };
+	b.insert_data(0, INSERT, 1);
+	
+	b.write_inplace();
+	
+	/* First block was loaded when the snapshot was taken, so is still readable. */
+	EXPECT_EQ(s->read_data(0, 4), std::vector<unsigned char>({ 0x00, 0x01, 0x02, 0x03 }));
+	
+	/* Second block would've come from the file, which has since been rewritten. */
+	EXPECT_THROW(s->read_data(4, 4), std::runtime_error);
+}
+
+TEST(Buffer, ForkSharesData)
+{
+	TempFilename f1;
+	
+	std::vector<unsigned char> file_data;
+	for(int i = 0; i < 64; ++i) { file_data.push_back(i); }
+	
+	write_file(f1.tmpfile, file_data);
+	
+	REHex::Buffer parent(f1.tmpfile, 8);
+	
+	/* Load and modify some of the blocks, leave the rest unloaded. */
+	parent.read_data(0, 20);
+	
+	const unsigned char OVERWRITE[] = { 0xAA, 0xBB };
+	parent.overwrite_data(4, OVERWRITE, 2);
+	
+	std::vector<unsigned char> expect_data = parent.read_data(0, 1024);
+	
+	REHex::Buffer fork(&parent);
+	
+	EXPECT_EQ(fork.length(), 64);
+	EXPECT_EQ(fork.read_data(0, 1024), expect_data) << "Forked Buffer has contents of parent";
+	
+	ASSERT_EQ(fork.blocks.size(), parent.blocks.size());
+	EXPECT_EQ(fork.blocks[0].data.share(), parent.blocks[0].data.share()) << "Forked Buffer shares loaded blocks with parent";
+	EXPECT_EQ(fork.blocks[0].state, REHex::Buffer::Block::DIRTY);
+}
+
+TEST(Buffer, ForkIndependentChanges)
+{
+	TempFilename f1;
+	
+	std::vector<unsigned char> file_data;
+	for(int i = 0; i < 64; ++i) { file_data.push_back(i); }
+	
+	write_file(f1.tmpfile, file_data);
+	
+	REHex::Buffer parent(f1.tmpfile, 8);
+	parent.read_data(0, 20);
+	
+	REHex::Buffer fork(&parent);
+	
+	const unsigned char OVERWRITE[] = { 0xAA, 0xBB };
+	const unsigned char INSERT[] = { 0xCC, 0xDD, 0xEE };
+	
+	fork.overwrite_data(4, OVERWRITE, 2);
+	fork.insert_data(40, INSERT, 3);
+	
+	parent.erase_data(10, 20);
+	
+	std::vector<unsigned char> expect_parent(file_data);
+	expect_parent.erase(expect_parent.begin() + 10, expect_parent.begin() + 30);
+	
+	std::vector<unsigned char> expect_fork(file_data);
+	expect_fork[4] = 0xAA;
+	expect_fork[5] = 0xBB;
+	expect_fork.insert(expect_fork.begin() + 40, INSERT, INSERT + 3);
+	
+	EXPECT_EQ(parent.read_data(0, 1024), expect_parent) << "Changes to forked Buffer don't affect parent";
+	EXPECT_EQ(fork.read_data(0, 1024), expect_fork) << "Changes to parent Buffer don't affect fork";
+	
+	EXPECT_EQ(read_file(f1.tmpfile), file_data) << "Backing file is unchanged";
+}
+
+TEST(Buffer, ForkOutlivesParent)
+{
+	TempFilename f1;
+	write_file(f1.tmpfile, std::vector<unsigned char>({ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 }));
+	
+	REHex::Buffer *parent = new REHex::Buffer(f1.tmpfile, 4);
+	parent->read_data(0, 4);
+	
+	REHex::Buffer fork(parent);
+	delete parent;
+	
+	EXPECT_EQ(fork.read_data(0, 8), std::vector<unsigned char>({ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 }));
+}
+
+TEST(Buffer, ForkUnaffectedByParentWriteInplace)
+{
+	TempFilename f1;
+	
+	std::vector<unsigned char> file_data;
+	for(int i = 0; i < 64; ++i) { file_data.push_back(i); }
+	
+	write_file(f1.tmpfile, file_data);
+	
+	REHex::Buffer parent(f1.tmpfile, 8);
+	parent.read_data(0, 20);
+	
+	REHex::Buffer fork(&parent);
+	
+	const unsigned char INSERT[] = { 0xAA, 0xBB, 0xCC };
+	parent.insert_data(0, INSERT, 3);
+	
+	const unsigned char OVERWRITE[] = { 0xDD, 0xEE };
+	parent.overwrite_data(40, OVERWRITE, 2);
+	
+	parent.write_inplace();
+	
+	std::vector<unsigned char> expect_parent(file_data);
+	expect_parent.insert(expect_parent.begin(), INSERT, INSERT + 3);
+	expect_parent[40] = 0xDD;
+	expect_parent[41] = 0xEE;
+	
+	EXPECT_EQ(read_file(f1.tmpfile), expect_parent) << "Buffer::write_inplace() writes out parent Buffer";
+	
+	EXPECT_EQ(fork.read_data(0, 1024), file_data) << "Forked Buffer keeps original data after parent is written in place";
+	EXPECT_FALSE(fork.file_modified());
+	
+	for(auto b = fork.blocks.begin(); b != fork.blocks.end(); ++b)
+	{
+		EXPECT_NE(b->state, REHex::Buffer::Block::UNLOADED) << "Forked Buffer doesn't read from file after parent is written in place";
+	}
+}
+
+TEST(Buffer, ScanReusesBlockData)
+{
+	TempFilename f1;
+	
+	std::vector<unsigned char> file_data;
+	for(int i = 0; i < 256; ++i) { file_data.push_back(i); }
+	
+	write_file(f1.tmpfile, file_data);
+	
+	REHex::Buffer b(f1.tmpfile, 8);
+	
+	/* Read through the file twice, which loads more blocks than are kept in memory. */
+	for(int pass = 0; pass < 2; ++pass)
+	{
+		for(int i = 0; i < 256; i += 8)
+		{
+			EXPECT_EQ(b.read_data(i, 8), std::vector<unsigned char>(file_data.begin() + i, file_data.begin() + i + 8));
+		}
+	}
+	
+	REHex::BlockPool::Stats stats = b.get_block_pool_stats();
+	
+	EXPECT_EQ(stats.allocated, REHex::Buffer::MAX_CLEAN_BLOCKS + 1) << "Buffer only allocates enough blocks to hold the clean blocks kept in memory";
+	EXPECT_EQ(stats.reused, (64 - stats.allocated)) << "Buffer reuses data of unloaded blocks";
+}
+
+/* Sets the Buffer dirty memory budget for the duration of a test. */
+class DirtyMemoryBudget
+{
+	private:
+		size_t old_budget;
+	
+	public:
+		DirtyMemoryBudget(size_t budget):
+			old_budget(REHex::Buffer::get_dirty_memory_budget())
+		{
+			REHex::Buffer::set_dirty_memory_budget(budget);
+		}
+		
+		~DirtyMemoryBudget()
+		{
+			REHex::Buffer::set_dirty_memory_budget(old_budget);
+		}
+};
+
+TEST(Buffer, SwapOutDirtyBlocks)
+{
+	TempFilename f1;
+	
+	std::vector<unsigned char> file_data;
+	for(int i = 0; i < 64; ++i) { file_data.push_back(i); }
+	
+	write_file(f1.tmpfile, file_data);
+	
+	DirtyMemoryBudget budget(16);
+	
+	{
+		REHex::Buffer b(f1.tmpfile, 8);
+		
+		std::vector<unsigned char> expect_data(file_data);
+		
+		for(int i = 0; i < 64; i += 8)
+		{
+			const unsigned char X = 0xFF;
+			b.overwrite_data(i, &X, 1);
+			
+			expect_data[i] = 0xFF;
+		}
+		
+		EXPECT_EQ(REHex::Buffer::get_dirty_memory_used(), 16U) << "Buffer keeps dirty data in memory up to the budget";
+		
+		EXPECT_EQ(b.blocks[0].state, REHex::Buffer::Block::SWAPPED) << "Buffer swaps out least recently used dirty blocks";
+		EXPECT_EQ(b.blocks[5].state, REHex::Buffer::Block::SWAPPED) << "Buffer swaps out least recently used dirty blocks";
+		EXPECT_EQ(b.blocks[6].state, REHex::Buffer::Block::DIRTY) << "Buffer keeps most recently used dirty blocks";
+		EXPECT_EQ(b.blocks[7].state, REHex::Buffer::Block::DIRTY) << "Buffer keeps most recently used dirty blocks";
+		
+		EXPECT_EQ(b.read_data(0, 1024), expect_data) << "Buffer reads back swapped out blocks";
+		EXPECT_LE(REHex::Buffer::get_dirty_memory_used(), 16U);
+		
+		b.write_inplace();
+		
+		EXPECT_EQ(read_file(f1.tmpfile), expect_data) << "Buffer::write_inplace() writes swapped out blocks";
+		EXPECT_EQ(REHex::Buffer::get_dirty_memory_used(), 0U);
+		
+		for(auto i = b.blocks.begin(); i != b.blocks.end(); ++i)
+		{
+			EXPECT_NE(i->state, REHex::Buffer::Block::DIRTY);
+			EXPECT_NE(i->state, REHex::Buffer::Block::SWAPPED);
+		}
+		
+		EXPECT_EQ(b.read_data(0, 1024), expect_data);
+	}
+	
+	EXPECT_EQ(REHex::Buffer::get_dirty_memory_used(), 0U);
+}
+
+TEST(Buffer, ForkCountsSharedDirtyDataOnce)
+{
+	TempFilename f1;
+	
+	std::vector<unsigned char> file_data;
+	for(int i = 0; i < 64; ++i) { file_data.push_back(i); }
+	
+	write_file(f1.tmpfile, file_data);
+	
+	DirtyMemoryBudget budget(1024);
+	
+	{
+		REHex::Buffer b(f1.tmpfile, 8);
+		
+		const unsigned char X = 0xFF;
+		b.overwrite_data(0, &X, 1);
+		b.overwrite_data(8, &X, 1);
+		
+		EXPECT_EQ(REHex::Buffer::get_dirty_memory_used(), 16U);
+		
+		{
+			REHex::Buffer fork(&b);
+			
+			EXPECT_EQ(REHex::Buffer::get_dirty_memory_used(), 16U) << "Dirty data shared with a fork is only counted once";
+			
+			fork.read_data(0, 1024);
+			EXPECT_EQ(REHex::Buffer::get_dirty_memory_used(), 16U) << "Dirty data shared with a fork is only counted once";
+			
+			const unsigned char Y = 0xAA;
+			fork.overwrite_data(0, &Y, 1);
+			
+			EXPECT_EQ(REHex::Buffer::get_dirty_memory_used(), 24U) << "Dirty data copied by a fork is counted";
+			
+			b.overwrite_data(8, &Y, 1);
+			
+			EXPECT_EQ(REHex::Buffer::get_dirty_memory_used(), 32U) << "Dirty data copied by the parent is counted";
+		}
+		
+		EXPECT_EQ(REHex::Buffer::get_dirty_memory_used(), 16U) << "Dirty data of a destroyed fork isn't counted";
+	}
+	
+	EXPECT_EQ(REHex::Buffer::get_dirty_memory_used(), 0U);
+}
+
+TEST(Buffer, SwapOutInsertedData)
+{
+	TempFilename f1, f2;
+	
+	std::vector<unsigned char> file_data;
+	for(int i = 0; i < 16; ++i) { file_data.push_back(i); }
+	
+	write_file(f1.tmpfile, file_data);
+	
+	DirtyMemoryBudget budget(64);
+	
+	{
+		REHex::Buffer b(f1.tmpfile, 8);
+		
+		std::vector<unsigned char> insert_data(1000, 0xAA);
+		b.insert_data(4, insert_data.data(), insert_data.size());
+		
+		EXPECT_EQ(b.blocks[0].state, REHex::Buffer::Block::SWAPPED) << "Buffer swaps out inserted data beyond the budget";
+		EXPECT_LE(REHex::Buffer::get_dirty_memory_used(), 64U);
+		
+		EXPECT_EQ(b.blocks.size(), 127U) << "Buffer splits large inserts into block sized blocks";
+		
+		for(auto i = b.blocks.begin(); i != b.blocks.end(); ++i)
+		{
+			EXPECT_LE(i->virt_length, 8) << "Buffer splits large inserts into block sized blocks";
+		}
+		
+		std::vector<unsigned char> expect_data(file_data);
+		expect_data.insert(expect_data.begin() + 4, insert_data.begin(), insert_data.end());
+		
+		b.write_copy(f2.tmpfile);
+		
+		EXPECT_EQ(read_file(f2.tmpfile), expect_data) << "Buffer::write_copy() writes swapped out blocks";
+		EXPECT_EQ(b.blocks[0].state, REHex::Buffer::Block::SWAPPED) << "Buffer::write_copy() doesn't page in swapped out blocks";
+		
+		b.write_inplace();
+		
+		EXPECT_EQ(read_file(f1.tmpfile), expect_data) << "Buffer::write_inplace() writes swapped out blocks";
+	}
+	
+	EXPECT_EQ(REHex::Buffer::get_dirty_memory_used(), 0U);
+}
+
+TEST(Buffer, InsertSplitsGrownBlock)
+{
+	TempFilename f1;
+	write_file(f1.tmpfile, std::vector<unsigned char>({ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09 }));
+	
+	REHex::Buffer b(f1.tmpfile, 4);
+	
+	std::vector<unsigned char> expect_data({ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09 });
+	
+	/* Insert one byte at a time into the middle of the first block. */
+	for(int i = 0; i < 6; ++i)
+	{
+		const unsigned char X = 0xA0 + i;
+		b.insert_data((2 + i), &X, 1);
+		
+		expect_data.insert((expect_data.begin() + 2 + i), X);
+	}
+	
+	EXPECT_EQ(b.read_data(0, 1024), expect_data);
+	
+	for(auto i = b.blocks.begin(); i != b.blocks.end(); ++i)
+	{
+		EXPECT_LE(i->virt_length, 8) << "Buffer doesn't grow blocks beyond twice the block size";
+	}
+	
+	b.write_inplace();
+	
+	EXPECT_EQ(read_file(f1.tmpfile), expect_data) << "Buffer::write_inplace() writes split blocks";
+	EXPECT_EQ(b.read_data(0, 1024), expect_data);
+}
+
+TEST(Buffer, SwapFileReusesSpace)
+{
+	TempFilename f1;
+	
+	std::vector<unsigned char> file_data;
+	for(int i = 0; i < 64; ++i) { file_data.push_back(i); }
+	
+	write_file(f1.tmpfile, file_data);
+	
+	DirtyMemoryBudget budget(8);
+	
+	REHex::Buffer b(f1.tmpfile, 8);
+	
+	const unsigned char X = 0xFF;
+	b.overwrite_data(0, &X, 1);
+	b.overwrite_data(8, &X, 1);
+	
+	std::vector<unsigned char> expect_data(file_data);
+	expect_data[0] = 0xFF;
+	expect_data[8] = 0xFF;
+	
+	ASSERT_EQ(b.blocks[0].state, REHex::Buffer::Block::SWAPPED);
+	ASSERT_TRUE(b.swap_file);
+	EXPECT_EQ(b.swap_file->get_length(), 8);
+	
+	for(int i = 0; i < 4; ++i)
+	{
+		EXPECT_EQ(b.read_data(0, 16), std::vector<unsigned char>(expect_data.begin(), expect_data.begin() + 16));
+		EXPECT_EQ(b.read_data(8, 8), std::vector<unsigned char>(expect_data.begin() + 8, expect_data.begin() + 16));
+	}
+	
+	EXPECT_EQ(b.swap_file->get_length(), 8) << "Swap file space is reused when blocks are paged back in";
+	
+	/* Space referenced by a snapshot mustn't be reused. */
+	
+	ASSERT_EQ(b.blocks[0].state, REHex::Buffer::Block::SWAPPED);
+	std::shared_ptr<const REHex::Buffer::Snapshot> s = b.snapshot();
+	
+	EXPECT_EQ(b.read_data(0, 8), std::vector<unsigned char>(expect_data.begin(), expect_data.begin() + 8));
+	EXPECT_EQ(b.blocks[1].state, REHex::Buffer::Block::SWAPPED);
+	EXPECT_EQ(b.swap_file->get_length(), 16);
+	
+	EXPECT_EQ(s->read_data(0, 1024), expect_data) << "Snapshot reads swapped out data after the block is paged in";
+	
+	s.reset();
+	
+	EXPECT_EQ(b.read_data(8, 8), std::vector<unsigned char>(expect_data.begin() + 8, expect_data.begin() + 16));
+	EXPECT_EQ(b.swap_file->get_length(), 8) << "Swap file space is reused once the snapshot is released";
+}
+
+TEST(Buffer, SnapshotOfSwappedBlock)
+{
+	TempFilename f1;
+	write_file(f1.tmpfile, std::vector<unsigned char>({ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 }));
+	
+	DirtyMemoryBudget budget(0);
+	
+	REHex::Buffer b(f1.tmpfile, 4);
+	
+	const unsigned char OVERWRITE[] = { 0xAA, 0xBB };
+	b.overwrite_data(2, OVERWRITE, 2);
+	
+	ASSERT_EQ(b.blocks[0].state, REHex::Buffer::Block::SWAPPED);
+	
+	std::shared_ptr<const REHex::Buffer::Snapshot> s = b.snapshot();
+	
+	b.overwrite_data(0, OVERWRITE, 2);
+	
+	EXPECT_EQ(s->read_data(0, 8), std::vector<unsigned char>({ 0x00, 0x01, 0xAA, 0xBB, 0x04, 0x05, 0x06, 0x07 })) << "Snapshot reads swapped out blocks";
+	EXPECT_EQ(b.read_data(0, 8), std::vector<unsigned char>({ 0xAA, 0xBB, 0xAA, 0xBB, 0x04, 0x05, 0x06, 0x07 }));
+}
+
+TEST(Buffer, MultiFileRead)
+{
+	TempFilename f1, f2, f3, f4;
+	
+	std::vector<unsigned char> file_data;
+	for(int i = 0; i < 40; ++i) { file_data.push_back(i); }
+	
+	write_file(f1.tmpfile, std::vector<unsigned char>(file_data.begin(), file_data.begin() + 10));
+	write_file(f2.tmpfile, std::vector<unsigned char>());
+	write_file(f3.tmpfile, std::vector<unsigned char>(file_data.begin() + 10, file_data.begin() + 13));
+	write_file(f4.tmpfile, std::vector<unsigned char>(file_data.begin() + 13, file_data.end()));
+	
+	REHex::Buffer b(std::vector<std::string>({ f1.tmpfile, f2.tmpfile, f3.tmpfile, f4.tmpfile }), 8);
+	
+	EXPECT_EQ(b.length(), 40);
+	EXPECT_EQ(b.read_data(0, 1024), file_data) << "Buffer presents files as one contiguous buffer";
+	EXPECT_EQ(b.read_data(9, 6), std::vector<unsigned char>(file_data.begin() + 9, file_data.begin() + 15)) << "Buffer reads across file boundaries";
+	
+	std::shared_ptr<const REHex::Buffer::Snapshot> s = b.snapshot();
+	EXPECT_EQ(s->read_data(0, 1024), file_data) << "Snapshot reads from multiple files";
+	
+	REHex::Buffer fork(&b);
+	EXPECT_EQ(fork.read_data(0, 1024), file_data) << "Fork of multi-file Buffer reads from multiple files";
+}
+
+TEST(Buffer, MultiFileWrite)
+{
+	TempFilename f1, f2, f3;
+	
+	write_file(f1.tmpfile, std::vector<unsigned char>({ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05 }));
+	write_file(f2.tmpfile, std::vector<unsigned char>({ 0x06, 0x07, 0x08, 0x09 }));
+	
+	REHex::Buffer b(std::vector<std::string>({ f1.tmpfile, f2.tmpfile }), 4);
+	
+	const unsigned char OVERWRITE[] = { 0xAA, 0xBB };
+	b.overwrite_data(5, OVERWRITE, 2);
+	
+	EXPECT_THROW(b.write_inplace(f2.tmpfile), std::runtime_error) << "Buffer refuses to overwrite one of its files";
+	
+	EXPECT_EQ(read_file(f1.tmpfile), std::vector<unsigned char>({ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05 }));
+	EXPECT_EQ(read_file(f2.tmpfile), std::vector<unsigned char>({ 0x06, 0x07, 0x08, 0x09 }));
+	
+	const std::vector<unsigned char> EXPECT = { 0x00, 0x01, 0x02, 0x03, 0x04, 0xAA, 0xBB, 0x07, 0x08, 0x09 };
+	
+	b.write_inplace(f3.tmpfile);
+	
+	EXPECT_EQ(read_file(f3.tmpfile), EXPECT) << "Buffer::write_inplace() writes out concatenated data";
+	EXPECT_EQ(read_file(f1.tmpfile), std::vector<unsigned char>({ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05 }));
+	EXPECT_EQ(read_file(f2.tmpfile), std::vector<unsigned char>({ 0x06, 0x07, 0x08, 0x09 }));
+	
+	EXPECT_EQ(b.read_data(0, 1024), EXPECT);
+}
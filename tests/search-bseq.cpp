@@ -314,4 +314,125 @@ TEST(Search, ByteSequence)
 		
 		EXPECT_EQ(s.find_next(0, 4), 6) << "REHEX::Search::ByteSequence::find_next() finds search-window-sized byte sequences which span two windows";
 	}
+	
+	{
+		wxFrame frame(NULL, wxID_ANY, wxT("Unit tests"));
+		REHex::SharedDocumentPointer doc(REHex::SharedDocumentPointer::make(TMPFILE));
+		
+		REHex::ByteRangeSet skip_ranges;
+		skip_ranges.set_range(0x10, 0x20);
+		doc->set_skip_ranges(skip_ranges);
+		
+		const unsigned char SEARCH_DATA[] = { 0x20, 0x21 };
+		REHex::Search::ByteSequence s(&frame, doc, std::vector<unsigned char>(SEARCH_DATA, SEARCH_DATA + 2));
+		
+		EXPECT_EQ(s.find_next(0), (128 + 0x20)) << "REHEX::Search::ByteSequence::find_next() skips byte sequences starting in the document's skip ranges";
+	}
+	
+	{
+		wxFrame frame(NULL, wxID_ANY, wxT("Unit tests"));
+		REHex::SharedDocumentPointer doc(REHex::SharedDocumentPointer::make(TMPFILE));
+		
+		REHex::ByteRangeSet skip_ranges;
+		skip_ranges.set_range(0x21, 0x10);
+		doc->set_skip_ranges(skip_ranges);
+		
+		const unsigned char SEARCH_DATA[] = { 0x20, 0x21 };
+		REHex::Search::ByteSequence s(&frame, doc, std::vector<unsigned char>(SEARCH_DATA, SEARCH_DATA + 2));
+		
+		EXPECT_EQ(s.find_next(0), 0x20) << "REHEX::Search::ByteSequence::find_next() finds byte sequences which start before the document's skip ranges";
+	}
+}
+
+TEST(Search, ApproxByteSequence)
+{
+	FILE *tmp = fopen(TMPFILE, "wb");
+	assert(tmp != NULL);
+	for(int c = 0; c < 128; ++c) { fputc(c, tmp); }
+	for(int c = 0; c < 256; ++c) { fputc(c, tmp); }
+	fclose(tmp);
+	
+	typedef REHex::Search::ApproxByteSequence::Metric Metric;
+	
+	{
+		wxFrame frame(NULL, wxID_ANY, wxT("Unit tests"));
+		REHex::SharedDocumentPointer doc(REHex::SharedDocumentPointer::make(TMPFILE));
+		
+		const unsigned char SEARCH_DATA[] = { 0x20, 0x99, 0x22, 0x23 };
+		REHex::Search::ApproxByteSequence s(&frame, doc, std::vector<unsigned char>(SEARCH_DATA, SEARCH_DATA + 4), 1, Metric::HAMMING);
+		
+		EXPECT_EQ(s.find_next(0), 0x20) << "REHEX::Search::ApproxByteSequence::find_next() finds byte sequence with a changed byte";
+		EXPECT_EQ(s.find_next(0x21), (128 + 0x20)) << "REHEX::Search::ApproxByteSequence::find_next() finds repeated byte sequence with a changed byte";
+	}
+	
+	{
+		wxFrame frame(NULL, wxID_ANY, wxT("Unit tests"));
+		REHex::SharedDocumentPointer doc(REHex::SharedDocumentPointer::make(TMPFILE));
+		
+		const unsigned char SEARCH_DATA[] = { 0x20, 0x99, 0x22, 0x99 };
+		REHex::Search::ApproxByteSequence s(&frame, doc, std::vector<unsigned char>(SEARCH_DATA, SEARCH_DATA + 4), 1, Metric::HAMMING);
+		
+		EXPECT_EQ(s.find_next(0), -1) << "REHEX::Search::ApproxByteSequence::find_next() doesn't find byte sequence with too many changed bytes";
+	}
+	
+	{
+		wxFrame frame(NULL, wxID_ANY, wxT("Unit tests"));
+		REHex::SharedDocumentPointer doc(REHex::SharedDocumentPointer::make(TMPFILE));
+		
+		const unsigned char SEARCH_DATA[] = { 0x20, 0x21, 0x23, 0x24 };
+		
+		REHex::Search::ApproxByteSequence s1(&frame, doc, std::vector<unsigned char>(SEARCH_DATA, SEARCH_DATA + 4), 1, Metric::HAMMING);
+		EXPECT_EQ(s1.find_next(0), -1) << "REHEX::Search::ApproxByteSequence::find_next() doesn't find byte sequence with a deleted byte when only counting changed bytes";
+		
+		REHex::Search::ApproxByteSequence s2(&frame, doc, std::vector<unsigned char>(SEARCH_DATA, SEARCH_DATA + 4), 1, Metric::LEVENSHTEIN);
+		EXPECT_EQ(s2.find_next(0), 0x20) << "REHEX::Search::ApproxByteSequence::find_next() finds byte sequence with a deleted byte";
+	}
+	
+	{
+		wxFrame frame(NULL, wxID_ANY, wxT("Unit tests"));
+		REHex::SharedDocumentPointer doc(REHex::SharedDocumentPointer::make(TMPFILE));
+		
+		const unsigned char SEARCH_DATA[] = { 0x40, 0x41, 0x99, 0x42, 0x43, 0x44 };
+		REHex::Search::ApproxByteSequence s(&frame, doc, std::vector<unsigned char>(SEARCH_DATA, SEARCH_DATA + 6), 1, Metric::LEVENSHTEIN);
+		
+		EXPECT_EQ(s.find_next(0), 0x40) << "REHEX::Search::ApproxByteSequence::find_next() finds byte sequence with an inserted byte";
+	}
+	
+	{
+		wxFrame frame(NULL, wxID_ANY, wxT("Unit tests"));
+		REHex::SharedDocumentPointer doc(REHex::SharedDocumentPointer::make(TMPFILE));
+		
+		std::vector<unsigned char> search_data;
+		for(int c = 0x10; c < 0x30; ++c) { search_data.push_back(c); }
+		
+		search_data[3]  = 0xAA;
+		search_data[20] = 0xBB;
+		
+		REHex::Search::ApproxByteSequence s1(&frame, doc, search_data, 2, Metric::HAMMING);
+		EXPECT_EQ(s1.find_next(0), 0x10) << "REHEX::Search::ApproxByteSequence::find_next() finds long byte sequence with changed bytes";
+		
+		REHex::Search::ApproxByteSequence s2(&frame, doc, search_data, 1, Metric::HAMMING);
+		EXPECT_EQ(s2.find_next(0), -1) << "REHEX::Search::ApproxByteSequence::find_next() doesn't find long byte sequence with too many changed bytes";
+		
+		std::vector<unsigned char> data = doc->read_data(0x10, 0x20);
+		
+		EXPECT_EQ(s1.distance(data.data(), data.size()), 2);
+		EXPECT_EQ(s2.distance(data.data(), data.size()), -1);
+	}
+	
+	{
+		wxFrame frame(NULL, wxID_ANY, wxT("Unit tests"));
+		REHex::SharedDocumentPointer doc(REHex::SharedDocumentPointer::make(TMPFILE));
+		
+		const unsigned char SEARCH_DATA[] = { 'h', 'e', 'l', 'l', 'o' };
+		REHex::Search::ApproxByteSequence s(&frame, doc, std::vector<unsigned char>(SEARCH_DATA, SEARCH_DATA + 5), 2, Metric::LEVENSHTEIN);
+		
+		EXPECT_EQ(s.distance("hello", 5), 0);
+		EXPECT_EQ(s.distance("helo!", 5), 1);
+		EXPECT_EQ(s.distance("hxllo", 5), 1);
+		EXPECT_EQ(s.distance("heello", 6), 1);
+		EXPECT_EQ(s.distance("hel", 3), 2);
+		EXPECT_EQ(s.distance("hxlxo", 5), 2);
+		EXPECT_EQ(s.distance("xxxlo", 5), -1);
+	}
 }
@@ -31,6 +31,7 @@
 #include <unistd.h>
 #endif
 
+#include "../src/document.hpp"
 #include "testutil.hpp"
 
 void run_wx_for(unsigned int ms)
@@ -125,6 +126,27 @@ std::vector<unsigned char> read_file(const std::string &filename)
 	return data;
 }
 
+std::vector<unsigned char> random_data(size_t length, uint32_t seed)
+{
+	std::vector<unsigned char> data(length);
+	
+	for(size_t i = 0; i < length; ++i)
+	{
+		seed = (seed * 1103515245) + 12345;
+		data[i] = (seed >> 16) & 0xFF;
+	}
+	
+	return data;
+}
+
+REHex::SharedDocumentPointer make_doc(const std::vector<unsigned char> &data)
+{
+	REHex::SharedDocumentPointer doc(REHex::SharedDocumentPointer::make());
+	doc->insert_data(0, data.data(), data.size());
+	
+	return doc;
+}
+
 TempFilename::TempFilename()
 {
 	if(tmpnam(tmpfile) == NULL)
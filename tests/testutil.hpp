@@ -20,9 +20,13 @@
 
 #include <functional>
 #include <jansson.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
+#include "../src/SharedDocumentPointer.hpp"
+
 #ifdef _WIN32
 #define CONFIG_EOL "\r\n"
 #else
@@ -35,6 +39,12 @@ bool run_wx_until(const std::function<bool()> &predicate, unsigned int timeout_m
 void write_file(const std::string &filename, const std::vector<unsigned char>& data);
 std::vector<unsigned char> read_file(const std::string &filename);
 
+/* Generates length bytes of pseudo-random data, always the same for a given seed. */
+std::vector<unsigned char> random_data(size_t length, uint32_t seed);
+
+/* Creates a new Document containing the given data. */
+REHex::SharedDocumentPointer make_doc(const std::vector<unsigned char> &data);
+
 class TempFilename
 {
 	public: